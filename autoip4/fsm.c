@@ -41,6 +41,9 @@
 #define IPV4LL_RATE_LIMIT_INTERVAL	60000
 #define IPV4LL_DEFEND_INTERVAL		10000
 
+/* Minimal distance between scheduled ARP transmissions (process-wide) */
+#define IPV4LL_PACING_INTERVAL		10
+
 static ni_autoip_event_handler_t *	ni_autoip_fsm_event_handler;
 
 extern int	ni_autoip_device_get_address(ni_autoip_device_t *, struct in_addr *);
@@ -303,6 +306,49 @@ ni_autoip_fsm_process_arp_packet(ni_arp_socket_t *arph, const ni_arp_packet_t *p
 	}
 }
 
+/*
+ * Global pacing of the ARP transmit schedule.
+ *
+ * The per-device state machines run concurrently, and at boot the
+ * randomized probe delays of hundreds of link-local interfaces all
+ * land within the same PROBE_WAIT window. Keep one process-wide
+ * schedule and place the timer slots at least IPV4LL_PACING_INTERVAL
+ * msec apart, so the supplicant never bursts ARP frames no matter
+ * how many interfaces are claiming at once.
+ */
+static unsigned int
+ni_autoip_fsm_pace_timeout(unsigned int wait)
+{
+	static struct timeval schedule;
+	struct timeval now, when, delta;
+
+	ni_timer_get_time(&now);
+	when = now;
+	when.tv_sec += wait / 1000;
+	when.tv_usec += (wait % 1000) * 1000;
+	if (when.tv_usec >= 1000000) {
+		when.tv_sec++;
+		when.tv_usec -= 1000000;
+	}
+
+	if (timercmp(&schedule, &now, <))
+		schedule = now;
+
+	schedule.tv_usec += IPV4LL_PACING_INTERVAL * 1000;
+	if (schedule.tv_usec >= 1000000) {
+		schedule.tv_sec++;
+		schedule.tv_usec -= 1000000;
+	}
+
+	if (timercmp(&when, &schedule, <)) {
+		timersub(&schedule, &now, &delta);
+		wait = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	} else {
+		schedule = when;
+	}
+	return wait;
+}
+
 void
 ni_autoip_fsm_set_timeout(ni_autoip_device_t *dev, unsigned int wait_min, unsigned int wait_max)
 {
@@ -312,6 +358,7 @@ ni_autoip_fsm_set_timeout(ni_autoip_device_t *dev, unsigned int wait_min, unsign
 		if (wait_min < wait_max)
 			wait += (unsigned int) random() % (wait_max - wait_min);
 
+		wait = ni_autoip_fsm_pace_timeout(wait);
 		ni_debug_autoip("%s: setting timeout to %u ms", dev->ifname, wait);
 		if (dev->fsm.timer)
 			ni_timer_rearm(dev->fsm.timer, wait);
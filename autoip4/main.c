@@ -25,6 +25,7 @@
 #include <wicked/socket.h>
 #include <wicked/wireless.h>
 #include <wicked/objectmodel.h>
+#include "workqueue.h"
 #include "autoip4/autoip.h"
 
 enum {
@@ -244,8 +245,56 @@ autoip4_recover_state(ni_netdev_t *ifp)
 /*
  * Functions to support the AUTO4 DBus binding
  */
+
+/*
+ * org.opensuse.Network.AUTO4.getLeaseStatus()
+ *
+ * Bulk lease status query: returns one (index, name, state, uuid,
+ * acquired) dict per device, so that fleet monitoring costs one dbus
+ * round trip instead of one call per interface. IPv4LL leases do not
+ * expire, thus there is no expires member here.
+ */
+static dbus_bool_t
+autoip4_get_lease_status(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	const ni_autoip_device_t *dev;
+	dbus_bool_t rv;
+
+	ni_dbus_dict_array_init(&result);
+	for (dev = ni_autoip_active; dev; dev = dev->next) {
+		ni_dbus_variant_t *dict;
+
+		if (!(dict = ni_dbus_dict_array_add(&result)))
+			break;
+
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_uint32(dict, "index", dev->link.ifindex);
+		ni_dbus_dict_add_string(dict, "name", dev->ifname);
+		ni_dbus_dict_add_string(dict, "state",
+				ni_autoip_fsm_state_name(dev->fsm.state));
+		if (dev->lease) {
+			ni_dbus_dict_add_uuid(dict, "uuid", &dev->lease->uuid);
+			ni_dbus_dict_add_uint64(dict, "acquired",
+					dev->lease->acquired.tv_sec);
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+static ni_dbus_method_t		__wicked_dbus_autoip4_methods[] = {
+	{ "getLeaseStatus",	"",		.handler = autoip4_get_lease_status },
+	{ NULL }
+};
+
 static ni_dbus_service_t	__wicked_dbus_autoip4_interface = {
 	.name		= NI_OBJECTMODEL_AUTO4_INTERFACE,
+	.methods	= __wicked_dbus_autoip4_methods,
 };
 
 
@@ -429,6 +478,10 @@ autoip4_supplicant(void)
 			ni_fatal("unable to background server");
 	}
 
+	/* worker pool for blocking syscall offload; started after the
+	 * daemonizing fork, as threads do not survive it */
+	ni_workqueue_init(0);
+
 	while (!ni_caught_terminal_signal()) {
 		long timeout;
 
@@ -42,9 +42,21 @@
 #include <wicked/util.h>
 
 #include "netinfo_priv.h"
+#include "util_priv.h"
 
 struct arp_ops;
 
+/*
+ * One address probed or announced in a verify/notify batch; all
+ * targets share the capture socket and the timer schedule, so a
+ * whole batch costs one probe round instead of one run per address.
+ */
+struct arp_target {
+	ni_sockaddr_t		ipaddr;
+	ni_hwaddr_t		hwaddr;		/* verify: conflicting owner */
+	unsigned int		sent_cnt;
+};
+
 struct arp_handle {
 	ni_bool_t		verbose;
 	unsigned int		count;
@@ -58,9 +70,11 @@ struct arp_handle {
 
 	const char *		ifname;
 	ni_sockaddr_t		ipaddr;
-	ni_hwaddr_t		hwaddr;
 	ni_sockaddr_t		fromip;
 
+	struct arp_target *	targets;
+	unsigned int		ntargets;
+
 	ni_arp_socket_t *	sock;
 	struct {
 		const ni_timer_t *interval;
@@ -265,6 +279,61 @@ do_arp_arm_interval_timer(struct arp_handle *handle)
 }
 
 
+/*
+ * target address batch
+ */
+static ni_bool_t
+do_arp_target_add(struct arp_handle *handle, const char *name)
+{
+	struct arp_target *target;
+	ni_sockaddr_t ipaddr;
+
+	if (ni_sockaddr_parse(&ipaddr, name, AF_INET) != 0)
+		return FALSE;
+
+	handle->targets = xrealloc(handle->targets,
+			(handle->ntargets + 1) * sizeof(*handle->targets));
+	target = &handle->targets[handle->ntargets++];
+	memset(target, 0, sizeof(*target));
+	target->ipaddr = ipaddr;
+	return TRUE;
+}
+
+static ni_bool_t
+do_arp_targets_parse(struct arp_handle *handle, const char *command,
+			char **argv, int argc)
+{
+	int i;
+
+	if (argc == 1 && ni_string_eq(argv[0], "-")) {
+		char name[64];
+
+		/* one address per line/word read from stdin */
+		while (fscanf(stdin, "%63s", name) == 1) {
+			if (!do_arp_target_add(handle, name)) {
+				ni_error("%s: cannot parse '%s' as IPv4 address",
+						command, name);
+				return FALSE;
+			}
+		}
+	} else {
+		for (i = 0; i < argc; ++i) {
+			if (!do_arp_target_add(handle, argv[i])) {
+				ni_error("%s: cannot parse '%s' as IPv4 address",
+						command, argv[i]);
+				return FALSE;
+			}
+		}
+	}
+
+	if (!handle->ntargets) {
+		ni_error("%s: no IP address to process", command);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
 /*
  * verify
  */
@@ -307,7 +376,7 @@ do_arp_verify_run(struct arp_handle *handle, const char *caller, int argc, char
 		usage:
 			fprintf(stderr,
 				"Usage\n"
-				"  %s [options ...] <ifname> <IP address>\n"
+				"  %s [options ...] <ifname> <IP address> [<IP address> ...|-]\n"
 				"\n"
 				"Supported options:\n"
 				"  --help\n"
@@ -323,6 +392,10 @@ do_arp_verify_run(struct arp_handle *handle, const char *caller, int argc, char
 				"  --interval <msec>\n"
 				"      DAD probing packet sending interval in msec\n"
 				"      (default: 1000..2000).\n"
+				"\n"
+				"  Multiple IP addresses are probed in one batch using\n"
+				"  a shared probing schedule; a single \"-\" reads the\n"
+				"  address list from stdin.\n"
 				, argv[0]
 			);
 			goto cleanup;
@@ -355,18 +428,15 @@ do_arp_verify_run(struct arp_handle *handle, const char *caller, int argc, char
 		}
 	}
 
-	if (optind + 2 != argc)
+	if (optind + 2 > argc)
 		goto usage;
 
 	handle->ifname = argv[optind++];
 	if (ni_string_empty(handle->ifname))
 		goto usage;
 
-	if (ni_sockaddr_parse(&handle->ipaddr, argv[optind], AF_INET) != 0) {
-		ni_error("%s: cannot parse '%s' as IPv4 address",
-				argv[0], argv[optind]);
+	if (!do_arp_targets_parse(handle, argv[0], argv + optind, argc - optind))
 		goto cleanup;
-	}
 
 	status = do_arp_run(handle);
 
@@ -401,26 +471,36 @@ static ni_bool_t
 do_arp_verify_send(struct arp_handle *handle)
 {
 	static const struct in_addr null = { 0 };
-	ni_bool_t ret = FALSE;
+	struct arp_target *target;
+	unsigned int i, sent = 0;
+
+	for (i = 0; i < handle->ntargets; ++i) {
+		target = &handle->targets[i];
+
+		if (target->hwaddr.len || target->sent_cnt >= handle->count)
+			continue;
 
-	if (!handle->hwaddr.len && handle->sent_cnt < handle->count) {
 		ni_debug_application("%s: arp verify: %s",
 				handle->ifname,
-				ni_sockaddr_print(&handle->ipaddr));
+				ni_sockaddr_print(&target->ipaddr));
 
-		if ((ret = ni_arp_send_request(handle->sock, null,
-				handle->ipaddr.sin.sin_addr) > 0)) {
+		if (ni_arp_send_request(handle->sock, null,
+				target->ipaddr.sin.sin_addr) > 0) {
 
 			do {
-				handle->sent_cnt++;
-			} while (!handle->sent_cnt);
-			ni_timer_get_time(&handle->sent_time);
-
-			do_arp_arm_interval_timer(handle);
+				target->sent_cnt++;
+			} while (!target->sent_cnt);
+			sent++;
 		}
 	}
 
-	return ret;
+	if (sent) {
+		ni_timer_get_time(&handle->sent_time);
+
+		do_arp_arm_interval_timer(handle);
+	}
+
+	return sent != 0;
 }
 
 static void
@@ -428,14 +508,22 @@ do_arp_verify_recv(struct arp_handle *handle, const ni_arp_packet_t *pkt)
 {
 	ni_netconfig_t *nc = ni_global_state_handle(0);
 	ni_arp_socket_t *sock = handle->sock;
+	struct arp_target *target = NULL;
 	const ni_netdev_t *ifp;
 	ni_bool_t false_alarm = FALSE;
 	ni_bool_t found_addr = FALSE;
 	const ni_address_t *ap;
 	ni_sockaddr_t addr;
+	unsigned int i;
 
-	/* Is it about the address we're validating at all? */
-	if (pkt->sip.s_addr != handle->ipaddr.sin.sin_addr.s_addr) {
+	/* Is it about one of the addresses we're validating at all? */
+	for (i = 0; i < handle->ntargets; ++i) {
+		if (pkt->sip.s_addr == handle->targets[i].ipaddr.sin.sin_addr.s_addr) {
+			target = &handle->targets[i];
+			break;
+		}
+	}
+	if (!target) {
 		ni_debug_application("%s: report about different address",
 				handle->ifname);
 		return;
@@ -488,25 +576,45 @@ do_arp_verify_recv(struct arp_handle *handle, const ni_arp_packet_t *pkt)
 			handle->ifname, inet_ntoa(pkt->sip),
 			ni_link_address_print(&pkt->sha));
 
-	handle->hwaddr = pkt->sha;
+	target->hwaddr = pkt->sha;
+
+	/* keep probing the remaining addresses and stop early
+	 * only when every address has a conflict reported */
+	for (i = 0; i < handle->ntargets; ++i) {
+		if (!handle->targets[i].hwaddr.len)
+			return;
+	}
 	do_arp_handle_close(handle);
 }
 
 static int
 do_arp_verify_status(struct arp_handle *handle, int status)
 {
-	if (handle->verbose) {
-		if (handle->hwaddr.len) {
+	const struct arp_target *target;
+	unsigned int i, dups = 0;
+
+	for (i = 0; i < handle->ntargets; ++i) {
+		target = &handle->targets[i];
+
+		if (target->hwaddr.len)
+			dups++;
+
+		if (!handle->verbose)
+			continue;
+
+		if (target->hwaddr.len) {
 			fprintf(stdout, "%s: IP address %s is in use by %s\n",
-				handle->ifname, ni_sockaddr_print(&handle->ipaddr),
-				ni_link_address_print(&handle->hwaddr));
+				handle->ifname, ni_sockaddr_print(&target->ipaddr),
+				ni_link_address_print(&target->hwaddr));
 		} else {
 			fprintf(stdout, "%s: No duplicates for IP address %s detected\n",
-				handle->ifname, ni_sockaddr_print(&handle->ipaddr));
+				handle->ifname, ni_sockaddr_print(&target->ipaddr));
 		}
-		fflush(stdout);
 	}
-	if (handle->hwaddr.len)
+	if (handle->verbose)
+		fflush(stdout);
+
+	if (dups)
 		status = NI_WICKED_RC_NOT_ALLOWED;
 	else
 		status = NI_WICKED_RC_SUCCESS;
@@ -556,7 +664,7 @@ do_arp_notify_run(struct arp_handle *handle, const char *caller, int argc, char
 		usage:
 			fprintf(stderr,
 				"Usage:\n"
-				"  %s [options ...] <ifname> <IP address>\n"
+				"  %s [options ...] <ifname> <IP address> [<IP address> ...|-]\n"
 				"\n"
 				"Supported options:\n"
 				"  --help\n"
@@ -572,6 +680,10 @@ do_arp_notify_run(struct arp_handle *handle, const char *caller, int argc, char
 				"  --interval <msec>\n"
 				"      Announcement packet sending interval in msec\n"
 				"      (default: 2000).\n"
+				"\n"
+				"  Multiple IP addresses are announced in one batch using\n"
+				"  a shared announcement schedule; a single \"-\" reads the\n"
+				"  address list from stdin.\n"
 				, argv[0]
 			);
 			goto cleanup;
@@ -604,18 +716,15 @@ do_arp_notify_run(struct arp_handle *handle, const char *caller, int argc, char
 		}
 	}
 
-	if (optind + 2 != argc)
+	if (optind + 2 > argc)
 		goto usage;
 
 	handle->ifname = argv[optind++];
 	if (ni_string_empty(handle->ifname))
 		goto usage;
 
-	if (ni_sockaddr_parse(&handle->ipaddr, argv[optind], AF_INET) != 0) {
-		ni_error("%s: cannot parse '%s' as IPv4 address",
-				argv[0], argv[optind]);
+	if (!do_arp_targets_parse(handle, argv[0], argv + optind, argc - optind))
 		goto cleanup;
-	}
 
 	status = do_arp_run(handle);
 
@@ -646,42 +755,66 @@ do_arp_notify_init(struct arp_handle *handle, ni_netdev_t *dev, ni_netconfig_t *
 static ni_bool_t
 do_arp_notify_send(struct arp_handle *handle)
 {
-	ni_bool_t ret = FALSE;
+	struct arp_target *target;
+	unsigned int i, sent = 0, pending = 0;
+
+	for (i = 0; i < handle->ntargets; ++i) {
+		target = &handle->targets[i];
+
+		if (target->sent_cnt >= handle->count)
+			continue;
 
-	if (handle->sent_cnt < handle->count) {
 		ni_debug_application("%s: arp notify: %s",
 				handle->ifname,
-				ni_sockaddr_print(&handle->ipaddr));
+				ni_sockaddr_print(&target->ipaddr));
 
-		if ((ret = ni_arp_send_grat_request(handle->sock,
-				handle->ipaddr.sin.sin_addr) > 0)) {
+		if (ni_arp_send_grat_request(handle->sock,
+				target->ipaddr.sin.sin_addr) > 0) {
 
 			do {
-				handle->sent_cnt++;
-			} while (!handle->sent_cnt);
-			ni_timer_get_time(&handle->sent_time);
+				target->sent_cnt++;
+			} while (!target->sent_cnt);
+			sent++;
+		}
+		if (target->sent_cnt < handle->count)
+			pending++;
+	}
 
-			if (handle->sent_cnt < handle->count) {
-				do_arp_arm_interval_timer(handle);
-			} else if (handle->sock) {
-				do_arp_handle_close(handle);
-			}
+	if (sent) {
+		ni_timer_get_time(&handle->sent_time);
+
+		if (pending) {
+			do_arp_arm_interval_timer(handle);
+		} else if (handle->sock) {
+			do_arp_handle_close(handle);
 		}
 	}
 
-	return ret;
+	return sent != 0;
 }
 
 static int
 do_arp_notify_status(struct arp_handle *handle, int status)
 {
-	if (handle->verbose && handle->sent_cnt /* >= handle->count */) {
-		fprintf(stdout, "%s: Notified neighbours about IP address %s\n",
-			handle->ifname, ni_sockaddr_print(&handle->ipaddr));
-		fflush(stdout);
+	const struct arp_target *target;
+	unsigned int i, notified = 0;
+
+	for (i = 0; i < handle->ntargets; ++i) {
+		target = &handle->targets[i];
+
+		if (!target->sent_cnt /* >= handle->count */)
+			continue;
+		notified++;
+
+		if (handle->verbose) {
+			fprintf(stdout, "%s: Notified neighbours about IP address %s\n",
+				handle->ifname, ni_sockaddr_print(&target->ipaddr));
+		}
 	}
+	if (handle->verbose && notified)
+		fflush(stdout);
 
-	if (handle->sent_cnt /* >= handle->count */)
+	if (notified == handle->ntargets)
 		status = NI_WICKED_RC_SUCCESS;
 	else
 		status = NI_WICKED_RC_NOT_RUNNING;
@@ -1108,10 +1241,10 @@ ni_do_arp(const char *caller, int argc, char **argv)
 				"      Packet sending interval in msec\n"
 				"\n"
 				"Actions:\n"
-				"  verify [options] <ifname> <IP address>\n"
+				"  verify [options] <ifname> <IP address> [<IP address> ...|-]\n"
 				"        Verify/Probe an IP address for duplicates\n"
 				"\n"
-				"  notify [options] <ifname> <IP address>\n"
+				"  notify [options] <ifname> <IP address> [<IP address> ...|-]\n"
 				"        Notify/Announce IP address use to neighbours\n"
 				"\n"
 				"  ping   [options] <ifname> <IP address>\n"
@@ -1163,7 +1296,7 @@ ni_do_arp(const char *caller, int argc, char **argv)
 		if (ni_string_empty(handle.ifname))
 			goto usage;
 
-		if (ni_sockaddr_parse(&handle.ipaddr, argv[optind], AF_INET) != 0) {
+		if (!do_arp_target_add(&handle, argv[optind])) {
 			ni_error("%s: cannot parse '%s' as IPv4 address", argv[0],
 					argv[optind]);
 			goto cleanup;
@@ -1218,9 +1351,9 @@ ni_do_arp(const char *caller, int argc, char **argv)
 		goto usage;
 
 cleanup:
+	free(handle.targets);
 	if (command != caller)
 		argv[0] = (char *)caller;
 	ni_string_free(&command);
 	return status;
 }
-
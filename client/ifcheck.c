@@ -37,10 +37,13 @@
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
+#include <wicked/dbus.h>
+#include <wicked/client.h>
 #include <wicked/fsm.h>
 
 #include "wicked-client.h"
 #include "appconfig.h"
+#include "util_priv.h"
 #include "ifcheck.h"
 
 static ni_bool_t opt_quiet;
@@ -169,6 +172,103 @@ ni_ifcheck_worker_not_in_state(ni_ifworker_t *w, ni_fsm_state_t state_val)
 	return FALSE;
 }
 
+/*
+ * Per-interface state retrieved in bulk with one getClientInfo call
+ */
+typedef struct ni_ifcheck_info {
+	char *		name;
+	unsigned int	ifindex;
+	ni_bool_t	persistent;
+	ni_bool_t	configured;
+	ni_uuid_t	config_uuid;
+} ni_ifcheck_info_t;
+
+typedef struct ni_ifcheck_info_array {
+	unsigned int		count;
+	ni_ifcheck_info_t *	data;
+} ni_ifcheck_info_array_t;
+
+static void
+ni_ifcheck_info_array_destroy(ni_ifcheck_info_array_t *infos)
+{
+	unsigned int i;
+
+	for (i = 0; i < infos->count; ++i)
+		ni_string_free(&infos->data[i].name);
+	free(infos->data);
+	infos->data = NULL;
+	infos->count = 0;
+}
+
+static const ni_ifcheck_info_t *
+ni_ifcheck_info_array_find(const ni_ifcheck_info_array_t *infos, const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < infos->count; ++i) {
+		if (ni_string_eq(infos->data[i].name, name))
+			return &infos->data[i];
+	}
+	return NULL;
+}
+
+/*
+ * Retrieve name, index and client state of all interfaces with a
+ * single InterfaceList.getClientInfo round trip. Returns FALSE, e.g.
+ * when the server does not implement the call yet, so the caller
+ * can fall back to a full state refresh.
+ */
+static ni_bool_t
+ni_ifcheck_info_array_fetch(ni_ifcheck_info_array_t *infos)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *list_object;
+	const ni_dbus_variant_t *entry;
+	const char *name;
+	unsigned int index;
+
+	if (!ni_call_create_client())
+		return FALSE;
+	if (!(list_object = ni_call_get_netif_list_object()))
+		return FALSE;
+
+	if (!ni_dbus_object_call_variant(list_object, NULL, "getClientInfo",
+				0, NULL, 1, &result, &error)) {
+		ni_debug_application("%s.getClientInfo failed: %s",
+				list_object->path,
+				error.message ? error.message : "unknown error");
+		dbus_error_free(&error);
+		ni_dbus_variant_destroy(&result);
+		return FALSE;
+	}
+
+	for (index = 0; (entry = ni_dbus_dict_get_entry(&result, index, &name)); ++index) {
+		ni_ifcheck_info_t *info;
+		const char *string;
+		dbus_bool_t flag;
+		uint32_t u32;
+
+		infos->data = xrealloc(infos->data,
+				(infos->count + 1) * sizeof(*infos->data));
+		info = &infos->data[infos->count++];
+		memset(info, 0, sizeof(*info));
+
+		ni_string_dup(&info->name, name);
+		if (ni_dbus_dict_get_uint32(entry, "index", &u32))
+			info->ifindex = u32;
+		if (ni_dbus_dict_get_bool(entry, "persistent", &flag))
+			info->persistent = !!flag;
+		if (ni_dbus_dict_get_string(entry, "config-origin", &string))
+			info->configured = !ni_string_empty(string);
+		if (ni_dbus_dict_get_string(entry, "config-uuid", &string))
+			ni_uuid_parse(&info->config_uuid, string);
+	}
+
+	ni_dbus_variant_destroy(&result);
+	return TRUE;
+}
+
 static void
 if_printf(const char *dev, const char *flag, const char *fmt, ...)
 {
@@ -197,13 +297,80 @@ set_status(int *status, unsigned int code)
 		*status = code;
 }
 
+enum { OPT_HELP, OPT_QUIET, OPT_IFCONFIG, OPT_MISSED, OPT_CHANGED, OPT_STATE, OPT_PERSISTENT };
+
+/*
+ * Evaluate the requested checks for one interface. The worker may be
+ * NULL for interfaces existing in the system without any config.
+ */
+static void
+ni_do_ifcheck_device(const char *name, const ni_uint_array_t *checks,
+		ni_ifworker_t *w, ni_bool_t exists, ni_bool_t configured,
+		ni_bool_t persistent, const ni_uuid_t *system_uuid,
+		const char *opt_state, unsigned int opt_state_val, int *status)
+{
+	unsigned int j;
+
+	for (j = 0; j < checks->count; j++) {
+		switch (checks->data[j]) {
+			ni_bool_t changed, not_in_state;
+
+			default:
+			case OPT_MISSED:
+				if_printf(name, "device exists", (exists ? "yes" : "no"));
+
+				if (!exists)
+					set_status(status, NI_WICKED_RC_NO_DEVICE);
+				break;
+
+			case OPT_CHANGED:
+				changed = FALSE;
+				if (configured ||
+				    (ni_ifcheck_worker_config_exists(w) && exists))
+					changed = !(ni_ifcheck_worker_config_exists(w) &&
+						system_uuid &&
+						ni_uuid_equal(system_uuid, &w->config.meta.uuid));
+
+				if_printf(name, "configuration changed",
+						(changed ? "yes" : "no"));
+				if (changed) {
+					ni_debug_wicked("%s: config file uuid is %s", name,
+						w ? ni_uuid_print(&w->config.meta.uuid) : "NOT SET");
+					ni_debug_wicked("%s: system dev. uuid is %s", name,
+						system_uuid ? ni_uuid_print(system_uuid) : "NOT SET");
+					set_status(status, NI_WICKED_ST_CHANGED_CONFIG);
+				}
+				break;
+
+			case OPT_STATE:
+				if (w) {
+					not_in_state = ni_ifcheck_worker_not_in_state(w, opt_state_val);
+				} else {
+					/* same mapping as in ni_ifcheck_worker_not_in_state */
+					not_in_state = NI_FSM_STATE_NONE < opt_state_val;
+				}
+
+				if_printf(name, "queried state", "%s (%s)",
+					(not_in_state ? "no" : "yes"), opt_state);
+				if (not_in_state)
+					set_status(status, NI_WICKED_ST_NOT_IN_STATE);
+				break;
+
+			case OPT_PERSISTENT:
+				if_printf(name, "persistent", (persistent ? "yes" : "no"));
+				if (persistent)
+					set_status(status, NI_WICKED_ST_PERSISTENT_ON);
+				break;
+		}
+	}
+}
+
 /*
  * ifcheck action
  */
 int
 ni_do_ifcheck(int argc, char **argv)
 {
-	enum { OPT_HELP, OPT_QUIET, OPT_IFCONFIG, OPT_MISSED, OPT_CHANGED, OPT_STATE, OPT_PERSISTENT };
 	static struct option ifcheck_options[] = {
 		{ "help",	no_argument, NULL,		OPT_HELP },
 		{ "quiet",	no_argument, NULL,		OPT_QUIET },
@@ -218,11 +385,13 @@ ni_do_ifcheck(int argc, char **argv)
 	ni_string_array_t opt_ifconfig = NI_STRING_ARRAY_INIT;
 	ni_string_array_t ifnames = NI_STRING_ARRAY_INIT;
 	ni_uint_array_t checks = NI_UINT_ARRAY_INIT;
+	ni_ifcheck_info_array_t infos = { 0, NULL };
 	ni_stringbuf_t sb = NI_STRINGBUF_INIT_DYNAMIC;
 	const char *opt_state = NULL;
 	ni_bool_t multiple = FALSE;
+	ni_bool_t bulk = FALSE;
 	ni_fsm_t *fsm;
-	unsigned int i, opt_state_val;
+	unsigned int i, opt_state_val = NI_FSM_STATE_NONE;
 	int c, status = NI_WICKED_RC_USAGE;
 
 	fsm = ni_fsm_new();
@@ -323,16 +492,23 @@ ni_do_ifcheck(int argc, char **argv)
 		goto cleanup;
 	}
 
-	if (!ni_fsm_create_client(fsm)) {
-		/* Severe error we always explicitly return */
-		status = NI_WICKED_RC_ERROR;
-		goto cleanup;
-	}
+	/* Try to retrieve the client state of all interfaces with one
+	 * bulk call and evaluate locally; fall back to a full state
+	 * refresh when the server does not support it. */
+	bulk = ni_ifcheck_info_array_fetch(&infos);
 
-	if (!ni_fsm_refresh_state(fsm)) {
-		/* Severe error we always explicitly return */
-		status = NI_WICKED_RC_ERROR;
-		goto cleanup;
+	if (!bulk) {
+		if (!ni_fsm_create_client(fsm)) {
+			/* Severe error we always explicitly return */
+			status = NI_WICKED_RC_ERROR;
+			goto cleanup;
+		}
+
+		if (!ni_fsm_refresh_state(fsm)) {
+			/* Severe error we always explicitly return */
+			status = NI_WICKED_RC_ERROR;
+			goto cleanup;
+		}
 	}
 
 	status = NI_WICKED_ST_OK;
@@ -345,7 +521,9 @@ ni_do_ifcheck(int argc, char **argv)
 		const char *ifname = argv[optind++];
 
 		ifmatch.name = ifname;
-		if (ni_fsm_get_matching_workers(fsm, &ifmatch, &marked) == 0) {
+		if (ni_fsm_get_matching_workers(fsm, &ifmatch, &marked) == 0 &&
+		    (!bulk || (!ni_string_eq(ifname, "all") &&
+			       !ni_ifcheck_info_array_find(&infos, ifname)))) {
 			if_printf(ifname, "device exists", "no");
 			set_status(&status, NI_WICKED_RC_NO_DEVICE);
 			continue;
@@ -357,70 +535,62 @@ ni_do_ifcheck(int argc, char **argv)
 			ni_ifworker_t *w = marked.data[i];
 			ni_netdev_t *dev = w->device;
 			ni_client_state_t *cs = dev ? dev->client_state : NULL;
-			unsigned int j;
+			const ni_ifcheck_info_t *info;
 
 			if (ni_string_array_index(&ifnames, w->name) != -1)
 				continue;
 			multiple = ifnames.count ? TRUE : multiple;
 			ni_string_array_append(&ifnames, w->name);
 
-			for (j = 0; j < checks.count; j++) {
-				switch (checks.data[j]) {
-					ni_bool_t changed, not_in_state, persistent;
-
-					default:
-					case OPT_MISSED:
-						if_printf(w->name, "device exists", (dev ? "yes" : "no"));
-
-						if (!dev)
-							set_status(&status, NI_WICKED_RC_NO_DEVICE);
-						break;
-
-					case OPT_CHANGED:
-						changed = FALSE;
-						if (ni_ifcheck_device_configured(dev) ||
-						     (ni_ifcheck_worker_config_exists(w) &&
-						      ni_ifcheck_worker_device_exists(w)))
-							changed = !ni_ifcheck_worker_config_matches(w);
-
-						if_printf(w->name, "configuration changed",
-								(changed ? "yes" : "no"));
-						if (changed) {
-							ni_debug_wicked("%s: config file uuid is %s", w->name,
-								ni_uuid_print(&w->config.meta.uuid));
-							ni_debug_wicked("%s: system dev. uuid is %s", w->name,
-								cs ? ni_uuid_print(&cs->config.uuid) : "NOT SET");
-							set_status(&status, NI_WICKED_ST_CHANGED_CONFIG);
-						}
-						break;
-
-					case OPT_STATE:
-						not_in_state = ni_ifcheck_worker_not_in_state(w, opt_state_val);
-
-						if_printf(w->name, "queried state", "%s (%s)",
-							(not_in_state ? "no" : "yes"), opt_state);
-						if (not_in_state)
-							set_status(&status, NI_WICKED_ST_NOT_IN_STATE);
-						break;
-
-					case OPT_PERSISTENT:
-						persistent = ni_ifcheck_device_is_persistent(dev);
-
-						if_printf(w->name, "persistent", (persistent ? "yes" : "no"));
-						if (persistent)
-							set_status(&status, NI_WICKED_ST_PERSISTENT_ON);
-						break;
-				}
+			if (bulk) {
+				info = ni_ifcheck_info_array_find(&infos, w->name);
+				ni_do_ifcheck_device(w->name, &checks, w,
+						info != NULL,
+						info && info->configured,
+						info && info->persistent,
+						info ? &info->config_uuid : NULL,
+						opt_state, opt_state_val, &status);
+			} else {
+				ni_do_ifcheck_device(w->name, &checks, w,
+						dev != NULL,
+						ni_ifcheck_device_configured(dev),
+						ni_ifcheck_device_is_persistent(dev),
+						cs ? &cs->config.uuid : NULL,
+						opt_state, opt_state_val, &status);
 			}
 			if (opt_quiet && status)
 				goto cleanup;
 		}
+
+		if (bulk) {
+			/* interfaces existing in the system without any
+			 * matching config worker */
+			for (i = 0; i < infos.count; ++i) {
+				const ni_ifcheck_info_t *info = &infos.data[i];
+
+				if (!ni_string_eq(ifname, "all") &&
+				    !ni_string_eq(ifname, info->name))
+					continue;
+				if (ni_string_array_index(&ifnames, info->name) != -1)
+					continue;
+				multiple = ifnames.count ? TRUE : multiple;
+				ni_string_array_append(&ifnames, info->name);
+
+				ni_do_ifcheck_device(info->name, &checks, NULL,
+						TRUE, info->configured,
+						info->persistent, &info->config_uuid,
+						opt_state, opt_state_val, &status);
+				if (opt_quiet && status)
+					goto cleanup;
+			}
+		}
 	}
 
 cleanup:
 	ni_string_array_destroy(&opt_ifconfig);
 	ni_string_array_destroy(&ifnames);
 	ni_uint_array_destroy(&checks);
+	ni_ifcheck_info_array_destroy(&infos);
 	return status;
 }
 
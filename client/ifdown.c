@@ -79,6 +79,7 @@ ni_ifdown_fire_nanny(ni_ifworker_array_t *array)
 		ni_ifworker_t *w = array->data[i];
 
 		policy_name = ni_ifpolicy_name_from_ifname(w->name);
+		ni_fsm_trace_record(w->name, "nanny-del-policy", "%s", policy_name);
 		if (!ni_ifdown_stop_policy(policy_name)) {
 			/* We ignore errors for now */;
 		}
@@ -95,6 +96,7 @@ ni_ifdown_fire_nanny(ni_ifworker_array_t *array)
 			continue;
 		}
 
+		ni_fsm_trace_record(w->name, "nanny-disable", NULL);
 		if (!ni_ifdown_stop_device(w->name)) {
 			/* We ignore errors for now */;
 		}
@@ -38,6 +38,7 @@
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <wicked/fsm.h>
+#include <wicked/xml.h>
 
 #include "wicked-client.h"
 #include "appconfig.h"
@@ -47,11 +48,79 @@
 #include "ifreload.h"
 #include "ifstatus.h"
 
+/*
+ * Decide how deep the down phase of a reload has to go for a device
+ * with changed config. When the previously applied config document has
+ * been recorded in the client state, diff it against the new one: when
+ * all changes are confined to the addrconf sections (the ipv4/ipv6
+ * nodes with their addresses, routes, dhcp and updater settings), the
+ * up run reapplies them by dropping and re-requesting the leases, so
+ * the down phase only needs to revert to link-up and the carrier stays
+ * up. Any change outside these sections -- and any device without a
+ * recorded config document -- takes the full way down as before.
+ */
+static ni_bool_t
+ni_ifreload_addrconf_section(const xml_node_t *node)
+{
+	return node && node->name &&
+		(ni_string_startswith(node->name, "ipv4") ||
+		 ni_string_startswith(node->name, "ipv6"));
+}
+
+static ni_fsm_state_t
+ni_ifreload_device_down_state(ni_ifworker_t *w)
+{
+	const xml_node_array_t *groups[3];
+	xml_diff_t diff = XML_DIFF_INIT;
+	const xml_node_t *old_conf = NULL;
+	ni_fsm_state_t state = NI_FSM_STATE_LINK_UP;
+	unsigned int g, i;
+
+	if (w->device && w->device->client_state)
+		old_conf = w->device->client_state->config.node;
+
+	if (!old_conf || xml_node_is_empty(w->config.node))
+		return NI_FSM_STATE_DEVICE_READY;
+
+	if (xml_node_diff(old_conf, w->config.node, &diff)) {
+		groups[0] = &diff.added;
+		groups[1] = &diff.removed;
+		groups[2] = &diff.modified;
+
+		for (g = 0; g < 3 && state == NI_FSM_STATE_LINK_UP; ++g) {
+			const xml_node_array_t *nodes = groups[g];
+
+			for (i = 0; i < nodes->count; ++i) {
+				const xml_node_t *section = nodes->data[i];
+
+				/* find the section directly below the config root */
+				while (section->parent &&
+				       section->parent != old_conf &&
+				       section->parent != w->config.node)
+					section = section->parent;
+
+				if (!section->parent ||
+				    !ni_ifreload_addrconf_section(section)) {
+					state = NI_FSM_STATE_DEVICE_READY;
+					break;
+				}
+			}
+		}
+	}
+	xml_diff_destroy(&diff);
+
+	if (state == NI_FSM_STATE_LINK_UP) {
+		ni_info("%s: only addrconf configuration changed, "
+			"reloading without a carrier drop", w->name);
+	}
+	return state;
+}
+
 static int
 ni_do_ifreload_direct(int argc, char **argv)
 {
 	enum  { OPT_HELP, OPT_IFCONFIG, OPT_PERSISTENT, OPT_TRANSIENT,
-		OPT_TIMEOUT,
+		OPT_TIMEOUT, OPT_TRACE,
 #ifdef NI_TEST_HACKS
 		OPT_IGNORE_PRIO, OPT_IGNORE_STARTMODE,
 #endif
@@ -61,6 +130,7 @@ ni_do_ifreload_direct(int argc, char **argv)
 		{ "help",		no_argument,		NULL,	OPT_HELP },
 		{ "ifconfig",		required_argument,	NULL,	OPT_IFCONFIG },
 		{ "timeout",		required_argument,	NULL,	OPT_TIMEOUT },
+		{ "trace",		no_argument,		NULL,	OPT_TRACE },
 		{ "transient",		no_argument,		NULL,	OPT_TRANSIENT },
 #ifdef NI_TEST_HACKS
 		{ "ignore-prio",	no_argument,		NULL, 	OPT_IGNORE_PRIO },
@@ -134,6 +204,10 @@ ni_do_ifreload_direct(int argc, char **argv)
 			}
 			break;
 
+		case OPT_TRACE:
+			ni_fsm_trace_enable();
+			break;
+
 		default:
 		case OPT_HELP:
 usage:
@@ -148,6 +222,8 @@ usage:
 				"      Read interface configuration(s) from file\n"
 				"  --timeout <sec>\n"
 				"      Timeout after <sec> seconds\n"
+				"  --trace\n"
+				"      Print a timestamped per-stage trace of the reload\n"
 #ifdef NI_TEST_HACKS
 				"  --ignore-prio\n"
 				"      Ignore checking the config origin priorities\n"
@@ -303,7 +379,7 @@ usage:
 				w->target_range.max = NI_FSM_STATE_DEVICE_DOWN;
 				break;
 			default:
-				w->target_range.max = NI_FSM_STATE_DEVICE_READY;
+				w->target_range.max = ni_ifreload_device_down_state(w);
 				break;
 			}
 			nmarked++;
@@ -377,6 +453,7 @@ usage:
 	}
 
 cleanup:
+	ni_fsm_print_trace();
 	ni_string_array_destroy(&ifnames);
 	ni_string_array_destroy(&opt_ifconfig);
 	ni_ifworker_array_destroy(&down_marked);
@@ -388,7 +465,7 @@ static int
 ni_do_ifreload_nanny(int argc, char **argv)
 {
 	enum  { OPT_HELP, OPT_IFCONFIG, OPT_PERSISTENT, OPT_TRANSIENT,
-		OPT_TIMEOUT,
+		OPT_TIMEOUT, OPT_TRACE,
 #ifdef NI_TEST_HACKS
 		OPT_IGNORE_PRIO, OPT_IGNORE_STARTMODE,
 #endif
@@ -398,6 +475,7 @@ ni_do_ifreload_nanny(int argc, char **argv)
 		{ "help",		no_argument,		NULL,	OPT_HELP },
 		{ "ifconfig",		required_argument,	NULL,	OPT_IFCONFIG },
 		{ "timeout",		required_argument,	NULL,	OPT_TIMEOUT },
+		{ "trace",		no_argument,		NULL,	OPT_TRACE },
 		{ "transient",		no_argument,		NULL,	OPT_TRANSIENT },
 #ifdef NI_TEST_HACKS
 		{ "ignore-prio",	no_argument,		NULL, 	OPT_IGNORE_PRIO },
@@ -468,6 +546,10 @@ ni_do_ifreload_nanny(int argc, char **argv)
 			}
 			break;
 
+		case OPT_TRACE:
+			ni_fsm_trace_enable();
+			break;
+
 		default:
 		case OPT_HELP:
 usage:
@@ -482,6 +564,8 @@ usage:
 				"      Read interface configuration(s) from file\n"
 				"  --timeout <sec>\n"
 				"      Timeout after <sec> seconds\n"
+				"  --trace\n"
+				"      Print a timestamped per-stage trace of the reload\n"
 #ifdef NI_TEST_HACKS
 				"  --ignore-prio\n"
 				"      Ignore checking the config origin priorities\n"
@@ -633,7 +717,7 @@ usage:
 				w->target_range.max = NI_FSM_STATE_DEVICE_DOWN;
 				break;
 			default:
-				w->target_range.max = NI_FSM_STATE_DEVICE_READY;
+				w->target_range.max = ni_ifreload_device_down_state(w);
 				break;
 			}
 			nmarked++;
@@ -712,6 +796,7 @@ usage:
 	}
 
 cleanup:
+	ni_fsm_print_trace();
 	ni_string_array_destroy(&ifnames);
 	ni_nanny_fsm_monitor_free(monitor);
 	ni_string_array_destroy(&opt_ifconfig);
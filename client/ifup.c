@@ -276,6 +276,7 @@ ni_ifup_hire_nanny(ni_ifworker_array_t *array, ni_bool_t set_persistent)
 		if (set_persistent)
 			ni_client_state_set_persistent(w->config.node);
 
+		ni_fsm_trace_record(w->name, "nanny-apply-policy", NULL);
 		if (!ni_ifup_start_policy(w))
 			rv = FALSE;
 		else {
@@ -703,6 +704,7 @@ ni_do_ifup_direct(int argc, char **argv)
 {
 	enum  { OPT_HELP, OPT_IFCONFIG, OPT_CONTROL_MODE, OPT_STAGE, OPT_TIMEOUT,
 		OPT_SKIP_ACTIVE, OPT_SKIP_ORIGIN, OPT_PERSISTENT, OPT_TRANSIENT,
+		OPT_TIMING,
 #ifdef NI_TEST_HACKS
 		OPT_IGNORE_PRIO, OPT_IGNORE_STARTMODE,
 #endif
@@ -717,6 +719,7 @@ ni_do_ifup_direct(int argc, char **argv)
 		{ "skip-origin",required_argument, NULL,	OPT_SKIP_ORIGIN },
 		{ "timeout",	required_argument, NULL,	OPT_TIMEOUT },
 		{ "transient", 	no_argument,		NULL,	OPT_TRANSIENT },
+		{ "timing",	no_argument,		NULL,	OPT_TIMING },
 #ifdef NI_TEST_HACKS
 		{ "ignore-prio",no_argument, NULL,	OPT_IGNORE_PRIO },
 		{ "ignore-startmode",no_argument, NULL,	OPT_IGNORE_STARTMODE },
@@ -732,6 +735,7 @@ ni_do_ifup_direct(int argc, char **argv)
 	ni_string_array_t ifnames = NI_STRING_ARRAY_INIT;
 	ni_bool_t check_prio = TRUE;
 	ni_bool_t opt_transient = FALSE;
+	ni_bool_t opt_timing = FALSE;
 	unsigned int nmarked;
 	ni_fsm_t *fsm;
 	int c, status = NI_WICKED_RC_USAGE;
@@ -822,6 +826,10 @@ ni_do_ifup_direct(int argc, char **argv)
 			opt_transient = TRUE;
 			break;
 
+		case OPT_TIMING:
+			opt_timing = TRUE;
+			break;
+
 		default:
 		case OPT_HELP:
 usage:
@@ -846,6 +854,8 @@ usage:
 				"      touching interfaces that have been set up via firmware (like iBFT) previously\n"
 				"  --timeout <sec>\n"
 				"      Timeout after <sec> seconds\n"
+				"  --timing\n"
+				"      Print per-transition timings after the interfaces are up\n"
 #ifdef NI_TEST_HACKS
 				"  --ignore-prio\n"
 				"      Ignore checking the config origin priorities\n"
@@ -956,6 +966,9 @@ usage:
 
 		ni_fsm_wait_tentative_addrs(fsm);
 
+		if (opt_timing)
+			ni_fsm_print_timings(fsm, &ifmarked);
+
 		status = ni_ifstatus_display_result(fsm, &ifnames, &ifmarked,
 			opt_transient);
 
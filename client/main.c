@@ -32,6 +32,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -98,6 +99,7 @@ unsigned int ni_wait_for_interfaces;
 
 static int		do_show_xml(int, char **);
 static int		do_show_config(int, char **, const char *);
+static int		do_stats(int, char **);
 extern int		do_nanny(int, char **);
 extern int		do_lease(int, char **);
 extern int		do_check(int, char **);
@@ -123,13 +125,25 @@ show_exec_info(int argc, char **argv)
 
 int
 main(int argc, char **argv)
+{
+	int status;
+
+	mtrace();
+
+	/* opt-in session mode: run the command via a warm daemonlet */
+	if ((status = ni_client_session_dispatch(argc, argv)) >= 0)
+		return status;
+
+	return ni_client_command_main(argc, argv);
+}
+
+int
+ni_client_command_main(int argc, char **argv)
 {
 	int c, status = NI_WICKED_RC_USAGE;
 	const char *program;
 	const char *cmd;
 
-	mtrace();
-
 	ni_log_init();
 	program = ni_basename(argv[0]);
 
@@ -171,6 +185,7 @@ main(int argc, char **argv)
 				"  show        [options] <ifname ...>|all\n"
 				"  show-xml    [options]\n"
 				"  show-config [options]\n"
+				"  stats       [options]\n"
 				"  convert     [options]\n"
 				"  getnames    [options]\n"
 				"  xpath       [options] expr ...\n"
@@ -262,7 +277,8 @@ main(int argc, char **argv)
 		ni_log_destination(program, "syslog:user:perror");
 	}
 
-	if (ni_init("client") < 0) {
+	/* session workers inherit an initialized library from the daemonlet */
+	if (!ni_client_session_worker() && ni_init("client") < 0) {
 		status = NI_WICKED_RC_ERROR;
 		goto done;
 	}
@@ -298,6 +314,9 @@ main(int argc, char **argv)
 	if (!strcmp(cmd, "show-config")) {
 		status = do_show_config(argc - optind, argv + optind, NULL);
 	} else
+	if (!strcmp(cmd, "stats")) {
+		status = do_stats(argc - optind, argv + optind);
+	} else
 	if (!strcmp(cmd, "nanny")) {
 		status = do_nanny(argc - optind, argv + optind);
 	} else
@@ -596,6 +615,7 @@ do_show_xml(int argc, char **argv)
 	enum {
 		OPT_HELP,
 		OPT_RAW,
+		OPT_STREAM,
 #ifdef MODEM
 		OPT_MODEMS,
 #endif
@@ -603,6 +623,7 @@ do_show_xml(int argc, char **argv)
 	static struct option local_options[] = {
 		{ "help", no_argument, NULL, OPT_HELP },
 		{ "raw", no_argument, NULL, OPT_RAW },
+		{ "stream", no_argument, NULL, OPT_STREAM },
 #ifdef MODEM
 		{ "modem", no_argument, NULL, OPT_MODEMS },
 #endif
@@ -612,6 +633,7 @@ do_show_xml(int argc, char **argv)
 	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
 	DBusError error = DBUS_ERROR_INIT;
 	int opt_raw = FALSE;
+	int opt_stream = FALSE;
 #ifdef MODEM
 	int opt_modems = 0;
 #endif
@@ -625,6 +647,10 @@ do_show_xml(int argc, char **argv)
 			opt_raw = TRUE;
 			break;
 
+		case OPT_STREAM:
+			opt_stream = TRUE;
+			break;
+
 #ifdef MODEM
 		case OPT_MODEMS:
 			opt_modems = 1;
@@ -643,6 +669,9 @@ do_show_xml(int argc, char **argv)
 				"  --raw\n"
 				"      Show raw dbus reply in pseudo-xml, rather than using the schema.\n"
 				"      This option effectively disables the ifname filter. \n"
+				"  --stream\n"
+				"      Print each interface's subtree as soon as it is converted,\n"
+				"      bounding memory to one interface on large systems.\n"
 #ifdef MODEM
 				"  --modem\n"
 				"      List Modems\n"
@@ -652,7 +681,7 @@ do_show_xml(int argc, char **argv)
 		}
 	}
 
-	if (opt_raw && optind != argc)
+	if (opt_raw && (opt_stream || optind != argc))
 		goto usage;
 
 	/* warning: this is a shallow-copy from argv,
@@ -692,6 +721,35 @@ do_show_xml(int argc, char **argv)
 		};
 
 		__dump_fake_xml(&result, 0, dict_element_tags);
+	} else if (opt_stream) {
+		ni_xs_scope_t *schema = ni_objectmodel_init(NULL);
+		ni_dbus_dict_entry_t *entry;
+		unsigned int index;
+
+		if (!ni_dbus_variant_is_dict(&result)) {
+			ni_error("unable to represent properties as xml");
+			goto out;
+		}
+
+		/* Convert, print and release one object at a time: the xml
+		 * footprint stays bounded to a single interface, the reply
+		 * is released progressively, and consumers get the first
+		 * subtree without waiting for the whole document. */
+		for (entry = result.dict_array_value, index = 0; index < result.array.len; ++index, ++entry) {
+			xml_node_t *root = xml_node_new(NULL, NULL);
+
+			if (!__dump_object_xml(entry->key, &entry->datum, schema, root, &ifnames)) {
+				ni_error("unable to represent properties as xml");
+				xml_node_free(root);
+				goto out;
+			}
+			if (root->children) {
+				xml_node_print(root, NULL);
+				fflush(stdout);
+			}
+			xml_node_free(root);
+			ni_dbus_variant_destroy(&entry->datum);
+		}
 	} else {
 		ni_xs_scope_t *schema = ni_objectmodel_init(NULL);
 		xml_node_t *tree;
@@ -713,6 +771,130 @@ out:
 	return rv;
 }
 
+/*
+ * Fetch and print the daemon's runtime work counters and event loop
+ * latency accounting via InterfaceList.getRuntimeStats.
+ */
+int
+do_stats(int argc, char **argv)
+{
+	enum { OPT_HELP };
+	static struct option local_options[] = {
+		{ "help", no_argument, NULL, OPT_HELP },
+		{ NULL }
+	};
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *list_object, *object;
+	ni_dbus_variant_t *counters, *latency, *entry;
+	const char *name;
+	unsigned int index;
+	uint64_t value;
+	int c, rv = 1;
+
+	optind = 1;
+	while ((c = getopt_long(argc, argv, "", local_options, NULL)) != EOF) {
+		switch (c) {
+		default:
+		case OPT_HELP:
+			fprintf(stderr,
+				"wicked stats [options]\n"
+				"\n"
+				"Supported options:\n"
+				"  --help\n"
+				"      Show this help text.\n"
+				);
+			return 1;
+		}
+	}
+
+	if (!(object = ni_call_create_client()))
+		return 1;
+	if (!(list_object = ni_call_get_netif_list_object()))
+		goto out;
+
+	if (!ni_dbus_object_call_variant(list_object, NULL, "getRuntimeStats",
+				0, NULL, 1, &result, &error)) {
+		ni_dbus_print_error(&error, "%s.getRuntimeStats: failed", list_object->path);
+		dbus_error_free(&error);
+		goto out;
+	}
+
+	if ((counters = ni_dbus_dict_get(&result, "counters"))) {
+		printf("counters:\n");
+		for (index = 0; (entry = ni_dbus_dict_get_entry(counters, index, &name)); ++index) {
+			if (ni_dbus_variant_get_uint64(entry, &value))
+				printf("  %-24s %"PRIu64"\n", name, value);
+		}
+	}
+
+	if ((latency = ni_dbus_dict_get(&result, "latency"))) {
+		printf("event latency:\n");
+		for (index = 0; (entry = ni_dbus_dict_get_entry(latency, index, &name)); ++index) {
+			uint64_t count = 0, total = 0, max = 0;
+
+			ni_dbus_dict_get_uint64(entry, "count", &count);
+			ni_dbus_dict_get_uint64(entry, "total-usec", &total);
+			ni_dbus_dict_get_uint64(entry, "max-usec", &max);
+			printf("  %-24s count %-10"PRIu64" avg %-8"PRIu64" max %"PRIu64" usec\n",
+					name, count, count ? total / count : 0, max);
+		}
+	}
+	if ((latency = ni_dbus_dict_get(&result, "phases"))) {
+		printf("ifup phases:\n");
+		for (index = 0; (entry = ni_dbus_dict_get_entry(latency, index, &name)); ++index) {
+			uint64_t count = 0, total = 0, max = 0;
+
+			ni_dbus_dict_get_uint64(entry, "count", &count);
+			ni_dbus_dict_get_uint64(entry, "total-usec", &total);
+			ni_dbus_dict_get_uint64(entry, "max-usec", &max);
+			printf("  %-24s count %-10"PRIu64" avg %-8"PRIu64" max %"PRIu64" usec\n",
+					name, count, count ? total / count : 0, max);
+		}
+	}
+	if ((latency = ni_dbus_dict_get(&result, "memory"))) {
+		printf("memory:\n");
+		for (index = 0; (entry = ni_dbus_dict_get_entry(latency, index, &name)); ++index) {
+			uint64_t allocs = 0, live = 0;
+
+			ni_dbus_dict_get_uint64(entry, "allocs", &allocs);
+			ni_dbus_dict_get_uint64(entry, "live-bytes", &live);
+			printf("  %-24s allocs %-10"PRIu64" live %"PRIu64" bytes\n",
+					name, allocs, live);
+		}
+	}
+
+	if ((latency = ni_dbus_dict_get(&result, "refresh"))) {
+		printf("refresh:\n");
+		for (index = 0; (entry = ni_dbus_dict_get_entry(latency, index, &name)); ++index) {
+			if (ni_dbus_variant_get_uint64(entry, &value))
+				printf("  %-24s %"PRIu64"\n", name, value);
+		}
+	}
+
+	if ((latency = ni_dbus_dict_get(&result, "stalls"))) {
+		if (latency->array.len)
+			printf("worst stall offenders:\n");
+		for (index = 0; (entry = ni_dbus_dict_get_entry(latency, index, &name)); ++index) {
+			uint64_t count = 0, total = 0, max = 0;
+
+			ni_dbus_dict_get_uint64(entry, "count", &count);
+			ni_dbus_dict_get_uint64(entry, "total-usec", &total);
+			ni_dbus_dict_get_uint64(entry, "max-usec", &max);
+			printf("  %-32s count %-6"PRIu64" total %-8"PRIu64" max %"PRIu64" usec\n",
+					name, count, total, max);
+		}
+	}
+	if (ni_dbus_dict_get_uint64(&result, "max-stall-usec", &value))
+		printf("max event stall: %"PRIu64" usec\n", value);
+
+	rv = 0;
+
+out:
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
 int
 do_show_config(int argc, char **argv, const char *root_schema)
 {
@@ -1008,7 +1190,9 @@ __get_lease_document(const char *pathname)
 		return NULL;
 	}
 
-	doc = xml_document_read(pathname);
+	/* lease files may be stored in the compact binary form */
+	if (!(doc = xml_document_read_binary(pathname)))
+		doc = xml_document_read(pathname);
 	if (!doc) {
 		ni_error("unable to parse XML document %s", pathname);
 		return NULL;
@@ -1334,6 +1518,49 @@ do_lease(int argc, char **argv)
 
 		ni_info("Writing lease info to %s", opt_file);
 		xml_document_write(doc, opt_file);
+	} else if (!strcmp(opt_cmd, "convert")) {
+		const char *opt_output = opt_file;
+		ni_bool_t to_binary = FALSE;
+
+		while (optind < argc) {
+			const char *optarg;
+
+			opt_subcmd = argv[optind++];
+			if (optind >= argc) {
+				ni_error("missing argument to command \"%s %s\"", opt_cmd, opt_subcmd);
+				goto failed;
+			}
+			optarg = argv[optind++];
+
+			if (!strcmp(opt_subcmd, "format")) {
+				if (!strcmp(optarg, "binary")) {
+					to_binary = TRUE;
+				} else
+				if (!strcmp(optarg, "xml")) {
+					to_binary = FALSE;
+				} else {
+					ni_error("invalid lease format \"%s\"", optarg);
+					goto failed;
+				}
+			} else
+			if (!strcmp(opt_subcmd, "output")) {
+				opt_output = optarg;
+			} else
+				goto unknown_subcommand;
+		}
+
+		ni_info("Writing lease info to %s", opt_output);
+		if (to_binary) {
+			if (xml_document_write_binary(doc, opt_output) < 0) {
+				ni_error("unable to write binary lease file %s", opt_output);
+				goto failed;
+			}
+		} else {
+			if (xml_document_write(doc, opt_output) < 0) {
+				ni_error("unable to write lease file %s", opt_output);
+				goto failed;
+			}
+		}
 	} else if (!strcmp(opt_cmd, "install")) {
 		static struct option install_options[] = {
 			{ "device", required_argument, NULL, 'd' },
@@ -1390,6 +1617,7 @@ usage:
 			"  {set|add}-address <ipaddr>/prefixlen [netmask <ipmask>] [peer <ipaddr>]\n"
 			"  {set|add}-route <ipaddr>/prefixlen [netmask <ipmask>] [gateway <ipaddr>]\n"
 			"  {set|add}-resolver [default-domain <domain>] [server <ipaddr> ...] [search <domain> ...]\n"
+			"  convert [format {xml|binary}] [output <filename>]\n"
 			"  install --device <object-path>\n"
 		       );
 		return ret;
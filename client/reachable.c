@@ -27,6 +27,7 @@
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
+#include <wicked/resolver.h>
 #include <wicked/xml.h>
 #include <wicked/fsm.h>
 
@@ -36,13 +37,70 @@
 /*
  * Data needed for this check
  */
-typedef struct ni_reachability_check {
+typedef struct ni_reachability_check	ni_reachability_check_t;
+struct ni_reachability_check {
+	ni_reachability_check_t *next;
+
 	char *			hostname;
 	int			family;
 
 	ni_bool_t		address_valid;
 	ni_sockaddr_t		address;
-} ni_reachability_check_t;
+};
+
+/*
+ * All outstanding checks, so that their lookups can be batched
+ */
+static ni_reachability_check_t *	ni_reachability_checks;
+
+/*
+ * Resolve the hostnames of all outstanding checks of this address
+ * family in one batch sharing a single deadline. When many workers
+ * carry a reachable requirement, a run then waits for the slowest
+ * lookup only instead of a full timeout per requirement.
+ */
+static void
+ni_reachability_checks_resolve(int family)
+{
+	ni_reachability_check_t *check;
+	const char **hostnames;
+	ni_sockaddr_t *addrs;
+	unsigned int i, count = 0;
+
+	for (check = ni_reachability_checks; check; check = check->next) {
+		if (!check->address_valid && check->family == family)
+			count++;
+	}
+	if (count == 0)
+		return;
+
+	hostnames = calloc(count, sizeof(hostnames[0]));
+	addrs = calloc(count, sizeof(addrs[0]));
+	if (!hostnames || !addrs)
+		goto done;
+
+	for (i = 0, check = ni_reachability_checks; check; check = check->next) {
+		if (!check->address_valid && check->family == family)
+			hostnames[i++] = check->hostname;
+	}
+
+	if (ni_resolve_hostnames_timed(family, count, hostnames, addrs, 1) == 0) {
+		for (i = 0, check = ni_reachability_checks; check; check = check->next) {
+			if (check->address_valid || check->family != family)
+				continue;
+
+			if (addrs[i].ss_family != AF_UNSPEC) {
+				check->address = addrs[i];
+				check->address_valid = TRUE;
+			}
+			i++;
+		}
+	}
+
+done:
+	free(hostnames);
+	free(addrs);
+}
 
 
 static ni_bool_t
@@ -61,12 +119,13 @@ ni_fsm_require_check_reachable(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_require_t
 		check->address_valid = FALSE;
 	req->event_seq = fsm->event_seq;
 
-	if (!check->address_valid
-	 && ni_resolve_hostname_timed(check->hostname, check->family, &check->address, 1) <= 0) {
+	if (!check->address_valid)
+		ni_reachability_checks_resolve(check->family);
+
+	if (!check->address_valid) {
 		ni_debug_application("check reachability: %s not resolvable", check->hostname);
 		return FALSE;
 	}
-	check->address_valid = TRUE;
 
 	if (ni_host_is_reachable(check->hostname, &check->address) <= 0) {
 		ni_debug_application("check reachability: %s not reachable at %s",
@@ -82,8 +141,15 @@ static void
 ni_ifworker_reachability_check_destroy(ni_fsm_require_t *req)
 {
 	ni_reachability_check_t *check = req->user_data;
+	ni_reachability_check_t **pos;
 
 	if (check != NULL) {
+		for (pos = &ni_reachability_checks; *pos; pos = &(*pos)->next) {
+			if (*pos == check) {
+				*pos = check->next;
+				break;
+			}
+		}
 		ni_string_free(&check->hostname);
 		free(check);
 	}
@@ -115,6 +181,9 @@ ni_ifworker_reachability_check_new(xml_node_t *node)
 	ni_string_dup(&check->hostname, hostname);
 	check->family = afhint;
 
+	check->next = ni_reachability_checks;
+	ni_reachability_checks = check;
+
 	req = ni_fsm_require_new(ni_fsm_require_check_reachable, ni_ifworker_reachability_check_destroy);
 	req->user_data = check;
 
@@ -35,7 +35,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
@@ -47,6 +50,8 @@
 #if defined(COMPAT_AUTO) || defined(COMPAT_SUSE)
 extern ni_bool_t	__ni_suse_get_ifconfig(const char *, const char *,
 						ni_compat_ifconfig_t *);
+extern ni_bool_t	__ni_suse_ifconfig_deps(const char *, const char *,
+						ni_string_array_t *);
 #endif
 #if defined(COMPAT_AUTO) || defined(COMPAT_REDHAT)
 extern ni_bool_t	__ni_redhat_get_ifconfig(const char *, const char *,
@@ -381,6 +386,202 @@ ni_ifconfig_validate_adding_doc(xml_document_t *config_doc, ni_bool_t check_prio
 	return TRUE;
 }
 
+/*
+ * Cache of converted compat configs.
+ *
+ * Converting the ifcfg files to canonical XML walks and parses many
+ * small files, while provisioning scripts invoke the client over and
+ * over against an unchanged configuration. Keep the conversion result
+ * per source under the statedir, together with a manifest of every
+ * file the conversion consulted, and replay it as long as all manifest
+ * entries are unchanged (same mtime, or still absent). When only the
+ * mtime changed, the recorded content checksum decides, so deployment
+ * tools rewriting identical files do not flush the cache. Raw reads
+ * are not cached, and any inconsistency falls back to a fresh
+ * conversion.
+ *
+ * The wicked: xml sources gain nothing from this - reading the cache
+ * would parse just as much XML as reading them directly - and the
+ * firmware: sources come from extension scripts without mtimes.
+ */
+static const char *
+ni_ifconfig_cache_file_path(char **cachefile, const char *source)
+{
+	const unsigned char *sp;
+	unsigned int hash = 5381;
+
+	for (sp = (const unsigned char *) source; *sp; ++sp)
+		hash = ((hash << 5) + hash) + *sp;
+	return ni_string_printf(cachefile, "%s/ifcfg-cache-%08x.xml",
+					ni_config_statedir(), hash);
+}
+
+static ni_bool_t
+ni_ifconfig_cache_file_csum(const char *path, unsigned int *csum)
+{
+	unsigned char buf[BUFSIZ];
+	ssize_t len;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return FALSE;
+
+	*csum = 0;
+	while ((len = read(fd, buf, sizeof(buf))) > 0)
+		*csum = ni_crc32c(*csum, buf, len);
+	close(fd);
+
+	return len == 0;
+}
+
+static ni_bool_t
+ni_ifconfig_cache_manifest_valid(const xml_node_t *manifest)
+{
+	const xml_node_t *child;
+
+	if (!manifest)
+		return FALSE;
+
+	for (child = manifest->children; child; child = child->next) {
+		const char *path = xml_node_get_attr(child, "path");
+		unsigned int csum, have;
+		const char *attr;
+		unsigned long mtime;
+		struct stat stb;
+
+		if (!ni_string_eq(child->name, "file") || ni_string_empty(path))
+			return FALSE;
+
+		if (xml_node_get_attr_ulong(child, "mtime", &mtime)) {
+			if (stat(path, &stb) < 0)
+				return FALSE;
+
+			if ((unsigned long)stb.st_mtime == mtime)
+				continue;
+
+			/* mtime changed: still valid when the recorded
+			 * content checksum matches, e.g. after a tool
+			 * rewrote the very same file */
+			if (!(attr = xml_node_get_attr(child, "csum")))
+				return FALSE;
+			if (ni_parse_uint(attr, &have, 16) ||
+			    !ni_ifconfig_cache_file_csum(path, &csum) ||
+			    have != csum)
+				return FALSE;
+		} else {
+			/* recorded as absent, so it has to stay absent */
+			if (stat(path, &stb) == 0)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+ni_ifconfig_cache_load(xml_document_array_t *docs, const char *cachefile,
+			const char *source, ni_bool_t check_prio)
+{
+	ni_client_state_config_t conf = NI_CLIENT_STATE_CONFIG_INIT;
+	xml_document_t *cache;
+	xml_node_t *cnode, *entry, *next;
+
+	if (!(cache = xml_document_read(cachefile)))
+		return FALSE;
+
+	cnode = xml_node_get_child(xml_document_root(cache), "ifconfig-cache");
+	if (!cnode || !ni_string_eq(xml_node_get_attr(cnode, "source"), source) ||
+	    !ni_ifconfig_cache_manifest_valid(xml_node_get_child(cnode, "manifest"))) {
+		xml_document_free(cache);
+		return FALSE;
+	}
+
+	for (entry = cnode->children; entry; entry = next) {
+		xml_document_t *doc;
+		xml_node_t *node;
+
+		next = entry->next;
+		if (!ni_string_eq(entry->name, "config"))
+			continue;
+
+		doc = xml_document_new();
+		node = xml_document_root(doc);
+		while (entry->children)
+			xml_node_reparent(node, entry->children);
+
+		if (ni_ifconfig_metadata_get_from_node(&conf, node))
+			xml_node_location_relocate(node, conf.origin);
+
+		if (ni_ifconfig_validate_adding_doc(doc, check_prio)) {
+			ni_debug_ifconfig("%s: %s", __func__, xml_node_location(node));
+			xml_document_array_append(docs, doc);
+		} else {
+			xml_document_free(doc);
+		}
+	}
+
+	ni_debug_ifconfig("%s: reusing cached config conversion %s", source, cachefile);
+	ni_client_state_config_reset(&conf);
+	xml_document_free(cache);
+	return TRUE;
+}
+
+static void
+ni_ifconfig_cache_save(const xml_document_array_t *docs, unsigned int first,
+			const char *cachefile, const char *source,
+			const ni_string_array_t *deps)
+{
+	xml_document_t *cache;
+	xml_node_t *cnode, *manifest;
+	char *tmppath = NULL;
+	struct stat stb;
+	unsigned int i;
+
+	cache = xml_document_new();
+	cnode = xml_node_new("ifconfig-cache", xml_document_root(cache));
+	xml_node_add_attr(cnode, "source", source);
+
+	manifest = xml_node_new("manifest", cnode);
+	for (i = 0; i < deps->count; ++i) {
+		xml_node_t *file = xml_node_new("file", manifest);
+		unsigned int csum;
+		char buf[16];
+
+		xml_node_add_attr(file, "path", deps->data[i]);
+		if (stat(deps->data[i], &stb) == 0) {
+			xml_node_add_attr_ulong(file, "mtime", stb.st_mtime);
+			if (ni_ifconfig_cache_file_csum(deps->data[i], &csum)) {
+				snprintf(buf, sizeof(buf), "%08x", csum);
+				xml_node_add_attr(file, "csum", buf);
+			}
+		}
+	}
+
+	for (i = first; i < docs->count; ++i) {
+		xml_node_t *config = xml_node_new("config", cnode);
+		const xml_node_t *child;
+
+		child = xml_document_root(docs->data[i])->children;
+		for (; child; child = child->next)
+			xml_node_clone(child, config);
+	}
+
+	/* write to a temp file and rename, so concurrent readers
+	 * never see a partial cache; failure to save is no error */
+	ni_string_printf(&tmppath, "%s.%u.tmp", cachefile, getpid());
+	if (xml_document_write(cache, tmppath) == 0) {
+		if (rename(tmppath, cachefile) < 0) {
+			ni_debug_ifconfig("%s: unable to rename %s to %s: %m",
+					__func__, tmppath, cachefile);
+			unlink(tmppath);
+		}
+	} else {
+		unlink(tmppath);
+	}
+
+	ni_string_free(&tmppath);
+	xml_document_free(cache);
+}
+
 /*
  * Read ifconfig
  */
@@ -544,16 +745,36 @@ ni_bool_t
 ni_ifconfig_read_compat_suse(xml_document_array_t *array, const char *type,
 			const char *root, const char *path, ni_bool_t check_prio, ni_bool_t raw)
 {
+	ni_string_array_t deps = NI_STRING_ARRAY_INIT;
+	unsigned int first = array->count;
 	ni_compat_ifconfig_t conf;
-	ni_bool_t rv;
+	char *cachefile = NULL;
+	char *source = NULL;
+	ni_bool_t rv = TRUE;
+
+	/* raw mode strips the meta data the cache needs to replay */
+	if (!raw) {
+		ni_string_printf(&source, "%s:%s:%s", type,
+				root ? root : "", path ? path : "");
+		ni_ifconfig_cache_file_path(&cachefile, source);
+		if (ni_ifconfig_cache_load(array, cachefile, source, check_prio))
+			goto out;
+	}
 
 	ni_compat_ifconfig_init(&conf, type);
 
 	/* TODO: apply timeout */
 	if ((rv = __ni_suse_get_ifconfig(root, path, &conf))) {
 		ni_compat_generate_interfaces(array, &conf, check_prio, raw);
+		if (cachefile && __ni_suse_ifconfig_deps(root, path, &deps))
+			ni_ifconfig_cache_save(array, first, cachefile, source, &deps);
 	}
 	ni_compat_ifconfig_destroy(&conf);
+
+out:
+	ni_string_array_destroy(&deps);
+	ni_string_free(&cachefile);
+	ni_string_free(&source);
 	return rv;
 }
 #endif
@@ -392,6 +392,7 @@ try_vlan(ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 {
 	ni_netdev_t *dev = compat->dev;
 	unsigned int eth_num, vlan_tag;
+	char *parent = NULL;
 	ni_vlan_t *vlan;
 	ni_bool_t is_vlan = 0;
 
@@ -408,12 +409,14 @@ try_vlan(ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 	vlan = ni_netdev_get_vlan(dev);
 	vlan->tag = vlan_tag;
 
-	if(!ni_string_printf(&dev->link.lowerdev.name, "eth%u", eth_num)) {
+	if(!ni_string_printf(&parent, "eth%u", eth_num)) {
 		ni_error("%s: unable to allocate VLAN base interface name",
 			dev->name);
 		free(vlan);
 		return FALSE;
 	}
+	ni_refstr_dup(&dev->link.lowerdev.name, parent);
+	ni_string_free(&parent);
 	return TRUE;
 }
 
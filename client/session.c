@@ -0,0 +1,486 @@
+/*
+ *	Client session mode: amortize per-invocation startup cost over
+ *	many wicked commands.
+ *
+ *	When WICKED_CLIENT_SESSION is enabled in the environment, the
+ *	first invocation forks a small daemonlet that initializes the
+ *	library once (config parse, DBus XML schema load) and then
+ *	accepts command lines on a unix socket. Subsequent invocations
+ *	pass their argv plus their stdio descriptors to the daemonlet,
+ *	which forks a worker per command; output streams through the
+ *	passed descriptors and only the exit status travels back over
+ *	the socket. The daemonlet exits after an idle period.
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/objectmodel.h>
+#include <wicked/util.h>
+
+#include "client/wicked-client.h"
+#include "util_priv.h"
+
+#define NI_CLIENT_SESSION_SOCKET	WICKED_STATEDIR"/client-session.sock"
+#define NI_CLIENT_SESSION_MAX_ARGV	(64U * 1024)
+#define NI_CLIENT_SESSION_IDLE_MSEC	(600 * 1000)
+#define NI_CLIENT_SESSION_WAIT_MSEC	50
+#define NI_CLIENT_SESSION_WAIT_LOOPS	100
+
+static ni_bool_t	ni_client_session_is_worker = FALSE;
+
+/*
+ * TRUE when running a command forked off the session daemonlet;
+ * such a worker inherits an already initialized library.
+ */
+ni_bool_t
+ni_client_session_worker(void)
+{
+	return ni_client_session_is_worker;
+}
+
+static int
+ni_client_session_connect(void)
+{
+	struct sockaddr_un sun;
+	int fd;
+
+	if ((fd = socket(PF_LOCAL, SOCK_STREAM, 0)) < 0)
+		return -1;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	strncpy(sun.sun_path, NI_CLIENT_SESSION_SOCKET, sizeof(sun.sun_path) - 1);
+
+	if (connect(fd, (struct sockaddr *) &sun, sizeof(sun)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Read and write helpers; the stream socket may deliver partial data.
+ */
+static ni_bool_t
+ni_client_session_write(int fd, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	ssize_t n;
+
+	while (len) {
+		if ((n = write(fd, p, len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		p += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+ni_client_session_read(int fd, void *data, size_t len)
+{
+	unsigned char *p = data;
+	ssize_t n;
+
+	while (len) {
+		if ((n = read(fd, p, len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		if (n == 0)
+			return FALSE;
+		p += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+/*
+ * Send the command line plus our stdio descriptors. The descriptors
+ * ride along the length header as SCM_RIGHTS ancillary data, so the
+ * worker's output streams directly to our terminal or pipe.
+ */
+static ni_bool_t
+ni_client_session_send_request(int fd, int argc, char **argv)
+{
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(3 * sizeof(int))];
+	} u;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	int fds[3] = { 0, 1, 2 };
+	uint32_t len = 0;
+	char *blob, *p;
+	int i;
+	ni_bool_t ok;
+
+	for (i = 0; i < argc; ++i)
+		len += strlen(argv[i]) + 1;
+	if (len == 0 || len > NI_CLIENT_SESSION_MAX_ARGV)
+		return FALSE;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&u, 0, sizeof(u));
+	iov.iov_base = &len;
+	iov.iov_len = sizeof(len);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = u.buf;
+	msg.msg_controllen = sizeof(u.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(3 * sizeof(int));
+	memcpy(CMSG_DATA(cmsg), fds, 3 * sizeof(int));
+
+	if (sendmsg(fd, &msg, 0) != (ssize_t) sizeof(len))
+		return FALSE;
+
+	blob = xmalloc(len);
+	for (i = 0, p = blob; i < argc; ++i) {
+		strcpy(p, argv[i]);
+		p += strlen(argv[i]) + 1;
+	}
+	ok = ni_client_session_write(fd, blob, len);
+	free(blob);
+	return ok;
+}
+
+/*
+ * Daemonlet side: receive one command line and the client's stdio
+ * descriptors. Returns the argv array (NULL terminated, backed by
+ * a single blob hung off argv[0]) or NULL on a bad request.
+ */
+static char **
+ni_client_session_recv_request(int conn, int *argcp, int fds[3])
+{
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(3 * sizeof(int))];
+	} u;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	uint32_t len = 0;
+	char *blob, **argv;
+	unsigned int argc, i;
+
+	fds[0] = fds[1] = fds[2] = -1;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &len;
+	iov.iov_len = sizeof(len);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = u.buf;
+	msg.msg_controllen = sizeof(u.buf);
+
+	if (recvmsg(conn, &msg, 0) != (ssize_t) sizeof(len))
+		return NULL;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+	    cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+		return NULL;
+	memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+
+	if (len == 0 || len > NI_CLIENT_SESSION_MAX_ARGV)
+		return NULL;
+
+	blob = xmalloc(len);
+	if (!ni_client_session_read(conn, blob, len) || blob[len - 1] != '\0') {
+		free(blob);
+		return NULL;
+	}
+
+	argc = 0;
+	for (i = 0; i < len; ++i) {
+		if (blob[i] == '\0')
+			argc++;
+	}
+
+	argv = xcalloc(argc + 1, sizeof(char *));
+	for (i = 0; i < argc; ++i) {
+		argv[i] = blob;
+		blob += strlen(blob) + 1;
+	}
+
+	*argcp = argc;
+	return argv;
+}
+
+/*
+ * Handle one connection: fork a worker that takes over the client's
+ * stdio and runs the command dispatch, then report its exit status.
+ * The worker inherits the warm state (parsed config, loaded schema)
+ * from the daemonlet; the DBus connection is established per command
+ * in the worker, since libdbus state cannot be shared across forks.
+ */
+static void
+ni_client_session_serve(int conn)
+{
+	char **argv;
+	int argc, fds[3], status = NI_WICKED_RC_ERROR;
+	pid_t pid;
+
+	if ((argv = ni_client_session_recv_request(conn, &argc, fds)) == NULL) {
+		ni_error("client session: received malformed request");
+		goto report;
+	}
+
+	if ((pid = fork()) < 0) {
+		ni_error("client session: unable to fork worker: %m");
+		goto report;
+	}
+
+	if (pid == 0) {
+		dup2(fds[0], 0);
+		dup2(fds[1], 1);
+		dup2(fds[2], 2);
+		close(fds[0]);
+		close(fds[1]);
+		close(fds[2]);
+		close(conn);
+
+		ni_client_session_is_worker = TRUE;
+		exit(ni_client_command_main(argc, argv));
+	}
+
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+		;
+	status = WIFEXITED(status) ? WEXITSTATUS(status) : NI_WICKED_RC_ERROR;
+
+report:
+	if (argv) {
+		free(argv[0]);
+		free(argv);
+	}
+	if (fds[0] >= 0) {
+		close(fds[0]);
+		close(fds[1]);
+		close(fds[2]);
+	}
+	ni_client_session_write(conn, &status, sizeof(status));
+}
+
+/*
+ * The daemonlet proper; entered in a double-forked child and never
+ * returns. Requests are handled one at a time, which also serializes
+ * the provisioning pipeline's commands the way separate invocations
+ * would.
+ */
+/*
+ * The socket executes whatever argv it receives as root; accept
+ * connections from root peers only.
+ */
+static ni_bool_t
+ni_client_session_peer_ok(int conn)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+		ni_error("client session: cannot get peer credentials: %m");
+		return FALSE;
+	}
+	if (cred.uid != 0) {
+		ni_error("client session: rejecting connection from uid %u",
+				(unsigned int) cred.uid);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+ni_client_session_server(void)
+{
+	struct sockaddr_un sun;
+	struct pollfd pfd;
+	mode_t omask;
+	int fd, lfd, conn;
+
+	setsid();
+	if ((fd = open("/dev/null", O_RDWR)) >= 0) {
+		dup2(fd, 0);
+		dup2(fd, 1);
+		dup2(fd, 2);
+		if (fd > 2)
+			close(fd);
+	}
+
+	ni_log_destination("wicked", "syslog:user");
+
+	if (ni_init("client") < 0)
+		exit(NI_WICKED_RC_ERROR);
+
+	/* warm up: load and register the DBus XML schema once */
+	if (ni_objectmodel_init(NULL) == NULL)
+		exit(NI_WICKED_RC_ERROR);
+
+	if ((lfd = socket(PF_LOCAL, SOCK_STREAM, 0)) < 0)
+		exit(NI_WICKED_RC_ERROR);
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	strncpy(sun.sun_path, NI_CLIENT_SESSION_SOCKET, sizeof(sun.sun_path) - 1);
+
+	unlink(NI_CLIENT_SESSION_SOCKET);
+	/* do not rely on the inherited umask for the socket mode */
+	omask = umask(077);
+	if (bind(lfd, (struct sockaddr *) &sun, sizeof(sun)) < 0 ||
+	    chmod(NI_CLIENT_SESSION_SOCKET, 0600) < 0 ||
+	    listen(lfd, 8) < 0) {
+		umask(omask);
+		ni_error("client session: cannot listen on %s: %m",
+				NI_CLIENT_SESSION_SOCKET);
+		exit(NI_WICKED_RC_ERROR);
+	}
+	umask(omask);
+
+	ni_debug_application("client session daemonlet listening on %s",
+			NI_CLIENT_SESSION_SOCKET);
+
+	for (;;) {
+		pfd.fd = lfd;
+		pfd.events = POLLIN;
+
+		if (poll(&pfd, 1, NI_CLIENT_SESSION_IDLE_MSEC) <= 0)
+			break;
+
+		if ((conn = accept(lfd, NULL, NULL)) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (ni_client_session_peer_ok(conn))
+			ni_client_session_serve(conn);
+		close(conn);
+	}
+
+	ni_debug_application("client session daemonlet exiting");
+	unlink(NI_CLIENT_SESSION_SOCKET);
+	exit(NI_WICKED_RC_SUCCESS);
+}
+
+/*
+ * Detach the daemonlet via a double fork, so it is not a child of
+ * this (short-lived) invocation.
+ */
+static ni_bool_t
+ni_client_session_start(void)
+{
+	pid_t pid;
+
+	if ((pid = fork()) < 0)
+		return FALSE;
+
+	if (pid == 0) {
+		if (fork() == 0)
+			ni_client_session_server();	/* never returns */
+		_exit(0);
+	}
+
+	while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+		;
+	return TRUE;
+}
+
+/*
+ * Run the command line through the session daemonlet if the user
+ * opted in via WICKED_CLIENT_SESSION. Returns the command's exit
+ * status, or a negative value when the invocation should proceed
+ * normally (session mode disabled, unavailable, or a per-invocation
+ * option that the pre-initialized daemonlet cannot honor).
+ */
+int
+ni_client_session_dispatch(int argc, char **argv)
+{
+	const char *var;
+	ni_bool_t enabled = FALSE;
+	int fd, status, i;
+
+	if ((var = getenv("WICKED_CLIENT_SESSION")) == NULL)
+		return -1;
+	if (ni_parse_boolean(var, &enabled) < 0 || !enabled)
+		return -1;
+
+	/* the daemonlet initialized with the default config; options
+	 * changing that must bypass the session */
+	for (i = 1; i < argc; ++i) {
+		if (!strncmp(argv[i], "--config", 8) ||
+		    !strncmp(argv[i], "--root-directory", 16))
+			return -1;
+	}
+
+	if ((fd = ni_client_session_connect()) < 0) {
+		if (!ni_client_session_start())
+			return -1;
+
+		for (i = 0; i < NI_CLIENT_SESSION_WAIT_LOOPS; ++i) {
+			usleep(NI_CLIENT_SESSION_WAIT_MSEC * 1000);
+			if ((fd = ni_client_session_connect()) >= 0)
+				break;
+		}
+		if (fd < 0) {
+			ni_warn("cannot reach client session daemonlet - running directly");
+			return -1;
+		}
+	}
+
+	if (!ni_client_session_send_request(fd, argc, argv)) {
+		/* nothing executed yet - safe to run directly */
+		close(fd);
+		return -1;
+	}
+
+	if (!ni_client_session_read(fd, &status, sizeof(status))) {
+		/* the command may have run; do not run it again */
+		ni_error("lost connection to client session daemonlet");
+		close(fd);
+		return NI_WICKED_RC_ERROR;
+	}
+
+	close(fd);
+	return status;
+}
@@ -102,11 +102,17 @@ static ni_bool_t		__ni_wireless_parse_eap_auth(const ni_sysconfig_t *, ni_wirele
 							const char *, const char *, ni_wireless_ap_scan_mode_t);
 static ni_bool_t		__ni_suse_parse_dhcp4_user_class(const ni_sysconfig_t *, ni_compat_netdev_t *, const char *);
 
+struct ni_suse_provider_entry {
+	struct ni_suse_provider_entry *	next;
+	ni_sysconfig_t *		sc;
+};
+
 static char *			__ni_suse_default_hostname;
 static ni_sysconfig_t *		__ni_suse_config_defaults;
 static ni_sysconfig_t *		__ni_suse_dhcp_defaults;
 static ni_route_table_t *	__ni_suse_global_routes;
 static ni_var_array_t		__ni_suse_global_ifsysctl;
+static struct ni_suse_provider_entry *	__ni_suse_provider_cache;
 static ni_bool_t		__ni_ipv6_disbled;
 
 /* compat: no default script scheme as a safeguard (boo#907215, bsc#920070, bsc#919496) */
@@ -281,6 +287,93 @@ done:
 	return success;
 }
 
+/*
+ * Enumerate the files an ifcfg read consults, so the caller can cache
+ * the conversion result and validate it against their mtimes. The list
+ * also contains paths which may not exist (yet); the caller records
+ * them as absent, so their appearance invalidates the cache as well.
+ */
+static void
+__ni_suse_ifconfig_deps_scan(const char *dirname, ni_string_array_t *deps, unsigned int depth)
+{
+	ni_string_array_t entries = NI_STRING_ARRAY_INIT;
+	char pathbuf[PATH_MAX];
+	unsigned int i;
+
+	ni_string_array_append(deps, dirname);
+	if (!ni_scandir(dirname, NULL, &entries))
+		return;
+
+	for (i = 0; i < entries.count; ++i) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", dirname, entries.data[i]);
+		if (ni_isdir(pathbuf)) {
+			if (depth)
+				__ni_suse_ifconfig_deps_scan(pathbuf, deps, depth - 1);
+			else
+				ni_string_array_append(deps, pathbuf);
+		} else {
+			ni_string_array_append(deps, pathbuf);
+		}
+	}
+	ni_string_array_destroy(&entries);
+}
+
+ni_bool_t
+__ni_suse_ifconfig_deps(const char *root, const char *path, ni_string_array_t *deps)
+{
+	const char *filenames[] = __NI_SUSE_HOSTNAME_FILES, **name;
+	const char *sysctldirs[] = __NI_SUSE_SYSCTL_DIRS, **sysctld;
+	const char *_path = __NI_SUSE_SYSCONFIG_NETWORK_DIR;
+	char pathbuf[PATH_MAX];
+	char *pathname = NULL;
+	struct utsname u;
+
+	if (!ni_string_empty(path))
+		_path = path;
+
+	if (!root)
+		root = "";
+
+	if (ni_string_empty(root))
+		snprintf(pathbuf, sizeof(pathbuf), "%s", _path);
+	else
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", root, _path);
+
+	if (!ni_realpath(pathbuf, &pathname) || !ni_isdir(pathname)) {
+		ni_string_free(&pathname);
+		return FALSE;
+	}
+
+	/* the ifcfg dir with routes, rules, sysctl and provider files */
+	__ni_suse_ifconfig_deps_scan(pathname, deps, 1);
+	ni_string_free(&pathname);
+
+	/* hostname files, cf. __ni_suse_read_default_hostname */
+	for (name = filenames; *name; name++) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, *name);
+		ni_string_array_append(deps, pathbuf);
+	}
+
+	/* sysctl locations, cf. __ni_suse_read_global_ifsysctl */
+	memset(&u, 0, sizeof(u));
+	if (uname(&u) == 0) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s%s", root,
+				__NI_SUSE_SYSCTL_BOOT, u.release);
+		ni_string_array_append(deps, pathbuf);
+	}
+	for (sysctld = sysctldirs; *sysctld; ++sysctld) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, *sysctld);
+		if (ni_isdir(pathbuf))
+			__ni_suse_ifconfig_deps_scan(pathbuf, deps, 0);
+		else
+			ni_string_array_append(deps, pathbuf);
+	}
+	snprintf(pathbuf, sizeof(pathbuf), "%s%s", root, __NI_SUSE_SYSCTL_FILE);
+	ni_string_array_append(deps, pathbuf);
+
+	return TRUE;
+}
+
 /*
  * Read HOSTNAME file
  */
@@ -497,6 +590,14 @@ __ni_suse_free_globals(void)
 
 	ni_route_tables_destroy(&__ni_suse_global_routes);
 
+	while (__ni_suse_provider_cache) {
+		struct ni_suse_provider_entry *pe = __ni_suse_provider_cache;
+
+		__ni_suse_provider_cache = pe->next;
+		ni_sysconfig_destroy(pe->sc);
+		free(pe);
+	}
+
 	ni_var_array_destroy(&__ni_suse_global_ifsysctl);
 }
 
@@ -549,7 +650,7 @@ __ni_suse_parse_route_hops(ni_route_nexthop_t *nh, ni_string_array_t *opts,
 			val = ni_string_array_at(opts, (*pos)++);
 			if (!val || nh->device.name)
 				return -1;
-			ni_string_dup(&nh->device.name, val);
+			ni_refstr_dup(&nh->device.name, val);
 		} else
 		if (!strcmp(opt, "weight")) {
 			val = ni_string_array_at(opts, (*pos)++);
@@ -591,7 +692,7 @@ __ni_suse_parse_route_hops(ni_route_nexthop_t *nh, ni_string_array_t *opts,
 
 	/* apply default ifname when available */
 	if (!nh->device.name && ifname)
-		ni_string_dup(&nh->device.name, ifname);
+		ni_refstr_dup(&nh->device.name, ifname);
 
 	if (!nh->device.name && nh->gateway.ss_family == AF_UNSPEC)
 		return -1;
@@ -1030,14 +1131,14 @@ __ni_suse_route_parse(ni_route_table_t **routes, char *buffer, const char *ifnam
 		/* Hmm... just assign to loopback (as in kernel) and continue */
 		ni_route_nexthop_list_destroy(&rp->nh.next);
 		memset(&rp->nh.gateway, 0, sizeof(rp->nh.gateway));
-		ni_string_dup(&rp->nh.device.name, "lo");
+		ni_refstr_dup(&rp->nh.device.name, "lo");
 		break;
 
 	default:
 		/* we need either ifname or gateway... */
 		for (nh = &rp->nh; nh; nh = nh->next) {
 			if (!nh->device.name && ifname) {
-				ni_string_dup(&nh->device.name, ifname);
+				ni_refstr_dup(&nh->device.name, ifname);
 			}
 			if (!rp->nh.device.name && rp->nh.gateway.ss_family == AF_UNSPEC) {
 				ni_error("%s[%u]: Neither device nor gateway found",
@@ -1359,7 +1460,7 @@ ni_suse_parse_rule(ni_rule_t *rule, ni_string_array_t *opts,
 						filename, line, val);
 				return -1;
 			}
-			ni_string_dup(&rule->iif.name, val);
+			ni_refstr_dup(&rule->iif.name, val);
 		} else
 		if (ni_string_eq(opt, "oif")) {
 			val = ni_string_array_at(opts, pos++);
@@ -1368,7 +1469,7 @@ ni_suse_parse_rule(ni_rule_t *rule, ni_string_array_t *opts,
 						filename, line, val);
 				return -1;
 			}
-			ni_string_dup(&rule->oif.name, val);
+			ni_refstr_dup(&rule->oif.name, val);
 		} else
 		if (ni_string_eq(opt, "nat") || ni_string_eq(opt, "map-to")) {
 			ni_error("%s[%u]: NAT routing rules are not supported any more",
@@ -1677,6 +1778,7 @@ try_infiniband(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 	const char *mode;
 	const char *pkey;
 	const char *err;
+	char *parent = NULL;
 	ni_infiniband_t *ib;
 
 	mode   = ni_sysconfig_get_value(sc, "IPOIB_MODE");
@@ -1705,7 +1807,9 @@ try_infiniband(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 		}
 
 		ib->pkey = tmp;
-		ni_string_set(&dev->link.lowerdev.name, dev->name, pkey - dev->name);
+		ni_string_set(&parent, dev->name, pkey - dev->name);
+		ni_refstr_dup(&dev->link.lowerdev.name, parent);
+		ni_string_free(&parent);
 	}
 
 	if (mode && !ni_infiniband_get_mode_flag(mode, &ib->mode)) {
@@ -3110,7 +3214,7 @@ try_vlan(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 		vlan->protocol = protocol;
 	}
 
-	ni_string_dup(&dev->link.lowerdev.name, etherdev);
+	ni_refstr_dup(&dev->link.lowerdev.name, etherdev);
 	vlan->tag = tag;
 
 	if ((lladdr = ni_sysconfig_get_value(sc, "LLADDR")) != NULL) {
@@ -3159,7 +3263,7 @@ try_vxlan(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 					dev->name, ni_print_suspect(str, 15));
 			return -1;
 		}
-		ni_string_dup(&dev->link.lowerdev.name, str);
+		ni_refstr_dup(&dev->link.lowerdev.name, str);
 	}
 
 	/* vxlan specific properties */
@@ -3434,7 +3538,7 @@ try_macvlan(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 		ni_error("ifcfg-%s: %s", dev->name, err);
 		return -1;
 	}
-	ni_string_dup(&dev->link.lowerdev.name, macvlan_dev);
+	ni_refstr_dup(&dev->link.lowerdev.name, macvlan_dev);
 
 	if ((lladdr = ni_sysconfig_get_value(sc, "LLADDR")) != NULL) {
 		if (ni_link_address_parse(&dev->link.hwaddr, ARPHRD_ETHER, lladdr) < 0) {
@@ -4122,16 +4226,35 @@ try_wireless(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 
 /*
  * Handle provider files
+ *
+ * Multiple interfaces may refer to the same provider, so keep the
+ * parsed files around until the globals are flushed instead of
+ * re-reading them for every interface.
  */
 static ni_sysconfig_t *
 __ni_suse_read_provider(const char *sibling, const char *provider)
 {
+	struct ni_suse_provider_entry *pe;
 	const char *filename;
+	ni_sysconfig_t *sc;
 
 	filename = ni_sibling_path_printf(sibling, "providers/%s", provider);
 	if (ni_string_empty(filename) || !ni_file_exists(filename))
 		return NULL;
-	return ni_sysconfig_read(filename);
+
+	for (pe = __ni_suse_provider_cache; pe; pe = pe->next) {
+		if (ni_string_eq(pe->sc->pathname, filename))
+			return pe->sc;
+	}
+
+	if (!(sc = ni_sysconfig_read(filename)))
+		return NULL;
+
+	pe = xcalloc(1, sizeof(*pe));
+	pe->sc = sc;
+	pe->next = __ni_suse_provider_cache;
+	__ni_suse_provider_cache = pe;
+	return sc;
 }
 
 static int
@@ -4327,8 +4450,7 @@ try_ppp(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 	}
 
 done:
-	if (psc)
-		ni_sysconfig_destroy(psc);
+	/* psc is owned by the provider cache */
 	return ret;
 }
 
@@ -4400,7 +4522,7 @@ __try_tunnel_generic(const char *ifname, unsigned short arp_type,
 					ifname, value);
 			return -1;
 		}
-		ni_string_dup(&link->lowerdev.name, value);
+		ni_refstr_dup(&link->lowerdev.name, value);
 	}
 
 	if ((value = ni_sysconfig_get_value(sc, "TUNNEL_LOCAL_IPADDR"))) {
@@ -4968,6 +5090,17 @@ __ni_suse_addrconf_static(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 				if (rp->family == AF_INET6 && !ipv6_enabled)
 					continue;
 
+				/* a route where every nexthop names some other
+				 * device can never match; skip it before the
+				 * more expensive destination lookup below */
+				for (nh = &rp->nh; nh; nh = nh->next) {
+					if (!nh->device.name ||
+					    ni_string_eq(nh->device.name, dev->name))
+						break;
+				}
+				if (nh == NULL)
+					continue;
+
 				/* skip if dev->routes contains the destination */
 				if (ni_route_tables_find_match(dev->routes, rp,
 						ni_route_equal_destination))
@@ -5013,7 +5146,7 @@ __ni_suse_addrconf_static(const ni_sysconfig_t *sc, ni_compat_netdev_t *compat)
 				if (matches) {
 					for (nh = &rp->nh; nh; nh = nh->next) {
 						if (!nh->device.name) {
-							ni_string_dup(&nh->device.name, dev->name);
+							ni_refstr_dup(&nh->device.name, dev->name);
 						}
 					}
 
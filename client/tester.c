@@ -95,7 +95,7 @@ ni_do_test_dhcp4(const char *caller, int argc, char **argv)
 				"  --timeout, -t   	<timeout in sec> (default: 20+10)\n"
 				"  --request, -r   	<request.xml>\n"
 				"  --output, -o    	<output file name>\n"
-				"  --format, -F    	<leaseinfo|lease-xml>\n"
+				"  --format, -F    	<leaseinfo|leaseinfo-json|lease-xml>\n"
 				"  --broadcast, -b	request broadcast responses from server\n"
 				"\n", program);
 			goto cleanup;
@@ -215,7 +215,7 @@ ni_do_test_dhcp6(const char *caller, int argc, char **argv)
 				"  --request, -r   <request.xml>\n"
 				"  --timeout, -t   <timeout in sec> (default: 20+10)\n"
 				"  --output, -o    <output file name>\n"
-				"  --format, -F    <leaseinfo|lease-xml>\n"
+				"  --format, -F    <leaseinfo|leaseinfo-json|lease-xml>\n"
 				"  --mode, -m      <auto|info|managed>\n"
 				"\n", program);
 			goto cleanup;
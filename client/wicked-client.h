@@ -38,6 +38,10 @@ extern int			opt_global_dryrun;
 extern char *			opt_global_rootdir;
 extern ni_bool_t		opt_systemd;
 
+extern int			ni_client_command_main(int, char **);
+extern int			ni_client_session_dispatch(int, char **);
+extern ni_bool_t		ni_client_session_worker(void);
+
 /* We may want to move this into the library. */
 extern int			ni_resolve_hostname_timed(const char *, int, ni_sockaddr_t *, unsigned int);
 extern int			ni_host_is_reachable(const char *, const ni_sockaddr_t *);
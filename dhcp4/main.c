@@ -21,6 +21,8 @@
 #include <wicked/logging.h>
 #include <wicked/objectmodel.h>
 
+#include "workqueue.h"
+#include "appconfig.h"
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/tester.h"
 
@@ -45,6 +47,7 @@ enum {
 	OPT_TEST_OUTPUT,
 	OPT_TEST_OUTFMT,
 	OPT_TEST_BROADCAST,
+	OPT_TEST_CLIENTS,
 };
 
 static struct option	options[] = {
@@ -70,6 +73,7 @@ static struct option	options[] = {
 	{ "test-output",	required_argument,	NULL,	OPT_TEST_OUTPUT  },
 	{ "test-format",	required_argument,	NULL,	OPT_TEST_OUTFMT  },
 	{ "test-broadcast",	no_argument,		NULL,	OPT_TEST_BROADCAST},
+	{ "test-clients",	required_argument,	NULL,	OPT_TEST_CLIENTS },
 
 	{ NULL,			no_argument,		NULL,	0 }
 };
@@ -138,6 +142,7 @@ main(int argc, char **argv)
 				"       --test-output  <output file name>\n"
 				"       --test-format  <leaseinfo|lease-xml>\n"
 				"       --test-broadcast\n"
+				"       --test-clients <count> (load generation mode)\n"
 				, program_name);
 			return status;
 
@@ -225,6 +230,13 @@ main(int argc, char **argv)
 				goto usage;
 			tester->broadcast = NI_TRISTATE_ENABLE;
 			break;
+
+		case OPT_TEST_CLIENTS:
+			if (!tester || ni_parse_uint(optarg,
+						&tester->clients, 0) < 0 ||
+					!tester->clients)
+				goto usage;
+			break;
 		}
 	}
 
@@ -345,8 +357,63 @@ dhcp4_recover_lease(ni_netdev_t *ifp)
 /*
  * Functions to support the DHCP4 DBus binding
  */
+
+/*
+ * org.opensuse.Network.DHCP4.getLeaseStatus()
+ *
+ * Bulk lease status query: returns one (index, name, state, uuid,
+ * acquired, expires) dict per device, so that fleet monitoring costs
+ * one dbus round trip instead of one call per interface.
+ */
+static dbus_bool_t
+dhcp4_get_lease_status(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	const ni_dhcp4_device_t *dev;
+	dbus_bool_t rv;
+
+	ni_dbus_dict_array_init(&result);
+	for (dev = ni_dhcp4_active; dev; dev = dev->next) {
+		ni_dbus_variant_t *dict;
+
+		if (!(dict = ni_dbus_dict_array_add(&result)))
+			break;
+
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_uint32(dict, "index", dev->link.ifindex);
+		ni_dbus_dict_add_string(dict, "name", dev->ifname);
+		ni_dbus_dict_add_string(dict, "state",
+				ni_dhcp4_fsm_state_name(dev->fsm.state));
+		if (dev->lease) {
+			uint64_t expires = 0;
+
+			/* expires 0 for an infinite lease time */
+			if (dev->lease->dhcp4.lease_time != NI_LIFETIME_INFINITE)
+				expires = (uint64_t)dev->lease->acquired.tv_sec +
+						dev->lease->dhcp4.lease_time;
+
+			ni_dbus_dict_add_uuid(dict, "uuid", &dev->lease->uuid);
+			ni_dbus_dict_add_uint64(dict, "acquired",
+					dev->lease->acquired.tv_sec);
+			ni_dbus_dict_add_uint64(dict, "expires", expires);
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+static ni_dbus_method_t		__ni_objectmodel_dhcp4_methods[] = {
+	{ "getLeaseStatus",	"",		.handler = dhcp4_get_lease_status },
+	{ NULL }
+};
+
 static ni_dbus_service_t	__ni_objectmodel_dhcp4_interface = {
 	.name		= NI_OBJECTMODEL_DHCP4_INTERFACE,
+	.methods	= __ni_objectmodel_dhcp4_methods,
 };
 
 
@@ -469,6 +536,10 @@ dhcp4_supplicant(void)
 	if (ni_server_enable_interface_addr_events(NULL) < 0)
 		ni_fatal("unable to initialize netlink addr listener");
 
+	/* don't wake up for address events until we manage a device;
+	 * ni_dhcp4_device_set_config() maintains the filter from then on */
+	ni_server_filter_interface_addr_events(TRUE, NULL, 0);
+
 	if (!opt_foreground) {
 		ni_daemon_close_t close_flags = NI_DAEMON_CLOSE_STD;
 
@@ -479,6 +550,10 @@ dhcp4_supplicant(void)
 			ni_fatal("unable to background server");
 	}
 
+	/* worker pool for blocking syscall offload; started after the
+	 * daemonizing fork, as threads do not survive it */
+	ni_workqueue_init(0);
+
 	if (opt_recover_state)
 		dhcp4_recover_state(opt_state_file);
 
@@ -592,7 +667,17 @@ dhcp4_protocol_event(enum ni_dhcp4_event ev, const ni_dhcp4_device_t *dev, ni_ad
 	var = &argv[argc++];
 	ni_dbus_variant_init_dict(var);
 	if (lease) {
-		if (!ni_objectmodel_get_addrconf_lease(lease, var)) {
+		ni_bool_t ok;
+
+		if (ev == NI_DHCP4_EVENT_ACQUIRED && ni_config_differential_lease_updates()) {
+			ok = ni_objectmodel_get_addrconf_lease_diff(lease, var,
+					ni_dbus_object_get_path(dev_object));
+		} else {
+			ni_objectmodel_addrconf_lease_diff_forget(
+					ni_dbus_object_get_path(dev_object));
+			ok = ni_objectmodel_get_addrconf_lease(lease, var);
+		}
+		if (!ok) {
 			ni_warn("%s: could not extract lease data", __func__);
 			goto done;
 		}
@@ -38,8 +38,11 @@
 #include <wicked/logging.h>
 #include <wicked/objectmodel.h>
 
+#include "workqueue.h"
+#include "appconfig.h"
 #include "dhcp6/dbus-api.h"
 #include "dhcp6/device.h"
+#include "dhcp6/fsm.h"
 #include "dhcp6/tester.h"
 #include "netinfo_priv.h"
 #include "duid.h"
@@ -65,6 +68,7 @@ enum {
 	OPT_TEST_REQUEST,
 	OPT_TEST_OUTPUT,
 	OPT_TEST_OUTFMT,
+	OPT_TEST_CLIENTS,
 };
 
 static struct option		options[] = {
@@ -90,6 +94,7 @@ static struct option		options[] = {
 	{ "test-timeout",	required_argument,	NULL,	OPT_TEST_TIMEOUT },
 	{ "test-output",	required_argument,	NULL,	OPT_TEST_OUTPUT  },
 	{ "test-format",	required_argument,	NULL,	OPT_TEST_OUTFMT  },
+	{ "test-clients",	required_argument,	NULL,	OPT_TEST_CLIENTS },
 	{ NULL,			no_argument,		NULL,	0 }
 };
 
@@ -154,6 +159,7 @@ main(int argc, char **argv)
 				"       --test-timeout <timeout in sec> (default: 20+10)\n"
 				"       --test-output  <output file name>\n"
 				"       --test-format  <leaseinfo|lease-xml>\n"
+				"       --test-clients <count> (load generation mode)\n"
 				, program_name
 			       );
 			return status;
@@ -243,6 +249,13 @@ main(int argc, char **argv)
 						&tester->outfmt))
 				goto usage;
 			break;
+
+		case OPT_TEST_CLIENTS:
+			if (!tester || ni_parse_uint(optarg,
+						&tester->clients, 0) < 0 ||
+					!tester->clients)
+				goto usage;
+			break;
 		}
 	}
 
@@ -306,8 +319,78 @@ main(int argc, char **argv)
 /*
  * Functions to support the DHCP6 DBus binding
  */
+/*
+ * org.opensuse.Network.DHCP6.getLeaseStatus()
+ *
+ * Bulk lease status query: returns one (index, name, state, uuid,
+ * acquired, expires) dict per device, so that fleet monitoring costs
+ * one dbus round trip instead of one call per interface.
+ */
+static dbus_bool_t
+dhcp6_get_lease_status(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	const ni_dhcp6_device_t *dev;
+	dbus_bool_t rv;
+
+	ni_dbus_dict_array_init(&result);
+	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
+		ni_dbus_variant_t *dict;
+
+		if (!(dict = ni_dbus_dict_array_add(&result)))
+			break;
+
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_uint32(dict, "index", dev->link.ifindex);
+		ni_dbus_dict_add_string(dict, "name", dev->ifname);
+		ni_dbus_dict_add_string(dict, "state",
+				ni_dhcp6_fsm_state_name(dev->fsm.state));
+		if (dev->lease) {
+			const ni_dhcp6_ia_t *ia;
+			const ni_dhcp6_ia_addr_t *iadr;
+			uint64_t expires = 0;
+			ni_bool_t infinite = FALSE;
+
+			/* the lease lasts until its last address expires;
+			 * expires 0 for an infinite valid lifetime */
+			for (ia = dev->lease->dhcp6.ia_list; ia; ia = ia->next) {
+				for (iadr = ia->addrs; iadr; iadr = iadr->next) {
+					uint64_t end;
+
+					if (iadr->valid_lft == NI_LIFETIME_INFINITE) {
+						infinite = TRUE;
+						continue;
+					}
+					end = (uint64_t)ia->acquired.tv_sec +
+							iadr->valid_lft;
+					if (end > expires)
+						expires = end;
+				}
+			}
+
+			ni_dbus_dict_add_uuid(dict, "uuid", &dev->lease->uuid);
+			ni_dbus_dict_add_uint64(dict, "acquired",
+					dev->lease->acquired.tv_sec);
+			ni_dbus_dict_add_uint64(dict, "expires",
+					infinite ? 0 : expires);
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+static ni_dbus_method_t		__ni_objectmodel_dhcp6_root_methods[] = {
+	{ "getLeaseStatus",	"",		.handler = dhcp6_get_lease_status },
+	{ NULL }
+};
+
 static ni_dbus_service_t	__ni_objectmodel_dhcp6_interface = {
 	.name			= NI_OBJECTMODEL_DHCP6_INTERFACE,	/* org.opensuse.Network.DHCP6 */
+	.methods		= __ni_objectmodel_dhcp6_root_methods,
 };
 
 static void			dhcp6_discover_devices(ni_dbus_server_t *);
@@ -455,6 +538,10 @@ dhcp6_supplicant(void)
 			ni_fatal("Unable to background server");
 	}
 
+	/* worker pool for blocking syscall offload; started after the
+	 * daemonizing fork, as threads do not survive it */
+	ni_workqueue_init(0);
+
 	if (opt_recover_state)
 		dhcp6_recover_state(opt_state_file);
 
@@ -616,7 +703,17 @@ dhcp6_protocol_event(enum ni_dhcp6_event ev, const ni_dhcp6_device_t *dev, ni_ad
 	var = &argv[argc++];
 	ni_dbus_variant_init_dict(var);
 	if (lease) {
-		if (!ni_objectmodel_get_addrconf_lease(lease, var)) {
+		ni_bool_t ok;
+
+		if (ev == NI_DHCP6_EVENT_ACQUIRED && ni_config_differential_lease_updates()) {
+			ok = ni_objectmodel_get_addrconf_lease_diff(lease, var,
+					ni_dbus_object_get_path(dev_object));
+		} else {
+			ni_objectmodel_addrconf_lease_diff_forget(
+					ni_dbus_object_get_path(dev_object));
+			ok = ni_objectmodel_get_addrconf_lease(lease, var);
+		}
+		if (!ok) {
 			ni_warn("%s(%s): could not extract lease data",
 				__func__, dev->ifname);
 			goto done;
@@ -226,10 +226,24 @@ ni_addrconf_lease_is_valid(const ni_addrconf_lease_t *lease)
 	return lease && lease->state == NI_ADDRCONF_STATE_GRANTED;
 }
 
+/*
+ * Durability policy for lease file commits
+ */
+typedef enum {
+	NI_LEASE_FILE_FSYNC_NEVER = 0,	/* rely on temp file plus rename only */
+	NI_LEASE_FILE_FSYNC_DEADLINE,	/* sync deferred (coalesced) flushes  */
+	NI_LEASE_FILE_FSYNC_ALWAYS,	/* sync every lease commit            */
+} ni_lease_file_fsync_t;
+
 extern int		ni_addrconf_lease_file_write(const char *, ni_addrconf_lease_t *);
 extern ni_addrconf_lease_t *ni_addrconf_lease_file_read(const char *, int, int);
 extern ni_bool_t	ni_addrconf_lease_file_exists(const char *, int, int);
 extern void		ni_addrconf_lease_file_remove(const char *, int, int);
+extern void		ni_addrconf_lease_file_flush(void);
+extern void		ni_addrconf_lease_file_set_flush_delay(unsigned int);
+extern void		ni_addrconf_lease_file_set_fsync(ni_lease_file_fsync_t);
+extern ni_bool_t	ni_addrconf_lease_file_set_fsync_policy(const char *);
+extern void		ni_addrconf_lease_file_set_journal(ni_bool_t);
 
 extern int		ni_addrconf_lease_to_xml(const ni_addrconf_lease_t *, xml_node_t **, const char *);
 extern int		ni_addrconf_lease_from_xml(ni_addrconf_lease_t **, const xml_node_t *, const char *);
@@ -63,6 +63,18 @@ typedef struct ni_address_array {
 
 #define NI_ADDRESS_ARRAY_INIT	{ .count = 0, .data = NULL }
 
+/*
+ * Hashed lookup index over an address list, keyed by local address.
+ * Used to reconcile a kernel address dump against a device's address
+ * list without rescanning the list for every message. The index holds
+ * references; destroying it leaves the list untouched.
+ */
+#define NI_ADDRESS_INDEX_NBUCKETS	64
+
+typedef struct ni_address_index {
+	ni_address_array_t	buckets[NI_ADDRESS_INDEX_NBUCKETS];
+} ni_address_index_t;
+
 extern ni_bool_t	ni_sockaddr_is_ipv4_loopback(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_is_ipv4_linklocal(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_is_ipv4_broadcast(const ni_sockaddr_t *);
@@ -146,6 +158,12 @@ extern void		ni_address_list_dedup(ni_address_t **);
 extern ni_address_t *	ni_address_list_find(ni_address_t *, const ni_sockaddr_t *);
 extern unsigned int	ni_address_list_count(ni_address_t *list);
 
+extern void		ni_address_index_init(ni_address_index_t *);
+extern void		ni_address_index_build(ni_address_index_t *, ni_address_t *);
+extern ni_bool_t	ni_address_index_insert(ni_address_index_t *, ni_address_t *);
+extern ni_address_t *	ni_address_index_find(ni_address_index_t *, const ni_sockaddr_t *);
+extern void		ni_address_index_destroy(ni_address_index_t *);
+
 extern void		ni_address_array_init(ni_address_array_t *);
 extern void		ni_address_array_destroy(ni_address_array_t *);
 extern ni_bool_t	ni_address_array_append(ni_address_array_t *, ni_address_t *);
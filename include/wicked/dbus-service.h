@@ -41,6 +41,7 @@ struct ni_dbus_property	{
 			uint64_t *	uint64_offset;
 			double *	double_offset;
 			char **		string_offset;
+			const char **	refstr_offset;
 			ni_string_array_t *string_array_offset;
 			ni_uuid_t *	uuid_offset;
 			const ni_dbus_property_t *dict_children;
@@ -115,6 +116,12 @@ extern dbus_bool_t		ni_dbus_generic_property_set_string(ni_dbus_object_t *, cons
 					const ni_dbus_variant_t *, DBusError *);
 extern dbus_bool_t		ni_dbus_generic_property_parse_string(const ni_dbus_property_t *,
 					ni_dbus_variant_t *, const char *);
+extern dbus_bool_t		ni_dbus_generic_property_get_refstr(const ni_dbus_object_t *, const ni_dbus_property_t *,
+					ni_dbus_variant_t *r, DBusError *);
+extern dbus_bool_t		ni_dbus_generic_property_set_refstr(ni_dbus_object_t *, const ni_dbus_property_t *,
+					const ni_dbus_variant_t *, DBusError *);
+extern dbus_bool_t		ni_dbus_generic_property_parse_refstr(const ni_dbus_property_t *,
+					ni_dbus_variant_t *, const char *);
 extern dbus_bool_t		ni_dbus_generic_property_get_string_array(const ni_dbus_object_t *, const ni_dbus_property_t *,
 					ni_dbus_variant_t *r, DBusError *);
 extern dbus_bool_t		ni_dbus_generic_property_set_string_array(ni_dbus_object_t *, const ni_dbus_property_t *,
@@ -205,6 +212,8 @@ extern dbus_bool_t		ni_dbus_generic_property_parse_string_array(const ni_dbus_pr
 			dbus_name, uuid, member_name, rw)
 #define NI_DBUS_GENERIC_STRING_PROPERTY(struct_name, dbus_name, member_name, rw) \
 	__NI_DBUS_GENERIC_PROPERTY(struct_name, DBUS_TYPE_STRING_AS_STRING, dbus_name, string, member_name, rw)
+#define NI_DBUS_GENERIC_REFSTR_PROPERTY(struct_name, dbus_name, member_name, rw) \
+	__NI_DBUS_GENERIC_PROPERTY(struct_name, DBUS_TYPE_STRING_AS_STRING, dbus_name, refstr, member_name, rw)
 #define NI_DBUS_GENERIC_STRING_ARRAY_PROPERTY(struct_name, dbus_name, member_name, rw) \
 	__NI_DBUS_GENERIC_PROPERTY(struct_name, \
 			DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_STRING_AS_STRING, \
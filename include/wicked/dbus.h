@@ -58,6 +58,11 @@ struct ni_dbus_variant {
 		ni_dbus_variant_t *struct_value;
 	};
 
+	/* If set, string_value points into the message referenced by
+	 * __message below and must not be freed. Set by the message
+	 * deserializer to avoid copying large string arguments. */
+	dbus_bool_t		__string_ref;
+
 	ni_dbus_message_t *	__message;
 };
 
@@ -131,19 +136,25 @@ struct ni_dbus_class {
 
 extern const ni_dbus_class_t	ni_dbus_anonymous_class;
 
+typedef struct ni_dbus_object_hash ni_dbus_object_hash_t;
+
 struct ni_dbus_object {
 	ni_dbus_object_t **	pprev;
 	ni_dbus_object_t *	next;
 	ni_dbus_object_t *	parent;
 
 	ni_bool_t		stale;		/* used by GetManagedObjects client code */
+	ni_bool_t		lazy_bind;	/* bind interfaces on first access */
 
 	const ni_dbus_class_t *	class;
 	char *			name;		/* relative path */
 	char *			path;		/* absolute path */
 	void *			handle;		/* local object */
 	ni_dbus_object_t *	children;
+	ni_dbus_object_hash_t *	child_hash;	/* hashed child lookup by name, see dbus-object.c */
 	const ni_dbus_service_t **interfaces;
+	ni_bool_t		interfaces_shared; /* interfaces points to a per-class table */
+	char *			introspect_xml;	/* cached Introspect() reply */
 
 	ni_dbus_server_object_t *server_object;
 	ni_dbus_client_object_t *client_object;
@@ -151,6 +162,9 @@ struct ni_dbus_object {
 
 typedef void			ni_dbus_async_callback_t(ni_dbus_object_t *proxy,
 					ni_dbus_message_t *reply);
+typedef void			ni_dbus_async_data_callback_t(ni_dbus_object_t *proxy,
+					ni_dbus_message_t *reply,
+					void *user_data);
 typedef void			ni_dbus_signal_handler_t(ni_dbus_connection_t *connection,
 					ni_dbus_message_t *signal_msg,
 					void *user_data);
@@ -176,6 +190,8 @@ extern ni_dbus_object_t *	ni_dbus_object_create(ni_dbus_object_t *root_object,
 					const ni_dbus_class_t *class,
 					void *handle);
 extern ni_dbus_object_t *	ni_dbus_object_lookup(ni_dbus_object_t *root_object, const char *path);
+extern void			ni_dbus_object_set_lazy_binder(void (*)(ni_dbus_object_t *));
+extern void			ni_dbus_object_bind_interfaces(ni_dbus_object_t *);
 extern ni_dbus_object_t *	ni_dbus_object_find_descendant_by_handle(const ni_dbus_object_t *, const void *);
 extern dbus_bool_t		ni_dbus_object_isa(const ni_dbus_object_t *, const ni_dbus_class_t *);
 extern dbus_bool_t		ni_dbus_object_register_service(ni_dbus_object_t *object,
@@ -225,6 +241,7 @@ extern void			ni_dbus_variant_copy(ni_dbus_variant_t *dst,
 extern void			ni_dbus_variant_destroy(ni_dbus_variant_t *);
 extern const char *		ni_dbus_variant_sprint(const ni_dbus_variant_t *);
 extern const char *		ni_dbus_variant_signature(const ni_dbus_variant_t *);
+extern uint32_t			ni_dbus_variant_csum(uint32_t, const ni_dbus_variant_t *);
 extern void			ni_dbus_variant_set_string(ni_dbus_variant_t *, const char *);
 extern void			ni_dbus_variant_set_object_path(ni_dbus_variant_t *, const char *);
 extern void			ni_dbus_variant_set_bool(ni_dbus_variant_t *, dbus_bool_t);
@@ -372,6 +389,10 @@ extern int			ni_dbus_object_call_simple(const ni_dbus_object_t *,
 					int res_type, void *res_ptr);
 extern int			ni_dbus_object_call_async(ni_dbus_object_t *obj,
 					ni_dbus_async_callback_t *callback, const char *method, ...);
+extern int			ni_dbus_object_call_variant_async(ni_dbus_object_t *obj,
+					const char *interface, const char *method,
+					unsigned int nargs, const ni_dbus_variant_t *args,
+					ni_dbus_async_data_callback_t *callback, void *user_data);
 
 extern ni_dbus_message_t *	ni_dbus_object_call_new(const ni_dbus_object_t *, const char *method, ...);
 extern ni_dbus_message_t *	ni_dbus_object_call_new_va(const ni_dbus_object_t *obj,
@@ -379,6 +400,9 @@ extern ni_dbus_message_t *	ni_dbus_object_call_new_va(const ni_dbus_object_t *ob
 
 extern dbus_bool_t		ni_dbus_object_get_managed_objects(ni_dbus_object_t *, DBusError *, ni_bool_t purge);
 extern dbus_bool_t		ni_dbus_object_refresh_properties(ni_dbus_object_t *, const ni_dbus_service_t *, DBusError *);
+extern int			ni_dbus_object_refresh_properties_async(ni_dbus_object_t *,
+						const ni_dbus_service_t *,
+						ni_dbus_async_data_callback_t *, void *user_data);
 extern dbus_bool_t		ni_dbus_object_send_property(ni_dbus_object_t *proxy,
 					const char *service_name,
 					const char *property_name,
@@ -425,11 +449,17 @@ extern dbus_bool_t		ni_dbus_xml_serialize_arg(const ni_dbus_method_t *, unsigned
 						ni_dbus_variant_t *, xml_node_t *);
 extern dbus_bool_t		ni_dbus_xml_method_has_return(const ni_dbus_method_t *);
 extern int			ni_dbus_serialize_return(const ni_dbus_method_t *, ni_dbus_variant_t *, xml_node_t *);
+extern int			ni_dbus_serialize_return_message(const ni_dbus_method_t *, ni_dbus_message_t *,
+						xml_node_t *);
 extern void			ni_dbus_serialize_error(DBusError *, xml_node_t *);
 extern xml_node_t *		ni_dbus_xml_deserialize_arguments(const ni_dbus_method_t *method,
 						unsigned int nvars, const ni_dbus_variant_t *vars,
 						xml_node_t *parent,
 						ni_tempstate_t *);
+extern xml_node_t *		ni_dbus_xml_deserialize_arguments_message(const ni_dbus_method_t *method,
+						ni_dbus_message_t *msg,
+						xml_node_t *parent,
+						ni_tempstate_t *);
 extern xml_node_t *		ni_dbus_xml_deserialize_properties(ni_xs_scope_t *, const char *,
 						ni_dbus_variant_t *, xml_node_t *);
 extern int			ni_dbus_xml_serialize_properties(ni_xs_scope_t *, ni_dbus_variant_t *, xml_node_t *);
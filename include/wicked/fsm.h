@@ -8,6 +8,8 @@
 #ifndef __CLIENT_FSM_H__
 #define __CLIENT_FSM_H__
 
+#include <sys/time.h>
+
 #include <wicked/socket.h>	/* needed for ni_timer_t */
 #include <wicked/secret.h>
 #include <wicked/objectmodel.h>
@@ -47,6 +49,8 @@ typedef enum ni_config_origin_prio {
 #define NI_IFWORKER_DEFAULT_TIMEOUT	30000
 #define NI_IFWORKER_INFINITE_TIMEOUT	((unsigned int) -1)
 
+#define NI_FSM_DEFAULT_WORKER_BUDGET	64	/* max transitions in flight, 0 is unlimited */
+
 typedef struct ni_fsm		ni_fsm_t;
 typedef struct ni_ifworker	ni_ifworker_t;
 typedef struct ni_fsm_require	ni_fsm_require_t;
@@ -100,6 +104,12 @@ struct ni_fsm_transition {
 		ni_bool_t		parsed;
 		ni_fsm_require_t *	list;
 	} require;
+
+	/* wall clock time the transition was fired and completed */
+	struct {
+		struct timeval		started;
+		struct timeval		finished;
+	} timing;
 };
 
 typedef enum {
@@ -242,6 +252,7 @@ struct ni_fsm {
 	ni_ifworker_array_t	pending;
 	ni_ifworker_array_t	workers;
 	unsigned int		worker_timeout;
+	unsigned int		worker_budget;
 	ni_bool_t		readonly;
 
 	unsigned int		timeout_count;
@@ -255,6 +266,9 @@ struct ni_fsm {
 	} process_event;
 
 	ni_fsm_policy_t *	policies;
+	ni_fsm_policy_t **	policy_hash;	/* policies indexed by name */
+
+	uint32_t		netif_event_seqno; /* resume token for InterfaceList.getEventsSince */
 
 	ni_dbus_object_t *	client_root_object;
 };
@@ -299,6 +313,11 @@ extern ni_bool_t		ni_fsm_policies_changed_since(const ni_fsm_t *, unsigned int *
 extern ni_dbus_client_t *	ni_fsm_create_client(ni_fsm_t *);
 extern ni_bool_t		ni_fsm_refresh_state(ni_fsm_t *);
 extern unsigned int		ni_fsm_schedule(ni_fsm_t *);
+extern void			ni_fsm_print_timings(const ni_fsm_t *, const ni_ifworker_array_t *);
+extern void			ni_fsm_trace_enable(void);
+extern ni_bool_t		ni_fsm_trace_enabled(void);
+extern void			ni_fsm_trace_record(const char *, const char *, const char *, ...);
+extern void			ni_fsm_print_trace(void);
 extern ni_bool_t		ni_fsm_do(ni_fsm_t *fsm, long *timeout_p);
 extern void			ni_fsm_mainloop(ni_fsm_t *);
 extern void			ni_fsm_set_process_event_callback(ni_fsm_t *, void (*)(ni_fsm_t *, ni_ifworker_t *, ni_fsm_event_t *), void *);
@@ -35,5 +35,7 @@ extern void	ni_leaseinfo_remove(const char *, const ni_addrconf_mode_t,
 				const unsigned int);
 extern void	ni_leaseinfo_dump(FILE *, const ni_addrconf_lease_t *,
 				const char *, const char *);
+extern void	ni_leaseinfo_json_dump(FILE *, const ni_addrconf_lease_t *,
+				const char *, const char *);
 
 #endif /* __WICKED_LEASEINFO_H__ */
@@ -7,6 +7,8 @@
 #ifndef __WICKED_LINKSTATS_H__
 #define __WICKED_LINKSTATS_H__
 
+#include <sys/time.h>
+
 struct ni_link_stats {
 	unsigned long		rx_packets;		/* total packets received	*/
 	unsigned long		tx_packets;		/* total packets transmitted	*/
@@ -39,4 +41,23 @@ struct ni_link_stats {
 	unsigned long		tx_compressed;
 };
 
+/*
+ * Ring of the most recent statistics samples per interface.
+ * Samples are recorded whenever the kernel reports interface
+ * statistics via rtnetlink, i.e. they arrive for free with every
+ * link refresh or event - no extra syscalls are needed.
+ */
+#define NI_LINK_STATS_RING_SIZE		16
+
+struct ni_link_stats_sample {
+	struct timeval		when;
+	struct ni_link_stats	stats;
+};
+
+struct ni_link_stats_ring {
+	unsigned int		head;		/* next slot to write	*/
+	unsigned int		count;		/* valid samples	*/
+	struct ni_link_stats_sample samples[NI_LINK_STATS_RING_SIZE];
+};
+
 #endif /* __WICKED_LINKSTATS_H__ */
@@ -39,6 +39,7 @@ extern unsigned int	ni_log_level_get(void);
 extern ni_bool_t	ni_log_destination(const char *program, const char *destination);
 extern void		ni_log_reopen(void);
 extern void		ni_log_close(void);
+extern void		ni_log_flush(void);
 
 enum {
 	NI_LOG_ERROR,
@@ -81,8 +82,16 @@ extern unsigned int	ni_log_level;
 #define ni_log_level_at(level)			(ni_log_level >= (level))
 #define ni_log_facility(facility)		(ni_debug & (facility))
 
+#ifdef __GNUC__
+# define __ni_log_unlikely(x)			__builtin_expect(!!(x), 0)
+#else
+# define __ni_log_unlikely(x)			(x)
+#endif
+
+/* Debug messages compile down to one predicted-untaken branch when the
+ * level or facility is disabled; the arguments are not evaluated. */
 #define ni_debug_guard(level, facility) \
-	(ni_log_level_at(level) && ni_log_facility(facility))
+	__ni_log_unlikely(ni_log_level_at(level) && ni_log_facility(facility))
 
 #define __ni_debug(level, facility, fmt, args...) \
 	do { \
@@ -18,6 +18,8 @@
 #include "client/client_state.h"
 
 typedef struct ni_link_stats	ni_link_stats_t;
+typedef struct ni_link_stats_sample ni_link_stats_sample_t;
+typedef struct ni_link_stats_ring ni_link_stats_ring_t;
 
 typedef struct ni_slaveinfo	ni_slaveinfo_t;
 struct ni_slaveinfo {
@@ -50,23 +52,32 @@ struct ni_linkinfo {
 
 	unsigned int		saved_mtu;
 
+	/* digest of the last seen IFLA_INFO_DATA payload, so the
+	 * type detail re-parse can be skipped for stable devices */
+	unsigned int		infodata_len;
+	unsigned int		infodata_csum;
+
 	ni_link_stats_t *	stats;
+	ni_link_stats_ring_t *	stats_ring;
 };
 
 struct ni_netdev {
+	/* Fields touched on every event dispatch and refresh come first,
+	 * so they share the leading cache lines; the per-linktype data
+	 * below is only dereferenced when the device is actually of that
+	 * type. */
 	ni_netdev_t *		next;
 	unsigned int		seq;
 	unsigned int		modified : 1,
 				deleted : 1,
-				created : 1;
+				created : 1,
+				bridge_stale : 1,	/* deep discovery deferred */
+				team_stale : 1;		/* deep discovery deferred */
+	unsigned int		users;
 
 	char *			name;
 	ni_linkinfo_t		link;
 
-	ni_client_state_t *	client_state;
-
-	unsigned int		users;
-
 	ni_address_t *		addrs;
 	ni_route_table_t *	routes;
 
@@ -78,6 +89,10 @@ struct ni_netdev {
 	/* Assigned leases */
 	ni_addrconf_lease_t *	leases;
 
+	ni_event_filter_t *	event_filter;
+
+	ni_client_state_t *	client_state;
+
 	/* link layer info specific to different device types. */
 	ni_team_t *		team;
 	ni_bonding_t *		bonding;
@@ -100,8 +115,6 @@ struct ni_netdev {
 
 	ni_pci_dev_t *		pci_dev;
 	ni_ethtool_t *		ethtool;
-
-	ni_event_filter_t *	event_filter;
 };
 
 typedef struct ni_netdev_port_req	ni_netdev_port_req_t;
@@ -138,6 +151,9 @@ extern int		ni_server_enable_interface_prefix_events(void (*handler)(ni_netdev_t
 extern int		ni_server_enable_interface_nduseropt_events(void (*handler)(ni_netdev_t *, ni_event_t));
 extern int		ni_server_enable_route_events(void (*handler)(ni_netconfig_t *, ni_event_t, const ni_route_t *));
 extern int		ni_server_enable_rule_events(void (*handler)(ni_netconfig_t *, ni_event_t, const ni_rule_t *));
+extern void		ni_server_set_event_coalescing(unsigned int msec);
+extern ni_bool_t	ni_server_filter_interface_addr_events(ni_bool_t enable,
+					const unsigned int *ifindices, unsigned int count);
 extern int		ni_server_enable_interface_uevents(void);
 extern void		ni_server_disable_interface_uevents(void);
 extern void		ni_server_trace_interface_addr_events(ni_netdev_t *, ni_event_t, const ni_address_t *);
@@ -223,6 +239,8 @@ extern void		ni_netdev_set_ethtool(ni_netdev_t *, ni_ethtool_t *);
 extern void		ni_netdev_set_ethernet(ni_netdev_t *, ni_ethernet_t *);
 extern void		ni_netdev_set_infiniband(ni_netdev_t *, ni_infiniband_t *);
 extern void		ni_netdev_set_link_stats(ni_netdev_t *, ni_link_stats_t *);
+extern void		ni_link_stats_ring_record(ni_link_stats_ring_t **, const ni_link_stats_t *);
+extern const ni_link_stats_sample_t *ni_link_stats_ring_get(const ni_link_stats_ring_t *, unsigned int);
 extern void		ni_netdev_set_wireless(ni_netdev_t *, ni_wireless_t *);
 extern void		ni_netdev_set_openvpn(ni_netdev_t *, ni_openvpn_t *);
 extern void		ni_netdev_set_tuntap(ni_netdev_t *, ni_tuntap_t *);
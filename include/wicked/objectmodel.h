@@ -68,6 +68,7 @@ extern ni_dbus_class_t *	ni_objectmodel_class_new(const char *, const ni_dbus_cl
 #define NI_OBJECTMODEL_MANAGED_POLICY_LIST_PATH	NI_OBJECTMODEL_OBJECT_ROOT "/Nanny/Policy"
 
 #define NI_OBJECTMODEL_INTERFACE		NI_OBJECTMODEL_NAMESPACE
+#define NI_OBJECTMODEL_STATS_INTERFACE		NI_OBJECTMODEL_INTERFACE ".Stats"
 #define NI_OBJECTMODEL_NETIFLIST_INTERFACE	NI_OBJECTMODEL_INTERFACE ".InterfaceList"
 #define NI_OBJECTMODEL_NETIF_INTERFACE		NI_OBJECTMODEL_INTERFACE ".Interface"
 #define NI_OBJECTMODEL_ETHTOOL_INTERFACE	NI_OBJECTMODEL_INTERFACE ".Ethtool"
@@ -112,6 +113,16 @@ extern ni_dbus_class_t *	ni_objectmodel_class_new(const char *, const ni_dbus_cl
 #define NI_OBJECTMODEL_LEASE_DEFERRED_SIGNAL	"LeaseDeferred"
 #define NI_OBJECTMODEL_LEASE_LOST_SIGNAL	"LeaseLost"
 
+/*
+ * Meta entries in a differential lease update dict. A complete dict
+ * carries diff-seqno only; a differential dict additionally carries
+ * diff-base (the seqno it applies on top of) and optionally the list
+ * of top-level entries that disappeared since then.
+ */
+#define NI_OBJECTMODEL_LEASE_DIFF_SEQNO		"diff-seqno"
+#define NI_OBJECTMODEL_LEASE_DIFF_BASE		"diff-base"
+#define NI_OBJECTMODEL_LEASE_DIFF_REMOVED	"diff-removed"
+
 extern const ni_dbus_class_t	ni_objectmodel_netif_class;
 extern const ni_dbus_class_t	ni_objectmodel_addrconf_device_class;
 
@@ -129,6 +140,9 @@ extern dbus_bool_t		ni_objectmodel_bind_compatible_interfaces(ni_dbus_object_t *
 
 extern dbus_bool_t		ni_objectmodel_get_addrconf_lease(const ni_addrconf_lease_t *, ni_dbus_variant_t *);
 extern dbus_bool_t		ni_objectmodel_set_addrconf_lease(ni_addrconf_lease_t *, const ni_dbus_variant_t *);
+extern dbus_bool_t		ni_objectmodel_get_addrconf_lease_diff(const ni_addrconf_lease_t *,
+						ni_dbus_variant_t *, const char *);
+extern void			ni_objectmodel_addrconf_lease_diff_forget(const char *);
 
 extern dbus_bool_t		ni_objectmodel_netif_client_state_to_dict(const ni_client_state_t *, ni_dbus_variant_t *);
 extern dbus_bool_t		ni_objectmodel_netif_client_state_control_to_dict(const ni_client_state_control_t *, ni_dbus_variant_t *);
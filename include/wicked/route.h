@@ -91,6 +91,7 @@ typedef struct ni_route_array	ni_route_array_t;
 struct ni_route_array {
 	unsigned int		count;
 	ni_route_t **		data;
+	struct ni_route_dest_index *index;	/* destination hash, see route.c */
 };
 
 struct ni_route_table {
@@ -162,6 +163,23 @@ typedef struct ni_rule_array  {
 	ni_rule_t **		data;
 } ni_rule_array_t;
 
+/*
+ * Bounded-memory summary of foreign routes: a count plus an
+ * open-addressed set of destination fingerprints, sufficient for
+ * conflict checks without storing a ni_route_t per kernel route.
+ */
+typedef struct ni_route_foreign_slot {
+	uint32_t		fp;		/* fingerprint, 0 is empty	*/
+	uint32_t		refs;		/* routes behind fingerprint	*/
+} ni_route_foreign_slot_t;
+
+struct ni_route_foreign_set {
+	unsigned int		count;		/* routes summarized		*/
+	unsigned int		used;		/* slots taken, incl. tombstones*/
+	unsigned int		size;		/* allocated slots, power of two*/
+	ni_route_foreign_slot_t *slots;
+};
+
 
 typedef int			ni_route_cmp_fn(const ni_route_t *, const ni_route_t *);
 
@@ -283,6 +301,14 @@ extern ni_bool_t		ni_route_tables_empty(const ni_route_table_t *);
 extern ni_route_table_t *	ni_route_tables_get(ni_route_table_t **, unsigned int);
 extern void			ni_route_tables_destroy(ni_route_table_t **);
 
+extern uint32_t			ni_route_dest_fingerprint(const ni_route_t *);
+extern void			ni_route_foreign_set_init(ni_route_foreign_set_t *);
+extern void			ni_route_foreign_set_reset(ni_route_foreign_set_t *);
+extern void			ni_route_foreign_set_destroy(ni_route_foreign_set_t *);
+extern ni_bool_t		ni_route_foreign_set_add(ni_route_foreign_set_t *, uint32_t);
+extern void			ni_route_foreign_set_del(ni_route_foreign_set_t *, uint32_t);
+extern ni_bool_t		ni_route_foreign_set_test(const ni_route_foreign_set_t *, uint32_t);
+
 extern ni_rule_t *		ni_rule_new(void);
 extern ni_rule_t *		ni_rule_ref(ni_rule_t *);
 extern ni_bool_t		ni_rule_copy(ni_rule_t *, const ni_rule_t *);
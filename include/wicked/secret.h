@@ -23,6 +23,9 @@ struct ni_secret {
 	ni_secret_t **		prev;
 	ni_secret_t *		next;
 
+	ni_secret_t **		hash_pprev;	/* (class, path) hash chain */
+	ni_secret_t *		hash_next;
+
 	unsigned int		refcount;
 	unsigned int		seq;		/* sequence no of last update */
 
@@ -41,6 +44,9 @@ typedef struct ni_secret_db {
 	unsigned int		seq;
 
 	ni_secret_t *		list;
+
+	/* hash index and negative lookup cache, maintained in secret.c */
+	struct ni_secret_index *index;
 } ni_secret_db_t;
 
 extern ni_secret_db_t *	ni_secret_db_new(void);
@@ -38,6 +38,7 @@ extern const ni_timer_t *ni_timer_register(unsigned long, ni_timeout_callback_t
 extern void *		ni_timer_cancel(const ni_timer_t *);
 extern const ni_timer_t *ni_timer_rearm(const ni_timer_t *, unsigned long);
 extern long		ni_timer_next_timeout(void);
+extern void		ni_timer_set_slack(unsigned int msec);
 extern int		ni_timer_get_time(struct timeval *tv);
 
 extern ni_socket_t *	ni_socket_hold(ni_socket_t *);
@@ -31,6 +31,7 @@ typedef struct ni_route		ni_route_t;
 typedef struct ni_route_table	ni_route_table_t;
 typedef struct ni_rule		ni_rule_t;
 typedef struct ni_rule_array	ni_rule_array_t;
+typedef struct ni_route_foreign_set	ni_route_foreign_set_t;
 typedef struct ni_vlan		ni_vlan_t;
 typedef struct ni_vxlan		ni_vxlan_t;
 typedef struct ni_macvlan	ni_macvlan_t;
@@ -72,7 +73,8 @@ typedef struct ni_pci_dev	ni_pci_dev_t;
 
 typedef struct ni_netdev_ref {
 	unsigned int		index;	/* by ifindex */
-	char *			name;	/* by ifname  */
+	const char *		name;	/* by ifname; shared refstr, use
+					 * the ni_netdev_ref_* helpers */
 } ni_netdev_ref_t;
 
 typedef struct ni_dbus_server	ni_dbus_server_t;
@@ -43,6 +43,9 @@ struct ni_var_array {
 	ni_var_array_t *next;
 	unsigned int	count;
 	ni_var_t *	data;
+
+	/* lazily built name lookup index, maintained in util.c */
+	struct ni_var_array_index *index;
 };
 
 #define NI_VAR_ARRAY_INIT	{ .count = 0, .data = NULL }
@@ -74,6 +77,40 @@ typedef struct ni_bitfield {
 
 #define NI_BITFIELD_INIT { 0, NULL, { 0, 0, 0, 0 } }
 
+/*
+ * Arena allocator: chunked bump allocation with bulk reset, for
+ * subsystems creating many short-lived small objects (XML trees,
+ * netlink parsing, dbus marshalling, lease objects).
+ */
+typedef struct ni_arena		ni_arena_t;
+typedef struct ni_arena_chunk	ni_arena_chunk_t;
+
+struct ni_arena {
+	ni_arena_t *		next;		/* global stats list */
+	const char *		name;		/* subsystem tag */
+	size_t			chunk_size;
+	ni_arena_chunk_t *	chunks;		/* current chunk first */
+	ni_arena_chunk_t *	spare;		/* retained across resets */
+
+	struct {
+		uint64_t	allocs;		/* allocations served */
+		uint64_t	bytes;		/* bytes handed out */
+		uint64_t	resets;
+		unsigned int	chunks;		/* currently allocated */
+		size_t		capacity;	/* current chunk bytes */
+		size_t		peak;		/* capacity high water */
+	} stats;
+};
+
+extern void		ni_arena_init(ni_arena_t *, const char *, size_t);
+extern void		ni_arena_destroy(ni_arena_t *);
+extern void *		ni_arena_alloc(ni_arena_t *, size_t);
+extern void *		ni_arena_calloc(ni_arena_t *, size_t);
+extern char *		ni_arena_strdup(ni_arena_t *, const char *);
+extern void		ni_arena_reset(ni_arena_t *);
+extern const ni_arena_t *ni_arena_stats_list(void);
+extern void		ni_arena_stats_log(void);
+
 typedef enum ni_daemon_close {
 	NI_DAEMON_CLOSE_NONE	= 0,
 	NI_DAEMON_CLOSE_IN	= 1,
@@ -98,6 +135,17 @@ extern ni_bool_t	ni_bitfield_isset(const ni_bitfield_t *);
 extern ni_bool_t	ni_bitfield_parse(ni_bitfield_t *, const char *, unsigned int);
 extern ni_bool_t	ni_bitfield_format(const ni_bitfield_t *, char **, ni_bool_t);
 
+/*
+ * Refcounted shared ("atom") strings, interned in a global table.
+ * High-duplication fields such as interface names hold one shared
+ * copy per distinct value; ni_refstr_dup/ni_refstr_free mirror the
+ * ni_string_dup/ni_string_free calling conventions.
+ */
+extern const char *	ni_refstr_get(const char *);
+extern void		ni_refstr_put(const char *);
+extern ni_bool_t	ni_refstr_dup(const char **, const char *);
+extern void		ni_refstr_free(const char **);
+
 extern void		ni_string_free(char **);
 extern void		ni_string_clear(char **);
 extern ni_bool_t	ni_string_dup(char **, const char *);
@@ -144,6 +192,7 @@ extern void		ni_var_array_copy(ni_var_array_t *, const ni_var_array_t *);
 extern void		ni_var_array_move(ni_var_array_t *, ni_var_array_t *);
 extern ni_var_t *	ni_var_array_get(const ni_var_array_t *, const char *name);
 extern void		ni_var_array_set(ni_var_array_t *, const char *name, const char *value);
+extern void		ni_var_array_append(ni_var_array_t *, const char *name, const char *value);
 
 extern int		ni_var_array_get_string(ni_var_array_t *, const char *, char **);
 extern int		ni_var_array_get_uint(ni_var_array_t *, const char *, unsigned int *);
@@ -216,6 +265,7 @@ extern int		ni_parse_boolean(const char *, ni_bool_t *);
 
 extern int		ni_parse_uint_mapped(const char *, const struct ni_intmap *, unsigned int *);
 extern int		ni_parse_uint_maybe_mapped(const char *, const struct ni_intmap *, unsigned int *, int);
+extern void		ni_intmap_index_drop(const struct ni_intmap *);
 
 extern const char *	ni_format_uint_mapped(unsigned int, const ni_intmap_t *);
 extern const char *	ni_format_uint_maybe_mapped(unsigned int, const ni_intmap_t *);
@@ -419,6 +469,7 @@ typedef struct ni_hashctx ni_hashctx_t;
 typedef enum {
 	NI_HASHCTX_MD5	= 1,
 	NI_HASHCTX_SHA1	= 2,
+	NI_HASHCTX_CRC32C = 3,	/* fast content checksum, not for uuids */
 } ni_hashctx_algo_t;
 
 extern ni_hashctx_t *	ni_hashctx_new(ni_hashctx_algo_t algo);
@@ -430,6 +481,13 @@ extern int		ni_hashctx_get_digest(ni_hashctx_t *, void *, size_t);
 extern void		ni_hashctx_put(ni_hashctx_t *, const void *, size_t);
 extern void		ni_hashctx_puts(ni_hashctx_t *, const char *);
 
+/*
+ * One-shot/streaming CRC32C; pass 0 as initial value and feed the
+ * previous result back in to checksum data in several chunks. Uses
+ * the SSE4.2/ARMv8 crc instructions where the CPU has them.
+ */
+extern uint32_t		ni_crc32c(uint32_t, const void *, size_t);
+
 
 /*
  * Sanity check functions
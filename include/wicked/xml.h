@@ -56,6 +56,8 @@ struct xml_node {
 	uint16_t		refcount;
 	uint16_t		final : 1;
 
+	/* interned atom - do not free or assign directly,
+	 * use xml_node_set_name to rename a node */
 	char *			name;
 	struct xml_node *	parent;
 
@@ -65,6 +67,9 @@ struct xml_node {
 	ni_var_array_t		attrs;
 	struct xml_node *	children;
 
+	/* lazily built child-name index for wide nodes, see xml.c */
+	struct xml_child_index *child_index;
+
 	xml_location_t *	location;
 };
 
@@ -86,6 +91,46 @@ extern int		xml_document_hash(const xml_document_t *, ni_hashctx_algo_t, void *,
 extern int		xml_document_uuid(const xml_document_t *, unsigned int, const ni_uuid_t *, ni_uuid_t *);
 extern const char *	xml_document_dtd(const xml_document_t *);
 
+/*
+ * Binary dump/restore of a parsed document; used to cache the schema
+ * files across invocations. See xml-binary.c for the format.
+ */
+extern int		xml_document_write_binary(const xml_document_t *, const char *path);
+extern xml_document_t *	xml_document_read_binary(const char *path);
+extern int		xml_node_write_binary(const xml_node_t *, FILE *);
+extern xml_node_t *	xml_node_read_binary(FILE *, const char *location);
+extern ni_bool_t	xml_binary_sniff(FILE *);
+
+/*
+ * Streaming (callback driven) parse interface. The reader invokes the
+ * callback for each element and cdata blob as it is parsed, without
+ * building a document tree. Use this when scanning large documents for
+ * a few fields, where materializing the full node tree is wasted work.
+ *
+ * For element events, node carries the name and attributes of the
+ * element; it is owned by the reader, has no parent or children, and is
+ * only valid for the duration of the callback. cdata is non-NULL for
+ * XML_STREAM_CDATA events only and refers to the innermost open element.
+ * Returning FALSE from the callback stops the parse early; this is not
+ * treated as an error by the xml_stream_* functions.
+ */
+typedef enum {
+	XML_STREAM_ELEMENT_OPEN,
+	XML_STREAM_CDATA,
+	XML_STREAM_ELEMENT_CLOSE,
+} xml_stream_event_t;
+
+typedef ni_bool_t	xml_stream_callback_t(xml_stream_event_t event,
+				const xml_node_t *node, const char *cdata,
+				void *user_data);
+
+extern ni_bool_t	xml_stream_read(const char *filename,
+				xml_stream_callback_t *callback, void *user_data);
+extern ni_bool_t	xml_stream_scan(FILE *fp, const char *location,
+				xml_stream_callback_t *callback, void *user_data);
+extern ni_bool_t	xml_stream_from_buffer(ni_buffer_t *, const char *location,
+				xml_stream_callback_t *callback, void *user_data);
+
 extern xml_document_t *	xml_document_new();
 extern xml_node_t *	xml_document_root(xml_document_t *);
 extern void		xml_document_set_root(xml_document_t *, xml_node_t *);
@@ -111,6 +156,7 @@ extern int		xml_node_content_uuid(const xml_node_t *, unsigned int, const ni_uui
 extern int		xml_node_print_fn(const xml_node_t *, void (*)(const char *, void *), void *);
 extern int		xml_node_print_debug(const xml_node_t *, unsigned int facility);
 extern xml_node_t *	xml_node_scan(FILE *fp, const char *location);
+extern void		xml_node_set_name(xml_node_t *, const char *);
 extern void		xml_node_set_cdata(xml_node_t *, const char *);
 extern void		xml_node_set_int(xml_node_t *, int);
 extern void		xml_node_set_int64(xml_node_t *, int64_t);
@@ -144,6 +190,24 @@ extern xml_node_t *	xml_node_get_next_named(xml_node_t *, const char *, xml_node
 
 extern ni_bool_t	xml_node_match_attrs(const xml_node_t *, const ni_var_array_t *);
 
+/*
+ * Structural diff between two documents. The arrays hold references to
+ * nodes in the compared trees: added/modified point into the new tree,
+ * removed into the old tree. Initialize with XML_DIFF_INIT and release
+ * with xml_diff_destroy; the diff functions return TRUE iff the trees
+ * differ.
+ */
+typedef struct xml_diff {
+	xml_node_array_t	added;
+	xml_node_array_t	removed;
+	xml_node_array_t	modified;
+} xml_diff_t;
+#define XML_DIFF_INIT		{ XML_NODE_ARRAY_INIT, XML_NODE_ARRAY_INIT, XML_NODE_ARRAY_INIT }
+
+extern ni_bool_t	xml_node_diff(const xml_node_t *, const xml_node_t *, xml_diff_t *);
+extern ni_bool_t	xml_document_diff(const xml_document_t *, const xml_document_t *, xml_diff_t *);
+extern void		xml_diff_destroy(xml_diff_t *);
+
 extern const char *	xml_node_get_path(ni_stringbuf_t *, const xml_node_t *, const xml_node_t *);
 
 extern void		xml_location_free(xml_location_t *);
@@ -286,9 +286,9 @@ babysit(void)
 			do {
 				ni_fsm_do(mgr->fsm, &timeout);
 #if 0
-			} while (ni_nanny_recheck_do(mgr) || ni_nanny_down_do(mgr));
+			} while (ni_nanny_recheck_do(mgr, &timeout) || ni_nanny_down_do(mgr));
 #else
-			} while (ni_nanny_recheck_do(mgr));
+			} while (ni_nanny_recheck_do(mgr, &timeout));
 #endif
 		}
 
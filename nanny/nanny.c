@@ -143,7 +143,15 @@ ni_nanny_free(ni_nanny_t *mgr)
  * Two, all enabled devices are checked when policies have been updated.
  *
  * Both checks happen once per mainloop iteration.
+ *
+ * Rechecks are debounced: scheduling a device just marks it dirty, and
+ * the whole dirty set is evaluated in one pass once the deadline below
+ * has expired. During boot, events arrive in bursts and this avoids
+ * re-running the policy evaluation once per event with nearly
+ * identical inputs.
  */
+#define NI_NANNY_RECHECK_DELAY_MS	250
+
 void
 ni_nanny_schedule_recheck(ni_ifworker_array_t *array, ni_ifworker_t *w)
 {
@@ -211,12 +219,40 @@ ni_nanny_recheck(ni_nanny_t *mgr, ni_ifworker_t *w)
 }
 
 unsigned int
-ni_nanny_recheck_do(ni_nanny_t *mgr)
+ni_nanny_recheck_do(ni_nanny_t *mgr, long *timeout)
 {
 	unsigned int i, count = 0;
 	ni_fsm_t *fsm = mgr->fsm;
+	struct timeval now;
 
 	ni_assert(fsm);
+	if (mgr->recheck.count == 0) {
+		timerclear(&mgr->recheck_deadline);
+		return 0;
+	}
+
+	ni_timer_get_time(&now);
+	if (!timerisset(&mgr->recheck_deadline)) {
+		struct timeval delay = {
+			.tv_sec = NI_NANNY_RECHECK_DELAY_MS / 1000,
+			.tv_usec = (NI_NANNY_RECHECK_DELAY_MS % 1000) * 1000,
+		};
+
+		timeradd(&now, &delay, &mgr->recheck_deadline);
+	}
+	if (timercmp(&now, &mgr->recheck_deadline, <)) {
+		struct timeval left;
+		long ms;
+
+		/* not yet due; make sure the mainloop wakes us in time */
+		timersub(&mgr->recheck_deadline, &now, &left);
+		ms = left.tv_sec * 1000 + left.tv_usec / 1000 + 1;
+		if (timeout && (*timeout < 0 || ms < *timeout))
+			*timeout = ms;
+		return 0;
+	}
+	timerclear(&mgr->recheck_deadline);
+
 	for (i = 0; i < mgr->recheck.count; ++i) {
 		ni_ifworker_t *w = mgr->recheck.data[i];
 
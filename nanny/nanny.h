@@ -98,6 +98,7 @@ struct ni_nanny {
 
 	unsigned int		last_policy_seq;
 	ni_ifworker_array_t	recheck;
+	struct timeval		recheck_deadline;
 	ni_ifworker_array_t	down;
 
 	ni_nanny_user_t *	users;
@@ -121,7 +122,7 @@ extern const char *		ni_nanny_statedir(void);
 extern void			ni_nanny_recheck_policies(ni_nanny_t *, const ni_string_array_t *);
 extern void			ni_nanny_schedule_recheck(ni_ifworker_array_t *, ni_ifworker_t *);
 extern void			ni_nanny_unschedule(ni_ifworker_array_t *, ni_ifworker_t *);
-extern unsigned int		ni_nanny_recheck_do(ni_nanny_t *mgr);
+extern unsigned int		ni_nanny_recheck_do(ni_nanny_t *mgr, long *timeout);
 extern unsigned int		ni_nanny_down_do(ni_nanny_t *mgr);
 extern void			ni_nanny_register_device(ni_nanny_t *, ni_ifworker_t *);
 extern void			ni_nanny_unregister_device(ni_nanny_t *, ni_ifworker_t *);
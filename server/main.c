@@ -11,6 +11,9 @@
 #endif
 
 #include <sys/poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
@@ -29,8 +32,12 @@
 #include <wicked/wireless.h>
 #include <wicked/modem.h>
 #include "netinfo_priv.h"
+#include "socket_priv.h"
+#include "appconfig.h"
 #include "udev-utils.h"
 #include "auto6.h"
+#include "flight.h"
+#include "workqueue.h"
 
 enum {
 	OPT_HELP,
@@ -43,6 +50,7 @@ enum {
 
 	OPT_FOREGROUND,
 	OPT_RECOVER,
+	OPT_CHECKCONFIG,
 #ifdef MODEM
 	OPT_NOMODEMMGR,
 #endif
@@ -63,6 +71,7 @@ static struct option	options[] = {
 
 	/* specific */
 	{ "recover",		no_argument,		NULL,	OPT_RECOVER },
+	{ "check-config",	no_argument,		NULL,	OPT_CHECKCONFIG },
 #ifdef MODEM
 	{ "no-modem-manager",	no_argument,		NULL,	OPT_NOMODEMMGR },
 #endif
@@ -75,6 +84,7 @@ static const char *	program_name;
 static const char *	opt_log_target;
 static ni_bool_t	opt_foreground;
 static ni_bool_t	opt_recover_state;
+static ni_bool_t	opt_check_config;
 /* FIXME: ModemManager changed to ModemManager1 - new API -> disabled */
 #ifdef MODEM
 static ni_bool_t	opt_no_modem_manager = TRUE;
@@ -86,6 +96,10 @@ static ni_dbus_server_t *dbus_server;
 static void		run_interface_server(void);
 static void		discover_state(ni_dbus_server_t *);
 static void		recover_state(const char *filename);
+static ni_bool_t	handover_takeover(void);
+static void		handover_listen(void);
+static void		schedule_save_state(void);
+static void		schedule_link_stats(void);
 static void		handle_interface_event(ni_netdev_t *, ni_event_t);
 static void		handle_interface_addr_events(ni_netdev_t *, ni_event_t, const ni_address_t *);
 static void		handle_interface_prefix_events(ni_netdev_t *, ni_event_t, const ni_ipv6_ra_pinfo_t *);
@@ -127,6 +141,8 @@ main(int argc, char **argv)
 				"        Tell the daemon to not background itself at startup.\n"
 				"  --recover\n"
 				"        Restart of address configuration daemons and keep state information.\n"
+				"  --check-config\n"
+				"        Parse the configuration, rebuild the compiled config cache and exit.\n"
 #ifdef MODEM
 				"  --no-modem-manager\n"
 				"        Skip start of modem-manager.\n"
@@ -177,6 +193,11 @@ main(int argc, char **argv)
 		case OPT_RECOVER:
 			opt_recover_state = TRUE;
 			break;
+
+		case OPT_CHECKCONFIG:
+			opt_check_config = TRUE;
+			ni_config_cache_refresh = TRUE;
+			break;
 #ifdef MODEM
 		case OPT_NOMODEMMGR:
 			opt_no_modem_manager = TRUE;
@@ -209,25 +230,200 @@ main(int argc, char **argv)
 	if (ni_init("server") < 0)
 		return NI_LSB_RC_ERROR;
 
-	if (opt_recover_state && ni_string_empty(opt_state_file)) {
+	if (opt_check_config) {
+		printf("%s: configuration parsed successfully, cache rebuilt\n",
+				program_name);
+		return NI_LSB_RC_SUCCESS;
+	}
+
+	if (ni_string_empty(opt_state_file)) {
 		static char dirname[PATH_MAX];
 
 		snprintf(dirname, sizeof(dirname), "%s/state.xml", ni_config_statedir());
 		opt_state_file = dirname;
 	}
 
+	/* If a previous wickedd generation is still running (package
+	 * update), ask it to hand over before we claim the bus name. */
+	if (handover_takeover())
+		opt_recover_state = TRUE;
+
 	run_interface_server();
 	return NI_LSB_RC_SUCCESS;
 }
 
+/*
+ * Generation handover on package update.
+ *
+ * The new wickedd asks the running one, via a unix socket in the
+ * statedir, to write a fresh state snapshot and exit; it then warm
+ * starts from that snapshot (see the discover filter below), so the
+ * restart neither loses the cached device details nor re-triggers
+ * the external discovery storm. The old process replies only after
+ * its final snapshot, and we wait for EOF - its exit - before
+ * claiming the dbus bus name.
+ *
+ * Passing the live netlink and dbus descriptors across generations
+ * was considered, but neither libnl nor libdbus can adopt inherited
+ * descriptors into fresh handles; the netlink dumps on startup
+ * reconcile any events missed during the switch instead.
+ */
+#define WICKEDD_HANDOVER_TIMEOUT	30000		/* msec */
+
+static const char *
+handover_socket_path(void)
+{
+	static char pathname[PATH_MAX];
+
+	if (ni_string_empty(pathname))
+		snprintf(pathname, sizeof(pathname), "%s/handover.sock",
+				ni_config_statedir());
+	return pathname;
+}
+
+static ni_bool_t
+handover_wait(int fd, int events)
+{
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = events;
+	return poll(&pfd, 1, WICKEDD_HANDOVER_TIMEOUT) > 0;
+}
+
+static ni_bool_t
+handover_takeover(void)
+{
+	struct sockaddr_un sun;
+	char reply;
+	int fd;
+
+	if ((fd = socket(PF_LOCAL, SOCK_STREAM, 0)) < 0)
+		return FALSE;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	strncpy(sun.sun_path, handover_socket_path(), sizeof(sun.sun_path) - 1);
+
+	if (connect(fd, (struct sockaddr *) &sun, sizeof(sun)) < 0) {
+		/* no previous generation running */
+		close(fd);
+		return FALSE;
+	}
+
+	if (write(fd, "H", 1) != 1 ||
+	    !handover_wait(fd, POLLIN) || read(fd, &reply, 1) != 1) {
+		ni_warn("previous wickedd did not hand over - starting cold");
+		close(fd);
+		return FALSE;
+	}
+
+	/* snapshot written; wait for the peer to exit and release the
+	 * bus name, signalled by EOF on the handover socket */
+	if (!handover_wait(fd, POLLIN) || read(fd, &reply, 1) != 0)
+		ni_warn("previous wickedd slow to exit after handover");
+	close(fd);
+
+	ni_note("taking over state from previous wickedd generation");
+	return TRUE;
+}
+
+/*
+ * Old generation side: accept a handover request and schedule a clean
+ * exit; the main loop writes the final snapshot and sends the reply.
+ */
+static ni_bool_t	handover_requested;
+static int		handover_conn = -1;
+
+static void
+handover_accept(ni_socket_t *sock)
+{
+	struct ucred cred = { .uid = -1 };
+	socklen_t len = sizeof(cred);
+	char request;
+	int conn;
+
+	if ((conn = accept(sock->__fd, NULL, NULL)) < 0)
+		return;
+
+	/* only a root peer may make us snapshot and exit */
+	if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0
+	 || cred.uid != 0) {
+		ni_warn("rejecting handover request from uid %u",
+				(unsigned int) cred.uid);
+		close(conn);
+		return;
+	}
+
+	if (read(conn, &request, 1) != 1) {
+		close(conn);
+		return;
+	}
+
+	if (handover_conn >= 0) {
+		/* one successor at a time */
+		close(conn);
+		return;
+	}
+
+	ni_note("handover requested by new wickedd generation");
+	handover_conn = conn;
+	handover_requested = TRUE;
+}
+
+static void
+handover_listen(void)
+{
+	struct sockaddr_un sun;
+	ni_socket_t *sock;
+	mode_t omask;
+	int fd;
+
+	if ((fd = socket(PF_LOCAL, SOCK_STREAM, 0)) < 0) {
+		ni_error("cannot create handover socket: %m");
+		return;
+	}
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	strncpy(sun.sun_path, handover_socket_path(), sizeof(sun.sun_path) - 1);
+
+	unlink(handover_socket_path());
+	/* do not rely on the inherited umask for the socket mode */
+	omask = umask(077);
+	if (bind(fd, (struct sockaddr *) &sun, sizeof(sun)) < 0 ||
+	    chmod(handover_socket_path(), 0600) < 0 ||
+	    listen(fd, 1) < 0) {
+		umask(omask);
+		ni_error("cannot listen on handover socket %s: %m",
+				handover_socket_path());
+		close(fd);
+		return;
+	}
+	umask(omask);
+
+	if ((sock = ni_socket_wrap(fd, SOCK_STREAM)) == NULL) {
+		close(fd);
+		return;
+	}
+	sock->receive = handover_accept;
+	ni_socket_activate(sock);
+}
+
 /*
  * Implement service for configuring the system's network interfaces
  */
 void
 run_interface_server(void)
 {
+	static char	flight_file[PATH_MAX];
 	ni_xs_scope_t *	schema;
 
+	/* dump the event flight recorder ring on fatal signals, so a
+	 * post-mortem can reconstruct the event ordering */
+	snprintf(flight_file, sizeof(flight_file), "%s/flight.log", ni_config_statedir());
+	ni_flight_enable_crash_dump(flight_file);
+
 	dbus_server = ni_objectmodel_create_service();
 	if (!dbus_server)
 		ni_fatal("Cannot create server, giving up.");
@@ -251,6 +447,13 @@ run_interface_server(void)
 		ni_fatal("unable to initialize netlink prefix listener");
 	if (ni_server_enable_interface_nduseropt_events(handle_interface_nduseropt_events) < 0)
 		ni_fatal("unable to initialize netlink nduseropt listener");
+	if (ni_server_enable_route_events(ni_server_trace_route_events) < 0)
+		ni_fatal("unable to initialize netlink route listener");
+	if (ni_server_enable_rule_events(ni_server_trace_rule_events) < 0)
+		ni_fatal("unable to initialize netlink rule listener");
+
+	/* batch device event notifications during rtnetlink storms */
+	ni_server_set_event_coalescing(20);
 
 	if (ni_udev_is_active() && ni_udev_net_subsystem_available()) {
 		if (ni_server_enable_interface_uevents() < 0)
@@ -274,12 +477,39 @@ run_interface_server(void)
 			ni_fatal("unable to background server");
 	}
 
+	/* worker pool for blocking syscall offload; started after the
+	 * daemonizing fork, as threads do not survive it */
+	ni_workqueue_init(0);
+
+	/* Warm start: when we have a state snapshot from the previous
+	 * run, skip the slow external link discovery (ethtool & friends)
+	 * on the initial refresh; the netlink dumps still reconcile the
+	 * actual link/address/route state against the kernel, and the
+	 * cached details are recovered from the snapshot below. */
+	if (opt_recover_state && ni_file_exists(opt_state_file))
+		ni_netconfig_set_discover_filter(ni_global_state_handle(0),
+				NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+
 	discover_state(dbus_server);
 
-	if (opt_recover_state)
+	/* We now track all rtnetlink event groups and performed the initial
+	 * full dump above; further refresh requests can be served from the
+	 * event stream unless the event socket overruns. */
+	ni_netconfig_set_incremental_refresh(ni_global_state_handle(0), TRUE);
+
+	if (opt_recover_state) {
 		recover_state(opt_state_file);
+		ni_netconfig_clear_discover_filter(ni_global_state_handle(0),
+				NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+		schedule_save_state();
+	}
+
+	schedule_link_stats();
+
+	/* let a future generation request a state handover */
+	handover_listen();
 
-	while (!ni_caught_terminal_signal()) {
+	while (!ni_caught_terminal_signal() && !handover_requested) {
 		long timeout;
 
 		do {
@@ -290,9 +520,17 @@ run_interface_server(void)
 			ni_fatal("ni_socket_wait failed");
 	}
 
-	if (opt_recover_state)
+	if (opt_recover_state || handover_requested)
 		ni_objectmodel_save_state(opt_state_file);
 
+	if (handover_conn >= 0) {
+		/* reply after the final snapshot; our exit closes the
+		 * socket and lets the successor claim the bus name */
+		if (write(handover_conn, "R", 1) != 1)
+			ni_warn("unable to confirm handover: %m");
+		unlink(handover_socket_path());
+	}
+
 	exit(0);
 }
 
@@ -361,6 +599,7 @@ recover_state(const char *filename)
 {
 	const char *prefix_list[] = {
 		NI_OBJECTMODEL_ADDRCONF_INTERFACE,
+		NI_OBJECTMODEL_ETHERNET_INTERFACE,
 		NULL
 	};
 
@@ -378,6 +617,53 @@ recover_state(const char *filename)
 	/* FIXME: update resolver etc. */
 }
 
+/*
+ * Snapshot the state periodically, so a hard daemon stop (crash,
+ * SIGKILL on package update) still finds a reasonably fresh state
+ * file to warm start from.
+ */
+#define WICKEDD_SAVE_STATE_INTERVAL	(15 * 60 * 1000)	/* msec */
+
+static void
+handle_save_state_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_objectmodel_save_state(opt_state_file);
+	schedule_save_state();
+}
+
+static void
+schedule_save_state(void)
+{
+	ni_timer_register(WICKEDD_SAVE_STATE_INTERVAL, handle_save_state_timeout, NULL);
+}
+
+/*
+ * Periodic link statistics sampling.
+ *
+ * Every link refresh records the kernel's interface statistics into
+ * the per-device sample rings; this timer just makes sure samples
+ * keep arriving while the system is otherwise quiet. The interval is
+ * configured via <link-stats-interval> (seconds), 0 disables it.
+ */
+static void
+handle_link_stats_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_netconfig_t *nc;
+
+	if ((nc = ni_global_state_handle(0)))
+		__ni_system_refresh_interfaces(nc);
+	schedule_link_stats();
+}
+
+static void
+schedule_link_stats(void)
+{
+	unsigned int interval = ni_config_link_stats_interval();
+
+	if (interval)
+		ni_timer_register(interval * 1000, handle_link_stats_timeout, NULL);
+}
+
 /*
  * Handle network layer events for interface server.
  * FIXME: There should be some locking here, which prevents us from
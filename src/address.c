@@ -39,13 +39,28 @@ static const unsigned char *__ni_sockaddr_data(const ni_sockaddr_t *, unsigned i
 
 /*
  * ni_address functions
+ *
+ * A refresh releases and reallocates address objects in bulk, one per
+ * RTM_NEWADDR message; recycle them through a small free list to keep
+ * the refresh out of malloc/free.
  */
+#define NI_ADDRESS_CACHE_MAX	128
+
+static ni_address_t *	__ni_address_cache;
+static unsigned int	__ni_address_cache_count;
+
 static ni_address_t *
 do_address_new(void)
 {
 	ni_address_t *ap;
 
-	ap = xcalloc(1, sizeof(*ap));
+	if ((ap = __ni_address_cache) != NULL) {
+		__ni_address_cache = ap->next;
+		__ni_address_cache_count--;
+		memset(ap, 0, sizeof(*ap));
+	} else {
+		ap = xcalloc(1, sizeof(*ap));
+	}
 	if (ap) {
 		ap->refcount = 1;
 		ap->cache_info.valid_lft = NI_LIFETIME_INFINITE;
@@ -132,7 +147,13 @@ ni_address_free(ni_address_t *ap)
 			return;
 
 		ni_string_free(&ap->label);
-		free(ap);
+		if (__ni_address_cache_count < NI_ADDRESS_CACHE_MAX) {
+			ap->next = __ni_address_cache;
+			__ni_address_cache = ap;
+			__ni_address_cache_count++;
+		} else {
+			free(ap);
+		}
 	}
 }
 
@@ -475,6 +496,97 @@ ni_address_list_destroy(ni_address_t **list)
 	}
 }
 
+/*
+ * Hashed lookup index over an address list; see address.h.
+ */
+static unsigned int
+__ni_address_index_hashval(const ni_sockaddr_t *addr)
+{
+	const unsigned char *data = NULL;
+	unsigned int hash, len = 0, i;
+
+	switch (addr->ss_family) {
+	case AF_INET:
+		data = (const unsigned char *) &addr->sin.sin_addr;
+		len = sizeof(addr->sin.sin_addr);
+		break;
+	case AF_INET6:
+		data = (const unsigned char *) &addr->six.sin6_addr;
+		len = sizeof(addr->six.sin6_addr);
+		break;
+	default:
+		/* all in one bucket, found via ni_sockaddr_equal */
+		break;
+	}
+
+	hash = 5381 + addr->ss_family;
+	for (i = 0; i < len; ++i)
+		hash = (hash << 5) + hash + data[i];
+	return hash % NI_ADDRESS_INDEX_NBUCKETS;
+}
+
+void
+ni_address_index_init(ni_address_index_t *index)
+{
+	memset(index, 0, sizeof(*index));
+}
+
+ni_bool_t
+ni_address_index_insert(ni_address_index_t *index, ni_address_t *ap)
+{
+	ni_address_array_t *bucket;
+	ni_address_t *ref;
+
+	if (!index || !ap)
+		return FALSE;
+
+	bucket = &index->buckets[__ni_address_index_hashval(&ap->local_addr)];
+	ref = ni_address_ref(ap);
+	if (!ref || !ni_address_array_append(bucket, ref)) {
+		ni_address_free(ref);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void
+ni_address_index_build(ni_address_index_t *index, ni_address_t *list)
+{
+	ni_address_t *ap;
+
+	ni_address_index_destroy(index);
+	for (ap = list; ap; ap = ap->next)
+		ni_address_index_insert(index, ap);
+}
+
+ni_address_t *
+ni_address_index_find(ni_address_index_t *index, const ni_sockaddr_t *addr)
+{
+	ni_address_array_t *bucket;
+	unsigned int i;
+
+	if (!index || !addr)
+		return NULL;
+
+	bucket = &index->buckets[__ni_address_index_hashval(addr)];
+	for (i = 0; i < bucket->count; ++i) {
+		if (ni_sockaddr_equal(&bucket->data[i]->local_addr, addr))
+			return bucket->data[i];
+	}
+	return NULL;
+}
+
+void
+ni_address_index_destroy(ni_address_index_t *index)
+{
+	unsigned int i;
+
+	if (index) {
+		for (i = 0; i < NI_ADDRESS_INDEX_NBUCKETS; ++i)
+			ni_address_array_destroy(&index->buckets[i]);
+	}
+}
+
 void
 ni_address_array_init(ni_address_array_t *array)
 {
@@ -74,6 +74,15 @@ typedef struct ni_config_rtnl_event {
 	unsigned int	mesg_buff_length;
 } ni_config_rtnl_event_t;
 
+typedef struct ni_config_rtnl_pacing {
+	/*
+	 * pacing of netlink configuration transactions
+	 */
+	unsigned int	bulk_rate;	/* transactions per second, 0 disables	*/
+	unsigned int	burst;		/* transactions served without delay	*/
+	unsigned int	max_outstanding;/* pipelined requests in flight	*/
+} ni_config_rtnl_pacing_t;
+
 typedef enum {
 	NI_CONFIG_BONDING_CTL_NETLINK = 0,
 	NI_CONFIG_BONDING_CTL_SYSFS,
@@ -117,6 +126,9 @@ typedef struct ni_config_dhcp4 {
 	unsigned int		routes_opts;
 	char *			vendor_class;
 	unsigned int		lease_time;
+	/* spread lease renewals: at most this many renewals are scheduled
+	 * into the same second; 0 disables the spreading */
+	unsigned int		renew_rate_limit;
 	ni_string_array_t	ignore_servers;
 
 	unsigned int		num_preferred_servers;
@@ -136,6 +148,7 @@ typedef struct ni_config_dhcp6 {
 	unsigned int		allow_update;
 	unsigned int		lease_time;
 	unsigned int		release_nretries;
+	ni_bool_t		shared_socket;	/* one socket for all devices	*/
 	struct {
 		unsigned int	time;
 		ni_uint_range_t range;
@@ -194,6 +207,16 @@ typedef struct ni_config {
 	char *			dbus_type;
 
 	ni_config_rtnl_event_t	rtnl_event;
+	ni_config_rtnl_pacing_t	rtnl_pacing;
+
+	/* link statistics sampling interval in seconds, 0 disables */
+	unsigned int		link_stats_interval;
+
+	/* summarize routes of routing daemons instead of storing them */
+	ni_bool_t		compact_foreign_routes;
+
+	/* supplicants send only changed lease dict entries to the server */
+	ni_bool_t		differential_lease_updates;
 
 	ni_config_bonding_t	bonding;
 	ni_config_teamd_t	teamd;
@@ -202,11 +225,18 @@ typedef struct ni_config {
 extern ni_config_t *	ni_config_new();
 extern void		ni_config_free(ni_config_t *);
 extern ni_config_t *	ni_config_parse(const char *, ni_init_appdata_callback_t *, void *);
+extern ni_bool_t	ni_config_cache_refresh;	/* force compiled config cache rebuild */
 extern ni_extension_t *	ni_config_find_extension(ni_config_t *, const char *);
 extern ni_extension_t *	ni_config_find_system_updater(ni_config_t *, const char *);
 extern unsigned int	ni_config_addrconf_update_mask(ni_addrconf_mode_t, unsigned int);
 extern unsigned int	ni_config_addrconf_update(const char *, ni_addrconf_mode_t, unsigned int);
 extern ni_bool_t	ni_config_use_nanny(void);
+extern unsigned int	ni_config_link_stats_interval(void);
+extern ni_bool_t	ni_config_compact_foreign_routes(void);
+extern ni_bool_t	ni_config_differential_lease_updates(void);
+extern unsigned int	ni_config_rtnl_pacing_rate(void);
+extern unsigned int	ni_config_rtnl_pacing_burst(void);
+extern unsigned int	ni_config_rtnl_pacing_outstanding(void);
 
 extern const ni_config_dhcp4_t *	ni_config_dhcp4_find_device(const char *);
 extern const ni_config_dhcp6_t *	ni_config_dhcp6_find_device(const char *);
@@ -229,6 +259,7 @@ extern void *		ni_c_binding_get_address(const ni_c_binding_t *);
 
 extern ni_shellcmd_t *	ni_extension_script_new(ni_extension_t *, const char *name, const char *command);
 extern ni_shellcmd_t *	ni_extension_script_find(ni_extension_t *, const char *);
+extern void		ni_extension_script_setenv(ni_extension_t *, const char *, const char *);
 extern const ni_c_binding_t *ni_extension_find_c_binding(const ni_extension_t *, const char *name);
 extern void		ni_config_fslocation_init(ni_config_fslocation_t *, const char *, unsigned int);
 extern void		ni_config_fslocation_destroy(ni_config_fslocation_t *);
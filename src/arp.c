@@ -21,13 +21,86 @@
 static void	ni_arp_socket_recv(ni_socket_t *);
 static int	ni_arp_parse(ni_arp_socket_t *, ni_buffer_t *, ni_arp_packet_t *);
 
+/*
+ * Shared per-interface ARP transport.
+ *
+ * DHCP4 duplicate address detection, IPv4LL and address verification
+ * may run concurrently on the same interface; instead of opening one
+ * raw capture socket (with its own packet filter) per session, all
+ * sessions on an interface share one transport, which is released
+ * together with the last session. Incoming ARP packets are handed to
+ * every session - the session callbacks match the addresses they are
+ * interested in anyway.
+ */
+struct ni_arp_transport {
+	ni_arp_transport_t *	next;
+	unsigned int		ifindex;
+	ni_capture_t *		capture;
+	ni_arp_socket_t *	sessions;
+};
+
+static ni_arp_transport_t *	ni_arp_transports;
+
+static ni_arp_transport_t *
+ni_arp_transport_open(const ni_capture_devinfo_t *dev_info)
+{
+	ni_capture_protinfo_t prot_info;
+	ni_arp_transport_t *trans;
+
+	for (trans = ni_arp_transports; trans; trans = trans->next) {
+		if (trans->ifindex == dev_info->ifindex)
+			return trans;
+	}
+
+	trans = calloc(1, sizeof(*trans));
+	trans->ifindex = dev_info->ifindex;
+
+	memset(&prot_info, 0, sizeof(prot_info));
+	prot_info.eth_protocol = ETHERTYPE_ARP;
+
+	trans->capture = ni_capture_open(dev_info, &prot_info, ni_arp_socket_recv);
+	if (!trans->capture) {
+		free(trans);
+		return NULL;
+	}
+	ni_capture_set_user_data(trans->capture, trans);
+
+	trans->next = ni_arp_transports;
+	ni_arp_transports = trans;
+	return trans;
+}
+
+static void
+ni_arp_transport_release(ni_arp_transport_t *trans, ni_arp_socket_t *arph)
+{
+	ni_arp_transport_t **tpos;
+	ni_arp_socket_t **pos, *cur;
+
+	for (pos = &trans->sessions; (cur = *pos) != NULL; pos = &cur->next) {
+		if (cur == arph) {
+			*pos = cur->next;
+			break;
+		}
+	}
+
+	if (trans->sessions == NULL) {
+		for (tpos = &ni_arp_transports; *tpos; tpos = &(*tpos)->next) {
+			if (*tpos == trans) {
+				*tpos = trans->next;
+				break;
+			}
+		}
+		ni_capture_free(trans->capture);
+		free(trans);
+	}
+}
+
 /*
  * Open ARP socket
  */
 ni_arp_socket_t *
 ni_arp_socket_open(const ni_capture_devinfo_t *dev_info, ni_arp_callback_t *callback, void *calldata)
 {
-	ni_capture_protinfo_t prot_info;
 	ni_arp_socket_t *arph;
 
 	arph = calloc(1, sizeof(*arph));
@@ -35,23 +108,21 @@ ni_arp_socket_open(const ni_capture_devinfo_t *dev_info, ni_arp_callback_t *call
 	arph->callback = callback;
 	arph->user_data = calldata;
 
-	memset(&prot_info, 0, sizeof(prot_info));
-	prot_info.eth_protocol = ETHERTYPE_ARP;
-
-	arph->capture = ni_capture_open(dev_info, &prot_info, ni_arp_socket_recv);
-	if (!arph->capture) {
+	if (!(arph->transport = ni_arp_transport_open(dev_info))) {
 		ni_arp_socket_close(arph);
 		return NULL;
 	}
 
-	ni_capture_set_user_data(arph->capture, arph);
+	arph->next = arph->transport->sessions;
+	arph->transport->sessions = arph;
 	return arph;
 }
 
 void
 ni_arp_socket_close(ni_arp_socket_t *arph)
 {
-	ni_capture_free(arph->capture);
+	if (arph->transport)
+		ni_arp_transport_release(arph->transport, arph);
 	free(arph);
 }
 
@@ -66,11 +137,22 @@ ni_arp_socket_recv(ni_socket_t *sock)
 	ni_buffer_t buf;
 
 	if (ni_capture_recv(capture, &buf, NULL, "arp") >= 0) {
-		ni_arp_socket_t *arph = ni_capture_get_user_data(capture);
+		ni_arp_transport_t *trans = ni_capture_get_user_data(capture);
+		ni_arp_socket_t *arph, *next;
 		ni_arp_packet_t packet;
 
-		if (ni_arp_parse(arph, &buf, &packet) >= 0)
+		if (!(arph = trans->sessions))
+			return;
+
+		if (ni_arp_parse(arph, &buf, &packet) < 0)
+			return;
+
+		/* A callback may close its own session; it must not close
+		 * other sessions on the same interface, though. */
+		for (; arph; arph = next) {
+			next = arph->next;
 			arph->callback(arph, &packet, arph->user_data);
+		}
 	}
 }
 
@@ -170,7 +252,7 @@ ni_arp_send(ni_arp_socket_t *arph, const ni_arp_packet_t *packet)
 	}
 	ni_buffer_put(&buf, &packet->tip, 4);
 
-	rv = ni_capture_send(arph->capture, &buf, NULL);
+	rv = ni_capture_send(arph->transport->capture, &buf, NULL);
 	free(buf.base);
 	return rv;
 }
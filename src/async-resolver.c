@@ -11,6 +11,7 @@
 #include <wicked/resolver.h>
 #include <wicked/logging.h>
 #include <wicked/socket.h>
+#include <wicked/util.h>
 #include <stdlib.h>
 
 #include <sys/types.h>
@@ -22,6 +23,80 @@
 #include <errno.h>
 #include <poll.h>
 
+#include "util_priv.h"
+
+/*
+ * Small positive cache for forward lookups. Reachability checks tend to
+ * resolve the same few peer names over and over; getaddrinfo(3) does not
+ * expose the record TTLs, so cache hits expire after a fixed lifetime.
+ */
+#define NI_RESOLVER_CACHE_TTL	30	/* seconds */
+#define NI_RESOLVER_CACHE_MAX	64	/* entries */
+
+typedef struct ni_resolver_cache_entry	ni_resolver_cache_entry_t;
+struct ni_resolver_cache_entry {
+	ni_resolver_cache_entry_t *next;
+	char *			hostname;
+	int			af;
+	ni_sockaddr_t		addr;
+	struct timeval		expires;
+};
+
+static ni_resolver_cache_entry_t *	__ni_resolver_cache;
+static unsigned int			__ni_resolver_cache_count;
+
+static ni_bool_t
+ni_resolver_cache_get(const char *hostname, int af, ni_sockaddr_t *addr)
+{
+	ni_resolver_cache_entry_t *entry, **pos;
+	struct timeval now;
+
+	ni_timer_get_time(&now);
+	for (pos = &__ni_resolver_cache; (entry = *pos); ) {
+		if (timercmp(&now, &entry->expires, >)) {
+			*pos = entry->next;
+			__ni_resolver_cache_count--;
+			ni_string_free(&entry->hostname);
+			free(entry);
+			continue;
+		}
+		if (entry->af == af && ni_string_eq_nocase(entry->hostname, hostname)) {
+			*addr = entry->addr;
+			return TRUE;
+		}
+		pos = &entry->next;
+	}
+	return FALSE;
+}
+
+static void
+ni_resolver_cache_put(const char *hostname, int af, const ni_sockaddr_t *addr)
+{
+	ni_resolver_cache_entry_t *entry, **pos;
+
+	if (__ni_resolver_cache_count >= NI_RESOLVER_CACHE_MAX) {
+		/* drop the oldest entry; the list is in insertion order */
+		for (pos = &__ni_resolver_cache; (entry = *pos) && entry->next; )
+			pos = &entry->next;
+		if (entry) {
+			*pos = NULL;
+			__ni_resolver_cache_count--;
+			ni_string_free(&entry->hostname);
+			free(entry);
+		}
+	}
+
+	entry = xcalloc(1, sizeof(*entry));
+	ni_string_dup(&entry->hostname, hostname);
+	entry->af = af;
+	entry->addr = *addr;
+	ni_timer_get_time(&entry->expires);
+	entry->expires.tv_sec += NI_RESOLVER_CACHE_TTL;
+
+	entry->next = __ni_resolver_cache;
+	__ni_resolver_cache = entry;
+	__ni_resolver_cache_count++;
+}
 
 /*
  * Build a getaddrinfo_a request
@@ -156,6 +231,9 @@ ni_resolve_hostname_timed(const char *hostname, int af, ni_sockaddr_t *addr, uns
 	struct gaicb *cb;
 	int gerr;
 
+	if (ni_resolver_cache_get(hostname, af, addr))
+		return 1;
+
 	cb = gaicb_new(hostname, af);
 	if (gaicb_list_resolve(&cb, 1, timeout) < 0)
 		return -1;
@@ -168,6 +246,7 @@ ni_resolve_hostname_timed(const char *hostname, int af, ni_sockaddr_t *addr, uns
 		return 0;
 	}
 
+	ni_resolver_cache_put(hostname, af, addr);
 	return 1;
 }
 
@@ -175,25 +254,40 @@ int
 ni_resolve_hostnames_timed(int af, unsigned int count, const char *hostnames[], ni_sockaddr_t addrs[], unsigned int timeout)
 {
 	struct gaicb **cblist = NULL;
-	unsigned int i;
+	unsigned int *index = NULL;
+	unsigned int i, nreqs = 0;
 
+	/* answer what we can from the cache; resolve only the misses,
+	 * which still overlap within one getaddrinfo_a call */
 	cblist = calloc(count, sizeof(cblist[0]));
-	for (i = 0; i < count; ++i)
-		cblist[i] = gaicb_new(hostnames[i], af);
+	index = calloc(count, sizeof(index[0]));
+	for (i = 0; i < count; ++i) {
+		if (ni_resolver_cache_get(hostnames[i], af, &addrs[i]))
+			continue;
+		index[nreqs] = i;
+		cblist[nreqs++] = gaicb_new(hostnames[i], af);
+	}
 
-	if (gaicb_list_resolve(cblist, count, timeout) < 0)
+	if (nreqs && gaicb_list_resolve(cblist, nreqs, timeout) < 0) {
+		gaicb_list_free(cblist, nreqs);
+		free(index);
 		return -1;
+	}
 
-	for (i = 0; i < count; ++i) {
+	for (i = 0; i < nreqs; ++i) {
 		struct gaicb *cb = cblist[i];
+		ni_sockaddr_t *addr = &addrs[index[i]];
 		int gerr;
 
-		if ((gerr = gaicb_get_address(cb, &addrs[i])) != 0) {
+		if ((gerr = gaicb_get_address(cb, addr)) != 0) {
 			ni_error("unable to resolve %s: %s", cb->ar_name, gai_strerror(gerr));
-			memset(&addrs[i], 0, sizeof(addrs[i]));
+			memset(addr, 0, sizeof(*addr));
+		} else {
+			ni_resolver_cache_put(cb->ar_name, af, addr);
 		}
 	}
-	gaicb_list_free(cblist, count);
+	gaicb_list_free(cblist, nreqs);
+	free(index);
 
 	return 0;
 }
@@ -1045,9 +1045,9 @@ ni_bonding_parse_sysfs_attribute(ni_bonding_t *bonding, const char *attr, char *
 					&bonding->arpmon.validate_targets) < 0)
 			return -1;
 	} else if (!strcmp(attr, "primary")) {
-		ni_string_dup(&bonding->primary_slave.name, value);
+		ni_refstr_dup(&bonding->primary_slave.name, value);
 	} else if (!strcmp(attr, "active_slave")) {
-		ni_string_dup(&bonding->active_slave.name, value);
+		ni_refstr_dup(&bonding->active_slave.name, value);
 	} else if (!strcmp(attr, "packets_per_slave")) {
 		if (ni_parse_uint(value, &bonding->packets_per_slave, 10) < 0)
 			return -1;
@@ -1166,36 +1166,37 @@ ni_bonding_parse_sysfs_attrs(const char *ifname, ni_bonding_t *bonding)
 {
 	static const struct {
 		const char *name;
+		const char *path;	/* relative to the device directory */
 		ni_bool_t   nofail;	/* don't fail, may be missed */
 	} attrs[] = {
-		{ "mode",		FALSE },
-		{ "fail_over_mac",	FALSE },
-		{ "primary_reselect",	FALSE },
-		{ "xmit_hash_policy",	FALSE },
-		{ "lacp_rate",		FALSE },
-		{ "ad_select",		FALSE },
-		{ "min_links",		TRUE  },
-		{ "num_grat_arp",	FALSE },
-		{ "num_unsol_na",	FALSE },
-		{ "resend_igmp",	FALSE },
-		{ "all_slaves_active",	FALSE },
-		{ "active_slave",	FALSE },
-		{ "primary",		FALSE },
-		{ "miimon",		FALSE },
-		{ "updelay",		FALSE },
-		{ "downdelay",		FALSE },
-		{ "use_carrier",	FALSE },
-		{ "arp_validate",	FALSE },
-		{ "arp_interval",	FALSE },
-		{ "arp_all_targets",	TRUE  },
-		{ "packets_per_slave",	TRUE  },
-		{ "tlb_dynamic_lb",	TRUE  },
-		{ "lp_interval",	TRUE  },
-		{ NULL,			FALSE },
+		{ "mode",		"bonding/mode",			FALSE },
+		{ "fail_over_mac",	"bonding/fail_over_mac",	FALSE },
+		{ "primary_reselect",	"bonding/primary_reselect",	FALSE },
+		{ "xmit_hash_policy",	"bonding/xmit_hash_policy",	FALSE },
+		{ "lacp_rate",		"bonding/lacp_rate",		FALSE },
+		{ "ad_select",		"bonding/ad_select",		FALSE },
+		{ "min_links",		"bonding/min_links",		TRUE  },
+		{ "num_grat_arp",	"bonding/num_grat_arp",		FALSE },
+		{ "num_unsol_na",	"bonding/num_unsol_na",		FALSE },
+		{ "resend_igmp",	"bonding/resend_igmp",		FALSE },
+		{ "all_slaves_active",	"bonding/all_slaves_active",	FALSE },
+		{ "active_slave",	"bonding/active_slave",		FALSE },
+		{ "primary",		"bonding/primary",		FALSE },
+		{ "miimon",		"bonding/miimon",		FALSE },
+		{ "updelay",		"bonding/updelay",		FALSE },
+		{ "downdelay",		"bonding/downdelay",		FALSE },
+		{ "use_carrier",	"bonding/use_carrier",		FALSE },
+		{ "arp_validate",	"bonding/arp_validate",		FALSE },
+		{ "arp_interval",	"bonding/arp_interval",		FALSE },
+		{ "arp_all_targets",	"bonding/arp_all_targets",	TRUE  },
+		{ "packets_per_slave",	"bonding/packets_per_slave",	TRUE  },
+		{ "tlb_dynamic_lb",	"bonding/tlb_dynamic_lb",	TRUE  },
+		{ "lp_interval",	"bonding/lp_interval",		TRUE  },
+		{ NULL,			NULL,				FALSE },
 	};
+	ni_sysfs_netif_attr_t values[sizeof(attrs) / sizeof(attrs[0])];
 	ni_string_array_t slave_names = NI_STRING_ARRAY_INIT;
-	char *attrval = NULL;
-	unsigned int i;
+	unsigned int i, count;
 
 	__ni_bonding_clear(bonding);
 	ni_sysfs_bonding_get_slaves(ifname, &slave_names);
@@ -1203,38 +1204,41 @@ ni_bonding_parse_sysfs_attrs(const char *ifname, ni_bonding_t *bonding)
 		ni_bonding_add_slave(bonding, slave_names.data[i]);
 	ni_string_array_destroy(&slave_names);
 
-	for (i = 0; attrs[i].name; ++i) {
+	for (count = 0; attrs[count].name; ++count)
+		values[count].name = attrs[count].path;
+
+	/* one pass over a cached device directory fd instead of a
+	 * path lookup plus open per attribute */
+	ni_sysfs_netif_get_attrs(ifname, values, count);
+
+	for (i = 0; i < count; ++i) {
 		const char *attrname = attrs[i].name;
 		int rv;
 
-		if (ni_sysfs_bonding_get_attr(ifname, attrname, &attrval) < 0) {
+		if (!values[i].present) {
 			if (attrs[i].nofail)
 				continue;
 
 			ni_error("%s: cannot get bonding attribute %s", ifname, attrname);
-			goto failed;
+			return -1;
 		}
 
-		if (attrval == NULL)
+		if (ni_string_empty(values[i].value))
 			continue;
 
-		rv = ni_bonding_parse_sysfs_attribute(bonding, attrname, attrval);
+		rv = ni_bonding_parse_sysfs_attribute(bonding, attrname, values[i].value);
 		if (rv == -2) {
-			ni_error("ignoring unknown bonding module option %s=%s", attrname, attrval);
+			ni_error("ignoring unknown bonding module option %s=%s",
+					attrname, values[i].value);
 		} else if (rv < 0) {
-			ni_error("unable to parse bonding module option %s=%s", attrname, attrval);
-			goto failed;
+			ni_error("unable to parse bonding module option %s=%s",
+					attrname, values[i].value);
+			return -1;
 		}
 	}
 
 	ni_sysfs_bonding_get_arp_targets(ifname, &bonding->arpmon.targets);
-
-	ni_string_free(&attrval);
 	return 0;
-
-failed:
-	ni_string_free(&attrval);
-	return -1;
 }
 
 /*
@@ -1591,12 +1595,12 @@ ni_bonding_set_option(ni_bonding_t *bond, const char *option, const char *value)
 	} else
 
 	if (strcmp(option, "primary") == 0) {
-		ni_string_dup(&bond->primary_slave.name, value);
+		ni_refstr_dup(&bond->primary_slave.name, value);
 		return TRUE;
 	} else
 
 	if (strcmp(option, "active_slave") == 0) {
-		ni_string_dup(&bond->active_slave.name, value);
+		ni_refstr_dup(&bond->active_slave.name, value);
 		return TRUE;
 	} else
 
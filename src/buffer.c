@@ -8,6 +8,7 @@
 #include "config.h"
 #endif
 
+#include <wicked/logging.h>
 #include "buffer.h"
 
 void
@@ -31,3 +32,125 @@ ni_buffer_ensure_tailroom(ni_buffer_t *bp, unsigned int min_room)
 	}
 	bp->size = new_size;
 }
+
+/*
+ * Recycling cache of fixed-size packet buffers.
+ *
+ * All capture sockets receive into buffers of one size class, so
+ * instead of one malloc per capture we keep released buffers on a
+ * small free stack and hand them out again. Requests larger than the
+ * size class fall back to a plain allocation and are freed on the
+ * final release.
+ */
+#define NI_BUFFER_CACHE_SIZE	16384	/* covers jumbo frame MTUs */
+#define NI_BUFFER_CACHE_MAX	32	/* free buffers kept around */
+
+static ni_buffer_t *	ni_buffer_cache[NI_BUFFER_CACHE_MAX];
+static unsigned int	ni_buffer_cache_count;
+
+ni_buffer_t *
+ni_buffer_cache_get(size_t size)
+{
+	ni_buffer_t *bp;
+
+	if (size > NI_BUFFER_CACHE_SIZE) {
+		bp = ni_buffer_new(size);
+		bp->refs = 1;
+		return bp;
+	}
+
+	if (ni_buffer_cache_count != 0) {
+		bp = ni_buffer_cache[--ni_buffer_cache_count];
+		ni_buffer_reset(bp);
+	} else {
+		bp = ni_buffer_new(NI_BUFFER_CACHE_SIZE);
+		bp->cached = 1;
+	}
+	bp->refs = 1;
+	return bp;
+}
+
+ni_buffer_t *
+ni_buffer_hold(ni_buffer_t *bp)
+{
+	ni_assert(bp && bp->refs);
+	bp->refs++;
+	return bp;
+}
+
+void
+ni_buffer_release(ni_buffer_t *bp)
+{
+	if (!bp)
+		return;
+
+	ni_assert(bp->refs);
+	if (--bp->refs != 0)
+		return;
+
+	if (bp->cached && ni_buffer_cache_count < NI_BUFFER_CACHE_MAX) {
+		ni_buffer_cache[ni_buffer_cache_count++] = bp;
+		return;
+	}
+	ni_buffer_free(bp);
+}
+
+/*
+ * Chained buffers and slice views; see buffer.h for the contract.
+ */
+void
+ni_buffer_chain_append(ni_buffer_t **chain, ni_buffer_t *bp)
+{
+	while (*chain)
+		chain = &(*chain)->next;
+	*chain = bp;
+}
+
+unsigned int
+ni_buffer_chain_count(const ni_buffer_t *bp)
+{
+	unsigned int count = 0;
+
+	for (; bp; bp = bp->next)
+		count += ni_buffer_count(bp);
+	return count;
+}
+
+/*
+ * Flatten a buffer chain into an iovec for sendmsg/writev; empty
+ * segments are skipped. Returns the number of iovec slots used, or
+ * 0 if the chain does not fit into max slots.
+ */
+unsigned int
+ni_buffer_chain_iovec(const ni_buffer_t *bp, struct iovec *iov, unsigned int max)
+{
+	unsigned int niov = 0;
+
+	for (; bp; bp = bp->next) {
+		if (ni_buffer_count(bp) == 0)
+			continue;
+		if (niov >= max)
+			return 0;
+		iov[niov].iov_base = ni_buffer_head(bp);
+		iov[niov].iov_len = ni_buffer_count(bp);
+		niov++;
+	}
+	return niov;
+}
+
+void
+ni_buffer_slice(ni_buffer_t *slice, ni_buffer_t *parent, size_t offset, size_t len)
+{
+	ni_assert(offset + len <= ni_buffer_count(parent));
+
+	ni_buffer_init_reader(slice, (unsigned char *) ni_buffer_head(parent) + offset, len);
+	if (parent->refs)
+		slice->parent = ni_buffer_hold(parent);
+}
+
+void
+ni_buffer_slice_destroy(ni_buffer_t *slice)
+{
+	ni_buffer_release(slice->parent);
+	memset(slice, 0, sizeof(*slice));
+}
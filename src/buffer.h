@@ -13,6 +13,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/uio.h>	/* for struct iovec */
 #include <wicked/types.h>
 #include "util_priv.h"
 
@@ -21,9 +22,13 @@ struct ni_buffer {
 	size_t			head;
 	size_t			tail;
 	size_t			size;
+	unsigned int		refs;
 	unsigned int		overflow : 1,
 				underflow : 1,
-				allocated : 1;
+				allocated : 1,
+				cached : 1;
+	ni_buffer_t *		next;	/* chain of message segments */
+	ni_buffer_t *		parent;	/* buffer a slice view refers into */
 };
 
 /* this should really be named init_writer */
@@ -280,4 +285,32 @@ ni_buffer_get_uint32(ni_buffer_t *bp, uint32_t *var)
 
 extern void		ni_buffer_ensure_tailroom(ni_buffer_t *, unsigned int);
 
+/*
+ * Recycling cache of fixed-size packet buffers for the receive paths.
+ * Buffers are handed out by reference; a consumer that needs to keep
+ * the data beyond the callback takes an extra hold. The final release
+ * returns the buffer to the cache instead of freeing it.
+ */
+extern ni_buffer_t *	ni_buffer_cache_get(size_t size);
+extern ni_buffer_t *	ni_buffer_hold(ni_buffer_t *);
+extern void		ni_buffer_release(ni_buffer_t *);
+
+/*
+ * Chained buffers and slice views.
+ *
+ * A message can be assembled from several segments -- say a prebuilt
+ * header in front of a payload -- by linking buffers through ->next
+ * instead of copying them into one region; the chain is flattened
+ * into an iovec only at the syscall boundary. A slice is a read-only
+ * window into another buffer; when the parent is refcounted, the
+ * slice takes a hold on it for as long as the view exists.
+ */
+#define NI_BUFFER_CHAIN_MAXVEC	8
+
+extern void		ni_buffer_chain_append(ni_buffer_t **, ni_buffer_t *);
+extern unsigned int	ni_buffer_chain_count(const ni_buffer_t *);
+extern unsigned int	ni_buffer_chain_iovec(const ni_buffer_t *, struct iovec *, unsigned int);
+extern void		ni_buffer_slice(ni_buffer_t *, ni_buffer_t *, size_t, size_t);
+extern void		ni_buffer_slice_destroy(ni_buffer_t *);
+
 #endif /* __WICKED_DHCP_BUFFER_H__ */
@@ -424,6 +424,131 @@ out:
 	return rv;
 }
 
+/*
+ * Asynchronous version of ni_call_common_xml. The call is placed without
+ * blocking for the reply, so that the fsm can have the calls for many
+ * independent devices in flight at the same time. The completion callback
+ * receives the result code and the (optional) callback list the server
+ * returned; error handling including the retry-after-prompting logic of
+ * the error context works as in the synchronous version, except that any
+ * retry is placed asynchronously as well.
+ */
+struct ni_call_common_async {
+	ni_dbus_object_t *	object;
+	const ni_dbus_service_t *service;
+	const ni_dbus_method_t *method;
+	ni_call_error_context_t	error_context;
+	ni_call_common_done_t *	done;
+	void *			user_data;
+};
+
+static int	ni_call_common_xml_async_send(struct ni_call_common_async *);
+
+static void
+ni_call_common_xml_async_done(ni_dbus_object_t *proxy, ni_dbus_message_t *reply, void *user_data)
+{
+	struct ni_call_common_async *async = user_data;
+	ni_objectmodel_callback_info_t *callback_list = NULL;
+	DBusError error = DBUS_ERROR_INIT;
+	int rv = 0;
+
+	if (reply && dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN) {
+		ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+
+		if (ni_dbus_message_get_args_variants(reply, &result, 1) >= 0)
+			callback_list = ni_objectmodel_callback_info_from_dict(&result);
+		ni_dbus_variant_destroy(&result);
+	} else
+	if (reply && dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR) {
+		dbus_set_error_from_message(&error, reply);
+	} else {
+		dbus_set_error(&error, DBUS_ERROR_FAILED, "dbus: no reply");
+	}
+
+	if (dbus_error_is_set(&error)) {
+		if (async->error_context.handler) {
+			rv = async->error_context.handler(&async->error_context, &error);
+			if (rv > 0) {
+				ni_warn("Whaaah. Error context handler returns positive code. "
+					"Assuming programmer mistake");
+				rv = -rv;
+			}
+		} else {
+			ni_dbus_print_error(&error, "%s.%s() failed",
+					async->service->name, async->method->name);
+			rv = ni_dbus_get_error(&error, NULL);
+		}
+
+		if (rv == -NI_ERROR_RETRY_OPERATION && async->error_context.config) {
+			dbus_error_free(&error);
+			if (ni_call_common_xml_async_send(async) >= 0)
+				return;
+			rv = -NI_ERROR_DBUS_CALL_FAILED;
+		}
+	}
+
+	dbus_error_free(&error);
+	async->done(async->user_data, rv, callback_list);
+	ni_call_error_context_destroy(&async->error_context);
+	free(async);
+}
+
+static int
+ni_call_common_xml_async_send(struct ni_call_common_async *async)
+{
+	ni_dbus_variant_t argv[1];
+	int rv, argc = 0;
+
+	memset(argv, 0, sizeof(argv));
+	if (ni_dbus_xml_method_num_args(async->method)) {
+		ni_dbus_variant_t *dict = &argv[argc++];
+
+		ni_dbus_variant_init_dict(dict);
+		if (async->error_context.config
+		 && !ni_dbus_xml_serialize_arg(async->method, 0, dict, async->error_context.config)) {
+			ni_error("%s.%s: error serializing argument",
+					async->service->name, async->method->name);
+			rv = -NI_ERROR_CANNOT_MARSHAL;
+			goto out;
+		}
+	}
+
+	rv = ni_dbus_object_call_variant_async(async->object,
+			async->service->name, async->method->name,
+			argc, argv, ni_call_common_xml_async_done, async);
+
+out:
+	while (argc--)
+		ni_dbus_variant_destroy(&argv[argc]);
+	return rv;
+}
+
+int
+ni_call_common_xml_async(ni_dbus_object_t *object, const ni_dbus_service_t *service, const ni_dbus_method_t *method,
+			xml_node_t *config, ni_call_error_handler_t *error_handler,
+			ni_call_common_done_t *done, void *user_data)
+{
+	struct ni_call_common_async *async;
+	int rv;
+
+	async = calloc(1, sizeof(*async));
+	async->object = object;
+	async->service = service;
+	async->method = method;
+	async->error_context.handler = error_handler;
+	async->error_context.config = config;
+	async->done = done;
+	async->user_data = user_data;
+
+	/* Note, the completion callback is not invoked when placing the
+	 * call itself fails; the caller deals with the error code. */
+	if ((rv = ni_call_common_xml_async_send(async)) < 0) {
+		ni_call_error_context_destroy(&async->error_context);
+		free(async);
+	}
+	return rv;
+}
+
 static int
 ni_get_device_method(ni_dbus_object_t *object, const char *method_name, const ni_dbus_service_t **service_ret, const ni_dbus_method_t **method_ret)
 {
@@ -50,6 +50,8 @@
 #define MTU_MAX			1500
 #define DHCP_CLIENT_PORT	68
 
+#define NI_CAPTURE_BATCH_MAX	16	/* datagrams drained per wakeup */
+
 #ifndef ETHERTYPE_LLDP
 # define ETHERTYPE_LLDP		0x88CC
 #endif
@@ -97,6 +99,39 @@ static struct bpf_insn std_ipv4_bpf_filter [] = {
 	BPF_STMT(BPF_RET + BPF_K, 0),
 };
 
+/*
+ * Same as above, but additionally matching the BOOTP/DHCP4 transaction
+ * id in the UDP payload. With this attached, the kernel drops replies
+ * addressed to other clients instead of waking us up for every
+ * broadcast on the segment.
+ */
+static struct bpf_insn std_ipv4_xid_bpf_filter [] = {
+	/* Make sure it's a UDP packet... */
+	BPF_STMT(BPF_LD + BPF_B + BPF_ABS, 9),
+	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, IPPROTO_UDP, 0, 8),
+
+	/* Make sure this isn't a fragment... */
+	BPF_STMT(BPF_LD + BPF_H + BPF_ABS, 6),
+	BPF_JUMP(BPF_JMP + BPF_JSET + BPF_K, 0x1fff, 6, 0),
+
+	/* Get the IP header length... */
+	BPF_STMT(BPF_LDX + BPF_B + BPF_MSH, 0),
+
+	/* Make sure it's to the right port... */
+	BPF_STMT(BPF_LD + BPF_H + BPF_IND, 2),
+	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, DHCP_CLIENT_PORT, 0, 3),
+
+	/* Make sure it's our transaction... */
+	BPF_STMT(BPF_LD + BPF_W + BPF_IND, 12),
+	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, 0, 0, 1),
+
+	/* If we passed all the tests, ask for the whole packet. */
+	BPF_STMT(BPF_RET + BPF_K, ~0U),
+
+	/* Otherwise, drop it. */
+	BPF_STMT(BPF_RET + BPF_K, 0),
+};
+
 /*
  * Wrap sockaddr_ll same to ni_sockaddr_t,
  * just for link-layer packets only
@@ -119,46 +154,107 @@ struct ni_capture {
 	int			protocol;
 
 	char *			ifname;
+	ni_capture_protinfo_t	protinfo;
 
-	void *			buffer;
+	ni_buffer_t *		buffer;	/* pooled receive buffer */
 	size_t			mtu;
 
+	struct {
+		void		(*receive)(ni_socket_t *);
+		ni_bool_t	dispatching;
+		ni_bool_t	defer_free;
+		unsigned int	count;	/* queued datagrams		*/
+		unsigned int	next;	/* currently dispatched		*/
+		ni_buffer_t *	buf[NI_CAPTURE_BATCH_MAX];
+		ni_sockaddr_t	from[NI_CAPTURE_BATCH_MAX];
+		size_t		len[NI_CAPTURE_BATCH_MAX];
+		ni_bool_t	partial_csum[NI_CAPTURE_BATCH_MAX];
+	} rx;
+
 	struct {
 		struct timeval		deadline;
 		const ni_buffer_t *	buffer;
 		ni_timeout_param_t	timeout;
 	} retrans;
 
+	struct {
+		ni_bool_t		valid;
+		struct {
+			struct ip	ip;
+			struct udphdr	udp;
+		}			hdr;	/* prebuilt, patched per send */
+		uint32_t		pseudo;	/* sum over addresses + proto */
+	} txhdr;
+
 	void *			user_data;
 };
 
 static int		ni_capture_set_filter(ni_capture_t *, const ni_capture_protinfo_t *);
 static ssize_t		__ni_capture_send(const ni_capture_t *, const ni_buffer_t *);
 
+/*
+ * Internet checksum, accumulated a 32bit word at a time into a 64bit
+ * accumulator; ones' complement addition is associative, so deferring
+ * the carry folds to the end yields the same sum as the classic 16bit
+ * byte loop at a quarter of the memory passes.
+ */
 static uint32_t
 checksum_partial(uint32_t sum, const void *data, uint16_t len)
 {
 	union {
-		const uint16_t *s;
 		const uint8_t *c;
+		const uint16_t *s;
+		const uint32_t *l;
+		uintptr_t align;
 	} u;
+	uint64_t acc = sum;
 
-	u.s = data;
-	while (len > 1) {
-		sum += *u.s++;
-		len -= 2;
+	u.c = data;
+
+	if (u.align & 1) {
+		/* 16bit-misaligned data; sum halfwords bytewise */
+		while (len > 1) {
+			uint16_t w;
+
+			memcpy(&w, u.c, sizeof(w));
+			acc += w;
+			u.c += 2;
+			len -= 2;
+		}
+	} else {
+		if ((u.align & 2) && len >= 2) {
+			acc += *u.s++;
+			len -= 2;
+		}
+		while (len >= 16) {
+			acc += (uint64_t) u.l[0] + u.l[1] + u.l[2] + u.l[3];
+			u.l += 4;
+			len -= 16;
+		}
+		while (len >= 4) {
+			acc += *u.l++;
+			len -= 4;
+		}
+		if (len >= 2) {
+			acc += *u.s++;
+			len -= 2;
+		}
 	}
 
-	if (len == 1) {
+	if (len) {
 		union {
 			uint8_t c[2];
 			uint16_t s;
 		} bs;
 		bs.c[0] = u.c[0];
 		bs.c[1] = 0;
-		sum += bs.s;
+		acc += bs.s;
 	}
-	return sum;
+
+	/* fold the accumulator back into a 32bit running sum */
+	while (acc >> 32)
+		acc = (acc & 0xffffffff) + (acc >> 32);
+	return acc;
 }
 
 static inline uint16_t
@@ -205,57 +301,60 @@ ipudp_checksum(const struct ip *iph, const struct udphdr *uhp,
 	return checksum_fold(csum);
 }
 
+/*
+ * Prebuild the IP/UDP header template the capture frames outgoing
+ * payloads with. The invariant fields and the pseudo header sum over
+ * the addresses are computed once here; per send, only the length
+ * fields get patched and the payload folded into the UDP checksum,
+ * and the template is transmitted as its own iovec in front of the
+ * payload buffer, which stays untouched.
+ */
 int
-ni_capture_build_udp_header(ni_buffer_t *bp,
+ni_capture_set_udp_header(ni_capture_t *capture,
 		struct in_addr src_addr, uint16_t src_port,
 		struct in_addr dst_addr, uint16_t dst_port)
 {
-	const unsigned char *payload;
-	unsigned int payload_len;
-	unsigned int udp_len;
 	struct ip *ip;
 	struct udphdr *udp;
+	union {
+		uint8_t c[2];
+		uint16_t s;
+	} bs;
 
-	payload = ni_buffer_head(bp);
-	payload_len = ni_buffer_count(bp);
-
-	/* Build the UDP header */
-	udp = ni_buffer_push_head(bp, sizeof(struct udphdr));
-	if (udp == NULL) {
-		ni_error("not enough headroom for UDP header");
+	if (capture == NULL)
 		return -1;
-	}
-	udp_len = ni_buffer_count(bp);
-	udp->uh_sport = htons(src_port);
-	udp->uh_dport = htons(dst_port);
-	udp->uh_ulen = htons(udp_len);
-	udp->uh_sum = 0;
 
-	/* Build the IP header */
-	ip = ni_buffer_push_head(bp, sizeof(struct ip));
-	if (ip == NULL) {
-		ni_error("not enough headroom for IP header");
-		return -1;
-	}
+	if (dst_addr.s_addr == 0)
+		dst_addr.s_addr = INADDR_BROADCAST;
+
+	ip = &capture->txhdr.hdr.ip;
+	udp = &capture->txhdr.hdr.udp;
+
+	if (capture->txhdr.valid &&
+	    ip->ip_src.s_addr == src_addr.s_addr &&
+	    ip->ip_dst.s_addr == dst_addr.s_addr &&
+	    udp->uh_sport == htons(src_port) &&
+	    udp->uh_dport == htons(dst_port))
+		return 0;
+
+	memset(&capture->txhdr.hdr, 0, sizeof(capture->txhdr.hdr));
 	ip->ip_v = 4;
 	ip->ip_hl = 5;
-	ip->ip_id = 0;
 	ip->ip_tos = IPTOS_LOWDELAY;
-	ip->ip_len = htons(sizeof(*ip) + udp_len);
-	ip->ip_id = 0;
 	ip->ip_off = htons(IP_DF);
 	ip->ip_ttl = IPDEFTTL;
 	ip->ip_p = IPPROTO_UDP;
 	ip->ip_src = src_addr;
 	ip->ip_dst = dst_addr;
-	if (ip->ip_dst.s_addr == 0)
-		ip->ip_dst.s_addr = INADDR_BROADCAST;
-	ip->ip_sum = 0;
 
-	/* Finally, do the checksums */
-	ip->ip_sum = checksum( ip, sizeof(*ip));
-	udp->uh_sum = ipudp_checksum(ip, udp, payload, payload_len);
+	udp->uh_sport = htons(src_port);
+	udp->uh_dport = htons(dst_port);
 
+	bs.c[0] = 0;
+	bs.c[1] = IPPROTO_UDP;
+	capture->txhdr.pseudo = checksum_partial(bs.s,
+				&ip->ip_src, 2 * sizeof(ip->ip_src));
+	capture->txhdr.valid = TRUE;
 	return 0;
 }
 
@@ -343,7 +442,7 @@ ni_capture_force_retransmit(ni_capture_t *capture, unsigned int delay)
 	if (timerisset(&capture->retrans.deadline)) {
 		struct timeval *deadline = &capture->retrans.deadline;
 
-		gettimeofday(deadline, NULL);
+		ni_timer_get_time(deadline);
 		deadline->tv_sec += delay;
 	}
 }
@@ -497,20 +596,33 @@ ni_capture_from_hwaddr_print(const ni_sockaddr_t *from)
 int
 ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, const char *hint)
 {
+	void *data;
 	void *payload;
 	size_t payload_len;
 	ssize_t bytes;
 	ni_bool_t partial_checksum = FALSE;
 	const char *lladdr;
 
-	bytes = __ni_capture_recv(capture->sock->__fd, capture->buffer,
-				  capture->mtu, &partial_checksum, from);
+	if (capture->rx.count != 0) {
+		/* consume the datagram queued by the batch drain */
+		unsigned int i = capture->rx.next;
 
-	if (bytes < 0) {
-		ni_error("%s: %s cannot read %s%spacket from socket: %m",
-				capture->ifname, __FUNCTION__,
-				hint ? hint : "", hint ? " " : "");
-		return -1;
+		data = ni_buffer_head(capture->rx.buf[i]);
+		bytes = capture->rx.len[i];
+		partial_checksum = capture->rx.partial_csum[i];
+		if (from)
+			*from = capture->rx.from[i];
+	} else {
+		data = ni_buffer_head(capture->buffer);
+		bytes = __ni_capture_recv(capture->sock->__fd, data,
+					  capture->mtu, &partial_checksum, from);
+
+		if (bytes < 0) {
+			ni_error("%s: %s cannot read %s%spacket from socket: %m",
+					capture->ifname, __FUNCTION__,
+					hint ? hint : "", hint ? " " : "");
+			return -1;
+		}
 	}
 
 	lladdr = ni_capture_from_hwaddr_print(from);
@@ -522,7 +634,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	switch (capture->protocol) {
 	case ETHERTYPE_IP:
 		/* Make sure IP and UDP header are sane */
-		payload = ni_capture_inspect_udp_header(capture->buffer, bytes,
+		payload = ni_capture_inspect_udp_header(data, bytes,
 						&payload_len, partial_checksum);
 		if (payload == NULL) {
 			ni_debug_socket("%s: bad IP/UDP %s%spacket header",
@@ -534,7 +646,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 
 	case ETHERTYPE_ARP:
 	case ETHERTYPE_LLDP:
-		payload = capture->buffer;
+		payload = data;
 		payload_len = bytes;
 		break;
 
@@ -548,6 +660,110 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	return payload_len;
 }
 
+/*
+ * Batched receive: drain the socket in one recvmmsg(2) burst into
+ * buffers from the recycling cache and dispatch the queued datagrams
+ * to the consumer callback one at a time, each consumed by its
+ * ni_capture_recv() call. During ARP or DHCP storms this replaces one
+ * syscall per packet with one per NI_CAPTURE_BATCH_MAX packets.
+ */
+static void
+__ni_capture_batch_receive(ni_socket_t *sock)
+{
+	ni_capture_t *capture;
+	struct mmsghdr mmsg[NI_CAPTURE_BATCH_MAX];
+	struct iovec iov[NI_CAPTURE_BATCH_MAX];
+#if defined(PACKET_AUXDATA)
+	/* use 2 times bigger buffer to catch possible additions... */
+	unsigned char cbuf[NI_CAPTURE_BATCH_MAX][CMSG_SPACE(sizeof(struct tpacket_auxdata)*2)];
+#endif
+	unsigned int i, n;
+	int rv;
+
+	if (!(capture = sock->user_data)) {
+		ni_error("capture socket without capture object?!");
+		return;
+	}
+
+	memset(mmsg, 0, sizeof(mmsg));
+	memset(capture->rx.from, 0, sizeof(capture->rx.from));
+	for (i = 0; i < NI_CAPTURE_BATCH_MAX; ++i) {
+		capture->rx.buf[i] = ni_buffer_cache_get(capture->mtu);
+		iov[i].iov_base = ni_buffer_head(capture->rx.buf[i]);
+		iov[i].iov_len = capture->mtu;
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+		mmsg[i].msg_hdr.msg_name = &capture->rx.from[i];
+		mmsg[i].msg_hdr.msg_namelen = sizeof(capture->rx.from[i].ss);
+#if defined(PACKET_AUXDATA)
+		memset(cbuf[i], 0, sizeof(cbuf[i]));
+		mmsg[i].msg_hdr.msg_control = cbuf[i];
+		mmsg[i].msg_hdr.msg_controllen = sizeof(cbuf[i]);
+#endif
+	}
+
+	rv = recvmmsg(sock->__fd, mmsg, NI_CAPTURE_BATCH_MAX, MSG_DONTWAIT, NULL);
+	n = rv > 0 ? (unsigned int)rv : 0;
+
+	for (i = 0; i < n; ++i) {
+		capture->rx.len[i] = mmsg[i].msg_len;
+		capture->rx.partial_csum[i] = FALSE;
+#if defined(PACKET_AUXDATA)
+		{
+			struct msghdr *msg = &mmsg[i].msg_hdr;
+			struct tpacket_auxdata *aux;
+			struct cmsghdr *cmsg;
+
+			for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+				if (cmsg->cmsg_level == SOL_PACKET &&
+				    cmsg->cmsg_type == PACKET_AUXDATA &&
+				    cmsg->cmsg_len >= CMSG_LEN(sizeof(struct tpacket_auxdata))) {
+					aux = (void *)CMSG_DATA(cmsg);
+					if (aux->tp_status & TP_STATUS_CSUMNOTREADY)
+						capture->rx.partial_csum[i] = TRUE;
+					break;
+				}
+			}
+		}
+#endif
+	}
+	/* return the unused tail to the cache */
+	for (i = n; i < NI_CAPTURE_BATCH_MAX; ++i) {
+		ni_buffer_release(capture->rx.buf[i]);
+		capture->rx.buf[i] = NULL;
+	}
+
+	if (rv < 0 && errno != EAGAIN && errno != EINTR) {
+		ni_error("%s: cannot read packets from capture socket: %m",
+				capture->ifname);
+	}
+
+	capture->rx.count = n;
+	capture->rx.dispatching = TRUE;
+	for (i = 0; i < n; ++i) {
+		capture->rx.next = i;
+		capture->rx.receive(sock);
+		ni_buffer_release(capture->rx.buf[i]);
+		capture->rx.buf[i] = NULL;
+
+		/* the callback closed the capture; stop dispatching */
+		if (capture->rx.defer_free) {
+			while (++i < n) {
+				ni_buffer_release(capture->rx.buf[i]);
+				capture->rx.buf[i] = NULL;
+			}
+			break;
+		}
+	}
+	capture->rx.count = 0;
+	capture->rx.dispatching = FALSE;
+
+	if (capture->rx.defer_free) {
+		capture->rx.defer_free = FALSE;
+		ni_capture_free(capture);
+	}
+}
+
 /*
  * Get/set user data
  */
@@ -715,7 +931,9 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 		goto failed;
 	ni_string_dup(&capture->ifname, devinfo->ifname);
 	capture->sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	capture->sock->priority = NI_SOCKET_PRIO_PROTOCOL;
 	capture->protocol = protinfo->eth_protocol;
+	capture->protinfo = *protinfo;
 
 	capture->addr.sll.sll_family = AF_PACKET;
 	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
@@ -742,9 +960,10 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	capture->mtu = devinfo->mtu;
 	if (capture->mtu == 0)
 		capture->mtu = MTU_MAX;
-	capture->buffer = xmalloc(capture->mtu);
+	capture->buffer = ni_buffer_cache_get(capture->mtu);
 
-	capture->sock->receive = receive;
+	capture->rx.receive = receive;
+	capture->sock->receive = __ni_capture_batch_receive;
 	capture->sock->get_timeout = __ni_capture_socket_get_timeout;
 	capture->sock->check_timeout = __ni_capture_socket_check_timeout;
 	capture->sock->user_data = capture;
@@ -781,6 +1000,17 @@ ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 			return -1;
 		}
 
+		if (protinfo->ip_xid) {
+			std_ipv4_xid_bpf_filter[1].k = protinfo->ip_protocol;
+			std_ipv4_xid_bpf_filter[6].k = protinfo->ip_port;
+			/* BPF loads the wire bytes as a big endian word */
+			std_ipv4_xid_bpf_filter[8].k = htonl(protinfo->ip_xid);
+
+			pf.filter = std_ipv4_xid_bpf_filter;
+			pf.len = sizeof(std_ipv4_xid_bpf_filter) / sizeof(std_ipv4_xid_bpf_filter[0]);
+			break;
+		}
+
 		std_ipv4_bpf_filter[1].k = protinfo->ip_protocol;
 		std_ipv4_bpf_filter[6].k = protinfo->ip_port;
 
@@ -801,9 +1031,33 @@ ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 	return 0;
 }
 
+/*
+ * Update the transaction id matched by the socket filter. Attaching a
+ * new filter replaces the old one; with xid 0 we fall back to matching
+ * the port only.
+ */
+int
+ni_capture_set_xid(ni_capture_t *cap, uint32_t xid)
+{
+	if (cap == NULL)
+		return -1;
+	if (cap->protinfo.ip_xid == xid)
+		return 0;
+
+	cap->protinfo.ip_xid = xid;
+	return ni_capture_set_filter(cap, &cap->protinfo);
+}
+
 ssize_t
 __ni_capture_send(const ni_capture_t *capture, const ni_buffer_t *buf)
 {
+	struct iovec iov[NI_BUFFER_CHAIN_MAXVEC + 1];
+	struct {
+		struct ip	ip;
+		struct udphdr	udp;
+	} hdr;
+	struct msghdr msg;
+	unsigned int niov;
 	ssize_t rv;
 
 	if (capture == NULL) {
@@ -811,8 +1065,52 @@ __ni_capture_send(const ni_capture_t *capture, const ni_buffer_t *buf)
 		return -1;
 	}
 
-	rv = sendto(capture->sock->__fd, ni_buffer_head(buf), ni_buffer_count(buf), 0,
-			&capture->addr.sa, sizeof(capture->addr));
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = (void *) &capture->addr.sa;
+	msg.msg_namelen = sizeof(capture->addr);
+	msg.msg_iov = iov;
+
+	if (capture->txhdr.valid) {
+		const ni_buffer_t *bp;
+		unsigned int plen = 0;
+		uint32_t csum;
+
+		if (!(niov = ni_buffer_chain_iovec(buf, iov + 1, NI_BUFFER_CHAIN_MAXVEC))) {
+			ni_error("%s: cannot flatten packet buffer chain", __FUNCTION__);
+			return -1;
+		}
+		for (bp = buf; bp; bp = bp->next)
+			plen += ni_buffer_count(bp);
+
+		/* patch the length fields of the header template and
+		 * fold the payload into the UDP checksum; the payload
+		 * buffers go out as they are. Concatenating the partial
+		 * sums requires all but the last chain element to be of
+		 * even length. */
+		memcpy(&hdr, &capture->txhdr.hdr, sizeof(hdr));
+		hdr.udp.uh_ulen = htons(sizeof(hdr.udp) + plen);
+		hdr.ip.ip_len = htons(sizeof(hdr.ip) + sizeof(hdr.udp) + plen);
+		hdr.ip.ip_sum = checksum(&hdr.ip, sizeof(hdr.ip));
+
+		csum = checksum_partial(capture->txhdr.pseudo + hdr.udp.uh_ulen,
+					&hdr.udp, sizeof(hdr.udp));
+		for (bp = buf; bp; bp = bp->next)
+			csum = checksum_partial(csum, ni_buffer_head(bp),
+						ni_buffer_count(bp));
+		hdr.udp.uh_sum = checksum_fold(csum);
+		if (hdr.udp.uh_sum == 0)
+			hdr.udp.uh_sum = 0xFFFF;
+
+		iov[0].iov_base = &hdr;
+		iov[0].iov_len = sizeof(hdr);
+		msg.msg_iovlen = niov + 1;
+	} else
+	if (!(msg.msg_iovlen = ni_buffer_chain_iovec(buf, iov, NI_BUFFER_CHAIN_MAXVEC))) {
+		ni_error("%s: cannot flatten packet buffer chain", __FUNCTION__);
+		return -1;
+	}
+
+	rv = sendmsg(capture->sock->__fd, &msg, 0);
 	if (rv < 0)
 		ni_error("unable to send dhcp packet: %m");
 
@@ -840,10 +1138,15 @@ ni_capture_free(ni_capture_t *capture)
 {
 	if (!capture)
 		return;
+	if (capture->rx.dispatching) {
+		/* called from inside a receive callback; the batch
+		 * dispatcher finishes the job once it unwinds */
+		capture->rx.defer_free = TRUE;
+		return;
+	}
 	if (capture->sock)
 		ni_socket_close(capture->sock);
-	if (capture->buffer)
-		free(capture->buffer);
+	ni_buffer_release(capture->buffer);
 	ni_string_free(&capture->ifname);
 	free(capture);
 }
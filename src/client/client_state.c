@@ -37,6 +37,57 @@ ni_client_state_filename(unsigned int ifindex, char *path, size_t size)
 			ifindex);
 }
 
+/*
+ * The client updates control, config and scripts separately, and each
+ * update used to rewrite the complete state file -- with hundreds of
+ * interfaces transitioning at boot, most of these rewrites store the
+ * very same content again. Remember the content written last per
+ * ifindex and skip the write when the state is unchanged; a checksum
+ * would risk silently losing a real change to a collision, and the
+ * buffers are small.
+ */
+struct ni_client_state_written {
+	struct ni_client_state_written *next;
+	unsigned int			ifindex;
+	char *				data;
+};
+
+static struct ni_client_state_written *	__ni_client_state_written;
+
+static struct ni_client_state_written *
+__ni_client_state_written_get(unsigned int ifindex, ni_bool_t create)
+{
+	struct ni_client_state_written *entry;
+
+	for (entry = __ni_client_state_written; entry; entry = entry->next) {
+		if (entry->ifindex == ifindex)
+			return entry;
+	}
+	if (!create)
+		return NULL;
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->ifindex = ifindex;
+	entry->next = __ni_client_state_written;
+	__ni_client_state_written = entry;
+	return entry;
+}
+
+static void
+__ni_client_state_written_forget(unsigned int ifindex)
+{
+	struct ni_client_state_written **pos, *entry;
+
+	for (pos = &__ni_client_state_written; (entry = *pos); pos = &entry->next) {
+		if (entry->ifindex == ifindex) {
+			*pos = entry->next;
+			ni_string_free(&entry->data);
+			free(entry);
+			return;
+		}
+	}
+}
+
 ni_bool_t
 ni_client_state_parse_timeval(const char *str, struct timeval *tv)
 {
@@ -124,6 +175,15 @@ ni_client_state_config_print_xml(const ni_client_state_config_t *conf, xml_node_
 	}
 	ni_string_free(&tmp);
 
+	if (conf->node) {
+		xml_node_t *data;
+
+		if (!(data = xml_node_new(NI_CLIENT_STATE_XML_CONFIG_DATA_NODE, parent)))
+			return FALSE;
+		if (!xml_node_clone(conf->node, data))
+			return FALSE;
+	}
+
 	return TRUE;
 }
 
@@ -218,6 +278,13 @@ ni_client_state_config_parse_xml(const xml_node_t *node, ni_client_state_config_
 			return FALSE;
 	}
 
+	/* within <config> node <data> carrying the applied config is optional */
+	child = xml_node_get_child(parent, NI_CLIENT_STATE_XML_CONFIG_DATA_NODE);
+	xml_node_free(conf->node);
+	conf->node = NULL;
+	if (child && child->children)
+		conf->node = xml_node_clone(child->children, NULL);
+
 	return TRUE;
 }
 
@@ -341,6 +408,7 @@ ni_client_state_free(ni_client_state_t *cs)
 {
 	if (cs) {
 		ni_string_free(&cs->config.origin);
+		xml_node_free(cs->config.node);
 		xml_node_free(cs->scripts.node);
 		free(cs);
 	}
@@ -360,6 +428,7 @@ ni_client_state_config_reset(ni_client_state_config_t *conf)
 {
 	if (conf) {
 		ni_string_free(&conf->origin);
+		xml_node_free(conf->node);
 		ni_client_state_config_init(conf);
 	}
 }
@@ -373,6 +442,8 @@ ni_client_state_config_copy(ni_client_state_config_t *conf,
 			conf->uuid = src->uuid;
 			conf->owner = src->owner;
 			ni_string_dup(&conf->origin, src->origin);
+			xml_node_free(conf->node);
+			conf->node = src->node ? xml_node_clone(src->node, NULL) : NULL;
 		} else {
 			ni_client_state_config_reset(conf);
 		}
@@ -432,15 +503,45 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 {
 	char path[PATH_MAX] = {'\0'};
 	char temp[PATH_MAX] = {'\0'};
+	struct ni_client_state_written *entry;
 	xml_node_t *node;
+	char *data = NULL;
+	size_t len;
 	FILE *fp = NULL;
 	int fd;
 
 	ni_client_state_filename(ifindex, path, sizeof(path));
+
+	if (!(node = xml_node_new(NI_CLIENT_STATE_XML_NODE, NULL))) {
+		ni_error("Cannot create %s node for %s", NI_CLIENT_STATE_XML_NODE, path);
+		return FALSE;
+	}
+
+	if (!ni_client_state_print_xml(client_state, node)) {
+		ni_error("Cannot format state into xml for %s", path);
+		xml_node_free(node);
+		return FALSE;
+	}
+
+	data = xml_node_sprint(node);
+	xml_node_free(node);
+	if (!data) {
+		ni_error("Cannot format state into xml for %s", path);
+		return FALSE;
+	}
+
+	/* don't rewrite the file when the state did not change */
+	entry = __ni_client_state_written_get(ifindex, FALSE);
+	if (entry && ni_string_eq(entry->data, data) && ni_file_exists(path)) {
+		ni_string_free(&data);
+		return TRUE;
+	}
+
 	snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
 
 	if ((fd = mkstemp(temp)) < 0) {
 		ni_error("Cannot create %s state temp file", path);
+		ni_string_free(&data);
 		return FALSE;
 	}
 	if (!(fp = fdopen(fd, "we"))) {
@@ -449,23 +550,11 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 		goto failure;
 	}
 
-	if (!(node = xml_node_new(NI_CLIENT_STATE_XML_NODE, NULL))) {
-		ni_error("Cannot create %s node for %s", NI_CLIENT_STATE_XML_NODE, path);
-		goto failure;
-	}
-
-	if (!ni_client_state_print_xml(client_state, node)) {
-		ni_error("Cannot format state into xml for %s", path);
-		xml_node_free(node);
-		goto failure;
-	}
-
-	if (xml_node_print(node, fp) < 0) {
+	len = strlen(data);
+	if (fwrite(data, 1, len, fp) != len) {
 		ni_error("Cannot write into %s state temp file", path);
-		xml_node_free(node);
 		goto failure;
 	}
-	xml_node_free(node);
 
 	if (rename(temp, path) < 0) {
 		ni_error("Cannot move temp file to state file %s", path);
@@ -474,6 +563,10 @@ ni_client_state_save(const ni_client_state_t *client_state, unsigned int ifindex
 
 	fclose(fp);
 
+	entry = __ni_client_state_written_get(ifindex, TRUE);
+	ni_string_free(&entry->data);
+	entry->data = data;
+
 	return TRUE;
 
 failure:
@@ -481,6 +574,7 @@ failure:
 		fclose(fp);
 	}
 	unlink(temp);
+	ni_string_free(&data);
 	return FALSE;
 }
 
@@ -534,6 +628,7 @@ ni_client_state_move(unsigned int ifindex_old, unsigned int ifindex_new)
 {
 	char path_old[PATH_MAX] = {'\0'};
 	char path_new[PATH_MAX] = {'\0'};
+	struct ni_client_state_written *entry;
 
 	if (ifindex_old == ifindex_new)
 		return TRUE;
@@ -550,6 +645,11 @@ ni_client_state_move(unsigned int ifindex_old, unsigned int ifindex_new)
 		ni_error("Cannot rename state %s to %s", path_old, path_new);
 		return FALSE;
 	}
+
+	__ni_client_state_written_forget(ifindex_new);
+	if ((entry = __ni_client_state_written_get(ifindex_old, FALSE)))
+		entry->ifindex = ifindex_new;
+
 	return TRUE;
 }
 
@@ -558,6 +658,7 @@ ni_client_state_drop(unsigned int ifindex)
 {
 	char path[PATH_MAX] = {'\0'};
 
+	__ni_client_state_written_forget(ifindex);
 	ni_client_state_filename(ifindex, path, sizeof(path));
 
 	if (unlink(path) < 0) {
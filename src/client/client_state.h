@@ -23,6 +23,7 @@
 #define NI_CLIENT_STATE_XML_CONFIG_UUID_NODE	"uuid"
 #define NI_CLIENT_STATE_XML_CONFIG_ORIGIN_NODE	"origin"
 #define NI_CLIENT_STATE_XML_CONFIG_OWNER_NODE	"owner-uid"
+#define NI_CLIENT_STATE_XML_CONFIG_DATA_NODE	"data"
 
 #define NI_CLIENT_STATE_XML_SCRIPTS_NODE	"scripts"
 
@@ -37,9 +38,10 @@ typedef struct ni_client_state_config {
 	ni_uuid_t	uuid;		/* Configuration UUID marker of the interface */
 	char *		origin;		/* Source of the configuration of the interface */
 	uid_t		owner;		/* User's UID who has initiated the given configuration */
+	xml_node_t *	node;		/* Applied configuration document, used for diffing */
 } ni_client_state_config_t;
 
-#define NI_CLIENT_STATE_CONFIG_INIT { .uuid = NI_UUID_INIT, .origin = NULL, .owner = -1U }
+#define NI_CLIENT_STATE_CONFIG_INIT { .uuid = NI_UUID_INIT, .origin = NULL, .owner = -1U, .node = NULL }
 
 typedef struct ni_client_state_scripts {
 	xml_node_t *	node;		/* Custom scripts to store in state */
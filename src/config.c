@@ -13,6 +13,7 @@
 #include <ctype.h>
 #include <limits.h>
 #include <dlfcn.h>
+#include <sys/stat.h>
 #include <netinet/if_ether.h>
 
 #include <wicked/util.h>
@@ -25,6 +26,7 @@
 #include "netinfo_priv.h"
 #include "util_priv.h"
 #include "appconfig.h"
+#include "process.h"
 #include "xml-schema.h"
 #include "dhcp.h"
 #include "duid.h"
@@ -39,6 +41,7 @@ static const char *__ni_ifconfig_source_types[] = {
 static ni_bool_t	ni_config_parse_addrconf_dhcp4(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_addrconf_dhcp6(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_addrconf_auto6(ni_config_auto6_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_addrconf_lease_files(const xml_node_t *);
 static void		ni_config_parse_update_targets(unsigned int *, const xml_node_t *);
 static void		ni_config_parse_update_dhcp4_routes(unsigned int *, const xml_node_t *);
 static void		ni_config_parse_fslocation(ni_config_fslocation_t *, xml_node_t *);
@@ -49,10 +52,15 @@ static ni_bool_t	ni_config_parse_system_updater(ni_extension_t **, xml_node_t *)
 static ni_bool_t	ni_config_parse_extension(ni_extension_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_sources(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_rtnl_event(ni_config_rtnl_event_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_rtnl_pacing(ni_config_rtnl_pacing_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_bonding(ni_config_bonding_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_teamd(ni_config_teamd_t *, const xml_node_t *);
 static ni_c_binding_t *	ni_c_binding_new(ni_c_binding_t **, const char *name, const char *lib, const char *symbol);
-static const char *	ni_config_build_include(const char *, const char *);
+static const char *	ni_config_build_include(char *, size_t, const char *, const char *);
+static ni_bool_t	__ni_config_parse_node(ni_config_t *, const char *, xml_node_t *,
+					ni_init_appdata_callback_t *, void *);
+extern ni_bool_t	__ni_config_parse(ni_config_t *, const char *,
+					ni_init_appdata_callback_t *, void *);
 static unsigned int	ni_config_addrconf_update_mask_all(void);
 static unsigned int	ni_config_addrconf_update_mask_dhcp4(void);
 static unsigned int	ni_config_addrconf_update_mask_dhcp6(void);
@@ -92,6 +100,17 @@ ni_config_new()
 	conf->rtnl_event.recv_buff_length = 1024 * 1024;
 	conf->rtnl_event.mesg_buff_length = 0;
 
+	/* opt-in for routers holding full routing feeds */
+	conf->compact_foreign_routes = FALSE;
+
+	/* opt-in; older servers expect complete lease dicts */
+	conf->differential_lease_updates = FALSE;
+
+	/* pacing is opt-in; the zero rate keeps it disabled */
+	conf->rtnl_pacing.bulk_rate = 0;
+	conf->rtnl_pacing.burst = 32;
+	conf->rtnl_pacing.max_outstanding = 0;
+
 	/* we enable it explicitly in wickedd only */
 	conf->teamd.enabled = FALSE;
 
@@ -114,6 +133,7 @@ ni_config_dhcp4_clone(const ni_config_dhcp4_t *src, const char *device)
 	ni_string_dup(&dst->device, device);
 
 	dst->lease_time = src->lease_time;
+	dst->renew_rate_limit = src->renew_rate_limit;
 	dst->allow_update = src->allow_update;
 	ni_string_dup(&dst->vendor_class, src->vendor_class);
 	ni_string_array_copy(&dst->ignore_servers, &src->ignore_servers);
@@ -178,6 +198,7 @@ ni_config_dhcp6_clone(const ni_config_dhcp6_t *src, const char *device)
 
 	dst->lease_time = src->lease_time;
 	dst->allow_update = src->allow_update;
+	dst->shared_socket = src->shared_socket;
 	ni_string_dup(&dst->default_duid, src->default_duid);
 	dst->create_duid = src->create_duid;
 	dst->device_duid = src->device_duid;
@@ -258,28 +279,183 @@ ni_config_free(ni_config_t *conf)
 	free(conf);
 }
 
-ni_bool_t
-__ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callback_t *cb, void *appdata)
+/*
+ * Compiled configuration cache.
+ *
+ * ni_config_parse resolves a tree of <include> files through the XML
+ * stack at every daemon start, and the wicked daemons each parse
+ * overlapping files. While parsing, the resolved configuration is
+ * flattened into a single cache document in the (compile time) statedir
+ * together with the list of source files and their stat stamps; as long
+ * as no source changed, later starts parse just that one file and skip
+ * the include resolution entirely. The cache is invalidated whenever a
+ * source appears, disappears or changes, and wickedd --check-config
+ * rebuilds it explicitly.
+ */
+#define NI_CONFIG_CACHE_VERSION		"1"
+
+ni_bool_t		ni_config_cache_refresh = FALSE;
+
+static xml_document_t *	__ni_config_cache_doc;		/* cache being built */
+static xml_node_t *	__ni_config_cache_root;		/* its <cache> element */
+static xml_node_t *	__ni_config_cache_config;	/* flattened <config> */
+
+static const char *
+__ni_config_cache_path(const char *filename)
+{
+	static char pathname[PATH_MAX];
+
+	snprintf(pathname, sizeof(pathname), "%s/%s.cache",
+			WICKED_STATEDIR, ni_basename(filename));
+	return pathname;
+}
+
+static void
+__ni_config_cache_stamp(const char *path, char *stamp, size_t size)
+{
+	struct stat stb;
+
+	if (stat(path, &stb) == 0)
+		snprintf(stamp, size, "%lu.%09lu:%llu",
+				(unsigned long)stb.st_mtim.tv_sec,
+				(unsigned long)stb.st_mtim.tv_nsec,
+				(unsigned long long)stb.st_size);
+	else
+		stamp[0] = '\0';
+}
+
+static void
+__ni_config_cache_begin(void)
+{
+	__ni_config_cache_doc = xml_document_new();
+	__ni_config_cache_root = xml_node_new("cache", __ni_config_cache_doc->root);
+	xml_node_add_attr(__ni_config_cache_root, "version", NI_CONFIG_CACHE_VERSION);
+	__ni_config_cache_config = xml_node_new("config", __ni_config_cache_root);
+}
+
+static void
+__ni_config_cache_abort(void)
 {
+	if (__ni_config_cache_doc)
+		xml_document_free(__ni_config_cache_doc);
+	__ni_config_cache_doc = NULL;
+	__ni_config_cache_root = NULL;
+	__ni_config_cache_config = NULL;
+}
+
+static void
+__ni_config_cache_add_source(const char *path)
+{
+	xml_node_t *node;
+	char stamp[128];
+
+	if (!__ni_config_cache_doc)
+		return;
+
+	node = xml_node_new("source", __ni_config_cache_root);
+	xml_node_add_attr(node, "path", path);
+
+	__ni_config_cache_stamp(path, stamp, sizeof(stamp));
+	if (stamp[0] != '\0')
+		xml_node_add_attr(node, "stamp", stamp);
+	else
+		xml_node_add_attr(node, "absent", "true");
+}
+
+static void
+__ni_config_cache_store(const char *filename)
+{
+	const char *cachefile;
+
+	if (!__ni_config_cache_doc)
+		return;
+
+	cachefile = __ni_config_cache_path(filename);
+	if (xml_document_write(__ni_config_cache_doc, cachefile) < 0)
+		ni_debug_wicked("unable to write config cache %s", cachefile);
+	else
+		ni_debug_wicked("wrote compiled config cache %s", cachefile);
+
+	__ni_config_cache_abort();
+}
+
+static ni_config_t *
+__ni_config_parse_cache(const char *filename, ni_init_appdata_callback_t *cb, void *appdata)
+{
+	const char *cachefile = __ni_config_cache_path(filename);
 	xml_document_t *doc;
-	xml_node_t *node, *child;
+	xml_node_t *cache, *node, *child;
+	ni_bool_t first = TRUE;
+	ni_config_t *conf;
+	char stamp[128];
 
-	ni_debug_wicked("Reading config file %s", filename);
-	doc = xml_document_read(filename);
-	if (!doc) {
-		ni_error("%s: error parsing configuration file", filename);
-		goto failed;
+	if (ni_config_cache_refresh || !ni_file_exists(cachefile))
+		return NULL;
+
+	if (!(doc = xml_document_read(cachefile)))
+		return NULL;
+
+	if (!(cache = xml_node_get_child(doc->root, "cache"))
+	 || !ni_string_eq(xml_node_get_attr(cache, "version"), NI_CONFIG_CACHE_VERSION)
+	 || !(node = xml_node_get_child(cache, "config")))
+		goto invalid;
+
+	/* Verify that all recorded source files are unchanged */
+	for (child = cache->children; child; child = child->next) {
+		const char *path;
+
+		if (!ni_string_eq(child->name, "source"))
+			continue;
+		if (!(path = xml_node_get_attr(child, "path")))
+			goto invalid;
+		if (first) {
+			/* the first source is the toplevel config file */
+			if (!ni_string_eq(path, filename))
+				goto invalid;
+			first = FALSE;
+		}
+
+		__ni_config_cache_stamp(path, stamp, sizeof(stamp));
+		if (xml_node_get_attr(child, "absent")) {
+			if (stamp[0] != '\0')
+				goto invalid;
+		} else
+		if (!ni_string_eq(xml_node_get_attr(child, "stamp"), stamp))
+			goto invalid;
 	}
+	if (first)
+		goto invalid;
 
-	node = xml_node_get_child(doc->root, "config");
-	if (!node) {
-		ni_error("%s: no <config> element", filename);
-		goto failed;
+	conf = ni_config_new();
+	if (!__ni_config_parse_node(conf, cachefile, node, cb, appdata)) {
+		ni_config_free(conf);
+		goto invalid;
 	}
 
+	ni_debug_wicked("Using compiled config cache %s for %s", cachefile, filename);
+	xml_document_free(doc);
+	return conf;
+
+invalid:
+	xml_document_free(doc);
+	return NULL;
+}
+
+static ni_bool_t
+__ni_config_parse_node(ni_config_t *conf, const char *filename, xml_node_t *node,
+		ni_init_appdata_callback_t *cb, void *appdata)
+{
+	xml_node_t *child;
+
 	/* Loop over all elements in the config file */
 	for (child = node->children; child; child = child->next) {
+		/* Includes are resolved here; everything else goes into
+		 * the flattened cache document as is. */
+		if (__ni_config_cache_doc && strcmp(child->name, "include") != 0)
+			xml_node_clone(child, __ni_config_cache_config);
+
 		if (strcmp(child->name, "include") == 0) {
+			char pathbuf[PATH_MAX + 1];
 			const char *attrval, *path;
 			ni_bool_t optional = FALSE;
 
@@ -294,12 +470,14 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				ni_error("%s: <include> element lacks filename", xml_node_location(child));
 				goto failed;
 			}
-			if (!(path = ni_config_build_include(filename, attrval)))
+			if (!(path = ni_config_build_include(pathbuf, sizeof(pathbuf), filename, attrval)))
 				goto failed;
 			/* If the file is marked as optional, but does not exist, silently
-			 * skip it */
-			if (optional && !ni_file_exists(path))
+			 * skip it; record it so its appearance invalidates the cache */
+			if (optional && !ni_file_exists(path)) {
+				__ni_config_cache_add_source(path);
 				continue;
+			}
 			if (!__ni_config_parse(conf, path, cb, appdata))
 				goto failed;
 		} else
@@ -376,6 +554,10 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				if (!strcmp(gchild->name, "auto6")
 				 && !ni_config_parse_addrconf_auto6(&conf->addrconf.auto6, gchild))
 					goto failed;
+
+				if (!strcmp(gchild->name, "lease-files")
+				 && !ni_config_parse_addrconf_lease_files(gchild))
+					goto failed;
 			}
 		} else
 		if (strcmp(child->name, "sources") == 0) {
@@ -406,6 +588,28 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			if (!ni_config_parse_rtnl_event(&conf->rtnl_event, child))
 				goto failed;
 		} else
+		if (strcmp(child->name, "netlink-pacing") == 0) {
+			if (!ni_config_parse_rtnl_pacing(&conf->rtnl_pacing, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "link-stats-interval") == 0) {
+			if (ni_parse_uint(child->cdata, &conf->link_stats_interval, 0))
+				goto failed;
+		} else
+		if (strcmp(child->name, "compact-foreign-routes") == 0) {
+			if (ni_parse_boolean(child->cdata, &conf->compact_foreign_routes)) {
+				ni_error("%s: invalid <%s>%s</%s> element value",
+					filename, child->name, child->cdata, child->name);
+				goto failed;
+			}
+		} else
+		if (strcmp(child->name, "differential-lease-updates") == 0) {
+			if (ni_parse_boolean(child->cdata, &conf->differential_lease_updates)) {
+				ni_error("%s: invalid <%s>%s</%s> element value",
+					filename, child->name, child->cdata, child->name);
+				goto failed;
+			}
+		} else
 		if (strcmp(child->name, "bonding") == 0) {
 			if (!ni_config_parse_bonding(&conf->bonding, child))
 				goto failed;
@@ -427,39 +631,65 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 		ni_config_fslocation_init(&conf->backupdir, pathname, 0700);
 	}
 
-	xml_document_free(doc);
 	return TRUE;
 
 failed:
-	if (doc)
-		xml_document_free(doc);
 	return FALSE;
 }
 
+ni_bool_t
+__ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callback_t *cb, void *appdata)
+{
+	xml_document_t *doc;
+	xml_node_t *node;
+	ni_bool_t rv = FALSE;
+
+	ni_debug_wicked("Reading config file %s", filename);
+	doc = xml_document_read(filename);
+	if (!doc) {
+		ni_error("%s: error parsing configuration file", filename);
+		return FALSE;
+	}
+
+	__ni_config_cache_add_source(filename);
+
+	if (!(node = xml_node_get_child(doc->root, "config")))
+		ni_error("%s: no <config> element", filename);
+	else
+		rv = __ni_config_parse_node(conf, filename, node, cb, appdata);
+
+	xml_document_free(doc);
+	return rv;
+}
+
 ni_config_t *
 ni_config_parse(const char *filename, ni_init_appdata_callback_t *cb, void *appdata)
 {
 	ni_config_t *conf;
 
+	if ((conf = __ni_config_parse_cache(filename, cb, appdata)) != NULL)
+		return conf;
+
 	conf = ni_config_new();
+	__ni_config_cache_begin();
 	if (!__ni_config_parse(conf, filename, cb, appdata)) {
+		__ni_config_cache_abort();
 		ni_config_free(conf);
 		return NULL;
 	}
+	__ni_config_cache_store(filename);
 
 	return conf;
 }
 
 const char *
-ni_config_build_include(const char *parent_filename, const char *incl_filename)
+ni_config_build_include(char *fullname, size_t size, const char *parent_filename, const char *incl_filename)
 {
-	char fullname[PATH_MAX + 1];
-
 	if (incl_filename[0] != '/') {
 		unsigned int i;
 
 		i = strlen(parent_filename);
-		if (i >= PATH_MAX)
+		if (i >= size - 1)
 			goto too_long;
 		strcpy(fullname, parent_filename);
 
@@ -467,7 +697,7 @@ ni_config_build_include(const char *parent_filename, const char *incl_filename)
 			--i;
 		fullname[i] = '\0';
 
-		if (i + strlen(incl_filename) >= PATH_MAX)
+		if (i + strlen(incl_filename) >= size - 1)
 			goto too_long;
 		strcpy(&fullname[i], incl_filename);
 		incl_filename = fullname;
@@ -530,6 +760,9 @@ ni_config_parse_addrconf_dhcp4_nodes(ni_config_dhcp4_t *dhcp4, xml_node_t *node)
 		if (!strcmp(child->name, "lease-time") && child->cdata)
 			dhcp4->lease_time = strtoul(child->cdata, NULL, 0);
 		else
+		if (!strcmp(child->name, "renew-rate-limit") && child->cdata)
+			dhcp4->renew_rate_limit = strtoul(child->cdata, NULL, 0);
+		else
 		if (!strcmp(child->name, "ignore-server")) {
 			if ((attrval = xml_node_get_attr(child, "ip")) != NULL)
 				ni_string_array_append(&dhcp4->ignore_servers, attrval);
@@ -1076,6 +1309,11 @@ ni_config_parse_addrconf_dhcp6_nodes(ni_config_dhcp6_t *dhcp6, xml_node_t *node)
 		if (!strcmp(child->name, "release-retransmits") && child->cdata) {
 			dhcp6->release_nretries = strtoul(child->cdata, NULL, 0);
 		} else
+		if (!strcmp(child->name, "shared-socket") && child->cdata) {
+			if (ni_parse_boolean(child->cdata, &dhcp6->shared_socket)) {
+				ni_warn("config: discarding invalid shared-socket value");
+			}
+		} else
 		if (!strcmp(child->name, "info-refresh-time")) {
 			const char *attrval;
 			unsigned int value;
@@ -1236,6 +1474,48 @@ ni_config_parse_addrconf_auto6(ni_config_auto6_t *auto6, xml_node_t *node)
 	return TRUE;
 }
 
+/*
+ * Lease file persistence tuning: how long lease updates may be coalesced
+ * in memory before they hit the disk, and whether commits are fsync'ed.
+ */
+static ni_bool_t
+ni_config_parse_addrconf_lease_files(const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "flush-delay")) {
+			unsigned int msec;
+
+			if (ni_parse_uint(child->cdata, &msec, 0) < 0) {
+				ni_error("config: invalid <lease-files><flush-delay> value \"%s\"",
+						child->cdata);
+				return FALSE;
+			}
+			ni_addrconf_lease_file_set_flush_delay(msec);
+		} else
+		if (ni_string_eq(child->name, "fsync")) {
+			if (!ni_addrconf_lease_file_set_fsync_policy(child->cdata)) {
+				ni_error("config: invalid <lease-files><fsync> policy \"%s\" "
+						"(expected always, deadline or never)",
+						child->cdata);
+				return FALSE;
+			}
+		} else
+		if (ni_string_eq(child->name, "journal")) {
+			ni_bool_t enable;
+
+			if (ni_parse_boolean(child->cdata, &enable) != 0) {
+				ni_error("config: invalid <lease-files><journal> value \"%s\"",
+						child->cdata);
+				return FALSE;
+			}
+			ni_addrconf_lease_file_set_journal(enable);
+		}
+	}
+	return TRUE;
+}
+
 void
 ni_config_parse_update_targets(unsigned int *update_mask, const xml_node_t *node)
 {
@@ -1311,6 +1591,8 @@ ni_config_parse_fslocation(ni_config_fslocation_t *fsloc, xml_node_t *node)
  *  <action name="dbusMethodName" command="/some/shell/scripts some-args"/>
  *  <builtin name="dbusOtherMethodName" library="/usr/lib/libfoo.so" symbol="c_method_impl_name"/>
  *
+ *  <worker command="/some/persistent/helper" max-pending="2"/>
+ *
  *  <putenv name="WICKED_OBJECT_PATH" value="$object-path"/>
  *  <putenv name="WICKED_INTERFACE_NAME" value="$property:name"/>
  *  <putenv name="WICKED_INTERFACE_INDEX" value="$property:index"/>
@@ -1336,6 +1618,8 @@ ni_config_parse_objectmodel_extension(ni_extension_t **list, xml_node_t *node)
 static ni_bool_t
 ni_config_parse_extension(ni_extension_t *ex, xml_node_t *node)
 {
+	const char *worker_command = NULL;
+	unsigned int worker_max_pending = 0;
 	xml_node_t *child;
 
 	for (child = node->children; child; child = child->next) {
@@ -1379,6 +1663,36 @@ ni_config_parse_extension(ni_extension_t *ex, xml_node_t *node)
 			}
 			value = xml_node_get_attr(child, "value");
 			ni_var_array_set(&ex->environment, name, value);
+		} else
+		if (!strcmp(child->name, "worker")) {
+			const char *attrval;
+
+			if (!(worker_command = xml_node_get_attr(child, "command"))) {
+				ni_error("%s: <worker> element without command attribute",
+						xml_node_location(child));
+				return FALSE;
+			}
+			if ((attrval = xml_node_get_attr(child, "max-pending")) &&
+			    ni_parse_uint(attrval, &worker_max_pending, 10) < 0) {
+				ni_error("%s: cannot parse worker max-pending attribute",
+						xml_node_location(child));
+				return FALSE;
+			}
+		}
+	}
+
+	/* Route all script actions through the persistent worker; it is
+	 * shared between extensions referring to the same command. */
+	if (worker_command) {
+		ni_process_worker_t *worker;
+		ni_script_action_t *action;
+
+		if (!(worker = ni_process_worker_get(worker_command, worker_max_pending)))
+			return FALSE;
+
+		for (action = ex->actions; action; action = action->next) {
+			if (action->process)
+				action->process->worker = worker;
 		}
 	}
 
@@ -1540,6 +1854,34 @@ ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 	return TRUE;
 }
 
+/*
+ * netlink configuration transaction pacing tunables
+ */
+ni_bool_t
+ni_config_parse_rtnl_pacing(ni_config_rtnl_pacing_t *conf, xml_node_t *node)
+{
+	xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "bulk-rate")) {
+			if (ni_parse_uint(child->cdata, &conf->bulk_rate, 0))
+				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "burst")) {
+			if (ni_parse_uint(child->cdata, &conf->burst, 0))
+				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "max-outstanding")) {
+			if (ni_parse_uint(child->cdata, &conf->max_outstanding, 0))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /*
  * bonding support config options
  */
@@ -1946,6 +2288,42 @@ ni_config_use_nanny(void)
 	return ni_global.config ? ni_global.config->use_nanny : FALSE;
 }
 
+unsigned int
+ni_config_link_stats_interval(void)
+{
+	return ni_global.config ? ni_global.config->link_stats_interval : 0;
+}
+
+ni_bool_t
+ni_config_compact_foreign_routes(void)
+{
+	return ni_global.config ? ni_global.config->compact_foreign_routes : FALSE;
+}
+
+ni_bool_t
+ni_config_differential_lease_updates(void)
+{
+	return ni_global.config ? ni_global.config->differential_lease_updates : FALSE;
+}
+
+unsigned int
+ni_config_rtnl_pacing_rate(void)
+{
+	return ni_global.config ? ni_global.config->rtnl_pacing.bulk_rate : 0;
+}
+
+unsigned int
+ni_config_rtnl_pacing_burst(void)
+{
+	return ni_global.config ? ni_global.config->rtnl_pacing.burst : 0;
+}
+
+unsigned int
+ni_config_rtnl_pacing_outstanding(void)
+{
+	return ni_global.config ? ni_global.config->rtnl_pacing.max_outstanding : 0;
+}
+
 void
 ni_config_fslocation_init(ni_config_fslocation_t *loc, const char *path, unsigned int mode)
 {
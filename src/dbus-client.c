@@ -470,6 +470,56 @@ ni_dbus_object_call_async(ni_dbus_object_t *proxy,
 	return rv;
 }
 
+/*
+ * Asynchronous variant of ni_dbus_object_call_variant. The reply message
+ * is handed to the completion callback as-is (which may be a dbus error
+ * message), together with the caller provided context pointer.
+ */
+int
+ni_dbus_object_call_variant_async(ni_dbus_object_t *proxy,
+			const char *interface_name, const char *method,
+			unsigned int nargs, const ni_dbus_variant_t *args,
+			ni_dbus_async_data_callback_t *callback, void *user_data)
+{
+	ni_dbus_message_t *call = NULL;
+	ni_dbus_client_t *client;
+	DBusError error = DBUS_ERROR_INIT;
+	int rv;
+
+	if (!proxy || !(client = ni_dbus_object_get_client(proxy))) {
+		ni_error("%s: bad proxy object", __func__);
+		return -NI_ERROR_INVALID_ARGS;
+	}
+
+	if (interface_name == NULL)
+		interface_name = ni_dbus_object_get_default_interface(proxy);
+	if (interface_name == NULL) {
+		ni_error("%s: no registered dbus interface provides method %s",
+				proxy->path, method);
+		return -NI_ERROR_METHOD_NOT_SUPPORTED;
+	}
+
+	NI_TRACE_ENTER_ARGS("%s, if=%s, method=%s", proxy->path, interface_name, method);
+	call = dbus_message_new_method_call(client->bus_name, proxy->path, interface_name, method);
+	if (call == NULL) {
+		ni_error("%s: unable to build %s() message", __func__, method);
+		return -NI_ERROR_DBUS_CALL_FAILED;
+	}
+
+	if (nargs && !ni_dbus_message_serialize_variants(call, nargs, args, &error)) {
+		ni_dbus_print_error(&error, "%s: unable to serialize %s() arguments", __func__, method);
+		dbus_error_free(&error);
+		dbus_message_unref(call);
+		return -NI_ERROR_CANNOT_MARSHAL;
+	}
+
+	rv = ni_dbus_connection_call_async_data(client->connection,
+			call, client->call_timeout,
+			callback, proxy, user_data);
+	dbus_message_unref(call);
+	return rv;
+}
+
 /*
  * Use ObjectManager.GetManagedObjects to retrieve (part of)
  * the server's object hierarchy
@@ -832,6 +882,62 @@ out:
 	return rv;
 }
 
+/*
+ * Asynchronous variant of ni_dbus_object_refresh_properties. The GetAll
+ * call is placed without blocking; when the reply arrives, the object's
+ * properties are updated and the caller's completion callback is invoked.
+ * The callback also runs on an error reply (with the error message), so
+ * it can serve as a completion barrier when refreshing many objects in
+ * parallel.
+ */
+struct __ni_dbus_object_async_refresh {
+	const ni_dbus_service_t *service;
+	ni_dbus_async_data_callback_t *callback;
+	void *			user_data;
+};
+
+static void
+__ni_dbus_object_refresh_properties_done(ni_dbus_object_t *proxy, ni_dbus_message_t *reply, void *user_data)
+{
+	struct __ni_dbus_object_async_refresh *ctx = user_data;
+	DBusMessageIter iter;
+
+	if (reply && dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN) {
+		dbus_message_iter_init(reply, &iter);
+		if (!__ni_dbus_object_refresh_properties(proxy, ctx->service, &iter))
+			ni_debug_dbus("%s: failed to parse %s.GetAll reply",
+					proxy->path, ctx->service->name);
+	}
+
+	if (ctx->callback)
+		ctx->callback(proxy, reply, ctx->user_data);
+	free(ctx);
+}
+
+int
+ni_dbus_object_refresh_properties_async(ni_dbus_object_t *proxy, const ni_dbus_service_t *service,
+			ni_dbus_async_data_callback_t *callback, void *user_data)
+{
+	struct __ni_dbus_object_async_refresh *ctx;
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	int rv;
+
+	ctx = calloc(1, sizeof(*ctx));
+	ctx->service = service;
+	ctx->callback = callback;
+	ctx->user_data = user_data;
+
+	ni_dbus_variant_set_string(&arg, service->name);
+	rv = ni_dbus_object_call_variant_async(proxy,
+			NI_DBUS_INTERFACE ".Properties", "GetAll",
+			1, &arg, __ni_dbus_object_refresh_properties_done, ctx);
+	ni_dbus_variant_destroy(&arg);
+
+	if (rv < 0)
+		free(ctx);
+	return rv;
+}
+
 /*
  * Use Properties.Set to update one properties of an object
  */
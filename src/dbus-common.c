@@ -107,7 +107,7 @@ ni_dbus_message_get_args_variants(ni_dbus_message_t *msg, ni_dbus_variant_t *arg
 			iter_p = &iter_val;
 		}
 
-		if (!ni_dbus_message_iter_get_variant_data(iter_p, &argv[argc])) {
+		if (!ni_dbus_message_iter_get_variant_data_ref(iter_p, &argv[argc])) {
 			do {
 				ni_dbus_variant_destroy(&argv[argc]);
 			} while (argc--);
@@ -117,7 +117,8 @@ ni_dbus_message_get_args_variants(ni_dbus_message_t *msg, ni_dbus_variant_t *arg
 		/* We keep a reference to the dbus message in this variant variable,
 		 * because the caller may decide to free the message (eg in
 		 * ni_dbus_object_call_variant()). However, some strings we use point
-		 * directly into the message; such as the dict keys.
+		 * directly into the message; such as the dict keys, and string
+		 * arguments deserialized via the _ref variant above.
 		 */
 		argv[argc].__message = dbus_message_ref(msg);
 		dbus_message_iter_next(&iter);
@@ -172,8 +173,14 @@ ni_dbus_variant_is_string_array(const ni_dbus_variant_t *var)
 static inline void
 __ni_dbus_variant_change_type(ni_dbus_variant_t *var, int new_type)
 {
-	if (var->type == new_type)
+	if (var->type == new_type) {
+		/* Never hand a borrowed string to ni_string_dup/free */
+		if (var->__string_ref) {
+			var->string_value = NULL;
+			var->__string_ref = FALSE;
+		}
 		return;
+	}
 	if (var->type != DBUS_TYPE_INVALID) {
 		if (var->type == DBUS_TYPE_STRING
 		 || var->type == DBUS_TYPE_OBJECT_PATH
@@ -731,8 +738,84 @@ ni_dbus_variant_append_variant_element(ni_dbus_variant_t *var)
 void
 ni_dbus_variant_copy(ni_dbus_variant_t *dst, const ni_dbus_variant_t *src)
 {
+	unsigned int i;
+
 	ni_dbus_variant_destroy(dst);
-	ni_fatal("%s: not implemented", __FUNCTION__);
+	if (src == NULL)
+		return;
+
+	switch (src->type) {
+	case DBUS_TYPE_INVALID:
+		break;
+
+	case DBUS_TYPE_STRING:
+		ni_dbus_variant_set_string(dst, src->string_value);
+		break;
+
+	case DBUS_TYPE_OBJECT_PATH:
+		ni_dbus_variant_set_object_path(dst, src->string_value);
+		break;
+
+	case DBUS_TYPE_STRUCT:
+		ni_dbus_variant_init_struct(dst);
+		for (i = 0; i < src->array.len; ++i)
+			ni_dbus_variant_copy(ni_dbus_struct_add(dst), &src->struct_value[i]);
+		break;
+
+	case DBUS_TYPE_ARRAY:
+		switch (src->array.element_type) {
+		case DBUS_TYPE_BYTE:
+			ni_dbus_variant_set_byte_array(dst, src->byte_array_value, src->array.len);
+			break;
+
+		case DBUS_TYPE_STRING:
+		case DBUS_TYPE_OBJECT_PATH:
+			__ni_dbus_init_array(dst, src->array.element_type);
+			__ni_dbus_array_grow(dst, sizeof(char *), src->array.len);
+			for (i = 0; i < src->array.len; ++i)
+				dst->string_array_value[i] = xstrdup(src->string_array_value[i]?: "");
+			dst->array.len = src->array.len;
+			break;
+
+		case DBUS_TYPE_DICT_ENTRY:
+			ni_dbus_variant_init_dict(dst);
+			for (i = 0; i < src->array.len; ++i)
+				ni_dbus_dict_add_entry(dst, &src->dict_array_value[i]);
+			/* Dict keys are borrowed; if the source was unserialized
+			 * from a message, the keys point into it and we must keep
+			 * the message around. */
+			if (src->__message)
+				dst->__message = dbus_message_ref(src->__message);
+			break;
+
+		case DBUS_TYPE_INVALID:
+			if (src->array.element_signature == NULL)
+				break;
+			// fallthrough
+		case DBUS_TYPE_VARIANT:
+			if (src->array.element_signature)
+				__ni_dbus_init_array_signature(dst, src->array.element_signature);
+			else
+				__ni_dbus_init_array(dst, DBUS_TYPE_VARIANT);
+			__ni_dbus_array_grow(dst, sizeof(ni_dbus_variant_t), src->array.len);
+			for (i = 0; i < src->array.len; ++i)
+				ni_dbus_variant_copy(&dst->variant_array_value[i],
+						&src->variant_array_value[i]);
+			dst->array.len = src->array.len;
+			break;
+
+		default:
+			ni_warn("Don't know how to copy this type of array");
+			break;
+		}
+		break;
+
+	default:
+		/* Scalar types; the union holds the value itself */
+		dst->type = src->type;
+		dst->uint64_value = src->uint64_value;
+		break;
+	}
 }
 
 void
@@ -744,9 +827,11 @@ ni_dbus_variant_destroy(ni_dbus_variant_t *var)
 	}
 
 	if (var->type == DBUS_TYPE_STRING
-	 || var->type == DBUS_TYPE_OBJECT_PATH)
-		ni_string_free(&var->string_value);
-	else if (var->type == DBUS_TYPE_ARRAY) {
+	 || var->type == DBUS_TYPE_OBJECT_PATH) {
+		/* Borrowed strings point into __message and are freed with it */
+		if (!var->__string_ref)
+			ni_string_free(&var->string_value);
+	} else if (var->type == DBUS_TYPE_ARRAY) {
 		unsigned int i;
 
 		switch (var->array.element_type) {
@@ -1155,6 +1240,98 @@ ni_dbus_variant_signature(const ni_dbus_variant_t *var)
 	return NULL;
 }
 
+/*
+ * Fold a variant recursively into a CRC32C content checksum, used to
+ * fingerprint a marshalled property set for change detection. The type
+ * tags are fed along with the values, so that e.g. a value moving
+ * between members of different type does not go unnoticed.
+ */
+uint32_t
+ni_dbus_variant_csum(uint32_t csum, const ni_dbus_variant_t *var)
+{
+	unsigned int i;
+
+	csum = ni_crc32c(csum, &var->type, sizeof(var->type));
+	switch (var->type) {
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		if (var->string_value)
+			csum = ni_crc32c(csum, var->string_value,
+					strlen(var->string_value));
+		break;
+
+	case DBUS_TYPE_BYTE:
+		csum = ni_crc32c(csum, &var->byte_value, sizeof(var->byte_value));
+		break;
+	case DBUS_TYPE_BOOLEAN:
+		csum = ni_crc32c(csum, &var->bool_value, sizeof(var->bool_value));
+		break;
+	case DBUS_TYPE_INT16:
+	case DBUS_TYPE_UINT16:
+		csum = ni_crc32c(csum, &var->uint16_value, sizeof(var->uint16_value));
+		break;
+	case DBUS_TYPE_INT32:
+	case DBUS_TYPE_UINT32:
+		csum = ni_crc32c(csum, &var->uint32_value, sizeof(var->uint32_value));
+		break;
+	case DBUS_TYPE_INT64:
+	case DBUS_TYPE_UINT64:
+		csum = ni_crc32c(csum, &var->uint64_value, sizeof(var->uint64_value));
+		break;
+	case DBUS_TYPE_DOUBLE:
+		csum = ni_crc32c(csum, &var->double_value, sizeof(var->double_value));
+		break;
+
+	case DBUS_TYPE_STRUCT:
+		for (i = 0; i < var->array.len; ++i)
+			csum = ni_dbus_variant_csum(csum, &var->struct_value[i]);
+		break;
+
+	case DBUS_TYPE_ARRAY:
+		csum = ni_crc32c(csum, &var->array.element_type,
+				sizeof(var->array.element_type));
+		switch (var->array.element_type) {
+		case DBUS_TYPE_BYTE:
+			csum = ni_crc32c(csum, var->byte_array_value, var->array.len);
+			break;
+		case DBUS_TYPE_STRING:
+		case DBUS_TYPE_OBJECT_PATH:
+			for (i = 0; i < var->array.len; ++i) {
+				const char *s = var->string_array_value[i];
+
+				if (s)
+					csum = ni_crc32c(csum, s, strlen(s) + 1);
+			}
+			break;
+		case DBUS_TYPE_DICT_ENTRY:
+			for (i = 0; i < var->array.len; ++i) {
+				const ni_dbus_dict_entry_t *entry = &var->dict_array_value[i];
+
+				if (entry->key)
+					csum = ni_crc32c(csum, entry->key,
+							strlen(entry->key) + 1);
+				csum = ni_dbus_variant_csum(csum, &entry->datum);
+			}
+			break;
+		case DBUS_TYPE_VARIANT:
+			for (i = 0; i < var->array.len; ++i)
+				csum = ni_dbus_variant_csum(csum, &var->variant_array_value[i]);
+			break;
+		case DBUS_TYPE_STRUCT:
+			for (i = 0; i < var->array.len; ++i)
+				csum = ni_dbus_variant_csum(csum, &var->struct_value[i]);
+			break;
+		default:
+			break;
+		}
+		break;
+
+	default:
+		break;
+	}
+	return csum;
+}
+
 /*
  * Dict handling
  */
@@ -16,7 +16,7 @@
 #define NI_DBUS_INTERFACE	"org.freedesktop.DBus"
 
 extern const char *		ni_dbus_object_get_path(const ni_dbus_object_t *);
-extern char *			ni_dbus_object_introspect(ni_dbus_object_t *object);
+extern const char *		ni_dbus_object_introspect(ni_dbus_object_t *object);
 extern const DBusObjectPathVTable *ni_dbus_object_get_vtable(const ni_dbus_object_t *);
 extern int			ni_dbus_translate_error(const DBusError *, const ni_intmap_t *);
 
@@ -24,6 +24,8 @@ extern const char *		ni_dbus_type_as_string(int type);
 
 extern dbus_bool_t		ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter,
 					ni_dbus_variant_t *variant);
+extern dbus_bool_t		ni_dbus_message_iter_get_variant_data_ref(DBusMessageIter *iter,
+					ni_dbus_variant_t *variant);
 extern dbus_bool_t		ni_dbus_message_iter_append_value(DBusMessageIter *iter,
 					const ni_dbus_variant_t *variant,
 					const char *signature);
@@ -31,6 +33,8 @@ extern dbus_bool_t		ni_dbus_message_iter_append_variant(DBusMessageIter *iter,
 					const ni_dbus_variant_t *variant);
 extern dbus_bool_t		ni_dbus_message_iter_get_variant(DBusMessageIter *iter,
 					ni_dbus_variant_t *variant);
+extern dbus_bool_t		__ni_dbus_message_iter_get_variant(DBusMessageIter *iter,
+					ni_dbus_variant_t *variant, dbus_bool_t string_ref);
 extern dbus_bool_t		ni_dbus_message_iter_append_byte_array(DBusMessageIter *iter,
 						const unsigned char *value, unsigned int len);
 
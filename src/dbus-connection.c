@@ -27,7 +27,9 @@ struct ni_dbus_async_client_call {
 
 	DBusPendingCall *	call;
 	ni_dbus_async_callback_t *callback;
+	ni_dbus_async_data_callback_t *data_callback;
 	ni_dbus_object_t *	proxy;
+	void *			user_data;
 };
 
 typedef struct ni_dbus_async_server_call ni_dbus_async_server_call_t;
@@ -85,6 +87,7 @@ static void			__ni_dbus_async_client_call_free(ni_dbus_async_client_call_t *);
 static void			__ni_dbus_notify_async(DBusPendingCall *, void *);
 static dbus_bool_t		__ni_dbus_add_watch(DBusWatch *, void *);
 static void			__ni_dbus_remove_watch(DBusWatch *, void *);
+static void			__ni_dbus_toggle_watch(DBusWatch *, void *);
 static DBusHandlerResult	__ni_dbus_signal_filter(DBusConnection *, DBusMessage *, void *);
 static void			__ni_dbus_connection_dispatch(ni_dbus_connection_t *);
 
@@ -194,7 +197,7 @@ ni_dbus_connection_open(const char *bus_type_string, const char *bus_name)
 		dbus_connection_set_watch_functions(connection->conn,
 				__ni_dbus_add_watch,
 				__ni_dbus_remove_watch,
-				NULL,			/* toggle_function */
+				__ni_dbus_toggle_watch,
 				connection,		/* data */
 				NULL);			/* free_data_function */
 	}
@@ -256,7 +259,7 @@ ni_dbus_connection_free(ni_dbus_connection_t *dbc)
 /*
  * Handle pending (async) calls
  */
-static void
+static ni_dbus_async_client_call_t *
 ni_dbus_connection_add_pending(ni_dbus_connection_t *connection,
 			DBusPendingCall *call,
 			ni_dbus_async_callback_t *callback,
@@ -271,6 +274,8 @@ ni_dbus_connection_add_pending(ni_dbus_connection_t *connection,
 
 	async->next = connection->async_client_calls;
 	connection->async_client_calls = async;
+
+	return async;
 }
 
 static void
@@ -290,7 +295,10 @@ __ni_dbus_process_pending(ni_dbus_connection_t *dbc, DBusPendingCall *call)
 	for (pos = &dbc->async_client_calls; (async = *pos) != NULL; pos = &async->next) {
 		if (async->call == call) {
 			*pos = async->next;
-			async->callback(async->proxy, msg);
+			if (async->data_callback)
+				async->data_callback(async->proxy, msg, async->user_data);
+			else
+				async->callback(async->proxy, msg);
 			__ni_dbus_async_client_call_free(async);
 			rv = 1;
 			break;
@@ -381,6 +389,37 @@ ni_dbus_connection_call_async(ni_dbus_connection_t *connection,
 	return 0;
 }
 
+/*
+ * Same as above, but invoking a completion callback that takes a caller
+ * provided context pointer. This is what the client fsm uses to keep the
+ * calls for many devices in flight concurrently.
+ */
+int
+ni_dbus_connection_call_async_data(ni_dbus_connection_t *connection,
+			ni_dbus_message_t *call, unsigned int timeout,
+			ni_dbus_async_data_callback_t *callback,
+			ni_dbus_object_t *proxy, void *user_data)
+{
+	ni_dbus_async_client_call_t *async;
+	DBusPendingCall *pending;
+
+	if (!dbus_connection_send_with_reply(connection->conn, call, &pending, timeout)) {
+		ni_error("dbus: unable to send async message (errno=%d): %m", errno);
+		return -NI_ERROR_DBUS_CALL_FAILED;
+	}
+	if (!pending) {
+		ni_error("dbus: connection is closed: %m");
+		return -NI_ERROR_DBUS_CALL_FAILED;
+	}
+
+	async = ni_dbus_connection_add_pending(connection, pending, NULL, proxy);
+	async->data_callback = callback;
+	async->user_data = user_data;
+	dbus_pending_call_set_notify(pending, __ni_dbus_notify_async, connection, NULL);
+
+	return 0;
+}
+
 static void
 __ni_dbus_notify_async(DBusPendingCall *pending, void *call_data)
 {
@@ -455,17 +494,23 @@ ni_dbus_add_signal_handler(ni_dbus_connection_t *connection,
 	DBusError error = DBUS_ERROR_INIT;
 	ni_dbus_sigaction_t *sigact;
 	char specbuf[1024], *arg;
-
-	if (sender && object_path && object_interface) {
-		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',path='%s',interface='%s'",
-			sender, object_path, object_interface);
-	} else if (sender && object_interface) {
-		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',interface='%s'",
-			sender, object_interface);
-	} else {
-		snprintf(specbuf, sizeof(specbuf), "type='signal',interface='%s'",
-			object_interface);
-	}
+	unsigned int len;
+
+	/* Build the match rule from whatever the caller specified. In
+	 * particular a path scoped rule without a sender is useful: a
+	 * client tracking a single interface can subscribe to just that
+	 * object, and the bus daemon will not wake it up for (nor copy
+	 * to it) the signals of all the other interfaces. */
+	len = snprintf(specbuf, sizeof(specbuf), "type='signal'");
+	if (sender)
+		len += snprintf(specbuf + len, sizeof(specbuf) - len,
+				",sender='%s'", sender);
+	if (object_path)
+		len += snprintf(specbuf + len, sizeof(specbuf) - len,
+				",path='%s'", object_path);
+	if (object_interface)
+		len += snprintf(specbuf + len, sizeof(specbuf) - len,
+				",interface='%s'", object_interface);
 	arg = specbuf;
 
 	call = dbus_message_new_method_call(NI_DBUS_BUS_NAME,
@@ -776,6 +821,57 @@ restart:
 		ni_warn("%s: dead socket", func);
 }
 
+/*
+ * Recompute the poll flags of a socket from the current state of all
+ * dbus watches attached to it.
+ */
+static void
+__ni_dbus_watch_update_poll_flags(ni_socket_t *sock)
+{
+	ni_dbus_watch_data_t *wd;
+	int poll_flags = 0;
+
+	for (wd = ni_dbus_watches; wd; wd = wd->next) {
+		int watch_flags;
+
+		if (wd->socket != sock || wd->state != DBUS_WD_STATE_ACTIVE)
+			continue;
+		if (!dbus_watch_get_enabled(wd->watch))
+			continue;
+
+		watch_flags = dbus_watch_get_flags(wd->watch);
+		if (watch_flags & DBUS_WATCH_READABLE)
+			poll_flags |= POLLIN;
+		if (watch_flags & DBUS_WATCH_WRITABLE)
+			poll_flags |= POLLOUT;
+	}
+
+	sock->poll_flags = poll_flags;
+}
+
+/*
+ * libdbus toggles the write watch when its outgoing queue becomes
+ * non-empty resp. drains. Without this callback, a message queued
+ * outside of dbus socket activity (such as a signal emitted from a
+ * netlink event handler) would not arm POLLOUT until the next
+ * incoming dbus event, delaying the transmission. The queue itself
+ * is flushed from the socket mainloop via __ni_dbus_watch_send(),
+ * so a slow client never blocks us.
+ */
+static void
+__ni_dbus_toggle_watch(DBusWatch *watch, void *data)
+{
+	ni_dbus_watch_data_t *wd;
+
+	for (wd = ni_dbus_watches; wd; wd = wd->next) {
+		if (wd->watch == watch) {
+			if (wd->socket)
+				__ni_dbus_watch_update_poll_flags(wd->socket);
+			break;
+		}
+	}
+}
+
 static void
 __ni_dbus_watch_recv(ni_socket_t *sock)
 {
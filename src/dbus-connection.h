@@ -18,6 +18,10 @@ extern ni_dbus_message_t *	ni_dbus_connection_call(ni_dbus_connection_t *connect
 extern int			ni_dbus_connection_call_async(ni_dbus_connection_t *connection,
 					ni_dbus_message_t *call, unsigned int timeout,
 					ni_dbus_async_callback_t *callback, ni_dbus_object_t *proxy);
+extern int			ni_dbus_connection_call_async_data(ni_dbus_connection_t *connection,
+					ni_dbus_message_t *call, unsigned int timeout,
+					ni_dbus_async_data_callback_t *callback,
+					ni_dbus_object_t *proxy, void *user_data);
 extern int			ni_dbus_connection_send_message(ni_dbus_connection_t *, ni_dbus_message_t *);
 extern void			ni_dbus_connection_send_error(ni_dbus_connection_t *, ni_dbus_message_t *, DBusError *);
 extern void			ni_dbus_add_signal_handler(ni_dbus_connection_t *conn,
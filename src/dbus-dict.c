@@ -62,7 +62,8 @@ ni_dbus_message_open_dict_read(DBusMessageIter *iter, DBusMessageIter *iter_dict
  *
  */
 dbus_bool_t
-ni_dbus_message_get_next_dict_entry(DBusMessageIter *iter_dict, struct ni_dbus_dict_entry *entry)
+__ni_dbus_message_get_next_dict_entry(DBusMessageIter *iter_dict, struct ni_dbus_dict_entry *entry,
+			dbus_bool_t string_ref)
 {
 	DBusMessageIter iter_dict_entry;
 	const char *key;
@@ -83,7 +84,7 @@ ni_dbus_message_get_next_dict_entry(DBusMessageIter *iter_dict, struct ni_dbus_d
 	if (!dbus_message_iter_next(&iter_dict_entry))
 		goto error;
 
-	if (!ni_dbus_message_iter_get_variant(&iter_dict_entry, &entry->datum))
+	if (!__ni_dbus_message_iter_get_variant(&iter_dict_entry, &entry->datum, string_ref))
 		goto error;
 
 	dbus_message_iter_next(iter_dict);
@@ -96,6 +97,12 @@ error:
 	return FALSE;
 }
 
+dbus_bool_t
+ni_dbus_message_get_next_dict_entry(DBusMessageIter *iter_dict, struct ni_dbus_dict_entry *entry)
+{
+	return __ni_dbus_message_get_next_dict_entry(iter_dict, entry, FALSE);
+}
+
 
 /**
  * Free any memory used by the entry object.
@@ -23,6 +23,8 @@ extern dbus_bool_t	ni_dbus_message_open_dict_read(DBusMessageIter *iter,
 				    DBusMessageIter *iter_dict);
 extern dbus_bool_t	ni_dbus_message_get_next_dict_entry(DBusMessageIter *iter_dict,
 				    ni_dbus_dict_entry_t *entry);
+extern dbus_bool_t	__ni_dbus_message_get_next_dict_entry(DBusMessageIter *iter_dict,
+				    ni_dbus_dict_entry_t *entry, dbus_bool_t string_ref);
 extern void		ni_dbus_dict_entry_clear(ni_dbus_dict_entry_t *);
 
 #endif  /* DBUS_DICT_HELPERS_H */
@@ -22,11 +22,18 @@ static ni_bool_t	__ni_dbus_introspect_method(const ni_dbus_method_t *, xml_node_
 static ni_bool_t	__ni_dbus_introspect_property(const ni_dbus_property_t *, xml_node_t *);
 static void		__ni_dbus_introspect_annotate(xml_node_t *, const char *, const char *);
 
-char *
+const char *
 ni_dbus_object_introspect(ni_dbus_object_t *object)
 {
 	xml_node_t *node;
-	char *result = NULL;
+
+	/* The generated xml is cached on the object; the cache is
+	 * invalidated in dbus-object.c whenever an interface is
+	 * registered or the list of children changes. Monitoring
+	 * tools tend to introspect frequently, so serve repeated
+	 * calls without regenerating (and without allocations). */
+	if (object->introspect_xml)
+		return object->introspect_xml;
 
 	ni_debug_dbus("%s(%s)", __func__, object->path);
 
@@ -50,11 +57,11 @@ ni_dbus_object_introspect(ni_dbus_object_t *object)
 		}
 	}
 
-	result = xml_node_sprint(node);
+	object->introspect_xml = xml_node_sprint(node);
 
 out:
 	xml_node_free(node);
-	return result;
+	return object->introspect_xml;
 }
 
 ni_bool_t
@@ -63,7 +70,8 @@ __ni_dbus_introspect_object(ni_dbus_object_t *object, xml_node_t *node)
 	unsigned int i;
 
 	xml_node_add_attr(node, "name", object->path);
-	for (i = 0; object->interfaces[i]; ++i) {
+	ni_dbus_object_bind_interfaces(object);
+	for (i = 0; object->interfaces && object->interfaces[i]; ++i) {
 		if (!__ni_dbus_introspect_service(object->interfaces[i], xml_node_new("interface", node)))
 			return FALSE;
 	}
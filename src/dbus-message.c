@@ -16,7 +16,10 @@
 #include "dbus-dict.h"
 #include "debug.h"
 
-static dbus_bool_t	ni_dbus_message_iter_get_array(DBusMessageIter *, ni_dbus_variant_t *);
+static dbus_bool_t	ni_dbus_message_iter_get_array(DBusMessageIter *, ni_dbus_variant_t *,
+					dbus_bool_t string_ref);
+static dbus_bool_t	__ni_dbus_message_iter_get_variant_data(DBusMessageIter *, ni_dbus_variant_t *,
+					dbus_bool_t string_ref);
 
 dbus_bool_t
 ni_dbus_message_iter_append_byte_array(DBusMessageIter *iter,
@@ -341,8 +344,9 @@ ni_dbus_message_iter_get_object_path_array(DBusMessageIter *iter, ni_dbus_varian
 	return TRUE;
 }
 
-dbus_bool_t
-ni_dbus_message_iter_get_array_array(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+static dbus_bool_t
+ni_dbus_message_iter_get_array_array(DBusMessageIter *iter, ni_dbus_variant_t *variant,
+				dbus_bool_t string_ref)
 {
 	dbus_bool_t rv = TRUE;
 	char *signature;
@@ -357,15 +361,16 @@ ni_dbus_message_iter_get_array_array(DBusMessageIter *iter, ni_dbus_variant_t *v
 		ni_dbus_variant_t *elem;
 
 		elem = ni_dbus_array_array_add(variant);
-		rv = ni_dbus_message_iter_get_array(iter, elem);
+		rv = ni_dbus_message_iter_get_array(iter, elem, string_ref);
 		dbus_message_iter_next(iter);
 	}
 
 	return rv;
 }
 
-dbus_bool_t
-ni_dbus_message_iter_get_dict(DBusMessageIter *iter, ni_dbus_variant_t *result)
+static dbus_bool_t
+__ni_dbus_message_iter_get_dict(DBusMessageIter *iter, ni_dbus_variant_t *result,
+				dbus_bool_t string_ref)
 {
 	DBusMessageIter iter_dict;
 
@@ -379,7 +384,7 @@ ni_dbus_message_iter_get_dict(DBusMessageIter *iter, ni_dbus_variant_t *result)
 		ni_dbus_variant_t *ev;
 
 		memset(&entry, 0, sizeof(entry));
-		if (!ni_dbus_message_get_next_dict_entry(&iter_dict, &entry))
+		if (!__ni_dbus_message_get_next_dict_entry(&iter_dict, &entry, string_ref))
 			break;
 
 		ev = ni_dbus_dict_add(result, entry.key);
@@ -390,7 +395,14 @@ ni_dbus_message_iter_get_dict(DBusMessageIter *iter, ni_dbus_variant_t *result)
 }
 
 dbus_bool_t
-ni_dbus_message_iter_get_variant_array(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+ni_dbus_message_iter_get_dict(DBusMessageIter *iter, ni_dbus_variant_t *result)
+{
+	return __ni_dbus_message_iter_get_dict(iter, result, FALSE);
+}
+
+static dbus_bool_t
+ni_dbus_message_iter_get_variant_array(DBusMessageIter *iter, ni_dbus_variant_t *variant,
+				dbus_bool_t string_ref)
 {
 	dbus_bool_t rv = TRUE;
 
@@ -399,7 +411,7 @@ ni_dbus_message_iter_get_variant_array(DBusMessageIter *iter, ni_dbus_variant_t
 		ni_dbus_variant_t *elem;
 
 		elem = ni_dbus_variant_append_variant_element(variant);
-		rv = ni_dbus_message_iter_get_variant(iter, elem);
+		rv = __ni_dbus_message_iter_get_variant(iter, elem, string_ref);
 		dbus_message_iter_next(iter);
 	}
 
@@ -408,7 +420,8 @@ ni_dbus_message_iter_get_variant_array(DBusMessageIter *iter, ni_dbus_variant_t
 
 
 static dbus_bool_t
-ni_dbus_message_iter_get_array(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+ni_dbus_message_iter_get_array(DBusMessageIter *iter, ni_dbus_variant_t *variant,
+				dbus_bool_t string_ref)
 {
 	int array_type = dbus_message_iter_get_element_type(iter);
 	dbus_bool_t success = FALSE;
@@ -430,13 +443,13 @@ ni_dbus_message_iter_get_array(DBusMessageIter *iter, ni_dbus_variant_t *variant
 		success = ni_dbus_message_iter_get_object_path_array(&iter_array, variant);
 		break;
 	case DBUS_TYPE_DICT_ENTRY:
-		success = ni_dbus_message_iter_get_dict(iter, variant);
+		success = __ni_dbus_message_iter_get_dict(iter, variant, string_ref);
 		break;
 	case DBUS_TYPE_ARRAY:
-		success = ni_dbus_message_iter_get_array_array(&iter_array, variant);
+		success = ni_dbus_message_iter_get_array_array(&iter_array, variant, string_ref);
 		break;
 	case DBUS_TYPE_VARIANT:
-		success = ni_dbus_message_iter_get_variant_array(&iter_array, variant);
+		success = ni_dbus_message_iter_get_variant_array(&iter_array, variant, string_ref);
 		break;
 	default:
 		ni_debug_dbus("%s: cannot decode array of type %c", __FUNCTION__, array_type);
@@ -447,7 +460,8 @@ ni_dbus_message_iter_get_array(DBusMessageIter *iter, ni_dbus_variant_t *variant
 }
 
 static dbus_bool_t
-ni_dbus_message_iter_get_struct(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+ni_dbus_message_iter_get_struct(DBusMessageIter *iter, ni_dbus_variant_t *variant,
+				dbus_bool_t string_ref)
 {
 	DBusMessageIter iter_struct;
 	int type;
@@ -464,7 +478,7 @@ ni_dbus_message_iter_get_struct(DBusMessageIter *iter, ni_dbus_variant_t *varian
 		if (!member)
 			return FALSE;
 
-		if (!ni_dbus_message_iter_get_variant_data(&iter_struct, member))
+		if (!__ni_dbus_message_iter_get_variant_data(&iter_struct, member, string_ref))
 			return FALSE;
 		dbus_message_iter_next(&iter_struct);
 	}
@@ -473,8 +487,9 @@ ni_dbus_message_iter_get_struct(DBusMessageIter *iter, ni_dbus_variant_t *varian
 }
 
 
-dbus_bool_t
-ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+static dbus_bool_t
+__ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter, ni_dbus_variant_t *variant,
+				dbus_bool_t string_ref)
 {
 	void *value;
 
@@ -487,13 +502,21 @@ ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter, ni_dbus_variant_t *
 		dbus_message_iter_get_basic(iter, value);
 
 		if (variant->type == DBUS_TYPE_STRING
-		 || variant->type == DBUS_TYPE_OBJECT_PATH)
-			variant->string_value = xstrdup(variant->string_value);
+		 || variant->type == DBUS_TYPE_OBJECT_PATH) {
+			/* If the caller pins the message by storing a reference
+			 * in variant->__message, we can use the string in place
+			 * rather than copying it. This matters for large payloads
+			 * such as policy or config documents. */
+			if (string_ref)
+				variant->__string_ref = TRUE;
+			else
+				variant->string_value = xstrdup(variant->string_value);
+		}
 	} else if (variant->type == DBUS_TYPE_ARRAY) {
-		if (!ni_dbus_message_iter_get_array(iter, variant))
+		if (!ni_dbus_message_iter_get_array(iter, variant, string_ref))
 			return FALSE;
 	} else if (variant->type == DBUS_TYPE_STRUCT) {
-		if (!ni_dbus_message_iter_get_struct(iter, variant))
+		if (!ni_dbus_message_iter_get_struct(iter, variant, string_ref))
 			return FALSE;
 	} else {
 		/* FIXME: need to handle other types here */
@@ -505,7 +528,25 @@ ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter, ni_dbus_variant_t *
 }
 
 dbus_bool_t
-ni_dbus_message_iter_get_variant(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+ni_dbus_message_iter_get_variant_data(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+{
+	return __ni_dbus_message_iter_get_variant_data(iter, variant, FALSE);
+}
+
+/* As above, but keep string values pointing into the message rather than
+ * duplicating them. The caller must keep a reference to the message in
+ * variant->__message, as ni_dbus_message_get_args_variants() does; the
+ * flag is propagated to all nested dicts, arrays and structs, whose
+ * lifetime is bounded by the top-level variant holding that reference. */
+dbus_bool_t
+ni_dbus_message_iter_get_variant_data_ref(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+{
+	return __ni_dbus_message_iter_get_variant_data(iter, variant, TRUE);
+}
+
+dbus_bool_t
+__ni_dbus_message_iter_get_variant(DBusMessageIter *iter, ni_dbus_variant_t *variant,
+				dbus_bool_t string_ref)
 {
 	DBusMessageIter iter_val;
 	int type;
@@ -517,7 +558,13 @@ ni_dbus_message_iter_get_variant(DBusMessageIter *iter, ni_dbus_variant_t *varia
 		return FALSE;
 
 	dbus_message_iter_recurse(iter, &iter_val);
-	return ni_dbus_message_iter_get_variant_data(&iter_val, variant);
+	return __ni_dbus_message_iter_get_variant_data(&iter_val, variant, string_ref);
+}
+
+dbus_bool_t
+ni_dbus_message_iter_get_variant(DBusMessageIter *iter, ni_dbus_variant_t *variant)
+{
+	return __ni_dbus_message_iter_get_variant(iter, variant, FALSE);
 }
 
 /*
@@ -30,6 +30,87 @@ const ni_dbus_class_t		ni_dbus_anonymous_class = {
 	.name = "<anonymous>"
 };
 
+/*
+ * Hashed child lookup. Message dispatch resolves the object path of every
+ * incoming call one component at a time; with thousands of interface
+ * children below Interface/ a linear scan per message adds up. Nodes with
+ * many children get a chained hash over the child names, built lazily on
+ * the first lookup and maintained as children come and go. The child list
+ * itself stays authoritative for iteration order.
+ */
+#define NI_DBUS_CHILD_HASH_MIN		16	/* build the hash at this many children */
+#define NI_DBUS_CHILD_HASH_NBUCKETS	256
+
+typedef struct ni_dbus_child_hash_entry ni_dbus_child_hash_entry_t;
+struct ni_dbus_child_hash_entry {
+	ni_dbus_child_hash_entry_t *next;
+	ni_dbus_object_t *	child;
+};
+
+struct ni_dbus_object_hash {
+	ni_dbus_child_hash_entry_t *buckets[NI_DBUS_CHILD_HASH_NBUCKETS];
+};
+
+static unsigned int
+__ni_dbus_child_name_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = (hash << 5) + hash + (unsigned char)*name++;
+	return hash % NI_DBUS_CHILD_HASH_NBUCKETS;
+}
+
+static void
+__ni_dbus_child_hash_insert(ni_dbus_object_hash_t *hash, ni_dbus_object_t *child)
+{
+	ni_dbus_child_hash_entry_t **chain = &hash->buckets[__ni_dbus_child_name_hash(child->name)];
+	ni_dbus_child_hash_entry_t *entry;
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->child = child;
+	entry->next = *chain;
+	*chain = entry;
+}
+
+static void
+__ni_dbus_child_hash_remove(ni_dbus_object_t *parent, const ni_dbus_object_t *child)
+{
+	ni_dbus_child_hash_entry_t **pos, *entry;
+
+	if (parent->child_hash == NULL)
+		return;
+
+	pos = &parent->child_hash->buckets[__ni_dbus_child_name_hash(child->name)];
+	while ((entry = *pos) != NULL) {
+		if (entry->child == child) {
+			*pos = entry->next;
+			free(entry);
+			return;
+		}
+		pos = &entry->next;
+	}
+}
+
+static void
+__ni_dbus_child_hash_free(ni_dbus_object_t *object)
+{
+	ni_dbus_child_hash_entry_t *entry;
+	unsigned int i;
+
+	if (object->child_hash == NULL)
+		return;
+
+	for (i = 0; i < NI_DBUS_CHILD_HASH_NBUCKETS; ++i) {
+		while ((entry = object->child_hash->buckets[i]) != NULL) {
+			object->child_hash->buckets[i] = entry->next;
+			free(entry);
+		}
+	}
+	free(object->child_hash);
+	object->child_hash = NULL;
+}
+
 /*
  * Create a new dbus object
  */
@@ -39,6 +120,7 @@ __ni_dbus_object_new(const ni_dbus_class_t *class, const char *path)
 	ni_dbus_object_t *object;
 
 	object = xcalloc(1, sizeof(*object));
+	ni_memstats_alloc(NI_MEMTAG_DBUS, sizeof(*object));
 	ni_string_dup(&object->path, path);
 	object->class = class;
 	return object;
@@ -71,6 +153,10 @@ __ni_dbus_object_new_child(ni_dbus_object_t *parent, const ni_dbus_class_t *obje
 	child->parent = parent;
 	__ni_dbus_object_insert(pos, child);
 	ni_string_dup(&child->name, name);
+	if (parent->child_hash)
+		__ni_dbus_child_hash_insert(parent->child_hash, child);
+	/* the child node list is part of the parent's introspection data */
+	ni_string_free(&parent->introspect_xml);
 	if (parent->server_object)
 		__ni_dbus_server_object_inherit(child, parent);
 	if (parent->client_object)
@@ -105,8 +191,13 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 {
 	ni_dbus_object_t *child;
 
+	if (object->parent) {
+		__ni_dbus_child_hash_remove(object->parent, object);
+		ni_string_free(&object->parent->introspect_xml);
+	}
 	__ni_dbus_object_unlink(object);
 	object->parent = NULL;
+	__ni_dbus_child_hash_free(object);
 
 	if (object->server_object)
 		__ni_dbus_server_object_destroy(object);
@@ -121,8 +212,11 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 
 	ni_string_free(&object->name);
 	ni_string_free(&object->path);
+	ni_string_free(&object->introspect_xml);
 
-	free(object->interfaces);
+	if (!object->interfaces_shared)
+		free(object->interfaces);
+	ni_memstats_free(NI_MEMTAG_DBUS, sizeof(*object));
 	free(object);
 }
 
@@ -136,6 +230,10 @@ ni_dbus_object_free(ni_dbus_object_t *object)
 	if (object->pprev) {
 		ni_debug_dbus("%s: deferring deletion of active object %s",
 				__FUNCTION__, object->path);
+		if (object->parent) {
+			__ni_dbus_child_hash_remove(object->parent, object);
+			ni_string_free(&object->parent->introspect_xml);
+		}
 		__ni_dbus_object_unlink(object);
 		object->parent = NULL;
 		__ni_dbus_object_insert(&__ni_dbus_objects_trashcan, object);
@@ -182,6 +280,31 @@ __ni_dbus_object_get_child(ni_dbus_object_t *parent, const char *name)
 	if (*name == '\0')
 		return parent;
 
+	if (parent->child_hash == NULL) {
+		unsigned int count = 0;
+
+		for (child = parent->children; child; child = child->next) {
+			if (++count < NI_DBUS_CHILD_HASH_MIN)
+				continue;
+
+			parent->child_hash = xcalloc(1, sizeof(*parent->child_hash));
+			for (child = parent->children; child; child = child->next)
+				__ni_dbus_child_hash_insert(parent->child_hash, child);
+			break;
+		}
+	}
+
+	if (parent->child_hash) {
+		ni_dbus_child_hash_entry_t *entry;
+		unsigned int index = __ni_dbus_child_name_hash(name);
+
+		for (entry = parent->child_hash->buckets[index]; entry; entry = entry->next) {
+			if (!strcmp(entry->child->name, name))
+				return entry->child;
+		}
+		return NULL;
+	}
+
 	for (child = parent->children; child; child = child->next) {
 		if (!strcmp(child->name, name))
 			return child;
@@ -295,6 +418,30 @@ ni_dbus_object_find_descendant_by_handle(const ni_dbus_object_t *parent, const v
 	return found;
 }
 
+/*
+ * Lazy interface binding. Objects created with lazy_bind set have no
+ * services attached yet; the binder is invoked on first access, so the
+ * cost of matching all registered services against an object's class
+ * is paid when the object is actually used, not when it is created.
+ */
+static void			(*__ni_dbus_object_lazy_binder)(ni_dbus_object_t *);
+
+void
+ni_dbus_object_set_lazy_binder(void (*binder)(ni_dbus_object_t *))
+{
+	__ni_dbus_object_lazy_binder = binder;
+}
+
+void
+ni_dbus_object_bind_interfaces(ni_dbus_object_t *object)
+{
+	if (object && object->lazy_bind) {
+		object->lazy_bind = FALSE;
+		if (__ni_dbus_object_lazy_binder)
+			__ni_dbus_object_lazy_binder(object);
+	}
+}
+
 /*
  * Look up an object interface by name
  */
@@ -304,7 +451,11 @@ ni_dbus_object_get_service(const ni_dbus_object_t *object, const char *interface
 	const ni_dbus_service_t *svc;
 	unsigned int i;
 
-	if (object == NULL || object->interfaces == NULL)
+	if (object == NULL)
+		return NULL;
+
+	ni_dbus_object_bind_interfaces((ni_dbus_object_t *) object);
+	if (object->interfaces == NULL)
 		return NULL;
 
 	for (i = 0; (svc = object->interfaces[i]) != NULL; ++i) {
@@ -345,7 +496,11 @@ ni_dbus_object_get_service_for_method(const ni_dbus_object_t *object, const char
 	const ni_dbus_service_t *svc, *best = NULL;
 	unsigned int i;
 
-	if (object == NULL || object->interfaces == NULL || method == NULL)
+	if (object == NULL || method == NULL)
+		return NULL;
+
+	ni_dbus_object_bind_interfaces((ni_dbus_object_t *) object);
+	if (object->interfaces == NULL)
 		return NULL;
 
 	for (i = 0; (svc = object->interfaces[i]) != NULL; ++i) {
@@ -367,7 +522,11 @@ ni_dbus_object_get_all_services_for_method(const ni_dbus_object_t *object, const
 	const ni_dbus_service_t *svc;
 	unsigned int i, found = 0;
 
-	if (object == NULL || object->interfaces == NULL || method == NULL)
+	if (object == NULL || method == NULL)
+		return 0;
+
+	ni_dbus_object_bind_interfaces((ni_dbus_object_t *) object);
+	if (object->interfaces == NULL)
 		return 0;
 
 	for (i = 0; (svc = object->interfaces[i]) != NULL; ++i) {
@@ -386,7 +545,11 @@ ni_dbus_object_get_service_for_signal(const ni_dbus_object_t *object, const char
 	const ni_dbus_service_t *svc, *best = NULL;
 	unsigned int i;
 
-	if (object == NULL || object->interfaces == NULL)
+	if (object == NULL)
+		return NULL;
+
+	ni_dbus_object_bind_interfaces((ni_dbus_object_t *) object);
+	if (object->interfaces == NULL)
 		return NULL;
 
 	for (i = 0; (svc = object->interfaces[i]) != NULL; ++i) {
@@ -407,7 +570,11 @@ ni_dbus_object_get_service_for_property(const ni_dbus_object_t *object, const ch
 	const ni_dbus_service_t *svc;
 	unsigned int i;
 
-	if (object == NULL || object->interfaces == NULL)
+	if (object == NULL)
+		return NULL;
+
+	ni_dbus_object_bind_interfaces((ni_dbus_object_t *) object);
+	if (object->interfaces == NULL)
 		return NULL;
 
 	for (i = 0; (svc = object->interfaces[i]) != NULL; ++i) {
@@ -499,9 +666,20 @@ ni_dbus_object_register_service(ni_dbus_object_t *object, const ni_dbus_service_
 		}
 	}
 
-	object->interfaces = realloc(object->interfaces, (count + 2) * sizeof(svc));
+	if (object->interfaces_shared) {
+		/* this object diverges from the per-class table; unshare it */
+		const ni_dbus_service_t **table;
+
+		table = xcalloc(count + 2, sizeof(svc));
+		memcpy(table, object->interfaces, count * sizeof(svc));
+		object->interfaces = table;
+		object->interfaces_shared = FALSE;
+	} else {
+		object->interfaces = realloc(object->interfaces, (count + 2) * sizeof(svc));
+	}
 	object->interfaces[count++] = svc;
 	object->interfaces[count] = NULL;
+	ni_string_free(&object->introspect_xml);
 
 	if (svc->properties)
 		ni_dbus_object_register_property_interface(object);
@@ -1289,6 +1467,54 @@ ni_dbus_generic_property_parse_string(const ni_dbus_property_t *prop, ni_dbus_va
 	return ni_dbus_variant_parse(var, string, prop->signature);
 }
 
+/*
+ * Like the string handlers above, but for members holding a shared
+ * refstr; these must never be released via ni_string_free().
+ */
+dbus_bool_t
+ni_dbus_generic_property_get_refstr(const ni_dbus_object_t *obj, const ni_dbus_property_t *prop,
+					ni_dbus_variant_t *var, DBusError *error)
+{
+	const char **vptr;
+	const void *handle;
+
+	if (!(handle = ni_dbus_generic_property_read_handle(obj, prop, error)))
+		return FALSE;
+
+	vptr = __property_data(prop, handle, refstr);
+	if (*vptr == NULL) {
+		dbus_set_error(error, NI_DBUS_ERROR_PROPERTY_NOT_PRESENT, "property %s not present", prop->name);
+		return FALSE;
+	}
+	ni_dbus_variant_set_string(var, *vptr);
+	return TRUE;
+}
+
+dbus_bool_t
+ni_dbus_generic_property_set_refstr(ni_dbus_object_t *obj, const ni_dbus_property_t *prop,
+					const ni_dbus_variant_t *var, DBusError *error)
+{
+	const char *value;
+	const char **vptr;
+	void *handle;
+
+	if (!(handle = ni_dbus_generic_property_write_handle(obj, prop, error)))
+		return FALSE;
+
+	if (!ni_dbus_variant_get_string(var, &value))
+		return FALSE;
+
+	vptr = __property_data(prop, handle, refstr);
+	ni_refstr_dup(vptr, value);
+	return TRUE;
+}
+
+dbus_bool_t
+ni_dbus_generic_property_parse_refstr(const ni_dbus_property_t *prop, ni_dbus_variant_t *var, const char *string)
+{
+	return ni_dbus_variant_parse(var, string, prop->signature);
+}
+
 dbus_bool_t
 ni_dbus_generic_property_get_uuid(const ni_dbus_object_t *obj, const ni_dbus_property_t *prop,
 					ni_dbus_variant_t *var, DBusError *error)
@@ -9,6 +9,7 @@
 #endif
 
 #include <sys/poll.h>
+#include <sys/time.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
@@ -33,6 +34,7 @@
 #include "util_priv.h"
 #include "appconfig.h"
 #include "auto6.h"
+#include "phasestats.h"
 
 
 const ni_dbus_class_t		ni_objectmodel_addrconf_device_class = {
@@ -147,7 +149,7 @@ __ni_objectmodel_routes_bind_device_name(ni_route_table_t *routes, const char *i
 
 			for (nh = &rp->nh; nh; nh = nh->next) {
 				if (ifname && !nh->device.name) {
-					ni_string_dup(&nh->device.name, ifname);
+					ni_refstr_dup(&nh->device.name, ifname);
 					count++;
 				} else
 				if (ni_string_eq(nh->device.name, ifname)) {
@@ -194,6 +196,206 @@ ni_objectmodel_addrconf_send_event(ni_netdev_t *dev, ni_event_t ifevent, ni_uuid
 	return FALSE;
 }
 
+/*
+ * Reassembly of differential lease updates (diff-seqno/diff-base meta
+ * entries, see ni_objectmodel_get_addrconf_lease_diff): we keep the last
+ * complete set of top-level lease dict entries per supplicant device and
+ * merge each differential update into it. The datum variants may borrow
+ * nested dict keys from the message they arrived in, so every entry pins
+ * that message until the entry is replaced or removed.
+ */
+struct ni_addrconf_lease_diff_entry {
+	struct ni_addrconf_lease_diff_entry *next;
+	char *			key;
+	ni_dbus_variant_t	datum;
+	ni_dbus_message_t *	msg;
+};
+
+struct ni_addrconf_lease_diff_cache {
+	struct ni_addrconf_lease_diff_cache *next;
+	const ni_dbus_addrconf_forwarder_t *forwarder;
+	unsigned int		ifindex;
+	uint32_t		seqno;
+	struct ni_addrconf_lease_diff_entry *entries;
+};
+
+static struct ni_addrconf_lease_diff_cache *	__ni_addrconf_lease_diff_caches;
+
+static struct ni_addrconf_lease_diff_cache *
+__ni_addrconf_lease_diff_cache_find(const ni_dbus_addrconf_forwarder_t *forwarder,
+		unsigned int ifindex)
+{
+	struct ni_addrconf_lease_diff_cache *cache;
+
+	for (cache = __ni_addrconf_lease_diff_caches; cache; cache = cache->next) {
+		if (cache->forwarder == forwarder && cache->ifindex == ifindex)
+			return cache;
+	}
+	return NULL;
+}
+
+static void
+__ni_addrconf_lease_diff_entry_free(struct ni_addrconf_lease_diff_entry *entry)
+{
+	ni_dbus_variant_destroy(&entry->datum);
+	ni_string_free(&entry->key);
+	if (entry->msg)
+		dbus_message_unref(entry->msg);
+	free(entry);
+}
+
+static void
+__ni_addrconf_lease_diff_cache_clear(struct ni_addrconf_lease_diff_cache *cache)
+{
+	struct ni_addrconf_lease_diff_entry *entry;
+
+	while ((entry = cache->entries) != NULL) {
+		cache->entries = entry->next;
+		__ni_addrconf_lease_diff_entry_free(entry);
+	}
+}
+
+static void
+__ni_addrconf_lease_diff_cache_drop(const ni_dbus_addrconf_forwarder_t *forwarder,
+		unsigned int ifindex)
+{
+	struct ni_addrconf_lease_diff_cache **pos, *cache;
+
+	for (pos = &__ni_addrconf_lease_diff_caches; (cache = *pos); pos = &cache->next) {
+		if (cache->forwarder == forwarder && cache->ifindex == ifindex) {
+			*pos = cache->next;
+			__ni_addrconf_lease_diff_cache_clear(cache);
+			free(cache);
+			return;
+		}
+	}
+}
+
+static void
+__ni_addrconf_lease_diff_entry_set(struct ni_addrconf_lease_diff_cache *cache,
+		const char *key, const ni_dbus_variant_t *datum, ni_dbus_message_t *msg)
+{
+	struct ni_addrconf_lease_diff_entry *entry;
+
+	for (entry = cache->entries; entry; entry = entry->next) {
+		if (ni_string_eq(entry->key, key))
+			break;
+	}
+	if (entry == NULL) {
+		entry = xcalloc(1, sizeof(*entry));
+		ni_string_dup(&entry->key, key);
+		entry->next = cache->entries;
+		cache->entries = entry;
+	} else if (entry->msg) {
+		dbus_message_unref(entry->msg);
+		entry->msg = NULL;
+	}
+
+	ni_dbus_variant_copy(&entry->datum, datum);
+	if (msg)
+		entry->msg = dbus_message_ref(msg);
+}
+
+static void
+__ni_addrconf_lease_diff_entry_del(struct ni_addrconf_lease_diff_cache *cache,
+		const char *key)
+{
+	struct ni_addrconf_lease_diff_entry **pos, *entry;
+
+	for (pos = &cache->entries; (entry = *pos); pos = &entry->next) {
+		if (ni_string_eq(entry->key, key)) {
+			*pos = entry->next;
+			__ni_addrconf_lease_diff_entry_free(entry);
+			return;
+		}
+	}
+}
+
+static ni_bool_t
+__ni_addrconf_lease_diff_meta_entry(const char *key)
+{
+	return ni_string_eq(key, NI_OBJECTMODEL_LEASE_DIFF_SEQNO)
+	    || ni_string_eq(key, NI_OBJECTMODEL_LEASE_DIFF_BASE)
+	    || ni_string_eq(key, NI_OBJECTMODEL_LEASE_DIFF_REMOVED);
+}
+
+/*
+ * Returns 0 when @arg is a complete lease dict that can be decoded as-is,
+ * 1 when @merged has been filled with the reassembled lease dict, and a
+ * negative value when a differential update does not apply to the state
+ * we have and the signal must be ignored until the next complete update.
+ */
+static int
+__ni_objectmodel_addrconf_lease_diff_apply(const ni_dbus_addrconf_forwarder_t *forwarder,
+		ni_netdev_t *ifp, ni_dbus_message_t *msg,
+		const ni_dbus_variant_t *arg, ni_dbus_variant_t *merged)
+{
+	struct ni_addrconf_lease_diff_cache *cache;
+	struct ni_addrconf_lease_diff_entry *entry;
+	const ni_dbus_variant_t *datum, *removed;
+	ni_bool_t complete = FALSE;
+	ni_dbus_variant_t *child;
+	uint32_t seqno, base;
+	const char *key;
+	unsigned int i;
+
+	if (!ni_dbus_dict_get_uint32(arg, NI_OBJECTMODEL_LEASE_DIFF_SEQNO, &seqno)) {
+		/* this supplicant does not use differential updates */
+		__ni_addrconf_lease_diff_cache_drop(forwarder, ifp->link.ifindex);
+		return 0;
+	}
+
+	if (!(cache = __ni_addrconf_lease_diff_cache_find(forwarder, ifp->link.ifindex))) {
+		cache = xcalloc(1, sizeof(*cache));
+		cache->forwarder = forwarder;
+		cache->ifindex = ifp->link.ifindex;
+		cache->next = __ni_addrconf_lease_diff_caches;
+		__ni_addrconf_lease_diff_caches = cache;
+	}
+
+	if (ni_dbus_dict_get_uint32(arg, NI_OBJECTMODEL_LEASE_DIFF_BASE, &base)) {
+		if (cache->entries == NULL || cache->seqno != base) {
+			ni_warn("%s: dropping %s:%s lease update %u based on %u (we have %u); "
+				"waiting for a complete update", ifp->name,
+				ni_addrfamily_type_to_name(forwarder->addrfamily),
+				ni_addrconf_type_to_name(forwarder->addrconf),
+				seqno, base, cache->seqno);
+			__ni_addrconf_lease_diff_cache_clear(cache);
+			return -1;
+		}
+
+		removed = ni_dbus_dict_get(arg, NI_OBJECTMODEL_LEASE_DIFF_REMOVED);
+		if (removed && ni_dbus_variant_is_string_array(removed)) {
+			for (i = 0; i < removed->array.len; ++i)
+				__ni_addrconf_lease_diff_entry_del(cache,
+						removed->string_array_value[i]);
+		}
+	} else {
+		/* complete dict; restart tracking from here */
+		__ni_addrconf_lease_diff_cache_clear(cache);
+		complete = TRUE;
+	}
+
+	for (i = 0; (datum = ni_dbus_dict_get_entry(arg, i, &key)); ++i) {
+		if (__ni_addrconf_lease_diff_meta_entry(key))
+			continue;
+		__ni_addrconf_lease_diff_entry_set(cache, key, datum, msg);
+	}
+	cache->seqno = seqno;
+
+	/* a complete dict can be decoded directly; the lease decoder
+	 * simply ignores the meta entries */
+	if (complete || cache->entries == NULL)
+		return 0;
+
+	ni_dbus_variant_init_dict(merged);
+	for (entry = cache->entries; entry; entry = entry->next) {
+		if ((child = ni_dbus_dict_add(merged, entry->key)))
+			ni_dbus_variant_copy(child, &entry->datum);
+	}
+	return 1;
+}
+
 /*
  * Callback from addrconf supplicant whenever it acquired, released or lost a lease.
  *
@@ -209,6 +411,8 @@ ni_objectmodel_addrconf_signal_handler(ni_dbus_connection_t *conn, ni_dbus_messa
 	ni_netdev_t *ifp;
 	ni_addrconf_lease_t *lease = NULL;
 	ni_dbus_variant_t argv[16];
+	ni_dbus_variant_t merged = NI_DBUS_VARIANT_INIT;
+	const ni_dbus_variant_t *lease_dict;
 	ni_uuid_t uuid = NI_UUID_INIT;
 	ni_event_t ifevent;
 	int rv, argc, optind = 0;
@@ -240,7 +444,19 @@ ni_objectmodel_addrconf_signal_handler(ni_dbus_connection_t *conn, ni_dbus_messa
 		goto done;
 	}
 
-	if (!ni_objectmodel_set_addrconf_lease(lease, &argv[optind++])) {
+	lease_dict = &argv[optind++];
+	switch (__ni_objectmodel_addrconf_lease_diff_apply(forwarder, ifp, msg, lease_dict, &merged)) {
+	case 0:
+		break;
+	case 1:
+		lease_dict = &merged;
+		break;
+	default:
+		/* differential update we cannot apply; wait for a complete one */
+		goto done;
+	}
+
+	if (!ni_objectmodel_set_addrconf_lease(lease, lease_dict)) {
 		ni_error("%s: unable to parse lease argument received from %s", __func__,
 				dbus_message_get_sender(msg));
 		goto done;
@@ -262,6 +478,22 @@ ni_objectmodel_addrconf_signal_handler(ni_dbus_connection_t *conn, ni_dbus_messa
 
 		ifevent = NI_EVENT_ADDRESS_ACQUIRED;
 
+		{
+			const ni_addrconf_lease_t *req;
+			struct timeval now, delta;
+
+			req = ni_netdev_get_lease(ifp, lease->family, lease->type);
+			if (req && req->state == NI_ADDRCONF_STATE_REQUESTING &&
+			    timerisset(&req->acquired)) {
+				ni_timer_get_time(&now);
+				if (timercmp(&now, &req->acquired, >)) {
+					timersub(&now, &req->acquired, &delta);
+					ni_phasestats_record(NI_PHASE_ADDRCONF_ACQUIRE,
+							delta.tv_sec * 1000000ULL + delta.tv_usec);
+				}
+			}
+		}
+
 		__ni_objectmodel_routes_bind_device_name(lease->routes, ifp->name);
 		if (!__ni_addrconf_should_update(lease->update, NI_ADDRCONF_UPDATE_DEFAULT_ROUTE)) {
 			ni_route_table_t *tab;
@@ -341,6 +573,7 @@ ni_objectmodel_addrconf_signal_handler(ni_dbus_connection_t *conn, ni_dbus_messa
 	}
 
 done:
+	ni_dbus_variant_destroy(&merged);
 	while (argc--)
 		ni_dbus_variant_destroy(&argv[argc]);
 	if (lease)
@@ -625,6 +858,10 @@ ni_objectmodel_addrconf_forward_request(ni_dbus_addrconf_forwarder_t *forwarder,
 		ni_objectmodel_callback_data_t data = { .lease = lease };
 
 		lease->state = NI_ADDRCONF_STATE_REQUESTING;
+		/* While requesting, the acquired field carries the time the
+		 * acquire call was forwarded; the signal handler uses it to
+		 * measure how long the supplicant took to deliver a lease. */
+		ni_timer_get_time(&lease->acquired);
 
 		/* Tell the client to wait for an addressAcquired event with the given uuid */
 		return __ni_objectmodel_return_callback_info(reply, NI_EVENT_ADDRESS_ACQUIRED,
@@ -571,7 +571,7 @@ __ni_objectmodel_bonding_set_slaves(ni_dbus_object_t *object,
 					object->path, property->name);
 				return FALSE;
 			}
-			ni_string_dup(&bond->primary_slave.name, slave_name);
+			ni_refstr_dup(&bond->primary_slave.name, slave_name);
 		}
 		if (ni_dbus_dict_get_bool(var, "active", &is_active) && is_active) {
 			if (bond->active_slave.name) {
@@ -580,7 +580,7 @@ __ni_objectmodel_bonding_set_slaves(ni_dbus_object_t *object,
 					object->path, property->name);
 				return FALSE;
 			}
-			ni_string_dup(&bond->active_slave.name, slave_name);
+			ni_refstr_dup(&bond->active_slave.name, slave_name);
 		}
 
 		slave = ni_bonding_add_slave(bond, slave_name);
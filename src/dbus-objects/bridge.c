@@ -213,8 +213,12 @@ __ni_objectmodel_bridge_handle(const ni_dbus_object_t *object, ni_bool_t write_a
 	if (!(dev = ni_objectmodel_unwrap_netif(object, error)))
 		return NULL;
 
-	if (!write_access)
+	if (!write_access) {
+		/* catch up on deferred discovery of system devices */
+		if (dev->bridge_stale)
+			return ni_netdev_get_bridge(dev);
 		return dev->bridge;
+	}
 
 	if (!(bridge = ni_netdev_get_bridge(dev))) {
 		dbus_set_error(error, DBUS_ERROR_FAILED, "Error getting bridge handle for interface");
@@ -23,12 +23,17 @@
 #include <wicked/dbus-service.h>
 #include <wicked/system.h>
 #include <wicked/xml.h>
+#include <wicked/linkstats.h>
 #include "netinfo_priv.h"
 #include "dbus-common.h"
 #include "xml-schema.h"
 #include "appconfig.h"
 #include "model.h"
 #include "debug.h"
+#include "stats.h"
+#include "evstats.h"
+#include "phasestats.h"
+#include "util_priv.h"
 
 extern dbus_bool_t	ni_objectmodel_netif_list_refresh(ni_dbus_object_t *);
 static void		ni_objectmodel_register_netif_factory_service(ni_dbus_service_t *);
@@ -311,6 +316,27 @@ ni_objectmodel_netif_list_identify_device(ni_dbus_object_t *object, const ni_dbu
 	return TRUE;
 }
 
+/*
+ * InterfaceList.echo
+ *
+ * Returns its string argument unchanged. This exists for the dbus-bench
+ * tool in testing/, which uses it to measure call round-trip and
+ * marshalling cost in isolation from any real work.
+ */
+static dbus_bool_t
+ni_objectmodel_netif_list_echo(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	const char *payload;
+
+	if (argc != 1 || !ni_dbus_variant_get_string(&argv[0], &payload))
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	ni_dbus_message_append_string(reply, payload);
+	return TRUE;
+}
+
 /*
  * InterfaceList.getAddresses
  */
@@ -458,10 +484,412 @@ ni_objectmodel_netif_list_get_addresses(ni_dbus_object_t *object, const ni_dbus_
 	return rv;
 }
 
+/*
+ * InterfaceList.getStatistics
+ *
+ * Bulk query returning the recorded link statistics sample rings of
+ * all interfaces in a single call, so monitoring does not need one
+ * call (or an `ip -s link` run) per interface.
+ */
+static void
+__ni_objectmodel_link_stats_to_dict(const ni_link_stats_t *stats, ni_dbus_variant_t *dict)
+{
+	ni_dbus_dict_add_uint64(dict, "rx-packets", stats->rx_packets);
+	ni_dbus_dict_add_uint64(dict, "tx-packets", stats->tx_packets);
+	ni_dbus_dict_add_uint64(dict, "rx-bytes", stats->rx_bytes);
+	ni_dbus_dict_add_uint64(dict, "tx-bytes", stats->tx_bytes);
+	ni_dbus_dict_add_uint64(dict, "rx-errors", stats->rx_errors);
+	ni_dbus_dict_add_uint64(dict, "tx-errors", stats->tx_errors);
+	ni_dbus_dict_add_uint64(dict, "rx-dropped", stats->rx_dropped);
+	ni_dbus_dict_add_uint64(dict, "tx-dropped", stats->tx_dropped);
+	ni_dbus_dict_add_uint64(dict, "multicast", stats->multicast);
+	ni_dbus_dict_add_uint64(dict, "collisions", stats->collisions);
+}
+
+static dbus_bool_t
+ni_objectmodel_netif_list_get_statistics(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	dbus_bool_t refresh = FALSE;
+	ni_netdev_t *dev;
+	dbus_bool_t rv;
+
+	if (!reply || !argv || argc != 1 || !ni_dbus_variant_is_dict(&argv[0])) {
+		dbus_set_error(error, DBUS_ERROR_INVALID_ARGS,
+				"%s.%s: invalid argument dict",
+				object->path, method->name);
+		return FALSE;
+	}
+	ni_dbus_dict_get_bool(&argv[0], "refresh", &refresh);
+
+	/* when refresh, take an up-to-the-moment sample first */
+	if (refresh && (!nc || __ni_system_refresh_interfaces(nc) < 0)) {
+		dbus_set_error(error, DBUS_ERROR_FAILED, "Unable to refresh interface list");
+		return FALSE;
+	}
+
+	ni_dbus_variant_init_dict(&result);
+	for (dev = nc ? ni_netconfig_devlist(nc) : NULL; dev; dev = dev->next) {
+		const ni_link_stats_sample_t *sample;
+		ni_dbus_variant_t *samples, *dict;
+		unsigned int age;
+		const char *path;
+
+		path = ni_objectmodel_netif_full_path(dev);
+		if (ni_string_empty(path) || !dev->link.stats_ring)
+			continue;
+
+		if (!(dict = ni_dbus_dict_add(&result, path)))
+			break;
+		ni_dbus_variant_init_dict(dict);
+		ni_dbus_dict_add_string(dict, "name",  dev->name);
+		ni_dbus_dict_add_uint32(dict, "index", dev->link.ifindex);
+
+		if (!(samples = ni_dbus_dict_add(dict, "samples")))
+			break;
+		ni_dbus_dict_array_init(samples);
+
+		/* newest sample first */
+		for (age = 0; (sample = ni_link_stats_ring_get(dev->link.stats_ring, age)); ++age) {
+			if (!(dict = ni_dbus_dict_array_add(samples)))
+				break;
+			ni_dbus_dict_add_uint64(dict, "time",
+					(uint64_t)sample->when.tv_sec * 1000 +
+					sample->when.tv_usec / 1000);
+			__ni_objectmodel_link_stats_to_dict(&sample->stats, dict);
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+/*
+ * InterfaceList.getClientInfo
+ *
+ * Report name, index, flags and client state (config origin/uuid,
+ * persistent mode) of all interfaces in one compact dict, so that
+ * clients like ifcheck can decide up-to-date-ness of all interfaces
+ * with a single round trip instead of a full object refresh.
+ */
+static dbus_bool_t
+ni_objectmodel_netif_list_get_client_info(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	const ni_netdev_t *dev;
+	dbus_bool_t rv;
+
+	ni_dbus_variant_init_dict(&result);
+	for (dev = nc ? ni_netconfig_devlist(nc) : NULL; dev; dev = dev->next) {
+		const ni_client_state_t *cs = dev->client_state;
+		ni_dbus_variant_t *entry;
+
+		if (!dev->name || !dev->link.ifindex)
+			continue;
+
+		if (!(entry = ni_dbus_dict_add(&result, dev->name)))
+			continue;
+
+		ni_dbus_variant_init_dict(entry);
+		ni_dbus_dict_add_uint32(entry, "index", dev->link.ifindex);
+		ni_dbus_dict_add_uint32(entry, "flags", dev->link.ifflags);
+		if (cs) {
+			ni_dbus_dict_add_bool(entry, "persistent", cs->control.persistent);
+			if (!ni_string_empty(cs->config.origin))
+				ni_dbus_dict_add_string(entry, "config-origin",
+							cs->config.origin);
+			if (!ni_uuid_is_null(&cs->config.uuid))
+				ni_dbus_dict_add_string(entry, "config-uuid",
+							ni_uuid_print(&cs->config.uuid));
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+/*
+ * InterfaceList.getRuntimeStats
+ *
+ * Report the daemon's runtime work counters and event loop latency
+ * accounting, so a production wickedd can be asked what it has been
+ * doing without enabling debug logging or restarting it.
+ */
+static dbus_bool_t
+ni_objectmodel_netif_list_get_runtime_stats(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t *counters, *latency, *phases, *stalls, *memory, *dict;
+	const ni_evstat_offender_t *off;
+	unsigned int type;
+	dbus_bool_t rv;
+
+	ni_dbus_variant_init_dict(&result);
+
+	if ((counters = ni_dbus_dict_add(&result, "counters"))) {
+		ni_dbus_variant_init_dict(counters);
+		for (type = 0; type < __NI_STAT_MAX; ++type)
+			ni_dbus_dict_add_uint64(counters,
+					ni_stat_type_name(type), ni_stats_get(type));
+	}
+
+	if ((latency = ni_dbus_dict_add(&result, "latency"))) {
+		ni_dbus_variant_init_dict(latency);
+		for (type = 0; type < __NI_EVSTAT_MAX; ++type) {
+			const ni_evstat_hist_t *hist = ni_evstats_get(type);
+
+			if (!hist || !(dict = ni_dbus_dict_add(latency, ni_evstat_type_name(type))))
+				continue;
+			ni_dbus_variant_init_dict(dict);
+			ni_dbus_dict_add_uint64(dict, "count", hist->count);
+			ni_dbus_dict_add_uint64(dict, "total-usec", hist->total_usec);
+			ni_dbus_dict_add_uint64(dict, "max-usec", hist->max_usec);
+		}
+	}
+
+	if ((phases = ni_dbus_dict_add(&result, "phases"))) {
+		ni_dbus_variant_init_dict(phases);
+		for (type = 0; type < __NI_PHASE_MAX; ++type) {
+			const ni_evstat_hist_t *hist = ni_phasestats_get(type);
+			ni_dbus_variant_t *buckets;
+			unsigned int bucket;
+			char name[32];
+
+			if (!hist || !(dict = ni_dbus_dict_add(phases, ni_phase_type_name(type))))
+				continue;
+			ni_dbus_variant_init_dict(dict);
+			ni_dbus_dict_add_uint64(dict, "count", hist->count);
+			ni_dbus_dict_add_uint64(dict, "total-usec", hist->total_usec);
+			ni_dbus_dict_add_uint64(dict, "max-usec", hist->max_usec);
+
+			if (!(buckets = ni_dbus_dict_add(dict, "buckets")))
+				continue;
+			ni_dbus_variant_init_dict(buckets);
+			for (bucket = 0; bucket < NI_EVSTAT_BUCKETS; ++bucket) {
+				if (!hist->bucket[bucket])
+					continue;
+				if (bucket + 1 < NI_EVSTAT_BUCKETS)
+					snprintf(name, sizeof(name), "le-%llu",
+							1ULL << bucket);
+				else
+					snprintf(name, sizeof(name), "le-inf");
+				ni_dbus_dict_add_uint64(buckets, name,
+						hist->bucket[bucket]);
+			}
+		}
+	}
+
+	if ((stalls = ni_dbus_dict_add(&result, "stalls"))) {
+		ni_dbus_variant_init_dict(stalls);
+		for (type = 0; (off = ni_evstats_offender_get(type)); ++type) {
+			if (!(dict = ni_dbus_dict_add(stalls, off->ident)))
+				continue;
+			ni_dbus_variant_init_dict(dict);
+			ni_dbus_dict_add_uint64(dict, "count", off->count);
+			ni_dbus_dict_add_uint64(dict, "total-usec", off->total_usec);
+			ni_dbus_dict_add_uint64(dict, "max-usec", off->max_usec);
+		}
+	}
+
+	if ((memory = ni_dbus_dict_add(&result, "memory"))) {
+		const ni_memstat_t *mem;
+		const ni_arena_t *arena;
+
+		ni_dbus_variant_init_dict(memory);
+		for (type = 0; type < __NI_MEMTAG_MAX; ++type) {
+			if (!(mem = ni_memstats_get(type)))
+				continue;
+			if (!(dict = ni_dbus_dict_add(memory, ni_memtag_name(type))))
+				continue;
+			ni_dbus_variant_init_dict(dict);
+			ni_dbus_dict_add_uint64(dict, "allocs", mem->allocs);
+			ni_dbus_dict_add_uint64(dict, "frees", mem->frees);
+			ni_dbus_dict_add_uint64(dict, "live-bytes",
+					mem->bytes_alloc - mem->bytes_freed);
+		}
+		for (arena = ni_arena_stats_list(); arena; arena = arena->next) {
+			if (ni_string_empty(arena->name))
+				continue;
+			if (!(dict = ni_dbus_dict_add(memory, arena->name)))
+				continue;
+			ni_dbus_variant_init_dict(dict);
+			ni_dbus_dict_add_uint64(dict, "allocs", arena->stats.allocs);
+			ni_dbus_dict_add_uint64(dict, "resets", arena->stats.resets);
+			ni_dbus_dict_add_uint64(dict, "live-bytes", arena->stats.capacity);
+		}
+	}
+	if ((dict = ni_dbus_dict_add(&result, "refresh"))) {
+		const ni_refresh_stats_t *refresh;
+
+		ni_dbus_variant_init_dict(dict);
+		if ((refresh = ni_netconfig_refresh_stats(ni_global_state_handle(0)))) {
+			ni_dbus_dict_add_uint64(dict, "count", refresh->count);
+			ni_dbus_dict_add_uint64(dict, "skipped", refresh->skipped);
+			ni_dbus_dict_add_uint64(dict, "last-usec", refresh->last_usec);
+			ni_dbus_dict_add_uint64(dict, "ewma-usec", refresh->ewma_usec);
+			ni_dbus_dict_add_uint64(dict, "max-usec", refresh->max_usec);
+			ni_dbus_dict_add_uint64(dict, "devices", refresh->devices);
+			ni_dbus_dict_add_uint64(dict, "routes", refresh->routes);
+		}
+	}
+	ni_dbus_dict_add_uint64(&result, "max-stall-usec", ni_evstats_max_stall());
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+/*
+ * InterfaceList.resetRuntimeStats
+ *
+ * Zero the phase duration histograms, so a scraper can obtain
+ * per-interval distributions instead of counters since daemon start.
+ * The plain work counters are monotonic by design and remain untouched.
+ */
+static dbus_bool_t
+ni_objectmodel_netif_list_reset_runtime_stats(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_phasestats_reset();
+	return TRUE;
+}
+
+/*
+ * Bounded journal of emitted interface events.
+ *
+ * Clients watching the netif list can present the seqno of the last
+ * event they saw to InterfaceList.getEventsSince and learn which
+ * devices changed while they were away, instead of transferring the
+ * whole interface tree via ObjectManager.GetManagedObjects after
+ * every transient connection loss.
+ */
+#define NI_OBJECTMODEL_NETIF_JOURNAL_SIZE	256
+
+typedef struct ni_objectmodel_netif_journal_entry {
+	uint32_t		seqno;
+	unsigned int		ifindex;
+	ni_event_t		event;
+} ni_objectmodel_netif_journal_entry_t;
+
+static ni_objectmodel_netif_journal_entry_t	__ni_objectmodel_netif_journal[NI_OBJECTMODEL_NETIF_JOURNAL_SIZE];
+static uint32_t		__ni_objectmodel_netif_journal_seqno;	/* seqno of newest entry; 0 means none yet */
+static unsigned int	__ni_objectmodel_netif_journal_count;
+
+static void
+__ni_objectmodel_netif_journal_record(ni_dbus_object_t *object, ni_event_t ifevent)
+{
+	ni_objectmodel_netif_journal_entry_t *entry;
+	ni_netdev_t *dev;
+
+	if (!(dev = ni_objectmodel_unwrap_netif(object, NULL)) || !dev->link.ifindex)
+		return;
+
+	__ni_objectmodel_netif_journal_seqno++;
+	entry = &__ni_objectmodel_netif_journal[__ni_objectmodel_netif_journal_seqno
+						% NI_OBJECTMODEL_NETIF_JOURNAL_SIZE];
+	entry->seqno = __ni_objectmodel_netif_journal_seqno;
+	entry->ifindex = dev->link.ifindex;
+	entry->event = ifevent;
+
+	if (__ni_objectmodel_netif_journal_count < NI_OBJECTMODEL_NETIF_JOURNAL_SIZE)
+		__ni_objectmodel_netif_journal_count++;
+}
+
+/*
+ * InterfaceList.getEventsSince
+ *
+ * Return the object paths of devices that emitted events after the
+ * given journal seqno, so that a reconnecting client can refresh just
+ * those instead of re-enumerating every interface.  The reply always
+ * carries the current head seqno as the caller's next resume token;
+ * when the requested window has already been overwritten, "stale" is
+ * set and the caller must fall back to a complete enumeration.
+ * Devices whose most recent event was a deletion are reported
+ * separately in "deleted".
+ */
+static dbus_bool_t
+ni_objectmodel_netif_list_get_events_since(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	unsigned int ifindex[NI_OBJECTMODEL_NETIF_JOURNAL_SIZE];
+	ni_event_t last[NI_OBJECTMODEL_NETIF_JOURNAL_SIZE];
+	ni_dbus_variant_t *changed = NULL, *deleted = NULL;
+	unsigned int ndevices = 0, i;
+	uint32_t token, head, seq;
+	dbus_bool_t rv;
+
+	if (argc != 1 || !ni_dbus_variant_get_uint32(&argv[0], &token))
+		return ni_dbus_error_invalid_args(error, object->path, method->name);
+
+	head = __ni_objectmodel_netif_journal_seqno;
+	ni_dbus_variant_init_dict(&result);
+	ni_dbus_dict_add_uint32(&result, "seqno", head);
+
+	if (head - token > __ni_objectmodel_netif_journal_count) {
+		/* the window (token, head] is no longer fully retained */
+		ni_dbus_dict_add_bool(&result, "stale", TRUE);
+	} else {
+		for (seq = token + 1; seq != (uint32_t) (head + 1); ++seq) {
+			const ni_objectmodel_netif_journal_entry_t *entry;
+
+			/* the count check above guarantees entry->seqno == seq */
+			entry = &__ni_objectmodel_netif_journal[seq % NI_OBJECTMODEL_NETIF_JOURNAL_SIZE];
+			for (i = 0; i < ndevices; ++i) {
+				if (ifindex[i] == entry->ifindex)
+					break;
+			}
+			if (i == ndevices)
+				ifindex[ndevices++] = entry->ifindex;
+			last[i] = entry->event;
+		}
+
+		for (i = 0; i < ndevices; ++i) {
+			char pathbuf[128];
+
+			snprintf(pathbuf, sizeof(pathbuf), NI_OBJECTMODEL_OBJECT_PATH "/Interface/%u",
+					ifindex[i]);
+			if (last[i] == NI_EVENT_DEVICE_DELETE) {
+				if (!deleted && (deleted = ni_dbus_dict_add(&result, "deleted")))
+					ni_dbus_variant_init_object_path_array(deleted);
+				if (deleted)
+					ni_dbus_variant_append_object_path_array(deleted, pathbuf);
+			} else {
+				if (!changed && (changed = ni_dbus_dict_add(&result, "changed")))
+					ni_dbus_variant_init_object_path_array(changed);
+				if (changed)
+					ni_dbus_variant_append_object_path_array(changed, pathbuf);
+			}
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
 static ni_dbus_method_t		ni_objectmodel_netif_list_methods[] = {
 	{ "deviceByName",	"s",		.handler = ni_objectmodel_netif_list_device_by_name },
 	{ "identifyDevice",	"sa{sv}",	.handler = ni_objectmodel_netif_list_identify_device },
 	{ "getAddresses",	"a{sv}",	.handler = ni_objectmodel_netif_list_get_addresses },
+	{ "getStatistics",	"a{sv}",	.handler = ni_objectmodel_netif_list_get_statistics },
+	{ "getClientInfo",	"",		.handler = ni_objectmodel_netif_list_get_client_info },
+	{ "getRuntimeStats",	"",		.handler = ni_objectmodel_netif_list_get_runtime_stats },
+	{ "resetRuntimeStats",	"",		.handler = ni_objectmodel_netif_list_reset_runtime_stats },
+	{ "getEventsSince",	"u",		.handler = ni_objectmodel_netif_list_get_events_since },
+	{ "echo",		"s",		.handler = ni_objectmodel_netif_list_echo },
 	{ NULL }
 };
 
@@ -539,7 +967,13 @@ __ni_objectmodel_build_netif_object(ni_dbus_server_t *server, ni_netdev_t *dev,
 		return NULL;
 	}
 
-	ni_objectmodel_bind_compatible_interfaces(object);
+	/* Server-side objects defer interface binding until first access;
+	 * scanning the service table for every device would dominate startup
+	 * on hosts with many interfaces. */
+	if (server != NULL)
+		object->lazy_bind = TRUE;
+	else
+		ni_objectmodel_bind_compatible_interfaces(object);
 	return object;
 }
 
@@ -1201,6 +1635,92 @@ ni_objectmodel_netif_set_client_state_scripts(ni_dbus_object_t *object, const ni
 	return TRUE;
 }
 
+/*
+ * Checksum-gated state signals.
+ *
+ * A full refresh re-processes every device and re-emits deviceChange
+ * even when nothing effectively changed; during route churn, nearly
+ * all of these signals are no-ops for every subscriber. Fingerprint
+ * the marshalled property set of the object before emitting and
+ * suppress the signal when it matches the state last published.
+ */
+typedef struct ni_objectmodel_netif_csum	ni_objectmodel_netif_csum_t;
+struct ni_objectmodel_netif_csum {
+	ni_objectmodel_netif_csum_t *next;
+	unsigned int		ifindex;
+	uint32_t		csum;
+};
+
+static ni_objectmodel_netif_csum_t *	__ni_objectmodel_netif_csums;
+
+static uint32_t
+__ni_objectmodel_netif_properties_csum(ni_dbus_object_t *object)
+{
+	const ni_dbus_service_t *service;
+	unsigned int i;
+	uint32_t csum = 0;
+
+	ni_dbus_object_bind_interfaces(object);
+	for (i = 0; object->interfaces && (service = object->interfaces[i]); ++i) {
+		ni_dbus_variant_t dict = NI_DBUS_VARIANT_INIT;
+
+		ni_dbus_variant_init_dict(&dict);
+		if (ni_dbus_object_get_properties_as_dict(object, service, &dict, NULL)) {
+			csum = ni_crc32c(csum, service->name, strlen(service->name) + 1);
+			csum = ni_dbus_variant_csum(csum, &dict);
+		}
+		ni_dbus_variant_destroy(&dict);
+	}
+	return csum;
+}
+
+static ni_bool_t
+__ni_objectmodel_netif_event_suppress(ni_dbus_object_t *object, ni_event_t ifevent)
+{
+	ni_objectmodel_netif_csum_t **pos, *entry;
+	ni_netdev_t *dev;
+	uint32_t csum;
+
+	if (!(dev = ni_objectmodel_unwrap_netif(object, NULL)) || !dev->link.ifindex)
+		return FALSE;
+
+	for (pos = &__ni_objectmodel_netif_csums; (entry = *pos) != NULL; pos = &entry->next) {
+		if (entry->ifindex == dev->link.ifindex)
+			break;
+	}
+
+	switch (ifevent) {
+	case NI_EVENT_DEVICE_DELETE:
+		if (entry) {
+			*pos = entry->next;
+			free(entry);
+		}
+		return FALSE;
+
+	case NI_EVENT_DEVICE_CREATE:
+	case NI_EVENT_DEVICE_CHANGE:
+		break;
+
+	default:
+		/* edge-triggered events carry meaning of their own */
+		return FALSE;
+	}
+
+	csum = __ni_objectmodel_netif_properties_csum(object);
+	if (!entry) {
+		entry = xcalloc(1, sizeof(*entry));
+		entry->ifindex = dev->link.ifindex;
+		entry->next = NULL;
+		*pos = entry;
+	} else if (ifevent == NI_EVENT_DEVICE_CHANGE && entry->csum == csum) {
+		ni_debug_dbus("%s: suppressing deviceChange signal, property state unchanged",
+				ni_dbus_object_get_path(object));
+		return TRUE;
+	}
+	entry->csum = csum;
+	return FALSE;
+}
+
 /*
  * Broadcast an interface event
  * The optional uuid argument helps the client match e.g. notifications
@@ -1218,6 +1738,11 @@ ni_objectmodel_send_netif_event(ni_dbus_server_t *server, ni_dbus_object_t *obje
 		return FALSE;
 	}
 
+	if (!uuid && __ni_objectmodel_netif_event_suppress(object, ifevent))
+		return TRUE;
+
+	__ni_objectmodel_netif_journal_record(object, ifevent);
+
 	return __ni_objectmodel_device_event(server, object, NI_OBJECTMODEL_NETIF_INTERFACE, ifevent, uuid);
 }
 
@@ -1533,6 +2058,16 @@ ni_objectmodel_netif_client_state_config_to_dict(const ni_client_state_config_t
 		return FALSE;
 	}
 
+	if (conf->node) {
+		char *data;
+
+		if ((data = xml_node_sprint(conf->node))) {
+			ni_dbus_dict_add_string(var,
+				NI_CLIENT_STATE_XML_CONFIG_DATA_NODE, data);
+			free(data);
+		}
+	}
+
 	return TRUE;
 }
 
@@ -1651,6 +2186,25 @@ ni_objectmodel_netif_client_state_config_from_dict(ni_client_state_config_t *con
 		return FALSE;
 	}
 
+	/* the applied config document is optional */
+	xml_node_free(conf->node);
+	conf->node = NULL;
+	if (ni_dbus_dict_get_string(var,
+	    NI_CLIENT_STATE_XML_CONFIG_DATA_NODE, &sval) &&
+	    !ni_string_empty(sval)) {
+		xml_node_t *root;
+		FILE *fp;
+
+		if ((fp = fmemopen((void *) sval, strlen(sval), "r"))) {
+			if ((root = xml_node_scan(fp, NI_CLIENT_STATE_XML_CONFIG_DATA_NODE))) {
+				if (root->children)
+					conf->node = xml_node_clone(root->children, NULL);
+				xml_node_free(root);
+			}
+			fclose(fp);
+		}
+	}
+
 	return TRUE;
 }
 
@@ -1698,7 +2252,7 @@ static ni_dbus_property_t	ni_objectmodel_netif_properties[] = {
 	NI_DBUS_GENERIC_UINT_PROPERTY(netdev, mtu, link.mtu, RO),
 	NI_DBUS_GENERIC_UINT_PROPERTY(netdev, txqlen, link.txqlen, RO),
 	NI_DBUS_GENERIC_STRING_PROPERTY(netdev, alias, link.alias, RO),
-	NI_DBUS_GENERIC_STRING_PROPERTY(netdev, master, link.masterdev.name, RO),
+	NI_DBUS_GENERIC_REFSTR_PROPERTY(netdev, master, link.masterdev.name, RO),
 
 	___NI_DBUS_PROPERTY(NI_DBUS_DICT_SIGNATURE,
 				client-state, client_state,
@@ -1860,6 +2414,8 @@ __ni_objectmodel_netdev_req_set_port(ni_dbus_object_t *object, const ni_dbus_pro
 	NI_DBUS_GENERIC_UINT_PROPERTY(netdev_req, dbus_name, name, rw)
 #define NETIF_REQUEST_STRING_PROPERTY(dbus_name, name, rw) \
 	NI_DBUS_GENERIC_STRING_PROPERTY(netdev_req, dbus_name, name, rw)
+#define NETIF_REQUEST_REFSTR_PROPERTY(dbus_name, name, rw) \
+	NI_DBUS_GENERIC_REFSTR_PROPERTY(netdev_req, dbus_name, name, rw)
 #define NETIF_REQUEST_PROPERTY_SIGNATURE(signature, __name, rw) \
 	__NI_DBUS_PROPERTY(signature, __name, __ni_objectmodel_netdev_req, rw)
 #define NETIF_REQUEST_UNION_PROPERTY(name, rw) \
@@ -1871,7 +2427,7 @@ static ni_dbus_property_t	ni_objectmodel_netif_request_properties[] = {
 	NETIF_REQUEST_UINT_PROPERTY(metric, metric, RO),
 	NETIF_REQUEST_UINT_PROPERTY(txqlen, txqlen, RO),
 	NETIF_REQUEST_STRING_PROPERTY(alias, alias, RO),
-	NETIF_REQUEST_STRING_PROPERTY(master, master.name, RO),
+	NETIF_REQUEST_REFSTR_PROPERTY(master, master.name, RO),
 	NETIF_REQUEST_UNION_PROPERTY(port, RO),
 
 	{ NULL }
@@ -288,7 +288,7 @@ __ni_objectmodel_macvlan_change(ni_netdev_t *cfg, ni_netdev_t *dev, DBusError *e
 		return FALSE;
 	}
 	cfg->link.lowerdev.index = dev->link.lowerdev.index;
-	ni_string_dup(&cfg->link.lowerdev.name, dev->link.lowerdev.name);
+	ni_refstr_dup(&cfg->link.lowerdev.name, dev->link.lowerdev.name);
 
 	cfg->link.ifindex = dev->link.ifindex;
 	if (ni_string_empty(cfg->name))
@@ -500,7 +500,7 @@ __ni_objectmodel_macvlan_set_flags(ni_dbus_object_t *object,
 				dbus_name, __ni_objectmodel_macvlan, rw)
 
 const ni_dbus_property_t	ni_objectmodel_macvlan_property_table[] = {
-	NI_DBUS_GENERIC_STRING_PROPERTY(netdev,  device, link.lowerdev.name, RO),
+	NI_DBUS_GENERIC_REFSTR_PROPERTY(netdev,  device, link.lowerdev.name, RO),
 	MACVLAN_HWADDR_PROPERTY(address, RO),
 	MACVLAN_UINT32_PROPERTY(mode, RO),
 	MACVLAN_UINT16_PROPERTY(flags, RO),
@@ -31,6 +31,7 @@
 #include "misc.h"
 #include "model.h"
 #include "debug.h"
+#include "util_priv.h"
 #include "dhcp.h"
 
 static dbus_bool_t		__ni_objectmodel_callback_info_to_dict(const ni_objectmodel_callback_info_t *, ni_dbus_variant_t *);
@@ -1068,7 +1069,7 @@ __ni_objectmodel_route_nexthop_from_dict(ni_route_nexthop_t *nh, const ni_dbus_v
 					ni_print_suspect(string, ni_string_len(string)));
 			return FALSE;
 		}
-		ni_string_dup(&nh->device.name, string);
+		ni_refstr_dup(&nh->device.name, string);
 	}
 
 	if (ni_dbus_dict_get_uint32(nhdict, "weight", &value))
@@ -1434,12 +1435,12 @@ ni_objectmodel_rule_match_from_dict(ni_rule_t *rule, const ni_dbus_variant_t *di
 
 	if (ni_dbus_dict_get_string(dict, "iif", &ptr)) {
 		if (!ni_netdev_name_is_valid(ptr) ||
-		    !ni_string_dup(&rule->iif.name, ptr))
+		    !ni_refstr_dup(&rule->iif.name, ptr))
 			return FALSE;
 	}
 	if (ni_dbus_dict_get_string(dict, "oif", &ptr)) {
 		if (!ni_netdev_name_is_valid(ptr) ||
-		    !ni_string_dup(&rule->oif.name, ptr))
+		    !ni_refstr_dup(&rule->oif.name, ptr))
 			return FALSE;
 	}
 
@@ -1814,6 +1815,121 @@ ni_objectmodel_get_addrconf_lease(const ni_addrconf_lease_t *lease, ni_dbus_vari
 	return TRUE;
 }
 
+/*
+ * Differential lease updates. Rather than sending the complete lease dict
+ * to the server on every change, send only the top-level entries that
+ * differ from what we sent last time, tagged with a sequence number so
+ * the receiver can detect when it missed an update. Every
+ * NI_OBJECTMODEL_LEASE_DIFF_CYCLE updates we send a complete dict again,
+ * which also reconciles the receiver after a restart on either side.
+ */
+#define NI_OBJECTMODEL_LEASE_DIFF_CYCLE		8
+
+struct ni_objectmodel_lease_diff {
+	struct ni_objectmodel_lease_diff *next;
+	char *			path;
+	uint32_t		seqno;
+	unsigned int		since_full;
+	ni_dbus_variant_t	dict;
+};
+
+static struct ni_objectmodel_lease_diff *	__ni_objectmodel_lease_diffs;
+
+static struct ni_objectmodel_lease_diff *
+__ni_objectmodel_lease_diff_find(const char *path)
+{
+	struct ni_objectmodel_lease_diff *state;
+
+	for (state = __ni_objectmodel_lease_diffs; state; state = state->next) {
+		if (ni_string_eq(state->path, path))
+			return state;
+	}
+	return NULL;
+}
+
+void
+ni_objectmodel_addrconf_lease_diff_forget(const char *path)
+{
+	struct ni_objectmodel_lease_diff **pos, *state;
+
+	for (pos = &__ni_objectmodel_lease_diffs; (state = *pos); pos = &state->next) {
+		if (ni_string_eq(state->path, path)) {
+			*pos = state->next;
+			ni_dbus_variant_destroy(&state->dict);
+			ni_string_free(&state->path);
+			free(state);
+			return;
+		}
+	}
+}
+
+dbus_bool_t
+ni_objectmodel_get_addrconf_lease_diff(const ni_addrconf_lease_t *lease,
+				ni_dbus_variant_t *result, const char *path)
+{
+	ni_dbus_variant_t full = NI_DBUS_VARIANT_INIT;
+	struct ni_objectmodel_lease_diff *state;
+	const ni_dbus_variant_t *datum, *prev;
+	ni_dbus_variant_t *child;
+	const char *key;
+	unsigned int i;
+
+	ni_dbus_variant_init_dict(&full);
+	if (!ni_objectmodel_get_addrconf_lease(lease, &full)) {
+		ni_dbus_variant_destroy(&full);
+		return FALSE;
+	}
+
+	if (!(state = __ni_objectmodel_lease_diff_find(path))) {
+		state = xcalloc(1, sizeof(*state));
+		ni_string_dup(&state->path, path);
+		state->next = __ni_objectmodel_lease_diffs;
+		__ni_objectmodel_lease_diffs = state;
+	}
+
+	if (!ni_dbus_variant_is_dict(&state->dict)
+	 || state->since_full + 1 >= NI_OBJECTMODEL_LEASE_DIFF_CYCLE) {
+		/* Send the complete dict, re-syncing the receiver with us */
+		ni_dbus_variant_destroy(&state->dict);
+		state->dict = full;
+		state->since_full = 0;
+
+		ni_dbus_variant_copy(result, &state->dict);
+		ni_dbus_dict_add_uint32(result, NI_OBJECTMODEL_LEASE_DIFF_SEQNO,
+				++state->seqno);
+		return TRUE;
+	}
+
+	/* changed or added entries */
+	for (i = 0; (datum = ni_dbus_dict_get_entry(&full, i, &key)); ++i) {
+		prev = ni_dbus_dict_get(&state->dict, key);
+		if (prev && ni_dbus_variant_csum(0, prev) == ni_dbus_variant_csum(0, datum))
+			continue;
+		if ((child = ni_dbus_dict_add(result, key)))
+			ni_dbus_variant_copy(child, datum);
+	}
+
+	/* entries that disappeared since the last update */
+	child = NULL;
+	for (i = 0; ni_dbus_dict_get_entry(&state->dict, i, &key); ++i) {
+		if (ni_dbus_dict_get(&full, key))
+			continue;
+		if (child == NULL) {
+			child = ni_dbus_dict_add(result, NI_OBJECTMODEL_LEASE_DIFF_REMOVED);
+			ni_dbus_variant_init_string_array(child);
+		}
+		ni_dbus_variant_append_string_array(child, key);
+	}
+
+	ni_dbus_dict_add_uint32(result, NI_OBJECTMODEL_LEASE_DIFF_BASE, state->seqno);
+	ni_dbus_dict_add_uint32(result, NI_OBJECTMODEL_LEASE_DIFF_SEQNO, ++state->seqno);
+
+	ni_dbus_variant_destroy(&state->dict);
+	state->dict = full;
+	state->since_full++;
+	return TRUE;
+}
+
 static dbus_bool_t
 __ni_objectmodel_set_addrconf_dhcp4_data(struct ni_addrconf_lease_dhcp4 *dhcp4,
 					const ni_dbus_variant_t *dict,
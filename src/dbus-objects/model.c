@@ -29,6 +29,7 @@
 #include "debug.h"
 #include "dbus-connection.h"
 #include "process.h"
+#include "evstats.h"
 
 extern ni_dbus_object_t *	ni_objectmodel_new_interface(ni_dbus_server_t *server,
 					const ni_dbus_service_t *service,
@@ -50,6 +51,8 @@ static ni_dbus_class_array_t	ni_objectmodel_class_registry;
 static ni_dbus_service_array_t	ni_objectmodel_service_registry;
 
 static ni_dbus_service_t	ni_objectmodel_netif_root_interface;
+static ni_dbus_service_t	ni_objectmodel_stats_interface;
+static void			ni_objectmodel_lazy_bind(ni_dbus_object_t *);
 
 ni_dbus_server_t *		__ni_objectmodel_server;
 ni_xs_scope_t *			__ni_objectmodel_schema;
@@ -86,6 +89,9 @@ ni_objectmodel_init(ni_dbus_server_t *server)
 		/* Register all built-in classes and services */
 		ni_objectmodel_register_all();
 
+		/* Allow objects to defer service binding until first access */
+		ni_dbus_object_set_lazy_binder(ni_objectmodel_lazy_bind);
+
 		/* Register/amend all services defined in the schema */
 		ni_dbus_xml_register_services(__ni_objectmodel_schema);
 
@@ -131,6 +137,7 @@ ni_objectmodel_create_initial_objects(ni_dbus_server_t *server)
 	/* Register root interface with the root of the object hierarchy */
 	object = ni_dbus_server_get_root_object(server);
 	ni_dbus_object_register_service(object, &ni_objectmodel_netif_root_interface);
+	ni_dbus_object_register_service(object, &ni_objectmodel_stats_interface);
 
 	ni_objectmodel_create_netif_list(server);
 #ifdef MODEM
@@ -139,6 +146,70 @@ ni_objectmodel_create_initial_objects(ni_dbus_server_t *server)
 	return TRUE;
 }
 
+static void
+ni_objectmodel_lazy_bind(ni_dbus_object_t *object)
+{
+	ni_objectmodel_bind_compatible_interfaces(object);
+}
+
+/*
+ * All objects of a given class get the same set of services bound, so
+ * there is no point in building an identical interface table for every
+ * netif object. We build the table once per class and let all objects
+ * of that class reference it (interfaces_shared); an object diverges
+ * from the shared table only when an extra service is registered on it
+ * explicitly, see ni_dbus_object_register_service().
+ */
+struct ni_objectmodel_class_interfaces {
+	struct ni_objectmodel_class_interfaces *next;
+	const ni_dbus_class_t *	class;
+	unsigned int		registry_count;
+	const ni_dbus_service_t **interfaces;
+};
+
+static struct ni_objectmodel_class_interfaces *	__ni_objectmodel_class_interfaces;
+
+static const struct ni_objectmodel_class_interfaces *
+__ni_objectmodel_class_interfaces_get(const ni_dbus_class_t *class)
+{
+	struct ni_objectmodel_class_interfaces *entry;
+	const ni_dbus_service_t *services[NI_DBUS_SERVICES_MAX + 1];
+	ni_bool_t properties = FALSE;
+	unsigned int i, count;
+
+	for (entry = __ni_objectmodel_class_interfaces; entry; entry = entry->next) {
+		if (entry->class == class)
+			return entry;
+	}
+
+	count = 0;
+	for (i = 0; i < ni_objectmodel_service_registry.count; ++i) {
+		const ni_dbus_service_t *service = ni_objectmodel_service_registry.services[i];
+
+		if (!ni_dbus_class_is_subclass(class, service->compatible))
+			continue;
+		services[count++] = service;
+		if (service->properties)
+			properties = TRUE;
+	}
+
+	/* registering a service with properties pulls in the standard
+	 * properties interface; include it in the shared table */
+	if (properties)
+		services[count++] = ni_dbus_get_standard_service(NI_DBUS_INTERFACE ".Properties");
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->class = class;
+	entry->registry_count = ni_objectmodel_service_registry.count;
+	if (count) {
+		entry->interfaces = xcalloc(count + 1, sizeof(entry->interfaces[0]));
+		memcpy(entry->interfaces, services, count * sizeof(services[0]));
+	}
+	entry->next = __ni_objectmodel_class_interfaces;
+	__ni_objectmodel_class_interfaces = entry;
+	return entry;
+}
+
 dbus_bool_t
 ni_objectmodel_bind_compatible_interfaces(ni_dbus_object_t *object)
 {
@@ -150,6 +221,22 @@ ni_objectmodel_bind_compatible_interfaces(ni_dbus_object_t *object)
 	}
 
 	NI_TRACE_ENTER_ARGS("object=%s, class=%s", object->path, object->class->name);
+
+	if (object->interfaces == NULL) {
+		const struct ni_objectmodel_class_interfaces *entry;
+
+		entry = __ni_objectmodel_class_interfaces_get(object->class);
+		if (entry->registry_count == ni_objectmodel_service_registry.count) {
+			if (entry->interfaces) {
+				object->interfaces = entry->interfaces;
+				object->interfaces_shared = TRUE;
+			}
+			return TRUE;
+		}
+		/* services were registered after the table was built;
+		 * fall back to binding them one by one */
+	}
+
 	for (i = 0; i < ni_objectmodel_service_registry.count; ++i) {
 		const ni_dbus_service_t *service = ni_objectmodel_service_registry.services[i];
 
@@ -190,7 +277,15 @@ ni_objectmodel_compatible_services_for_class(const ni_dbus_class_t *query_class,
 
 /*
  * objectmodel service registry
+ *
+ * Name lookups happen once per interface dict entry when we take apart
+ * a GetManagedObjects reply, so we keep a sorted index of the registry
+ * and use a binary search rather than scanning all services each time.
+ * The index is (re)built lazily on the first lookup after a service
+ * has been registered.
  */
+static ni_dbus_service_array_t	ni_objectmodel_service_name_index;
+
 void
 ni_objectmodel_register_service(const ni_dbus_service_t *service)
 {
@@ -200,18 +295,46 @@ ni_objectmodel_register_service(const ni_dbus_service_t *service)
 
 	ni_objectmodel_service_registry.services[index++] = service;
 	ni_objectmodel_service_registry.count = index;
+
+	ni_objectmodel_service_name_index.count = 0;
+}
+
+static int
+__ni_objectmodel_service_name_cmp(const void *pa, const void *pb)
+{
+	const ni_dbus_service_t *a = *(const ni_dbus_service_t **) pa;
+	const ni_dbus_service_t *b = *(const ni_dbus_service_t **) pb;
+
+	return strcmp(a->name, b->name);
 }
 
 const ni_dbus_service_t *
 ni_objectmodel_service_by_name(const char *name)
 {
-	unsigned int i;
+	ni_dbus_service_array_t *index = &ni_objectmodel_service_name_index;
+	unsigned int lo, hi;
+
+	if (index->count != ni_objectmodel_service_registry.count) {
+		memcpy(index->services, ni_objectmodel_service_registry.services,
+			ni_objectmodel_service_registry.count * sizeof(index->services[0]));
+		index->count = ni_objectmodel_service_registry.count;
+		qsort(index->services, index->count, sizeof(index->services[0]),
+			__ni_objectmodel_service_name_cmp);
+	}
 
-	for (i = 0; i < ni_objectmodel_service_registry.count; ++i) {
-		const ni_dbus_service_t *service = ni_objectmodel_service_registry.services[i];
+	lo = 0;
+	hi = index->count;
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+		const ni_dbus_service_t *service = index->services[mid];
+		int cmp = strcmp(name, service->name);
 
-		if (!strcmp(service->name, name))
+		if (cmp == 0)
 			return service;
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
 	}
 
 	return NULL;
@@ -415,6 +538,63 @@ static ni_dbus_service_t	ni_objectmodel_netif_root_interface = {
 	.signals	= ni_objectmodel_netif_root_signals,
 };
 
+/*
+ * Event loop latency statistics, collected in src/evstats.c around the
+ * socket and timer callback dispatch. Returns one dict per callback
+ * type with count/total/max and a log2 microsecond histogram of only
+ * the populated buckets, plus the worst stall seen since startup.
+ */
+static dbus_bool_t
+ni_objectmodel_stats_get_event_loop(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+			unsigned int argc, const ni_dbus_variant_t *argv,
+			ni_dbus_message_t *reply, DBusError *error)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	unsigned int type, i;
+	dbus_bool_t rv;
+
+	ni_dbus_variant_init_dict(&result);
+	ni_dbus_dict_add_uint64(&result, "max-stall-usec", ni_evstats_max_stall());
+
+	for (type = 0; type < __NI_EVSTAT_MAX; ++type) {
+		const ni_evstat_hist_t *hist = ni_evstats_get(type);
+		ni_dbus_variant_t *entry, *buckets;
+
+		entry = ni_dbus_dict_add(&result, ni_evstat_type_name(type));
+		ni_dbus_variant_init_dict(entry);
+		ni_dbus_dict_add_uint64(entry, "count", hist->count);
+		ni_dbus_dict_add_uint64(entry, "total-usec", hist->total_usec);
+		ni_dbus_dict_add_uint64(entry, "max-usec", hist->max_usec);
+
+		buckets = ni_dbus_dict_add(entry, "histogram");
+		ni_dbus_variant_init_dict(buckets);
+		for (i = 0; i < NI_EVSTAT_BUCKETS; ++i) {
+			char name[32];
+
+			if (hist->bucket[i] == 0)
+				continue;
+			snprintf(name, sizeof(name), "le-%llu-usec",
+					(unsigned long long)1 << i);
+			ni_dbus_dict_add_uint64(buckets, name, hist->bucket[i]);
+		}
+	}
+
+	rv = ni_dbus_message_serialize_variants(reply, 1, &result, error);
+	ni_dbus_variant_destroy(&result);
+	return rv;
+}
+
+static ni_dbus_method_t		ni_objectmodel_stats_methods[] = {
+	{ "getEventLoopStats",	"",		.handler = ni_objectmodel_stats_get_event_loop },
+
+	{ NULL }
+};
+
+static ni_dbus_service_t	ni_objectmodel_stats_interface = {
+	.name		= NI_OBJECTMODEL_STATS_INTERFACE,
+	.methods	= ni_objectmodel_stats_methods,
+};
+
 /*
  * Expand the environment of an extension
  * This should probably go with the objectmodel code.
@@ -456,22 +636,12 @@ ni_objectmodel_expand_environment(const ni_dbus_object_t *object, const ni_var_a
 static char *
 __ni_objectmodel_write_message(ni_dbus_message_t *msg, const ni_dbus_method_t *method, ni_tempstate_t *temp_state)
 {
-	ni_dbus_variant_t argv[16];
 	char *tempname = NULL;
 	xml_node_t *xmlnode;
-	int argc = 0;
 	FILE *fp;
 
-	/* Deserialize dbus message */
-	memset(argv, 0, sizeof(argv));
-	argc = ni_dbus_message_get_args_variants(msg, argv, 16);
-	if (argc < 0)
-		return NULL;
-
-	xmlnode = ni_dbus_xml_deserialize_arguments(method, argc, argv, NULL, temp_state);
-
-	while (argc--)
-		ni_dbus_variant_destroy(&argv[argc]);
+	/* Deserialize dbus message, transcoding it into XML directly */
+	xmlnode = ni_dbus_xml_deserialize_arguments_message(method, msg, NULL, temp_state);
 
 	if (xmlnode == NULL) {
 		ni_error("%s: unable to build XML from arguments", method->name);
@@ -614,31 +784,21 @@ ni_objectmodel_extension_completion(ni_dbus_connection_t *connection, const ni_d
 	}
 
 	if (ni_process_exit_status_okay(process)) {
-		ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
 		xml_node_t *retnode = NULL;
-		int nres;
-
-		/* if the method returns anything, read it from the response file
-		 * and encode it. */
-		if (doc == NULL
-		 || (retnode = xml_node_get_child(xml_document_root(doc), "return")) == NULL) {
-			nres = 0;
-		} else if ((nres = ni_dbus_serialize_return(method, &result, retnode)) < 0) {
+
+		/* Build the response message. If the method returns anything,
+		 * read it from the response file and transcode it into the
+		 * reply directly. */
+		reply = dbus_message_new_method_return(call);
+		if (doc != NULL
+		 && (retnode = xml_node_get_child(xml_document_root(doc), "return")) != NULL
+		 && ni_dbus_serialize_return_message(method, reply, retnode) < 0) {
 			dbus_set_error(&error, NI_DBUS_ERROR_CANNOT_MARSHAL,
 					"%s.%s: unable to serialize returned data",
 					interface_name, method->name);
-			ni_dbus_variant_destroy(&result);
-			goto send_error;
-		}
-
-		/* Build the response message */
-		reply = dbus_message_new_method_return(call);
-		if (!ni_dbus_message_serialize_variants(reply, nres, &result, &error)) {
-			ni_dbus_variant_destroy(&result);
 			dbus_message_unref(reply);
 			goto send_error;
 		}
-		ni_dbus_variant_destroy(&result);
 	} else {
 		xml_node_t *errnode = NULL;
 
@@ -365,7 +365,7 @@ ni_objectmodel_get_netdev(const ni_dbus_object_t *object, ni_bool_t write_access
  * sit (point-to-point) tunnel service
  */
 static const ni_dbus_property_t	ni_objectmodel_sit_property_table[] = {
-	NI_DBUS_GENERIC_STRING_PROPERTY(netdev, device, link.lowerdev.name, RO),
+	NI_DBUS_GENERIC_REFSTR_PROPERTY(netdev, device, link.lowerdev.name, RO),
 	SIT_HWADDR_PROPERTY(local-address,	local_addr, RO),
 	SIT_HWADDR_PROPERTY(remote-address,	remote_addr, RO),
 	SIT_TUNNEL_UINT16_PROPERTY(ttl, ttl, RO),
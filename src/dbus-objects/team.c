@@ -257,8 +257,12 @@ __ni_objectmodel_team_handle(const ni_dbus_object_t *object, ni_bool_t write_acc
 	if (!(dev = ni_objectmodel_unwrap_netif(object, error)))
 		return NULL;
 
-	if (!write_access)
+	if (!write_access) {
+		/* catch up on deferred discovery of system devices */
+		if (dev->team_stale)
+			return ni_netdev_get_team(dev);
 		return dev->team;
+	}
 
 	if (!(team = ni_netdev_get_team(dev))) {
 		dbus_set_error(error, DBUS_ERROR_FAILED, "Error getting team handle for interface");
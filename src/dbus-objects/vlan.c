@@ -195,7 +195,7 @@ ni_objectmodel_vlan_change(ni_dbus_object_t *object, const ni_dbus_method_t *met
 		return FALSE;
 	}
 	cfg->link.lowerdev.index = dev->link.lowerdev.index;
-	ni_string_dup(&cfg->link.lowerdev.name, dev->link.lowerdev.name);
+	ni_refstr_dup(&cfg->link.lowerdev.name, dev->link.lowerdev.name);
 
 	cfg->link.ifindex = dev->link.ifindex;
 	if (ni_string_empty(cfg->name))
@@ -381,7 +381,7 @@ __ni_objectmodel_vlan_set_tag(ni_dbus_object_t *object, const ni_dbus_property_t
 				dbus_name, __ni_objectmodel_vlan, rw)
 
 const ni_dbus_property_t	ni_objectmodel_vlan_property_table[] = {
-	NI_DBUS_GENERIC_STRING_PROPERTY(netdev,  device, link.lowerdev.name, RO),
+	NI_DBUS_GENERIC_REFSTR_PROPERTY(netdev,  device, link.lowerdev.name, RO),
 	VLAN_HWADDR_PROPERTY(address, RO),
 	VLAN_UINT16_PROPERTY(protocol, RO),
 	VLAN_UINT16_PROPERTY(tag, RO),
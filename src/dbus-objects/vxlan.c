@@ -441,7 +441,7 @@ ni_objectmodel_vxlan_set_src_port(ni_dbus_object_t *object,
 #define VXLAN_BOOL_PROPERTY(type, dbus_name, member_name, rw) \
 	NI_DBUS_GENERIC_BOOL_PROPERTY(type, dbus_name, member_name, rw)
 #define VXLAN_DEVICE_PROPERTY(type, dbus_name, member_name, rw) \
-	NI_DBUS_GENERIC_STRING_PROPERTY(type, dbus_name, member_name, rw)
+	NI_DBUS_GENERIC_REFSTR_PROPERTY(type, dbus_name, member_name, rw)
 
 
 /* VXLAN property table */
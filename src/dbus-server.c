@@ -9,6 +9,8 @@
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/xml.h>
 #include <wicked/dbus-service.h>
 #include <wicked/dbus-errors.h>
 #include "dbus-server.h"
@@ -16,6 +18,8 @@
 #include "dbus-dict.h"
 #include "debug.h"
 #include "util_priv.h"
+#include "stats.h"
+#include "flight.h"
 
 
 struct ni_dbus_server_object {
@@ -332,6 +336,7 @@ __ni_dbus_object_properties_arg_property(ni_dbus_object_t *object, const ni_dbus
 	} else {
 		unsigned int i;
 
+		ni_dbus_object_bind_interfaces(object);
 		for (i = 0; (service = object->interfaces[i]) != NULL; ++i) {
 			property = ni_dbus_service_get_property(service, property_name);
 			if (property)
@@ -372,6 +377,7 @@ __ni_dbus_object_properties_getall(ni_dbus_object_t *object, const ni_dbus_metho
 	} else {
 		unsigned int i;
 
+		ni_dbus_object_bind_interfaces(object);
 		for (i = 0; rv && (service = object->interfaces[i]) != NULL; ++i)
 			rv = ni_dbus_object_get_properties_as_dict(object, service, &dict, error);
 	}
@@ -483,7 +489,7 @@ __ni_dbus_object_introspectable_introspect(ni_dbus_object_t *object, const ni_db
 		unsigned int argc, const ni_dbus_variant_t *argv,
 		ni_dbus_message_t *reply, DBusError *error)
 {
-	char *data;
+	const char *data;
 
 	if (!(data = ni_dbus_object_introspect(object))) {
 		dbus_set_error(error, DBUS_ERROR_FAILED, "Failed to introspect object %s", object->path);
@@ -491,7 +497,6 @@ __ni_dbus_object_introspectable_introspect(ni_dbus_object_t *object, const ni_db
 	}
 
 	ni_dbus_message_append_string(reply, data);
-	free(data);
 	return TRUE;
 }
 
@@ -511,6 +516,7 @@ __ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_vari
 	ni_dbus_object_t *child;
 	int rv = TRUE;
 
+	ni_dbus_object_bind_interfaces(object);
 	if (object->interfaces) {
 		ni_dbus_variant_t *ifdict = ni_dbus_dict_add(obj_dict, object->path);
 		const ni_dbus_service_t *service;
@@ -565,6 +571,99 @@ __ni_dbus_object_unregister(DBusConnection *conn, void *user_data)
 	}
 }
 
+static DBusHandlerResult __ni_dbus_object_message(DBusConnection *, DBusMessage *, void *);
+
+/*
+ * Two-queue scheduling of incoming method calls.
+ *
+ * Method calls normally execute in arrival order, straight from the
+ * libdbus dispatcher. Methods annotated with <meta:dispatch
+ * class="batch"/> in the schema are instead parked on a side queue
+ * and re-dispatched one call per mainloop iteration: calls without
+ * the annotation - short, operator initiated requests - run ahead of
+ * a backlog of bulk automation work, and newly arriving messages are
+ * picked up between any two deferred calls.
+ */
+typedef struct ni_dbus_deferred_call {
+	struct ni_dbus_deferred_call *next;
+	ni_dbus_server_t *	server;
+	DBusConnection *	conn;
+	DBusMessage *		call;
+} ni_dbus_deferred_call_t;
+
+static ni_dbus_deferred_call_t *	__ni_dbus_deferred_calls;
+static ni_dbus_deferred_call_t **	__ni_dbus_deferred_tail = &__ni_dbus_deferred_calls;
+static const ni_timer_t *		__ni_dbus_deferred_timer;
+static ni_bool_t			__ni_dbus_deferred_running;
+
+static ni_bool_t
+__ni_dbus_method_is_batch(const ni_dbus_method_t *method)
+{
+	xml_node_t *meta;
+
+	if (ni_dbus_xml_get_method_metadata(method, "dispatch", &meta, 1) < 1)
+		return FALSE;
+
+	return ni_string_eq(xml_node_get_attr(meta, "class"), "batch");
+}
+
+static void
+__ni_dbus_deferred_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_dbus_deferred_call_t *dc;
+	void *object = NULL;
+
+	__ni_dbus_deferred_timer = NULL;
+	if (!(dc = __ni_dbus_deferred_calls))
+		return;
+	if ((__ni_dbus_deferred_calls = dc->next) == NULL)
+		__ni_dbus_deferred_tail = &__ni_dbus_deferred_calls;
+
+	if (dbus_connection_get_object_path_data(dc->conn,
+			dbus_message_get_path(dc->call), &object) && object) {
+		__ni_dbus_deferred_running = TRUE;
+		__ni_dbus_object_message(dc->conn, dc->call, object);
+		__ni_dbus_deferred_running = FALSE;
+	} else {
+		DBusMessage *reply;
+
+		reply = dbus_message_new_error(dc->call, DBUS_ERROR_FAILED,
+				"object vanished before deferred method dispatch");
+		if (reply) {
+			ni_dbus_connection_send_message(dc->server->connection, reply);
+			dbus_message_unref(reply);
+		}
+	}
+
+	dbus_message_unref(dc->call);
+	dbus_connection_unref(dc->conn);
+	free(dc);
+
+	if (__ni_dbus_deferred_calls && __ni_dbus_deferred_timer == NULL)
+		__ni_dbus_deferred_timer = ni_timer_register(0,
+				__ni_dbus_deferred_timeout, NULL);
+}
+
+static void
+__ni_dbus_server_defer_call(ni_dbus_server_t *server, DBusConnection *conn, DBusMessage *call)
+{
+	ni_dbus_deferred_call_t *dc;
+
+	dc = xcalloc(1, sizeof(*dc));
+	dc->server = server;
+	dc->conn = conn;
+	dc->call = call;
+	dbus_connection_ref(conn);
+	dbus_message_ref(call);
+
+	*__ni_dbus_deferred_tail = dc;
+	__ni_dbus_deferred_tail = &dc->next;
+
+	if (__ni_dbus_deferred_timer == NULL)
+		__ni_dbus_deferred_timer = ni_timer_register(0,
+				__ni_dbus_deferred_timeout, NULL);
+}
+
 static DBusHandlerResult
 __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_data)
 {
@@ -596,6 +695,8 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 	}
 
 	server = ni_dbus_object_get_server(object);
+	ni_stats_inc(NI_STAT_DBUS_CALLS);
+	ni_flight_record(NI_FLIGHT_DBUS_CALL, 0, 0, method_name);
 
 	method = ni_dbus_service_get_method(svc, method_name);
 	if (method == NULL
@@ -606,6 +707,13 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 				object->path,
 				svc->name,
 				method_name);
+	} else
+	if (!__ni_dbus_deferred_running && __ni_dbus_method_is_batch(method)) {
+		/* park bulk work; interactive calls keep flowing */
+		ni_debug_dbus("%s.%s: deferring batch class method call",
+				svc->name, method_name);
+		__ni_dbus_server_defer_call(server, conn, call);
+		return DBUS_HANDLER_RESULT_HANDLED;
 	} else {
 		ni_dbus_variant_t argv[16];
 		uid_t caller_uid = -1;
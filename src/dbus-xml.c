@@ -28,6 +28,7 @@ static int		ni_dbus_xml_register_classes(ni_xs_scope_t *);
 static ni_dbus_method_t *ni_dbus_xml_register_methods(ni_xs_service_t *, ni_xs_method_t *, const ni_dbus_method_t *);
 
 static dbus_bool_t	ni_dbus_validate_xml(xml_node_t *, const ni_xs_type_t *, const ni_dbus_xml_validate_context_t *);
+static dbus_bool_t	ni_dbus_do_validate_xml(xml_node_t *, const ni_xs_type_t *, const ni_dbus_xml_validate_context_t *);
 static dbus_bool_t	ni_dbus_validate_xml_void(xml_node_t *, const ni_xs_type_t *, const ni_dbus_xml_validate_context_t *);
 static dbus_bool_t	ni_dbus_validate_xml_scalar(xml_node_t *, const ni_xs_type_t *, const ni_dbus_xml_validate_context_t *);
 static dbus_bool_t	ni_dbus_validate_xml_struct(xml_node_t *, const ni_xs_type_t *, const ni_dbus_xml_validate_context_t *);
@@ -48,6 +49,16 @@ static dbus_bool_t	ni_dbus_deserialize_xml_struct(const ni_dbus_variant_t *, con
 static dbus_bool_t	ni_dbus_deserialize_xml_union(const ni_dbus_variant_t *, const ni_xs_type_t *, xml_node_t *);
 static dbus_bool_t	ni_dbus_deserialize_xml_array(const ni_dbus_variant_t *, const ni_xs_type_t *, xml_node_t *);
 static dbus_bool_t	ni_dbus_deserialize_xml_dict(const ni_dbus_variant_t *, const ni_xs_type_t *, xml_node_t *);
+static dbus_bool_t	ni_dbus_serialize_xml_iter(xml_node_t *, const ni_xs_type_t *, DBusMessageIter *);
+static dbus_bool_t	ni_dbus_serialize_xml_scalar_iter(xml_node_t *, const ni_xs_type_t *, DBusMessageIter *);
+static dbus_bool_t	ni_dbus_serialize_xml_union_iter(xml_node_t *, const ni_xs_type_t *, DBusMessageIter *);
+static dbus_bool_t	ni_dbus_serialize_xml_array_iter(xml_node_t *, const ni_xs_type_t *, DBusMessageIter *);
+static dbus_bool_t	ni_dbus_serialize_xml_dict_iter(xml_node_t *, const ni_xs_type_t *, DBusMessageIter *);
+static dbus_bool_t	ni_dbus_deserialize_iter(DBusMessageIter *, const ni_xs_type_t *, xml_node_t *);
+static dbus_bool_t	ni_dbus_deserialize_iter_scalar(DBusMessageIter *, const ni_xs_type_t *, xml_node_t *);
+static dbus_bool_t	ni_dbus_deserialize_iter_union(DBusMessageIter *, const ni_xs_type_t *, xml_node_t *);
+static dbus_bool_t	ni_dbus_deserialize_iter_array(DBusMessageIter *, const ni_xs_type_t *, xml_node_t *);
+static dbus_bool_t	ni_dbus_deserialize_iter_dict(DBusMessageIter *, const ni_xs_type_t *, xml_node_t *);
 static char *		__ni_xs_type_to_dbus_signature(const ni_xs_type_t *, char *, size_t);
 static char *		ni_xs_type_to_dbus_signature(const ni_xs_type_t *);
 static ni_xs_service_t *ni_dbus_xml_get_service_schema(const ni_xs_scope_t *, const char *);
@@ -418,11 +429,161 @@ ni_dbus_serialize_error(DBusError *error, xml_node_t *node)
 			node->cdata? node->cdata : "extension call failed (no error message returned by script)");
 }
 
+/*
+ * Memoization of validation verdicts.
+ *
+ * Client configs tend to repeat identical subtrees many times (e.g. the
+ * same <address> or vlan shape on thousands of interfaces), and each of
+ * them is re-validated on every deserialization. For types whose schema
+ * subtree carries no <meta> information, validation has no side effects
+ * and its verdict depends on the subtree content only, so we remember
+ * successful verdicts keyed by (type, content digest) in a small bounded
+ * cache and answer repeats with a hash lookup. Failed verdicts are not
+ * cached, so their diagnostics are emitted on every occurrence.
+ */
+#define NI_DBUS_VALIDATE_CACHE_BUCKETS	64
+#define NI_DBUS_VALIDATE_CACHE_DEPTH	16
+#define NI_DBUS_VALIDATE_DIGEST_SIZE	16	/* md5 */
+
+typedef struct ni_dbus_validate_cache_entry ni_dbus_validate_cache_entry_t;
+struct ni_dbus_validate_cache_entry {
+	ni_dbus_validate_cache_entry_t *next;
+
+	const ni_xs_type_t *	type;
+	unsigned char		digest[NI_DBUS_VALIDATE_DIGEST_SIZE];
+};
+
+static ni_dbus_validate_cache_entry_t *	ni_dbus_validate_cache[NI_DBUS_VALIDATE_CACHE_BUCKETS];
+
+/*
+ * Check (and remember in type->meta_scan) whether the type subtree is
+ * free of <meta> nodes, i.e. validating against it never invokes the
+ * metadata or prompt callbacks. Recursive type definitions are treated
+ * as not memoizable.
+ */
+static ni_bool_t
+ni_dbus_validate_xml_memoizable(const ni_xs_type_t *type)
+{
+	ni_xs_type_t *mutable = (ni_xs_type_t *) type;
+	const ni_xs_name_type_array_t *children = NULL;
+	ni_bool_t pure = TRUE;
+	unsigned int i;
+
+	if (type->meta_scan)
+		return type->meta_scan == 1;
+
+	if (type->meta) {
+		mutable->meta_scan = -1;
+		return FALSE;
+	}
+
+	mutable->meta_scan = 2; /* scan in progress */
+	switch (type->class) {
+	case NI_XS_TYPE_ARRAY:
+		pure = ni_dbus_validate_xml_memoizable(ni_xs_array_info(type)->element_type);
+		break;
+
+	case NI_XS_TYPE_DICT:
+		children = &ni_xs_dict_info(type)->children;
+		break;
+
+	case NI_XS_TYPE_STRUCT:
+		children = &ni_xs_struct_info(type)->children;
+		break;
+
+	case NI_XS_TYPE_UNION:
+		children = &ni_xs_union_info(type)->children;
+		break;
+
+	default:
+		break;
+	}
+	for (i = 0; pure && children && i < children->count; ++i) {
+		const ni_xs_type_t *child = children->data[i].type;
+
+		/* hitting a type we're still scanning means recursion */
+		if (child->meta_scan == 2 || !ni_dbus_validate_xml_memoizable(child))
+			pure = FALSE;
+	}
+
+	mutable->meta_scan = pure ? 1 : -1;
+	return pure;
+}
+
+static ni_bool_t
+ni_dbus_validate_cache_get(const ni_xs_type_t *type, const unsigned char *digest)
+{
+	ni_dbus_validate_cache_entry_t **pprev, *entry;
+
+	pprev = &ni_dbus_validate_cache[digest[0] % NI_DBUS_VALIDATE_CACHE_BUCKETS];
+	while ((entry = *pprev) != NULL) {
+		if (entry->type == type &&
+		    memcmp(entry->digest, digest, NI_DBUS_VALIDATE_DIGEST_SIZE) == 0) {
+			/* move to front, so hot entries survive eviction */
+			*pprev = entry->next;
+			entry->next = ni_dbus_validate_cache[digest[0] % NI_DBUS_VALIDATE_CACHE_BUCKETS];
+			ni_dbus_validate_cache[digest[0] % NI_DBUS_VALIDATE_CACHE_BUCKETS] = entry;
+			return TRUE;
+		}
+		pprev = &entry->next;
+	}
+	return FALSE;
+}
+
+static void
+ni_dbus_validate_cache_put(const ni_xs_type_t *type, const unsigned char *digest)
+{
+	ni_dbus_validate_cache_entry_t **pprev, *entry;
+	unsigned int depth;
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->type = type;
+	memcpy(entry->digest, digest, NI_DBUS_VALIDATE_DIGEST_SIZE);
+
+	pprev = &ni_dbus_validate_cache[digest[0] % NI_DBUS_VALIDATE_CACHE_BUCKETS];
+	entry->next = *pprev;
+	*pprev = entry;
+
+	/* keep the chain bounded; drop the least recently used tail */
+	for (depth = 0; (entry = *pprev) != NULL; pprev = &entry->next) {
+		if (++depth > NI_DBUS_VALIDATE_CACHE_DEPTH) {
+			*pprev = entry->next;
+			free(entry);
+			break;
+		}
+	}
+}
+
 /*
  * Validate an XML tree
  */
 dbus_bool_t
 ni_dbus_validate_xml(xml_node_t *node, const ni_xs_type_t *type, const ni_dbus_xml_validate_context_t *ctx)
+{
+	unsigned char digest[NI_DBUS_VALIDATE_DIGEST_SIZE];
+	ni_bool_t memoize = FALSE;
+	dbus_bool_t verdict;
+
+	/* memoize container types only; hashing plain scalars would
+	 * cost more than just validating them */
+	if (type->class != NI_XS_TYPE_SCALAR && type->class != NI_XS_TYPE_VOID &&
+	    ni_dbus_validate_xml_memoizable(type) &&
+	    xml_node_hash(node, NI_HASHCTX_MD5, digest, sizeof(digest)) == 0) {
+		if (ni_dbus_validate_cache_get(type, digest))
+			return TRUE;
+		memoize = TRUE;
+	}
+
+	if (!(verdict = ni_dbus_do_validate_xml(node, type, ctx)))
+		return FALSE;
+
+	if (memoize)
+		ni_dbus_validate_cache_put(type, digest);
+	return verdict;
+}
+
+static dbus_bool_t
+ni_dbus_do_validate_xml(xml_node_t *node, const ni_xs_type_t *type, const ni_dbus_xml_validate_context_t *ctx)
 {
 	if (ctx && ctx->metadata_callback && type->meta) {
 		if (!ctx->metadata_callback(node, type, type->meta, ctx->user_data))
@@ -1335,7 +1496,475 @@ ni_dbus_deserialize_xml_union(const ni_dbus_variant_t *var, const ni_xs_type_t *
 }
 
 /*
- * Get the dbus signature of a dbus-xml type
+ * Direct transcoding between XML and a dbus message.
+ *
+ * This walks the XML tree and the schema type in lockstep while
+ * appending straight into (or reading straight from) the message
+ * iterator, so that no intermediate dbus variant tree needs to be
+ * materialized and destroyed per call. Scalars still pass through
+ * a single stack-allocated variant so that the value conversion
+ * (bitmaps, enums, notations, ...) is shared with the variant based
+ * code paths above.
+ */
+static char *
+ni_dbus_xml_node_signature(xml_node_t *node, const ni_xs_type_t *type, char *sigbuf, size_t buflen)
+{
+	ni_xs_scalar_info_t *scalar_info;
+	const ni_xs_type_t *child_type;
+	size_t len;
+
+	switch (type->class) {
+	case NI_XS_TYPE_SCALAR:
+		scalar_info = ni_xs_scalar_info(type);
+
+		/* flag elements are encoded as a BYTE value */
+		if (scalar_info->type == DBUS_TYPE_INVALID) {
+			ni_assert(buflen >= 2);
+			sigbuf[0] = DBUS_TYPE_BYTE;
+			sigbuf[1] = '\0';
+			return sigbuf;
+		}
+		return __ni_xs_type_to_dbus_signature(type, sigbuf, buflen);
+
+	case NI_XS_TYPE_UNION:
+		/* the signature depends on the discriminant of this node */
+		if (!(child_type = __ni_dbus_xml_union_type(node, type, NULL)))
+			return NULL;
+
+		ni_assert(buflen >= 4);
+		sigbuf[0] = DBUS_STRUCT_BEGIN_CHAR;
+		sigbuf[1] = DBUS_TYPE_STRING;
+		sigbuf[2] = '\0';
+		if (child_type->class != NI_XS_TYPE_VOID
+		 && !ni_dbus_xml_node_signature(node, child_type, sigbuf + 2, buflen - 3))
+			return NULL;
+
+		len = strlen(sigbuf);
+		sigbuf[len++] = DBUS_STRUCT_END_CHAR;
+		sigbuf[len] = '\0';
+		return sigbuf;
+
+	default:
+		return __ni_xs_type_to_dbus_signature(type, sigbuf, buflen);
+	}
+}
+
+static dbus_bool_t
+ni_dbus_serialize_xml_scalar_iter(xml_node_t *node, const ni_xs_type_t *type, DBusMessageIter *iter)
+{
+	ni_dbus_variant_t var = NI_DBUS_VARIANT_INIT;
+	dbus_bool_t rv;
+
+	rv = ni_dbus_serialize_xml_scalar(node, type, &var)
+	  && ni_dbus_message_iter_append_value(iter, &var, NULL);
+	ni_dbus_variant_destroy(&var);
+	return rv;
+}
+
+static dbus_bool_t
+ni_dbus_serialize_xml_union_iter(xml_node_t *node, const ni_xs_type_t *type, DBusMessageIter *iter)
+{
+	const ni_xs_type_t *child_type;
+	DBusMessageIter iter_struct;
+	const char *kind;
+
+	if (!(child_type = __ni_dbus_xml_union_type(node, type, &kind)))
+		return FALSE;
+
+	if (!dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &iter_struct))
+		return FALSE;
+
+	if (!dbus_message_iter_append_basic(&iter_struct, DBUS_TYPE_STRING, &kind))
+		return FALSE;
+
+	if (child_type->class != NI_XS_TYPE_VOID
+	 && !ni_dbus_serialize_xml_iter(node, child_type, &iter_struct))
+		return FALSE;
+
+	return dbus_message_iter_close_container(iter, &iter_struct);
+}
+
+static dbus_bool_t
+ni_dbus_serialize_xml_array_iter(xml_node_t *node, const ni_xs_type_t *type, DBusMessageIter *iter)
+{
+	ni_xs_array_info_t *array_info = ni_xs_array_info(type);
+	ni_xs_type_t *element_type = array_info->element_type;
+	DBusMessageIter iter_array;
+	const char *element_sig;
+	char sigbuf[32];
+	xml_node_t *child;
+
+	if (array_info->notation) {
+		unsigned char *data = NULL;
+		unsigned int len = 0;
+		dbus_bool_t rv;
+
+		if (!ni_dbus_serialize_byte_array_notation(node, array_info, &data, &len))
+			return FALSE;
+		rv = ni_dbus_message_iter_append_byte_array(iter, data, len);
+		free(data);
+		return rv;
+	}
+
+	if (!(element_sig = __ni_xs_type_to_dbus_signature(element_type, sigbuf, sizeof(sigbuf)))) {
+		ni_error("%s: cannot build signature of array element type",
+				xml_node_location(node));
+		return FALSE;
+	}
+
+	if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, element_sig, &iter_array))
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (element_type->class == NI_XS_TYPE_SCALAR) {
+			ni_dbus_variant_t var = NI_DBUS_VARIANT_INIT;
+			dbus_bool_t rv;
+
+			if (child->cdata == NULL) {
+				ni_error("%s: NULL array element",
+						xml_node_location(child));
+				return FALSE;
+			}
+
+			/* TBD: handle constants defined in the schema? */
+			if (!ni_dbus_variant_parse(&var, child->cdata, element_sig)) {
+				ni_error("%s: syntax error in array element", __func__);
+				ni_dbus_variant_destroy(&var);
+				return FALSE;
+			}
+
+			rv = ni_dbus_message_iter_append_value(&iter_array, &var, NULL);
+			ni_dbus_variant_destroy(&var);
+			if (!rv)
+				return FALSE;
+		} else if (element_type->class == NI_XS_TYPE_DICT) {
+			if (!ni_dbus_serialize_xml_dict_iter(child, element_type, &iter_array)) {
+				ni_error("%s: failed to serialize array element",
+						xml_node_location(child));
+				return FALSE;
+			}
+		} else {
+			ni_error("%s: arrays of type %s not implemented yet",
+					xml_node_location(child),
+					ni_xs_type_to_dbus_signature(element_type));
+			return FALSE;
+		}
+	}
+
+	return dbus_message_iter_close_container(iter, &iter_array);
+}
+
+static dbus_bool_t
+ni_dbus_serialize_xml_dict_iter(xml_node_t *node, const ni_xs_type_t *type, DBusMessageIter *iter)
+{
+	ni_xs_dict_info_t *dict_info = ni_xs_dict_info(type);
+	DBusMessageIter iter_array;
+	xml_node_t *child;
+
+	if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
+				NI_DBUS_DICT_ENTRY_SIGNATURE, &iter_array))
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		const ni_xs_type_t *child_type = ni_xs_dict_info_find(dict_info, child->name);
+		DBusMessageIter iter_entry, iter_variant;
+		const char *child_sig;
+		char sigbuf[32];
+
+		if (child_type == NULL) {
+			ni_warn("%s: ignoring unknown dict element \"%s\"", __func__, child->name);
+			continue;
+		}
+
+		if (!(child_sig = ni_dbus_xml_node_signature(child, child_type, sigbuf, sizeof(sigbuf)))) {
+			ni_error("%s: cannot build signature of dict element \"%s\"",
+					__func__, child->name);
+			return FALSE;
+		}
+
+		if (!dbus_message_iter_open_container(&iter_array, DBUS_TYPE_DICT_ENTRY, NULL, &iter_entry)
+		 || !dbus_message_iter_append_basic(&iter_entry, DBUS_TYPE_STRING, &child->name)
+		 || !dbus_message_iter_open_container(&iter_entry, DBUS_TYPE_VARIANT, child_sig, &iter_variant))
+			return FALSE;
+
+		if (!ni_dbus_serialize_xml_iter(child, child_type, &iter_variant))
+			return FALSE;
+
+		if (!dbus_message_iter_close_container(&iter_entry, &iter_variant)
+		 || !dbus_message_iter_close_container(&iter_array, &iter_entry))
+			return FALSE;
+	}
+
+	return dbus_message_iter_close_container(iter, &iter_array);
+}
+
+static dbus_bool_t
+ni_dbus_serialize_xml_iter(xml_node_t *node, const ni_xs_type_t *type, DBusMessageIter *iter)
+{
+	switch (type->class) {
+		case NI_XS_TYPE_VOID:
+			return TRUE;
+
+		case NI_XS_TYPE_SCALAR:
+			return ni_dbus_serialize_xml_scalar_iter(node, type, iter);
+
+		case NI_XS_TYPE_UNION:
+			return ni_dbus_serialize_xml_union_iter(node, type, iter);
+
+		case NI_XS_TYPE_ARRAY:
+			return ni_dbus_serialize_xml_array_iter(node, type, iter);
+
+		case NI_XS_TYPE_DICT:
+			return ni_dbus_serialize_xml_dict_iter(node, type, iter);
+
+		default:
+			ni_error("unsupported xml type class %u", type->class);
+			return FALSE;
+	}
+}
+
+static dbus_bool_t
+ni_dbus_deserialize_iter_scalar(DBusMessageIter *iter, const ni_xs_type_t *type, xml_node_t *node)
+{
+	ni_dbus_variant_t var = NI_DBUS_VARIANT_INIT;
+	dbus_bool_t rv;
+
+	rv = ni_dbus_message_iter_get_variant_data(iter, &var)
+	  && ni_dbus_deserialize_xml_scalar(&var, type, node);
+	ni_dbus_variant_destroy(&var);
+	return rv;
+}
+
+static dbus_bool_t
+ni_dbus_deserialize_iter_union(DBusMessageIter *iter, const ni_xs_type_t *type, xml_node_t *node)
+{
+	ni_xs_union_info_t *union_info = ni_xs_union_info(type);
+	const ni_xs_type_t *child_type;
+	DBusMessageIter iter_struct;
+	const char *kind;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_STRUCT) {
+		ni_error("unable to deserialize %s: expected a struct", node->name);
+		return FALSE;
+	}
+	dbus_message_iter_recurse(iter, &iter_struct);
+
+	/* Set the discriminant="kind" attribute first */
+	if (dbus_message_iter_get_arg_type(&iter_struct) != DBUS_TYPE_STRING)
+		return FALSE;
+	dbus_message_iter_get_basic(&iter_struct, &kind);
+	xml_node_add_attr(node, union_info->discriminant, kind);
+
+	/* Now we can look up the child type based on the discriminant */
+	if (!(child_type = __ni_dbus_xml_union_type(node, type, NULL)))
+		return FALSE;
+
+	if (child_type->class == NI_XS_TYPE_VOID)
+		return TRUE;
+
+	dbus_message_iter_next(&iter_struct);
+	return ni_dbus_deserialize_iter(&iter_struct, child_type, node);
+}
+
+static dbus_bool_t
+ni_dbus_deserialize_iter_array(DBusMessageIter *iter, const ni_xs_type_t *type, xml_node_t *node)
+{
+	ni_xs_array_info_t *array_info = ni_xs_array_info(type);
+	ni_xs_type_t *element_type = array_info->element_type;
+	DBusMessageIter iter_array;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY) {
+		ni_error("unable to deserialize %s: expected an array", node->name);
+		return FALSE;
+	}
+
+	if (array_info->notation) {
+		ni_dbus_variant_t var = NI_DBUS_VARIANT_INIT;
+		dbus_bool_t rv;
+
+		/* Notations print from a byte array; fetch it and reuse
+		 * the variant based representation code. */
+		rv = ni_dbus_message_iter_get_variant_data(iter, &var)
+		  && ni_dbus_deserialize_xml_array(&var, type, node);
+		ni_dbus_variant_destroy(&var);
+		return rv;
+	}
+
+	dbus_message_iter_recurse(iter, &iter_array);
+	while (dbus_message_iter_get_arg_type(&iter_array) != DBUS_TYPE_INVALID) {
+		const char *name = "e";
+		xml_node_t *child;
+
+		if (array_info->element_name != NULL)
+			name = array_info->element_name;
+		else if (element_type->origdef.name != NULL)
+			name = element_type->origdef.name;
+
+		child = xml_node_new(name, node);
+
+		if (element_type->class == NI_XS_TYPE_SCALAR) {
+			ni_dbus_variant_t var = NI_DBUS_VARIANT_INIT;
+			const char *string = NULL;
+
+			if (!ni_dbus_message_iter_get_variant_data(&iter_array, &var)
+			 || !(string = ni_dbus_variant_sprint(&var))) {
+				ni_error("%s: cannot represent array element", __func__);
+				ni_dbus_variant_destroy(&var);
+				return FALSE;
+			}
+			xml_node_set_cdata(child, string);
+			ni_dbus_variant_destroy(&var);
+		} else if (element_type->class == NI_XS_TYPE_DICT) {
+			DBusMessageIter iter_value, *iter_elem = &iter_array;
+
+			/* An array of non-scalars may wrap each element in a variant */
+			if (dbus_message_iter_get_arg_type(&iter_array) == DBUS_TYPE_VARIANT) {
+				dbus_message_iter_recurse(&iter_array, &iter_value);
+				iter_elem = &iter_value;
+			}
+
+			if (!ni_dbus_deserialize_iter(iter_elem, element_type, child))
+				return FALSE;
+		} else {
+			ni_error("%s: arrays of type %s not implemented yet", __func__,
+					ni_xs_type_to_dbus_signature(element_type));
+			return FALSE;
+		}
+
+		dbus_message_iter_next(&iter_array);
+	}
+
+	return TRUE;
+}
+
+static dbus_bool_t
+ni_dbus_deserialize_iter_dict(DBusMessageIter *iter, const ni_xs_type_t *type, xml_node_t *node)
+{
+	ni_xs_dict_info_t *dict_info = ni_xs_dict_info(type);
+	DBusMessageIter iter_array;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY
+	 || dbus_message_iter_get_element_type(iter) != DBUS_TYPE_DICT_ENTRY) {
+		ni_error("unable to deserialize %s: expected a dict", node->name);
+		return FALSE;
+	}
+
+	dbus_message_iter_recurse(iter, &iter_array);
+	while (dbus_message_iter_get_arg_type(&iter_array) == DBUS_TYPE_DICT_ENTRY) {
+		DBusMessageIter iter_entry, iter_value;
+		const ni_xs_type_t *child_type;
+		const char *key;
+		xml_node_t *child;
+
+		dbus_message_iter_recurse(&iter_array, &iter_entry);
+		if (dbus_message_iter_get_arg_type(&iter_entry) != DBUS_TYPE_STRING)
+			return FALSE;
+		dbus_message_iter_get_basic(&iter_entry, &key);
+
+		dbus_message_iter_next(&iter_entry);
+		if (dbus_message_iter_get_arg_type(&iter_entry) != DBUS_TYPE_VARIANT)
+			return FALSE;
+		dbus_message_iter_recurse(&iter_entry, &iter_value);
+
+		/* Silently ignore dict entries we have no schema information for */
+		if (!(child_type = ni_xs_dict_info_find(dict_info, key))) {
+			ni_debug_dbus("%s: ignoring unknown dict entry %s in node <%s>",
+					__func__, key, node->name);
+		} else {
+			child = xml_node_new(key, node);
+			if (!ni_dbus_deserialize_iter(&iter_value, child_type, child))
+				return FALSE;
+		}
+
+		dbus_message_iter_next(&iter_array);
+	}
+
+	return TRUE;
+}
+
+static dbus_bool_t
+ni_dbus_deserialize_iter(DBusMessageIter *iter, const ni_xs_type_t *type, xml_node_t *node)
+{
+	switch (type->class) {
+	case NI_XS_TYPE_VOID:
+		return TRUE;
+
+	case NI_XS_TYPE_SCALAR:
+		return ni_dbus_deserialize_iter_scalar(iter, type, node);
+
+	case NI_XS_TYPE_UNION:
+		return ni_dbus_deserialize_iter_union(iter, type, node);
+
+	case NI_XS_TYPE_ARRAY:
+		return ni_dbus_deserialize_iter_array(iter, type, node);
+
+	case NI_XS_TYPE_DICT:
+		return ni_dbus_deserialize_iter_dict(iter, type, node);
+
+	default:
+		ni_error("unsupported xml type class %u", type->class);
+		return FALSE;
+	}
+}
+
+xml_node_t *
+ni_dbus_xml_deserialize_arguments_message(const ni_dbus_method_t *method, ni_dbus_message_t *msg,
+				xml_node_t *parent, ni_tempstate_t *temp_state)
+{
+	xml_node_t *node = xml_node_new("arguments", parent);
+	const ni_xs_method_t *xs_method = method->schema;
+	DBusMessageIter iter;
+	unsigned int i;
+
+	/* This is a lousy hack, but it sure beats passing down the temp_state to
+	 * all functions. */
+	__ni_dbus_xml_global_temp_state = temp_state;
+
+	dbus_message_iter_init(msg, &iter);
+	for (i = 0; i < xs_method->arguments.count; ++i) {
+		xml_node_t *arg;
+
+		if (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_INVALID)
+			break;
+
+		arg = xml_node_new(xs_method->arguments.data[i].name, node);
+		if (!ni_dbus_deserialize_iter(&iter, xs_method->arguments.data[i].type, arg)) {
+			xml_node_free(node);
+			node = NULL;
+			break;
+		}
+		dbus_message_iter_next(&iter);
+	}
+
+	__ni_dbus_xml_global_temp_state = NULL;
+	return node;
+}
+
+int
+ni_dbus_serialize_return_message(const ni_dbus_method_t *method, ni_dbus_message_t *msg, xml_node_t *node)
+{
+	const ni_xs_method_t *xs_method = method->schema;
+	ni_xs_type_t *xs_type;
+	DBusMessageIter iter;
+
+	ni_assert(xs_method);
+	if ((xs_type = xs_method->retval) == NULL)
+		return 0;
+
+	ni_debug_dbus("%s: serializing response (%s)", method->name, xs_type->name);
+	dbus_message_iter_init_append(msg, &iter);
+	if (!ni_dbus_serialize_xml_iter(node, xs_type, &iter))
+		return -NI_ERROR_CANNOT_MARSHAL;
+
+	return 1;
+}
+
+/*
+ * Get the dbus signature of a dbus-xml type.
+ * The signature of a schema type never changes, so it is computed
+ * once and memoized in the type; this keeps the per-value cost of
+ * the interpretive marshaller down when converting large dicts
+ * such as address and route lists.
  */
 static char *
 __ni_xs_type_to_dbus_signature(const ni_xs_type_t *type, char *sigbuf, size_t buflen)
@@ -1344,6 +1973,13 @@ __ni_xs_type_to_dbus_signature(const ni_xs_type_t *type, char *sigbuf, size_t bu
 	ni_xs_array_info_t *array_info;
 	unsigned int i = 0;
 
+	if (type->dbus_signature) {
+		if (strlen(type->dbus_signature) >= buflen)
+			return NULL;
+		strcpy(sigbuf, type->dbus_signature);
+		return sigbuf;
+	}
+
 	ni_assert(buflen >= 2);
 	switch (type->class) {
 	case NI_XS_TYPE_SCALAR:
@@ -1377,6 +2013,8 @@ __ni_xs_type_to_dbus_signature(const ni_xs_type_t *type, char *sigbuf, size_t bu
 		return NULL;
 
 	}
+
+	((ni_xs_type_t *) type)->dbus_signature = xstrdup(sigbuf);
 	return sigbuf;
 }
 
@@ -100,9 +100,13 @@ ni_dcbx_should_start(ni_netdev_t *dev)
 	if ((dcb = dev->dcb) == NULL) {
 		ni_dcb_capabilities_t capabilities;
 
+		/* The DCB capabilities are a static property of the hardware,
+		 * so probe them only once per device. A failed probe (ie a NIC
+		 * without DCB support) is cached, too, with all capabilities
+		 * cleared - else every ifreload would re-issue the RTM_GETDCB
+		 * query for every bond member just to fail again. */
 		memset(&capabilities, 0, sizeof(capabilities));
-		if (ni_dcb_get_capabilities(dev->name, &capabilities) < 0)
-			return FALSE;
+		ni_dcb_get_capabilities(dev->name, &capabilities);
 
 		dcb = dev->dcb = ni_dcb_new();
 		dcb->capabilities = capabilities;
@@ -32,9 +32,92 @@
 static unsigned int	ni_dhcp4_do_bits(const ni_config_dhcp4_t *, unsigned int);
 static const char *	ni_dhcp4_print_doflags(unsigned int);
 static void		ni_dhcp4_config_set_request_options(const char *, ni_uint_array_t *, const ni_string_array_t *);
+static void		ni_dhcp4_device_template_invalidate(ni_dhcp4_device_t *);
+static void		ni_dhcp4_device_template_drop_lease(ni_dhcp4_device_t *, const ni_addrconf_lease_t *);
 
 ni_dhcp4_device_t *	ni_dhcp4_active;
 
+/*
+ * Hash indexes over the active device list. Per-packet dispatch and
+ * netlink event handling look devices up by ifindex (and by name),
+ * which must not degrade to a list walk with thousands of managed
+ * interfaces.
+ */
+#define NI_DHCP4_DEVICE_HASH_SIZE	256	/* power of two */
+
+static ni_dhcp4_device_t *	ni_dhcp4_device_index_hash[NI_DHCP4_DEVICE_HASH_SIZE];
+static ni_dhcp4_device_t *	ni_dhcp4_device_name_hash[NI_DHCP4_DEVICE_HASH_SIZE];
+
+static inline unsigned int
+ni_dhcp4_device_index_bucket(unsigned int ifindex)
+{
+	return ifindex & (NI_DHCP4_DEVICE_HASH_SIZE - 1);
+}
+
+static unsigned int
+ni_dhcp4_device_name_bucket(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = ((hash << 5) + hash) + *name++;
+	return hash & (NI_DHCP4_DEVICE_HASH_SIZE - 1);
+}
+
+static void
+ni_dhcp4_device_name_hash_insert(ni_dhcp4_device_t *dev)
+{
+	ni_dhcp4_device_t **bucket;
+
+	bucket = &ni_dhcp4_device_name_hash[ni_dhcp4_device_name_bucket(dev->ifname)];
+	dev->name_next = *bucket;
+	*bucket = dev;
+}
+
+static void
+ni_dhcp4_device_name_hash_remove(ni_dhcp4_device_t *dev)
+{
+	ni_dhcp4_device_t **pos;
+
+	pos = &ni_dhcp4_device_name_hash[ni_dhcp4_device_name_bucket(dev->ifname)];
+	for (; *pos; pos = &(*pos)->name_next) {
+		if (*pos == dev) {
+			*pos = dev->name_next;
+			break;
+		}
+	}
+	dev->name_next = NULL;
+}
+
+static void
+ni_dhcp4_device_hash_insert(ni_dhcp4_device_t *dev)
+{
+	ni_dhcp4_device_t **bucket;
+
+	bucket = &ni_dhcp4_device_index_hash[ni_dhcp4_device_index_bucket(dev->link.ifindex)];
+	dev->index_next = *bucket;
+	*bucket = dev;
+
+	ni_dhcp4_device_name_hash_insert(dev);
+}
+
+static void
+ni_dhcp4_device_hash_remove(ni_dhcp4_device_t *dev)
+{
+	ni_dhcp4_device_t **pos;
+
+	pos = &ni_dhcp4_device_index_hash[ni_dhcp4_device_index_bucket(dev->link.ifindex)];
+	for (; *pos; pos = &(*pos)->index_next) {
+		if (*pos == dev) {
+			*pos = dev->index_next;
+			break;
+		}
+	}
+	dev->index_next = NULL;
+
+	ni_dhcp4_device_name_hash_remove(dev);
+}
+
 /*
  * Create and destroy dhcp4 device handles
  */
@@ -63,6 +146,7 @@ ni_dhcp4_device_new(const char *ifname, const ni_linkinfo_t *link)
 
 	/* append to end of list */
 	*pos = dev;
+	ni_dhcp4_device_hash_insert(dev);
 
 	return dev;
 }
@@ -72,7 +156,8 @@ ni_dhcp4_device_by_index(unsigned int ifindex)
 {
 	ni_dhcp4_device_t *dev;
 
-	for (dev = ni_dhcp4_active; dev; dev = dev->next) {
+	dev = ni_dhcp4_device_index_hash[ni_dhcp4_device_index_bucket(ifindex)];
+	for (; dev; dev = dev->index_next) {
 		if (dev->system.ifindex == ifindex)
 			return dev;
 	}
@@ -80,6 +165,20 @@ ni_dhcp4_device_by_index(unsigned int ifindex)
 	return NULL;
 }
 
+ni_dhcp4_device_t *
+ni_dhcp4_device_by_name(const char *ifname)
+{
+	ni_dhcp4_device_t *dev;
+
+	dev = ni_dhcp4_device_name_hash[ni_dhcp4_device_name_bucket(ifname)];
+	for (; dev; dev = dev->name_next) {
+		if (ni_string_eq(dev->ifname, ifname))
+			return dev;
+	}
+
+	return NULL;
+}
+
 static void
 ni_dhcp4_device_close(ni_dhcp4_device_t *dev)
 {
@@ -113,6 +212,31 @@ ni_dhcp4_device_stop(ni_dhcp4_device_t *dev)
 	ni_dhcp4_device_set_request(dev, NULL);
 }
 
+/*
+ * The supplicant only consumes address events of devices it actively
+ * manages (those with a config); tell the event listener to drop the
+ * events of all other interfaces kernel-side.
+ */
+static void
+ni_dhcp4_device_update_event_filter(void)
+{
+	unsigned int ifindices[64];
+	unsigned int count = 0;
+	ni_dhcp4_device_t *dev;
+
+	for (dev = ni_dhcp4_active; dev; dev = dev->next) {
+		if (!dev->config)
+			continue;
+		if (count >= sizeof(ifindices)/sizeof(ifindices[0])) {
+			/* too many to filter, accept everything */
+			ni_server_filter_interface_addr_events(FALSE, NULL, 0);
+			return;
+		}
+		ifindices[count++] = dev->link.ifindex;
+	}
+	ni_server_filter_interface_addr_events(TRUE, ifindices, count);
+}
+
 void
 ni_dhcp4_device_set_config(ni_dhcp4_device_t *dev, ni_dhcp4_config_t *config)
 {
@@ -122,6 +246,18 @@ ni_dhcp4_device_set_config(ni_dhcp4_device_t *dev, ni_dhcp4_config_t *config)
 		free(dev->config);
 	}
 	dev->config = config;
+	ni_dhcp4_device_template_invalidate(dev);
+
+	if (config) {
+		ni_netconfig_t *nih = ni_global_state_handle(0);
+		ni_netdev_t *ifp;
+
+		/* resync addresses missed while the events of this
+		 * interface were filtered out */
+		if ((ifp = ni_netdev_by_index(nih, dev->link.ifindex)))
+			__ni_system_refresh_interface_addrs(nih, ifp);
+	}
+	ni_dhcp4_device_update_event_filter();
 }
 
 void
@@ -141,6 +277,8 @@ ni_dhcp4_device_free(ni_dhcp4_device_t *dev)
 	ni_debug_dhcp("%s: Deleting dhcp4 device with index %u",
 			dev->ifname, dev->link.ifindex);
 
+	ni_dhcp4_device_hash_remove(dev);
+	ni_dhcp4_device_template_invalidate(dev);
 	ni_dhcp4_device_drop_buffer(dev);
 	ni_dhcp4_device_drop_lease(dev);
 	ni_dhcp4_device_drop_best_offer(dev);
@@ -194,8 +332,10 @@ void
 ni_dhcp4_device_set_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 {
 	if (dev->lease != lease) {
-		if (dev->lease)
+		if (dev->lease) {
+			ni_dhcp4_device_template_drop_lease(dev, dev->lease);
 			ni_addrconf_lease_free(dev->lease);
+		}
 		dev->lease = lease;
 		if (dev->config && lease)
 			lease->uuid = dev->config->uuid;
@@ -209,6 +349,7 @@ ni_dhcp4_device_drop_lease(ni_dhcp4_device_t *dev)
 
 	if ((lease = dev->lease) != NULL) {
 		dev->lease = NULL;
+		ni_dhcp4_device_template_drop_lease(dev, lease);
 		ni_addrconf_lease_free(lease);
 	}
 }
@@ -217,8 +358,10 @@ void
 ni_dhcp4_device_set_best_offer(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease,
 							int weight)
 {
-	if (dev->best_offer.lease && dev->best_offer.lease != lease)
+	if (dev->best_offer.lease && dev->best_offer.lease != lease) {
+		ni_dhcp4_device_template_drop_lease(dev, dev->best_offer.lease);
 		ni_addrconf_lease_free(dev->best_offer.lease);
+	}
 	dev->best_offer.lease = lease;
 	dev->best_offer.weight = weight;
 	if (dev->config && lease)
@@ -229,8 +372,10 @@ void
 ni_dhcp4_device_drop_best_offer(ni_dhcp4_device_t *dev)
 {
 	dev->best_offer.weight = -1;
-	if (dev->best_offer.lease)
+	if (dev->best_offer.lease) {
+		ni_dhcp4_device_template_drop_lease(dev, dev->best_offer.lease);
 		ni_addrconf_lease_free(dev->best_offer.lease);
+	}
 	dev->best_offer.lease = NULL;
 }
 
@@ -568,7 +713,9 @@ ni_dhcp4_device_event(ni_dhcp4_device_t *dev, ni_netdev_t *ifp, ni_event_t event
 		if (!ni_string_eq(dev->ifname, ifp->name)) {
 			ni_debug_dhcp("%s: Updating interface name to %s",
 					dev->ifname, ifp->name);
+			ni_dhcp4_device_name_hash_remove(dev);
 			ni_string_dup(&dev->ifname, ifp->name);
+			ni_dhcp4_device_name_hash_insert(dev);
 		}
 		/* Does return -1 on failure. */
 		ni_dhcp4_device_refresh(dev);
@@ -661,11 +808,84 @@ ni_dhcp4_device_drop_buffer(ni_dhcp4_device_t *dev)
 	ni_buffer_destroy(&dev->message);
 }
 
+/*
+ * Transmit message template handling.
+ *
+ * The option list of a DHCP4 message -- client-id, vendor class,
+ * parameter request list etc -- is invariant per device between config
+ * changes, so there is no point in rebuilding it for every
+ * retransmission. We keep a copy of the last built message and reuse
+ * it as long as message code, lease, xid and fsm state still match;
+ * only the secs header field needs patching then.
+ */
+static void
+ni_dhcp4_device_template_invalidate(ni_dhcp4_device_t *dev)
+{
+	ni_buffer_destroy(&dev->transmit.prebuilt.buf);
+	dev->transmit.prebuilt.lease = NULL;
+	dev->transmit.prebuilt.valid = 0;
+}
+
+static void
+ni_dhcp4_device_template_drop_lease(ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease)
+{
+	/* the lease the template was built from goes away */
+	if (dev->transmit.prebuilt.lease == lease)
+		ni_dhcp4_device_template_invalidate(dev);
+}
+
+static ni_bool_t
+ni_dhcp4_device_template_reuse(ni_dhcp4_device_t *dev)
+{
+	ni_buffer_t *pre = &dev->transmit.prebuilt.buf;
+	ni_dhcp4_message_t *message;
+
+	if (!dev->transmit.prebuilt.valid
+	 || dev->transmit.prebuilt.msg_code != dev->transmit.msg_code
+	 || dev->transmit.prebuilt.lease != dev->transmit.lease
+	 || dev->transmit.prebuilt.xid != dev->dhcp4.xid
+	 || dev->transmit.prebuilt.state != dev->fsm.state)
+		return FALSE;
+
+	ni_dhcp4_device_alloc_buffer(dev);
+	if (ni_buffer_put(&dev->message, ni_buffer_head(pre), ni_buffer_count(pre)) < 0)
+		return FALSE;
+
+	/* The buffer holds the bare payload; the capture frames it
+	 * with its header template and checksums it per send, so the
+	 * secs field is patched without further ado. */
+	message = (ni_dhcp4_message_t *) ni_buffer_head(&dev->message);
+	message->secs = htons(ni_dhcp4_device_uptime(dev, 0xFFFF));
+
+	return TRUE;
+}
+
+static void
+ni_dhcp4_device_template_store(ni_dhcp4_device_t *dev)
+{
+	ni_buffer_t *pre = &dev->transmit.prebuilt.buf;
+
+	ni_buffer_destroy(pre);
+	ni_buffer_init_dynamic(pre, ni_buffer_count(&dev->message));
+	if (ni_buffer_put(pre, ni_buffer_head(&dev->message), ni_buffer_count(&dev->message)) < 0)
+		return;
+
+	dev->transmit.prebuilt.msg_code = dev->transmit.msg_code;
+	dev->transmit.prebuilt.lease = dev->transmit.lease;
+	dev->transmit.prebuilt.xid = dev->dhcp4.xid;
+	dev->transmit.prebuilt.state = dev->fsm.state;
+	dev->transmit.prebuilt.valid = 1;
+}
+
 static int
 ni_dhcp4_device_prepare_message(void *data)
 {
 	ni_dhcp4_device_t *dev = data;
 
+	/* Reuse the prebuilt message where we can */
+	if (ni_dhcp4_device_template_reuse(dev))
+		return 0;
+
 	/* Allocate an empty buffer */
 	ni_dhcp4_device_alloc_buffer(dev);
 
@@ -675,6 +895,8 @@ ni_dhcp4_device_prepare_message(void *data)
 		ni_error("unable to build DHCP4 message");
 		return -1;
 	}
+
+	ni_dhcp4_device_template_store(dev);
 	return 0;
 }
 
@@ -786,6 +1008,7 @@ ni_dhcp4_device_arp_close(ni_dhcp4_device_t *dev)
 		ni_arp_socket_close(dev->arp.handle);
 		dev->arp.handle = NULL;
 	}
+	ni_arp_verify_destroy(&dev->arp.verify);
 }
 
 /*
@@ -946,6 +1169,14 @@ ni_dhcp4_config_vendor_class(void)
 	return dhconf->vendor_class;
 }
 
+unsigned int
+ni_dhcp4_config_renew_limit(void)
+{
+	const struct ni_config_dhcp4 *dhconf = &ni_global.config->addrconf.dhcp4;
+
+	return dhconf->renew_rate_limit;
+}
+
 int
 ni_dhcp4_config_ignore_server(const char *name)
 {
@@ -1132,4 +1363,8 @@ ni_dhcp4_new_xid(ni_dhcp4_device_t *cur)
 	} while (!xid);
 
 	cur->dhcp4.xid = xid;
+
+	/* have the kernel filter on the new transaction id */
+	if (cur->capture)
+		ni_capture_set_xid(cur->capture, xid);
 }
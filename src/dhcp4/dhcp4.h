@@ -35,6 +35,8 @@ typedef struct ni_dhcp4_request	ni_dhcp4_request_t;
 
 typedef struct ni_dhcp4_device {
 	struct ni_dhcp4_device *	next;
+	struct ni_dhcp4_device *	index_next;	/* ifindex hash chain */
+	struct ni_dhcp4_device *	name_next;	/* ifname hash chain */
 	unsigned int		users;
 
 	char *			ifname;
@@ -66,6 +68,16 @@ typedef struct ni_dhcp4_device {
 	struct {
 	    unsigned int	msg_code;
 	    const ni_addrconf_lease_t *lease;
+
+	    /* prebuilt message, reused across retransmissions */
+	    struct {
+		ni_buffer_t	buf;
+		unsigned int	msg_code;
+		const ni_addrconf_lease_t *lease;
+		uint32_t	xid;
+		enum fsm_state	state;
+		unsigned int	valid  : 1;
+	    } prebuilt;
 	} transmit;
 
 	struct {
@@ -78,8 +90,7 @@ typedef struct ni_dhcp4_device {
 
 	struct {
 	   ni_arp_socket_t *	handle;
-	   unsigned int		nprobes;
-	   unsigned int		nclaims;
+	   ni_arp_verify_t	verify;
 	} arp;
 
 	struct {
@@ -231,6 +242,8 @@ extern int		ni_dhcp4_build_message(const ni_dhcp4_device_t *,
 extern void		ni_dhcp4_fsm_link_up(ni_dhcp4_device_t *);
 extern void		ni_dhcp4_fsm_link_down(ni_dhcp4_device_t *);
 
+extern int		ni_dhcp4_probe_response(const ni_buffer_t *, struct in_addr *,
+						ni_opaque_t *);
 extern int		ni_dhcp4_parse_response(const ni_dhcp4_config_t *, const ni_dhcp4_message_t *,
 						ni_buffer_t *, ni_addrconf_lease_t **);
 
@@ -242,6 +255,7 @@ extern void		ni_dhcp4_device_stop(ni_dhcp4_device_t *);
 extern unsigned int	ni_dhcp4_device_uptime(const ni_dhcp4_device_t *, unsigned int);
 extern ni_dhcp4_device_t *ni_dhcp4_device_new(const char *, const ni_linkinfo_t *);
 extern ni_dhcp4_device_t *ni_dhcp4_device_by_index(unsigned int);
+extern ni_dhcp4_device_t *ni_dhcp4_device_by_name(const char *);
 extern ni_dhcp4_device_t *ni_dhcp4_device_get(ni_dhcp4_device_t *);
 extern void		ni_dhcp4_device_put(ni_dhcp4_device_t *);
 extern void		ni_dhcp4_device_event(ni_dhcp4_device_t *, ni_netdev_t *, ni_event_t);
@@ -270,6 +284,7 @@ extern int		ni_dhcp4_xml_from_lease(const ni_addrconf_lease_t *, xml_node_t *);
 extern int		ni_dhcp4_xml_to_lease(ni_addrconf_lease_t *, const xml_node_t *);
 
 extern const char *	ni_dhcp4_config_vendor_class(void);
+extern unsigned int	ni_dhcp4_config_renew_limit(void);
 extern int		ni_dhcp4_config_ignore_server(const char *);
 extern int		ni_dhcp4_config_have_server_preference(void);
 extern int		ni_dhcp4_config_server_preference_ipaddr(struct in_addr);
@@ -26,6 +26,7 @@
 
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/protocol.h"
+#include "trace.h"
 
 
 #define NAK_BACKOFF_MAX		60	/* seconds */
@@ -43,6 +44,17 @@ static void		__ni_dhcp4_fsm_timeout(void *, const ni_timer_t *);
 
 static ni_dhcp4_event_handler_t *ni_dhcp4_fsm_event_handler;
 
+/*
+ * All state changes funnel through here, so the dhcp4_state USDT
+ * probe can reconstruct per-interface lease timelines.
+ */
+static inline void
+ni_dhcp4_fsm_set_state(ni_dhcp4_device_t *dev, unsigned int state)
+{
+	ni_tracepoint3(dhcp4_state, dev->link.ifindex, dev->fsm.state, state);
+	dev->fsm.state = state;
+}
+
 static void
 ni_dhcp4_defer_timeout(void *user_data, const ni_timer_t *timer)
 {
@@ -109,6 +121,37 @@ ni_dhcp4_fsm_process_dhcp4_packet(ni_dhcp4_device_t *dev, ni_buffer_t *msgbuf, n
 		return -1;
 	}
 
+	/* Pre-scan the options in place before materializing a lease;
+	 * during OFFER floods most of them are discarded right away */
+	if (dev->fsm.state == NI_DHCP4_STATE_SELECTING) {
+		struct in_addr srv_addr;
+		ni_opaque_t client_id;
+
+		if (ni_dhcp4_probe_response(msgbuf, &srv_addr, &client_id) == DHCP4_OFFER) {
+			const char *ipaddr;
+
+			sender = ni_capture_from_hwaddr_print(from);
+			ipaddr = srv_addr.s_addr ? inet_ntoa(srv_addr) : NULL;
+
+			if ((sender && ni_dhcp4_config_ignore_server(sender))
+			 || (ipaddr && ni_dhcp4_config_ignore_server(ipaddr))) {
+				ni_debug_dhcp("%s: ignoring DHCP4 offer from %s%s%s%s (blacklisted)",
+						dev->ifname, ipaddr ? ipaddr : "?",
+						sender ? " (" : "",
+						sender ? sender : "",
+						sender ? ")" : "");
+				return -1;
+			}
+			if (client_id.len && dev->config->client_id.len
+			 && !ni_opaque_eq(&dev->config->client_id, &client_id)) {
+				ni_debug_dhcp("%s: ignoring packet with not matching client-id%s%s",
+						dev->ifname,
+						sender ? " sender " : "", sender ? sender : "");
+				return -1;
+			}
+		}
+	}
+
 	msg_code = ni_dhcp4_parse_response(dev->config, message, msgbuf, &lease);
 	sender = ni_capture_from_hwaddr_print(from);
 	if (msg_code < 0) {
@@ -338,7 +381,7 @@ out:
 static void
 ni_dhcp4_fsm_restart(ni_dhcp4_device_t *dev)
 {
-	dev->fsm.state = NI_DHCP4_STATE_INIT;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_INIT);
 
 	ni_dhcp4_device_disarm_retransmit(dev);
 	if (dev->fsm.timer) {
@@ -346,6 +389,8 @@ ni_dhcp4_fsm_restart(ni_dhcp4_device_t *dev)
 		dev->fsm.timer = NULL;
 	}
 	dev->dhcp4.xid = 0;
+	if (dev->capture)
+		ni_capture_set_xid(dev->capture, 0);
 	dev->config->elapsed_timeout = 0;
 
 	ni_dhcp4_device_drop_lease(dev);
@@ -402,7 +447,7 @@ __ni_dhcp4_fsm_discover(ni_dhcp4_device_t *dev, int scan_offers)
 	lease->fqdn.qualify = dev->config->fqdn.qualify;
 	ni_string_free(&lease->hostname);
 
-	dev->fsm.state = NI_DHCP4_STATE_SELECTING;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_SELECTING);
 	dev->dhcp4.accept_any_offer = 1;
 
 	ni_debug_dhcp("valid lease: %d; have prefs: %d",
@@ -429,7 +474,7 @@ __ni_dhcp4_fsm_discover(ni_dhcp4_device_t *dev, int scan_offers)
 static void
 ni_dhcp4_fsm_discover_init(ni_dhcp4_device_t *dev)
 {
-	dev->fsm.state = NI_DHCP4_STATE_SELECTING;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_SELECTING);
 	ni_dhcp4_new_xid(dev);
 	dev->start_time = time(NULL);
 	dev->config->elapsed_timeout = 0;
@@ -439,7 +484,7 @@ ni_dhcp4_fsm_discover_init(ni_dhcp4_device_t *dev)
 static void
 ni_dhcp4_fsm_request(ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease)
 {
-	dev->fsm.state = NI_DHCP4_STATE_REQUESTING;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_REQUESTING);
 	dev->config->capture_timeout = dev->config->capture_max_timeout;
 	if (dev->config->acquire_timeout && dev->config->acquire_timeout - dev->config->elapsed_timeout < dev->config->capture_max_timeout)
 		dev->config->capture_timeout = dev->config->acquire_timeout - dev->config->elapsed_timeout;
@@ -471,7 +516,7 @@ ni_dhcp4_fsm_renewal(ni_dhcp4_device_t *dev, ni_bool_t oneshot)
 static void
 ni_dhcp4_fsm_renewal_init(ni_dhcp4_device_t *dev)
 {
-	dev->fsm.state = NI_DHCP4_STATE_RENEWING;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_RENEWING);
 	ni_dhcp4_new_xid(dev);
 	dev->start_time = time(NULL);
 	/* Send renewal request at least once */
@@ -502,7 +547,7 @@ ni_dhcp4_fsm_rebind(ni_dhcp4_device_t *dev, ni_bool_t oneshot)
 static void
 ni_dhcp4_fsm_rebind_init(ni_dhcp4_device_t *dev)
 {
-	dev->fsm.state = NI_DHCP4_STATE_REBINDING;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_REBINDING);
 	ni_dhcp4_new_xid(dev);
 	dev->start_time = time(NULL);
 	dev->lease->dhcp4.server_id.s_addr = 0;
@@ -522,7 +567,7 @@ ni_dhcp4_fsm_reboot(ni_dhcp4_device_t *dev)
 	ni_dhcp4_new_xid(dev);
 	dev->config->elapsed_timeout = 0;
 	dev->start_time = time(NULL);
-	dev->fsm.state = NI_DHCP4_STATE_REBOOT;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_REBOOT);
 
 	expire_time = dev->lease->acquired.tv_sec + dev->lease->dhcp4.rebind_time;
 	if (expire_time > now && deadline > expire_time)
@@ -544,7 +589,7 @@ ni_dhcp4_fsm_decline(ni_dhcp4_device_t *dev)
 		inet_ntoa(dev->lease->dhcp4.address));
 
 	dev->start_time = time(NULL);
-	dev->fsm.state = NI_DHCP4_STATE_INIT;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_INIT);
 	ni_dhcp4_device_send_message(dev, DHCP4_DECLINE, dev->lease);
 
 	/* FIXME: we should record the bad lease, and ignore it
@@ -575,7 +620,7 @@ void
 ni_dhcp4_fsm_release_init(ni_dhcp4_device_t *dev)
 {
 	/* there is currently no releasing state... */
-	dev->fsm.state = NI_DHCP4_STATE_INIT;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_INIT);
 	ni_dhcp4_new_xid(dev);
 	dev->start_time = time(NULL);
 	dev->config->elapsed_timeout = 0;
@@ -849,11 +894,76 @@ ni_dhcp4_process_ack(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 	return 0;
 }
 
+/*
+ * Renewal spreading.
+ *
+ * When many devices obtain their leases in the same second (rack power
+ * on), their T1 renewals would fire simultaneously forever after, and
+ * the per-timeout jitter only smears them within a fraction of a
+ * second. If the configuration sets a renew-rate-limit, we keep a
+ * ledger of how many renewals are already booked per second and push a
+ * new renewal to the next second with budget left. A renewal is never
+ * pushed past the midpoint between T1 and T2, and a target outside the
+ * ledger window simply stays unspread.
+ */
+#define NI_DHCP4_RENEW_LEDGER_SIZE	1024	/* seconds tracked */
+
+static time_t		ni_dhcp4_renew_ledger_base;
+static unsigned short	ni_dhcp4_renew_ledger[NI_DHCP4_RENEW_LEDGER_SIZE];
+
+static unsigned int
+ni_dhcp4_fsm_shard_renewal(ni_dhcp4_device_t *dev, const ni_addrconf_lease_t *lease)
+{
+	unsigned int budget = ni_dhcp4_config_renew_limit();
+	unsigned int renewal = lease->dhcp4.renewal_time;
+	time_t now = time(NULL);
+	time_t target, end, t;
+
+	if (budget == 0)
+		return renewal;
+
+	target = now + renewal;
+	end = now + renewal + (lease->dhcp4.rebind_time - renewal) / 2;
+
+	/* rebase the ledger once the window has moved past it; bookings
+	 * of long-gone renewals are dropped along the way */
+	if (ni_dhcp4_renew_ledger_base == 0
+	 || target < ni_dhcp4_renew_ledger_base
+	 || target >= ni_dhcp4_renew_ledger_base + NI_DHCP4_RENEW_LEDGER_SIZE) {
+		ni_dhcp4_renew_ledger_base = target;
+		memset(ni_dhcp4_renew_ledger, 0, sizeof(ni_dhcp4_renew_ledger));
+	}
+
+	for (t = target; t < end; ++t) {
+		unsigned short *count;
+
+		if (t >= ni_dhcp4_renew_ledger_base + NI_DHCP4_RENEW_LEDGER_SIZE)
+			break;
+
+		count = &ni_dhcp4_renew_ledger[t - ni_dhcp4_renew_ledger_base];
+		if (*count < budget) {
+			(*count)++;
+			if (t != target) {
+				ni_debug_dhcp("%s: spreading renewal by %ld seconds "
+						"(%u renewals already booked at T1)",
+						dev->ifname, (long) (t - target), budget);
+			}
+			return t - now;
+		}
+	}
+
+	/* window saturated or out of ledger range; renew at T1 */
+	return renewal;
+}
+
 int
 ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 {
-	ni_capture_free(dev->capture);
-	dev->capture = NULL;
+	/* Stop retransmission, but keep the capture socket open while we
+	 * stay bound; the BOUND -> RENEWING -> REBINDING cycle reuses it
+	 * and just moves the xid filter instead of paying socket setup
+	 * and poll registration on every lease timer. */
+	ni_dhcp4_device_disarm_retransmit(dev);
 
 	if (lease) {
 		ni_debug_dhcp("%s: committing lease", dev->ifname);
@@ -862,9 +972,12 @@ ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 			dev->defer.timer = NULL;
 		}
 		if (dev->config->dry_run == NI_DHCP4_RUN_NORMAL) {
+			unsigned int renewal;
+
+			renewal = ni_dhcp4_fsm_shard_renewal(dev, lease);
 			ni_debug_dhcp("%s: schedule renewal of lease in %u seconds",
-					dev->ifname, lease->dhcp4.renewal_time);
-			ni_dhcp4_fsm_set_timeout(dev, lease->dhcp4.renewal_time);
+					dev->ifname, renewal);
+			ni_dhcp4_fsm_set_timeout(dev, renewal);
 		}
 
 		/* If the user requested a specific route metric, apply it now */
@@ -884,7 +997,7 @@ ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 		}
 
 		ni_dhcp4_device_set_lease(dev, lease);
-		dev->fsm.state = NI_DHCP4_STATE_BOUND;
+		ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_BOUND);
 
 		ni_note("%s: Committed DHCPv4 lease with address %s "
 			"(lease time %u sec, renew in %u sec, rebind in %u sec)",
@@ -905,6 +1018,10 @@ ni_dhcp4_fsm_commit_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 			ni_dhcp4_device_stop(dev);
 		}
 	} else {
+		/* Dropping the lease leaves managed state, so release
+		 * the capture socket along with it. */
+		ni_capture_free(dev->capture);
+		dev->capture = NULL;
 
 		/* Delete old lease file */
 		if ((lease = dev->lease) != NULL) {
@@ -1013,6 +1130,9 @@ __ni_dhcp4_address_on_link(ni_dhcp4_device_t *dev, struct in_addr ipv4)
 int
 ni_dhcp4_fsm_validate_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 {
+	unsigned int count = 0;
+	ni_address_t *ap;
+
 	/*
 	 * When the address is already set on the link, we
 	 * don't need to validate it and just commit it.
@@ -1027,38 +1147,40 @@ ni_dhcp4_fsm_validate_lease(ni_dhcp4_device_t *dev, ni_addrconf_lease_t *lease)
 	ni_info("%s: Validating DHCPv4 address %s",
 		dev->ifname, inet_ntoa(lease->dhcp4.address));
 
-	/* For ARP validations, we will send 3 ARP queries with a timeout
-	 * of 200ms each.
-	 * The "claims" part is really for IPv4LL
-	 */
-	dev->arp.nprobes = 3;
-	dev->arp.nclaims = 0;
-
-	/* dhcp4cd source code says:
-	 * IEEE1394 cannot set ARP target address according to RFC2734
+	/* For ARP validations, we will send 3 ARP probes with a timeout
+	 * of 200ms each; all addresses of the lease are verified in the
+	 * same probe round, so validation takes one round regardless of
+	 * how many addresses the lease carries.
 	 */
-	if (dev->system.hwaddr.type == ARPHRD_IEEE1394)
-		dev->arp.nclaims = 0;
+	ni_arp_verify_reset(&dev->arp.verify, 3, NI_DHCP4_ARP_TIMEOUT);
+	for (ap = lease->addrs; ap; ap = ap->next) {
+		ni_address_set_tentative(ap, TRUE);
+		if (ni_arp_verify_add_address(&dev->arp.verify, ap))
+			count++;
+	}
+	if (!count) {
+		ni_debug_dhcp("%s: no addresses to validate in lease", dev->ifname);
+		ni_dhcp4_fsm_commit_lease(dev, lease);
+		return 0;
+	}
 
 	if (ni_dhcp4_fsm_arp_validate(dev) < 0) {
 		ni_debug_dhcp("%s: unable to validate lease", dev->ifname);
 		return -1;
 	}
 
-	dev->fsm.state = NI_DHCP4_STATE_VALIDATING;
+	ni_dhcp4_fsm_set_state(dev, NI_DHCP4_STATE_VALIDATING);
 	return 0;
 }
 
 int
 ni_dhcp4_fsm_arp_validate(ni_dhcp4_device_t *dev)
 {
-	struct in_addr null = { 0 };
-	struct in_addr claim;
+	unsigned int timeout;
 
 	if (!dev->lease)
 		return -1;
 
-	claim = dev->lease->dhcp4.address;
 	if (dev->arp.handle == NULL) {
 		dev->arp.handle = ni_arp_socket_open(&dev->system,
 				ni_dhcp4_fsm_process_arp_packet, dev);
@@ -1068,26 +1190,16 @@ ni_dhcp4_fsm_arp_validate(ni_dhcp4_device_t *dev)
 		}
 	}
 
-	if (dev->arp.nprobes) {
-		ni_debug_dhcp("%s: arp validate: probing for %s",
-				dev->ifname, inet_ntoa(claim));
-		ni_arp_send_request(dev->arp.handle, null, claim);
-		dev->arp.nprobes--;
-	} else if (dev->arp.nclaims) {
-		ni_debug_dhcp("%s: arp validate: claiming %s",
-				dev->ifname, inet_ntoa(claim));
-		ni_arp_send_grat_request(dev->arp.handle, claim);
-		dev->arp.nclaims--;
-	} else {
-		/* Wow, we're done! */
-		ni_info("%s: Successfully validated DHCPv4 address %s",
-			dev->ifname, inet_ntoa(claim));
-		ni_dhcp4_fsm_commit_lease(dev, dev->lease);
-		ni_dhcp4_device_arp_close(dev);
+	if (ni_arp_verify_send(dev->arp.handle, &dev->arp.verify, &timeout)) {
+		ni_dhcp4_fsm_set_timeout_msec(dev, timeout);
 		return 0;
 	}
 
-	ni_dhcp4_fsm_set_timeout_msec(dev, NI_DHCP4_ARP_TIMEOUT);
+	/* Wow, we're done! */
+	ni_info("%s: Successfully validated DHCPv4 address %s",
+		dev->ifname, inet_ntoa(dev->lease->dhcp4.address));
+	ni_dhcp4_fsm_commit_lease(dev, dev->lease);
+	ni_dhcp4_device_arp_close(dev);
 	return 0;
 }
 
@@ -1095,55 +1207,27 @@ void
 ni_dhcp4_fsm_process_arp_packet(ni_arp_socket_t *arph, const ni_arp_packet_t *pkt, void *user_data)
 {
 	ni_dhcp4_device_t *dev = user_data;
-	ni_netconfig_t *nc = ni_global_state_handle(0);
-	const ni_netdev_t *ifp;
-	ni_bool_t false_alarm = FALSE;
-	ni_bool_t found_addr = FALSE;
+	unsigned int i;
 
 	if (!pkt || pkt->op != ARPOP_REPLY || !dev->lease)
 		return;
 
-	/* Is it about the address we're validating at all? */
-	if (pkt->sip.s_addr != dev->lease->dhcp4.address.s_addr)
-		return;
-
-	/* Ignore any ARP replies that seem to come from our own
-	 * MAC address. Some helpful switches seem to generate
-	 * these. */
-	if (ni_link_address_equal(&dev->system.hwaddr, &pkt->sha))
-		return;
-
-	/* As well as ARP replies that seem to come from our own
-	 * host: dup if same address, not a dup if there are two
-	 * interfaces connected to the same broadcast domain.
+	/* The shared verify engine filters unrelated addresses as well
+	 * as replies from our own MAC or another interface of our own
+	 * host, and marks genuine conflicts as duplicate.
 	 */
-	for (ifp = ni_netconfig_devlist(nc); ifp; ifp = ifp->next) {
-		if (ifp->link.ifindex == dev->link.ifindex)
-			continue;
-
-		if (!ni_netdev_link_is_up(ifp))
-			continue;
+	ni_arp_verify_process(arph, pkt, &dev->arp.verify);
 
-		if (!ni_link_address_equal(&ifp->link.hwaddr, &pkt->sha))
-			continue;
+	/* Decline the lease as soon as one of its addresses is in use */
+	for (i = 0; i < dev->arp.verify.ipaddrs.count; ++i) {
+		const ni_address_t *ap = dev->arp.verify.ipaddrs.data[i];
 
-		/* OK, we have an interface matching the hwaddr,
-		 * which will answer arp requests when it is on
-		 * the same broadcast domain and causes a false
-		 * alarm, except it really has the IP assigned.
-		 */
-		false_alarm = TRUE;
-		if (__ni_dhcp4_address_on_device(ifp, pkt->sip))
-			found_addr = TRUE;
+		if (ni_address_is_duplicate(ap)) {
+			ni_dhcp4_device_arp_close(dev);
+			ni_dhcp4_fsm_decline(dev);
+			return;
+		}
 	}
-	if (false_alarm && !found_addr)
-		return;
-
-	ni_debug_dhcp("%s: address %s already in use by %s",
-			dev->ifname, inet_ntoa(pkt->sip),
-			ni_link_address_print(&pkt->sha));
-	ni_dhcp4_device_arp_close(dev);
-	ni_dhcp4_fsm_decline(dev);
 }
 
 /*
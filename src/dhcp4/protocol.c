@@ -103,6 +103,7 @@ ni_dhcp4_socket_open(ni_dhcp4_device_t *dev)
 	prot_info.eth_protocol = ETHERTYPE_IP;
 	prot_info.ip_protocol = IPPROTO_UDP;
 	prot_info.ip_port = DHCP4_CLIENT_PORT;
+	prot_info.ip_xid = dev->dhcp4.xid;
 
 	if ((capture = dev->capture) != NULL) {
 		if (ni_capture_is_valid(capture, ETHERTYPE_IP))
@@ -1166,10 +1167,6 @@ ni_dhcp4_build_message(const ni_dhcp4_device_t *dev, unsigned int msg_code,
 		goto failed;
 	}
 
-	/* Reserve some room for the IP and UDP header */
-	if (!renew)
-		ni_buffer_reserve_head(msgbuf, sizeof(struct ip) + sizeof(struct udphdr));
-
 	src_addr.s_addr = dst_addr.s_addr = 0;
 	switch (msg_code) {
 	case DHCP4_INFORM:
@@ -1241,9 +1238,9 @@ ni_dhcp4_build_message(const ni_dhcp4_device_t *dev, unsigned int msg_code,
 	ni_buffer_pad(msgbuf, BOOTP_MESSAGE_LENGTH_MIN, DHCP4_PAD);
 #endif
 
-	if (!renew && ni_capture_build_udp_header(msgbuf, src_addr,
+	if (!renew && ni_capture_set_udp_header(dev->capture, src_addr,
 			DHCP4_CLIENT_PORT, dst_addr, DHCP4_SERVER_PORT) < 0) {
-		ni_error("%s: unable to build packet header", dev->ifname);
+		ni_error("%s: unable to set up packet header template", dev->ifname);
 		goto failed;
 	}
 
@@ -1801,6 +1798,60 @@ ni_dhcp4_apply_routes(ni_addrconf_lease_t *lease, ni_route_array_t *routes)
 	ni_route_array_destroy(&temp);
 }
 
+/*
+ * Cheap pre-scan of a response's option buffer.
+ *
+ * Walks the options in place - no allocations, no lease - and extracts
+ * just the fields needed to decide whether the message is worth
+ * processing: the message type, server id and client id. The caller's
+ * buffer is not consumed; a full ni_dhcp4_parse_response() can follow.
+ * Used to discard unwanted OFFERs during broadcast floods without
+ * materializing a lease for each of them.
+ *
+ * Returns the message type, or -1 if none was found.
+ */
+int
+ni_dhcp4_probe_response(const ni_buffer_t *options, struct in_addr *server_id, ni_opaque_t *client_id)
+{
+	ni_buffer_t obuf = *options;
+	int msg_type = -1;
+
+	server_id->s_addr = 0;
+	client_id->len = 0;
+
+	while (ni_buffer_count(&obuf) && !obuf.underflow) {
+		ni_buffer_t buf;
+		int option;
+
+		option = ni_dhcp4_option_next(&obuf, &buf);
+		if (option == DHCP4_END || option < 0)
+			break;
+
+		switch (option) {
+		case DHCP4_PAD:
+			continue;
+
+		case DHCP4_MESSAGETYPE:
+			if ((option = ni_buffer_getc(&buf)) != EOF && msg_type == -1)
+				msg_type = option;
+			continue;
+
+		case DHCP4_SERVERIDENTIFIER:
+			ni_dhcp4_option_get_ipv4(&buf, server_id);
+			continue;
+
+		case DHCP4_CLIENTID:
+			ni_dhcp4_option_get_opaque(&buf, client_id);
+			continue;
+
+		default:
+			continue;
+		}
+	}
+
+	return msg_type;
+}
+
 /*
  * Parse a DHCP4 response.
  */
@@ -41,6 +41,7 @@
 #include <wicked/xml.h>
 
 #include "appconfig.h"
+#include "util_priv.h"
 #include "dhcp4/dhcp4.h"
 #include "dhcp4/tester.h"
 
@@ -49,6 +50,24 @@
 static ni_dhcp4_tester_t	dhcp4_tester_opts;
 static int			dhcp4_tester_status;
 
+/*
+ * Load generation mode: N virtual clients with distinct client-ids
+ * and xids racing over the same interface, to measure acquisition
+ * latency distribution and sustained acquisitions per second.
+ */
+typedef struct ni_dhcp4_tester_client {
+	ni_dhcp4_device_t *	dev;
+	struct timeval		started;
+	struct timeval		acquired;
+	ni_bool_t		done;
+	ni_bool_t		granted;
+} ni_dhcp4_tester_client_t;
+
+static ni_dhcp4_tester_client_t *dhcp4_tester_clients;
+static unsigned int		dhcp4_tester_nclients;
+static unsigned int		dhcp4_tester_nfinished;
+static unsigned int		dhcp4_tester_ngranted;
+
 ni_dhcp4_tester_t *
 ni_dhcp4_tester_init(void)
 {
@@ -67,11 +86,48 @@ ni_dhcp4_tester_set_outfmt(const char *outfmt, unsigned int *type)
 		{ "lease-xml",	NI_DHCP4_TESTER_OUT_LEASE_XML  },
 		{ "leaseinfo",	NI_DHCP4_TESTER_OUT_LEASE_INFO },
 		{ "info",	NI_DHCP4_TESTER_OUT_LEASE_INFO },
+		{ "leaseinfo-json", NI_DHCP4_TESTER_OUT_LEASE_JSON },
+		{ "json",	NI_DHCP4_TESTER_OUT_LEASE_JSON },
 		{ NULL,		NI_DHCP4_TESTER_OUT_LEASE_INFO },
 	};
 	return ni_parse_uint_mapped(outfmt, __outfmt_map, type) == 0;
 }
 
+static void
+ni_dhcp4_tester_client_event(enum ni_dhcp4_event ev, const ni_dhcp4_device_t *dev,
+		ni_addrconf_lease_t *lease)
+{
+	unsigned int i;
+
+	for (i = 0; i < dhcp4_tester_nclients; ++i) {
+		ni_dhcp4_tester_client_t *client = &dhcp4_tester_clients[i];
+
+		if (client->dev != dev || client->done)
+			continue;
+
+		switch (ev) {
+		case NI_DHCP4_EVENT_ACQUIRED:
+			if (!lease || lease->state != NI_ADDRCONF_STATE_GRANTED)
+				return;
+			ni_timer_get_time(&client->acquired);
+			client->granted = TRUE;
+			client->done = TRUE;
+			dhcp4_tester_ngranted++;
+			dhcp4_tester_nfinished++;
+			break;
+
+		case NI_DHCP4_EVENT_LOST:
+			client->done = TRUE;
+			dhcp4_tester_nfinished++;
+			break;
+
+		default:
+			break;
+		}
+		return;
+	}
+}
+
 static void
 ni_dhcp4_tester_protocol_event(enum ni_dhcp4_event ev, const ni_dhcp4_device_t *dev,
 		ni_addrconf_lease_t *lease)
@@ -80,6 +136,11 @@ ni_dhcp4_tester_protocol_event(enum ni_dhcp4_event ev, const ni_dhcp4_device_t *
 			dev->ifname, dev->link.ifindex,
 			dev->config ? ni_uuid_print(&dev->config->uuid) : "<none>");
 
+	if (dhcp4_tester_nclients) {
+		ni_dhcp4_tester_client_event(ev, dev, lease);
+		return;
+	}
+
 	switch (ev) {
 	case NI_DHCP4_EVENT_ACQUIRED:
 		if (lease && lease->state == NI_ADDRCONF_STATE_GRANTED) {
@@ -105,6 +166,9 @@ ni_dhcp4_tester_protocol_event(enum ni_dhcp4_event ev, const ni_dhcp4_device_t *
 				}
 				xml_node_print(xml, fp);
 				xml_node_free(xml);
+			} else
+			if (dhcp4_tester_opts.outfmt == NI_DHCP4_TESTER_OUT_LEASE_JSON) {
+				ni_leaseinfo_json_dump(fp, lease, dev->ifname, NULL);
 			} else {
 				ni_leaseinfo_dump(fp, lease, dev->ifname, NULL);
 			}
@@ -256,6 +320,137 @@ ni_dhcp4_tester_req_init(ni_dhcp4_request_t *req, const char *request)
 	return TRUE;
 }
 
+static unsigned long
+ni_dhcp4_tester_timeval_msec(const struct timeval *beg, const struct timeval *end)
+{
+	struct timeval dif;
+
+	timersub(end, beg, &dif);
+	return dif.tv_sec * 1000 + dif.tv_usec / 1000;
+}
+
+static int
+ni_dhcp4_tester_latency_cmp(const void *a, const void *b)
+{
+	unsigned long la = *(const unsigned long *) a;
+	unsigned long lb = *(const unsigned long *) b;
+
+	return la < lb ? -1 : (la > lb ? 1 : 0);
+}
+
+static int
+ni_dhcp4_tester_spawn_clients(ni_dhcp4_device_t *dev, const ni_dhcp4_request_t *req,
+		unsigned int count)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *ifp;
+	unsigned int i;
+	int rv;
+
+	if (!nc || !(ifp = ni_netdev_by_index(nc, dev->link.ifindex)))
+		return -1;
+
+	dhcp4_tester_clients = xcalloc(count, sizeof(*dhcp4_tester_clients));
+	dhcp4_tester_nclients = count;
+
+	for (i = 0; i < count; ++i) {
+		ni_dhcp4_tester_client_t *client = &dhcp4_tester_clients[i];
+		ni_dhcp4_request_t *creq;
+		ni_dhcp4_device_t *cdev;
+		char clientid[32];
+
+		if (i == 0) {
+			cdev = dev;
+		} else
+		if (!(cdev = ni_dhcp4_device_new(ifp->name, &ifp->link))) {
+			ni_error("%s: cannot allocate dhcp4 client %u", ifp->name, i);
+			return -1;
+		}
+
+		if (!(creq = ni_dhcp4_request_new()))
+			return -1;
+
+		creq->update = req->update;
+		creq->dry_run = req->dry_run;
+		creq->acquire_timeout = req->acquire_timeout;
+		creq->broadcast = req->broadcast;
+		creq->lease_time = req->lease_time;
+		ni_uuid_generate(&creq->uuid);
+
+		/* Each virtual client gets a distinct client-id built
+		 * from a locally administered MAC; the server hands out
+		 * one lease per client-id. No lease recovery or release,
+		 * we only measure the acquisition.
+		 */
+		snprintf(clientid, sizeof(clientid), "02:00:00:%02x:%02x:%02x",
+				(i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+		ni_string_dup(&creq->clientid, clientid);
+		creq->recover_lease = FALSE;
+		creq->release_lease = FALSE;
+
+		client->dev = cdev;
+		ni_timer_get_time(&client->started);
+		rv = ni_dhcp4_acquire(cdev, creq);
+		ni_dhcp4_request_free(creq);
+		if (rv < 0) {
+			ni_error("%s: acquire request for client %u failed: %s",
+					cdev->ifname, i, ni_strerror(rv));
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void
+ni_dhcp4_tester_report_clients(const struct timeval *started)
+{
+	FILE *fp = stdout;
+	unsigned long *lat, total = 0, elapsed;
+	struct timeval last = *started;
+	unsigned int i, n = 0;
+
+	lat = xcalloc(dhcp4_tester_nclients, sizeof(*lat));
+	for (i = 0; i < dhcp4_tester_nclients; ++i) {
+		ni_dhcp4_tester_client_t *client = &dhcp4_tester_clients[i];
+
+		if (!client->granted)
+			continue;
+
+		lat[n++] = ni_dhcp4_tester_timeval_msec(&client->started,
+							&client->acquired);
+		total += lat[n - 1];
+		if (timercmp(&client->acquired, &last, >))
+			last = client->acquired;
+	}
+
+	if (dhcp4_tester_opts.output != NULL) {
+		if (!(fp = fopen(dhcp4_tester_opts.output, "w"))) {
+			ni_error("Cannot open %s for output", dhcp4_tester_opts.output);
+			fp = stdout;
+		}
+	}
+
+	fprintf(fp, "clients: %u\n", dhcp4_tester_nclients);
+	fprintf(fp, "acquired: %u\n", n);
+	fprintf(fp, "failed: %u\n", dhcp4_tester_nclients - n);
+	if (n) {
+		qsort(lat, n, sizeof(*lat), ni_dhcp4_tester_latency_cmp);
+		elapsed = ni_dhcp4_tester_timeval_msec(started, &last);
+		fprintf(fp, "elapsed: %lu.%03lu sec\n", elapsed / 1000, elapsed % 1000);
+		fprintf(fp, "rate: %.2f acquisitions/sec\n", elapsed ?
+				(double) n * 1000.0 / (double) elapsed : (double) n);
+		fprintf(fp, "latency min/avg/max: %lu/%lu/%lu msec\n",
+				lat[0], total / n, lat[n - 1]);
+		fprintf(fp, "latency p50/p90/p99: %lu/%lu/%lu msec\n",
+				lat[(n - 1) * 50 / 100], lat[(n - 1) * 90 / 100],
+				lat[(n - 1) * 99 / 100]);
+	}
+	fflush(fp);
+	if (fp != stdout)
+		fclose(fp);
+	free(lat);
+}
+
 int
 ni_dhcp4_tester_run(ni_dhcp4_tester_t *opts)
 {
@@ -264,6 +459,7 @@ ni_dhcp4_tester_run(ni_dhcp4_tester_t *opts)
 	ni_dhcp4_device_t *dev = NULL;
 	ni_dhcp4_request_t *req = NULL;
 	unsigned int link_timeout = 20;
+	struct timeval started;
 	int rv;
 
 	if (opts->timeout && opts->timeout != -1U) {
@@ -346,6 +542,11 @@ ni_dhcp4_tester_run(ni_dhcp4_tester_t *opts)
 
 	req->broadcast = opts->broadcast;
 
+	ni_timer_get_time(&started);
+	if (opts->clients > 1) {
+		if (ni_dhcp4_tester_spawn_clients(dev, req, opts->clients) < 0)
+			goto failure;
+	} else
 	if ((rv = ni_dhcp4_acquire(dev, req)) < 0) {
 		ni_error("%s: DHCP4v6 acquire request %s failed: %s",
 				dev->ifname, ni_uuid_print(&req->uuid),
@@ -357,6 +558,10 @@ ni_dhcp4_tester_run(ni_dhcp4_tester_t *opts)
 	while (!ni_caught_terminal_signal()) {
 		long timeout;
 
+		if (dhcp4_tester_nclients &&
+		    dhcp4_tester_nfinished >= dhcp4_tester_nclients)
+			break;
+
 		timeout = ni_timer_next_timeout();
 
 		if (ni_socket_wait(timeout) != 0)
@@ -365,6 +570,12 @@ ni_dhcp4_tester_run(ni_dhcp4_tester_t *opts)
 	ni_server_deactivate_interface_events();
 	ni_socket_deactivate_all();
 
+	if (dhcp4_tester_nclients) {
+		ni_dhcp4_tester_report_clients(&started);
+		dhcp4_tester_status = dhcp4_tester_ngranted == dhcp4_tester_nclients ?
+				NI_WICKED_RC_SUCCESS : NI_WICKED_RC_ERROR;
+	}
+
 failure:
 	if (dev)
 		ni_dhcp4_device_put(dev);
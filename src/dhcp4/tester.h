@@ -27,6 +27,7 @@
 
 enum {
 	NI_DHCP4_TESTER_OUT_LEASE_INFO,
+	NI_DHCP4_TESTER_OUT_LEASE_JSON,
 	NI_DHCP4_TESTER_OUT_LEASE_XML,
 };
 
@@ -37,6 +38,7 @@ typedef struct ni_dhcp4_tester {
 	const char *	output;
 	unsigned int	outfmt;
 	ni_tristate_t	broadcast;
+	unsigned int	clients;
 } ni_dhcp4_tester_t;
 
 extern ni_dhcp4_tester_t *	ni_dhcp4_tester_init(void);
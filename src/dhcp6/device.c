@@ -79,6 +79,87 @@
 
 ni_dhcp6_device_t *		ni_dhcp6_active;
 
+/*
+ * Hash indexes over the active device list. Per-packet dispatch and
+ * netlink event handling look devices up by ifindex (and by name),
+ * which must not degrade to a list walk with thousands of managed
+ * interfaces.
+ */
+#define NI_DHCP6_DEVICE_HASH_SIZE	256	/* power of two */
+
+static ni_dhcp6_device_t *	ni_dhcp6_device_index_hash[NI_DHCP6_DEVICE_HASH_SIZE];
+static ni_dhcp6_device_t *	ni_dhcp6_device_name_hash[NI_DHCP6_DEVICE_HASH_SIZE];
+
+static inline unsigned int
+ni_dhcp6_device_index_bucket(unsigned int ifindex)
+{
+	return ifindex & (NI_DHCP6_DEVICE_HASH_SIZE - 1);
+}
+
+static unsigned int
+ni_dhcp6_device_name_bucket(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = ((hash << 5) + hash) + *name++;
+	return hash & (NI_DHCP6_DEVICE_HASH_SIZE - 1);
+}
+
+static void
+ni_dhcp6_device_name_hash_insert(ni_dhcp6_device_t *dev)
+{
+	ni_dhcp6_device_t **bucket;
+
+	bucket = &ni_dhcp6_device_name_hash[ni_dhcp6_device_name_bucket(dev->ifname)];
+	dev->name_next = *bucket;
+	*bucket = dev;
+}
+
+static void
+ni_dhcp6_device_name_hash_remove(ni_dhcp6_device_t *dev)
+{
+	ni_dhcp6_device_t **pos;
+
+	pos = &ni_dhcp6_device_name_hash[ni_dhcp6_device_name_bucket(dev->ifname)];
+	for (; *pos; pos = &(*pos)->name_next) {
+		if (*pos == dev) {
+			*pos = dev->name_next;
+			break;
+		}
+	}
+	dev->name_next = NULL;
+}
+
+static void
+ni_dhcp6_device_hash_insert(ni_dhcp6_device_t *dev)
+{
+	ni_dhcp6_device_t **bucket;
+
+	bucket = &ni_dhcp6_device_index_hash[ni_dhcp6_device_index_bucket(dev->link.ifindex)];
+	dev->index_next = *bucket;
+	*bucket = dev;
+
+	ni_dhcp6_device_name_hash_insert(dev);
+}
+
+static void
+ni_dhcp6_device_hash_remove(ni_dhcp6_device_t *dev)
+{
+	ni_dhcp6_device_t **pos;
+
+	pos = &ni_dhcp6_device_index_hash[ni_dhcp6_device_index_bucket(dev->link.ifindex)];
+	for (; *pos; pos = &(*pos)->index_next) {
+		if (*pos == dev) {
+			*pos = dev->index_next;
+			break;
+		}
+	}
+	dev->index_next = NULL;
+
+	ni_dhcp6_device_name_hash_remove(dev);
+}
+
 static void			ni_dhcp6_device_close(ni_dhcp6_device_t *);
 static void			ni_dhcp6_device_free(ni_dhcp6_device_t *);
 
@@ -112,6 +193,7 @@ ni_dhcp6_device_new(const char *ifname, const ni_linkinfo_t *link)
 
 	/* append to end of list */
 	*pos = dev;
+	ni_dhcp6_device_hash_insert(dev);
 
 	return dev;
 }
@@ -121,13 +203,27 @@ ni_dhcp6_device_by_index(unsigned int ifindex)
 {
 	ni_dhcp6_device_t *dev;
 
-	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
+	dev = ni_dhcp6_device_index_hash[ni_dhcp6_device_index_bucket(ifindex)];
+	for (; dev; dev = dev->index_next) {
 		if (dev->link.ifindex == ifindex)
 			return dev;
 	}
 	return NULL;
 }
 
+ni_dhcp6_device_t *
+ni_dhcp6_device_by_name(const char *ifname)
+{
+	ni_dhcp6_device_t *dev;
+
+	dev = ni_dhcp6_device_name_hash[ni_dhcp6_device_name_bucket(ifname)];
+	for (; dev; dev = dev->name_next) {
+		if (ni_string_eq(dev->ifname, ifname))
+			return dev;
+	}
+	return NULL;
+}
+
 /*
  * Refcount handling
  */
@@ -199,6 +295,7 @@ ni_dhcp6_device_free(ni_dhcp6_device_t *dev)
 	ni_debug_dhcp("%s: Deleting dhcp6 device with index %u",
 			dev->ifname, dev->link.ifindex);
 
+	ni_dhcp6_device_hash_remove(dev);
 	ni_buffer_destroy(&dev->message);
 	ni_dhcp6_device_drop_lease(dev);
 	ni_dhcp6_device_drop_best_offer(dev);
@@ -1102,7 +1199,9 @@ ni_dhcp6_device_event(ni_dhcp6_device_t *dev, ni_netdev_t *ifp, ni_event_t event
 		if (!ni_string_eq(dev->ifname, ifp->name)) {
 			ni_debug_dhcp("%s: Updating interface name to %s",
 					dev->ifname, ifp->name);
+			ni_dhcp6_device_name_hash_remove(dev);
 			ni_string_dup(&dev->ifname, ifp->name);
+			ni_dhcp6_device_name_hash_insert(dev);
 		}
 	break;
 	case NI_EVENT_DEVICE_DOWN:
@@ -1358,6 +1457,12 @@ ni_dhcp6_config_max_lease_time(void)
 	return ni_global.config->addrconf.dhcp6.lease_time;
 }
 
+ni_bool_t
+ni_dhcp6_config_shared_socket(void)
+{
+	return ni_global.config->addrconf.dhcp6.shared_socket;
+}
+
 unsigned int
 ni_dhcp6_config_release_nretries(const char *ifname)
 {
@@ -169,6 +169,8 @@ struct ni_dhcp6_config {
  */
 struct ni_dhcp6_device {
 	struct ni_dhcp6_device *next;
+	struct ni_dhcp6_device *index_next;	/* ifindex hash chain */
+	struct ni_dhcp6_device *name_next;	/* ifname hash chain */
 	unsigned int		users;
 
 	char *			ifname;		/* cached interface name	*/
@@ -232,11 +234,14 @@ struct ni_dhcp6_device {
 /*
  * -- device methods
  */
+extern ni_dhcp6_device_t *	ni_dhcp6_active;
+
 extern ni_dhcp6_device_t *	ni_dhcp6_device_new(const char *, const ni_linkinfo_t *);
 extern ni_dhcp6_device_t *	ni_dhcp6_device_get(ni_dhcp6_device_t *);
 extern void			ni_dhcp6_device_put(ni_dhcp6_device_t *);
 
 extern ni_dhcp6_device_t *	ni_dhcp6_device_by_index(unsigned int);
+extern ni_dhcp6_device_t *	ni_dhcp6_device_by_name(const char *);
 extern ni_dhcp6_device_t *	ni_dhcp6_device_by_index_show_all(unsigned int);
 
 extern void			ni_dhcp6_device_set_request(ni_dhcp6_device_t *, ni_dhcp6_request_t *);
@@ -35,6 +35,7 @@
 #include "dhcp6/protocol.h"
 #include "dhcp6/fsm.h"
 #include "duid.h"
+#include "trace.h"
 
 
 struct ni_dhcp6_message {
@@ -76,6 +77,16 @@ static void			ni_dhcp6_send_event(enum ni_dhcp6_event, const ni_dhcp6_device_t *
 static int			__fsm_parse_client_options(ni_dhcp6_device_t *, struct ni_dhcp6_message *, ni_buffer_t *);
 
 
+/*
+ * All state changes funnel through here, so the dhcp6_state USDT
+ * probe can reconstruct per-interface lease timelines.
+ */
+static inline void
+ni_dhcp6_fsm_set_state(ni_dhcp6_device_t *dev, unsigned int state)
+{
+	ni_tracepoint3(dhcp6_state, dev->link.ifindex, dev->fsm.state, state);
+	dev->fsm.state = state;
+}
 
 /*
  * How long to wait until an address is ready to use
@@ -150,7 +161,7 @@ ni_dhcp6_fsm_start(ni_dhcp6_device_t *dev)
 void
 ni_dhcp6_fsm_reset(ni_dhcp6_device_t *dev)
 {
-	dev->fsm.state = NI_DHCP6_STATE_INIT;
+	ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_INIT);
 
 	ni_dhcp6_fsm_timer_cancel(dev);
 	ni_dhcp6_device_retransmit_disarm(dev);
@@ -469,7 +480,8 @@ ni_dhcp6_fsm_timeout(ni_dhcp6_device_t *dev)
 }
 
 static inline ni_bool_t
-__fsm_select_best_offer(const ni_dhcp6_device_t *dev, const ni_addrconf_lease_t *lease, int pref, int weight)
+__fsm_select_best_offer(const ni_dhcp6_device_t *dev, const struct in6_addr *server_addr,
+			const ni_opaque_t *server_id, int pref, int weight)
 {
 	/* when we don't have any or this is a better offer, remember it */
 	if (dev->best_offer.lease == NULL || dev->best_offer.weight < weight)
@@ -495,8 +507,8 @@ __fsm_select_best_offer(const ni_dhcp6_device_t *dev, const ni_addrconf_lease_t
 	if (dev->lease && dev->lease->dhcp6.server_id.len > 0 &&
 	    !IN6_IS_ADDR_UNSPECIFIED(&dev->lease->dhcp6.server_addr)) {
 
-		if (IN6_ARE_ADDR_EQUAL(&dev->lease->dhcp6.server_addr, &lease->dhcp6.server_addr) ||
-		    ni_opaque_eq(&dev->lease->dhcp6.server_id, &lease->dhcp6.server_id))
+		if (IN6_ARE_ADDR_EQUAL(&dev->lease->dhcp6.server_addr, server_addr) ||
+		    ni_opaque_eq(&dev->lease->dhcp6.server_id, server_id))
 			return TRUE;
 	}
 	return FALSE;
@@ -505,6 +517,7 @@ __fsm_select_best_offer(const ni_dhcp6_device_t *dev, const ni_addrconf_lease_t
 static int
 __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, ni_buffer_t *opts, char **hint)
 {
+	ni_dhcp6_offer_scan_t scan;
 	unsigned int count;
 	int weight = 0;
 	int pref = 0;
@@ -512,11 +525,19 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 
 	switch (msg->type) {
 	case NI_DHCP6_ADVERTISE:
-		if (__fsm_parse_client_options(dev, msg, opts) < 0)
+		/* Scan the option buffer in place first; offers rejected
+		 * by the checks below never materialize a lease, only the
+		 * one we actually record is parsed. */
+		if (ni_dhcp6_scan_client_options(opts, &scan) < 0)
 			return -1;
 
+		if (scan.client_id.len == 0 || scan.server_id.len == 0 ||
+		    !ni_opaque_eq(&dev->config->client_duid, &scan.client_id)) {
+			ni_string_printf(hint, "client-id or server-id check failed");
+			goto cleanup;
+		}
 
-		if (msg->lease->dhcp6.rapid_commit) {
+		if (scan.rapid_commit) {
 			ni_string_printf(hint, "advertise with rapid commit option");
 			goto cleanup;
 		}
@@ -526,37 +547,30 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 		 * status NI_DHCP6_STATUS_NOADDRS; the another codes IMO
 		 * don't fit here ... simply discard all unsuccessful codes.
 		 */
-		if (msg->lease->dhcp6.status &&
-		    msg->lease->dhcp6.status->code != NI_DHCP6_STATUS_SUCCESS) {
+		if (scan.status_code != NI_DHCP6_STATUS_SUCCESS) {
+			ni_string_printf(hint, "status %s",
+				ni_dhcp6_status_name(scan.status_code));
+			goto cleanup;
+		}
+		if (scan.ia_noaddrs) {
 			ni_string_printf(hint, "status %s - %s",
-				ni_dhcp6_status_name(msg->lease->dhcp6.status->code),
-				msg->lease->dhcp6.status->message);
+				ni_dhcp6_status_name(NI_DHCP6_STATUS_NOADDRS),
+				"no addresses available");
 			goto cleanup;
-		} else {
-			ni_dhcp6_ia_t *ia;
-			for (ia = msg->lease->dhcp6.ia_list; ia; ia = ia->next) {
-				if (ia->status.code == NI_DHCP6_STATUS_NOADDRS) {
-					ni_string_printf(hint, "status %s - %s",
-						ni_dhcp6_status_name(ia->status.code),
-						ia->status.message ? ia->status.message :
-						"no addresses available");
-					goto cleanup;
-				}
-			}
 		}
 
 		/* check if the config provides/overrides the preference */
-		if (!ni_dhcp6_config_server_preference(	&msg->lease->dhcp6.server_addr,
-							&msg->lease->dhcp6.server_id,
+		if (!ni_dhcp6_config_server_preference(	&msg->sender,
+							&scan.server_id,
 							&pref)) {
-			pref = msg->lease->dhcp6.server_pref;
+			pref = scan.server_pref;
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
 					"%s: dhcp6 server preference %u",
-					dev->ifname, msg->lease->dhcp6.server_pref);
+					dev->ifname, scan.server_pref);
 		} else {
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
 					"%s: dhcp6 server preference %u overriden by config to %d",
-					dev->ifname, msg->lease->dhcp6.server_pref, pref);
+					dev->ifname, scan.server_pref, pref);
 		}
 		if (pref < 0) {
 			ni_string_printf(hint, "blacklisted server");
@@ -567,7 +581,7 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 		 * server forgot to set NI_DHCP6_STATUS_NOADDRS,
 		 * reset weight for offers without any lease addrs
 		 */
-		count = ni_address_list_count(msg->lease->addrs);
+		count = scan.addrs_usable;
 		if (count) {
 			weight += count;
 		} else {
@@ -575,7 +589,10 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 			goto cleanup;
 		}
 
-		if (__fsm_select_best_offer(dev, msg->lease, pref, weight)) {
+		if (__fsm_select_best_offer(dev, &msg->sender, &scan.server_id, pref, weight)) {
+			if (__fsm_parse_client_options(dev, msg, opts) < 0)
+				return -1;
+
 			ni_dhcp6_device_set_best_offer(dev, msg->lease, pref, weight);
 			msg->lease = NULL;
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
@@ -587,9 +604,14 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 			goto cleanup;
 		}
 
-		if (dev->best_offer.lease && dev->retrans.count > 0) {
-			/* if the weight has maximum value, just accept this offer */
-			if (dev->best_offer.pref > 254) {
+		if (dev->best_offer.lease) {
+			/*
+			 * RFC 3315, Section 17.1.2: an advertise with the
+			 * maximum preference of 255 terminates the wait
+			 * immediately; once the first RT has elapsed, any
+			 * acceptable advertise does.
+			 */
+			if (dev->best_offer.pref > 254 || dev->retrans.count > 0) {
 				ni_dhcp6_fsm_timer_cancel(dev);
 				rv = ni_dhcp6_fsm_accept_offer(dev);
 			} else {
@@ -664,7 +686,8 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 		}
 		weight += count;
 
-		if (__fsm_select_best_offer(dev, msg->lease, pref, weight)) {
+		if (__fsm_select_best_offer(dev, &msg->lease->dhcp6.server_addr,
+					&msg->lease->dhcp6.server_id, pref, weight)) {
 			ni_dhcp6_device_set_best_offer(dev, msg->lease, pref, weight);
 			msg->lease = NULL;
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
@@ -676,9 +699,14 @@ __fsm_select_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg, n
 			goto cleanup;
 		}
 
-		if (dev->best_offer.lease && dev->retrans.count > 0) {
-			/* if the weight has maximum value, just accept this offer */
-			if (dev->best_offer.pref > 254) {
+		if (dev->best_offer.lease) {
+			/*
+			 * RFC 3315, Section 17.1.2: an advertise with the
+			 * maximum preference of 255 terminates the wait
+			 * immediately; once the first RT has elapsed, any
+			 * acceptable advertise does.
+			 */
+			if (dev->best_offer.pref > 254 || dev->retrans.count > 0) {
 				ni_dhcp6_fsm_timer_cancel(dev);
 				rv = ni_dhcp6_fsm_accept_offer(dev);
 			} else {
@@ -1209,7 +1237,8 @@ __fsm_inforeq_process_msg(ni_dhcp6_device_t *dev, struct ni_dhcp6_message *msg,
 			weight = 0;
 		}
 
-		if(__fsm_select_best_offer(dev, msg->lease, pref, weight)) {
+		if(__fsm_select_best_offer(dev, &msg->lease->dhcp6.server_addr,
+					&msg->lease->dhcp6.server_id, pref, weight)) {
 			ni_dhcp6_device_set_best_offer(dev, msg->lease, pref, weight);
 			msg->lease = NULL;
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
@@ -1441,7 +1470,7 @@ ni_dhcp6_fsm_solicit(ni_dhcp6_device_t *dev)
 			dev->retrans.duration = deadline * 1000;
 		}
 
-		dev->fsm.state = NI_DHCP6_STATE_SELECTING;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_SELECTING);
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else {
 		if (dev->best_offer.lease && dev->best_offer.weight > 0) {
@@ -1494,7 +1523,7 @@ ni_dhcp6_fsm_request_lease(ni_dhcp6_device_t *dev, const ni_addrconf_lease_t *le
 		if (ni_dhcp6_init_message(dev, NI_DHCP6_REQUEST, lease) != 0)
 			return -1;
 
-		dev->fsm.state = NI_DHCP6_STATE_REQUESTING;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_REQUESTING);
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else {
 		ni_debug_dhcp("%s: Retransmitting DHCPv6 Lease Request",
@@ -1521,7 +1550,7 @@ ni_dhcp6_fsm_request_info(ni_dhcp6_device_t *dev)
 		if (ni_dhcp6_init_message(dev, NI_DHCP6_INFO_REQUEST, NULL) != 0)
 			return -1;
 
-		dev->fsm.state = NI_DHCP6_STATE_REQUESTING_INFO;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_REQUESTING_INFO);
 
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else
@@ -1555,7 +1584,7 @@ ni_dhcp6_fsm_confirm_lease(ni_dhcp6_device_t *dev, const ni_addrconf_lease_t *le
 		if (ni_dhcp6_init_message(dev, NI_DHCP6_CONFIRM, lease) != 0)
 			return -1;
 
-		dev->fsm.state = NI_DHCP6_STATE_CONFIRMING;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_CONFIRMING);
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else if (dev->fsm.state == NI_DHCP6_STATE_CONFIRMING) {
 
@@ -1601,7 +1630,7 @@ ni_dhcp6_fsm_renew(ni_dhcp6_device_t *dev)
 			return -1;
 
 		dev->retrans.duration = deadline * 1000;
-		dev->fsm.state = NI_DHCP6_STATE_RENEWING;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_RENEWING);
 
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else {
@@ -1655,7 +1684,7 @@ ni_dhcp6_fsm_rebind(ni_dhcp6_device_t *dev)
 		if (ni_dhcp6_init_message(dev, NI_DHCP6_REBIND, dev->lease) != 0)
 			return -1;
 
-		dev->fsm.state = NI_DHCP6_STATE_REBINDING;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_REBINDING);
 		dev->retrans.duration = deadline * 1000;
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else {
@@ -1736,7 +1765,7 @@ ni_dhcp6_fsm_decline(ni_dhcp6_device_t *dev)
 		if (ni_dhcp6_init_message(dev, NI_DHCP6_DECLINE, dev->lease) != 0)
 			return -1;
 
-		dev->fsm.state = NI_DHCP6_STATE_DECLINING;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_DECLINING);
 		rv = ni_dhcp6_device_transmit_init(dev);
 	} else {
 		if (!ni_dhcp6_fsm_decline_info(dev, dev->lease->dhcp6.ia_list,
@@ -1770,7 +1799,7 @@ __ni_dhcp6_fsm_release(ni_dhcp6_device_t *dev, unsigned int nretries)
 		if (ni_dhcp6_init_message(dev, NI_DHCP6_RELEASE, dev->lease) != 0)
 			return -1;
 
-		dev->fsm.state = NI_DHCP6_STATE_RELEASING;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_RELEASING);
 		if (nretries < (unsigned int)dev->retrans.params.nretries)
 			dev->retrans.params.nretries = nretries;
 		rv = ni_dhcp6_device_transmit_init(dev);
@@ -1904,10 +1933,10 @@ ni_dhcp6_fsm_commit_lease(ni_dhcp6_device_t *dev, ni_addrconf_lease_t *lease)
 			ni_dhcp6_device_drop_lease(dev);
 			ni_dhcp6_device_stop(dev);
 		} else if (dev->config->mode == NI_DHCP6_MODE_INFO) {
-			dev->fsm.state = NI_DHCP6_STATE_BOUND;
+			ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_BOUND);
 			ni_dhcp6_fsm_bound(dev);
 		} else {
-			dev->fsm.state = NI_DHCP6_STATE_VALIDATING;
+			ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_VALIDATING);
 			ni_dhcp6_fsm_set_timeout_msec(dev, NI_DHCP6_WAIT_IAADDR_READY);
 		}
 
@@ -1940,7 +1969,7 @@ ni_dhcp6_fsm_bound_info(ni_dhcp6_device_t *dev)
 	unsigned int refresh;
 	struct timeval now;
 
-	dev->fsm.state = NI_DHCP6_STATE_BOUND;
+	ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_BOUND);
 
 	refresh = ni_dhcp6_config_info_refresh_time(dev->ifname, &range);
 	if (dev->lease->dhcp6.info_refresh) {
@@ -1984,7 +2013,7 @@ ni_dhcp6_fsm_bound(ni_dhcp6_device_t *dev)
 
 	timeout = ni_dhcp6_fsm_get_renewal_timeout(dev);
 	if (timeout > 0) {
-		dev->fsm.state = NI_DHCP6_STATE_BOUND;
+		ni_dhcp6_fsm_set_state(dev, NI_DHCP6_STATE_BOUND);
 
 		if (timeout == NI_DHCP6_INFINITE_LIFETIME) {
 			/* Hmm... */
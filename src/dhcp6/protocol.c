@@ -72,6 +72,13 @@
  */
 #define NI_DHCP6_OPTION_REQUEST_CHUNK	16
 
+/*
+ * Receive buffer of the shared socket; it carries the replies for all
+ * devices, so size it for a concurrent solicit burst rather than for
+ * a single interface.
+ */
+#define NI_DHCP6_SHARED_RCVBUF		(1024 * 1024)
+
 
 //extern int	ni_dhcp6_device_retransmit(ni_dhcp6_device_t *dev);
 
@@ -82,6 +89,17 @@ static int	ni_dhcp6_process_packet		(ni_dhcp6_device_t *dev, ni_buffer_t *msgbuf
 static int	ni_dhcp6_socket_get_timeout	(const ni_socket_t *sock, struct timeval *tv);
 static void	ni_dhcp6_socket_check_timeout	(ni_socket_t *sock, const struct timeval *now);
 
+static int	ni_dhcp6_shared_socket_get_timeout(const ni_socket_t *sock, struct timeval *tv);
+static void	ni_dhcp6_shared_socket_check_timeout(ni_socket_t *sock, const struct timeval *now);
+
+/*
+ * In shared-socket mode all devices receive through one unbound socket
+ * and the packets are demultiplexed by the arrival interface reported
+ * via IPV6_RECVPKTINFO, instead of one socket + poll entry per device.
+ */
+static ni_socket_t *	ni_dhcp6_shared_sock;
+static unsigned int	ni_dhcp6_shared_users;
+
 static int	ni_dhcp6_option_next(ni_buffer_t *options, ni_buffer_t *optbuf);
 static int	ni_dhcp6_option_get_duid(ni_buffer_t *bp, ni_opaque_t *duid);
 
@@ -162,6 +180,52 @@ __ni_dhcp6_mcast_socket_open(const struct ni_dhcp6_link *link, const char *ifnam
 	return fd;
 }
 
+/*
+ * Open the shared socket bound to the any address and dhcp6 client port;
+ * the outgoing interface is selected per send via the multicast scope-id
+ * in the destination address.
+ */
+static int
+__ni_dhcp6_shared_socket_open(void)
+{
+	ni_sockaddr_t saddr;
+	int fd, on, rcvbuf;
+
+	if ((fd = socket (PF_INET6, SOCK_DGRAM, IPPROTO_UDP)) == -1) {
+		ni_error("dhcp6: Cannot open socket(INET6, DGRAM, UDP): %m");
+		return -1;
+	}
+
+	on = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1)
+		ni_error("dhcp6: Cannot set setsockopt(SO_REUSEADDR): %m");
+#if defined(SO_REUSEPORT)
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1)
+		ni_error("dhcp6: Cannot set setsockopt(SO_REUSEPORT): %m");
+#endif
+	rcvbuf = NI_DHCP6_SHARED_RCVBUF;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) == -1)
+		ni_error("dhcp6: Cannot set setsockopt(SO_RCVBUF): %m");
+
+	if (setsockopt(fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on)) != 0)
+		ni_error("dhcp6: Cannot set setsockopt(IPV6_RECVPKTINFO): %m");
+
+	if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+		ni_error("dhcp6: Cannot set fcntl(SETDF, CLOEXEC): %m");
+
+	ni_sockaddr_set_ipv6(&saddr, in6addr_any, NI_DHCP6_CLIENT_PORT);
+	if (bind(fd, &saddr.sa, sizeof(saddr.six)) == -1) {
+		ni_error("dhcp6: Cannot bind(%s): %m", ni_sockaddr_print(&saddr));
+		close(fd);
+		return -1;
+	}
+
+	ni_debug_dhcp("dhcp6: bound shared DHCPv6 socket to [%s]:%u",
+		ni_sockaddr_print(&saddr), ntohs(saddr.six.sin6_port));
+
+	return fd;
+}
+
 /*
  * Open a DHCP6 socket for send and receive
  */
@@ -203,12 +267,41 @@ ni_dhcp6_mcast_socket_open(ni_dhcp6_device_t *dev)
 	dev->mcast.dest.six.sin6_port = htons(NI_DHCP6_SERVER_PORT);
 	dev->mcast.dest.six.sin6_scope_id = dev->link.ifindex;
 
+	if (ni_dhcp6_config_shared_socket()) {
+		if (ni_dhcp6_shared_sock == NULL) {
+			if ((fd = __ni_dhcp6_shared_socket_open()) == -1)
+				return -1;
+
+			if (!(ni_dhcp6_shared_sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+				ni_error("%s: Unable to prepare shared DHCPv6 socket",
+					dev->ifname);
+				close(fd);
+				return -1;
+			}
+			ni_dhcp6_shared_sock->priority = NI_SOCKET_PRIO_PROTOCOL;
+			ni_dhcp6_shared_sock->user_data = NULL;
+			ni_dhcp6_shared_sock->receive = ni_dhcp6_socket_recv;
+			ni_dhcp6_shared_sock->get_timeout = ni_dhcp6_shared_socket_get_timeout;
+			ni_dhcp6_shared_sock->check_timeout = ni_dhcp6_shared_socket_check_timeout;
+
+			/* See rfc2460#section-5, Packet Size Issues. Allocate max buffer */
+			ni_buffer_init_dynamic(&ni_dhcp6_shared_sock->rbuf, NI_DHCP6_RBUF_SIZE);
+
+			ni_socket_activate(ni_dhcp6_shared_sock);
+		}
+
+		dev->mcast.sock = ni_socket_hold(ni_dhcp6_shared_sock);
+		ni_dhcp6_shared_users++;
+		return 0;
+	}
+
 	/* open the socket an bind to the link-local address */
 	if ((fd = __ni_dhcp6_mcast_socket_open(&dev->link, dev->ifname)) == -1)
 		return -1;
 
 	/* finally wrap it and allocate receive buffer */
 	if ((dev->mcast.sock = ni_socket_wrap(fd, SOCK_DGRAM)) != NULL) {
+		dev->mcast.sock->priority = NI_SOCKET_PRIO_PROTOCOL;
 		dev->mcast.sock->user_data = dev;
 		dev->mcast.sock->receive = ni_dhcp6_socket_recv;
 		dev->mcast.sock->get_timeout = ni_dhcp6_socket_get_timeout;
@@ -230,8 +323,17 @@ ni_dhcp6_mcast_socket_open(ni_dhcp6_device_t *dev)
 void
 ni_dhcp6_mcast_socket_close(ni_dhcp6_device_t *dev)
 {
-	if (dev->mcast.sock)
-		ni_socket_close(dev->mcast.sock);
+	if (dev->mcast.sock) {
+		if (dev->mcast.sock == ni_dhcp6_shared_sock) {
+			ni_socket_release(dev->mcast.sock);
+			if (--ni_dhcp6_shared_users == 0) {
+				ni_socket_close(ni_dhcp6_shared_sock);
+				ni_dhcp6_shared_sock = NULL;
+			}
+		} else {
+			ni_socket_close(dev->mcast.sock);
+		}
+	}
 	dev->mcast.sock = NULL;
 	memset(&dev->mcast.dest, 0, sizeof(dev->mcast.dest));
 }
@@ -239,15 +341,16 @@ ni_dhcp6_mcast_socket_close(ni_dhcp6_device_t *dev)
 ssize_t
 ni_dhcp6_socket_send(ni_socket_t *sock, const ni_buffer_t *mesg, const ni_sockaddr_t *dest)
 {
+	struct iovec iov[NI_BUFFER_CHAIN_MAXVEC];
+	struct msghdr msg;
 	int flags = 0;
-	size_t cnt;
 
 	if (!sock) {
 		errno = ENOTSOCK;
 		return -1;
 	}
 
-	if (!mesg || !(cnt = ni_buffer_count(mesg))) {
+	if (!mesg || !ni_buffer_chain_count(mesg)) {
 		errno = EBADMSG;
 		return -1;
 	}
@@ -261,8 +364,16 @@ ni_dhcp6_socket_send(ni_socket_t *sock, const ni_buffer_t *mesg, const ni_sockad
 	    ni_sockaddr_is_ipv6_linklocal(dest))
 		flags |= MSG_DONTROUTE;
 
-	return sendto(sock->__fd, ni_buffer_head(mesg), cnt,
-			flags, &dest->sa, sizeof(dest->six));
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = (void *) &dest->sa;
+	msg.msg_namelen = sizeof(dest->six);
+	msg.msg_iov = iov;
+	if (!(msg.msg_iovlen = ni_buffer_chain_iovec(mesg, iov, NI_BUFFER_CHAIN_MAXVEC))) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	return sendmsg(sock->__fd, &msg, flags);
 }
 
 
@@ -312,13 +423,13 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 	if(bytes < 0) {
 		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
 			ni_error("%s: recvmsg error on socket %d: %m",
-				dev->ifname, sock->__fd);
+				dev ? dev->ifname : "dhcp6", sock->__fd);
 			ni_socket_deactivate(sock);
 		}
 		return;
 	} else if (bytes == 0) {
 		ni_error("%s: recvmsg didn't returned any data on socket %d",
-			dev->ifname, sock->__fd);
+			dev ? dev->ifname : "dhcp6", sock->__fd);
 		return;
 	}
 
@@ -332,9 +443,17 @@ ni_dhcp6_socket_recv(ni_socket_t *sock)
 
 	if (pinfo == NULL) {
 		ni_error("%s: discarding packet without packet info on socket %d",
-			dev->ifname, sock->__fd);
+			dev ? dev->ifname : "dhcp6", sock->__fd);
 		return;
 	}
+	if (dev == NULL) {
+		/* shared socket: demultiplex by the arrival interface */
+		if (!(dev = ni_dhcp6_device_by_index(pinfo->ipi6_ifindex))) {
+			ni_debug_dhcp("dhcp6: discarding packet for unmanaged"
+				" interface index %u", pinfo->ipi6_ifindex);
+			return;
+		}
+	} else
 	if(dev->link.ifindex != pinfo->ipi6_ifindex) {
 		ni_error("%s: discarding packet with interface index %u instead %u",
 			dev->ifname, pinfo->ipi6_ifindex, dev->link.ifindex);
@@ -487,6 +606,40 @@ ni_dhcp6_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
 	}
 }
 
+/*
+ * The shared socket carries no device object; scan all devices
+ * attached to it for the nearest retransmit deadline instead.
+ */
+static int
+ni_dhcp6_shared_socket_get_timeout(const ni_socket_t *sock, struct timeval *tv)
+{
+	const ni_dhcp6_device_t *dev;
+
+	timerclear(tv);
+	for (dev = ni_dhcp6_active; dev; dev = dev->next) {
+		if (dev->mcast.sock != sock || !timerisset(&dev->retrans.deadline))
+			continue;
+		if (!timerisset(tv) || timercmp(&dev->retrans.deadline, tv, <))
+			*tv = dev->retrans.deadline;
+	}
+	return timerisset(tv) ? 0 : -1;
+}
+
+static void
+ni_dhcp6_shared_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
+{
+	ni_dhcp6_device_t *dev, *next;
+
+	for (dev = ni_dhcp6_active; dev; dev = next) {
+		next = dev->next;
+		if (dev->mcast.sock != sock)
+			continue;
+		if (timerisset(&dev->retrans.deadline) &&
+		    timercmp(&dev->retrans.deadline, now, <))
+			ni_dhcp6_device_retransmit(dev);
+	}
+}
+
 /*
  * Inline functions for setting/retrieving options from a buffer
  */
@@ -2730,6 +2883,164 @@ ni_dhcp6_ia_copy_to_lease_addrs(const ni_dhcp6_device_t *dev, ni_addrconf_lease_
 	return count;
 }
 
+/*
+ * Allocation-free scan of the few facts the advertise selection in the
+ * fsm needs to score or reject an offer. The walker runs a private
+ * cursor over the receive buffer and reads the option bodies in place,
+ * so the buffer remains intact and the winning offer can still be
+ * parsed into a lease afterwards -- rejected advertisements never
+ * materialize any ia/address objects at all.
+ */
+static int
+ni_dhcp6_option_scan_ia_addr(ni_buffer_t *bp, unsigned int ia_type, unsigned int *usable)
+{
+	ni_dhcp6_ia_addr_t iadr;
+	uint16_t status = NI_DHCP6_STATUS_SUCCESS;
+	ni_buffer_t optbuf;
+	uint8_t value8;
+	int option;
+
+	memset(&iadr, 0, sizeof(iadr));
+	if (ia_type == NI_DHCP6_OPTION_IA_PD) {
+		if (ni_dhcp6_option_get32(bp, &iadr.preferred_lft) < 0 ||
+		    ni_dhcp6_option_get32(bp, &iadr.valid_lft) < 0 ||
+		    ni_dhcp6_option_get8(bp, &value8) < 0 ||
+		    ni_dhcp6_option_get_ipv6(bp, &iadr.addr) < 0)
+			return -1;
+		iadr.plen = value8;
+	} else {
+		if (ni_dhcp6_option_get_ipv6(bp, &iadr.addr) < 0 ||
+		    ni_dhcp6_option_get32(bp, &iadr.preferred_lft) < 0 ||
+		    ni_dhcp6_option_get32(bp, &iadr.valid_lft) < 0)
+			return -1;
+	}
+
+	while (ni_buffer_count(bp) && !bp->underflow) {
+		if ((option = ni_dhcp6_option_next(bp, &optbuf)) < 0)
+			return -1;
+		if (option == 0)
+			break;
+
+		if (option == NI_DHCP6_OPTION_STATUS_CODE) {
+			if (ni_dhcp6_option_get16(&optbuf, &status) < 0)
+				return -1;
+		}
+		ni_buffer_pull_head(&optbuf, ni_buffer_count(&optbuf));
+	}
+
+	/* mirror the checks applied when materializing the address */
+	if (status != NI_DHCP6_STATUS_SUCCESS)
+		return 0;
+	if (iadr.preferred_lft > iadr.valid_lft)
+		return 0;
+	if (ni_dhcp6_ia_addr_is_usable(&iadr))
+		(*usable)++;
+	return 0;
+}
+
+static int
+ni_dhcp6_option_scan_ia(ni_buffer_t *bp, unsigned int ia_type, ni_dhcp6_offer_scan_t *scan)
+{
+	uint32_t iaid, t1 = 0, t2 = 0;
+	uint16_t status = NI_DHCP6_STATUS_SUCCESS;
+	unsigned int usable = 0;
+	ni_buffer_t optbuf;
+	int option;
+
+	if (ni_dhcp6_option_get32(bp, &iaid) < 0)
+		return -1;
+	if (ia_type != NI_DHCP6_OPTION_IA_TA) {
+		if (ni_dhcp6_option_get32(bp, &t1) < 0 ||
+		    ni_dhcp6_option_get32(bp, &t2) < 0)
+			return -1;
+	}
+
+	while (ni_buffer_count(bp) && !bp->underflow) {
+		if ((option = ni_dhcp6_option_next(bp, &optbuf)) < 0)
+			return -1;
+		if (option == 0)
+			break;
+
+		switch (option) {
+		case NI_DHCP6_OPTION_STATUS_CODE:
+			if (ni_dhcp6_option_get16(&optbuf, &status) < 0)
+				return -1;
+		break;
+
+		case NI_DHCP6_OPTION_IA_ADDRESS:
+			if (ia_type == NI_DHCP6_OPTION_IA_PD)
+				break;
+			if (ni_dhcp6_option_scan_ia_addr(&optbuf, ia_type, &usable) < 0)
+				return -1;
+		break;
+
+		default:
+		break;
+		}
+		ni_buffer_pull_head(&optbuf, ni_buffer_count(&optbuf));
+	}
+
+	/* an ia with invalid times is discarded by the parser, including
+	 * its status code -- mirror that here */
+	if (t1 && t2 && t1 > t2)
+		return 0;
+
+	if (status == NI_DHCP6_STATUS_NOADDRS)
+		scan->ia_noaddrs = TRUE;
+
+	if (ia_type != NI_DHCP6_OPTION_IA_PD && status == NI_DHCP6_STATUS_SUCCESS)
+		scan->addrs_usable += usable;
+	return 0;
+}
+
+int
+ni_dhcp6_scan_client_options(const ni_buffer_t *buffer, ni_dhcp6_offer_scan_t *scan)
+{
+	ni_buffer_t opts = *buffer;	/* private cursor, buffer stays unread */
+	ni_buffer_t optbuf;
+	int option;
+
+	memset(scan, 0, sizeof(*scan));
+	scan->status_code = NI_DHCP6_STATUS_SUCCESS;
+
+	while (ni_buffer_count(&opts) && !opts.underflow) {
+		option = ni_dhcp6_option_next(&opts, &optbuf);
+		if (option < 0)
+			return -1;
+		if (option == 0)
+			break;
+
+		switch (option) {
+		case NI_DHCP6_OPTION_CLIENTID:
+			ni_dhcp6_option_get_duid(&optbuf, &scan->client_id);
+		break;
+		case NI_DHCP6_OPTION_SERVERID:
+			ni_dhcp6_option_get_duid(&optbuf, &scan->server_id);
+		break;
+		case NI_DHCP6_OPTION_PREFERENCE:
+			ni_dhcp6_option_get8(&optbuf, &scan->server_pref);
+		break;
+		case NI_DHCP6_OPTION_RAPID_COMMIT:
+			if (ni_buffer_count(&optbuf) == 0)
+				scan->rapid_commit = TRUE;
+		break;
+		case NI_DHCP6_OPTION_STATUS_CODE:
+			if (ni_dhcp6_option_get16(&optbuf, &scan->status_code) < 0)
+				return -1;
+		break;
+		case NI_DHCP6_OPTION_IA_NA:
+		case NI_DHCP6_OPTION_IA_TA:
+		case NI_DHCP6_OPTION_IA_PD:
+			if (ni_dhcp6_option_scan_ia(&optbuf, option, scan) < 0)
+				return -1;
+		break;
+		default:
+		break;
+		}
+	}
+	return 0;
+}
+
 static int
 __ni_dhcp6_parse_client_options(ni_dhcp6_device_t *dev, ni_buffer_t *buffer, ni_addrconf_lease_t *lease, ni_bool_t request)
 {
@@ -243,6 +243,23 @@ extern int		ni_dhcp6_parse_client_header(ni_buffer_t *msgbuf,
 extern int		ni_dhcp6_parse_client_options(ni_dhcp6_device_t *dev, ni_buffer_t *buffer,
 							ni_addrconf_lease_t *lease);
 
+/*
+ * Allocation-free view of the selection-relevant facts of an
+ * advertise message, extracted directly from the receive buffer.
+ */
+typedef struct ni_dhcp6_offer_scan {
+	ni_opaque_t		client_id;
+	ni_opaque_t		server_id;
+	uint8_t			server_pref;
+	uint16_t		status_code;
+	ni_bool_t		rapid_commit;
+	ni_bool_t		ia_noaddrs;
+	unsigned int		addrs_usable;
+} ni_dhcp6_offer_scan_t;
+
+extern int		ni_dhcp6_scan_client_options(const ni_buffer_t *buffer,
+							ni_dhcp6_offer_scan_t *scan);
+
 extern int		ni_dhcp6_check_client_header(ni_dhcp6_device_t *dev, const struct in6_addr *sender,
 							unsigned int msg_type, unsigned int msg_xid);
 
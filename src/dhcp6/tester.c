@@ -32,6 +32,7 @@
 #include <limits.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include <net/if_arp.h>
 
 #include <wicked/types.h>
@@ -46,11 +47,30 @@
 #include "duid.h"
 #include "appconfig.h"
 #include "netinfo_priv.h"
+#include "util_priv.h"
 
 /* TODO: get rid of these static things */
 static ni_dhcp6_tester_t	dhcp6_tester_opts;
 static int			dhcp6_tester_status;
 
+/*
+ * Load generation mode: N virtual clients with distinct DUIDs
+ * and xids racing over the same interface, to measure acquisition
+ * latency distribution and sustained acquisitions per second.
+ */
+typedef struct ni_dhcp6_tester_client {
+	ni_dhcp6_device_t *	dev;
+	struct timeval		started;
+	struct timeval		acquired;
+	ni_bool_t		done;
+	ni_bool_t		granted;
+} ni_dhcp6_tester_client_t;
+
+static ni_dhcp6_tester_client_t *dhcp6_tester_clients;
+static unsigned int		dhcp6_tester_nclients;
+static unsigned int		dhcp6_tester_nfinished;
+static unsigned int		dhcp6_tester_ngranted;
+
 ni_dhcp6_tester_t *
 ni_dhcp6_tester_init(void)
 {
@@ -69,11 +89,48 @@ ni_dhcp6_tester_set_outfmt(const char *outfmt, unsigned int *type)
 		{ "lease-xml",	NI_DHCP6_TESTER_OUT_LEASE_XML  },
 		{ "leaseinfo",	NI_DHCP6_TESTER_OUT_LEASE_INFO },
 		{ "info",	NI_DHCP6_TESTER_OUT_LEASE_INFO },
+		{ "leaseinfo-json", NI_DHCP6_TESTER_OUT_LEASE_JSON },
+		{ "json",	NI_DHCP6_TESTER_OUT_LEASE_JSON },
 		{ NULL,		NI_DHCP6_TESTER_OUT_LEASE_INFO },
 	};
 	return ni_parse_uint_mapped(outfmt, __outfmt_map, type) == 0;
 }
 
+static void
+ni_dhcp6_tester_client_event(enum ni_dhcp6_event ev, const ni_dhcp6_device_t *dev,
+				ni_addrconf_lease_t *lease)
+{
+	unsigned int i;
+
+	for (i = 0; i < dhcp6_tester_nclients; ++i) {
+		ni_dhcp6_tester_client_t *client = &dhcp6_tester_clients[i];
+
+		if (client->dev != dev || client->done)
+			continue;
+
+		switch (ev) {
+		case NI_DHCP6_EVENT_ACQUIRED:
+			if (!lease || lease->state != NI_ADDRCONF_STATE_GRANTED)
+				return;
+			ni_timer_get_time(&client->acquired);
+			client->granted = TRUE;
+			client->done = TRUE;
+			dhcp6_tester_ngranted++;
+			dhcp6_tester_nfinished++;
+			break;
+
+		case NI_DHCP6_EVENT_LOST:
+			client->done = TRUE;
+			dhcp6_tester_nfinished++;
+			break;
+
+		default:
+			break;
+		}
+		return;
+	}
+}
+
 static void
 ni_dhcp6_tester_protocol_event(enum ni_dhcp6_event ev, const ni_dhcp6_device_t *dev,
 				ni_addrconf_lease_t *lease)
@@ -82,6 +139,11 @@ ni_dhcp6_tester_protocol_event(enum ni_dhcp6_event ev, const ni_dhcp6_device_t *
 			dev->ifname, dev->link.ifindex,
 			dev->config ? ni_uuid_print(&dev->config->uuid) : "<none>");
 
+	if (dhcp6_tester_nclients) {
+		ni_dhcp6_tester_client_event(ev, dev, lease);
+		return;
+	}
+
 	switch (ev) {
 	case NI_DHCP6_EVENT_ACQUIRED:
 		if (lease && lease->state == NI_ADDRCONF_STATE_GRANTED) {
@@ -107,6 +169,9 @@ ni_dhcp6_tester_protocol_event(enum ni_dhcp6_event ev, const ni_dhcp6_device_t *
 				}
 				xml_node_print(xml, fp);
 				xml_node_free(xml);
+			} else
+			if (dhcp6_tester_opts.outfmt == NI_DHCP6_TESTER_OUT_LEASE_JSON) {
+				ni_leaseinfo_json_dump(fp, lease, dev->ifname, NULL);
 			} else {
 				ni_leaseinfo_dump(fp, lease, dev->ifname, NULL);
 			}
@@ -246,6 +311,143 @@ ni_dhcp6_tester_req_init(ni_dhcp6_request_t *req, const char *request)
 	return TRUE;
 }
 
+static unsigned long
+ni_dhcp6_tester_timeval_msec(const struct timeval *beg, const struct timeval *end)
+{
+	struct timeval dif;
+
+	timersub(end, beg, &dif);
+	return dif.tv_sec * 1000 + dif.tv_usec / 1000;
+}
+
+static int
+ni_dhcp6_tester_latency_cmp(const void *a, const void *b)
+{
+	unsigned long la = *(const unsigned long *) a;
+	unsigned long lb = *(const unsigned long *) b;
+
+	return la < lb ? -1 : (la > lb ? 1 : 0);
+}
+
+static int
+ni_dhcp6_tester_spawn_clients(ni_dhcp6_device_t *dev, const ni_dhcp6_request_t *req,
+		unsigned int count)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *ifp;
+	unsigned int i;
+	int rv;
+
+	if (!nc || !(ifp = ni_netdev_by_index(nc, dev->link.ifindex)))
+		return -1;
+
+	dhcp6_tester_clients = xcalloc(count, sizeof(*dhcp6_tester_clients));
+	dhcp6_tester_nclients = count;
+
+	for (i = 0; i < count; ++i) {
+		ni_dhcp6_tester_client_t *client = &dhcp6_tester_clients[i];
+		ni_dhcp6_request_t *creq;
+		ni_dhcp6_device_t *cdev;
+		char *errdetail = NULL;
+		char clientid[48];
+
+		if (i == 0) {
+			cdev = dev;
+		} else
+		if (!(cdev = ni_dhcp6_device_new(ifp->name, &ifp->link))) {
+			ni_error("%s: cannot allocate dhcp6 client %u", ifp->name, i);
+			return -1;
+		}
+
+		if (!(creq = ni_dhcp6_request_new()))
+			return -1;
+
+		creq->update = req->update;
+		creq->dry_run = req->dry_run;
+		creq->mode = req->mode;
+		creq->rapid_commit = req->rapid_commit;
+		creq->acquire_timeout = req->acquire_timeout;
+		creq->lease_time = req->lease_time;
+		ni_uuid_generate(&creq->uuid);
+
+		/* Each virtual client gets a distinct DUID-LL built from
+		 * a locally administered MAC; the server hands out one
+		 * lease per client DUID. No lease recovery or release,
+		 * we only measure the acquisition.
+		 */
+		snprintf(clientid, sizeof(clientid), "00:03:00:01:02:00:00:%02x:%02x:%02x",
+				(i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+		ni_string_dup(&creq->clientid, clientid);
+		creq->recover_lease = FALSE;
+		creq->release_lease = FALSE;
+
+		client->dev = cdev;
+		ni_timer_get_time(&client->started);
+		rv = ni_dhcp6_acquire(cdev, creq, &errdetail);
+		ni_dhcp6_request_free(creq);
+		if (rv < 0) {
+			ni_error("%s: acquire request for client %u failed: %s%s[%s]",
+					cdev->ifname, i,
+					(errdetail ? errdetail : ""),
+					(errdetail ? " " : ""),
+					ni_strerror(rv));
+			ni_string_free(&errdetail);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void
+ni_dhcp6_tester_report_clients(const struct timeval *started)
+{
+	FILE *fp = stdout;
+	unsigned long *lat, total = 0, elapsed;
+	struct timeval last = *started;
+	unsigned int i, n = 0;
+
+	lat = xcalloc(dhcp6_tester_nclients, sizeof(*lat));
+	for (i = 0; i < dhcp6_tester_nclients; ++i) {
+		ni_dhcp6_tester_client_t *client = &dhcp6_tester_clients[i];
+
+		if (!client->granted)
+			continue;
+
+		lat[n++] = ni_dhcp6_tester_timeval_msec(&client->started,
+							&client->acquired);
+		total += lat[n - 1];
+		if (timercmp(&client->acquired, &last, >))
+			last = client->acquired;
+	}
+
+	if (dhcp6_tester_opts.output != NULL) {
+		if (!(fp = fopen(dhcp6_tester_opts.output, "w"))) {
+			ni_error("Cannot open %s for output", dhcp6_tester_opts.output);
+			fp = stdout;
+		}
+	}
+
+	fprintf(fp, "clients: %u\n", dhcp6_tester_nclients);
+	fprintf(fp, "acquired: %u\n", n);
+	fprintf(fp, "failed: %u\n", dhcp6_tester_nclients - n);
+	if (n) {
+		qsort(lat, n, sizeof(*lat), ni_dhcp6_tester_latency_cmp);
+		elapsed = ni_dhcp6_tester_timeval_msec(started, &last);
+		fprintf(fp, "elapsed: %lu.%03lu sec\n", elapsed / 1000, elapsed % 1000);
+		fprintf(fp, "rate: %.2f acquisitions/sec\n", elapsed ?
+				(double) n * 1000.0 / (double) elapsed : (double) n);
+		fprintf(fp, "latency min/avg/max: %lu/%lu/%lu msec\n",
+				lat[0], total / n, lat[n - 1]);
+		fprintf(fp, "latency p50/p90/p99: %lu/%lu/%lu msec\n",
+				lat[(n - 1) * 50 / 100], lat[(n - 1) * 90 / 100],
+				lat[(n - 1) * 99 / 100]);
+	}
+	fflush(fp);
+	if (fp != stdout)
+		fclose(fp);
+	free(lat);
+}
+
 int
 ni_dhcp6_tester_run(ni_dhcp6_tester_t *opts)
 {
@@ -255,6 +457,7 @@ ni_dhcp6_tester_run(ni_dhcp6_tester_t *opts)
 	ni_dhcp6_request_t *req = NULL;
 	unsigned int link_timeout = 20;
 	char *errdetail = NULL;
+	struct timeval started;
 	int rv;
 
 	if (opts->timeout && opts->timeout != -1U) {
@@ -341,6 +544,11 @@ ni_dhcp6_tester_run(ni_dhcp6_tester_t *opts)
 	if (opts->timeout && opts->timeout != -1U)
 		req->acquire_timeout = opts->timeout;
 
+	ni_timer_get_time(&started);
+	if (opts->clients > 1) {
+		if (ni_dhcp6_tester_spawn_clients(dev, req, opts->clients) < 0)
+			goto failure;
+	} else
 	if ((rv = ni_dhcp6_acquire(dev, req, &errdetail)) < 0) {
 		ni_error("%s: DHCPv6 acquire request %s failed: %s%s[%s]",
 				dev->ifname, ni_uuid_print(&req->uuid),
@@ -355,6 +563,10 @@ ni_dhcp6_tester_run(ni_dhcp6_tester_t *opts)
 	while (!ni_caught_terminal_signal()) {
 		long timeout;
 
+		if (dhcp6_tester_nclients &&
+		    dhcp6_tester_nfinished >= dhcp6_tester_nclients)
+			break;
+
 		timeout = ni_timer_next_timeout();
 		if (dev->config && dev->config->mode == NI_DHCP6_MODE_AUTO) {
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_DHCP,
@@ -377,6 +589,12 @@ ni_dhcp6_tester_run(ni_dhcp6_tester_t *opts)
 	ni_server_deactivate_interface_events();
 	ni_socket_deactivate_all();
 
+	if (dhcp6_tester_nclients) {
+		ni_dhcp6_tester_report_clients(&started);
+		dhcp6_tester_status = dhcp6_tester_ngranted == dhcp6_tester_nclients ?
+				NI_WICKED_RC_SUCCESS : NI_WICKED_RC_ERROR;
+	}
+
 failure:
 	if (dev)
 		ni_dhcp6_device_put(dev);
@@ -27,6 +27,7 @@
 
 enum {
 	NI_DHCP6_TESTER_OUT_LEASE_INFO,
+	NI_DHCP6_TESTER_OUT_LEASE_JSON,
 	NI_DHCP6_TESTER_OUT_LEASE_XML,
 };
 
@@ -37,6 +38,7 @@ typedef struct ni_dhcp6_tester {
 	const char *	output;
 	unsigned int	outfmt;
 	ni_dhcp6_mode_t	mode;
+	unsigned int	clients;
 } ni_dhcp6_tester_t;
 
 extern ni_dhcp6_tester_t *	ni_dhcp6_tester_init(void);
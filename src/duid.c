@@ -71,6 +71,51 @@ struct ni_duid_map {
 	struct flock	flock;
 };
 
+/*
+ * Process-wide cache of the parsed duid map.
+ *
+ * Mass interface bring-up acquires the duid once per device, and every
+ * acquisition used to re-read and re-parse the same map file. Keep the
+ * last parsed document cached and revalidate it against the file
+ * identity and mtime under the lock; the on-disk format and the locked
+ * read-modify-write update path stay as they are.
+ */
+static struct {
+	xml_document_t *doc;
+	char *		file;
+	struct stat	stb;
+} ni_duid_map_cache;
+
+static ni_bool_t
+ni_duid_map_cache_valid(const char *file, const struct stat *stb)
+{
+	return	ni_duid_map_cache.doc != NULL &&
+		ni_string_eq(ni_duid_map_cache.file, file) &&
+		ni_duid_map_cache.stb.st_dev == stb->st_dev &&
+		ni_duid_map_cache.stb.st_ino == stb->st_ino &&
+		ni_duid_map_cache.stb.st_size == stb->st_size &&
+		ni_duid_map_cache.stb.st_mtim.tv_sec == stb->st_mtim.tv_sec &&
+		ni_duid_map_cache.stb.st_mtim.tv_nsec == stb->st_mtim.tv_nsec;
+}
+
+static void
+ni_duid_map_cache_store(const ni_duid_map_t *map, const struct stat *stb)
+{
+	if (ni_duid_map_cache.doc != map->doc)
+		xml_document_free(ni_duid_map_cache.doc);
+	ni_duid_map_cache.doc = map->doc;
+	ni_string_dup(&ni_duid_map_cache.file, map->file);
+	ni_duid_map_cache.stb = *stb;
+}
+
+static void
+ni_duid_map_cache_dirty(const ni_duid_map_t *map)
+{
+	/* in-memory changes not written back yet; force a re-read */
+	if (map && map->doc && map->doc == ni_duid_map_cache.doc)
+		memset(&ni_duid_map_cache.stb, 0, sizeof(ni_duid_map_cache.stb));
+}
+
 /*
  * compiler (gcc) specific ...
  */
@@ -576,7 +621,8 @@ ni_duid_map_free(ni_duid_map_t *map)
 			close(map->fd);
 			map->fd = -1;
 		}
-		xml_document_free(map->doc);
+		if (map->doc != ni_duid_map_cache.doc)
+			xml_document_free(map->doc);
 		ni_string_free(&map->file);
 		free(map);
 	}
@@ -620,6 +666,7 @@ ni_duid_map_load(const char *filename)
 	const char *type;
 	ni_buffer_t buff;
 	struct stat stb;
+	ni_bool_t have_stb;
 	ssize_t len;
 
 	if (!(map = ni_duid_map_new())) {
@@ -666,8 +713,12 @@ ni_duid_map_load(const char *filename)
 		goto failure;
 	}
 
-	if (fstat(map->fd, &stb) < 0)
+	if (!(have_stb = fstat(map->fd, &stb) == 0)) {
 		stb.st_size = BUFSIZ;
+	} else if (ni_duid_map_cache_valid(map->file, &stb)) {
+		map->doc = ni_duid_map_cache.doc;
+		return map;
+	}
 
 	ni_buffer_init_dynamic(&buff, stb.st_size + 1);
 	do {
@@ -690,6 +741,8 @@ ni_duid_map_load(const char *filename)
 			map->doc = xml_document_new();
 			ni_warn("unable to parse %s duid map file name (%s): %m", type, map->file);
 		}
+		if (have_stb)
+			ni_duid_map_cache_store(map, &stb);
 		return map;
 	}
 
@@ -703,6 +756,7 @@ ni_duid_map_save(ni_duid_map_t *map)
 {
 	char *data = NULL;
 	size_t off, len;
+	struct stat stb;
 	ssize_t ret;
 
 	if (!map || map->fd < 0)
@@ -730,7 +784,13 @@ ni_duid_map_save(ni_duid_map_t *map)
 	}
 	free(data);
 
-	return ret < 0 ? FALSE : TRUE;
+	if (ret < 0)
+		return FALSE;
+
+	/* the written document is up to date again; recache it */
+	if (fstat(map->fd, &stb) == 0)
+		ni_duid_map_cache_store(map, &stb);
+	return TRUE;
 }
 
 static xml_node_t *
@@ -803,6 +863,8 @@ ni_duid_map_set(ni_duid_map_t *map, const char *name, const char *duid)
 	if (!(root = ni_duid_map_root_node(map)) || ni_string_empty(duid))
 		return FALSE;
 
+	ni_duid_map_cache_dirty(map);
+
 	while ((node = ni_duid_map_next_node(root, node))) {
 		attr = xml_node_get_attr(node, NI_CONFIG_DEFAULT_DUID_DEVICE);
 		if (!ni_string_eq(name, attr))
@@ -834,6 +896,7 @@ ni_duid_map_del(ni_duid_map_t *map, const char *name)
 		if (!ni_string_eq(name, attr))
 			continue;
 
+		ni_duid_map_cache_dirty(map);
 		xml_node_detach(node);
 		xml_node_free(node);
 		return TRUE;
@@ -1431,6 +1431,9 @@ ni_ethtool_get_link_settings_current(const ni_netdev_ref_t *ref, ni_ethtool_t *e
 	static const ni_ethtool_cmd_info_t NI_ETHTOOL_CMD_GLINKSETINGS = {
 		ETHTOOL_GLINKSETTINGS,	"get link settings"
 	};
+	/* nwords negotiated with the running kernel -- it is a kernel
+	 * property, so remember it across devices and refreshes */
+	static int8_t kernel_nwords;
 	struct {
 		struct ethtool_link_settings settings;
 		uint32_t link_mode_maps[SCHAR_MAX * 3];
@@ -1445,8 +1448,8 @@ ni_ethtool_get_link_settings_current(const ni_netdev_ref_t *ref, ni_ethtool_t *e
 	ethtool->link_settings = NULL;
 
 	memset(&ecmd, 0, sizeof(ecmd));
-	if (ethtool->link_settings && ethtool->link_settings->nwords > 0)
-		ecmd.settings.link_mode_masks_nwords = ethtool->link_settings->nwords;
+	if (kernel_nwords > 0)
+		ecmd.settings.link_mode_masks_nwords = kernel_nwords;
 	else
 		ecmd.settings.link_mode_masks_nwords = ni_ethtool_link_mode_nwords();
 
@@ -1467,6 +1470,8 @@ ni_ethtool_get_link_settings_current(const ni_netdev_ref_t *ref, ni_ethtool_t *e
 		if ((ret = ni_ethtool_call(ref, &NI_ETHTOOL_CMD_GLINKSETINGS, &ecmd, NULL)) < 0)
 			return ret;
 	}
+	if (ecmd.settings.link_mode_masks_nwords > 0)
+		kernel_nwords = ecmd.settings.link_mode_masks_nwords;
 
 	if (!(link = ni_ethtool_link_settings_new()))
 		return -ENOMEM;
@@ -3610,7 +3615,7 @@ ni_ethtool_set_pause(const ni_netdev_ref_t *ref, ni_ethtool_t *ethtool, const ni
  * main system refresh and setup functions
  */
 static ni_bool_t
-ni_ethtool_refresh(ni_netdev_t *dev)
+ni_ethtool_refresh(ni_netdev_t *dev, ni_bool_t all)
 {
 	ni_ethtool_t *ethtool;
 	ni_netdev_ref_t ref;
@@ -3622,16 +3627,33 @@ ni_ethtool_refresh(ni_netdev_t *dev)
 	ref.index = dev->link.ifindex;
 	if (!ethtool->driver_info)
 		ni_ethtool_get_driver_info(&ref, ethtool);
-	ni_ethtool_get_priv_flags(&ref, ethtool);
+
+	/*
+	 * Link detection and the negotiated link settings are volatile;
+	 * the remaining parameters only change through our own setup
+	 * path, which forces a complete re-read. Don't re-read them on
+	 * every link event, it costs a dozen serialized ioctls per
+	 * device and refresh.
+	 */
 	ni_ethtool_get_link_detected(&ref, ethtool);
 	ni_ethtool_get_link_settings(&ref, ethtool);
-	ni_ethtool_get_wake_on_lan(&ref, ethtool);
-	ni_ethtool_get_features(&ref, ethtool, FALSE);
-	ni_ethtool_get_eee(&ref, ethtool);
-	ni_ethtool_get_ring(&ref, ethtool);
-	ni_ethtool_get_channels(&ref, ethtool);
-	ni_ethtool_get_coalesce(&ref, ethtool);
-	ni_ethtool_get_pause(&ref, ethtool);
+
+	if (all || !ethtool->priv_flags)
+		ni_ethtool_get_priv_flags(&ref, ethtool);
+	if (all || !ethtool->wake_on_lan)
+		ni_ethtool_get_wake_on_lan(&ref, ethtool);
+	if (all || !ethtool->features)
+		ni_ethtool_get_features(&ref, ethtool, FALSE);
+	if (all || !ethtool->eee)
+		ni_ethtool_get_eee(&ref, ethtool);
+	if (all || !ethtool->ring)
+		ni_ethtool_get_ring(&ref, ethtool);
+	if (all || !ethtool->channels)
+		ni_ethtool_get_channels(&ref, ethtool);
+	if (all || !ethtool->coalesce)
+		ni_ethtool_get_coalesce(&ref, ethtool);
+	if (all || !ethtool->pause)
+		ni_ethtool_get_pause(&ref, ethtool);
 
 	return TRUE;
 }
@@ -3642,7 +3664,7 @@ ni_system_ethtool_refresh(ni_netdev_t *dev)
 	if (!ni_netdev_device_is_ready(dev) || !dev->link.ifindex)
 		return;
 
-	ni_ethtool_refresh(dev);
+	ni_ethtool_refresh(dev, FALSE);
 }
 
 int
@@ -3653,7 +3675,7 @@ ni_system_ethtool_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t
 	if (!ni_netdev_device_is_ready(dev) || !dev->link.ifindex)
 		return -1;
 
-	if (!dev->ethtool && !ni_ethtool_refresh(dev))
+	if (!dev->ethtool && !ni_ethtool_refresh(dev, TRUE))
 		return -1;
 
 	ref.name = dev->name;
@@ -3668,7 +3690,7 @@ ni_system_ethtool_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t
 		ni_ethtool_set_channels(&ref, dev->ethtool, cfg->ethtool->channels);
 		ni_ethtool_set_coalesce(&ref, dev->ethtool, cfg->ethtool->coalesce);
 		ni_ethtool_set_pause(&ref, dev->ethtool, cfg->ethtool->pause);
-		ni_ethtool_refresh(dev);
+		ni_ethtool_refresh(dev, TRUE);
 	}
 	return 0;
 }
@@ -0,0 +1,169 @@
+/*
+ * Event loop latency accounting for wickedd.
+ *
+ * The socket and timer dispatch paths stamp the monotonic clock around
+ * every callback and feed the elapsed time in here. We keep one latency
+ * histogram per callback type plus the worst stall ever observed, so
+ * that "ifup took 40s" incidents can be triaged from a running daemon
+ * without enabling debug logging.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include "evstats.h"
+#include "trace.h"
+
+static ni_evstat_hist_t		ni_evstat_hists[__NI_EVSTAT_MAX];
+static uint64_t			ni_evstat_stall_max;
+
+static const char *		ni_evstat_type_names[__NI_EVSTAT_MAX] = {
+	[NI_EVSTAT_SOCKET_RECEIVE]	= "socket-receive",
+	[NI_EVSTAT_SOCKET_TRANSMIT]	= "socket-transmit",
+	[NI_EVSTAT_SOCKET_ERROR]	= "socket-error",
+	[NI_EVSTAT_SOCKET_HANGUP]	= "socket-hangup",
+	[NI_EVSTAT_TIMER]		= "timer",
+};
+
+void
+ni_evstats_stamp(struct timespec *ts)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+uint64_t
+ni_evstats_record(ni_evstat_type_t type, const struct timespec *begin)
+{
+	ni_evstat_hist_t *hist;
+	struct timespec now;
+	uint64_t usec;
+	unsigned int bucket;
+
+	if (type >= __NI_EVSTAT_MAX)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	usec = (now.tv_sec - begin->tv_sec) * 1000000ULL;
+	usec += (now.tv_nsec - begin->tv_nsec) / 1000;
+
+	ni_tracepoint2(event_latency, type, usec);
+
+	hist = &ni_evstat_hists[type];
+	hist->count++;
+	hist->total_usec += usec;
+	if (usec > hist->max_usec)
+		hist->max_usec = usec;
+	if (usec > ni_evstat_stall_max)
+		ni_evstat_stall_max = usec;
+
+	for (bucket = 0; bucket + 1 < NI_EVSTAT_BUCKETS; ++bucket) {
+		if (usec < (1ULL << bucket))
+			break;
+	}
+	hist->bucket[bucket]++;
+
+	return usec;
+}
+
+/*
+ * Stall watchdog. The dispatch paths hand in the duration returned by
+ * ni_evstats_record() together with a printf-style callback identity;
+ * everything below the threshold returns immediately, so the identity
+ * string is only ever formatted for actual stalls. Offenders are
+ * accumulated in a small table for the stats endpoint, and at most one
+ * warning per interval goes to the log.
+ */
+#define NI_EVSTAT_STALL_WARN_INTERVAL	10	/* seconds */
+
+static ni_evstat_offender_t	ni_evstat_offenders[NI_EVSTAT_OFFENDER_MAX];
+static unsigned int		ni_evstat_offender_count;
+
+void
+ni_evstats_stall_check(uint64_t usec, const char *fmt, ...)
+{
+	static time_t last_warn;
+	char ident[sizeof(((ni_evstat_offender_t *)0)->ident)];
+	ni_evstat_offender_t *off = NULL, *victim;
+	struct timespec now;
+	unsigned int i;
+	va_list ap;
+
+	if (usec < NI_EVSTAT_STALL_WARN_USEC)
+		return;
+
+	va_start(ap, fmt);
+	vsnprintf(ident, sizeof(ident), fmt, ap);
+	va_end(ap);
+
+	for (i = 0; i < ni_evstat_offender_count; ++i) {
+		if (!strcmp(ni_evstat_offenders[i].ident, ident)) {
+			off = &ni_evstat_offenders[i];
+			break;
+		}
+	}
+	if (off == NULL) {
+		if (ni_evstat_offender_count < NI_EVSTAT_OFFENDER_MAX) {
+			off = &ni_evstat_offenders[ni_evstat_offender_count++];
+		} else {
+			/* table full: recycle the least damaging entry */
+			victim = &ni_evstat_offenders[0];
+			for (i = 1; i < NI_EVSTAT_OFFENDER_MAX; ++i) {
+				if (ni_evstat_offenders[i].total_usec < victim->total_usec)
+					victim = &ni_evstat_offenders[i];
+			}
+			memset(victim, 0, sizeof(*victim));
+			off = victim;
+		}
+		strncpy(off->ident, ident, sizeof(off->ident) - 1);
+	}
+	off->count++;
+	off->total_usec += usec;
+	if (usec > off->max_usec)
+		off->max_usec = usec;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec - last_warn >= NI_EVSTAT_STALL_WARN_INTERVAL) {
+		last_warn = now.tv_sec;
+		ni_warn("event loop stalled for %llu.%03llu msec in %s",
+				(unsigned long long)usec / 1000,
+				(unsigned long long)usec % 1000, ident);
+	}
+}
+
+const ni_evstat_offender_t *
+ni_evstats_offender_get(unsigned int index)
+{
+	if (index >= ni_evstat_offender_count)
+		return NULL;
+	return &ni_evstat_offenders[index];
+}
+
+const ni_evstat_hist_t *
+ni_evstats_get(ni_evstat_type_t type)
+{
+	if (type >= __NI_EVSTAT_MAX)
+		return NULL;
+	return &ni_evstat_hists[type];
+}
+
+uint64_t
+ni_evstats_max_stall(void)
+{
+	return ni_evstat_stall_max;
+}
+
+const char *
+ni_evstat_type_name(ni_evstat_type_t type)
+{
+	if (type >= __NI_EVSTAT_MAX)
+		return NULL;
+	return ni_evstat_type_names[type];
+}
@@ -0,0 +1,54 @@
+/*
+ * Event loop latency accounting for wickedd.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+
+#ifndef __WICKED_EVSTATS_H__
+#define __WICKED_EVSTATS_H__
+
+#include <stdint.h>
+#include <time.h>
+
+typedef enum {
+	NI_EVSTAT_SOCKET_RECEIVE = 0,
+	NI_EVSTAT_SOCKET_TRANSMIT,
+	NI_EVSTAT_SOCKET_ERROR,
+	NI_EVSTAT_SOCKET_HANGUP,
+	NI_EVSTAT_TIMER,
+
+	__NI_EVSTAT_MAX
+} ni_evstat_type_t;
+
+/* Latency histogram with power-of-two microsecond buckets;
+ * the last bucket collects everything above the range. */
+#define NI_EVSTAT_BUCKETS	20
+
+typedef struct ni_evstat_hist {
+	uint64_t	count;
+	uint64_t	total_usec;
+	uint64_t	max_usec;
+	uint64_t	bucket[NI_EVSTAT_BUCKETS];
+} ni_evstat_hist_t;
+
+/* Callbacks blocking the loop for longer than this are logged
+ * (rate-limited) and tracked in the worst offenders table. */
+#define NI_EVSTAT_STALL_WARN_USEC	(250 * 1000)
+#define NI_EVSTAT_OFFENDER_MAX		16
+
+typedef struct ni_evstat_offender {
+	char		ident[64];
+	uint64_t	count;
+	uint64_t	total_usec;
+	uint64_t	max_usec;
+} ni_evstat_offender_t;
+
+extern void			ni_evstats_stamp(struct timespec *);
+extern uint64_t			ni_evstats_record(ni_evstat_type_t, const struct timespec *);
+extern void			ni_evstats_stall_check(uint64_t, const char *, ...);
+extern const ni_evstat_hist_t *	ni_evstats_get(ni_evstat_type_t);
+extern const ni_evstat_offender_t *	ni_evstats_offender_get(unsigned int);
+extern uint64_t			ni_evstats_max_stall(void);
+extern const char *		ni_evstat_type_name(ni_evstat_type_t);
+
+#endif /* __WICKED_EVSTATS_H__ */
@@ -170,6 +170,25 @@ ni_extension_script_find(ni_extension_t *extension, const char *name)
 	return NULL;
 }
 
+/*
+ * Set an environment variable on all scripts of an extension, so that
+ * every process spawned from them inherits it. This is how we announce
+ * protocol capabilities (e.g. delta input files) to backend scripts.
+ */
+void
+ni_extension_script_setenv(ni_extension_t *extension, const char *name, const char *value)
+{
+	ni_script_action_t *script;
+
+	if (!extension || ni_string_empty(name))
+		return;
+
+	for (script = extension->actions; script; script = script->next) {
+		if (script->process)
+			ni_shellcmd_setenv(script->process, name, value);
+	}
+}
+
 /*
  * Find C binding info
  */
@@ -7,12 +7,143 @@
 #include "config.h"
 #endif
 
+#include <sys/stat.h>
+#include <limits.h>
+
 #include <wicked/xml.h>
 #include "buffer.h"
 #include "appconfig.h"
 #include "process.h"
+#include "util_priv.h"
 #include "debug.h"
 
+/*
+ * Well-known sysfs locations of the firmware types shipped with the
+ * default config.  They let us skip spawning the discovery script when
+ * the firmware is not present at all -- the common case, costing one
+ * stat -- and serve as cache validation for the scan outcome.
+ */
+static const struct __ni_firmware_probe {
+	const char *		name;		/* script action name	*/
+	const char *		path;		/* sysfs presence path	*/
+} __ni_firmware_probes[] = {
+	{ "ibft",		"/sys/firmware/ibft"	},
+	{ NULL,			NULL			}
+};
+
+#define NI_FIRMWARE_PROBE_COUNT	\
+	(sizeof(__ni_firmware_probes) / sizeof(__ni_firmware_probes[0]) - 1)
+
+static const struct __ni_firmware_probe *
+__ni_firmware_probe_find(const char *name)
+{
+	const struct __ni_firmware_probe *probe;
+
+	for (probe = __ni_firmware_probes; probe->name; ++probe) {
+		if (ni_string_eq_nocase(probe->name, name))
+			return probe;
+	}
+	return NULL;
+}
+
+/*
+ * Single-entry scan outcome cache, including the negative (no firmware)
+ * result.  Only usable when every script run has a probe path we can
+ * stat for validation; unknown discovery scripts always run.
+ */
+static struct {
+	ni_bool_t		valid;
+	char *			key;		/* root|type|path args	*/
+	struct {
+		ni_bool_t	present;
+		struct timespec	mtime;
+	}			state[NI_FIRMWARE_PROBE_COUNT];
+	ni_buffer_t *		data;
+} __ni_firmware_cache;
+
+static ni_bool_t
+__ni_firmware_probe_path(const struct __ni_firmware_probe *probe,
+		const char *root, struct stat *stb)
+{
+	char pathbuf[PATH_MAX];
+
+	snprintf(pathbuf, sizeof(pathbuf), "%s%s", root ? root : "", probe->path);
+	return stat(pathbuf, stb) == 0;
+}
+
+static void
+__ni_firmware_probe_stat(const char *root, ni_bool_t state[], struct timespec mtime[])
+{
+	const struct __ni_firmware_probe *probe;
+	struct stat stb;
+	unsigned int i;
+
+	for (i = 0; (probe = &__ni_firmware_probes[i])->name; ++i) {
+		if (__ni_firmware_probe_path(probe, root, &stb)) {
+			state[i] = TRUE;
+			mtime[i] = stb.st_mtim;
+		} else {
+			state[i] = FALSE;
+			memset(&mtime[i], 0, sizeof(mtime[i]));
+		}
+	}
+}
+
+static ni_buffer_t *
+__ni_firmware_cache_get(const char *root, const char *key)
+{
+	ni_bool_t present[NI_FIRMWARE_PROBE_COUNT];
+	struct timespec mtime[NI_FIRMWARE_PROBE_COUNT];
+	ni_buffer_t *result;
+	unsigned int i;
+
+	if (!__ni_firmware_cache.valid || !ni_string_eq(__ni_firmware_cache.key, key))
+		return NULL;
+
+	__ni_firmware_probe_stat(root, present, mtime);
+	for (i = 0; i < NI_FIRMWARE_PROBE_COUNT; ++i) {
+		if (__ni_firmware_cache.state[i].present != present[i] ||
+		    __ni_firmware_cache.state[i].mtime.tv_sec  != mtime[i].tv_sec ||
+		    __ni_firmware_cache.state[i].mtime.tv_nsec != mtime[i].tv_nsec)
+			return NULL;
+	}
+
+	result = ni_buffer_new_dynamic(ni_buffer_count(__ni_firmware_cache.data) + 1);
+	ni_buffer_put(result, ni_buffer_head(__ni_firmware_cache.data),
+			ni_buffer_count(__ni_firmware_cache.data));
+	return result;
+}
+
+static void
+__ni_firmware_cache_put(const char *root, const char *key, ni_bool_t cachable,
+		const ni_buffer_t *data)
+{
+	ni_bool_t present[NI_FIRMWARE_PROBE_COUNT];
+	struct timespec mtime[NI_FIRMWARE_PROBE_COUNT];
+	unsigned int i;
+
+	if (__ni_firmware_cache.data) {
+		ni_buffer_free(__ni_firmware_cache.data);
+		__ni_firmware_cache.data = NULL;
+	}
+	__ni_firmware_cache.valid = FALSE;
+
+	if (!cachable)
+		return;
+
+	__ni_firmware_probe_stat(root, present, mtime);
+	for (i = 0; i < NI_FIRMWARE_PROBE_COUNT; ++i) {
+		__ni_firmware_cache.state[i].present = present[i];
+		__ni_firmware_cache.state[i].mtime = mtime[i];
+	}
+
+	__ni_firmware_cache.data = ni_buffer_new_dynamic(ni_buffer_count(data) + 1);
+	ni_buffer_put(__ni_firmware_cache.data, ni_buffer_head(data),
+			ni_buffer_count(data));
+	ni_string_dup(&__ni_firmware_cache.key, key);
+	__ni_firmware_cache.valid = TRUE;
+}
+
 /*
  * Run all the netif firmware discovery scripts and return their output
  * as one large buffer.
@@ -23,9 +154,19 @@ __ni_netconfig_firmware_discovery(const char *root, const char *type, const char
 	ni_buffer_t *result;
 	ni_config_t *config = ni_global.config;
 	ni_extension_t *ex;
+	ni_bool_t cachable = TRUE;
+	char *key = NULL;
 
 	ni_assert(config);
 
+	ni_string_printf(&key, "%s|%s|%s", root ? root : "",
+			type ? type : "", path ? path : "");
+	if ((result = __ni_firmware_cache_get(root, key))) {
+		ni_debug_ifconfig("%s: using cached firmware discovery result", __func__);
+		ni_string_free(&key);
+		return result;
+	}
+
 	result = ni_buffer_new_dynamic(1024);
 
 	for (ex = config->fw_extensions; ex; ex = ex->next) {
@@ -35,13 +176,27 @@ __ni_netconfig_firmware_discovery(const char *root, const char *type, const char
 			ni_warn("builtins specified in a netif-firmware-discovery element: not supported");
 
 		for (script = ex->actions; script; script = script->next) {
+			const struct __ni_firmware_probe *probe;
 			ni_process_t *process;
+			struct stat stb;
 			int rv;
 
 			/* Check if requested to use specific type/name only (e.g. "ibft") */
 			if (type && !ni_string_eq_nocase(type, script->name))
 				continue;
 
+			if ((probe = __ni_firmware_probe_find(script->name))) {
+				if (!__ni_firmware_probe_path(probe, root, &stb)) {
+					ni_debug_ifconfig("no %s firmware present (%s), "
+							"not running discovery script",
+							script->name, probe->path);
+					continue;
+				}
+			} else {
+				/* no probe path known; can't validate a cache */
+				cachable = FALSE;
+			}
+
 			ni_debug_ifconfig("trying to discover netif config via firmware service \"%s\"", script->name);
 
 			/* Create an instance of this command */
@@ -65,11 +220,14 @@ __ni_netconfig_firmware_discovery(const char *root, const char *type, const char
 				ni_error("unable to discover firmware (script \"%s\")",
 						script->name);
 				ni_buffer_free(result);
+				ni_string_free(&key);
 				return NULL;
 			}
 		}
 	}
 
+	__ni_firmware_cache_put(root, key, cachable, result);
+	ni_string_free(&key);
 	return result;
 }
 
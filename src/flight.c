@@ -0,0 +1,181 @@
+/*
+ * In-memory flight recorder of recent daemon events.
+ *
+ * The hot paths (netlink event processing, dbus dispatch, FSM state
+ * changes, timer expiry) drop a small fixed-size record into a
+ * statically allocated ring; recording is a clock read and a few
+ * stores, with no allocation or locking. When the daemon dies on a
+ * fatal signal or through ni_fatal(), the ring is dumped to a file, so
+ * a post-mortem can reconstruct the exact ordering of the last ~64k
+ * events leading up to the crash.
+ *
+ * The dump path runs inside a signal handler and therefore restricts
+ * itself to async-signal-safe calls: open/write/close and hand-rolled
+ * decimal formatting.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <wicked/logging.h>
+#include "flight.h"
+
+static ni_flight_entry_t	ni_flight_ring[NI_FLIGHT_ENTRIES];
+static unsigned int		ni_flight_next;
+static unsigned int		ni_flight_filled;
+static const char *		ni_flight_dump_path;
+
+static const char *		ni_flight_kind_names[] = {
+	[NI_FLIGHT_NETLINK_EVENT]	= "netlink",
+	[NI_FLIGHT_DBUS_CALL]		= "dbus",
+	[NI_FLIGHT_FSM_TRANSITION]	= "fsm",
+	[NI_FLIGHT_TIMER]		= "timer",
+};
+
+void
+ni_flight_record(ni_flight_kind_t kind, uint32_t arg1, uint32_t arg2, const char *tag)
+{
+	ni_flight_entry_t *entry;
+	struct timespec now;
+
+	entry = &ni_flight_ring[ni_flight_next];
+	ni_flight_next = (ni_flight_next + 1) & (NI_FLIGHT_ENTRIES - 1);
+	if (ni_flight_filled < NI_FLIGHT_ENTRIES)
+		ni_flight_filled++;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	entry->stamp_usec = now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+	entry->kind = kind;
+	entry->arg1 = arg1;
+	entry->arg2 = arg2;
+	if (tag) {
+		strncpy(entry->tag, tag, sizeof(entry->tag) - 1);
+		entry->tag[sizeof(entry->tag) - 1] = '\0';
+	} else {
+		entry->tag[0] = '\0';
+	}
+}
+
+/*
+ * Async-signal-safe helpers for the dump path.
+ */
+static char *
+__ni_flight_format_uint(char *end, uint64_t value)
+{
+	*--end = '\0';
+	do {
+		*--end = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	return end;
+}
+
+static void
+__ni_flight_write(int fd, const char *str)
+{
+	size_t len = strlen(str);
+
+	while (len) {
+		ssize_t n = write(fd, str, len);
+
+		if (n <= 0)
+			return;
+		str += n;
+		len -= n;
+	}
+}
+
+static void
+__ni_flight_write_uint(int fd, uint64_t value)
+{
+	char buf[24];
+
+	__ni_flight_write(fd, __ni_flight_format_uint(buf + sizeof(buf), value));
+}
+
+void
+ni_flight_dump(int fd)
+{
+	unsigned int index, count = ni_flight_filled;
+	const ni_flight_entry_t *entry;
+	const char *kind;
+
+	/* oldest entry first */
+	index = (ni_flight_next + NI_FLIGHT_ENTRIES - count) & (NI_FLIGHT_ENTRIES - 1);
+
+	while (count--) {
+		entry = &ni_flight_ring[index];
+		index = (index + 1) & (NI_FLIGHT_ENTRIES - 1);
+
+		kind = NULL;
+		if (entry->kind < sizeof(ni_flight_kind_names) / sizeof(ni_flight_kind_names[0]))
+			kind = ni_flight_kind_names[entry->kind];
+
+		__ni_flight_write_uint(fd, entry->stamp_usec);
+		__ni_flight_write(fd, " ");
+		__ni_flight_write(fd, kind ? kind : "?");
+		__ni_flight_write(fd, " ");
+		__ni_flight_write_uint(fd, entry->arg1);
+		__ni_flight_write(fd, " ");
+		__ni_flight_write_uint(fd, entry->arg2);
+		if (entry->tag[0]) {
+			__ni_flight_write(fd, " ");
+			__ni_flight_write(fd, entry->tag);
+		}
+		__ni_flight_write(fd, "\n");
+	}
+}
+
+void
+ni_flight_dump_to_path(void)
+{
+	int fd;
+
+	if (!ni_flight_dump_path || !ni_flight_filled)
+		return;
+
+	fd = open(ni_flight_dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return;
+	ni_flight_dump(fd);
+	close(fd);
+}
+
+static void
+__ni_flight_crash_handler(int sig)
+{
+	ni_flight_dump_to_path();
+
+	/* handlers are installed with SA_RESETHAND; re-raise to die
+	 * with the original signal and a usable core. */
+	raise(sig);
+}
+
+void
+ni_flight_enable_crash_dump(const char *path)
+{
+	static const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+	struct sigaction sa;
+	unsigned int i;
+
+	ni_flight_dump_path = path;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = __ni_flight_crash_handler;
+	sa.sa_flags = SA_RESETHAND;
+	sigemptyset(&sa.sa_mask);
+
+	for (i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i) {
+		if (sigaction(signals[i], &sa, NULL) < 0)
+			ni_warn("cannot install flight recorder handler for signal %d: %m",
+					signals[i]);
+	}
+}
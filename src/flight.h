@@ -0,0 +1,36 @@
+/*
+ * In-memory flight recorder of recent daemon events.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+
+#ifndef __WICKED_FLIGHT_H__
+#define __WICKED_FLIGHT_H__
+
+#include <stdint.h>
+
+typedef enum {
+	NI_FLIGHT_NETLINK_EVENT = 1,
+	NI_FLIGHT_DBUS_CALL,
+	NI_FLIGHT_FSM_TRANSITION,
+	NI_FLIGHT_TIMER,
+} ni_flight_kind_t;
+
+/* Ring capacity; must be a power of two. */
+#define NI_FLIGHT_ENTRIES	65536
+#define NI_FLIGHT_TAG_SIZE	16
+
+typedef struct ni_flight_entry {
+	uint64_t	stamp_usec;		/* CLOCK_MONOTONIC */
+	uint32_t	kind;
+	uint32_t	arg1;
+	uint32_t	arg2;
+	char		tag[NI_FLIGHT_TAG_SIZE];
+} ni_flight_entry_t;
+
+extern void		ni_flight_record(ni_flight_kind_t, uint32_t, uint32_t, const char *);
+extern void		ni_flight_dump(int fd);
+extern void		ni_flight_dump_to_path(void);
+extern void		ni_flight_enable_crash_dump(const char *);
+
+#endif /* __WICKED_FLIGHT_H__ */
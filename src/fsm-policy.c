@@ -102,6 +102,9 @@ struct ni_fsm_policy {
 	ni_fsm_policy_t **		pprev;
 	ni_fsm_policy_t *		next;
 
+	ni_fsm_policy_t **		hash_pprev;
+	ni_fsm_policy_t *		hash_next;
+
 	unsigned int			seq;
 
 	ni_fsm_policy_type_t		type;
@@ -159,6 +162,65 @@ __ni_fsm_policy_list_unlink(ni_fsm_policy_t *policy)
 	policy->next = NULL;
 }
 
+/*
+ * Hash index over the fsm policy list, keyed by policy name.
+ *
+ * Policy matching requires an exact name match (see check 1 in
+ * ni_fsm_policy_applicable), so looking up the name chain avoids
+ * evaluating every policy's match expression against every device.
+ */
+#define NI_FSM_POLICY_HASH_NBUCKETS	64
+
+static unsigned int
+__ni_fsm_policy_name_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = (hash << 5) + hash + (unsigned char)*name++;
+	return hash % NI_FSM_POLICY_HASH_NBUCKETS;
+}
+
+static inline ni_fsm_policy_t *
+__ni_fsm_policy_hash_head(const ni_fsm_t *fsm, const char *name)
+{
+	if (!fsm || !fsm->policy_hash)
+		return NULL;
+	return fsm->policy_hash[__ni_fsm_policy_name_hash(name)];
+}
+
+static void
+__ni_fsm_policy_hash_insert(ni_fsm_t *fsm, ni_fsm_policy_t *policy)
+{
+	ni_fsm_policy_t **chain;
+
+	if (!fsm->policy_hash)
+		fsm->policy_hash = xcalloc(NI_FSM_POLICY_HASH_NBUCKETS,
+						sizeof(fsm->policy_hash[0]));
+
+	chain = &fsm->policy_hash[__ni_fsm_policy_name_hash(policy->name)];
+	policy->hash_pprev = chain;
+	policy->hash_next = *chain;
+	if (policy->hash_next)
+		policy->hash_next->hash_pprev = &policy->hash_next;
+	*chain = policy;
+}
+
+static void
+__ni_fsm_policy_hash_unlink(ni_fsm_policy_t *policy)
+{
+	ni_fsm_policy_t **pprev, *next;
+
+	pprev = policy->hash_pprev;
+	next = policy->hash_next;
+	if (pprev)
+		*pprev = next;
+	if (next)
+		next->hash_pprev = pprev;
+	policy->hash_pprev = NULL;
+	policy->hash_next = NULL;
+}
+
 /*
  * Destructor for policy objects
  */
@@ -169,6 +231,7 @@ ni_fsm_policy_free(ni_fsm_policy_t *policy)
 		ni_assert(policy->refcount);
 		policy->refcount--;
 		if (policy->refcount == 0) {
+			__ni_fsm_policy_hash_unlink(policy);
 			__ni_fsm_policy_list_unlink(policy);
 			__ni_fsm_policy_destroy(policy);
 			free(policy);
@@ -322,6 +385,7 @@ ni_fsm_policy_new(ni_fsm_t *fsm, const char *name, xml_node_t *node)
 	}
 
 	__ni_fsm_policy_list_insert(&fsm->policies, policy);
+	__ni_fsm_policy_hash_insert(fsm, policy);
 	return policy;
 }
 
@@ -377,6 +441,7 @@ ni_fsm_policy_remove(ni_fsm_t *fsm, ni_fsm_policy_t *policy)
 			 * force remove if in fsm list,
 			 * even it is not the last ref.
 			 */
+			__ni_fsm_policy_hash_unlink(cur);
 			__ni_fsm_policy_list_unlink(cur);
 			ni_fsm_policy_free(cur);
 			return TRUE;
@@ -406,7 +471,7 @@ ni_fsm_policy_by_name(const ni_fsm_t *fsm, const char *name)
 {
 	ni_fsm_policy_t *policy;
 
-	for (policy = fsm->policies; policy; policy = policy->next) {
+	for (policy = __ni_fsm_policy_hash_head(fsm, name); policy; policy = policy->hash_next) {
 		if (policy->name && ni_string_eq(policy->name, name))
 			return policy;
 	}
@@ -447,21 +512,17 @@ ni_fsm_policy_location(const ni_fsm_policy_t *policy)
  * Check whether policy applies to this ifworker
  */
 static ni_bool_t
-ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifworker_t *w)
+ni_fsm_policy_applicable(const ni_fsm_t *fsm, ni_fsm_policy_t *policy, ni_ifworker_t *w,
+		const char *pname)
 {
 	xml_node_t *node;
-	char *pname;
 
 	if (!policy || !w)
 		return FALSE;
 
 	/* 1st match check -ifworker to policy name comparison */
-	pname = ni_ifpolicy_name_from_ifname(w->name);
-	if (!ni_string_eq(policy->name, pname)) {
-		ni_string_free(&pname);
+	if (!ni_string_eq(policy->name, pname))
 		return FALSE;
-	}
-	ni_string_free(&pname);
 
 	/* 2nd match check - ifworker  to config name comparison */
 	if (!xml_node_is_empty(w->config.node) &&
@@ -527,13 +588,19 @@ ni_fsm_policy_get_applicable_policies(const ni_fsm_t *fsm, ni_ifworker_t *w,
 {
 	unsigned int count = 0;
 	ni_fsm_policy_t *policy;
+	char *pname;
 
 	if (!w) {
 		ni_error("unable to get applicable policy for non-existing device");
 		return 0;
 	}
 
-	for (policy = fsm->policies; policy; policy = policy->next) {
+	/* only the name chain of the worker can ever apply */
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	for (policy = __ni_fsm_policy_hash_head(fsm, pname); policy; policy = policy->hash_next) {
+		if (!ni_string_eq(policy->name, pname))
+			continue;
+
 		if (!ni_ifpolicy_name_is_valid(policy->name)) {
 			ni_error("policy with invalid name %s", policy->name);
 			continue;
@@ -549,11 +616,12 @@ ni_fsm_policy_get_applicable_policies(const ni_fsm_t *fsm, ni_ifworker_t *w,
 			continue;
 		}
 
-		if (ni_fsm_policy_applicable(fsm, policy, w)) {
+		if (ni_fsm_policy_applicable(fsm, policy, w, pname)) {
 			if (count < max)
 				result[count++] = policy;
 		}
 	}
+	ni_string_free(&pname);
 
 	qsort(result, count, sizeof(result[0]), __ni_fsm_policy_compare);
 	return count;
@@ -563,16 +631,27 @@ ni_bool_t
 ni_fsm_exists_applicable_policy(const ni_fsm_t *fsm, ni_fsm_policy_t *list, ni_ifworker_t *w)
 {
 	ni_fsm_policy_t *policy;
+	ni_bool_t rv = FALSE;
+	char *pname;
 
 	if (!list || !w)
 		return FALSE;
 
-	for (policy = list; policy; policy = policy->next) {
-		if (ni_fsm_policy_applicable(fsm, policy, w))
-			return TRUE;
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	if (fsm && list == fsm->policies) {
+		for (policy = __ni_fsm_policy_hash_head(fsm, pname); policy; policy = policy->hash_next) {
+			if ((rv = ni_fsm_policy_applicable(fsm, policy, w, pname)))
+				break;
+		}
+	} else {
+		for (policy = list; policy; policy = policy->next) {
+			if ((rv = ni_fsm_policy_applicable(fsm, policy, w, pname)))
+				break;
+		}
 	}
+	ni_string_free(&pname);
 
-	return FALSE;
+	return rv;
 }
 
 /*
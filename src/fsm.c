@@ -32,6 +32,9 @@
 #include "client/ifconfig.h"
 #include "appconfig.h"
 #include "util_priv.h"
+#include "trace.h"
+#include "phasestats.h"
+#include "flight.h"
 
 static ni_fsm_user_prompt_fn_t *ni_fsm_user_prompt_fn;
 static void *			ni_fsm_user_prompt_data;
@@ -45,10 +48,20 @@ static ni_fsm_require_t *	ni_ifworker_netif_resolver_new(xml_node_t *);
 static ni_fsm_require_t *	ni_ifworker_modem_resolver_new(xml_node_t *);
 static void			ni_fsm_require_list_destroy(ni_fsm_require_t **);
 static void			ni_fsm_require_free(ni_fsm_require_t *);
+
+/*
+ * Generation counter for worker state changes. A state-check
+ * requirement which failed can only start to pass once some other
+ * worker changed state (or failed, or an event arrived); the scheduler
+ * uses this counter to skip re-evaluating requirements that are still
+ * blocked, instead of polling them on every sweep over the workers.
+ */
+static unsigned int		ni_ifworker_state_change_seq = 1;
 static int			ni_ifworker_bind_device_apis(ni_ifworker_t *, const ni_dbus_service_t *);
 static void			ni_ifworker_control_init(ni_ifworker_control_t *);
 static void			ni_ifworker_control_destroy(ni_ifworker_control_t *);
 static ni_bool_t		__ni_ifworker_refresh_netdevs(ni_fsm_t *);
+static ni_bool_t		__ni_ifworker_resume_netdevs(ni_fsm_t *);
 #ifdef MODEM
 static ni_bool_t		__ni_ifworker_refresh_modems(ni_fsm_t *);
 #endif
@@ -80,6 +93,7 @@ ni_fsm_new(void)
 	ni_fsm_t *fsm;
 
 	fsm = calloc(1, sizeof(*fsm));
+	fsm->worker_budget = NI_FSM_DEFAULT_WORKER_BUDGET;
 	fsm->readonly = FALSE;
 
 	ni_fsm_user_prompt_fn = ni_fsm_user_prompt_default;
@@ -92,6 +106,7 @@ ni_fsm_free(ni_fsm_t *fsm)
 	ni_fsm_events_destroy(&fsm->events);
 	ni_ifworker_array_destroy(&fsm->pending);
 	ni_ifworker_array_destroy(&fsm->workers);
+	free(fsm->policy_hash);
 	free(fsm);
 }
 
@@ -577,6 +592,8 @@ ni_ifworker_fail(ni_ifworker_t *w, const char *fmt, ...)
 	va_end(ap);
 
 	ni_error("device %s: %s", w->name, ni_string_empty(errmsg) ? "failed" : errmsg);
+	ni_fsm_trace_record(w->name, "fail", "%s", ni_string_empty(errmsg) ? "failed" : errmsg);
+	ni_ifworker_state_change_seq++;
 	w->fsm.state = NI_FSM_STATE_NONE;
 	w->failed = TRUE;
 	w->pending = FALSE;
@@ -587,6 +604,7 @@ ni_ifworker_fail(ni_ifworker_t *w, const char *fmt, ...)
 void
 ni_ifworker_success(ni_ifworker_t *w)
 {
+	ni_fsm_trace_record(w->name, "done", "%s", ni_ifworker_state_name(w->fsm.state));
 	__ni_ifworker_done(w);
 }
 
@@ -1513,6 +1531,10 @@ ni_ifworker_add_callbacks(ni_fsm_transition_t *action, ni_objectmodel_callback_i
 
 	ni_ifworker_print_callbacks(ifname, callback_list);
 
+	for (cb = callback_list; cb; cb = cb->next)
+		ni_fsm_trace_record(ifname, "wait", "%s uuid=%s",
+				cb->event, ni_uuid_print(&cb->uuid));
+
 	for (pos = &action->callbacks; (cb = *pos) != NULL; pos = &cb->next)
 		;
 	*pos = callback_list;
@@ -1600,9 +1622,15 @@ ni_ifworker_update_client_state_control(ni_ifworker_t *w)
 static inline void
 ni_ifworker_update_client_state_config(ni_ifworker_t *w)
 {
+	ni_client_state_config_t conf;
+
 	if (w && w->object && !w->readonly) {
-		ni_call_set_client_state_config(w->object, &w->config.meta);
-		ni_client_state_config_debug(w->name, &w->config.meta, "update");
+		/* record the applied config document along with its meta
+		 * data, so a later reload can diff against it */
+		conf = w->config.meta;
+		conf.node = w->config.node;
+		ni_call_set_client_state_config(w->object, &conf);
+		ni_client_state_config_debug(w->name, &conf, "update");
 	}
 }
 
@@ -1625,12 +1653,52 @@ ni_ifworker_empty_config(ni_ifworker_t *w)
 	return ni_string_empty(w->config.meta.origin);
 }
 
+/*
+ * Feed the duration of a completed transition into the phase duration
+ * histograms, for the milestones we aggregate fleet-wide.
+ */
+static void
+ni_ifworker_record_phase(const ni_fsm_transition_t *action)
+{
+	struct timeval delta;
+	ni_phase_type_t phase;
+
+	switch (action->next_state) {
+	case NI_FSM_STATE_DEVICE_READY:
+		phase = NI_PHASE_DEVICE_CREATE;
+		break;
+	case NI_FSM_STATE_LINK_UP:
+		phase = NI_PHASE_LINK_UP_WAIT;
+		break;
+	case NI_FSM_STATE_ADDRCONF_UP:
+		phase = NI_PHASE_ADDRCONF_ACQUIRE;
+		break;
+	default:
+		return;
+	}
+
+	if (!timerisset(&action->timing.started) ||
+	    !timercmp(&action->timing.finished, &action->timing.started, >))
+		return;
+
+	timersub(&action->timing.finished, &action->timing.started, &delta);
+	ni_phasestats_record(phase, delta.tv_sec * 1000000ULL + delta.tv_usec);
+}
+
 static void
 ni_ifworker_set_state(ni_ifworker_t *w, unsigned int new_state)
 {
 	unsigned int prev_state = w->fsm.state;
 
 	if (prev_state != new_state) {
+		ni_ifworker_state_change_seq++;
+		ni_tracepoint3(ifworker_state, w->ifindex, prev_state, new_state);
+		ni_flight_record(NI_FLIGHT_FSM_TRANSITION, w->ifindex,
+				(prev_state << 16) | new_state, w->name);
+		ni_fsm_trace_record(w->name, "state", "%s -> %s",
+				ni_ifworker_state_name(prev_state),
+				ni_ifworker_state_name(new_state));
+
 		if (w->progress.callback)
 			w->progress.callback(w, new_state);
 
@@ -1643,8 +1711,11 @@ ni_ifworker_set_state(ni_ifworker_t *w, unsigned int new_state)
 				(w->fsm.wait_for->next_state == w->fsm.state?
 					", resuming activity" : ", still waiting for event"));
 
-		if (w->fsm.wait_for && w->fsm.wait_for->next_state == new_state)
+		if (w->fsm.wait_for && w->fsm.wait_for->next_state == new_state) {
+			ni_timer_get_time(&w->fsm.wait_for->timing.finished);
+			ni_ifworker_record_phase(w->fsm.wait_for);
 			w->fsm.wait_for = NULL;
+		}
 
 		if ((new_state == NI_FSM_STATE_DEVICE_READY) && w->object && !w->readonly) {
 			ni_call_clear_event_filters(w->object);
@@ -2725,6 +2796,22 @@ ni_ifworker_check_dependencies(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transitio
 
 	for (req = action->require.list; req; req = next) {
 		next = req->next;
+
+		/* a failed state-check requirement stays blocked until
+		 * some worker changes state; skip re-evaluating it on
+		 * every sweep and wait for the next state change */
+		if (req->test_fn == ni_ifworker_check_state_req_test) {
+			if (req->event_seq == ni_ifworker_state_change_seq)
+				return FALSE;
+
+			if (!req->test_fn(fsm, w, req)) {
+				req->event_seq = ni_ifworker_state_change_seq;
+				return FALSE;
+			}
+			req->event_seq = ~0U;
+			continue;
+		}
+
 		if (!req->test_fn(fsm, w, req))
 			return FALSE;
 	}
@@ -3918,27 +4005,29 @@ ni_fsm_refresh_state(ni_fsm_t *fsm)
 	ni_ifworker_t *w;
 	unsigned int i;
 
-	for (i = 0; i < fsm->workers.count; ++i) {
-		w = fsm->workers.data[i];
+	if (!__ni_ifworker_resume_netdevs(fsm)) {
+		for (i = 0; i < fsm->workers.count; ++i) {
+			w = fsm->workers.data[i];
+
+			/* Always clear the object - we don't know if it's still there
+			 * after we've called ni_dbus_object_refresh_children() */
+			w->object = NULL;
+			if (w->device) {
+				ni_netdev_put(w->device);
+				w->device = NULL;
+			}
 
-		/* Always clear the object - we don't know if it's still there
-		 * after we've called ni_dbus_object_refresh_children() */
-		w->object = NULL;
-		if (w->device) {
-			ni_netdev_put(w->device);
-			w->device = NULL;
+			/* Set ifworkers to readonly if fsm is readonly */
+			w->readonly = fsm->readonly;
 		}
 
-		/* Set ifworkers to readonly if fsm is readonly */
-		w->readonly = fsm->readonly;
-	}
-
-	if (!__ni_ifworker_refresh_netdevs(fsm))
-		return FALSE;
+		if (!__ni_ifworker_refresh_netdevs(fsm))
+			return FALSE;
 #ifdef MODEM
-	if (!__ni_ifworker_refresh_modems(fsm))
-		return FALSE;
+		if (!__ni_ifworker_refresh_modems(fsm))
+			return FALSE;
 #endif
+	}
 
 	for (i = 0; i < fsm->workers.count; ++i) {
 		w = fsm->workers.data[i];
@@ -3978,6 +4067,81 @@ __ni_ifworker_refresh_netdevs(ni_fsm_t *fsm)
 	return TRUE;
 }
 
+/*
+ * Try to resume from the server's netif event journal instead of doing
+ * a full ObjectManager.GetManagedObjects transfer.  We remember the
+ * journal seqno of the previous refresh; when the server can still
+ * replay the window since then, only the devices it names need to be
+ * re-read.  Returns FALSE when a full enumeration is required; in that
+ * case the reply's head seqno (if we got one) has been stored, so that
+ * the next refresh can resume incrementally.
+ */
+static ni_bool_t
+__ni_ifworker_resume_netdevs(ni_fsm_t *fsm)
+{
+	ni_dbus_variant_t arg = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	const ni_dbus_variant_t *var;
+	ni_dbus_object_t *list_object;
+	dbus_bool_t stale = FALSE;
+	uint32_t token, head;
+	ni_bool_t ok = FALSE;
+	unsigned int i;
+
+	if (!(list_object = ni_call_get_netif_list_object()))
+		return FALSE;
+
+	token = fsm->netif_event_seqno;
+	ni_dbus_variant_set_uint32(&arg, token);
+	if (!ni_dbus_object_call_variant(list_object, NULL, "getEventsSince",
+						1, &arg, 1, &result, &error)) {
+		/* server without an event journal; just enumerate */
+		dbus_error_free(&error);
+		goto done;
+	}
+
+	if (!ni_dbus_dict_get_uint32(&result, "seqno", &head))
+		goto done;
+
+	/* remember the head even when we cannot replay, so that the
+	 * full refresh below arms the next resume */
+	fsm->netif_event_seqno = head;
+
+	if (token == 0)
+		goto done;
+
+	if (ni_dbus_dict_get_bool(&result, "stale", &stale) && stale) {
+		ni_debug_application("netif event journal stale at seqno %u (head %u), "
+				"doing full refresh", token, head);
+		goto done;
+	}
+
+	/* deletions are entangled with worker and policy teardown;
+	 * leave them to the full refresh path */
+	if ((var = ni_dbus_dict_get(&result, "deleted")) && var->array.len)
+		goto done;
+
+	if ((var = ni_dbus_dict_get(&result, "changed")) != NULL) {
+		for (i = 0; i < var->array.len; ++i) {
+			const char *path = var->string_array_value[i];
+
+			if (!ni_fsm_recv_new_netif_path(fsm, path))
+				goto done;
+		}
+		ni_debug_application("resumed netif state at seqno %u: "
+				"refreshed %u device(s)", head, var->array.len);
+	} else {
+		ni_debug_application("netif state unchanged since seqno %u", token);
+	}
+	ok = TRUE;
+
+done:
+	ni_dbus_variant_destroy(&arg);
+	ni_dbus_variant_destroy(&result);
+	return ok;
+}
+
 ni_ifworker_t *
 ni_fsm_recv_new_netif(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh)
 {
@@ -4688,20 +4852,116 @@ ni_ifworker_update_from_request(ni_ifworker_t *w, const char *service, const cha
 	}
 }
 
+/*
+ * ni_ifworker_do_common_call() places the dbus calls of a transition
+ * asynchronously, so that one scheduler pass can kick off the transitions
+ * of all independent devices and have their calls in flight concurrently
+ * rather than blocking for each reply in turn. The completion handler
+ * performs what used to happen after the blocking call returned; the
+ * worker keeps wait_for set until the last reply has been processed.
+ */
+typedef struct ni_ifworker_async_call {		/* shared per transition */
+	ni_fsm_t *		fsm;
+	ni_ifworker_t *		worker;
+	ni_fsm_transition_t *	action;
+	unsigned int		pending;
+	unsigned int		callbacks;
+} ni_ifworker_async_call_t;
+
+typedef struct ni_ifworker_async_binding {	/* one per method call */
+	ni_ifworker_async_call_t *call;
+	char *			service;
+	char *			method;
+} ni_ifworker_async_binding_t;
+
+static void
+ni_ifworker_async_call_release(ni_ifworker_async_call_t *call)
+{
+	ni_ifworker_t *w = call->worker;
+	ni_fsm_transition_t *action = call->action;
+
+	if (--(call->pending))
+		return;
+
+	/* All replies are in. If none of them carried callbacks to wait
+	 * for, complete the transition now ... unless this action requires
+	 * ACK via event */
+	if (call->callbacks == 0 && !w->failed && w->fsm.wait_for == action) {
+		if (action->next_state != NI_FSM_STATE_DEVICE_DOWN) {
+			ni_ifworker_set_state(w, action->next_state);
+			w->fsm.wait_for = NULL;
+		}
+	}
+
+	ni_ifworker_release(w);
+	free(call);
+}
+
+static void
+ni_ifworker_async_call_done(void *user_data, int rv, ni_objectmodel_callback_info_t *callback_list)
+{
+	ni_ifworker_async_binding_t *bind = user_data;
+	ni_ifworker_async_call_t *call = bind->call;
+	ni_fsm_transition_t *action = call->action;
+	ni_ifworker_t *w = call->worker;
+
+	ni_ifworker_update_from_request(w, bind->service, bind->method, rv, callback_list);
+
+	if (w->failed || w->fsm.wait_for != action) {
+		/* The worker has moved on while the call was in flight
+		 * (it failed, or the transition completed by other means);
+		 * the callbacks are of no use anymore. */
+		ni_objectmodel_callback_info_t *cb;
+
+		while ((cb = callback_list) != NULL) {
+			callback_list = cb->next;
+			cb->next = NULL;
+			ni_objectmodel_callback_info_free(cb);
+		}
+	} else
+	if (rv < 0) {
+		if (action->common.may_fail) {
+			ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
+					bind->service, bind->method, ni_strerror(rv));
+			ni_ifworker_set_state(w, action->next_state);
+		} else {
+			ni_ifworker_fail(w, "call to %s.%s() failed: %s",
+					bind->service, bind->method, ni_strerror(rv));
+		}
+	} else
+	if (callback_list) {
+		ni_debug_application("%s: adding callback for %s.%s()", w->name,
+				bind->service, bind->method);
+		ni_ifworker_add_callbacks(action, callback_list, w->name);
+		call->callbacks++;
+	}
+
+	ni_string_free(&bind->service);
+	ni_string_free(&bind->method);
+	free(bind);
+
+	ni_ifworker_async_call_release(call);
+}
+
 static int
 ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action)
 {
-	unsigned int i, count = 0;
+	ni_ifworker_async_call_t *call;
+	unsigned int i;
 	int rv;
 
 	/* Initially, enable waiting for this action */
 	w->fsm.wait_for = action;
 
+	call = xcalloc(1, sizeof(*call));
+	call->fsm = fsm;
+	call->worker = ni_ifworker_get(w);
+	call->action = action;
+	call->pending = 1;	/* guard reference while placing the calls */
+
 	for (i = 0; i < action->num_bindings; ++i) {
 		ni_fsm_transition_bind_t *bind = &action->binding[i];
-		ni_objectmodel_callback_info_t *callback_list = NULL;
-		char *service = NULL;
-		char *method = NULL;
+		ni_ifworker_async_binding_t *cb;
 
 		if (!bind->method || !bind->service)
 			continue;
@@ -4709,48 +4969,41 @@ ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 		if (bind->skip_call)
 			continue;
 
-		ni_string_dup(&service, bind->service->name);
-		ni_string_dup(&method, bind->method->name);
+		ni_debug_application("%s: calling %s.%s()", w->name,
+				bind->service->name, bind->method->name);
 
-		ni_debug_application("%s: calling %s.%s()", w->name, service, method);
+		cb = xcalloc(1, sizeof(*cb));
+		cb->call = call;
+		ni_string_dup(&cb->service, bind->service->name);
+		ni_string_dup(&cb->method, bind->method->name);
+		call->pending++;
 
-		rv = ni_call_common_xml(w->object, bind->service, bind->method, bind->config,
-				&callback_list, ni_ifworker_error_handler);
-		ni_ifworker_update_from_request(w, service, method, rv, callback_list);
+		rv = ni_call_common_xml_async(w->object, bind->service, bind->method, bind->config,
+				ni_ifworker_error_handler, ni_ifworker_async_call_done, cb);
 		if (rv < 0) {
+			call->pending--;
+			ni_string_free(&cb->service);
+			ni_string_free(&cb->method);
+			free(cb);
+
 			if (action->common.may_fail) {
 				ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
-						service, method, ni_strerror(rv));
+						bind->service->name, bind->method->name,
+						ni_strerror(rv));
 				ni_ifworker_set_state(w, action->next_state);
-				ni_string_free(&service);
-				ni_string_free(&method);
+				ni_ifworker_async_call_release(call);
 				return 0;
 			}
-			ni_ifworker_fail(w, "call to %s.%s() failed: %s", service, method, ni_strerror(rv));
-			ni_string_free(&service);
-			ni_string_free(&method);
+			ni_ifworker_fail(w, "call to %s.%s() failed: %s",
+					bind->service->name, bind->method->name, ni_strerror(rv));
+			ni_ifworker_async_call_release(call);
 			return rv;
 		}
-
-		if (callback_list) {
-			ni_debug_application("%s: adding callback for %s.%s()", w->name, service, method);
-			ni_ifworker_add_callbacks(action, callback_list, w->name);
-			count++;
-		}
-
-		ni_string_free(&service);
-		ni_string_free(&method);
-	}
-
-	/* Reset wait_for if there are no callbacks ... */
-	if (count == 0) {
-		/* ... unless this action requires ACK via event */
-		if (action->next_state != NI_FSM_STATE_DEVICE_DOWN) {
-			ni_ifworker_set_state(w, action->next_state);
-			w->fsm.wait_for = NULL;
-		}
 	}
 
+	/* Drop the guard reference; when all replies arrived already (or
+	 * no call was placed at all), this completes the transition. */
+	ni_ifworker_async_call_release(call);
 	return 0;
 }
 
@@ -5122,14 +5375,72 @@ ni_fsm_schedule_bind_methods(ni_fsm_t *fsm, ni_ifworker_t *w)
 	return 0;
 }
 
+/*
+ * Returns true when the worker is on its way down but has not reached
+ * its target state yet.
+ */
+static ni_bool_t
+ni_ifworker_is_tearing_down(const ni_ifworker_t *w)
+{
+	if (w->dead || ni_ifworker_complete(w))
+		return FALSE;
+	return w->fsm.state > w->target_state;
+}
+
+/*
+ * Teardown proceeds leaf-first through the device hierarchy: a master
+ * waits until its slaves are down, a lower device until the devices
+ * stacked on top of it are gone, mirroring the reverse of the setup
+ * order.  Only devices that are part of the same teardown run are
+ * considered, so independent subtrees proceed concurrently within the
+ * worker budget.
+ */
+static ni_bool_t
+ni_ifworker_teardown_deps_done(const ni_ifworker_t *w)
+{
+	const ni_ifworker_t *dep;
+	unsigned int i;
+
+	for (i = 0; i < w->children.count; ++i) {
+		dep = w->children.data[i];
+
+		if (dep->masterdev == w && ni_ifworker_is_tearing_down(dep))
+			return FALSE;
+	}
+
+	for (i = 0; i < w->lowerdev_for.count; ++i) {
+		dep = w->lowerdev_for.data[i];
+
+		if (ni_ifworker_is_tearing_down(dep))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * One scheduler pass kicks off the next transition of every worker whose
+ * dependencies are satisfied; the dbus calls are placed asynchronously, so
+ * independent devices proceed concurrently. The worker budget bounds how
+ * many transitions may be in flight at once, so that an ifup of hundreds
+ * of interfaces does not flood wickedd; deferred workers are picked up on
+ * the next pass, once replies or events have retired earlier transitions.
+ */
 unsigned int
 ni_fsm_schedule(ni_fsm_t *fsm)
 {
-	unsigned int i, waiting, nrequested;
+	unsigned int i, inflight, waiting, nrequested;
 
 	while (1) {
 		int made_progress = 0;
 
+		for (i = inflight = 0; i < fsm->workers.count; ++i) {
+			ni_ifworker_t *w = fsm->workers.data[i];
+
+			if (w->fsm.wait_for)
+				inflight++;
+		}
+
 		for (i = 0; i < fsm->workers.count; ++i) {
 			ni_ifworker_t *w = fsm->workers.data[i];
 			ni_fsm_transition_t *action;
@@ -5187,11 +5498,28 @@ ni_fsm_schedule(ni_fsm_t *fsm)
 				goto release;
 			}
 
+			if (action->from_state > action->next_state
+			 && !ni_ifworker_teardown_deps_done(w)) {
+				ni_debug_application("%s: defer teardown (stacked devices still going down)",
+						w->name);
+				goto release;
+			}
+
+			if (fsm->worker_budget && inflight >= fsm->worker_budget) {
+				ni_debug_application("%s: defer action (%u transitions in flight)",
+						w->name, inflight);
+				goto release;
+			}
+
 			ni_ifworker_cancel_secondary_timeout(w);
 
 			prev_state = w->fsm.state;
 			ni_fsm_events_block(fsm);
 
+			ni_timer_get_time(&action->timing.started);
+			timerclear(&action->timing.finished);
+
+			ni_fsm_trace_record(w->name, "call", "%s", action->common.method_name);
 			rv = action->call_func(fsm, w, action);
 			if (w->fsm.next_action)
 				w->fsm.next_action++;
@@ -5200,9 +5528,12 @@ ni_fsm_schedule(ni_fsm_t *fsm)
 				made_progress = 1;
 
 				if (w->fsm.wait_for) {
+					inflight++;
 					ni_debug_application("%s: waiting for event in state %s",
 						w->name, ni_ifworker_state_name(w->fsm.state));
 				} else {
+					if (!timerisset(&action->timing.finished))
+						ni_timer_get_time(&action->timing.finished);
 					ni_debug_application("%s: successfully transitioned from %s to %s",
 							w->name,
 							ni_ifworker_state_name(prev_state),
@@ -5256,6 +5587,177 @@ release:
 	return nrequested;
 }
 
+/*
+ * Report how long each transition took, per worker and aggregated
+ * across all workers; one datum per line so the output is easy to
+ * consume from scripts. Transitions which fired but did not complete
+ * (timeout, failure) are reported as pending.
+ */
+void
+ni_fsm_print_timings(const ni_fsm_t *fsm, const ni_ifworker_array_t *marked)
+{
+	struct {
+		const char *	method;
+		unsigned int	count;
+		struct timeval	total;
+		struct timeval	worst;
+	} agg[NI_IFTRANSITION_BINDINGS_MAX];
+	unsigned int i, j, naggs = 0;
+
+	for (i = 0; i < marked->count; ++i) {
+		ni_ifworker_t *w = marked->data[i];
+		ni_fsm_transition_t *action;
+
+		if (!w->fsm.action_table)
+			continue;
+
+		for (action = w->fsm.action_table; action->call_func; ++action) {
+			struct timeval delta;
+
+			if (!timerisset(&action->timing.started))
+				continue;
+
+			if (!timerisset(&action->timing.finished)) {
+				printf("transition %s %s %s %s pending\n",
+					w->name, action->common.method_name,
+					ni_ifworker_state_name(action->from_state),
+					ni_ifworker_state_name(action->next_state));
+				continue;
+			}
+
+			timersub(&action->timing.finished, &action->timing.started, &delta);
+			printf("transition %s %s %s %s %lu.%06lu\n",
+				w->name, action->common.method_name,
+				ni_ifworker_state_name(action->from_state),
+				ni_ifworker_state_name(action->next_state),
+				(unsigned long) delta.tv_sec,
+				(unsigned long) delta.tv_usec);
+
+			for (j = 0; j < naggs; ++j) {
+				if (ni_string_eq(agg[j].method, action->common.method_name))
+					break;
+			}
+			if (j == naggs) {
+				if (naggs >= NI_IFTRANSITION_BINDINGS_MAX)
+					continue;
+				agg[naggs].method = action->common.method_name;
+				agg[naggs].count = 0;
+				timerclear(&agg[naggs].total);
+				timerclear(&agg[naggs].worst);
+				naggs++;
+			}
+			agg[j].count++;
+			timeradd(&agg[j].total, &delta, &agg[j].total);
+			if (timercmp(&delta, &agg[j].worst, >))
+				agg[j].worst = delta;
+		}
+	}
+
+	for (j = 0; j < naggs; ++j) {
+		printf("aggregate %s count %u total %lu.%06lu worst %lu.%06lu\n",
+			agg[j].method, agg[j].count,
+			(unsigned long) agg[j].total.tv_sec,
+			(unsigned long) agg[j].total.tv_usec,
+			(unsigned long) agg[j].worst.tv_sec,
+			(unsigned long) agg[j].worst.tv_usec);
+	}
+}
+
+/*
+ * End-to-end trace of one client run.
+ *
+ * When enabled, the run gets a correlation uuid and every stage a
+ * worker passes through is recorded with a wall-clock timestamp: the
+ * method calls placed, the callback uuids wickedd hands back for
+ * backgrounded work, the events that retire them, state changes and
+ * the final outcome.  The callback uuids are the same ones wickedd
+ * and the supplicants log, so one report ties the client's view of
+ * e.g. a slow address acquisition to the daemon logs without
+ * correlating them by hand.
+ */
+typedef struct ni_fsm_trace_entry {
+	struct ni_fsm_trace_entry *next;
+	struct timeval		stamp;
+	char *			ifname;
+	char *			stage;
+	char *			detail;
+} ni_fsm_trace_entry_t;
+
+static ni_bool_t		__ni_fsm_trace_on;
+static ni_uuid_t		__ni_fsm_trace_uuid;
+static ni_fsm_trace_entry_t *	__ni_fsm_trace_entries;
+static ni_fsm_trace_entry_t **	__ni_fsm_trace_tail = &__ni_fsm_trace_entries;
+
+void
+ni_fsm_trace_enable(void)
+{
+	if (__ni_fsm_trace_on)
+		return;
+
+	ni_uuid_generate(&__ni_fsm_trace_uuid);
+	__ni_fsm_trace_on = TRUE;
+	ni_debug_application("tracing this run as %s", ni_uuid_print(&__ni_fsm_trace_uuid));
+}
+
+ni_bool_t
+ni_fsm_trace_enabled(void)
+{
+	return __ni_fsm_trace_on;
+}
+
+void
+ni_fsm_trace_record(const char *ifname, const char *stage, const char *fmt, ...)
+{
+	ni_fsm_trace_entry_t *entry;
+	char detail[256];
+	va_list ap;
+
+	if (!__ni_fsm_trace_on)
+		return;
+
+	detail[0] = '\0';
+	if (fmt) {
+		va_start(ap, fmt);
+		vsnprintf(detail, sizeof(detail), fmt, ap);
+		va_end(ap);
+	}
+
+	entry = xcalloc(1, sizeof(*entry));
+	ni_timer_get_time(&entry->stamp);
+	ni_string_dup(&entry->ifname, ifname);
+	ni_string_dup(&entry->stage, stage);
+	if (detail[0])
+		ni_string_dup(&entry->detail, detail);
+
+	*__ni_fsm_trace_tail = entry;
+	__ni_fsm_trace_tail = &entry->next;
+}
+
+/*
+ * Print the recorded trace, one timestamped stage per line; the
+ * timestamps are wall clock, so the lines interleave directly with
+ * syslog entries of the daemons.
+ */
+void
+ni_fsm_print_trace(void)
+{
+	ni_fsm_trace_entry_t *entry;
+
+	if (!__ni_fsm_trace_on)
+		return;
+
+	printf("trace id %s\n", ni_uuid_print(&__ni_fsm_trace_uuid));
+	for (entry = __ni_fsm_trace_entries; entry; entry = entry->next) {
+		printf("trace %lu.%06lu %s %s%s%s\n",
+			(unsigned long) entry->stamp.tv_sec,
+			(unsigned long) entry->stamp.tv_usec,
+			entry->ifname ? entry->ifname : "-",
+			entry->stage,
+			entry->detail ? " " : "",
+			entry->detail ? entry->detail : "");
+	}
+}
+
 static ni_bool_t
 ni_call_netif_refresh_tentative_addresses(ni_dbus_variant_t *result)
 {
@@ -5680,6 +6182,7 @@ ni_fsm_process_event(ni_fsm_t *fsm, ni_fsm_event_t *ev)
 	ni_ifworker_t *w;
 
 	fsm->event_seq += 1;
+	ni_ifworker_state_change_seq++;
 
 	w = ni_fsm_ifworker_by_object_path(fsm, ev->object_path);
 
@@ -5687,6 +6190,10 @@ ni_fsm_process_event(ni_fsm_t *fsm, ni_fsm_event_t *ev)
 			ni_objectmodel_event_to_signal(ev->event_type),
 			ev->object_path, ni_uuid_print(&ev->event_uuid));
 
+	ni_fsm_trace_record(w ? w->name : ev->object_path, "event", "%s uuid=%s",
+			ni_objectmodel_event_to_signal(ev->event_type),
+			ni_uuid_print(&ev->event_uuid));
+
 	/*
 	 * wickedd emits explicit events with callback uuids to the requesters
 	 * when it backgrounds execution / delivery of the result, e.g. to let
@@ -5847,15 +6354,19 @@ ni_fsm_create_client(ni_fsm_t *fsm)
 
 	client = ni_dbus_object_get_client(fsm->client_root_object);
 
-	ni_dbus_client_add_signal_handler(client, NULL, NULL,
-					NI_OBJECTMODEL_NETIF_INTERFACE,
-					interface_state_change_signal,
-					fsm);
+	/* A read-only fsm (ifstatus) never runs the event loop; don't
+	 * make the bus daemon maintain signal matches for it. */
+	if (!fsm->readonly) {
+		ni_dbus_client_add_signal_handler(client, NULL, NULL,
+						NI_OBJECTMODEL_NETIF_INTERFACE,
+						interface_state_change_signal,
+						fsm);
 
-	ni_dbus_client_add_signal_handler(client, NULL, NULL,
-					NI_OBJECTMODEL_MODEM_INTERFACE,
-					interface_state_change_signal,
-					fsm);
+		ni_dbus_client_add_signal_handler(client, NULL, NULL,
+						NI_OBJECTMODEL_MODEM_INTERFACE,
+						interface_state_change_signal,
+						fsm);
+	}
 
 	return client;
 }
@@ -25,15 +25,139 @@
 #include "config.h"
 #endif
 
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>	/* for htonl */
+
 #include <wicked/logging.h>
 #include <wicked/util.h>
 #include <gcrypt.h>
 
 struct ni_hashctx {
+	ni_hashctx_algo_t	algo;
 	gcry_md_hd_t		handle;
 	unsigned int		md_length;
+	uint32_t		crc;
 };
 
+/*
+ * CRC32C (Castagnoli polynomial, reflected). This is not run through
+ * libgcrypt: it is only a fast content checksum for change detection,
+ * and current x86 and arm64 CPUs compute it in hardware. The active
+ * implementation is selected once at first use.
+ */
+#define NI_CRC32C_POLY		0x82F63B78
+
+typedef uint32_t		__ni_crc32c_fn_t(uint32_t, const unsigned char *, size_t);
+
+static uint32_t			__ni_crc32c_table[256];
+
+static uint32_t
+__ni_crc32c_sw(uint32_t crc, const unsigned char *data, size_t len)
+{
+	while (len--)
+		crc = __ni_crc32c_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static uint32_t __attribute__((target("sse4.2")))
+__ni_crc32c_hw(uint32_t crc, const unsigned char *data, size_t len)
+{
+#ifdef __x86_64__
+	unsigned long long crc64 = crc;
+
+	for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t)) {
+		uint64_t word;
+
+		memcpy(&word, data, sizeof(word));
+		crc64 = __builtin_ia32_crc32di(crc64, word);
+		data += sizeof(word);
+	}
+	crc = crc64;
+#else
+	for (; len >= sizeof(uint32_t); len -= sizeof(uint32_t)) {
+		uint32_t word;
+
+		memcpy(&word, data, sizeof(word));
+		crc = __builtin_ia32_crc32si(crc, word);
+		data += sizeof(word);
+	}
+#endif
+	while (len--)
+		crc = __builtin_ia32_crc32qi(crc, *data++);
+	return crc;
+}
+
+static ni_bool_t
+__ni_crc32c_hw_supported(void)
+{
+	return !!__builtin_cpu_supports("sse4.2");
+}
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32		(1 << 7)
+#endif
+
+static uint32_t __attribute__((target("+crc")))
+__ni_crc32c_hw(uint32_t crc, const unsigned char *data, size_t len)
+{
+	for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t)) {
+		uint64_t word;
+
+		memcpy(&word, data, sizeof(word));
+		crc = __builtin_aarch64_crc32cx(crc, word);
+		data += sizeof(word);
+	}
+	while (len--)
+		crc = __builtin_aarch64_crc32cb(crc, *data++);
+	return crc;
+}
+
+static ni_bool_t
+__ni_crc32c_hw_supported(void)
+{
+	return !!(getauxval(AT_HWCAP) & HWCAP_CRC32);
+}
+#else
+#define __ni_crc32c_hw		NULL
+static ni_bool_t
+__ni_crc32c_hw_supported(void)
+{
+	return FALSE;
+}
+#endif
+
+static __ni_crc32c_fn_t *
+__ni_crc32c_select(void)
+{
+	uint32_t crc;
+	unsigned int i, j;
+
+	if (__ni_crc32c_hw_supported())
+		return __ni_crc32c_hw;
+
+	for (i = 0; i < 256; ++i) {
+		crc = i;
+		for (j = 0; j < 8; ++j)
+			crc = (crc >> 1) ^ (NI_CRC32C_POLY & -(crc & 1));
+		__ni_crc32c_table[i] = crc;
+	}
+	return __ni_crc32c_sw;
+}
+
+uint32_t
+ni_crc32c(uint32_t crc, const void *data, size_t len)
+{
+	static __ni_crc32c_fn_t *update;
+
+	if (update == NULL)
+		update = __ni_crc32c_select();
+	return ~update(~crc, data, len);
+}
+
 /*
  * Create a new hash context
  */
@@ -58,15 +182,28 @@ __ni_hashctx_new(int algo)
 ni_hashctx_t *
 ni_hashctx_new(ni_hashctx_algo_t algo)
 {
+	ni_hashctx_t *ctx;
+
 	switch (algo) {
 	case NI_HASHCTX_MD5:
-		return __ni_hashctx_new(GCRY_MD_MD5);
+		ctx = __ni_hashctx_new(GCRY_MD_MD5);
+		break;
 	case NI_HASHCTX_SHA1:
-		return __ni_hashctx_new(GCRY_MD_SHA1);
+		ctx = __ni_hashctx_new(GCRY_MD_SHA1);
+		break;
+
+	case NI_HASHCTX_CRC32C:
+		ctx = calloc(1, sizeof(*ctx));
+		ctx->md_length = sizeof(uint32_t);
+		break;
 
 	default:
 		return NULL;
 	}
+
+	if (ctx)
+		ctx->algo = algo;
+	return ctx;
 }
 
 /*
@@ -88,13 +225,17 @@ ni_hashctx_free(ni_hashctx_t *ctx)
 void
 ni_hashctx_begin(ni_hashctx_t *ctx)
 {
-	gcry_md_reset(ctx->handle);
+	if (ctx->algo == NI_HASHCTX_CRC32C)
+		ctx->crc = 0;
+	else
+		gcry_md_reset(ctx->handle);
 }
 
 void
 ni_hashctx_finish(ni_hashctx_t *ctx)
 {
-	gcry_md_final(ctx->handle);
+	if (ctx->algo != NI_HASHCTX_CRC32C)
+		gcry_md_final(ctx->handle);
 }
 
 unsigned int
@@ -108,6 +249,16 @@ ni_hashctx_get_digest(ni_hashctx_t *ctx, void *md_buffer, size_t md_size)
 {
 	void *md;
 
+	if (ctx->algo == NI_HASHCTX_CRC32C) {
+		/* fixed byte order, so the digest is stable across hosts */
+		uint32_t crc = htonl(ctx->crc);
+
+		if (md_size > sizeof(crc))
+			md_size = sizeof(crc);
+		memcpy(md_buffer, &crc, md_size);
+		return md_size;
+	}
+
 	if (ctx->handle == NULL)
 		return -1;
 
@@ -128,7 +279,12 @@ ni_hashctx_get_digest(ni_hashctx_t *ctx, void *md_buffer, size_t md_size)
 void
 ni_hashctx_put(ni_hashctx_t *ctx, const void *data, size_t len)
 {
-	if (data && len)
+	if (!data || !len)
+		return;
+
+	if (ctx->algo == NI_HASHCTX_CRC32C)
+		ctx->crc = ni_crc32c(ctx->crc, data, len);
+	else
 		gcry_md_write(ctx->handle, data, len);
 }
 
@@ -136,6 +292,6 @@ void
 ni_hashctx_puts(ni_hashctx_t *ctx, const char *string)
 {
 	if (string)
-		gcry_md_write(ctx->handle, string, strlen(string));
+		ni_hashctx_put(ctx, string, strlen(string));
 }
 
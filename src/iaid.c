@@ -56,6 +56,48 @@ struct ni_iaid_map {
 	struct flock		flock;
 };
 
+/*
+ * Process-wide cache of the parsed iaid map, see the duid map cache:
+ * avoid re-reading and re-parsing the map file for every device by
+ * revalidating the last parsed document against the file identity
+ * and mtime under the lock.
+ */
+static struct {
+	xml_document_t *	doc;
+	char *			file;
+	struct stat		stb;
+} ni_iaid_map_cache;
+
+static ni_bool_t
+ni_iaid_map_cache_valid(const char *file, const struct stat *stb)
+{
+	return	ni_iaid_map_cache.doc != NULL &&
+		ni_string_eq(ni_iaid_map_cache.file, file) &&
+		ni_iaid_map_cache.stb.st_dev == stb->st_dev &&
+		ni_iaid_map_cache.stb.st_ino == stb->st_ino &&
+		ni_iaid_map_cache.stb.st_size == stb->st_size &&
+		ni_iaid_map_cache.stb.st_mtim.tv_sec == stb->st_mtim.tv_sec &&
+		ni_iaid_map_cache.stb.st_mtim.tv_nsec == stb->st_mtim.tv_nsec;
+}
+
+static void
+ni_iaid_map_cache_store(const ni_iaid_map_t *map, const struct stat *stb)
+{
+	if (ni_iaid_map_cache.doc != map->doc)
+		xml_document_free(ni_iaid_map_cache.doc);
+	ni_iaid_map_cache.doc = map->doc;
+	ni_string_dup(&ni_iaid_map_cache.file, map->file);
+	ni_iaid_map_cache.stb = *stb;
+}
+
+static void
+ni_iaid_map_cache_dirty(const ni_iaid_map_t *map)
+{
+	/* in-memory changes not written back yet; force a re-read */
+	if (map && map->doc && map->doc == ni_iaid_map_cache.doc)
+		memset(&ni_iaid_map_cache.stb, 0, sizeof(ni_iaid_map_cache.stb));
+}
+
 static ni_iaid_map_t *
 ni_iaid_map_new(void)
 {
@@ -113,7 +155,8 @@ ni_iaid_map_free(ni_iaid_map_t *map)
 			close(map->fd);
 			map->fd = -1;
 		}
-		xml_document_free(map->doc);
+		if (map->doc != ni_iaid_map_cache.doc)
+			xml_document_free(map->doc);
 		ni_string_free(&map->file);
 		free(map);
 	}
@@ -157,6 +200,7 @@ ni_iaid_map_load(const char *filename)
 	const char *type;
 	ni_buffer_t buff;
 	struct stat stb;
+	ni_bool_t have_stb;
 	ssize_t len;
 
 	if (!(map = ni_iaid_map_new())) {
@@ -203,8 +247,12 @@ ni_iaid_map_load(const char *filename)
 		goto failure;
 	}
 
-	if (fstat(map->fd, &stb) < 0)
+	if (!(have_stb = fstat(map->fd, &stb) == 0)) {
 		stb.st_size = BUFSIZ;
+	} else if (ni_iaid_map_cache_valid(map->file, &stb)) {
+		map->doc = ni_iaid_map_cache.doc;
+		return map;
+	}
 
 	ni_buffer_init_dynamic(&buff, stb.st_size + 1);
 	do {
@@ -227,6 +275,8 @@ ni_iaid_map_load(const char *filename)
 			map->doc = xml_document_new();
 			ni_warn("unable to parse %s iaid map file name (%s): %m", type, map->file);
 		}
+		if (have_stb)
+			ni_iaid_map_cache_store(map, &stb);
 		return map;
 	}
 
@@ -240,6 +290,7 @@ ni_iaid_map_save(ni_iaid_map_t *map)
 {
 	char *data = NULL;
 	size_t off, len;
+	struct stat stb;
 	ssize_t ret;
 
 	if (!map || map->fd < 0)
@@ -267,7 +318,13 @@ ni_iaid_map_save(ni_iaid_map_t *map)
 	}
 	free(data);
 
-	return ret < 0 ? FALSE : TRUE;
+	if (ret < 0)
+		return FALSE;
+
+	/* the written document is up to date again; recache it */
+	if (fstat(map->fd, &stb) == 0)
+		ni_iaid_map_cache_store(map, &stb);
+	return TRUE;
 }
 
 static xml_node_t *
@@ -381,6 +438,7 @@ ni_iaid_map_set(ni_iaid_map_t *map, const char *name, unsigned int iaid)
 	if (!(root = ni_iaid_map_root_node(map)) || ni_string_empty(name))
 		return FALSE;
 
+	ni_iaid_map_cache_dirty(map);
 	while ((node = ni_iaid_map_next_node(root, node))) {
 		attr = xml_node_get_attr(node, NI_CONFIG_DEFAULT_IAID_DEVICE);
 		if (!ni_string_eq(name, attr))
@@ -415,6 +473,7 @@ ni_iaid_map_del_name(ni_iaid_map_t *map, const char *name)
 		if (!ni_string_eq(name, attr))
 			continue;
 
+		ni_iaid_map_cache_dirty(map);
 		xml_node_detach(node);
 		xml_node_free(node);
 		return TRUE;
@@ -435,6 +494,7 @@ ni_iaid_map_del_iaid(ni_iaid_map_t *map, unsigned int iaid)
 		if (!ni_iaid_map_node_to_iaid(node, &curr) || iaid != curr)
 			continue;
 
+		ni_iaid_map_cache_dirty(map);
 		xml_node_detach(node);
 		xml_node_free(node);
 		return TRUE;
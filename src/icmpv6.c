@@ -166,6 +166,7 @@ ni_icmpv6_ra_socket_open(ni_icmpv6_ra_socket_t *ras)
 		close(fd);
 		return FALSE;
 	}
+	ras->sock->priority = NI_SOCKET_PRIO_PROTOCOL;
 	ras->sock->user_data = ras;
 	return TRUE;
 }
@@ -79,6 +79,7 @@
 #include "kernel.h"
 #include "appconfig.h"
 #include "process.h"
+#include "phasestats.h"
 #include "debug.h"
 #include "modprobe.h"
 #include "pppd.h"
@@ -125,7 +126,8 @@ static int	__ni_netdev_update_mtu(ni_netconfig_t *nc, ni_netdev_t *dev,
 				const ni_addrconf_lease_t *old_lease,
 				ni_addrconf_lease_t       *new_lease);
 
-static int	__ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg);
+static int	__ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+				struct ni_nlmsg_list *echo);
 static int	__ni_rtnl_link_change(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cfg);
 
 static int	__ni_rtnl_link_change_mtu(ni_netdev_t *dev, unsigned int mtu);
@@ -139,17 +141,20 @@ static int	__ni_rtnl_link_add_port_up(const ni_netdev_t *, const char *, unsigne
 static int	__ni_rtnl_link_add_slave_down(const ni_netdev_t *, const char *, unsigned int);
 
 static int	__ni_rtnl_send_deladdr(ni_netdev_t *, const ni_address_t *);
-static int	__ni_rtnl_send_newaddr(ni_netdev_t *, const ni_address_t *, int);
+static int	__ni_rtnl_send_newaddr(ni_nl_batch_t *, ni_netdev_t *, const ni_address_t *, int);
 static int	__ni_rtnl_send_delroute(ni_netdev_t *, ni_route_t *);
-static int	__ni_rtnl_send_newroute(ni_netdev_t *, ni_route_t *, int);
+static int	__ni_rtnl_send_newroute(ni_nl_batch_t *, ni_netdev_t *, ni_route_t *, int);
 static int	__ni_rtnl_send_newrule(const ni_rule_t *, int);
 static int	__ni_rtnl_send_delrule(const ni_rule_t *);
 
+static void	__ni_rtnl_pace(void);
+
 static int	addattr_sockaddr(struct nl_msg *, int, const ni_sockaddr_t *);
 
 static int	__ni_system_netdev_create(ni_netconfig_t *nc,
 					const char *ifname, unsigned int ifindex,
-					ni_iftype_t iftype, ni_netdev_t **dev_ret);
+					ni_iftype_t iftype, struct ni_nlmsg_list *echo,
+					ni_netdev_t **dev_ret);
 
 static int	ni_system_bond_setup_netlink(ni_netconfig_t *, ni_netdev_t *, const ni_netdev_t *);
 
@@ -981,6 +986,8 @@ ni_addrconf_updater_execute(ni_netdev_t *dev, ni_addrconf_lease_t *lease)
 		} else {
 			timerclear(&delta);
 		}
+		ni_phasestats_record(NI_PHASE_UPDATER_RUN,
+				delta.tv_sec * 1000000ULL + delta.tv_usec);
 		ni_debug_ifconfig("%s: updater for lease %s:%s in state %s finished: %s [%ldm%ld.%03lds]",
 				dev->name,
 				ni_addrfamily_type_to_name(lease->family),
@@ -1334,7 +1341,9 @@ int
 ni_system_vlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 						ni_netdev_t **dev_ret)
 {
+	struct ni_nlmsg_list echo;
 	ni_netdev_t *dev;
+	int err;
 
 	if (!nc || !dev_ret || !cfg || !cfg->name || !cfg->vlan
 	||  !cfg->link.lowerdev.name || !cfg->link.lowerdev.index)
@@ -1351,12 +1360,16 @@ ni_system_vlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 	}
 
 	ni_debug_ifconfig("%s: creating VLAN device", cfg->name);
-	if (__ni_rtnl_link_create(nc, cfg)) {
+	ni_nlmsg_list_init(&echo);
+	if (__ni_rtnl_link_create(nc, cfg, &echo)) {
 		ni_error("unable to create vlan interface %s", cfg->name);
+		ni_nlmsg_list_destroy(&echo);
 		return -1;
 	}
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_VLAN, dev_ret);
+	err = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_VLAN, &echo, dev_ret);
+	ni_nlmsg_list_destroy(&echo);
+	return err;
 }
 
 int
@@ -1385,8 +1398,10 @@ int
 ni_system_vxlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 						ni_netdev_t **dev_ret)
 {
+	struct ni_nlmsg_list echo;
 	ni_netdev_t *dev;
 	const char *iftype = NULL;
+	int err;
 
 	if (!nc || !dev_ret || !cfg || !cfg->name || !cfg->vxlan)
 		return -1;
@@ -1411,12 +1426,16 @@ ni_system_vxlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 	iftype = ni_linktype_type_to_name(cfg->link.type);
 	ni_debug_ifconfig("%s: creating %s interface", cfg->name, iftype);
 
-	if (__ni_rtnl_link_create(nc, cfg)) {
+	ni_nlmsg_list_init(&echo);
+	if (__ni_rtnl_link_create(nc, cfg, &echo)) {
 		ni_error("%s: unable to create %s interface", cfg->name, iftype);
+		ni_nlmsg_list_destroy(&echo);
 		return -1;
 	}
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, dev_ret);
+	err = __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, &echo, dev_ret);
+	ni_nlmsg_list_destroy(&echo);
+	return err;
 }
 
 int
@@ -1443,8 +1462,10 @@ int
 ni_system_macvlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 						ni_netdev_t **dev_ret)
 {
+	struct ni_nlmsg_list echo;
 	ni_netdev_t *dev;
 	const char *cfg_iftype = NULL;
+	int err;
 
 	if (!nc || !dev_ret || !cfg || !cfg->name || !cfg->macvlan
 	||  !cfg->link.lowerdev.name || !cfg->link.lowerdev.index)
@@ -1470,13 +1491,17 @@ ni_system_macvlan_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 	cfg_iftype = ni_linktype_type_to_name(cfg->link.type);
 	ni_debug_ifconfig("%s: creating %s interface", cfg->name, cfg_iftype);
 
-	if (__ni_rtnl_link_create(nc, cfg)) {
+	ni_nlmsg_list_init(&echo);
+	if (__ni_rtnl_link_create(nc, cfg, &echo)) {
 		ni_error("unable to create %s interface %s",
 			cfg_iftype, cfg->name);
+		ni_nlmsg_list_destroy(&echo);
 		return -1;
 	}
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, dev_ret);
+	err = __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, &echo, dev_ret);
+	ni_nlmsg_list_destroy(&echo);
+	return err;
 }
 
 int
@@ -1505,6 +1530,7 @@ int
 ni_system_dummy_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 						ni_netdev_t **dev_ret)
 {
+	struct ni_nlmsg_list echo;
 	ni_netdev_t *dev;
 	int err;
 
@@ -1532,12 +1558,16 @@ ni_system_dummy_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 
 	ni_debug_ifconfig("%s: creating dummy interface", cfg->name);
 
-	if ((err = __ni_rtnl_link_create(nc, cfg)) && abs(err) != NLE_EXIST) {
+	ni_nlmsg_list_init(&echo);
+	if ((err = __ni_rtnl_link_create(nc, cfg, &echo)) && abs(err) != NLE_EXIST) {
 		ni_error("unable to create dummy interface %s", cfg->name);
+		ni_nlmsg_list_destroy(&echo);
 		return err;
 	}
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_DUMMY, dev_ret);
+	err = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_DUMMY, &echo, dev_ret);
+	ni_nlmsg_list_destroy(&echo);
+	return err;
 }
 
 int
@@ -1667,7 +1697,7 @@ ni_system_infiniband_child_create(ni_netconfig_t *nc,
 	if (__ni_system_infiniband_setup(cfg->name, ib->mode, ib->umcast) < 0)
 		return -1; /* error reported */
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_INFINIBAND_CHILD, dev_ret);
+	return __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_INFINIBAND_CHILD, NULL, dev_ret);
 }
 
 /*
@@ -1714,7 +1744,7 @@ ni_system_bridge_create(ni_netconfig_t *nc, const char *ifname,
 		return -1;
 	}
 
-	return __ni_system_netdev_create(nc, ifname, 0, NI_IFTYPE_BRIDGE, dev_ret);
+	return __ni_system_netdev_create(nc, ifname, 0, NI_IFTYPE_BRIDGE, NULL, dev_ret);
 }
 
 /*
@@ -1766,7 +1796,8 @@ ni_system_bridge_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_bridge_t *
 int
 ni_system_bridge_shutdown(ni_netdev_t *dev)
 {
-	ni_bridge_t *bridge = dev->bridge;
+	ni_bridge_t *bridge = dev->bridge_stale ?
+			ni_netdev_get_bridge(dev) : dev->bridge;
 	unsigned int i;
 
 	if (!bridge)
@@ -1943,7 +1974,7 @@ ni_system_ovs_bridge_create(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netde
 	}
 
 	ret = __ni_system_netdev_create(nc, cfg->name, dev ? dev->link.ifindex : 0,
-					NI_IFTYPE_OVS_BRIDGE, dev_ret);
+					NI_IFTYPE_OVS_BRIDGE, NULL, dev_ret);
 	return ret;
 }
 
@@ -2020,7 +2051,7 @@ ni_system_bond_create_sysfs(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netde
 		}
 	}
 
-	ret = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_BOND, dev_ret);
+	ret = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_BOND, NULL, dev_ret);
 	if (ret == 0 /* && cfg->bonding */)
 		ni_system_bond_setup(nc, *dev_ret, cfg);
 
@@ -2030,16 +2061,22 @@ ni_system_bond_create_sysfs(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netde
 int
 ni_system_bond_create_netlink(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netdev_t **dev_ret)
 {
+	struct ni_nlmsg_list echo;
 	int ret;
 
 	/* Load the bonding module */
 	if (ni_bonding_load(NULL) < 0)
 		return -1;
 
-	if ((ret = __ni_rtnl_link_create(nc, cfg)))
+	ni_nlmsg_list_init(&echo);
+	if ((ret = __ni_rtnl_link_create(nc, cfg, &echo))) {
+		ni_nlmsg_list_destroy(&echo);
 		return -NI_ERROR_CANNOT_CONFIGURE_DEVICE;
+	}
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_BOND, dev_ret);
+	ret = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_BOND, &echo, dev_ret);
+	ni_nlmsg_list_destroy(&echo);
+	return ret;
 }
 
 int
@@ -2294,7 +2331,7 @@ ni_system_team_create(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netdev_t **
 		usleep(25000);
 	}
 
-	ret = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_TEAM, dev_ret);
+	ret = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_TEAM, NULL, dev_ret);
 	if (dev_ret && *dev_ret) {
 		ni_teamd_discover(*dev_ret);
 	}
@@ -2381,7 +2418,7 @@ ni_system_tuntap_create(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netdev_t
 		return -1;
 	}
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, dev_ret);
+	return __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, NULL, dev_ret);
 }
 
 int
@@ -2425,7 +2462,7 @@ ni_system_ppp_create(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netdev_t **d
 		usleep(25000);
 	}
 
-	ret = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_PPP, dev_ret);
+	ret = __ni_system_netdev_create(nc, cfg->name, 0, NI_IFTYPE_PPP, NULL, dev_ret);
 	if (ret < 0)
 		ni_pppd_config_file_remove(cfg->name);
 	else if (dev_ret && *dev_ret) {
@@ -2529,7 +2566,9 @@ int
 ni_system_tunnel_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 		ni_netdev_t **dev_ret, unsigned int type)
 {
+	struct ni_nlmsg_list echo;
 	ni_netdev_t *dev;
+	int err;
 
 	if (!nc || !dev_ret || !cfg || !cfg->name)
 		return -1;
@@ -2560,13 +2599,17 @@ ni_system_tunnel_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
 		return -1;
 	}
 
-	if (__ni_rtnl_link_create(nc, cfg)) {
+	ni_nlmsg_list_init(&echo);
+	if (__ni_rtnl_link_create(nc, cfg, &echo)) {
 		ni_error("unable to create %s tunnel %s", ni_linktype_type_to_name(type),
 			cfg->name);
+		ni_nlmsg_list_destroy(&echo);
 		return -1;
 	}
 
-	return __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, dev_ret);
+	err = __ni_system_netdev_create(nc, cfg->name, 0, cfg->link.type, &echo, dev_ret);
+	ni_nlmsg_list_destroy(&echo);
+	return err;
 }
 
 /*
@@ -3899,8 +3942,59 @@ nla_put_failure:
 	return -1;
 }
 
+/*
+ * Pace netlink configuration transactions.
+ *
+ * A policy reload touching many interfaces applies changes as fast as
+ * the FSM feeds them, saturating rtnetlink and causing RTNL lock
+ * contention in the kernel, which slows down everything holding that
+ * lock including unrelated tools. A token bucket throttles the
+ * transaction rate to the configured <netlink-pacing> budget; the
+ * burst allowance is handed out without any delay, so short operator
+ * initiated operations on a single interface never wait, while bulk
+ * reloads drain the bucket and get spread out over time.
+ */
+static void
+__ni_rtnl_pace(void)
+{
+	static struct timeval	last;
+	static long		credit = -1;
+	unsigned int		rate, burst;
+	struct timeval		now, delta;
+	long			cost, limit;
+
+	if ((rate = ni_config_rtnl_pacing_rate()) == 0)
+		return;
+
+	cost = 1000000L / rate;
+	if ((burst = ni_config_rtnl_pacing_burst()) == 0)
+		burst = 1;
+	limit = (long)burst * cost;
+
+	ni_timer_get_time(&now);
+	if (credit < 0) {
+		/* the first transaction starts with a full burst */
+		credit = limit;
+	} else {
+		timersub(&now, &last, &delta);
+		credit += delta.tv_sec * 1000000L + delta.tv_usec;
+		if (credit > limit)
+			credit = limit;
+	}
+	last = now;
+
+	if (credit < cost) {
+		usleep(cost - credit);
+		ni_timer_get_time(&last);
+		credit = 0;
+	} else {
+		credit -= cost;
+	}
+}
+
 static int
-__ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg)
+__ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg,
+			struct ni_nlmsg_list *echo)
 {
 	struct ifinfomsg ifi;
 	struct nl_msg *msg;
@@ -3912,7 +4006,13 @@ __ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg)
 	memset(&ifi, 0, sizeof(ifi));
 	ifi.ifi_family = AF_UNSPEC;
 
-	msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL);
+	/* Ask the kernel to echo the created link back to us, so the
+	 * caller can pick up the new index and link info right from the
+	 * reply instead of a separate lookup plus link dump per device.
+	 * Kernels without RTM_NEWLINK echo support just send the ack,
+	 * leaving the list empty, and the caller falls back. */
+	msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_CREATE | NLM_F_EXCL |
+					(echo ? NLM_F_ECHO : 0));
 	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
 		goto nla_put_failure;
 
@@ -3989,7 +4089,8 @@ __ni_rtnl_link_create(ni_netconfig_t *nc, const ni_netdev_t *cfg)
 	}
 
 	/* Actually capture the netlink -error code for use by callers. */
-	if ((err = ni_nl_talk(msg, NULL)))
+	__ni_rtnl_pace();
+	if ((err = ni_nl_talk(msg, echo)))
 		goto failed;
 
 	ni_debug_ifconfig("successfully created interface %s", cfg->name);
@@ -4075,6 +4176,7 @@ __ni_rtnl_link_change(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *c
 		break;
 	}
 
+	__ni_rtnl_pace();
 	if (ni_nl_talk(msg, NULL))
 		goto failed;
 
@@ -4109,6 +4211,7 @@ __ni_rtnl_link_change_hwaddr(ni_netdev_t *dev, const ni_hwaddr_t *hwaddr)
 	if (__ni_rtnl_link_put_hwaddr(msg, hwaddr) < 0)
 		goto nla_put_failure;
 
+	__ni_rtnl_pace();
 	if (ni_nl_talk(msg, NULL))
 		goto failed;
 
@@ -4148,6 +4251,7 @@ __ni_rtnl_link_change_mtu(ni_netdev_t *dev, unsigned int mtu)
 	if (__ni_rtnl_link_put_mtu(msg, mtu) < 0)
 		goto nla_put_failure;
 
+	__ni_rtnl_pace();
 	if ((err = ni_nl_talk(msg, NULL))) {
 		ni_error("failed to modify interface %s mtu to %u: %s",
 				dev->name, mtu, nl_geterror(err));
@@ -4188,6 +4292,7 @@ __ni_rtnl_link_rename(unsigned int ifindex, const char *oldname, const char *new
 	if ((err = __ni_rtnl_link_put_ifname(msg, newname)) < 0)
 		goto nla_put_failure;
 
+	__ni_rtnl_pace();
 	if ((err = ni_nl_talk(msg, NULL)))
 		goto failed;
 
@@ -4219,6 +4324,7 @@ __ni_rtnl_simple(int msgtype, unsigned int flags, void *data, size_t len)
 	if ((rv = nlmsg_append(msg, data, len, NLMSG_ALIGNTO))) {
 		ni_error("%s: nlmsg_append failed: %s", __func__,  nl_geterror(rv));
 	} else
+	__ni_rtnl_pace();
 	if ((rv = ni_nl_talk(msg, NULL))) {
 		ni_debug_ifconfig("%s: rtnl_talk failed: %s", __func__,  nl_geterror(rv));
 	}
@@ -4291,6 +4397,7 @@ __ni_rtnl_link_add_port_up(const ni_netdev_t *port, const char *mname, unsigned
 
 	NLA_PUT_U32(msg, IFLA_MASTER, mindex);
 
+	__ni_rtnl_pace();
 	if (ni_nl_talk(msg, NULL))
 		goto failed;
 
@@ -4330,6 +4437,7 @@ __ni_rtnl_link_add_slave_down(const ni_netdev_t *slave, const char *mname, unsig
 
 	NLA_PUT_U32(msg, IFLA_MASTER, mindex);
 
+	__ni_rtnl_pace();
 	if (ni_nl_talk(msg, NULL) < 0)
 		goto failed;
 
@@ -4386,6 +4494,7 @@ __ni_rtnl_link_up(const ni_netdev_t *dev, const ni_netdev_req_t *cfg)
 		/* FIXME: handle COST, QDISC, MASTER */
 	}
 
+	__ni_rtnl_pace();
 	if ((rv = ni_nl_talk(msg, NULL)) < 0) {
 		if (errno == ERFKILL)
 			rv = -NI_ERROR_RADIO_DISABLED;
@@ -4454,7 +4563,7 @@ __ni_netdev_address_in_list(ni_address_t *list, const ni_address_t *ap)
 }
 
 static int
-__ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
+__ni_rtnl_send_newaddr(ni_nl_batch_t *batch, ni_netdev_t *dev, const ni_address_t *ap, int flags)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	unsigned int omit = IFA_F_TENTATIVE|IFA_F_DADFAILED;
@@ -4539,7 +4648,8 @@ __ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 			goto nla_put_failure;
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
+	__ni_rtnl_pace();
+	if ((err = ni_nl_batch_talk(batch, msg)) && abs(err) != NLE_EXIST) {
 		ni_error("%s(%s/%u): ni_nl_talk failed [%s]", __func__,
 				ni_sockaddr_print(&ap->local_addr),
 				ap->prefixlen,  nl_geterror(err));
@@ -4585,6 +4695,7 @@ __ni_rtnl_send_deladdr(ni_netdev_t *dev, const ni_address_t *ap)
 			goto nla_put_failure;
 	}
 
+	__ni_rtnl_pace();
 	if ((err = ni_nl_talk(msg, NULL)) < 0) {
 		ni_error("%s(%s/%u): rtnl_talk failed: %s", __func__,
 				ni_sockaddr_print(&ap->local_addr),
@@ -4606,7 +4717,7 @@ failed:
  * Add a static route
  */
 static int
-__ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
+__ni_rtnl_send_newroute(ni_nl_batch_t *batch, ni_netdev_t *dev, ni_route_t *rp, int flags)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct rtmsg rt;
@@ -4797,7 +4908,8 @@ __ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
 		nla_nest_end(msg, mxrta);
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
+	__ni_rtnl_pace();
+	if ((err = ni_nl_batch_talk(batch, msg)) && abs(err) != NLE_EXIST) {
 		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 		ni_error("%s(%s): ni_nl_talk failed [%s]", __FUNCTION__,
 				ni_route_print(&buf, rp),  nl_geterror(err));
@@ -4850,6 +4962,7 @@ __ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
 
 	NLA_PUT_U32(msg, RTA_OIF, dev->link.ifindex);
 
+	__ni_rtnl_pace();
 	if (ni_nl_talk(msg, NULL) < 0) {
 		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_route_print(&buf, rp));
 		ni_stringbuf_destroy(&buf);
@@ -4944,6 +5057,7 @@ __ni_rtnl_send_newrule(const ni_rule_t *rule, int flags)
 	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
 		goto nla_put_failure;
 
+	__ni_rtnl_pace();
 	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
 		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
 		ni_stringbuf_destroy(&buf);
@@ -4988,6 +5102,7 @@ __ni_rtnl_send_delrule(const ni_rule_t *rule)
 	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
 		goto nla_put_failure;
 
+	__ni_rtnl_pace();
 	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_OBJ_NOTFOUND) {
 		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
 		ni_stringbuf_destroy(&buf);
@@ -5332,6 +5447,7 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 {
 	unsigned int max_changes = NI_ADDRCONF_UPDATER_MAX_ADDR_CHANGES;
 	ni_addrconf_mode_t owner = NI_ADDRCONF_NONE;
+	ni_nl_batch_t batch = NI_NL_BATCH_INIT;
 	ni_address_updater_t *au;
 	unsigned int family = AF_UNSPEC;
 	ni_address_t *ap, *next;
@@ -5441,7 +5557,7 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 			if (!ni_address_lft_is_valid(new_addr, NULL))
 				continue;
 
-			if ((rv = __ni_rtnl_send_newaddr(dev, new_addr, NLM_F_REPLACE)) < 0)
+			if ((rv = __ni_rtnl_send_newaddr(NULL, dev, new_addr, NLM_F_REPLACE)) < 0)
 				continue;
 
 			new_addr->owner = new_lease->type;
@@ -5495,14 +5611,21 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 				ap->prefixlen);
 
 		__ni_netdev_addr_complete(dev, ap);
-		if ((rv = __ni_rtnl_send_newaddr(dev, ap, NLM_F_CREATE)) < 0)
+		if ((rv = __ni_rtnl_send_newaddr(&batch, dev, ap, NLM_F_CREATE)) < 0) {
+			ni_nl_batch_flush(&batch);
 			return rv;
+		}
 
 		ap->owner = new_lease->type;
 
 		ni_arp_notify_add_address(&au->notify, ap);
 	}
 
+	/* Collect the acks for the pipelined requests; a failure is
+	 * reported here and gets corrected by the next refresh. */
+	if ((rv = ni_nl_batch_flush(&batch)) < 0)
+		return rv;
+
 	if (family == AF_INET && ni_address_updater_arp_send(updater, dev))
 		return 1;
 
@@ -5577,11 +5700,12 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_addrconf_mode_t old_type = NI_ADDRCONF_NONE;
+	ni_nl_batch_t batch = NI_NL_BATCH_INIT;
 	unsigned int family = AF_UNSPEC;
 	ni_route_table_t *tab, *cfg_tab;
 	ni_route_t *rp, *new_route;
 	unsigned int minprio, i;
-	int rv = 0;
+	int rv = 0, err;
 
 	do {
 		__ni_global_seqno++;
@@ -5654,7 +5778,7 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 			}
 
 			if (new_route != NULL) {
-				if (__ni_rtnl_send_newroute(dev, new_route, NLM_F_REPLACE) >= 0) {
+				if (__ni_rtnl_send_newroute(NULL, dev, new_route, NLM_F_REPLACE) >= 0) {
 					ni_debug_ifconfig("%s: successfully updated existing route %s",
 							dev->name, ni_route_print(&buf, rp));
 					ni_stringbuf_destroy(&buf);
@@ -5699,7 +5823,7 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_route_print(&buf, rp));
 			ni_stringbuf_destroy(&buf);
 
-			if ((rv = __ni_rtnl_send_newroute(dev, rp, NLM_F_CREATE)) < 0)
+			if ((rv = __ni_rtnl_send_newroute(&batch, dev, rp, NLM_F_CREATE)) < 0)
 				continue;
 
 			rp->owner = new_lease->type;
@@ -5708,6 +5832,11 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 		}
 	}
 
+	/* Collect the acks for the pipelined requests; a failure is
+	 * reported here and gets corrected by the next refresh. */
+	if ((err = ni_nl_batch_flush(&batch)) < 0 && rv >= 0)
+		rv = err;
+
 	return rv;
 }
 
@@ -6106,6 +6235,33 @@ __ni_netdev_update_mtu(ni_netconfig_t *nc, ni_netdev_t *dev,
 }
 
 
+/*
+ * Find the RTM_NEWLINK the kernel echoed back for a created interface.
+ * The match is done by ifname, so an echo belonging to some other
+ * object in the reply list can never be picked up by accident.
+ */
+static struct nlmsghdr *
+__ni_system_netdev_echo_find(struct ni_nlmsg_list *echo, const char *ifname)
+{
+	struct ni_nlmsg *entry;
+
+	for (entry = echo ? echo->head : NULL; entry; entry = entry->next) {
+		struct nlmsghdr *h = &entry->h;
+		struct ifinfomsg *ifi;
+		struct nlattr *nla;
+
+		if (!(ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)))
+			continue;
+
+		if (!(nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME)))
+			continue;
+
+		if (ni_string_eq(ifname, nla_get_string(nla)))
+			return h;
+	}
+	return NULL;
+}
+
 /*
  * Initialialize a netdev of a just created inteface.
  *
@@ -6118,9 +6274,11 @@ __ni_netdev_update_mtu(ni_netconfig_t *nc, ni_netdev_t *dev,
 static int
 __ni_system_netdev_create(ni_netconfig_t *nc,
 				const char *ifname, unsigned int ifindex,
-				ni_iftype_t iftype, ni_netdev_t **dev_ret)
+				ni_iftype_t iftype, struct ni_nlmsg_list *echo,
+				ni_netdev_t **dev_ret)
 {
 	const char *type = ni_linktype_type_to_name(iftype);
+	struct nlmsghdr *h = NULL;
 	ni_netdev_t *dev;
 
 	if (!ifname || !type || iftype == NI_IFTYPE_UNKNOWN) {
@@ -6129,6 +6287,9 @@ __ni_system_netdev_create(ni_netconfig_t *nc,
 		return -1;
 	}
 
+	if (!ifindex && (h = __ni_system_netdev_echo_find(echo, ifname)))
+		ifindex = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)->ifi_index;
+
 	if (!ifindex && !(ifindex = if_nametoindex(ifname))) {
 		ni_error("%s: created %s interface, but can't find it's index",
 				ifname, type);
@@ -6155,7 +6316,13 @@ __ni_system_netdev_create(ni_netconfig_t *nc,
 	/* Hmm... init just the base link properties (e.g. type) or
 	 * do we required to discover furher things (vlan,bridge)?
 	 */
-	__ni_device_refresh_link_info(nc, &dev->link);
+	if (h) {
+		/* the echoed RTM_NEWLINK carries the full link info */
+		__ni_netdev_process_newlink(dev, h,
+				ni_rtnl_ifinfomsg(h, RTM_NEWLINK), nc);
+	} else {
+		__ni_device_refresh_link_info(nc, &dev->link);
+	}
 
 	/* Mark to emit device-create in next newlink event later */
 	dev->created = 1;
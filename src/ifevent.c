@@ -11,8 +11,11 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <netlink/msg.h>
+#include <netinet/in.h>
 #include <netinet/icmp6.h>
+#include <linux/filter.h>
 
 #include <wicked/types.h>
 #include <wicked/netinfo.h>
@@ -27,6 +30,10 @@
 #include "sysfs.h"
 #include "kernel.h"
 #include "appconfig.h"
+#include "stats.h"
+#include "flight.h"
+#include "trace.h"
+#include "nlcapture.h"
 
 #ifndef NI_ND_OPT_RDNSS_INFORMATION
 #define NI_ND_OPT_RDNSS_INFORMATION	25	/* RFC 5006 */
@@ -59,6 +66,11 @@ typedef struct ni_rtevent_handle
 {
 	struct nl_sock *nlsock;
 	ni_uint_array_t	groups;
+
+	/* optional kernel-side event filter, see
+	 * ni_server_filter_interface_addr_events() */
+	ni_bool_t	iffilter_set;
+	ni_uint_array_t	iffilter;
 } ni_rtevent_handle_t;
 
 /*
@@ -66,6 +78,33 @@ typedef struct ni_rtevent_handle
  */
 static ni_socket_t *	__ni_rtevent_sock;
 
+/*
+ * Adaptive receive buffer handling.
+ *
+ * An overrun of the event socket costs a full state re-dump; when one
+ * happens, the receive buffer was too small for a burst the system
+ * does produce, so the listener restarts with a doubled buffer up to
+ * NI_RTEVENT_RECV_BUFF_MAX. Independent of that, a socket filled
+ * beyond half of its buffer is drained in bulk recvmmsg(2) bursts
+ * ahead of the per message processing, emptying the kernel queue
+ * several messages per syscall before it can overrun.
+ */
+#define NI_RTEVENT_RECV_BUFF_MAX	(16U << 20)
+#define NI_RTEVENT_BULK_BURST		32	/* datagrams per recvmmsg */
+#define NI_RTEVENT_BULK_SIZE		8192	/* buffer per datagram	  */
+
+#ifndef SO_MEMINFO
+#define SO_MEMINFO			55
+#endif
+#ifndef SK_MEMINFO_RMEM_ALLOC
+#define SK_MEMINFO_RMEM_ALLOC		0
+#endif
+#ifndef SK_MEMINFO_RCVBUF
+#define SK_MEMINFO_RCVBUF		1
+#endif
+
+static unsigned int	__ni_rtevent_recv_buff_cur;	/* grown size	  */
+
 static int	__ni_rtevent_process(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_newlink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_dellink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
@@ -79,6 +118,108 @@ static int	__ni_rtevent_delrule(ni_netconfig_t *, const struct sockaddr_nl *, st
 static int	__ni_rtevent_nduseropt(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 
 
+/*
+ * Event coalescing. During rtnetlink storms (e.g. a bond with hundreds
+ * of VLANs flapping), every state transition wakes up all listeners
+ * individually. With a coalescing window configured, device-level
+ * events are accumulated per ifindex in a bitmap of event types and a
+ * single aggregated batch is delivered when the window expires.
+ * Create, delete and rename events bypass the window, as listeners
+ * maintain object registrations and name bindings on them in order.
+ * Listeners consult the current device state, so collapsing a series
+ * of transitions into one notification per type is safe.
+ */
+typedef struct ni_rtevent_pending ni_rtevent_pending_t;
+struct ni_rtevent_pending {
+	ni_rtevent_pending_t *	next;
+	unsigned int		ifindex;
+	unsigned int		mask;		/* bitmask of ni_event_t */
+};
+
+static unsigned int		ni_rtevent_coalesce_msec;	/* 0: deliver immediately */
+static ni_rtevent_pending_t *	ni_rtevent_pending_list;
+static const ni_timer_t *	ni_rtevent_coalesce_timer;
+
+static void
+__ni_rtevent_coalesce_flush(void)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_rtevent_pending_t *pending;
+	ni_netdev_t *dev;
+	unsigned int ev;
+
+	while ((pending = ni_rtevent_pending_list) != NULL) {
+		ni_rtevent_pending_list = pending->next;
+
+		/* The device may be gone; its delete event was immediate */
+		if (nc && (dev = ni_netdev_by_index(nc, pending->ifindex))) {
+			for (ev = 0; pending->mask && ev < 32; ++ev) {
+				if (!(pending->mask & (1 << ev)))
+					continue;
+				pending->mask &= ~(1 << ev);
+				if (ni_global.interface_event)
+					ni_global.interface_event(dev, ev);
+			}
+		}
+		free(pending);
+	}
+}
+
+static void
+__ni_rtevent_coalesce_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_rtevent_coalesce_timer = NULL;
+	__ni_rtevent_coalesce_flush();
+}
+
+static ni_bool_t
+__ni_rtevent_coalesce(const ni_netdev_t *dev, ni_event_t ev)
+{
+	ni_rtevent_pending_t *pending, **pos;
+
+	if (!ni_rtevent_coalesce_msec || (unsigned int)ev >= 32)
+		return FALSE;
+
+	switch (ev) {
+	case NI_EVENT_DEVICE_CREATE:
+	case NI_EVENT_DEVICE_DELETE:
+	case NI_EVENT_DEVICE_RENAME:
+		return FALSE;
+	default:
+		break;
+	}
+
+	for (pos = &ni_rtevent_pending_list; (pending = *pos) != NULL; pos = &pending->next) {
+		if (pending->ifindex == dev->link.ifindex)
+			break;
+	}
+	if (pending == NULL) {
+		pending = xcalloc(1, sizeof(*pending));
+		pending->ifindex = dev->link.ifindex;
+		*pos = pending;
+	}
+	pending->mask |= 1 << ev;
+
+	if (ni_rtevent_coalesce_timer == NULL) {
+		ni_rtevent_coalesce_timer = ni_timer_register(ni_rtevent_coalesce_msec,
+				__ni_rtevent_coalesce_timeout, NULL);
+	}
+	return TRUE;
+}
+
+void
+ni_server_set_event_coalescing(unsigned int msec)
+{
+	ni_rtevent_coalesce_msec = msec;
+	if (!msec) {
+		if (ni_rtevent_coalesce_timer) {
+			ni_timer_cancel(ni_rtevent_coalesce_timer);
+			ni_rtevent_coalesce_timer = NULL;
+		}
+		__ni_rtevent_coalesce_flush();
+	}
+}
+
 /*
  * Helper to trigger interface events
  */
@@ -87,6 +228,9 @@ __ni_netdev_event(ni_netconfig_t *nc, ni_netdev_t *dev, ni_event_t ev)
 {
 	ni_debug_events("%s(%s, idx=%d, %s)", __FUNCTION__,
 			dev->name, dev->link.ifindex, ni_event_type_to_name(ev));
+	ni_tracepoint2(netdev_event, dev->link.ifindex, ev);
+	if (__ni_rtevent_coalesce(dev, ev))
+		return;
 	if (ni_global.interface_event)
 		ni_global.interface_event(dev, ev);
 }
@@ -133,6 +277,11 @@ int
 __ni_rtevent_process(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struct nlmsghdr *h)
 {
 	int rv;
+
+	ni_stats_inc(NI_STAT_NETLINK_EVENTS);
+	ni_tracepoint1(netlink_message, h->nlmsg_type);
+	ni_nlcapture_record(NI_NLCAPTURE_EVENT, h);
+	ni_flight_record(NI_FLIGHT_NETLINK_EVENT, h->nlmsg_type, h->nlmsg_seq, NULL);
 #if 0
 	const char *rtnl_name;
 
@@ -187,12 +336,40 @@ __ni_rtevent_process(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 		break;
 
 	default:
-		rv = 0;
+		return 0;
 	}
 
+	/* The event modified our view of the system state */
+	if (rv >= 0)
+		__ni_netconfig_generation_bump(nc);
+
 	return rv;
 }
 
+/*
+ * Feed a recorded rtnetlink message into the regular event processing
+ * path; used by the offline replay harness in testing/.
+ */
+int
+ni_rtevent_replay(ni_netconfig_t *nc, struct nlmsghdr *h)
+{
+	struct sockaddr_nl nladdr;
+
+	memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+	return __ni_rtevent_process(nc, &nladdr, h);
+}
+
+/*
+ * Whether the rtnetlink event listener is active, i.e. whether the
+ * generation counter tracks kernel state changes.
+ */
+ni_bool_t
+ni_rtevent_listening(void)
+{
+	return __ni_rtevent_sock != NULL;
+}
+
 /*
  * Process device state change events
  */
@@ -303,6 +480,7 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 			ni_debug_events("%s[%u]: device renamed to %s",
 					old->name, old->link.ifindex, ifname);
 			ni_string_dup(&old->name, ifname);
+			__ni_netconfig_index_invalidate(nc);
 			__ni_netdev_event(nc, old, NI_EVENT_DEVICE_RENAME);
 		}
 		dev = old;
@@ -343,6 +521,7 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 			char *current = if_indextoname(conflict->link.ifindex, namebuf);
 			if (current) {
 				ni_string_dup(&conflict->name, current);
+				__ni_netconfig_index_invalidate(nc);
 				__ni_netdev_event(nc, conflict, NI_EVENT_DEVICE_RENAME);
 			} else {
 				unsigned int ifflags = conflict->link.ifflags;
@@ -453,7 +632,16 @@ __ni_rtevent_newprefix(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, str
 		if (pi->valid_lft != NI_LIFETIME_EXPIRED) {
 			/* Replace with updated prefix info - most recent in front */
 			ni_ipv6_ra_pinfo_list_prepend(&ipv6->radv.pinfo, pi);
-			__ni_netdev_prefix_event(dev, NI_EVENT_PREFIX_UPDATE, pi);
+			if (ni_ipv6_ra_pinfo_equal(old, pi)) {
+				/* Periodic RA re-announcing the prefix as-is;
+				 * the new entry refreshed the acquired time,
+				 * don't bother the listeners and updater. */
+				ni_debug_events("%s: unchanged ipv6 prefix info %s/%u refresh",
+						dev->name, ni_sockaddr_print(&pi->prefix),
+						pi->length);
+			} else {
+				__ni_netdev_prefix_event(dev, NI_EVENT_PREFIX_UPDATE, pi);
+			}
 		} else {
 			/* A lifetime of 0 means the router requests a prefix remove;
 			 * at least 3.0.x kernel set valid lft to 0 and keep pref. */
@@ -552,6 +740,10 @@ __ni_rtevent_newroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 	if (ni_rtnl_route_filter_msg(rtm))
 		return 1;
 
+	/* compact mode: just account foreign routes, don't store them */
+	if (__ni_rtnl_route_is_foreign(rtm))
+		return __ni_netdev_process_foreign_route(nc, h, rtm, TRUE);
+
 	rp = ni_route_new();
 	if (ni_rtnl_route_parse_msg(h, rtm, rp) != 0) {
 		ni_route_free(rp);
@@ -594,6 +786,10 @@ __ni_rtevent_delroute(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, stru
 	if (ni_rtnl_route_filter_msg(rtm))
 		return 1;
 
+	/* compact mode: just account foreign routes, don't store them */
+	if (__ni_rtnl_route_is_foreign(rtm))
+		return __ni_netdev_process_foreign_route(nc, h, rtm, FALSE);
+
 	rp = ni_route_new();
 	if (ni_rtnl_route_parse_msg(h, rtm, rp) != 0) {
 		ni_route_free(rp);
@@ -929,6 +1125,115 @@ __ni_rtevent_process_cb(struct nl_msg *msg, void *ptr)
 
 static ni_bool_t	__ni_rtevent_restart(ni_socket_t *sock);
 
+/*
+ * High watermark check: is the socket receive queue filled beyond
+ * half of its buffer?
+ */
+static ni_bool_t
+__ni_rtevent_backlogged(int fd)
+{
+	uint32_t meminfo[SK_MEMINFO_RCVBUF + 1];
+	socklen_t len = sizeof(meminfo);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) < 0 ||
+	    len < sizeof(meminfo))
+		return FALSE;
+
+	return meminfo[SK_MEMINFO_RMEM_ALLOC] >= meminfo[SK_MEMINFO_RCVBUF] / 2;
+}
+
+/*
+ * Drain the event socket in recvmmsg(2) bursts, processing the raw
+ * messages directly. Returns -NLE_NOMEM when events were lost (queue
+ * overrun or a datagram exceeding the drain buffers), 0 otherwise.
+ */
+static int
+__ni_rtevent_bulk_drain(ni_rtevent_handle_t *handle)
+{
+	static unsigned char *bufs;
+	struct mmsghdr mmsg[NI_RTEVENT_BULK_BURST];
+	struct iovec iov[NI_RTEVENT_BULK_BURST];
+	struct sockaddr_nl addr[NI_RTEVENT_BULK_BURST];
+	int fd = nl_socket_get_fd(handle->nlsock);
+	ni_netconfig_t *nc;
+	int n, i;
+
+	if ((nc = ni_global_state_handle(0)) == NULL)
+		return 0;
+
+	if (!bufs && !(bufs = malloc(NI_RTEVENT_BULK_BURST * NI_RTEVENT_BULK_SIZE)))
+		return 0;
+
+	do {
+		memset(mmsg, 0, sizeof(mmsg));
+		for (i = 0; i < NI_RTEVENT_BULK_BURST; ++i) {
+			iov[i].iov_base = bufs + i * NI_RTEVENT_BULK_SIZE;
+			iov[i].iov_len = NI_RTEVENT_BULK_SIZE;
+			mmsg[i].msg_hdr.msg_iov = &iov[i];
+			mmsg[i].msg_hdr.msg_iovlen = 1;
+			mmsg[i].msg_hdr.msg_name = &addr[i];
+			mmsg[i].msg_hdr.msg_namelen = sizeof(addr[i]);
+		}
+
+		n = recvmmsg(fd, mmsg, NI_RTEVENT_BULK_BURST, MSG_DONTWAIT, NULL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				return 0;
+			return -NLE_NOMEM;	/* e.g. ENOBUFS overrun */
+		}
+
+		for (i = 0; i < n; ++i) {
+			struct nlmsghdr *nlh;
+			int len = mmsg[i].msg_len;
+
+			if (mmsg[i].msg_hdr.msg_flags & MSG_TRUNC)
+				return -NLE_NOMEM;
+
+			if (addr[i].nl_pid != 0) {
+				ni_error("ignoring rtnetlink event message from PID %u",
+						addr[i].nl_pid);
+				continue;
+			}
+
+			for (nlh = (struct nlmsghdr *)(bufs + i * NI_RTEVENT_BULK_SIZE);
+			     NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+				if (__ni_rtevent_process(nc, &addr[i], nlh) < 0)
+					ni_debug_events("ignoring %s rtnetlink event",
+							ni_rtnl_msg_type_to_name(nlh->nlmsg_type,
+								"unknown"));
+			}
+		}
+	} while (n == NI_RTEVENT_BULK_BURST);
+
+	return 0;
+}
+
+/*
+ * Double the receive buffer for the restarted listener after an
+ * overrun, starting from the currently effective size.
+ */
+static void
+__ni_rtevent_recv_buff_grow(ni_rtevent_handle_t *handle)
+{
+	unsigned int cur = __ni_rtevent_recv_buff_cur;
+	socklen_t len = sizeof(cur);
+
+	if (cur == 0 && handle && handle->nlsock &&
+	    getsockopt(nl_socket_get_fd(handle->nlsock), SOL_SOCKET,
+				SO_RCVBUF, &cur, &len) < 0)
+		cur = 0;
+	if (cur < (1U << 20))
+		cur = 1U << 20;
+
+	if (cur >= NI_RTEVENT_RECV_BUFF_MAX) {
+		__ni_rtevent_recv_buff_cur = NI_RTEVENT_RECV_BUFF_MAX;
+		return;
+	}
+
+	__ni_rtevent_recv_buff_cur = cur * 2;
+	ni_note("growing netlink event receive buffer to %u bytes after overrun",
+			__ni_rtevent_recv_buff_cur);
+}
 
 /*
  * Receive netlink message and trigger processing by callback
@@ -940,9 +1245,17 @@ __ni_rtevent_receive(ni_socket_t *sock)
 	int ret;
 
 	if (handle && handle->nlsock) {
-		do {
-			ret = nl_recvmsgs_default(handle->nlsock);
-		} while (ret == NLE_SUCCESS || ret == -NLE_INTR);
+		/* above the high watermark, empty the kernel queue in
+		 * bulk before the per message processing gets to it */
+		ret = 0;
+		if (__ni_rtevent_backlogged(nl_socket_get_fd(handle->nlsock)))
+			ret = __ni_rtevent_bulk_drain(handle);
+
+		if (ret == 0) {
+			do {
+				ret = nl_recvmsgs_default(handle->nlsock);
+			} while (ret == NLE_SUCCESS || ret == -NLE_INTR);
+		}
 
 		switch (ret) {
 		case NLE_SUCCESS:
@@ -952,6 +1265,11 @@ __ni_rtevent_receive(ni_socket_t *sock)
 		default:
 			ni_error("rtnetlink event receive error: %s (%m)",
 					nl_geterror(ret));
+			/* We may have lost events (e.g. socket buffer
+			 * overrun); force a full re-dump on next refresh. */
+			__ni_netconfig_mark_stale(ni_global_state_handle(0));
+			if (ret == -NLE_NOMEM)
+				__ni_rtevent_recv_buff_grow(handle);
 			if (__ni_rtevent_restart(sock)) {
 				ni_note("restarted rtnetlink event listener");
 			} else {
@@ -993,10 +1311,130 @@ __ni_rtevent_handle_free(ni_rtevent_handle_t *handle)
 			handle->nlsock = NULL;
 		}
 		ni_uint_array_destroy(&handle->groups);
+		ni_uint_array_destroy(&handle->iffilter);
 		free(handle);
 	}
 }
 
+/*
+ * Kernel-side event filter.
+ *
+ * A supplicant joins the address/prefix/RA groups to track the state
+ * of the few interfaces it actually manages, but the kernel wakes it
+ * for every interface on the system. When a filter set is installed,
+ * a classic BPF program on the event socket drops per-interface
+ * address/prefix/RA events of other interfaces before they cost a
+ * wakeup. Link events and unknown message types always pass, so
+ * device creation/deletion tracking keeps working as before.
+ *
+ * All payloads filtered here (ifaddrmsg, prefixmsg, nduseroptmsg)
+ * carry a 32bit interface index at offset 4; BPF loads data in
+ * network byte order, hence the htons/htonl on the constants.
+ * Kernel event datagrams carry a single netlink message.
+ */
+#define NI_RTEVENT_FILTER_MAX_IFINDEX	64
+
+static ni_bool_t
+__ni_rtevent_filter_apply(ni_rtevent_handle_t *handle)
+{
+	static const uint16_t filtered_types[] = {
+		RTM_NEWADDR, RTM_DELADDR, RTM_NEWPREFIX, RTM_NEWNDUSEROPT
+	};
+	unsigned int ntypes = sizeof(filtered_types)/sizeof(filtered_types[0]);
+	unsigned int count, check, drop, accept, pc, i;
+	struct sock_filter *insns;
+	struct sock_fprog prog;
+	int fd;
+
+	if (!handle || !handle->nlsock)
+		return FALSE;
+
+	fd = nl_socket_get_fd(handle->nlsock);
+	if (!handle->iffilter_set) {
+		int dummy = 0;
+
+		if (setsockopt(fd, SOL_SOCKET, SO_DETACH_FILTER,
+					&dummy, sizeof(dummy)) < 0 && errno != ENOENT)
+			ni_debug_events("Cannot detach netlink event filter: %m");
+		return TRUE;
+	}
+
+	count = handle->iffilter.count;
+	if (count > NI_RTEVENT_FILTER_MAX_IFINDEX)
+		return FALSE;
+
+	/*
+	 * 0:              ldh [4]                  ; nlmsg_type
+	 * 1 .. ntypes:    jeq type -> check
+	 *                 ret ACCEPT               ; other types pass
+	 * check:          ldw [20]                 ; interface index
+	 * check+1 .. +n:  jeq ifindex -> accept
+	 * drop:           ret 0
+	 * accept:         ret -1
+	 */
+	check	= 1 + ntypes + 1;
+	drop	= check + 1 + count;
+	accept	= drop + 1;
+
+	insns = xcalloc(accept + 1, sizeof(*insns));
+
+	pc = 0;
+	insns[pc++] = (struct sock_filter)
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, offsetof(struct nlmsghdr, nlmsg_type));
+	for (i = 0; i < ntypes; ++i, ++pc) {
+		insns[pc] = (struct sock_filter)
+			BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htons(filtered_types[i]),
+					check - pc - 1, 0);
+	}
+	insns[pc++] = (struct sock_filter) BPF_STMT(BPF_RET|BPF_K, ~0U);
+	insns[pc++] = (struct sock_filter)
+		BPF_STMT(BPF_LD|BPF_W|BPF_ABS, NLMSG_HDRLEN + 4);
+	for (i = 0; i < count; ++i, ++pc) {
+		insns[pc] = (struct sock_filter)
+			BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, htonl(handle->iffilter.data[i]),
+					accept - pc - 1, 0);
+	}
+	insns[pc++] = (struct sock_filter) BPF_STMT(BPF_RET|BPF_K, 0);
+	insns[pc++] = (struct sock_filter) BPF_STMT(BPF_RET|BPF_K, ~0U);
+
+	memset(&prog, 0, sizeof(prog));
+	prog.len    = pc;
+	prog.filter = insns;
+
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+		ni_error("Cannot attach netlink event filter: %m");
+		free(insns);
+		return FALSE;
+	}
+	free(insns);
+	return TRUE;
+}
+
+/*
+ * Restrict kernel delivery of per-interface address/prefix/RA events
+ * to the given interfaces. An empty set drops all of them; passing
+ * enable FALSE removes the restriction again.
+ */
+ni_bool_t
+ni_server_filter_interface_addr_events(ni_bool_t enable,
+		const unsigned int *ifindices, unsigned int count)
+{
+	ni_rtevent_handle_t *handle;
+	unsigned int i;
+
+	if (!__ni_rtevent_sock || !(handle = __ni_rtevent_sock->user_data))
+		return FALSE;
+
+	ni_uint_array_destroy(&handle->iffilter);
+	handle->iffilter_set = enable;
+	for (i = 0; enable && i < count; ++i) {
+		if (!ni_uint_array_contains(&handle->iffilter, ifindices[i]))
+			ni_uint_array_append(&handle->iffilter, ifindices[i]);
+	}
+
+	return __ni_rtevent_filter_apply(handle);
+}
+
 static ni_bool_t
 __ni_rtevent_join_group(ni_rtevent_handle_t *handle, unsigned int group)
 {
@@ -1095,6 +1533,11 @@ __ni_rtevent_sock_open(void)
 		__ni_rtevent_handle_free(handle);
 		return NULL;
 	}
+	sock->priority = NI_SOCKET_PRIO_BULK;
+
+	/* apply adaptive growth from previous overruns */
+	if (__ni_rtevent_recv_buff_cur > recv_buff_len)
+		recv_buff_len = __ni_rtevent_recv_buff_cur;
 
 	if (recv_buff_len) {
 		if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE,
@@ -1133,12 +1576,18 @@ __ni_rtevent_restart(ni_socket_t *sock)
 	if (handle) {
 		if ((__ni_rtevent_sock = __ni_rtevent_sock_open())) {
 			const ni_uint_array_t *groups = &handle->groups;
+			const ni_uint_array_t *iffilter = &handle->iffilter;
+			ni_bool_t iffilter_set = handle->iffilter_set;
 			unsigned int i;
 
 			handle = __ni_rtevent_sock->user_data;
 			for (i = 0; i < groups->count; ++i) {
 				__ni_rtevent_join_group(handle, groups->data[i]);
 			}
+			if (iffilter_set) {
+				ni_server_filter_interface_addr_events(TRUE,
+						iffilter->data, iffilter->count);
+			}
 			ni_socket_activate(__ni_rtevent_sock);
 			return TRUE;
 		}
@@ -33,6 +33,7 @@
 #include <wicked/tuntap.h>
 #include <wicked/tunneling.h>
 #include <wicked/linkstats.h>
+#include <wicked/socket.h>
 
 #if defined(HAVE_RTA_MARK)
 #  include <netlink/netlink.h>
@@ -56,6 +57,9 @@
 #include "sysfs.h"
 #include "kernel.h"
 #include "appconfig.h"
+#include "stats.h"
+#include "nlcapture.h"
+#include "workqueue.h"
 #include "pppd.h"
 #include "teamd.h"
 #include "ovs.h"
@@ -64,12 +68,11 @@
 static int		__ni_process_ifinfomsg(ni_linkinfo_t *link, struct nlmsghdr *h,
 					struct ifinfomsg *ifi, ni_netconfig_t *);
 static int		__ni_netdev_process_newaddr(ni_netdev_t *dev, struct nlmsghdr *h,
-					struct ifaddrmsg *ifa);
+					struct ifaddrmsg *ifa, ni_address_index_t *index);
 static int		__ni_netdev_process_newroute(ni_netdev_t *, struct nlmsghdr *,
 					struct rtmsg *, ni_netconfig_t *);
 static int		__ni_netdev_process_newrule(struct nlmsghdr *, struct fib_rule_hdr *,
 					ni_netconfig_t *);
-static int		__ni_discover_bridge(ni_netdev_t *);
 static int		__ni_discover_bond(ni_netdev_t *, struct nlattr **, ni_netconfig_t *);
 static int		__ni_discover_addrconf(ni_netdev_t *);
 static int		__ni_discover_infiniband(ni_netdev_t *, ni_netconfig_t *);
@@ -102,13 +105,13 @@ struct ni_rtnl_query {
  * Query netlink for all relevant information
  */
 static inline int
-__ni_rtnl_query(struct ni_rtnl_info *qr, int af, int type)
+__ni_rtnl_query(struct ni_rtnl_info *qr, int af, int type, unsigned int ifindex)
 {
 	int rv;
 
 	ni_nlmsg_list_init(&qr->nlmsg_list);
 retry:
-	rv = ni_nl_dump_store(af, type, &qr->nlmsg_list);
+	rv = ni_nl_dump_store_index(af, type, ifindex, &qr->nlmsg_list);
 	switch (rv) {
 	case NLE_SUCCESS:
 		qr->entry = qr->nlmsg_list.head;
@@ -130,6 +133,7 @@ __ni_rtnl_info_next(struct ni_rtnl_info *qr)
 
 	if ((entry = qr->entry) != NULL) {
 		qr->entry = entry->next;
+		ni_nlcapture_record(NI_NLCAPTURE_DUMP, &entry->h);
 		return &entry->h;
 	}
 
@@ -146,16 +150,99 @@ ni_rtnl_query_destroy(struct ni_rtnl_query *q)
 	ni_nlmsg_list_destroy(&q->rule_info.nlmsg_list);
 }
 
+/*
+ * One netlink dump run as a workqueue job, on a private socket so that
+ * the dumps of a full query can proceed concurrently.
+ */
+struct ni_rtnl_dump_job {
+	struct ni_rtnl_info *	info;
+	int			af;
+	int			type;
+	unsigned int		ifindex;
+	int			status;
+};
+
+static void
+__ni_rtnl_dump_work(void *user_data)
+{
+	struct ni_rtnl_dump_job *job = user_data;
+	struct ni_rtnl_info *qr = job->info;
+
+	ni_nlmsg_list_init(&qr->nlmsg_list);
+retry:
+	job->status = ni_nl_dump_store_private(job->af, job->type,
+					job->ifindex, &qr->nlmsg_list);
+	switch (job->status) {
+	case NLE_SUCCESS:
+		qr->entry = qr->nlmsg_list.head;
+		break;
+	case -NLE_DUMP_INTR:
+		ni_nlmsg_list_destroy(&qr->nlmsg_list);
+		goto retry;
+	default:
+		qr->entry = NULL;
+		break;
+	}
+}
+
+static int
+ni_rtnl_query_parallel(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
+{
+	struct ni_rtnl_dump_job jobs[4];
+	unsigned int i, count = 0;
+	int rv = 0;
+
+	memset(jobs, 0, sizeof(jobs));
+	jobs[count].info = &q->link_info;
+	jobs[count].af = AF_UNSPEC;
+	jobs[count].type = RTM_GETLINK;
+	count++;
+	if (family != AF_INET) {
+		jobs[count].info = &q->ipv6_info;
+		jobs[count].af = AF_INET6;
+		jobs[count].type = RTM_GETLINK;
+		count++;
+	}
+	jobs[count].info = &q->addr_info;
+	jobs[count].af = family;
+	jobs[count].type = RTM_GETADDR;
+	jobs[count].ifindex = ifindex;
+	count++;
+	jobs[count].info = &q->route_info;
+	jobs[count].af = family;
+	jobs[count].type = RTM_GETROUTE;
+	jobs[count].ifindex = ifindex;
+	count++;
+
+	for (i = 0; i < count; ++i)
+		ni_workqueue_submit(__ni_rtnl_dump_work, NULL, &jobs[i]);
+	ni_workqueue_drain();
+
+	for (i = 0; i < count; ++i) {
+		if (jobs[i].status < 0)
+			rv = -1;
+	}
+	if (rv < 0)
+		ni_rtnl_query_destroy(q);
+	return rv;
+}
+
 static int
 ni_rtnl_query(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
 {
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0
-	 || (family != AF_INET && __ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK) < 0)
-	 || __ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0
-	 || __ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
+	/* With the worker pool running, issue the dumps concurrently on
+	 * private sockets; the kernel builds them in parallel, which cuts
+	 * the bootstrap time roughly by the number of dumps. */
+	if (ni_workqueue_active())
+		return ni_rtnl_query_parallel(q, ifindex, family);
+
+	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK, 0) < 0
+	 || (family != AF_INET && __ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK, 0) < 0)
+	 || __ni_rtnl_query(&q->addr_info, family, RTM_GETADDR, ifindex) < 0
+	 || __ni_rtnl_query(&q->route_info, family, RTM_GETROUTE, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -169,7 +256,7 @@ ni_rtnl_query_link(struct ni_rtnl_query *q, unsigned int ifindex)
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0) {
+	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK, 0) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -183,7 +270,7 @@ ni_rtnl_query_ipv6_link(struct ni_rtnl_query *q, unsigned int ifindex)
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK) < 0) {
+	if (__ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK, 0) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -235,7 +322,7 @@ ni_rtnl_query_addr_info(struct ni_rtnl_query *q, unsigned int ifindex, unsigned
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0) {
+	if (__ni_rtnl_query(&q->addr_info, family, RTM_GETADDR, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -262,11 +349,12 @@ ni_rtnl_query_next_addr_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
 }
 
 static int
-ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int family)
+ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
 {
 	memset(q, 0, sizeof(*q));
+	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
+	if (__ni_rtnl_query(&q->route_info, family, RTM_GETROUTE, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -296,7 +384,7 @@ ni_rtnl_query_rule_info(struct ni_rtnl_query *q, unsigned int family)
 {
 	memset(q, 0, sizeof(*q));
 
-	if (__ni_rtnl_query(&q->rule_info, family, RTM_GETRULE) < 0) {
+	if (__ni_rtnl_query(&q->rule_info, family, RTM_GETRULE, 0) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -508,6 +596,81 @@ __ni_refresh_unbind_master(ni_netconfig_t *nc, ni_netdev_t *dev)
 }
 
 
+/*
+ * Deferred ethtool discovery.
+ *
+ * The per-device ethtool ioctls are by far the most expensive part of
+ * the bootstrap refresh (serial, one device at a time), and nothing in
+ * the initial device publication needs them. During the bootstrap pass
+ * they are skipped and caught up in chunks from a zero timeout timer,
+ * so the daemon answers its first requests with links, addresses and
+ * routes already in place.
+ */
+#define NI_REFRESH_ETHTOOL_CHUNK	64
+
+static struct {
+	ni_uint_array_t		pending;
+	unsigned int		next;
+	const ni_timer_t *	timer;
+} __ni_refresh_ethtool;
+
+static void
+__ni_refresh_ethtool_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *dev;
+	unsigned int n;
+
+	if (__ni_refresh_ethtool.timer != timer)
+		return;
+
+	for (n = 0; n < NI_REFRESH_ETHTOOL_CHUNK &&
+	     __ni_refresh_ethtool.next < __ni_refresh_ethtool.pending.count; ++n) {
+		unsigned int ifindex;
+
+		ifindex = __ni_refresh_ethtool.pending.data[__ni_refresh_ethtool.next++];
+		if (!(dev = ni_netdev_by_index(nc, ifindex)))
+			continue;
+		/* a regular refresh may have filled it in meanwhile */
+		if (dev->ethtool)
+			continue;
+		ni_system_ethtool_refresh(dev);
+	}
+
+	if (__ni_refresh_ethtool.next < __ni_refresh_ethtool.pending.count) {
+		__ni_refresh_ethtool.timer = ni_timer_register(0,
+				__ni_refresh_ethtool_timeout, NULL);
+	} else {
+		ni_uint_array_destroy(&__ni_refresh_ethtool.pending);
+		__ni_refresh_ethtool.next = 0;
+		__ni_refresh_ethtool.timer = NULL;
+	}
+}
+
+static void
+__ni_refresh_ethtool_defer(ni_netconfig_t *nc)
+{
+	ni_netdev_t *dev;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		if (dev->ethtool || !dev->link.ifindex)
+			continue;
+		ni_uint_array_append(&__ni_refresh_ethtool.pending, dev->link.ifindex);
+	}
+
+	if (__ni_refresh_ethtool.pending.count && !__ni_refresh_ethtool.timer) {
+		__ni_refresh_ethtool.timer = ni_timer_register(0,
+				__ni_refresh_ethtool_timeout, NULL);
+	}
+}
+
+static void
+__ni_refresh_sysfs_prefetch(void *dummy)
+{
+	(void)dummy;
+	ni_sysfs_netif_prefetch();
+}
+
 /*
  * Refresh all interfaces
  */
@@ -525,9 +688,29 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 	struct ni_rtnl_query query;
 	struct nlmsghdr *h;
 	ni_netdev_t **tail, *dev;
+	struct timeval began;
+	ni_bool_t defer_ethtool = FALSE;
 	unsigned int seqno;
 	int res = -1;
 
+	ni_stats_inc(NI_STAT_REFRESHES);
+
+	if (!__ni_netconfig_full_refresh_needed(nc)) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_EVENTS,
+				"Skipping full refresh, event stream is authoritative (generation %u)",
+				ni_netconfig_generation(nc));
+		return 0;
+	}
+
+	if (__ni_netconfig_refresh_redundant(nc)) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_EVENTS,
+				"Skipping redundant full refresh, no events since the last one (generation %u)",
+				ni_netconfig_generation(nc));
+		return 0;
+	}
+
+	ni_timer_get_time(&began);
+
 	do {
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
@@ -536,6 +719,19 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 		refresh = 1;
 		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 				"Full refresh of all interfaces (bootstrap)");
+
+		/* Warm the sysfs caches for the per-device reads below
+		 * while the netlink dumps are in flight. */
+		if (ni_workqueue_active())
+			ni_workqueue_submit(__ni_refresh_sysfs_prefetch, NULL, NULL);
+
+		/* Skip the ethtool ioctls during the bootstrap pass and
+		 * catch them up from a timer, unless discovery of extern
+		 * link details is disabled altogether. */
+		if (!ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN)) {
+			defer_ethtool = TRUE;
+			ni_netconfig_set_discover_filter(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+		}
 	} else {
 		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_EVENTS,
 				"Full refresh of all interfaces (enforced)");
@@ -578,8 +774,10 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			*tail = dev;
 			tail = &dev->next;
 		} else {
-			if (!ni_string_eq(dev->name, ifname))
+			if (!ni_string_eq(dev->name, ifname)) {
 				ni_string_dup(&dev->name, ifname);
+				__ni_netconfig_index_invalidate(nc);
+			}
 
 			/* Clear out addresses and routes */
 			ni_address_list_reset_seq(dev->addrs);
@@ -592,6 +790,10 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			ni_error("Problem parsing RTM_NEWLINK message for %s", ifname);
 	}
 
+	/* We appended new devices to the list directly; make sure the
+	 * lookups below see them. */
+	__ni_netconfig_index_invalidate(nc);
+
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
 		__ni_refresh_bind_master(nc, dev);
 		__ni_refresh_bind_lower(nc, dev);
@@ -610,19 +812,36 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			ni_error("Problem parsing IPv6 RTM_NEWLINK message for %s", dev->name);
 	}
 
-	while (1) {
-		struct ifaddrmsg *ifa;
+	{
+		ni_address_index_t index;
+		ni_netdev_t *index_dev = NULL;
 
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
+		/* The dump groups addresses by interface, so the index is
+		 * typically built once per device. */
+		ni_address_index_init(&index);
+		while (1) {
+			struct ifaddrmsg *ifa;
 
-		if ((dev = ni_netdev_by_index(nc, ifa->ifa_index)) == NULL)
-			continue;
+			if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
+				break;
+
+			if ((dev = ni_netdev_by_index(nc, ifa->ifa_index)) == NULL)
+				continue;
+
+			if (dev != index_dev) {
+				ni_address_index_build(&index, dev->addrs);
+				index_dev = dev;
+			}
 
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+			if (__ni_netdev_process_newaddr(dev, h, ifa, &index) < 0)
+				ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+		}
+		ni_address_index_destroy(&index);
 	}
 
+	/* the full dump rebuilds the foreign route summary from scratch */
+	ni_route_foreign_set_reset(ni_netconfig_foreign_routes(nc));
+
 	while (1) {
 		struct rtmsg *rtm;
 
@@ -653,6 +872,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			tail = &dev->next;
 		}
 	}
+	__ni_netconfig_index_invalidate(nc);
 
 	/* issue separate query ingnoring the error to not break
 	 * the bootstrap, e.g. when a kernel lacks rule support.
@@ -660,9 +880,16 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 	if (!ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_ROUTE_RULES))
 		(void)__ni_system_refresh_rules(nc);
 
+	__ni_netconfig_full_refresh_done(nc);
+	__ni_netconfig_refresh_profile(nc, &began);
 	res = 0;
 
 failed:
+	if (defer_ethtool) {
+		ni_netconfig_clear_discover_filter(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN);
+		if (res == 0)
+			__ni_refresh_ethtool_defer(nc);
+	}
 	ni_rtnl_query_destroy(&query);
 	return res;
 }
@@ -703,8 +930,10 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 		}
 
 		ifname = nla_get_string(nla);
-		if (!ni_string_eq(dev->name, ifname))
+		if (!ni_string_eq(dev->name, ifname)) {
 			ni_string_dup(&dev->name, ifname);
+			__ni_netconfig_index_invalidate(nc);
+		}
 
 		/* Clear out addresses and routes */
 		dev->seq = __ni_global_seqno;
@@ -715,14 +944,21 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 			ni_error("Problem parsing RTM_NEWLINK message for %s", dev->name);
 	}
 
-	while (1) {
-		struct ifaddrmsg *ifa;
+	{
+		ni_address_index_t index;
 
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
+		ni_address_index_init(&index);
+		ni_address_index_build(&index, dev->addrs);
+		while (1) {
+			struct ifaddrmsg *ifa;
+
+			if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
+				break;
 
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+			if (__ni_netdev_process_newaddr(dev, h, ifa, &index) < 0)
+				ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+		}
+		ni_address_index_destroy(&index);
 	}
 	ni_address_list_drop_by_seq(&dev->addrs, dev->seq);
 
@@ -773,17 +1009,29 @@ __ni_system_refresh_addrs(ni_netconfig_t *nc, unsigned int family)
 		dev->seq = seqno;
 	}
 
-	while (1) {
-		struct ifaddrmsg *ifa;
+	{
+		ni_address_index_t index;
+		ni_netdev_t *index_dev = NULL;
 
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
+		ni_address_index_init(&index);
+		while (1) {
+			struct ifaddrmsg *ifa;
 
-		if ((dev = ni_netdev_by_index(nc, ifa->ifa_index)) == NULL)
-			continue;
+			if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
+				break;
+
+			if ((dev = ni_netdev_by_index(nc, ifa->ifa_index)) == NULL)
+				continue;
 
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+			if (dev != index_dev) {
+				ni_address_index_build(&index, dev->addrs);
+				index_dev = dev;
+			}
+
+			if (__ni_netdev_process_newaddr(dev, h, ifa, &index) < 0)
+				ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+		}
+		ni_address_index_destroy(&index);
 	}
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
@@ -815,14 +1063,21 @@ __ni_system_refresh_interface_addrs(ni_netconfig_t *nc, ni_netdev_t *dev)
 		goto failed;
 
 	ni_address_list_reset_seq(dev->addrs);
-	while (1) {
-		struct ifaddrmsg *ifa;
+	{
+		ni_address_index_t index;
 
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
+		ni_address_index_init(&index);
+		ni_address_index_build(&index, dev->addrs);
+		while (1) {
+			struct ifaddrmsg *ifa;
+
+			if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
+				break;
 
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+			if (__ni_netdev_process_newaddr(dev, h, ifa, &index) < 0)
+				ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+		}
+		ni_address_index_destroy(&index);
 	}
 	ni_address_list_drop_by_seq(&dev->addrs, dev->seq);
 
@@ -890,12 +1145,15 @@ __ni_system_refresh_routes(ni_netconfig_t *nc)
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_route_info(&query, 0, ni_netconfig_get_family_filter(nc)) < 0)
 		goto failed;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
 		ni_route_tables_reset_seq(dev->routes);
 
+	/* the full dump rebuilds the foreign route summary from scratch */
+	ni_route_foreign_set_reset(ni_netconfig_foreign_routes(nc));
+
 	while (1) {
 		struct rtmsg *rtm;
 
@@ -931,7 +1189,7 @@ __ni_system_refresh_interface_routes(ni_netconfig_t *nc, ni_netdev_t *dev)
 		dev->seq = ++__ni_global_seqno;
 	} while (!dev->seq);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_route_info(&query, dev->link.ifindex, ni_netconfig_get_family_filter(nc)) < 0)
 		goto failed;
 
 	ni_route_tables_reset_seq(dev->routes);
@@ -1497,7 +1755,7 @@ __ni_process_ifinfomsg_linkinfo(ni_linkinfo_t *link, const char *ifname,
 		link->lowerdev.index = nla_get_u32(tb[IFLA_LINK]);
 		if (!ni_netdev_ref_bind_ifname(&link->lowerdev, nc)) {
 			/* Drop old ifname, we will try it again later */
-			ni_string_free(&link->lowerdev.name);
+			ni_refstr_free(&link->lowerdev.name);
 		}
 	} else if (link->lowerdev.index) {
 		ni_netdev_ref_destroy(&link->lowerdev);
@@ -1519,39 +1777,60 @@ __ni_process_ifinfomsg_linkinfo(ni_linkinfo_t *link, const char *ifname,
 		link->oper_state = nla_get_u8(tb[IFLA_OPERSTATE]);
 	}
 
-	if (tb[IFLA_STATS]) {
-		struct rtnl_link_stats *s = nla_data(tb[IFLA_STATS]);
+#define __ni_link_stats_assign(n, s) do {			\
+		n->rx_packets = s->rx_packets;			\
+		n->tx_packets = s->tx_packets;			\
+		n->rx_bytes = s->rx_bytes;			\
+		n->tx_bytes = s->tx_bytes;			\
+		n->rx_errors = s->rx_errors;			\
+		n->tx_errors = s->tx_errors;			\
+		n->rx_dropped = s->rx_dropped;			\
+		n->tx_dropped = s->tx_dropped;			\
+		n->multicast = s->multicast;			\
+		n->collisions = s->collisions;			\
+		n->rx_length_errors = s->rx_length_errors;	\
+		n->rx_over_errors = s->rx_over_errors;		\
+		n->rx_crc_errors = s->rx_crc_errors;		\
+		n->rx_frame_errors = s->rx_frame_errors;	\
+		n->rx_fifo_errors = s->rx_fifo_errors;		\
+		n->rx_missed_errors = s->rx_missed_errors;	\
+		n->tx_aborted_errors = s->tx_aborted_errors;	\
+		n->tx_carrier_errors = s->tx_carrier_errors;	\
+		n->tx_fifo_errors = s->tx_fifo_errors;		\
+		n->tx_heartbeat_errors = s->tx_heartbeat_errors; \
+		n->tx_window_errors = s->tx_window_errors;	\
+		n->rx_compressed = s->rx_compressed;		\
+		n->tx_compressed = s->tx_compressed;		\
+	} while (0)
+
+	if (tb[IFLA_STATS64] || tb[IFLA_STATS]) {
 		ni_link_stats_t *n;
 
 		if (!link->stats)
 			link->stats = calloc(1, sizeof(*n));
 
 		if ((n = link->stats)) {
-			n->rx_packets = s->rx_packets;
-			n->tx_packets = s->tx_packets;
-			n->rx_bytes = s->rx_bytes;
-			n->tx_bytes = s->tx_bytes;
-			n->rx_errors = s->rx_errors;
-			n->tx_errors = s->tx_errors;
-			n->rx_dropped = s->rx_dropped;
-			n->tx_dropped = s->tx_dropped;
-			n->multicast = s->multicast;
-			n->collisions = s->collisions;
-			n->rx_length_errors = s->rx_length_errors;
-			n->rx_over_errors = s->rx_over_errors;
-			n->rx_crc_errors = s->rx_crc_errors;
-			n->rx_frame_errors = s->rx_frame_errors;
-			n->rx_fifo_errors = s->rx_fifo_errors;
-			n->rx_missed_errors = s->rx_missed_errors;
-			n->tx_aborted_errors = s->tx_aborted_errors;
-			n->tx_carrier_errors = s->tx_carrier_errors;
-			n->tx_fifo_errors = s->tx_fifo_errors;
-			n->tx_heartbeat_errors = s->tx_heartbeat_errors;
-			n->tx_window_errors = s->tx_window_errors;
-			n->rx_compressed = s->rx_compressed;
-			n->tx_compressed = s->tx_compressed;
+			if (tb[IFLA_STATS64]) {
+				struct rtnl_link_stats64 sb, *s = &sb;
+				int len = nla_len(tb[IFLA_STATS64]);
+
+				/* the payload may be unaligned and, on an
+				 * older kernel, shorter than our struct */
+				if (len > (int)sizeof(sb))
+					len = sizeof(sb);
+				memset(&sb, 0, sizeof(sb));
+				if (len > 0)
+					memcpy(&sb, nla_data(tb[IFLA_STATS64]), len);
+				__ni_link_stats_assign(n, s);
+			} else {
+				struct rtnl_link_stats *s = nla_data(tb[IFLA_STATS]);
+
+				__ni_link_stats_assign(n, s);
+			}
+			ni_link_stats_ring_record(&link->stats_ring, n);
 		}
 	}
+#undef __ni_link_stats_assign
 
 	/* Extended link info. Let's use it to try to determine link->type.
 	 *
@@ -1804,6 +2083,7 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 				struct ifinfomsg *ifi, ni_netconfig_t *nc)
 {
 	struct nlattr *tb[IFLA_MAX+1];
+	ni_bool_t infodata_changed;
 	int rv;
 
 	memset(tb, 0, sizeof(tb));
@@ -1850,6 +2130,28 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 	if (!ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
 		ni_system_ethtool_refresh(dev);
 
+	/* The vlan/vxlan/macvlan details come solely from the nested
+	 * IFLA_INFO_DATA payload; when its bytes are identical to the
+	 * last refresh, the re-parse is skipped below. In steady state
+	 * that is virtually every device in every dump. */
+	infodata_changed = TRUE;
+	if (tb[IFLA_LINKINFO]) {
+		struct nlattr *li[IFLA_INFO_MAX+1];
+
+		if (nla_parse_nested(li, IFLA_INFO_MAX, tb[IFLA_LINKINFO], NULL) == 0 &&
+		    li[IFLA_INFO_DATA]) {
+			unsigned int len = nla_len(li[IFLA_INFO_DATA]);
+			unsigned int csum = ni_crc32c(0,
+					nla_data(li[IFLA_INFO_DATA]), len);
+
+			if (dev->link.infodata_len == len &&
+			    dev->link.infodata_csum == csum)
+				infodata_changed = FALSE;
+			dev->link.infodata_len = len;
+			dev->link.infodata_csum = csum;
+		}
+	}
+
 	switch (dev->link.type) {
 	case NI_IFTYPE_ETHERNET:
 		if (ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
@@ -1864,23 +2166,29 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 		break;
 
 	case NI_IFTYPE_BRIDGE:
-		__ni_discover_bridge(dev);
+		/* Deep bridge discovery walks a lot of sysfs files per
+		 * bridge and port; defer it until somebody asks for the
+		 * bridge details (ni_netdev_get_bridge). */
+		dev->bridge_stale = 1;
 		break;
 	case NI_IFTYPE_BOND:
 		__ni_discover_bond(dev, tb, nc);
 		break;
 
 	case NI_IFTYPE_VLAN:
-		__ni_discover_vlan(dev, tb, nc);
+		if (infodata_changed || !dev->vlan)
+			__ni_discover_vlan(dev, tb, nc);
 		break;
 
 	case NI_IFTYPE_VXLAN:
-		ni_discover_vxlan(dev, tb, nc);
+		if (infodata_changed || !dev->vxlan)
+			ni_discover_vxlan(dev, tb, nc);
 		break;
 
 	case NI_IFTYPE_MACVLAN:
 	case NI_IFTYPE_MACVTAP:
-		__ni_discover_macvlan(dev, tb, nc);
+		if (infodata_changed || !dev->macvlan)
+			__ni_discover_macvlan(dev, tb, nc);
 		break;
 
 	case NI_IFTYPE_PPP:
@@ -1910,9 +2218,18 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 		break;
 
 	case NI_IFTYPE_IPIP:
+		if (infodata_changed || !dev->ipip)
+			__ni_discover_tunneling(dev, tb);
+		break;
+
 	case NI_IFTYPE_GRE:
+		if (infodata_changed || !dev->gre)
+			__ni_discover_tunneling(dev, tb);
+		break;
+
 	case NI_IFTYPE_SIT:
-		__ni_discover_tunneling(dev, tb);
+		if (infodata_changed || !dev->sit)
+			__ni_discover_tunneling(dev, tb);
 		break;
 
 	case NI_IFTYPE_TEAM:
@@ -1922,10 +2239,11 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 		/*
 		 * is using gennl, rtnl_link provides a kind only,
 		 * so we unfortunatelly have to ask teamd here and
-		 * even worser, by name...
+		 * even worser, by name... defer the teamd query until
+		 * somebody asks for the team details (ni_netdev_get_team).
 		 */
 		if (ni_config_teamd_enabled() && ni_netdev_device_is_ready(dev))
-			ni_teamd_discover(dev);
+			dev->team_stale = 1;
 		break;
 
 	case NI_IFTYPE_OVS_BRIDGE:
@@ -2851,22 +3169,27 @@ __ni_rtnl_parse_newaddr(unsigned ifflags, struct nlmsghdr *h, struct ifaddrmsg *
 	return 0;
 }
 
-int
-__ni_netdev_process_newaddr_event(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrmsg *ifa,
-					const ni_address_t **hint)
+static int
+__ni_netdev_process_newaddr_indexed(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrmsg *ifa,
+					const ni_address_t **hint, ni_address_index_t *index)
 {
 	ni_address_t tmp, *ap;
 
 	if (__ni_rtnl_parse_newaddr(dev->link.ifflags, h, ifa, &tmp) < 0)
 		return -1;
 
-	ap = ni_address_list_find(dev->addrs, &tmp.local_addr);
+	if (index)
+		ap = ni_address_index_find(index, &tmp.local_addr);
+	else
+		ap = ni_address_list_find(dev->addrs, &tmp.local_addr);
 	if (!ap) {
 		ap = ni_address_new(tmp.family, tmp.prefixlen, &tmp.local_addr, &dev->addrs);
 		if (!ap) {
 			ni_string_free(&tmp.label);
 			return -1;
 		}
+		if (index)
+			ni_address_index_insert(index, ap);
 	}
 	ap->seq = dev->seq;
 	ap->scope = tmp.scope;
@@ -2919,10 +3242,18 @@ __ni_netdev_process_newaddr_event(ni_netdev_t *dev, struct nlmsghdr *h, struct i
 	return 0;
 }
 
+int
+__ni_netdev_process_newaddr_event(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrmsg *ifa,
+					const ni_address_t **hint)
+{
+	return __ni_netdev_process_newaddr_indexed(dev, h, ifa, hint, NULL);
+}
+
 static int
-__ni_netdev_process_newaddr(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrmsg *ifa)
+__ni_netdev_process_newaddr(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrmsg *ifa,
+					ni_address_index_t *index)
 {
-	return __ni_netdev_process_newaddr_event(dev, h, ifa, NULL);
+	return __ni_netdev_process_newaddr_indexed(dev, h, ifa, NULL, index);
 }
 
 ni_bool_t
@@ -3172,6 +3503,82 @@ ni_rtnl_route_parse_msg(struct nlmsghdr *h, struct rtmsg *rtm, ni_route_t *rp)
 	return 0;
 }
 
+/*
+ * Bounded-memory route blob mode.
+ *
+ * Routes owned by a routing daemon (zebra, bird, bgp, ...) are nothing
+ * wicked will ever manage; in compact mode they are summarized into
+ * the foreign route set of the netconfig handle -- a count plus a
+ * destination fingerprint for conflict checks -- instead of being
+ * parsed into ni_route_t objects. The counters are approximate between
+ * full refreshes (a replace event adds a reference without removing
+ * the replaced one); every full dump rebuilds the set from scratch.
+ */
+ni_bool_t
+__ni_rtnl_route_is_foreign(const struct rtmsg *rtm)
+{
+	if (!ni_config_compact_foreign_routes())
+		return FALSE;
+
+	switch (rtm->rtm_protocol) {
+	case RTPROT_UNSPEC:
+	case RTPROT_REDIRECT:
+	case RTPROT_KERNEL:
+	case RTPROT_BOOT:
+	case RTPROT_STATIC:
+	case RTPROT_RA:
+#if defined(RTPROT_DHCP)
+	case RTPROT_DHCP:
+#endif
+		return FALSE;
+	default:
+		/* gated, zebra, bird, bgp, ospf, ... */
+		return TRUE;
+	}
+}
+
+int
+__ni_netdev_process_foreign_route(ni_netconfig_t *nc, struct nlmsghdr *h,
+				struct rtmsg *rtm, ni_bool_t add)
+{
+	struct nlattr *tb[RTA_MAX+1];
+	ni_route_foreign_set_t *set;
+	ni_route_t key;
+
+	if (!(set = ni_netconfig_foreign_routes(nc)))
+		return -1;
+
+	memset(tb, 0, sizeof(tb));
+	if (nlmsg_parse(h, sizeof(*rtm), tb, RTA_MAX, NULL) < 0) {
+		ni_warn("Cannot parse rtnl route message");
+		return -1;
+	}
+
+	/* only the destination key is needed, no route is constructed */
+	memset(&key, 0, sizeof(key));
+	key.family = rtm->rtm_family;
+	key.table = rtm->rtm_table;
+	if (tb[RTA_TABLE] != NULL)
+		key.table = nla_get_u32(tb[RTA_TABLE]);
+	key.tos = rtm->rtm_tos;
+	key.prefixlen = rtm->rtm_dst_len;
+	if (rtm->rtm_dst_len == 0) {
+		key.destination.ss_family = rtm->rtm_family;
+	} else
+	if (__ni_nla_get_addr(rtm->rtm_family, &key.destination, tb[RTA_DST]) != 0) {
+		ni_warn("Cannot parse rtnl route destination address");
+		return -1;
+	}
+	if (tb[RTA_PRIORITY] != NULL)
+		key.priority = nla_get_u32(tb[RTA_PRIORITY]);
+
+	if (add)
+		ni_route_foreign_set_add(set, ni_route_dest_fingerprint(&key));
+	else
+		ni_route_foreign_set_del(set, ni_route_dest_fingerprint(&key));
+	return 1;
+}
+
 int
 __ni_netdev_process_newroute(ni_netdev_t *dev, struct nlmsghdr *h,
 				struct rtmsg *rtm, ni_netconfig_t *nc)
@@ -3198,6 +3605,14 @@ __ni_netdev_process_newroute(ni_netdev_t *dev, struct nlmsghdr *h,
 	if (ni_rtnl_route_filter_msg(rtm))
 		return 1;
 
+	if (__ni_rtnl_route_is_foreign(rtm)) {
+		/* only the full dump maintains the summary; a per-device
+		 * refresh did not drop it and must not inflate it either */
+		if (dev == NULL)
+			return __ni_netdev_process_foreign_route(nc, h, rtm, TRUE);
+		return 1;
+	}
+
 	rp = ni_route_new();
 	rp->seq = dev ? dev->seq : __ni_global_seqno;
 
@@ -3431,9 +3846,12 @@ failure:
 
 
 /*
- * Discover bridge topology
+ * Discover bridge topology.
+ *
+ * Not called from the refresh path anymore, but lazily through
+ * ni_netdev_get_bridge() when a stale device is first accessed.
  */
-static int
+int
 __ni_discover_bridge(ni_netdev_t *dev)
 {
 	ni_bridge_t *bridge;
@@ -3652,7 +4070,7 @@ __ni_discover_bond_netlink_master(ni_netdev_t *dev, struct nlattr *info_data, ni
 		case IFLA_BOND_ACTIVE_SLAVE:
 			bond->active_slave.index = nla_get_u32(aptr);
 			if (!ni_netdev_ref_bind_ifname(&bond->active_slave, nc))
-				ni_string_free(&bond->active_slave.name);
+				ni_refstr_free(&bond->active_slave.name);
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
 					"%s: get attr %s=%u (%s)", dev->name, name,
 					bond->active_slave.index,
@@ -3725,7 +4143,7 @@ __ni_discover_bond_netlink_master(ni_netdev_t *dev, struct nlattr *info_data, ni
 		case IFLA_BOND_PRIMARY:
 			bond->primary_slave.index = nla_get_u32(aptr);
 			if (!ni_netdev_ref_bind_ifname(&bond->primary_slave, nc))
-				ni_string_free(&bond->active_slave.name);
+				ni_refstr_free(&bond->active_slave.name);
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
 					"%s: get attr %s=%u (%s)", dev->name, name,
 					bond->primary_slave.index, bond->primary_slave.name);
@@ -3946,8 +4364,8 @@ __ni_discover_infiniband(ni_netdev_t *dev, ni_netconfig_t *nc)
 			dev->name);
 		ret = -1;
 	} else if (!ni_string_eq(dev->link.lowerdev.name, value)) {
-		ni_string_free(&dev->link.lowerdev.name);
-		dev->link.lowerdev.name = value;
+		ni_refstr_dup(&dev->link.lowerdev.name, value);
+		ni_string_free(&value);
 		ni_netdev_ref_bind_ifindex(&dev->link.lowerdev, nc);
 	} else {
 		ni_string_free(&value);
@@ -148,6 +148,7 @@ int
 ni_system_ipv4_devinfo_get(ni_netdev_t *dev, ni_ipv4_devinfo_t *ipv4)
 {
 	ni_bool_t can_arp;
+	int dirfd;
 
 	if (ipv4 == NULL)
 		ipv4 = ni_netdev_get_ipv4(dev);
@@ -161,17 +162,19 @@ ni_system_ipv4_devinfo_get(ni_netdev_t *dev, ni_ipv4_devinfo_t *ipv4)
 			NI_TRISTATE_ENABLE : NI_TRISTATE_DISABLE;
 	}
 
-	if (ni_sysctl_ipv4_ifconfig_is_present(dev->name)) {
+	if ((dirfd = ni_sysctl_ipv4_ifconfig_open(dev->name)) >= 0) {
 		int val;
 
-		if (ni_sysctl_ipv4_ifconfig_get_int(dev->name, "forwarding", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "forwarding", &val) >= 0)
 			ni_tristate_set(&ipv4->conf.forwarding, val);
 
-		if (can_arp && ni_sysctl_ipv4_ifconfig_get_int(dev->name, "arp_notify", &val) >= 0)
+		if (can_arp && ni_sysctl_ifconfig_get_int(dirfd, "arp_notify", &val) >= 0)
 			ni_tristate_set(&ipv4->conf.arp_notify, val);
 
-		if (ni_sysctl_ipv4_ifconfig_get_int(dev->name, "accept_redirects", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "accept_redirects", &val) >= 0)
 			ni_tristate_set(&ipv4->conf.accept_redirects, val);
+
+		ni_sysctl_ifconfig_close(dirfd);
 	} else {
 		ni_warn("%s: cannot get ipv4 device attributes", dev->name);
 
@@ -186,12 +189,12 @@ ni_system_ipv4_devinfo_get(ni_netdev_t *dev, ni_ipv4_devinfo_t *ipv4)
  * Update the device's IPv4 settings
  */
 static inline int
-__change_int(const char *ifname, const char *attr, int value)
+__change_int(int dirfd, const char *ifname, const char *attr, int value)
 {
 	if (!ni_tristate_is_set(value))
 		return 1;
 
-	if (ni_sysctl_ipv4_ifconfig_set_int(ifname, attr, value) < 0) {
+	if (ni_sysctl_ifconfig_set_int(dirfd, attr, value) < 0) {
 		if (errno == EROFS || errno == ENOENT) {
 			ni_info("%s: cannot set ipv4.conf.%s = %d attribute: %m",
 					ifname, attr, value);
@@ -212,22 +215,19 @@ __tristate_changed(ni_tristate_t cfg, ni_tristate_t sys)
 	return ni_tristate_is_set(cfg) && cfg != sys;
 }
 
-int
-ni_system_ipv4_devinfo_set(ni_netdev_t *dev, const ni_ipv4_devconf_t *conf)
+static int
+__ni_system_ipv4_devinfo_set(ni_netdev_t *dev, const ni_ipv4_devconf_t *conf,
+				ni_ipv4_devinfo_t *ipv4, int dirfd)
 {
-	ni_ipv4_devinfo_t *ipv4;
 	ni_tristate_t arp_notify;
 	ni_bool_t can_arp;
 	int ret;
 
-	if (!conf || !(ipv4 = ni_netdev_get_ipv4(dev)))
-		return -1;
-
 	if (ni_tristate_is_set(conf->enabled))
 		ni_tristate_set(&ipv4->conf.enabled, conf->enabled);
 
 	if (__tristate_changed(conf->forwarding, ipv4->conf.forwarding)) {
-		ret = __change_int(dev->name, "forwarding", conf->forwarding);
+		ret = __change_int(dirfd, dev->name, "forwarding", conf->forwarding);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -244,7 +244,7 @@ ni_system_ipv4_devinfo_set(ni_netdev_t *dev, const ni_ipv4_devconf_t *conf)
 			conf->arp_notify : conf->arp_verify;
 
 	if (__tristate_changed(arp_notify, ipv4->conf.arp_notify)) {
-		ret = __change_int(dev->name, "arp_notify", arp_notify);
+		ret = __change_int(dirfd, dev->name, "arp_notify", arp_notify);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -252,7 +252,7 @@ ni_system_ipv4_devinfo_set(ni_netdev_t *dev, const ni_ipv4_devconf_t *conf)
 	}
 
 	if (__tristate_changed(conf->accept_redirects, ipv4->conf.accept_redirects)) {
-		ret = __change_int(dev->name, "accept_redirects", conf->accept_redirects);
+		ret = __change_int(dirfd, dev->name, "accept_redirects", conf->accept_redirects);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -262,6 +262,22 @@ ni_system_ipv4_devinfo_set(ni_netdev_t *dev, const ni_ipv4_devconf_t *conf)
 	return 0;
 }
 
+int
+ni_system_ipv4_devinfo_set(ni_netdev_t *dev, const ni_ipv4_devconf_t *conf)
+{
+	ni_ipv4_devinfo_t *ipv4;
+	int dirfd, ret;
+
+	if (!conf || !(ipv4 = ni_netdev_get_ipv4(dev)))
+		return -1;
+
+	/* apply the whole settings group through one conf dirfd */
+	dirfd = ni_sysctl_ipv4_ifconfig_open(dev->name);
+	ret = __ni_system_ipv4_devinfo_set(dev, conf, ipv4, dirfd);
+	ni_sysctl_ifconfig_close(dirfd);
+	return ret;
+}
+
 static inline const char *
 ni_ipv4_devconf_flag_to_sysctl_name(unsigned int flag)
 {
@@ -190,6 +190,8 @@ ni_ipv6_devinfo_free(ni_ipv6_devinfo_t *ipv6)
 int
 ni_system_ipv6_devinfo_get(ni_netdev_t *dev, ni_ipv6_devinfo_t *ipv6)
 {
+	int dirfd;
+
 	if (ipv6 == NULL)
 		ipv6 = ni_netdev_get_ipv6(dev);
 
@@ -209,30 +211,31 @@ ni_system_ipv6_devinfo_get(ni_netdev_t *dev, ni_ipv6_devinfo_t *ipv6)
 	 * When we bring the interface back up, everything is fine; but until
 	 * then we need to ignore this glitch.
 	 */
-	if (ni_sysctl_ipv6_ifconfig_is_present(dev->name)) {
+	if ((dirfd = ni_sysctl_ipv6_ifconfig_open(dev->name)) >= 0) {
 		int val;
 
-		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "disable_ipv6", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "disable_ipv6", &val) >= 0)
 			ni_tristate_set(&ipv6->conf.enabled, !val);
 
-		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "forwarding", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "forwarding", &val) >= 0)
 			ni_tristate_set(&ipv6->conf.forwarding, !!val);
 
-		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "autoconf", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "autoconf", &val) >= 0)
 			ni_tristate_set(&ipv6->conf.autoconf, !!val);
 
-		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "use_tempaddr", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "use_tempaddr", &val) >= 0)
 			ipv6->conf.privacy = val < -1 ? -1 : (val > 2 ? 2 : val);
 
-		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "accept_ra", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "accept_ra", &val) >= 0)
 			ipv6->conf.accept_ra = val < 0 ? 0 : val > 2 ? 2 : val;
 
-		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "accept_dad", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "accept_dad", &val) >= 0)
 			ipv6->conf.accept_dad = val < 0 ? 0 : val > 2 ? 2 : val;
 
-		if (ni_sysctl_ipv6_ifconfig_get_int(dev->name, "accept_redirects", &val) >= 0)
+		if (ni_sysctl_ifconfig_get_int(dirfd, "accept_redirects", &val) >= 0)
 			ni_tristate_set(&ipv6->conf.accept_redirects, !!val);
 
+		ni_sysctl_ifconfig_close(dirfd);
 	} else {
 		ni_warn("%s: cannot get ipv6 device attributes", dev->name);
 
@@ -248,12 +251,12 @@ ni_system_ipv6_devinfo_get(ni_netdev_t *dev, ni_ipv6_devinfo_t *ipv6)
  * Update the device's IPv6 settings
  */
 static inline int
-__change_int(const char *ifname, const char *attr, int value)
+__change_int(int dirfd, const char *ifname, const char *attr, int value)
 {
 	if (!ni_tristate_is_set(value))
 		return 1;
 
-	if (ni_sysctl_ipv6_ifconfig_set_int(ifname, attr, value) < 0) {
+	if (ni_sysctl_ifconfig_set_int(dirfd, attr, value) < 0) {
 		if (errno == EROFS || errno == ENOENT) {
 			ni_info("%s: cannot set ipv6.conf.%s = %d attribute: %m",
 					ifname, attr, value);
@@ -274,26 +277,14 @@ __tristate_changed(ni_tristate_t cfg, ni_tristate_t sys)
 	return ni_tristate_is_set(cfg) && cfg != sys;
 }
 
-int
-ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
+static int
+__ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf,
+				ni_ipv6_devinfo_t *ipv6, int dirfd)
 {
-	ni_ipv6_devinfo_t *ipv6;
 	int ret;
 
-	if (!conf || !(ipv6 = ni_netdev_get_ipv6(dev)))
-		return -1;
-
-	if (!ni_ipv6_supported()) {
-		ipv6->conf.enabled = NI_TRISTATE_DISABLE;
-		if (ni_tristate_is_enabled(conf->enabled)) {
-			errno = EAFNOSUPPORT;
-			return -1;
-		}
-		return 0;
-	}
-
 	if (__tristate_changed(conf->enabled, ipv6->conf.enabled)) {
-		ret = __change_int(dev->name, "disable_ipv6",
+		ret = __change_int(dirfd, dev->name, "disable_ipv6",
 				ni_tristate_is_enabled(conf->enabled) ? 0 : 1);
 		if (ret < 0)
 			return ret;
@@ -308,7 +299,7 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 	}
 
 	if (__tristate_changed(conf->forwarding, ipv6->conf.forwarding)) {
-		ret = __change_int(dev->name, "forwarding", conf->forwarding);
+		ret = __change_int(dirfd, dev->name, "forwarding", conf->forwarding);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -316,7 +307,7 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 	}
 
 	if (__tristate_changed(conf->autoconf, ipv6->conf.autoconf)) {
-		ret = __change_int(dev->name, "autoconf", conf->autoconf);
+		ret = __change_int(dirfd, dev->name, "autoconf", conf->autoconf);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -326,7 +317,7 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 	if (__tristate_changed(conf->privacy, ipv6->conf.privacy)) {
 		/* kernel is using -1 for loopback, ptp, ... */
 		int privacy = conf->privacy > 2 ? 2 : conf->privacy;
-		ret = __change_int(dev->name, "use_tempaddr", privacy);
+		ret = __change_int(dirfd, dev->name, "use_tempaddr", privacy);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -335,7 +326,7 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 
 	if (__tristate_changed(conf->accept_ra, ipv6->conf.accept_ra)) {
 		int accept_ra = conf->accept_ra > 2 ? 2 : conf->accept_ra;
-		ret = __change_int(dev->name, "accept_ra", accept_ra);
+		ret = __change_int(dirfd, dev->name, "accept_ra", accept_ra);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -344,7 +335,7 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 
 	if (__tristate_changed(conf->accept_dad, ipv6->conf.accept_dad)) {
 		int accept_dad = conf->accept_dad > 2 ? 2 : conf->accept_dad;
-		ret = __change_int(dev->name, "accept_dad", accept_dad);
+		ret = __change_int(dirfd, dev->name, "accept_dad", accept_dad);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -352,7 +343,7 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 	}
 
 	if (__tristate_changed(conf->accept_redirects, ipv6->conf.accept_redirects)) {
-		ret = __change_int(dev->name, "accept_redirects", conf->accept_redirects);
+		ret = __change_int(dirfd, dev->name, "accept_redirects", conf->accept_redirects);
 		if (ret < 0)
 			return ret;
 		if (ret == 0)
@@ -362,6 +353,31 @@ ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
 	return 0;
 }
 
+int
+ni_system_ipv6_devinfo_set(ni_netdev_t *dev, const ni_ipv6_devconf_t *conf)
+{
+	ni_ipv6_devinfo_t *ipv6;
+	int dirfd, ret;
+
+	if (!conf || !(ipv6 = ni_netdev_get_ipv6(dev)))
+		return -1;
+
+	if (!ni_ipv6_supported()) {
+		ipv6->conf.enabled = NI_TRISTATE_DISABLE;
+		if (ni_tristate_is_enabled(conf->enabled)) {
+			errno = EAFNOSUPPORT;
+			return -1;
+		}
+		return 0;
+	}
+
+	/* apply the whole settings group through one conf dirfd */
+	dirfd = ni_sysctl_ipv6_ifconfig_open(dev->name);
+	ret = __ni_system_ipv6_devinfo_set(dev, conf, ipv6, dirfd);
+	ni_sysctl_ifconfig_close(dirfd);
+	return ret;
+}
+
 void
 ni_ipv6_ra_info_flush(ni_ipv6_ra_info_t *radv)
 {
@@ -440,6 +456,22 @@ ni_ipv6_ra_pinfo_list_expire(ni_ipv6_ra_pinfo_t **list, const struct timeval *cu
 	return lifetime;
 }
 
+ni_bool_t
+ni_ipv6_ra_pinfo_equal(const ni_ipv6_ra_pinfo_t *a, const ni_ipv6_ra_pinfo_t *b)
+{
+	/*
+	 * Same prefix announcement as before (except of the acquired
+	 * time stamp), i.e. a periodic router advertisement refresh.
+	 */
+	return	a && b &&
+		a->length == b->length &&
+		a->on_link == b->on_link &&
+		a->autoconf == b->autoconf &&
+		a->valid_lft == b->valid_lft &&
+		a->preferred_lft == b->preferred_lft &&
+		ni_sockaddr_equal(&a->prefix, &b->prefix);
+}
+
 ni_ipv6_ra_pinfo_t *
 ni_ipv6_ra_pinfo_list_remove(ni_ipv6_ra_pinfo_t **list, const ni_ipv6_ra_pinfo_t *pi)
 {
@@ -17,6 +17,8 @@ extern unsigned int		ni_ipv6_ra_info_expire(ni_ipv6_ra_info_t *,
 							const struct timeval *);
 
 extern void			ni_ipv6_ra_pinfo_free(ni_ipv6_ra_pinfo_t *);
+extern ni_bool_t		ni_ipv6_ra_pinfo_equal(const ni_ipv6_ra_pinfo_t *,
+								const ni_ipv6_ra_pinfo_t *);
 extern void			ni_ipv6_ra_pinfo_list_destroy(ni_ipv6_ra_pinfo_t **);
 extern unsigned int		ni_ipv6_ra_pinfo_list_expire(ni_ipv6_ra_pinfo_t **,
 							const struct timeval *);
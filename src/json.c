@@ -838,8 +838,47 @@ ni_json_free(ni_json_t *json)
 }
 
 /*
- * format into stringbuf
+ * Format into a string buffer, a stdio stream, or just measure.
+ *
+ * All three modes share one emitter driven through a small writer
+ * sink; the measure mode (no buffer, no stream) computes the exact
+ * output size, which the string formatter uses to reserve the whole
+ * result in a single allocation before emitting.
  */
+typedef struct ni_json_writer {
+	ni_stringbuf_t *	buf;
+	FILE *			fp;
+	size_t			size;
+	ni_bool_t		error;
+} ni_json_writer_t;
+
+static void
+ni_json_writer_put(ni_json_writer_t *w, const char *data, size_t len)
+{
+	w->size += len;
+	if (w->buf)
+		ni_stringbuf_put(w->buf, data, len);
+	else
+	if (w->fp && fwrite(data, 1, len, w->fp) != len)
+		w->error = TRUE;
+}
+
+static inline void
+ni_json_writer_puts(ni_json_writer_t *w, const char *str)
+{
+	ni_json_writer_put(w, str, strlen(str));
+}
+
+static inline void
+ni_json_writer_putc(ni_json_writer_t *w, char cc)
+{
+	ni_json_writer_put(w, &cc, 1);
+}
+
+static ni_bool_t
+ni_json_format_value(ni_json_writer_t *w, const ni_json_t *json,
+			const ni_json_format_options_t *options);
+
 static inline const char *
 ni_json_string_escape_map(unsigned char uc, const ni_json_format_options_t *options)
 {
@@ -859,12 +898,13 @@ ni_json_string_escape_map(unsigned char uc, const ni_json_format_options_t *opti
 }
 
 static void
-ni_json_string_escape(ni_stringbuf_t *buf, const char *str,
+ni_json_string_escape(ni_json_writer_t *w, const char *str,
 			const ni_json_format_options_t *options)
 {
 	static const char *hex = "0123456789abcdefABCDEF";
 	size_t len = ni_string_len(str);
 	size_t pos = 0, off = 0;
+	char ubuf[8];
 	unsigned char uc;
 	const char *es;
 
@@ -873,132 +913,192 @@ ni_json_string_escape(ni_stringbuf_t *buf, const char *str,
 		es = ni_json_string_escape_map(uc, options);
 		if (es) {
 			if (pos - off > 0)
-				ni_stringbuf_put(buf, str + off, pos - off);
-			ni_stringbuf_puts(buf, es);
+				ni_json_writer_put(w, str + off, pos - off);
+			ni_json_writer_puts(w, es);
 			off = ++pos;
 		} else
 		if (uc < ' ') {
 			if (pos - off > 0)
-				ni_stringbuf_put(buf, str + off, pos - off);
-			ni_stringbuf_printf(buf, "\\u00%c%c", hex[uc >> 4], hex[uc & 0x0f]);
+				ni_json_writer_put(w, str + off, pos - off);
+			snprintf(ubuf, sizeof(ubuf), "\\u00%c%c",
+					hex[uc >> 4], hex[uc & 0x0f]);
+			ni_json_writer_puts(w, ubuf);
 			off = ++pos;
 		} else {
 			pos++;
 		}
 	}
 	if (pos - off > 0)
-		ni_stringbuf_put(buf, str + off, pos - off);
+		ni_json_writer_put(w, str + off, pos - off);
 }
 
 static void
-ni_json_string_format(ni_stringbuf_t *buf, const char *value,
+ni_json_string_format(ni_json_writer_t *w, const char *value,
 			const ni_json_format_options_t *options)
 {
-	ni_stringbuf_putc(buf, '\"');
-	ni_json_string_escape(buf, value, options);
-	ni_stringbuf_putc(buf, '\"');
+	ni_json_writer_putc(w, '\"');
+	ni_json_string_escape(w, value, options);
+	ni_json_writer_putc(w, '\"');
 }
 
 static void
-ni_json_array_format(ni_stringbuf_t *buf, const ni_json_array_t *nja,
+ni_json_array_format(ni_json_writer_t *w, const ni_json_array_t *nja,
 			const ni_json_format_options_t *options)
 {
 	unsigned int i;
 
 	if (!nja || !nja->count) {
-		ni_stringbuf_puts(buf, "[]");
+		ni_json_writer_puts(w, "[]");
 		return;
 	}
 
-	ni_stringbuf_puts(buf, "[ ");
+	ni_json_writer_puts(w, "[ ");
 	for (i = 0; i < nja->count; ++i) {
 		if (i)
-			ni_stringbuf_puts(buf, ", ");
-		ni_json_format_string(buf, nja->data[i], options);
+			ni_json_writer_puts(w, ", ");
+		ni_json_format_value(w, nja->data[i], options);
 	}
-	ni_stringbuf_puts(buf, " ]");
+	ni_json_writer_puts(w, " ]");
 }
 
 static void
-ni_json_pair_format(ni_stringbuf_t *buf, const ni_json_pair_t *pair,
+ni_json_pair_format(ni_json_writer_t *w, const ni_json_pair_t *pair,
 			const ni_json_format_options_t *options)
 {
-	ni_stringbuf_putc(buf, '\"');
-	ni_json_string_escape(buf, pair->name, options);
-	ni_stringbuf_puts(buf, "\": ");
-	ni_json_format_string(buf, pair->value, options);
+	ni_json_writer_putc(w, '\"');
+	ni_json_string_escape(w, pair->name, options);
+	ni_json_writer_puts(w, "\": ");
+	ni_json_format_value(w, pair->value, options);
 }
 
 static void
-ni_json_object_format(ni_stringbuf_t *buf, const ni_json_object_t *njo,
+ni_json_object_format(ni_json_writer_t *w, const ni_json_object_t *njo,
 			const ni_json_format_options_t *options)
 {
 	unsigned int i;
 
 	if (!njo || !njo->count) {
-		ni_stringbuf_puts(buf, "{}");
+		ni_json_writer_puts(w, "{}");
 		return;
 	}
 
-	ni_stringbuf_puts(buf, "{ ");
+	ni_json_writer_puts(w, "{ ");
 	for (i = 0; i < njo->count; ++i) {
 		if (i)
-			ni_stringbuf_puts(buf, ", ");
-		ni_json_pair_format(buf, njo->data[i], options);
+			ni_json_writer_puts(w, ", ");
+		ni_json_pair_format(w, njo->data[i], options);
 	}
-	ni_stringbuf_puts(buf, " }");
+	ni_json_writer_puts(w, " }");
 }
 
-const char *
-ni_json_format_string(ni_stringbuf_t *buf, const ni_json_t *json,
+static ni_bool_t
+ni_json_format_value(ni_json_writer_t *w, const ni_json_t *json,
 			const ni_json_format_options_t *options)
 {
-	static const ni_json_format_options_t defaults = {
-		.flags = 0,
-	};
-
-	if (!json || !buf)
-		return NULL;
-
-	if (!options)
-		options = &defaults;
+	char num[64];
 
 	switch (json->type) {
 	case NI_JSON_TYPE_NULL:
-		ni_stringbuf_puts(buf, "null");
+		ni_json_writer_puts(w, "null");
 		break;
 
 	case NI_JSON_TYPE_BOOL:
-		ni_stringbuf_puts(buf, json->bool_value ? "true" : "false");
+		ni_json_writer_puts(w, json->bool_value ? "true" : "false");
 		break;
 
 	case NI_JSON_TYPE_INT64:
-		ni_stringbuf_printf(buf, "%"PRId64, json->int64_value);
+		snprintf(num, sizeof(num), "%"PRId64, json->int64_value);
+		ni_json_writer_puts(w, num);
 		break;
 
 	case NI_JSON_TYPE_DOUBLE:
-		ni_stringbuf_printf(buf, "%.*g", 2, json->double_value);
+		snprintf(num, sizeof(num), "%.*g", 2, json->double_value);
+		ni_json_writer_puts(w, num);
 		break;
 
 	case NI_JSON_TYPE_STRING:
-		ni_json_string_format(buf, json->string_value, options);
+		ni_json_string_format(w, json->string_value, options);
 		break;
 
 	case NI_JSON_TYPE_ARRAY:
-		ni_json_array_format(buf, json->array_value, options);
+		ni_json_array_format(w, json->array_value, options);
 		break;
 
 	case NI_JSON_TYPE_OBJECT:
-		ni_json_object_format(buf, json->object_value, options);
+		ni_json_object_format(w, json->object_value, options);
 		break;
 
 	default:
-		return NULL;
+		return FALSE;
 	}
 
+	return TRUE;
+}
+
+static const ni_json_format_options_t	ni_json_format_defaults = {
+	.flags = 0,
+};
+
+/*
+ * Measure the formatted size without emitting anything.
+ */
+size_t
+ni_json_format_size(const ni_json_t *json, const ni_json_format_options_t *options)
+{
+	ni_json_writer_t w = { .buf = NULL, .fp = NULL };
+
+	if (!json)
+		return 0;
+	if (!options)
+		options = &ni_json_format_defaults;
+	if (!ni_json_format_value(&w, json, options))
+		return 0;
+	return w.size;
+}
+
+const char *
+ni_json_format_string(ni_stringbuf_t *buf, const ni_json_t *json,
+			const ni_json_format_options_t *options)
+{
+	ni_json_writer_t w = { .buf = buf, .fp = NULL };
+
+	if (!json || !buf)
+		return NULL;
+
+	if (!options)
+		options = &ni_json_format_defaults;
+
+	/* reserve the result in one allocation */
+	ni_stringbuf_grow(buf, ni_json_format_size(json, options));
+
+	if (!ni_json_format_value(&w, json, options))
+		return NULL;
+
 	return buf->string;
 }
 
+/*
+ * Stream the formatted value directly into a stdio file, without
+ * building the output in memory first.
+ */
+int
+ni_json_format_print(FILE *fp, const ni_json_t *json,
+			const ni_json_format_options_t *options)
+{
+	ni_json_writer_t w = { .buf = NULL, .fp = fp };
+
+	if (!json || !fp)
+		return -1;
+
+	if (!options)
+		options = &ni_json_format_defaults;
+
+	if (!ni_json_format_value(&w, json, options) || w.error)
+		return -1;
+
+	return 0;
+}
+
 /*
  * parsing from string
  */
@@ -1787,3 +1887,145 @@ ni_json_parse_string(const char *str)
 	return ni_json_parse_buffer(&buf);
 }
 
+/*
+ * Incremental JSON stream parser.
+ *
+ * Input chunks are appended to an internal buffer; a lightweight scanner
+ * tracks string/escape state and bracket depth to find the end of each
+ * top-level value, which is then parsed as a whole and emitted through
+ * the callback. Only the raw text of the value currently in flight is
+ * retained, so a long stream of JSON-RPC messages is parsed and released
+ * message by message instead of being accumulated and parsed at once.
+ * Top-level values must be objects or arrays - the end of a bare scalar
+ * cannot be detected on an unframed stream.
+ */
+struct ni_json_stream {
+	ni_buffer_t		data;		/* unconsumed raw text         */
+	size_t			scanned;	/* scan resume offset          */
+	unsigned int		depth;		/* object/array nesting        */
+	ni_bool_t		in_string;
+	ni_bool_t		escaped;
+	ni_bool_t		failed;
+
+	ni_json_stream_callback_t *callback;
+	void *			user_data;
+};
+
+ni_json_stream_t *
+ni_json_stream_new(ni_json_stream_callback_t *callback, void *user_data)
+{
+	ni_json_stream_t *stream;
+
+	if (!callback)
+		return NULL;
+
+	stream = xcalloc(1, sizeof(*stream));
+	ni_buffer_init_dynamic(&stream->data, BUFSIZ);
+	stream->callback = callback;
+	stream->user_data = user_data;
+	return stream;
+}
+
+void
+ni_json_stream_free(ni_json_stream_t *stream)
+{
+	if (stream) {
+		ni_buffer_destroy(&stream->data);
+		free(stream);
+	}
+}
+
+static int
+ni_json_stream_emit(ni_json_stream_t *stream, size_t len)
+{
+	ni_buffer_t vbuf;
+	ni_json_t *json;
+
+	ni_buffer_init_reader(&vbuf, (char *)ni_buffer_head(&stream->data), len);
+	json = ni_json_parse_buffer(&vbuf);
+	ni_buffer_pull_head(&stream->data, len);
+	stream->scanned = 0;
+
+	if (!json) {
+		stream->failed = TRUE;
+		return -1;
+	}
+	stream->callback(json, stream->user_data);
+
+	if (ni_buffer_count(&stream->data) == 0)
+		ni_buffer_clear(&stream->data);
+	return 0;
+}
+
+/*
+ * Feed the next chunk into the stream; the chunk data is consumed.
+ * Returns the number of values emitted through the callback in this
+ * round, or -1 on a malformed stream (further feeding is refused).
+ */
+int
+ni_json_stream_feed(ni_json_stream_t *stream, ni_buffer_t *chunk)
+{
+	int count = 0;
+
+	if (!stream || stream->failed)
+		return -1;
+
+	if (chunk && ni_buffer_count(chunk)) {
+		ni_buffer_ensure_tailroom(&stream->data, ni_buffer_count(chunk));
+		ni_buffer_put(&stream->data, ni_buffer_head(chunk), ni_buffer_count(chunk));
+		ni_buffer_pull_head(chunk, ni_buffer_count(chunk));
+	}
+
+	while (stream->scanned < ni_buffer_count(&stream->data)) {
+		unsigned char cc;
+
+		cc = ((unsigned char *)ni_buffer_head(&stream->data))[stream->scanned];
+
+		if (stream->in_string) {
+			if (stream->escaped)
+				stream->escaped = FALSE;
+			else if (cc == '\\')
+				stream->escaped = TRUE;
+			else if (cc == '"')
+				stream->in_string = FALSE;
+			stream->scanned++;
+			continue;
+		}
+
+		if (stream->depth == 0) {
+			/* between values: skip spaces, expect { or [ */
+			if (isspace(cc)) {
+				ni_buffer_pull_head(&stream->data, 1);
+				continue;
+			}
+			if (cc != '{' && cc != '[') {
+				stream->failed = TRUE;
+				return -1;
+			}
+		}
+
+		switch (cc) {
+		case '"':
+			stream->in_string = TRUE;
+			break;
+		case '{':
+		case '[':
+			stream->depth++;
+			break;
+		case '}':
+		case ']':
+			if (--stream->depth == 0) {
+				if (ni_json_stream_emit(stream, stream->scanned + 1) < 0)
+					return -1;
+				count++;
+				continue;
+			}
+			break;
+		default:
+			break;
+		}
+		stream->scanned++;
+	}
+	return count;
+}
+
@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <wicked/util.h>
+#include "buffer.h"
 
 
 typedef enum {
@@ -115,7 +116,28 @@ typedef struct {
 extern	const char *			ni_json_format_string(ni_stringbuf_t *buf,
 							const ni_json_t *,
 							const ni_json_format_options_t *);
+extern	size_t				ni_json_format_size(const ni_json_t *,
+							const ni_json_format_options_t *);
+extern	int				ni_json_format_print(FILE *fp,
+							const ni_json_t *,
+							const ni_json_format_options_t *);
 
 extern	ni_json_t *			ni_json_parse_string(const char *str);
+extern	ni_json_t *			ni_json_parse_buffer(ni_buffer_t *);
+
+/*
+ * Incremental parsing of a stream of JSON values, e.g. JSON-RPC
+ * messages arriving in chunks from a socket. Each top-level value
+ * (object or array) is emitted through the callback as soon as it
+ * is complete; the callback owns the passed reference.
+ */
+typedef struct ni_json_stream		ni_json_stream_t;
+typedef void				ni_json_stream_callback_t(ni_json_t *, void *);
+
+extern	ni_json_stream_t *		ni_json_stream_new(ni_json_stream_callback_t *,
+							void *user_data);
+extern	void				ni_json_stream_free(ni_json_stream_t *);
+extern	int				ni_json_stream_feed(ni_json_stream_t *,
+							ni_buffer_t *);
 
 #endif /* NI_JSON_H */
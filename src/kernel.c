@@ -31,6 +31,7 @@
 #include "util_priv.h"
 #include "sysfs.h"
 #include "kernel.h"
+#include "appconfig.h"
 #include <wicked/ppp.h>
 #include <wicked/tuntap.h>
 
@@ -533,33 +534,120 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 }
 
 /*
- * Issue a DUMP request and store all replies in list
+ * Kernel-side dump filtering. With NETLINK_GET_STRICT_CHK enabled, the
+ * kernel honors filter fields in the dump request (ifa_index for address
+ * dumps, RTA_OIF for route dumps), so a single-interface refresh does
+ * not have to transfer and discard the whole table. Older kernels do
+ * not support the option; in this case we fall back to an unfiltered
+ * dump and the callers filter in userspace as before.
  */
-int
-ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK	12
+#endif
+
+static ni_bool_t
+__ni_nl_strict_check(struct nl_sock *nl_sock, int onoff)
+{
+	static int supported = -1;
+
+	if (supported == 0)
+		return FALSE;
+
+	if (setsockopt(nl_socket_get_fd(nl_sock), SOL_NETLINK,
+			NETLINK_GET_STRICT_CHK, &onoff, sizeof(onoff)) < 0) {
+		if (supported < 0)
+			ni_debug_socket("kernel does not support NETLINK_GET_STRICT_CHK: %m");
+		supported = 0;
+		return FALSE;
+	}
+	supported = 1;
+	return TRUE;
+}
+
+static int
+__ni_nl_dump_request_filtered(struct nl_sock *nl_sock, int af, int type, unsigned int ifindex)
+{
+	struct nl_msg *msg;
+	int rv;
+
+	if (!(msg = nlmsg_alloc_simple(type, NLM_F_REQUEST | NLM_F_DUMP)))
+		return -NLE_NOMEM;
+
+	if (type == RTM_GETADDR) {
+		struct ifaddrmsg ifa;
+
+		memset(&ifa, 0, sizeof(ifa));
+		ifa.ifa_family = af;
+		ifa.ifa_index = ifindex;
+		if (nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO) < 0)
+			goto nla_put_failure;
+	} else if (type == RTM_GETROUTE) {
+		struct rtmsg rtm;
+
+		memset(&rtm, 0, sizeof(rtm));
+		rtm.rtm_family = af;
+		if (nlmsg_append(msg, &rtm, sizeof(rtm), NLMSG_ALIGNTO) < 0)
+			goto nla_put_failure;
+		NLA_PUT_U32(msg, RTA_OIF, ifindex);
+	} else {
+		nlmsg_free(msg);
+		return -NLE_OPNOTSUPP;
+	}
+
+	rv = nl_send_auto(nl_sock, msg);
+	nlmsg_free(msg);
+	return rv < 0 ? rv : 0;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -NLE_MSGSIZE;
+}
+
+/*
+ * Issue a DUMP request on the given handle and store all replies in list.
+ * A non-zero ifindex requests a kernel-side filtered dump when possible.
+ */
+static int
+__ni_nl_dump_store(ni_netlink_t *nl, int af, int type, unsigned int ifindex,
+		struct ni_nlmsg_list *list)
 {
 	struct nl_sock *nl_sock;
 	struct __ni_nl_dump_state data = {
 		.msg_type = -1,
 		.list = list,
 	};
+	ni_bool_t strict = FALSE;
 	struct nl_cb *cb;
 	const char *name;
 	int rv;
 
 	name = ni_rtnl_msg_type_to_name(type, __func__);
-	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+	if (!nl || !(nl_sock = nl->nl_sock)) {
 		ni_error("%s: no netlink socket", name);
 		return -NLE_BAD_SOCK;
 	}
 
-	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
+	/* Enable strict checking just for this exchange; other users of the
+	 * shared socket send requests the kernel would reject in strict mode. */
+	if (ifindex && (type == RTM_GETADDR || type == RTM_GETROUTE))
+		strict = __ni_nl_strict_check(nl_sock, 1);
+
+	if (strict)
+		rv = __ni_nl_dump_request_filtered(nl_sock, af, type, ifindex);
+	else
+		rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP);
+	if (rv < 0) {
 		ni_error("%s: failed to send request", name);
+		if (strict)
+			__ni_nl_strict_check(nl_sock, 0);
 		return rv;
 	}
 
-	if (!(cb = __ni_nl_cb_clone(__ni_global_netlink)))
+	if (!(cb = __ni_nl_cb_clone(nl))) {
+		if (strict)
+			__ni_nl_strict_check(nl_sock, 0);
 		return -NLE_NOMEM;
+	}
 
 	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, __ni_nl_dump_valid, &data);
 
@@ -583,10 +671,43 @@ retry:
 				name, nl_geterror(rv));
 		break;
 	}
+	if (strict)
+		__ni_nl_strict_check(nl_sock, 0);
 	nl_cb_put(cb);
 	return rv;
 }
 
+int
+ni_nl_dump_store_index(int af, int type, unsigned int ifindex, struct ni_nlmsg_list *list)
+{
+	return __ni_nl_dump_store(__ni_global_netlink, af, type, ifindex, list);
+}
+
+int
+ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+{
+	return ni_nl_dump_store_index(af, type, 0, list);
+}
+
+/*
+ * Like ni_nl_dump_store_index, but on a private netlink socket opened
+ * just for this dump. Safe to call from worker threads, where several
+ * dumps sharing the global socket would interleave their replies.
+ */
+int
+ni_nl_dump_store_private(int af, int type, unsigned int ifindex, struct ni_nlmsg_list *list)
+{
+	ni_netlink_t *nl;
+	int rv;
+
+	if (!(nl = __ni_netlink_open(NETLINK_ROUTE)))
+		return -NLE_BAD_SOCK;
+
+	rv = __ni_nl_dump_store(nl, af, type, ifindex, list);
+	__ni_netlink_close(nl);
+	return rv;
+}
+
 /*
  * Send a message and capture the response message(s)
  */
@@ -611,6 +732,132 @@ ni_nl_talk(struct nl_msg *msg, struct ni_nlmsg_list *list)
 	}
 }
 
+/*
+ * Pipelined request/ack exchange. The synchronous ni_nl_talk waits
+ * for the kernel's ack after every configuration request, which adds
+ * one round trip per address or route on interface bring-up. The
+ * batch variant sends the requests back-to-back, remembers their
+ * sequence numbers and matches the acks afterwards in one go.
+ */
+static void
+__ni_nl_batch_complete(ni_nl_batch_t *batch, unsigned int seq, int status)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch->count; ++i) {
+		if (batch->pending[i].done || batch->pending[i].seq != seq)
+			continue;
+
+		batch->pending[i].done = TRUE;
+		batch->pending[i].status = status;
+		if (batch->outstanding)
+			batch->outstanding--;
+
+		/* The senders create with NLM_F_CREATE and do not consider
+		 * an already existing object an error; neither do we. */
+		if (status && abs(status) != NLE_EXIST && !batch->error)
+			batch->error = status;
+		return;
+	}
+}
+
+static int
+__ni_nl_batch_ack_handler(struct nl_msg *msg, void *arg)
+{
+	ni_nl_batch_t *batch = arg;
+
+	__ni_nl_batch_complete(batch, nlmsg_hdr(msg)->nlmsg_seq, 0);
+	return NL_STOP;
+}
+
+static int
+__ni_nl_batch_error_handler(struct sockaddr_nl *sender, struct nlmsgerr *err, void *arg)
+{
+	ni_nl_batch_t *batch = arg;
+
+	ni_debug_ifconfig("netlink reports error %d for request %u",
+			err->error, err->msg.nlmsg_seq);
+	__ni_nl_batch_complete(batch, err->msg.nlmsg_seq,
+			-nl_syserr2nlerr(err->error));
+	return NL_STOP;
+}
+
+int
+ni_nl_batch_flush(ni_nl_batch_t *batch)
+{
+	ni_netlink_t *nl = __ni_global_netlink;
+	struct nl_cb *cb;
+	int err, ret;
+
+	if (!batch)
+		return -NLE_INVAL;
+
+	if (batch->outstanding) {
+		if (!nl || !nl->nl_sock) {
+			ni_error("%s: no netlink socket", __func__);
+			return -NLE_BAD_SOCK;
+		}
+		if (!(cb = __ni_nl_cb_clone(nl)))
+			return -NLE_NOMEM;
+
+		nl_cb_err(cb, NL_CB_CUSTOM, __ni_nl_batch_error_handler, batch);
+		nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, __ni_nl_batch_ack_handler, batch);
+
+		while (batch->outstanding) {
+			if ((err = nl_recvmsgs(nl->nl_sock, cb)) < 0) {
+				ni_debug_socket("%s: recv failed: %s",
+						__func__, nl_geterror(err));
+				if (!batch->error)
+					batch->error = err;
+				break;
+			}
+		}
+		nl_cb_put(cb);
+	}
+
+	ret = batch->error;
+	memset(batch, 0, sizeof(*batch));
+	return ret;
+}
+
+int
+ni_nl_batch_talk(ni_nl_batch_t *batch, struct nl_msg *msg)
+{
+	struct nl_sock *nl_sock;
+	unsigned int limit;
+	int err;
+
+	if (!batch)
+		return ni_nl_talk(msg, NULL);
+
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", __func__);
+		return -NLE_BAD_SOCK;
+	}
+
+	/* the configured pacing limit caps the number of unacked
+	 * requests in flight below the pipeline depth */
+	limit = ni_config_rtnl_pacing_outstanding();
+	if (limit == 0 || limit > NI_NL_BATCH_MAX)
+		limit = NI_NL_BATCH_MAX;
+
+	if (batch->count >= limit &&
+	    (err = ni_nl_batch_flush(batch)) < 0)
+		return err;
+
+	if ((err = nl_send_auto(nl_sock, msg)) < 0) {
+		ni_error("%s: unable to send: %s", __func__, nl_geterror(err));
+		return err;
+	}
+
+	batch->pending[batch->count].seq = nlmsg_hdr(msg)->nlmsg_seq;
+	batch->pending[batch->count].status = 0;
+	batch->pending[batch->count].done = FALSE;
+	batch->count++;
+	batch->outstanding++;
+	return 0;
+}
+
 #define ni_t2n(x)	[x] = #x
 static const char *	ni_rtnl_msg_type_names[RTM_MAX] = {
 #ifdef	RTM_NEWLINK
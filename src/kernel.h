@@ -74,6 +74,34 @@ struct ni_nlmsg_list {
 
 extern int	ni_nl_talk(struct nl_msg *, struct ni_nlmsg_list *);
 extern int	ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list);
+extern int	ni_nl_dump_store_index(int af, int type, unsigned int ifindex,
+				struct ni_nlmsg_list *list);
+extern int	ni_nl_dump_store_private(int af, int type, unsigned int ifindex,
+				struct ni_nlmsg_list *list);
+
+/*
+ * Pipelined variant of ni_nl_talk for bulk configuration changes.
+ * Up to NI_NL_BATCH_MAX requests are sent without waiting for the
+ * kernel's ack after each one; the outstanding acks are matched by
+ * sequence number and collected in ni_nl_batch_flush().
+ */
+#define NI_NL_BATCH_MAX		64
+
+typedef struct ni_nl_batch {
+	struct {
+		unsigned int	seq;
+		int		status;
+		ni_bool_t	done;
+	}			pending[NI_NL_BATCH_MAX];
+	unsigned int		count;
+	unsigned int		outstanding;
+	int			error;
+} ni_nl_batch_t;
+
+#define NI_NL_BATCH_INIT	{ .count = 0 }
+
+extern int	ni_nl_batch_talk(ni_nl_batch_t *, struct nl_msg *);
+extern int	ni_nl_batch_flush(ni_nl_batch_t *);
 
 extern void	ni_nlmsg_list_init(struct ni_nlmsg_list *);
 extern void	ni_nlmsg_list_destroy(struct ni_nlmsg_list *);
@@ -135,6 +163,9 @@ extern int	__ni_rtnl_parse_newprefix(const char *, struct nlmsghdr *, struct pre
 
 extern int	__ni_netdev_process_newlink(ni_netdev_t *, struct nlmsghdr *, struct ifinfomsg *, ni_netconfig_t *);
 extern int	__ni_netdev_process_newlink_ipv6(ni_netdev_t *, struct nlmsghdr *, struct ifinfomsg *);
+extern ni_bool_t __ni_rtnl_route_is_foreign(const struct rtmsg *);
+extern int	__ni_netdev_process_foreign_route(ni_netconfig_t *, struct nlmsghdr *,
+				struct rtmsg *, ni_bool_t);
 extern int	__ni_netdev_process_newprefix(ni_netdev_t *, struct nlmsghdr *, struct prefixmsg *);
 extern int	__ni_netdev_process_newaddr_event(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrmsg *ifa, const ni_address_t **);
 
@@ -42,14 +42,17 @@
 #include <wicked/nis.h>
 #include <wicked/route.h>
 #include <wicked/logging.h>
+#include <wicked/socket.h>
 #include <wicked/xml.h>
 
 #include "appconfig.h"
 #include "leasefile.h"
+#include "util_priv.h"
 #include "dhcp.h"
 #include "dhcp4/lease.h"
 #include "dhcp6/lease.h"
 #include "netinfo_priv.h"
+#include "workqueue.h"
 
 /*
  * utility returning a family + type specific node / name
@@ -1245,50 +1248,433 @@ static const char *		__ni_addrconf_lease_file_path(char **,
 static void			__ni_addrconf_lease_file_remove(
 				const char *, const char *, int, int);
 
+static ni_lease_file_fsync_t	ni_lease_file_fsync = NI_LEASE_FILE_FSYNC_NEVER;
+
 /*
- * Write a lease to a file
+ * Append-only lease journal.
+ *
+ * With thousands of interfaces, per-lease files cause a stat/open storm
+ * at startup and directory-entry churn on every update. When enabled,
+ * all leases of a daemon live in one append-only journal file instead,
+ * backed by an in-memory index which is loaded with a single sequential
+ * read on first use. Every update appends a record superseding earlier
+ * ones; the journal is rewritten from the index once the dead-record
+ * ratio grows too large.
+ *
+ * A record is a text header line followed by the lease as binary xml:
+ *	lease <ifname> <type> <family> <length>\n<blob>
+ * A zero length record marks a removed lease.
  */
-int
-ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
+#define NI_LEASE_JOURNAL_COMPACT_MIN	64	/* records needed to consider compaction */
+#define NI_LEASE_JOURNAL_COMPACT_RATIO	4	/* total vs live record ratio triggering it */
+
+typedef struct ni_lease_journal_entry	ni_lease_journal_entry_t;
+struct ni_lease_journal_entry {
+	ni_lease_journal_entry_t *next;
+	char *			ifname;
+	int			type;
+	int			family;
+	xml_node_t *		xml;
+};
+
+static ni_bool_t		ni_lease_journal_enabled;
+static ni_bool_t		ni_lease_journal_loaded;
+static FILE *			ni_lease_journal_fp;
+static char *			ni_lease_journal_path;
+static ni_lease_journal_entry_t *ni_lease_journal_index;
+static unsigned int		ni_lease_journal_live;
+static unsigned int		ni_lease_journal_records;
+
+void
+ni_addrconf_lease_file_set_journal(ni_bool_t enable)
+{
+	ni_lease_journal_enabled = enable;
+}
+
+static const char *
+__ni_lease_journal_file_path(char **path, const char *dir)
+{
+	if (!path || ni_string_empty(dir))
+		return NULL;
+	return ni_string_printf(path, "%s/leases-%s.journal", dir,
+			program_invocation_short_name);
+}
+
+static ni_lease_journal_entry_t *
+__ni_lease_journal_find(const char *ifname, int type, int family)
+{
+	ni_lease_journal_entry_t *entry;
+
+	for (entry = ni_lease_journal_index; entry; entry = entry->next) {
+		if (entry->type == type && entry->family == family &&
+		    ni_string_eq(entry->ifname, ifname))
+			return entry;
+	}
+	return NULL;
+}
+
+static void
+__ni_lease_journal_entry_free(ni_lease_journal_entry_t *entry)
+{
+	ni_string_free(&entry->ifname);
+	if (entry->xml)
+		xml_node_free(entry->xml);
+	free(entry);
+}
+
+static void
+__ni_lease_journal_index_update(const char *ifname, int type, int family,
+				xml_node_t *xml)
+{
+	ni_lease_journal_entry_t **pos, *entry;
+
+	for (pos = &ni_lease_journal_index; (entry = *pos) != NULL; pos = &entry->next) {
+		if (entry->type == type && entry->family == family &&
+		    ni_string_eq(entry->ifname, ifname))
+			break;
+	}
+
+	if (xml == NULL) {
+		/* a tombstone record removes the lease */
+		if (entry) {
+			*pos = entry->next;
+			__ni_lease_journal_entry_free(entry);
+			ni_lease_journal_live--;
+		}
+	} else
+	if (entry) {
+		xml_node_free(entry->xml);
+		entry->xml = xml;
+	} else {
+		entry = xcalloc(1, sizeof(*entry));
+		ni_string_dup(&entry->ifname, ifname);
+		entry->type = type;
+		entry->family = family;
+		entry->xml = xml;
+		*pos = entry;
+		ni_lease_journal_live++;
+	}
+}
+
+static int
+__ni_lease_journal_record_write(FILE *fp, const char *ifname, int type, int family,
+				const xml_node_t *xml)
+{
+	char *blob = NULL;
+	size_t len = 0;
+	int ret = -1;
+
+	if (xml) {
+		FILE *mp;
+
+		if (!(mp = open_memstream(&blob, &len)))
+			return -1;
+		if (xml_node_write_binary(xml, mp) < 0) {
+			fclose(mp);
+			free(blob);
+			return -1;
+		}
+		fclose(mp);
+	}
+
+	if (fprintf(fp, "lease %s %s %s %zu\n", ifname,
+			ni_addrconf_type_to_name(type),
+			ni_addrfamily_type_to_name(family), len) > 0
+	 && (len == 0 || fwrite(blob, 1, len, fp) == len))
+		ret = 0;
+
+	free(blob);
+	return ret;
+}
+
+static void
+__ni_lease_journal_load(const char *path)
+{
+	char header[128];
+	FILE *fp;
+
+	if ((fp = fopen(path, "re")) == NULL) {
+		if (errno != ENOENT)
+			ni_error("Unable to open lease journal '%s': %m", path);
+		return;
+	}
+
+	ni_debug_dhcp("Loading lease journal from '%s'", path);
+	while (fgets(header, sizeof(header), fp)) {
+		char ifname[64], tname[32], fname[32];
+		unsigned long len = 0;
+		xml_node_t *xml = NULL;
+		int type, family;
+
+		if (sscanf(header, "lease %63s %31s %31s %lu",
+					ifname, tname, fname, &len) != 4 ||
+		    (type = ni_addrconf_name_to_type(tname)) < 0 ||
+		    (family = ni_addrfamily_name_to_type(fname)) < 0) {
+			ni_warn("Ignoring truncated tail of lease journal '%s'", path);
+			break;
+		}
+
+		if (len) {
+			unsigned char *blob;
+			FILE *mp;
+
+			blob = xmalloc(len);
+			if (fread(blob, 1, len, fp) != len) {
+				free(blob);
+				ni_warn("Ignoring truncated tail of lease journal '%s'", path);
+				break;
+			}
+			if ((mp = fmemopen(blob, len, "r")) != NULL) {
+				xml = xml_node_read_binary(mp, path);
+				fclose(mp);
+			}
+			free(blob);
+			if (xml == NULL) {
+				ni_warn("Ignoring corrupt lease record for %s in journal '%s'",
+						ifname, path);
+				ni_lease_journal_records++;
+				continue;
+			}
+		}
+
+		__ni_lease_journal_index_update(ifname, type, family, xml);
+		ni_lease_journal_records++;
+	}
+	fclose(fp);
+}
+
+static void
+__ni_lease_journal_ensure(void)
+{
+	char *path = NULL;
+
+	if (ni_lease_journal_loaded)
+		return;
+	ni_lease_journal_loaded = TRUE;
+
+	if (__ni_lease_journal_file_path(&ni_lease_journal_path, ni_config_storedir()))
+		__ni_lease_journal_load(ni_lease_journal_path);
+
+	/* merge the runtime fallback journal written on a read-only store */
+	if (__ni_lease_journal_file_path(&path, ni_config_statedir()) &&
+	    !ni_string_eq(path, ni_lease_journal_path))
+		__ni_lease_journal_load(path);
+	ni_string_free(&path);
+}
+
+static FILE *
+__ni_lease_journal_open(void)
+{
+	if (ni_lease_journal_fp)
+		return ni_lease_journal_fp;
+
+	if (!(ni_lease_journal_fp = fopen(ni_lease_journal_path, "ae")) &&
+	    errno == EROFS &&
+	    __ni_lease_journal_file_path(&ni_lease_journal_path, ni_config_statedir())) {
+		ni_debug_dhcp("Read-only filesystem, try fallback to %s",
+				ni_lease_journal_path);
+		ni_lease_journal_fp = fopen(ni_lease_journal_path, "ae");
+	}
+
+	if (!ni_lease_journal_fp)
+		ni_error("Cannot open lease journal '%s': %m", ni_lease_journal_path);
+	return ni_lease_journal_fp;
+}
+
+static void
+__ni_lease_journal_compact(void)
+{
+	char tempname[PATH_MAX] = {'\0'};
+	ni_lease_journal_entry_t *entry;
+	FILE *fp;
+	int fd;
+
+	if (ni_lease_journal_records < NI_LEASE_JOURNAL_COMPACT_MIN ||
+	    ni_lease_journal_records < ni_lease_journal_live * NI_LEASE_JOURNAL_COMPACT_RATIO)
+		return;
+
+	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", ni_lease_journal_path);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_error("Cannot create temporary lease journal '%s': %m", tempname);
+		return;
+	}
+	if ((fp = fdopen(fd, "we")) == NULL) {
+		ni_error("Cannot reopen temporary lease journal '%s': %m", tempname);
+		close(fd);
+		unlink(tempname);
+		return;
+	}
+
+	for (entry = ni_lease_journal_index; entry; entry = entry->next) {
+		if (__ni_lease_journal_record_write(fp, entry->ifname, entry->type,
+						entry->family, entry->xml) < 0) {
+			ni_error("Cannot rewrite lease journal '%s'", tempname);
+			fclose(fp);
+			unlink(tempname);
+			return;
+		}
+	}
+
+	/* compaction replaces the complete state; always make it durable
+	 * before the rename, independent of the fsync policy */
+	fflush(fp);
+	fsync(fileno(fp));
+	fclose(fp);
+
+	if (rename(tempname, ni_lease_journal_path) != 0) {
+		ni_error("Unable to rename temporary lease journal '%s' to '%s': %m",
+				tempname, ni_lease_journal_path);
+		unlink(tempname);
+		return;
+	}
+
+	if (ni_lease_journal_fp) {
+		fclose(ni_lease_journal_fp);
+		ni_lease_journal_fp = NULL;
+	}
+	ni_lease_journal_records = ni_lease_journal_live;
+	ni_debug_dhcp("Compacted lease journal '%s' to %u records",
+			ni_lease_journal_path, ni_lease_journal_live);
+}
+
+static int
+__ni_lease_journal_commit(const char *ifname, int type, int family,
+				const xml_node_t *xml, ni_bool_t deferred)
+{
+	FILE *fp;
+
+	__ni_lease_journal_ensure();
+	if (!(fp = __ni_lease_journal_open()))
+		return -1;
+
+	if (__ni_lease_journal_record_write(fp, ifname, type, family, xml) < 0 ||
+	    fflush(fp) != 0) {
+		ni_error("Cannot append %s:%s lease for %s to journal '%s'",
+				ni_addrfamily_type_to_name(family),
+				ni_addrconf_type_to_name(type), ifname,
+				ni_lease_journal_path);
+		return -1;
+	}
+	if (ni_lease_file_fsync == NI_LEASE_FILE_FSYNC_ALWAYS ||
+	    (ni_lease_file_fsync == NI_LEASE_FILE_FSYNC_DEADLINE && deferred))
+		fsync(fileno(fp));
+
+	__ni_lease_journal_index_update(ifname, type, family,
+			xml ? xml_node_clone(xml, NULL) : NULL);
+	ni_lease_journal_records++;
+	__ni_lease_journal_compact();
+
+	ni_debug_dhcp("Lease appended to journal '%s'", ni_lease_journal_path);
+	return 0;
+}
+
+/*
+ * Asynchronous commit tail.
+ *
+ * The fsync before the rename can block for tens of msec on busy
+ * storage. When the worker pool is running, the fully written temp
+ * file is handed off to a worker which syncs and renames it; the
+ * completion runs back on the event loop and does the logging and
+ * legacy statedir cleanup. Callers that need to observe the on-disk
+ * state (read/remove/exists) drain the pool first.
+ */
+typedef struct ni_lease_file_sync	ni_lease_file_sync_t;
+struct ni_lease_file_sync {
+	int			fd;
+	char *			tempname;
+	char *			filename;
+	ni_bool_t		fallback;
+	char *			ifname;
+	int			type;
+	int			family;
+	int			result;
+};
+
+static void
+__ni_lease_file_sync_work(void *user_data)
+{
+	ni_lease_file_sync_t *job = user_data;
+
+	fsync(job->fd);
+	close(job->fd);
+	if (rename(job->tempname, job->filename) != 0)
+		job->result = -errno;
+}
+
+static void
+__ni_lease_file_sync_done(void *user_data)
+{
+	ni_lease_file_sync_t *job = user_data;
+
+	if (job->result < 0) {
+		errno = -job->result;
+		ni_error("Unable to rename temporary lease file '%s' to '%s': %m",
+				job->tempname, job->filename);
+		unlink(job->tempname);
+	} else {
+		ni_debug_dhcp("Lease written to file '%s'", job->filename);
+		if (!job->fallback)
+			__ni_addrconf_lease_file_remove(ni_config_statedir(),
+					job->ifname, job->type, job->family);
+	}
+	ni_string_free(&job->tempname);
+	ni_string_free(&job->filename);
+	ni_string_free(&job->ifname);
+	free(job);
+}
+
+static void
+__ni_lease_file_commit_async(int fd, const char *tempname, const char *filename,
+				ni_bool_t fallback, const char *ifname,
+				int type, int family)
+{
+	ni_lease_file_sync_t *job;
+
+	job = xcalloc(1, sizeof(*job));
+	job->fd = fd;
+	ni_string_dup(&job->tempname, tempname);
+	ni_string_dup(&job->filename, filename);
+	job->fallback = fallback;
+	ni_string_dup(&job->ifname, ifname);
+	job->type = type;
+	job->family = family;
+
+	ni_workqueue_submit(__ni_lease_file_sync_work,
+			__ni_lease_file_sync_done, job);
+}
+
+/*
+ * Commit serialized lease data to disk (temp file plus rename).
+ *
+ * The deferred flag tells whether this commit comes from the write-behind
+ * flush (ie the state has already been coalesced up to the staleness
+ * deadline); the "deadline" fsync policy syncs these commits only.
+ */
+static int
+__ni_addrconf_lease_file_commit(const char *ifname, int type, int family,
+				const xml_node_t *xml, ni_bool_t deferred)
 {
 	char tempname[PATH_MAX] = {'\0'};
 	ni_bool_t fallback = FALSE;
 	char *filename = NULL;
-	xml_node_t *xml = NULL;
 	FILE *fp = NULL;
 	int ret = -1;
 	int fd;
 
-	if (lease->state == NI_ADDRCONF_STATE_RELEASED) {
-		ni_addrconf_lease_file_remove(ifname, lease->type, lease->family);
-		return 0;
-	}
+	if (ni_lease_journal_enabled)
+		return __ni_lease_journal_commit(ifname, type, family, xml, deferred);
 
 	if (!__ni_addrconf_lease_file_path(&filename, ni_config_storedir(),
-					ifname, lease->type, lease->family)) {
+					ifname, type, family)) {
 		ni_error("Cannot construct lease file name: %m");
 		return -1;
 	}
 
-	ni_debug_dhcp("Preparing xml lease data for '%s'", filename);
-	if ((ret = ni_addrconf_lease_to_xml(lease, &xml, ifname)) != 0) {
-		if (ret > 0) {
-			ni_debug_dhcp("Skipped, %s:%s leases are disabled",
-		                        ni_addrfamily_type_to_name(lease->family),
-					ni_addrconf_type_to_name(lease->type));
-		} else {
-			ni_error("Unable to represent %s:%s lease as XML",
-					ni_addrfamily_type_to_name(lease->family),
-					ni_addrconf_type_to_name(lease->type));
-		}
-		goto failed;
-	}
-
 	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
 	if ((fd = mkstemp(tempname)) < 0) {
 		if (errno == EROFS && __ni_addrconf_lease_file_path(&filename,
 						ni_config_statedir(), ifname,
-						lease->type, lease->family)) {
+						type, family)) {
 			ni_debug_dhcp("Read-only filesystem, try fallback to %s",
 					filename);
 			snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
@@ -1311,9 +1697,29 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 	}
 
 	ni_debug_dhcp("Writing lease to temporary file for '%s'", filename);
-	xml_node_print(xml, fp);
+	/* store leases in the compact binary form; the xml writer remains
+	 * available for export via "wicked lease <file> convert" */
+	if (xml_node_write_binary(xml, fp) < 0) {
+		ni_error("Cannot write lease to temporary file '%s'", tempname);
+		goto failed;
+	}
+	if (ni_lease_file_fsync == NI_LEASE_FILE_FSYNC_ALWAYS ||
+	    (ni_lease_file_fsync == NI_LEASE_FILE_FSYNC_DEADLINE && deferred)) {
+		/* offload the blocking sync plus rename to a worker; the
+		 * dup'd descriptor keeps the temp file alive across the
+		 * fclose below */
+		if (ni_workqueue_active() && (fd = dup(fileno(fp))) >= 0) {
+			fclose(fp);
+			__ni_lease_file_commit_async(fd, tempname, filename,
+					fallback, ifname, type, family);
+			ni_string_free(&filename);
+			return 0;
+		}
+		fflush(fp);
+		fsync(fileno(fp));
+	}
 	fclose(fp);
-	xml_node_free(xml);
+	fp = NULL;
 
 	if ((ret = rename(tempname, filename)) != 0) {
 		ni_error("Unable to rename temporary lease file '%s' to '%s': %m",
@@ -1321,7 +1727,7 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 		goto failed;
 	} else if (!fallback) {
 		__ni_addrconf_lease_file_remove(ni_config_statedir(),
-				ifname, lease->type, lease->family);
+				ifname, type, family);
 	}
 
 	ni_debug_dhcp("Lease written to file '%s'", filename);
@@ -1331,14 +1737,209 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 failed:
 	if (fp)
 		fclose(fp);
-	if (xml)
-		xml_node_free(xml);
 	if (tempname[0])
 		unlink(tempname);
 	ni_string_free(&filename);
 	return -1;
 }
 
+/*
+ * Write-behind queue for lease files.
+ *
+ * Lease updates are staged in memory as serialized XML, coalesced per
+ * (interface, type, family), and flushed from a timer, so the FSM does
+ * not wait on storage for every lease change. A zero flush delay
+ * restores fully synchronous writes; the fsync knob trades crash
+ * durability against flush cost.
+ */
+#define NI_LEASE_FILE_FLUSH_DELAY	500	/* msec */
+
+typedef struct ni_lease_file_update	ni_lease_file_update_t;
+struct ni_lease_file_update {
+	ni_lease_file_update_t *next;
+	char *			ifname;
+	int			type;
+	int			family;
+	xml_node_t *		xml;
+};
+
+static ni_lease_file_update_t *	ni_lease_file_updates;
+static const ni_timer_t *	ni_lease_file_flush_timer;
+static unsigned int		ni_lease_file_flush_delay = NI_LEASE_FILE_FLUSH_DELAY;
+
+void
+ni_addrconf_lease_file_set_flush_delay(unsigned int msec)
+{
+	ni_lease_file_flush_delay = msec;
+}
+
+void
+ni_addrconf_lease_file_set_fsync(ni_lease_file_fsync_t mode)
+{
+	ni_lease_file_fsync = mode;
+}
+
+static const ni_intmap_t	ni_lease_file_fsync_names[] = {
+	{ "never",		NI_LEASE_FILE_FSYNC_NEVER	},
+	{ "deadline",		NI_LEASE_FILE_FSYNC_DEADLINE	},
+	{ "always",		NI_LEASE_FILE_FSYNC_ALWAYS	},
+
+	{ NULL,			0				}
+};
+
+ni_bool_t
+ni_addrconf_lease_file_set_fsync_policy(const char *name)
+{
+	unsigned int mode;
+
+	if (ni_parse_uint_mapped(name, ni_lease_file_fsync_names, &mode) < 0)
+		return FALSE;
+
+	ni_lease_file_fsync = mode;
+	return TRUE;
+}
+
+static void
+__ni_lease_file_update_free(ni_lease_file_update_t *up)
+{
+	ni_string_free(&up->ifname);
+	if (up->xml)
+		xml_node_free(up->xml);
+	free(up);
+}
+
+static ni_lease_file_update_t *
+__ni_lease_file_update_find(const char *ifname, int type, int family)
+{
+	ni_lease_file_update_t *up;
+
+	for (up = ni_lease_file_updates; up; up = up->next) {
+		if (up->type == type && up->family == family &&
+		    ni_string_eq(up->ifname, ifname))
+			return up;
+	}
+	return NULL;
+}
+
+static void
+__ni_lease_file_update_drop(const char *ifname, int type, int family)
+{
+	ni_lease_file_update_t **pos, *up;
+
+	for (pos = &ni_lease_file_updates; (up = *pos) != NULL; pos = &up->next) {
+		if (up->type == type && up->family == family &&
+		    ni_string_eq(up->ifname, ifname)) {
+			*pos = up->next;
+			__ni_lease_file_update_free(up);
+			return;
+		}
+	}
+}
+
+void
+ni_addrconf_lease_file_flush(void)
+{
+	ni_lease_file_update_t *up;
+
+	if (ni_lease_file_flush_timer) {
+		ni_timer_cancel(ni_lease_file_flush_timer);
+		ni_lease_file_flush_timer = NULL;
+	}
+
+	while ((up = ni_lease_file_updates) != NULL) {
+		ni_lease_file_updates = up->next;
+
+		__ni_addrconf_lease_file_commit(up->ifname,
+				up->type, up->family, up->xml, TRUE);
+		__ni_lease_file_update_free(up);
+	}
+}
+
+static void
+__ni_lease_file_flush_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_lease_file_flush_timer = NULL;
+	ni_addrconf_lease_file_flush();
+}
+
+static void
+__ni_lease_file_update_queue(const char *ifname, int type, int family,
+				xml_node_t *xml)
+{
+	static ni_bool_t atexit_registered;
+	ni_lease_file_update_t *up;
+
+	if ((up = __ni_lease_file_update_find(ifname, type, family)) != NULL) {
+		/* Coalesce: only the most recent state matters */
+		xml_node_free(up->xml);
+		up->xml = xml;
+	} else {
+		ni_lease_file_update_t **pos;
+
+		up = xcalloc(1, sizeof(*up));
+		ni_string_dup(&up->ifname, ifname);
+		up->type = type;
+		up->family = family;
+		up->xml = xml;
+
+		for (pos = &ni_lease_file_updates; *pos; pos = &(*pos)->next)
+			;
+		*pos = up;
+	}
+
+	if (!atexit_registered) {
+		atexit_registered = TRUE;
+		atexit(ni_addrconf_lease_file_flush);
+	}
+
+	if (!ni_lease_file_flush_timer) {
+		ni_lease_file_flush_timer = ni_timer_register(
+				ni_lease_file_flush_delay,
+				__ni_lease_file_flush_timeout, NULL);
+	}
+}
+
+/*
+ * Write a lease to a file
+ */
+int
+ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
+{
+	xml_node_t *xml = NULL;
+	int ret;
+
+	if (lease->state == NI_ADDRCONF_STATE_RELEASED) {
+		ni_addrconf_lease_file_remove(ifname, lease->type, lease->family);
+		return 0;
+	}
+
+	ni_debug_dhcp("Preparing xml lease data for %s:%s lease on %s",
+			ni_addrfamily_type_to_name(lease->family),
+			ni_addrconf_type_to_name(lease->type), ifname);
+	if ((ret = ni_addrconf_lease_to_xml(lease, &xml, ifname)) != 0) {
+		if (ret > 0) {
+			ni_debug_dhcp("Skipped, %s:%s leases are disabled",
+		                        ni_addrfamily_type_to_name(lease->family),
+					ni_addrconf_type_to_name(lease->type));
+		} else {
+			ni_error("Unable to represent %s:%s lease as XML",
+					ni_addrfamily_type_to_name(lease->family),
+					ni_addrconf_type_to_name(lease->type));
+		}
+		return -1;
+	}
+
+	if (ni_lease_file_flush_delay == 0) {
+		ret = __ni_addrconf_lease_file_commit(ifname, lease->type,
+						lease->family, xml, FALSE);
+		xml_node_free(xml);
+		return ret;
+	}
+
+	__ni_lease_file_update_queue(ifname, lease->type, lease->family, xml);
+	return 0;
+}
+
 /*
  * Read a lease from a file
  */
@@ -1347,9 +1948,40 @@ ni_addrconf_lease_file_read(const char *ifname, int type, int family)
 {
 	ni_addrconf_lease_t *lease = NULL;
 	xml_node_t *xml = NULL, *lnode;
+	const ni_lease_file_update_t *up;
 	char *filename = NULL;
 	FILE *fp;
 
+	/* A queued but not yet flushed update is the current state */
+	if ((up = __ni_lease_file_update_find(ifname, type, family)) != NULL) {
+		if (ni_addrconf_lease_from_xml(&lease, up->xml, ifname) < 0) {
+			ni_error("Unable to parse queued %s:%s lease for %s",
+					ni_addrfamily_type_to_name(family),
+					ni_addrconf_type_to_name(type), ifname);
+			return NULL;
+		}
+		return lease;
+	}
+
+	if (ni_lease_journal_enabled) {
+		const ni_lease_journal_entry_t *entry;
+
+		__ni_lease_journal_ensure();
+		if ((entry = __ni_lease_journal_find(ifname, type, family)) != NULL) {
+			if (ni_addrconf_lease_from_xml(&lease, entry->xml, ifname) < 0) {
+				ni_error("Unable to parse journaled %s:%s lease for %s",
+						ni_addrfamily_type_to_name(family),
+						ni_addrconf_type_to_name(type), ifname);
+				return NULL;
+			}
+			return lease;
+		}
+		/* fall through: migrate leases still kept in per-interface files */
+	}
+
+	/* make sure in-flight async commits are visible on disk */
+	ni_workqueue_drain();
+
 	if (!__ni_addrconf_lease_file_path(&filename,
 				ni_config_statedir(),
 				ifname, type, family)) {
@@ -1375,7 +2007,10 @@ ni_addrconf_lease_file_read(const char *ifname, int type, int family)
 	}
 
 	ni_debug_dhcp("Reading lease from %s", filename);
-	xml = xml_node_scan(fp, filename);
+	if (xml_binary_sniff(fp))
+		xml = xml_node_read_binary(fp, filename);
+	else
+		xml = xml_node_scan(fp, filename);
 	fclose(fp);
 
 	if (xml == NULL) {
@@ -1428,6 +2063,16 @@ __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
 void
 ni_addrconf_lease_file_remove(const char *ifname, int type, int family)
 {
+	__ni_lease_file_update_drop(ifname, type, family);
+	if (ni_lease_journal_enabled) {
+		__ni_lease_journal_ensure();
+		if (__ni_lease_journal_find(ifname, type, family))
+			__ni_lease_journal_commit(ifname, type, family, NULL, FALSE);
+	}
+	/* make sure no in-flight async commit resurrects the file */
+	ni_workqueue_drain();
+
+	/* also remove per-interface files left from a non-journal setup */
 	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family);
 	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family);
 }
@@ -1449,6 +2094,18 @@ ni_addrconf_lease_file_exists(const char *ifname, int type, int family)
 {
 	char *filename = NULL;
 
+	if (__ni_lease_file_update_find(ifname, type, family))
+		return TRUE;
+
+	if (ni_lease_journal_enabled) {
+		__ni_lease_journal_ensure();
+		if (__ni_lease_journal_find(ifname, type, family))
+			return TRUE;
+	}
+
+	/* make sure in-flight async commits are visible on disk */
+	ni_workqueue_drain();
+
 	if (__ni_addrconf_lease_file_path(&filename, ni_config_statedir(), ifname, type, family)) {
 		if (ni_file_exists(filename)) {
 			ni_string_free(&filename);
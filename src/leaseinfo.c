@@ -49,32 +49,33 @@
 #include "util_priv.h"
 #include "dhcp6/options.h"
 #include "dhcp.h"
+#include "json.h"
 
 static const char *	__ni_keyword_format(char **, const char *,
 					const char *, unsigned int);
-static void		__ni_leaseinfo_print_string(FILE *, const char *,
+static void		__ni_leaseinfo_put_string(ni_var_array_t *, const char *,
 					const char *, const char *,
 					const char *, unsigned int);
-static void		__ni_leaseinfo_print_string_array(FILE *, const char *,
+static void		__ni_leaseinfo_put_string_array(ni_var_array_t *, const char *,
 					const char *, const ni_string_array_t *,
 					const char *);
-static void		__ni_leaseinfo_dhcp4_dump(FILE *,
+static void		__ni_leaseinfo_dhcp4_collect(ni_var_array_t *,
 				const ni_addrconf_lease_t *,
 				const char *, const char *);
-static void		__ni_leaseinfo_dhcp6_dump(FILE *,
+static void		__ni_leaseinfo_dhcp6_collect(ni_var_array_t *,
 				const ni_addrconf_lease_t *,
 				const char *, const char *);
-static void		__ni_leaseinfo_print_addrs(FILE *, const char *,
+static void		__ni_leaseinfo_put_addrs(ni_var_array_t *, const char *,
 					ni_address_t *, unsigned int);
-static void		__ni_leaseinfo_print_routes(FILE *, const char *,
+static void		__ni_leaseinfo_put_routes(ni_var_array_t *, const char *,
 					ni_route_table_t *, unsigned int);
-static void		__ni_leaseinfo_print_nis(FILE *, const char *,
+static void		__ni_leaseinfo_put_nis(ni_var_array_t *, const char *,
 					ni_nis_info_t *);
-static void		__ni_leaseinfo_print_resolver(FILE *, const char *,
+static void		__ni_leaseinfo_put_resolver(ni_var_array_t *, const char *,
 					ni_resolver_info_t *, const char *);
-static void		__ni_leaseinfo_print_netbios(FILE *, const char *,
+static void		__ni_leaseinfo_put_netbios(ni_var_array_t *, const char *,
 					const ni_addrconf_lease_t *);
-static void		__ni_leaseinfo_dump(FILE *, const ni_addrconf_lease_t *,
+static void		__ni_leaseinfo_collect(ni_var_array_t *, const ni_addrconf_lease_t *,
 				const char *, const char *);
 #if 0
 static const char *	__ni_leaseinfo_strftime(time_t);
@@ -94,32 +95,29 @@ __ni_keyword_format(char **key, const char *prefix,
 }
 
 static void
-__ni_leaseinfo_print_string(FILE *out, const char *prefix, const char *name,
+__ni_leaseinfo_put_string(ni_var_array_t *vars, const char *prefix, const char *name,
 			const char *val, const char *default_val,
 			unsigned int index)
 {
 	char *key = NULL;
-	const char *val_to_print = NULL;
 
 	if (ni_string_empty(val) && !default_val)
 		return;
 
-	val_to_print = val ? val : default_val;
-
-	fprintf(out, "%s='%s'\n", __ni_keyword_format
-		(&key, prefix, name, index),
-		val_to_print);
+	ni_var_array_append(vars, __ni_keyword_format
+			(&key, prefix, name, index),
+			val ? val : default_val);
 
 	ni_string_free(&key);
 }
 
 static void
-__ni_leaseinfo_print_string_array(FILE *out, const char *prefix, const char *name,
+__ni_leaseinfo_put_string_array(ni_var_array_t *vars, const char *prefix, const char *name,
 				const ni_string_array_t *str_arr, const char *sep)
 {
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	char *key = NULL;
 	unsigned int i;
-	ni_bool_t doneone;
 
 	if (!str_arr || str_arr->count == 0)
 		return;
@@ -127,23 +125,22 @@ __ni_leaseinfo_print_string_array(FILE *out, const char *prefix, const char *nam
 	if (!sep)
 		sep = " ";
 
-	doneone = FALSE;
-	fprintf(out, "%s='", __ni_keyword_format
-		(&key, prefix, name, 0));
-
 	for (i = 0; i < str_arr->count; ++i) {
-		if (doneone)
-			fprintf(out, " ");
-		fprintf(out, "%s", str_arr->data[i]);
-		doneone = TRUE;
+		if (i)
+			ni_stringbuf_puts(&buf, sep);
+		ni_stringbuf_puts(&buf, str_arr->data[i]);
 	}
-	fprintf(out, "'\n");
 
+	ni_var_array_append(vars, __ni_keyword_format
+			(&key, prefix, name, 0),
+			buf.string ? buf.string : "");
+
+	ni_stringbuf_destroy(&buf);
 	ni_string_free(&key);
 }
 
 static void
-__ni_leaseinfo_print_addrs(FILE *out, const char *prefix, ni_address_t *addrs,
+__ni_leaseinfo_put_addrs(ni_var_array_t *vars, const char *prefix, ni_address_t *addrs,
 				unsigned int family)
 {
 	ni_address_t *ap;
@@ -161,26 +158,26 @@ __ni_leaseinfo_print_addrs(FILE *out, const char *prefix, ni_address_t *addrs,
 			ni_string_printf(&buf, "%s/%u",
 						ni_sockaddr_print(&ap->local_addr),
 						ap->prefixlen);
-			__ni_leaseinfo_print_string(out, prefix, "IPADDR",
+			__ni_leaseinfo_put_string(vars, prefix, "IPADDR",
 						buf, NULL, i);
 			ni_string_free(&buf);
 
 			ni_sockaddr_build_netmask(ap->family,ap->prefixlen, &nm);
-			__ni_leaseinfo_print_string(out, prefix, "NETMASK",
+			__ni_leaseinfo_put_string(vars, prefix, "NETMASK",
 						ni_sockaddr_print(&nm), NULL, i);
 
 			ni_sockaddr_set_ipv4(&net, nm.sin.sin_addr, 0);
 			net.sin.sin_addr.s_addr &= ap->local_addr.sin.sin_addr.s_addr;
-			__ni_leaseinfo_print_string(out, prefix, "NETWORK",
+			__ni_leaseinfo_put_string(vars, prefix, "NETWORK",
 						ni_sockaddr_print(&net), NULL, i);
 
 			if (!ni_sockaddr_is_unspecified(&ap->bcast_addr)) {
-				__ni_leaseinfo_print_string(out, prefix, "BROADCAST",
+				__ni_leaseinfo_put_string(vars, prefix, "BROADCAST",
 						ni_sockaddr_print(&ap->bcast_addr), NULL, i);
 			}
 
 			ni_string_printf(&buf, "%u", ap->prefixlen);
-			__ni_leaseinfo_print_string(out, prefix, "PREFIXLEN",
+			__ni_leaseinfo_put_string(vars, prefix, "PREFIXLEN",
 						buf, NULL, i);
 			ni_string_free(&buf);
 
@@ -191,12 +188,12 @@ __ni_leaseinfo_print_addrs(FILE *out, const char *prefix, ni_address_t *addrs,
 			ni_string_printf(&buf, "%s/%u",
 						ni_sockaddr_print(&ap->local_addr),
 						ap->prefixlen);
-			__ni_leaseinfo_print_string(out, prefix, "IPADDR",
+			__ni_leaseinfo_put_string(vars, prefix, "IPADDR",
 						buf, NULL, i);
 			ni_string_free(&buf);
 
 			ni_string_printf(&buf, "%u", ap->prefixlen);
-			__ni_leaseinfo_print_string(out, prefix, "PREFIXLEN",
+			__ni_leaseinfo_put_string(vars, prefix, "PREFIXLEN",
 						buf, NULL, i);
 			ni_string_free(&buf);
 
@@ -249,7 +246,7 @@ __ni_leaseinfo_format_route(ni_string_array_t *routes, ni_string_array_t *gates,
 }
 
 static void
-__ni_leaseinfo_print_routes(FILE *out, const char *prefix,
+__ni_leaseinfo_put_routes(ni_var_array_t *vars, const char *prefix,
 			ni_route_table_t *routes, unsigned int family)
 {
 	ni_string_array_t routes_entry_arr = NI_STRING_ARRAY_INIT;
@@ -282,9 +279,9 @@ __ni_leaseinfo_print_routes(FILE *out, const char *prefix,
 		}
 	}
 
-	__ni_leaseinfo_print_string_array(out, prefix, "ROUTES",
+	__ni_leaseinfo_put_string_array(vars, prefix, "ROUTES",
 					&routes_entry_arr, " ");
-	__ni_leaseinfo_print_string_array(out, prefix, "GATEWAYS",
+	__ni_leaseinfo_put_string_array(vars, prefix, "GATEWAYS",
 					&gw_entry_arr, " ");
 
 	ni_string_array_destroy(&routes_entry_arr);
@@ -293,25 +290,25 @@ __ni_leaseinfo_print_routes(FILE *out, const char *prefix,
 }
 
 static void
-__ni_leaseinfo_print_nis(FILE *out, const char *prefix, ni_nis_info_t *nis)
+__ni_leaseinfo_put_nis(ni_var_array_t *vars, const char *prefix, ni_nis_info_t *nis)
 {
 	unsigned int i;
 
 	if (!nis)
 		return;
 
-	__ni_leaseinfo_print_string(out, prefix, "NISDOMAIN", nis->domainname,
+	__ni_leaseinfo_put_string(vars, prefix, "NISDOMAIN", nis->domainname,
 				NULL, 0);
 
-	__ni_leaseinfo_print_string_array(out, prefix, "NISSERVERS",
+	__ni_leaseinfo_put_string_array(vars, prefix, "NISSERVERS",
 					&nis->default_servers, " ");
 
 	for (i = 0; i < nis->domains.count; ++i) {
-		__ni_leaseinfo_print_string(out, prefix, "NISDOMAIN",
+		__ni_leaseinfo_put_string(vars, prefix, "NISDOMAIN",
 					nis->domains.data[i]->domainname,
 					NULL, i);
 
-		__ni_leaseinfo_print_string_array(out, prefix, "NISSERVERS",
+		__ni_leaseinfo_put_string_array(vars, prefix, "NISSERVERS",
 						&nis->domains.data[i]->servers,
 						" ");
 	}
@@ -348,7 +345,7 @@ __ni_leaseinfo_qualify_addrs(ni_string_array_t *out,  const ni_string_array_t *i
 }
 
 static void
-__ni_leaseinfo_print_resolver(FILE *out, const char *prefix,
+__ni_leaseinfo_put_resolver(ni_var_array_t *vars, const char *prefix,
 			ni_resolver_info_t *resolver, const char *ifname)
 {
 	ni_string_array_t dns_servers = NI_STRING_ARRAY_INIT;
@@ -356,37 +353,37 @@ __ni_leaseinfo_print_resolver(FILE *out, const char *prefix,
 	if (!resolver)
 		return;
 
-	__ni_leaseinfo_print_string(out, prefix, "DNSDOMAIN",
+	__ni_leaseinfo_put_string(vars, prefix, "DNSDOMAIN",
 				resolver->default_domain, NULL, 0);
 
 	__ni_leaseinfo_qualify_addrs(&dns_servers, &resolver->dns_servers, ifname);
-	__ni_leaseinfo_print_string_array(out, prefix, "DNSSERVERS",
+	__ni_leaseinfo_put_string_array(vars, prefix, "DNSSERVERS",
 					&dns_servers, " ");
 	ni_string_array_destroy(&dns_servers);
 
-	__ni_leaseinfo_print_string_array(out, prefix, "DNSSEARCH",
+	__ni_leaseinfo_put_string_array(vars, prefix, "DNSSEARCH",
 					&resolver->dns_search, " ");
 }
 
 static void
-__ni_leaseinfo_print_netbios(FILE *out, const char *prefix,
+__ni_leaseinfo_put_netbios(ni_var_array_t *vars, const char *prefix,
 			const ni_addrconf_lease_t *lease)
 {
 	/* Netbios Name Servers */
-	__ni_leaseinfo_print_string_array(out, prefix, "NETBIOSNAMESERVER",
+	__ni_leaseinfo_put_string_array(vars, prefix, "NETBIOSNAMESERVER",
 					&lease->netbios_name_servers, " ");
 
 	/* Netbios Datagram Distribution Servers */
-	__ni_leaseinfo_print_string_array(out, prefix, "NETBIOSDDSERVER",
+	__ni_leaseinfo_put_string_array(vars, prefix, "NETBIOSDDSERVER",
 					&lease->netbios_dd_servers, " ");
 
 	/* Netbios Scope */
-	__ni_leaseinfo_print_string(out, prefix, "NETBIOSSCOPE",
+	__ni_leaseinfo_put_string(vars, prefix, "NETBIOSSCOPE",
 				lease->netbios_scope,
 				NULL, 0);
 
 	/* Netbios Type */
-	__ni_leaseinfo_print_string(out, prefix, "NETBIOSNODETYPE",
+	__ni_leaseinfo_put_string(vars, prefix, "NETBIOSNODETYPE",
 				ni_netbios_node_type_to_name(lease->netbios_type),
 				NULL, 0);
 }
@@ -421,14 +418,14 @@ __ni_leaseinfo_convert_dhcp_name(ni_stringbuf_t *result, const char *prefix, con
 }
 
 static void
-__ni_leaseinfo_print_dhcp_opts(FILE *out, const char *prefix,
+__ni_leaseinfo_put_dhcp_opts(ni_var_array_t *vars, const char *prefix,
 				const ni_dhcp_option_decl_t *custom,
 				const ni_dhcp_option_t *options)
 {
 	ni_stringbuf_t name = NI_STRINGBUF_INIT_DYNAMIC;
 	const ni_dhcp_option_decl_t *decl;
 	const ni_dhcp_option_t *opt;
-	ni_var_array_t *vars;
+	ni_var_array_t *optvars;
 	char *hstr = NULL;
 
 	for (opt = options; opt; opt = opt->next) {
@@ -437,17 +434,17 @@ __ni_leaseinfo_print_dhcp_opts(FILE *out, const char *prefix,
 
 		ni_stringbuf_clear(&name);
 		decl = ni_dhcp_option_decl_list_find_by_code(custom, opt->code);
-		if (decl && (vars = ni_dhcp_option_to_vars(opt, decl))) {
+		if (decl && (optvars = ni_dhcp_option_to_vars(opt, decl))) {
 			unsigned int i;
 			ni_var_t *var;
 
-			for (i = 0, var = vars->data; i < vars->count; ++i, ++var) {
+			for (i = 0, var = optvars->data; i < optvars->count; ++i, ++var) {
 				if (__ni_leaseinfo_convert_dhcp_name(&name, "OPTION_", var->name))
-					__ni_leaseinfo_print_string(out, prefix, name.string,
+					__ni_leaseinfo_put_string(vars, prefix, name.string,
 							var->value, NULL, 0);
 				ni_stringbuf_destroy(&name);
 			}
-			ni_var_array_free(vars);
+			ni_var_array_free(optvars);
 			continue;
 		}
 
@@ -456,7 +453,7 @@ __ni_leaseinfo_print_dhcp_opts(FILE *out, const char *prefix,
 			continue;
 
 		hstr = ni_sprint_hex(opt->data, opt->len);
-		__ni_leaseinfo_print_string(out, prefix, name.string, hstr, "", 0);
+		__ni_leaseinfo_put_string(vars, prefix, name.string, hstr, "", 0);
 		ni_string_free(&hstr);
 	}
 	ni_stringbuf_destroy(&name);
@@ -479,11 +476,11 @@ __ni_leaseinfo_strftime(time_t t)
 #endif
 
 static void
-__ni_leaseinfo_dhcp4_dump(FILE *out, const ni_addrconf_lease_t *lease,
+__ni_leaseinfo_dhcp4_collect(ni_var_array_t *vars, const ni_addrconf_lease_t *lease,
 			const char *ifname, const char *prefix)
 {
 	const ni_config_dhcp4_t *config;
-	char *key = NULL;
+	char *buf = NULL;
 	ni_sockaddr_t sa;
 
 	/*
@@ -492,123 +489,122 @@ __ni_leaseinfo_dhcp4_dump(FILE *out, const ni_addrconf_lease_t *lease,
 	 * duplicating here.
 	 */
 	if (lease->dhcp4.client_id.len) {
-		__ni_leaseinfo_print_string(out, prefix, "CLIENTID",
+		__ni_leaseinfo_put_string(vars, prefix, "CLIENTID",
 				ni_print_hex(lease->dhcp4.client_id.data,
 				lease->dhcp4.client_id.len), "", 0);
 	}
 	ni_sockaddr_set_ipv4(&sa, lease->dhcp4.server_id, 0);
 	if (ni_sockaddr_is_specified(&sa)) {
-		__ni_leaseinfo_print_string(out, prefix, "SERVERID",
+		__ni_leaseinfo_put_string(vars, prefix, "SERVERID",
 					ni_sockaddr_print(&sa), NULL, 0);
 	}
 	ni_sockaddr_set_ipv4(&sa, lease->dhcp4.relay_addr, 0);
 	if (ni_sockaddr_is_specified(&sa)) {
-		__ni_leaseinfo_print_string(out, prefix, "RELAYADDR",
+		__ni_leaseinfo_put_string(vars, prefix, "RELAYADDR",
 					ni_sockaddr_print(&sa), NULL, 0);
 	}
 	if (lease->dhcp4.sender_hwa) {
-		__ni_leaseinfo_print_string(out, prefix, "SENDERHWADDR",
+		__ni_leaseinfo_put_string(vars, prefix, "SENDERHWADDR",
 					lease->dhcp4.sender_hwa, NULL, 0);
 	}
 
 	if (lease->acquired.tv_sec) {
-		fprintf(out, "%s='%"PRId64"'\n", __ni_keyword_format
-				(&key, prefix, "ACQUIRED", 0),
+		ni_string_printf(&buf, "%"PRId64,
 				(int64_t) lease->acquired.tv_sec);
+		__ni_leaseinfo_put_string(vars, prefix, "ACQUIRED", buf, NULL, 0);
+		ni_string_free(&buf);
 	}
 	if (lease->dhcp4.lease_time)  {
-		fprintf(out, "%s='%"PRIu32"'\n", __ni_keyword_format
-				(&key, prefix, "LEASETIME", 0),
-				lease->dhcp4.lease_time);
+		ni_string_printf(&buf, "%"PRIu32, lease->dhcp4.lease_time);
+		__ni_leaseinfo_put_string(vars, prefix, "LEASETIME", buf, NULL, 0);
+		ni_string_free(&buf);
 	}
 	if (lease->dhcp4.renewal_time) {
-		fprintf(out, "%s='%"PRIu32"'\n", __ni_keyword_format
-				(&key, prefix, "RENEWALTIME", 0),
-				lease->dhcp4.renewal_time);
+		ni_string_printf(&buf, "%"PRIu32, lease->dhcp4.renewal_time);
+		__ni_leaseinfo_put_string(vars, prefix, "RENEWALTIME", buf, NULL, 0);
+		ni_string_free(&buf);
 	}
 	if (lease->dhcp4.rebind_time) {
-		fprintf(out, "%s='%"PRIu32"'\n", __ni_keyword_format
-				(&key, prefix, "REBINDTIME", 0),
-				lease->dhcp4.rebind_time);
+		ni_string_printf(&buf, "%"PRIu32, lease->dhcp4.rebind_time);
+		__ni_leaseinfo_put_string(vars, prefix, "REBINDTIME", buf, NULL, 0);
+		ni_string_free(&buf);
 	}
 
 	ni_sockaddr_set_ipv4(&sa, lease->dhcp4.boot_saddr, 0);
 	if (ni_sockaddr_is_specified(&sa)) {
-		__ni_leaseinfo_print_string(out, prefix, "BOOTSERVERADDR",
+		__ni_leaseinfo_put_string(vars, prefix, "BOOTSERVERADDR",
 				ni_sockaddr_print(&sa), NULL, 0);
 	}
 	if (lease->dhcp4.boot_sname) {
-		__ni_leaseinfo_print_string(out, prefix, "BOOTSERVERNAME",
+		__ni_leaseinfo_put_string(vars, prefix, "BOOTSERVERNAME",
 					lease->dhcp4.boot_sname,
 					NULL, 0);
 	}
-	__ni_leaseinfo_print_string(out, prefix, "BOOTFILE",
+	__ni_leaseinfo_put_string(vars, prefix, "BOOTFILE",
 				lease->dhcp4.boot_file,
 				NULL, 0);
 
-	__ni_leaseinfo_print_string(out, prefix, "ROOTPATH",
+	__ni_leaseinfo_put_string(vars, prefix, "ROOTPATH",
 				lease->dhcp4.root_path,
 				NULL, 0);
 
-	__ni_leaseinfo_print_string(out, prefix, "MESSAGE",
+	__ni_leaseinfo_put_string(vars, prefix, "MESSAGE",
 				lease->dhcp4.message,
 				NULL, 0);
 
 	if (lease->dhcp4.mtu) {
-		fprintf(out, "%s='%"PRIu16"'\n", __ni_keyword_format
-			(&key, prefix, "MTU", 0),
-			lease->dhcp4.mtu);
+		ni_string_printf(&buf, "%"PRIu16, lease->dhcp4.mtu);
+		__ni_leaseinfo_put_string(vars, prefix, "MTU", buf, NULL, 0);
+		ni_string_free(&buf);
 	}
 
 	config = ni_config_dhcp4_find_device(ifname);
-	__ni_leaseinfo_print_dhcp_opts(out, prefix, config ?
+	__ni_leaseinfo_put_dhcp_opts(vars, prefix, config ?
 			config->custom_options : NULL,
 			lease->dhcp4.options);
-
-	ni_string_free(&key);
 }
 
 static void
-__ni_leaseinfo_dhcp6_dump(FILE *out, const ni_addrconf_lease_t *lease,
+__ni_leaseinfo_dhcp6_collect(ni_var_array_t *vars, const ni_addrconf_lease_t *lease,
 			const char *ifname, const char *prefix)
 {
 	const ni_config_dhcp6_t *config;
-	char *key = NULL;
+	char *buf = NULL;
 	ni_sockaddr_t sa;
 
 	if (lease->acquired.tv_sec) {
-		fprintf(out, "%s='%"PRIu64"'\n", __ni_keyword_format
-				(&key, prefix, "ACQUIRED", 0),
+		ni_string_printf(&buf, "%"PRIu64,
 				(uint64_t) lease->acquired.tv_sec);
+		__ni_leaseinfo_put_string(vars, prefix, "ACQUIRED", buf, NULL, 0);
+		ni_string_free(&buf);
 	}
 
 	if (lease->dhcp6.client_id.len) {
-		__ni_leaseinfo_print_string(out, prefix, "CLIENTID",
+		__ni_leaseinfo_put_string(vars, prefix, "CLIENTID",
 				ni_print_hex(lease->dhcp6.client_id.data,
 					lease->dhcp6.client_id.len), "", 0);
 	}
 
 	if (lease->dhcp6.server_id.len) {
-		__ni_leaseinfo_print_string(out, prefix, "SERVERID",
+		__ni_leaseinfo_put_string(vars, prefix, "SERVERID",
 				ni_print_hex(lease->dhcp6.server_id.data,
 					lease->dhcp6.server_id.len), "", 0);
 	}
 	ni_sockaddr_set_ipv6(&sa, lease->dhcp6.server_addr, 0);
 	if (ni_sockaddr_is_specified(&sa)) {
-		__ni_leaseinfo_print_string(out, prefix, "SERVERADDR",
+		__ni_leaseinfo_put_string(vars, prefix, "SERVERADDR",
 				ni_sockaddr_print(&sa), NULL, 0);
 	}
 	if (lease->dhcp6.server_pref) {
-		fprintf(out, "%s='%"PRIu8"'\n", __ni_keyword_format
-			(&key, prefix, "SERVERPREF", 0),
-			lease->dhcp6.server_pref);
+		ni_string_printf(&buf, "%"PRIu8, lease->dhcp6.server_pref);
+		__ni_leaseinfo_put_string(vars, prefix, "SERVERPREF", buf, NULL, 0);
+		ni_string_free(&buf);
 	}
 	if (lease->dhcp6.rapid_commit) {
-		fprintf(out, "%s='%s'\n", __ni_keyword_format
-			(&key, prefix, "RAPIDCOMMIT", 0), "TRUE");
+		__ni_leaseinfo_put_string(vars, prefix, "RAPIDCOMMIT", "TRUE", NULL, 0);
 	}
 	if (lease->dhcp6.boot_url) {
-		__ni_leaseinfo_print_string(out, prefix, "BOOTFILEURL",
+		__ni_leaseinfo_put_string(vars, prefix, "BOOTFILEURL",
 					lease->dhcp6.boot_url, NULL, 0);
 	}
 	if (lease->dhcp6.boot_params.count) {
@@ -618,116 +614,153 @@ __ni_leaseinfo_dhcp6_dump(FILE *out, const ni_addrconf_lease_t *lease,
 			const char *param = lease->dhcp6.boot_params.data[i];
 			if (!param)
 				continue;
-			__ni_leaseinfo_print_string(out, prefix,
+			__ni_leaseinfo_put_string(vars, prefix,
 					"BOOTFILEPARAM", param, NULL, i);
 		}
 	}
 
 	config = ni_config_dhcp6_find_device(ifname);
-	__ni_leaseinfo_print_dhcp_opts(out, prefix, config ?
+	__ni_leaseinfo_put_dhcp_opts(vars, prefix, config ?
 			config->custom_options : NULL,
 			lease->dhcp6.options);
-
-	ni_string_free(&key);
 }
 
 static void
-__ni_leaseinfo_dump(FILE *out, const ni_addrconf_lease_t *lease,
+__ni_leaseinfo_collect(ni_var_array_t *vars, const ni_addrconf_lease_t *lease,
 		const char *ifname, const char *prefix)
 {
 	unsigned int i;
-	char *key = NULL;
 
-	__ni_leaseinfo_print_string(out, prefix, "INTERFACE", ifname, "", 0);
+	__ni_leaseinfo_put_string(vars, prefix, "INTERFACE", ifname, "", 0);
 
 	/* wicked specific vars */
 
-	__ni_leaseinfo_print_string(out, prefix, "TYPE",
+	__ni_leaseinfo_put_string(vars, prefix, "TYPE",
 				ni_addrconf_type_to_name(lease->type),
 				NULL, 0);
-	__ni_leaseinfo_print_string(out, prefix, "FAMILY",
+	__ni_leaseinfo_put_string(vars, prefix, "FAMILY",
 				ni_addrfamily_type_to_name(lease->family),
 				NULL, 0);
-	__ni_leaseinfo_print_string(out, prefix, "UUID",
+	__ni_leaseinfo_put_string(vars, prefix, "UUID",
 				ni_uuid_print(&lease->uuid), NULL, 0);
 
 	/* hostname, addrs, routes */
-	__ni_leaseinfo_print_string(out, prefix, "HOSTNAME", lease->hostname,
+	__ni_leaseinfo_put_string(vars, prefix, "HOSTNAME", lease->hostname,
 				NULL, 0);
 
-	__ni_leaseinfo_print_addrs(out, prefix, lease->addrs, lease->family);
+	__ni_leaseinfo_put_addrs(vars, prefix, lease->addrs, lease->family);
 
-	__ni_leaseinfo_print_routes(out, prefix, lease->routes, lease->family);
+	__ni_leaseinfo_put_routes(vars, prefix, lease->routes, lease->family);
 
 	/* Only applicable for ipv4. */
 	if (lease->family == AF_INET)
-		__ni_leaseinfo_print_nis(out, prefix, lease->nis);
+		__ni_leaseinfo_put_nis(vars, prefix, lease->nis);
 
 	/* DNS Servers and Domains */
-	__ni_leaseinfo_print_resolver(out, prefix, lease->resolver, ifname);
+	__ni_leaseinfo_put_resolver(vars, prefix, lease->resolver, ifname);
 
 	/* NTP Servers */
-	__ni_leaseinfo_print_string_array(out, prefix, "NTPSERVERS",
+	__ni_leaseinfo_put_string_array(vars, prefix, "NTPSERVERS",
 					&lease->ntp_servers, " ");
 
 	/* NDS Servers */
-	__ni_leaseinfo_print_string_array(out, prefix, "NDSSERVERS",
+	__ni_leaseinfo_put_string_array(vars, prefix, "NDSSERVERS",
 					&lease->nds_servers, " ");
 
 	/* NDS Context */
-	__ni_leaseinfo_print_string_array(out, prefix, "NDSCONTEXT",
+	__ni_leaseinfo_put_string_array(vars, prefix, "NDSCONTEXT",
 					&lease->nds_context, " ");
 
 	/* NDS Tree */
-	__ni_leaseinfo_print_string(out, prefix, "NDSTREE", lease->nds_tree,
+	__ni_leaseinfo_put_string(vars, prefix, "NDSTREE", lease->nds_tree,
 				NULL, 0);
 
 	/* Only applicable for ipv4. */
 	if (lease->family == AF_INET)
-		__ni_leaseinfo_print_netbios(out, prefix, lease);
+		__ni_leaseinfo_put_netbios(vars, prefix, lease);
 
 	/* Service Locator Servers */
 	for (i = 0; i < lease->slp_servers.count; ++i) {
-		__ni_leaseinfo_print_string(out, prefix, "SLPSERVERS",
+		__ni_leaseinfo_put_string(vars, prefix, "SLPSERVERS",
 					lease->slp_servers.data[i],
 					NULL, i);
 	}
 
 	/* Service Locator Scopes */
 	for (i = 0; i < lease->slp_scopes.count; ++i) {
-		__ni_leaseinfo_print_string(out, prefix, "SLPSCOPES",
+		__ni_leaseinfo_put_string(vars, prefix, "SLPSCOPES",
 					lease->slp_scopes.data[i],
 					NULL, i);
 	}
 
 	/* SIP Servers */
 	for (i = 0; i < lease->sip_servers.count; ++i) {
-		__ni_leaseinfo_print_string(out, prefix, "SIPSERVERS",
+		__ni_leaseinfo_put_string(vars, prefix, "SIPSERVERS",
 					lease->sip_servers.data[i],
 					NULL, i);
 	}
 
 	/* LPR Servers */
 	for (i = 0; i < lease->lpr_servers.count; ++i) {
-		__ni_leaseinfo_print_string(out, prefix, "LPRSERVERS",
+		__ni_leaseinfo_put_string(vars, prefix, "LPRSERVERS",
 					lease->lpr_servers.data[i],
 					NULL, i);
 	}
 
 	/* Log Servers */
 	for (i = 0; i < lease->log_servers.count; ++i) {
-		__ni_leaseinfo_print_string(out, prefix, "LOGSERVER",
+		__ni_leaseinfo_put_string(vars, prefix, "LOGSERVER",
 					lease->log_servers.data[i],
 					NULL, i);
 	}
 
-	__ni_leaseinfo_print_string(out, prefix, "POSIXTZSTRING",
+	__ni_leaseinfo_put_string(vars, prefix, "POSIXTZSTRING",
 				lease->posix_tz_string, NULL, 0);
 
-	__ni_leaseinfo_print_string(out, prefix, "POSIXTZDBNAME",
+	__ni_leaseinfo_put_string(vars, prefix, "POSIXTZDBNAME",
 				lease->posix_tz_dbname, NULL, 0);
 
-	ni_string_free(&key);
+	switch (lease->type) {
+	case NI_ADDRCONF_DHCP:
+		switch (lease->family) {
+		case AF_INET:
+			__ni_leaseinfo_dhcp4_collect(vars, lease, ifname, prefix);
+			break;
+		case AF_INET6:
+			__ni_leaseinfo_dhcp6_collect(vars, lease, ifname, prefix);
+			break;
+		default:
+			ni_error("Unsupported lease family (%u).", lease->family);
+			break;
+		}
+		break;
+
+	default:
+		/* Don't complain; if there's a lease type we don't know,
+		 * then it's probably fine if we just save the standard
+		 * information. */
+		break;
+	}
+}
+
+/*
+ * Format all collected variables in one pass into a buffer grown
+ * to the final size up front, so a dump costs one allocation
+ * instead of one per variable.
+ */
+static void
+__ni_leaseinfo_format_shell(ni_stringbuf_t *buf, const ni_var_array_t *vars)
+{
+	const ni_var_t *var;
+	size_t size = 0;
+	unsigned int i;
+
+	for (i = 0, var = vars->data; i < vars->count; ++i, ++var)
+		size += ni_string_len(var->name) + ni_string_len(var->value) + 4;
+
+	ni_stringbuf_grow(buf, size);
+	for (i = 0, var = vars->data; i < vars->count; ++i, ++var)
+		ni_stringbuf_printf(buf, "%s='%s'\n", var->name, var->value);
 }
 
 char *
@@ -748,7 +781,8 @@ void
 ni_leaseinfo_dump(FILE *out, const ni_addrconf_lease_t *lease,
 		const char *ifname, const char *prefix)
 {
-
+	ni_var_array_t vars = NI_VAR_ARRAY_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	char *filename = NULL;
 	ni_bool_t close_out_fp = TRUE; /* Used to prevent unwanted closure of
 					* things like stdout.
@@ -782,35 +816,51 @@ ni_leaseinfo_dump(FILE *out, const ni_addrconf_lease_t *lease,
 		close_out_fp = FALSE;
 	}
 
-	__ni_leaseinfo_dump(out, lease, ifname, prefix);
-
-	switch (lease->type) {
-	case NI_ADDRCONF_DHCP:
-		switch (lease->family) {
-		case AF_INET:
-			__ni_leaseinfo_dhcp4_dump(out, lease, ifname, prefix);
-			break;
-		case AF_INET6:
-			__ni_leaseinfo_dhcp6_dump(out, lease, ifname, prefix);
-			break;
-		default:
-			ni_error("Unsupported lease family (%u).", lease->family);
-			break;
-		}
-		break;
-
-	default:
-		/* Don't complain; if there's a lease type we don't know,
-		 * then it's probably fine if we just save the standard
-		 * information. */
-		break;
-	}
+	__ni_leaseinfo_collect(&vars, lease, ifname, prefix);
+	__ni_leaseinfo_format_shell(&buf, &vars);
+	if (buf.string)
+		fputs(buf.string, out);
+	ni_stringbuf_destroy(&buf);
+	ni_var_array_destroy(&vars);
 
 	if (close_out_fp)
 		fclose(out);
 	ni_string_free(&filename);
 }
 
+/*
+ * Dump the same lease info as one JSON object of strings,
+ * for tools which would otherwise parse the shell format.
+ */
+void
+ni_leaseinfo_json_dump(FILE *out, const ni_addrconf_lease_t *lease,
+		const char *ifname, const char *prefix)
+{
+	ni_var_array_t vars = NI_VAR_ARRAY_INIT;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_t *object;
+	const ni_var_t *var;
+	unsigned int i;
+
+	if (!out || !lease) {
+		ni_error("Cannot dump info from NULL lease.");
+		return;
+	}
+
+	__ni_leaseinfo_collect(&vars, lease, ifname, prefix);
+
+	object = ni_json_new_object();
+	for (i = 0, var = vars.data; i < vars.count; ++i, ++var)
+		ni_json_object_set(object, var->name, ni_json_new_string(var->value));
+
+	if (ni_json_format_string(&buf, object, NULL))
+		fprintf(out, "%s\n", buf.string);
+
+	ni_json_free(object);
+	ni_stringbuf_destroy(&buf);
+	ni_var_array_destroy(&vars);
+}
+
 void
 ni_leaseinfo_remove(const char *ifname, const ni_addrconf_mode_t type,
 		const unsigned int family)
@@ -75,6 +75,7 @@ struct ni_lldp_peer {
 	ni_lldp_peer_t *	next;
 	time_t			expires;
 	ni_lldp_t *		data;
+	uint32_t		pdu_csum;
 	unsigned int		raw_id_len;
 	unsigned char		raw_id[0];
 };
@@ -107,7 +108,7 @@ static void		ni_lldp_agent_stop(ni_netdev_t *);
 static ni_bool_t	ni_lldp_agent_send(ni_lldp_agent_t *);
 static int		ni_lldp_agent_send_shutdown(ni_lldp_agent_t *);
 static void		ni_lldp_agent_free(ni_lldp_agent_t *);
-static int		ni_lldp_agent_update(ni_lldp_agent_t *, ni_lldp_t *, const void *, unsigned int);
+static int		ni_lldp_agent_update(ni_lldp_agent_t *, ni_lldp_t *, const void *, unsigned int, uint32_t);
 static void		ni_lldp_tx_timer_arm(ni_lldp_agent_t *);
 static void		ni_lldp_tx_timer_arm_quick(ni_lldp_agent_t *);
 static void		ni_lldp_receive(ni_socket_t *);
@@ -634,8 +635,73 @@ ni_lldp_tx_timer_arm_quick(ni_lldp_agent_t *agent)
 /*
  * LLDP rx agent
  */
+static uint32_t
+ni_lldp_pdu_csum(const ni_buffer_t *bp)
+{
+	const unsigned char *data = ni_buffer_head(bp);
+	unsigned int i, count = ni_buffer_count(bp);
+	uint32_t hash = 5381;
+
+	for (i = 0; i < count; ++i)
+		hash = ((hash << 5) + hash) ^ data[i];
+	return hash;
+}
+
+/*
+ * Fast path for the common case of a known peer refreshing with an
+ * identical PDU: if the frame checksum matches what we parsed last
+ * time, just re-arm the peer's expiry without materializing anything.
+ */
+static ni_bool_t
+ni_lldp_agent_refresh_peer(ni_lldp_agent_t *agent, const void *raw_id, unsigned int raw_id_len,
+				uint32_t csum)
+{
+	ni_lldp_peer_t **pos, *peer, *found = NULL;
+	time_t now;
+
+	now = time(NULL);
+
+	/* First, expire any old entries. Note that peers are sorted by order
+	 * of increasing expiry timeout. */
+	pos = &agent->peers;
+	while ((peer = *pos) != NULL && peer->expires <= now)
+		ni_lldp_peer_unlink_and_free(pos);
+
+	while ((peer = *pos) != NULL) {
+		if (peer->raw_id_len == raw_id_len
+		 && !memcmp(peer->raw_id, raw_id, raw_id_len)) {
+			found = peer;
+			*pos = peer->next;
+			peer->next = NULL;
+			break;
+		}
+		pos = &peer->next;
+	}
+
+	if (found == NULL)
+		return FALSE;
+
+	if (!found->data || found->pdu_csum != csum || found->data->ttl == 0) {
+		/* changed PDU; put it back and take the slow path */
+		found->next = *pos;
+		*pos = found;
+		return FALSE;
+	}
+
+	/* Re-insert in order of increasing timeout */
+	found->expires = now + found->data->ttl;
+	pos = &agent->peers;
+	while ((peer = *pos) != NULL && peer->expires < found->expires)
+		pos = &peer->next;
+
+	found->next = *pos;
+	*pos = found;
+	return TRUE;
+}
+
 static int
-ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id, unsigned int raw_id_len)
+ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id, unsigned int raw_id_len,
+				uint32_t csum)
 {
 	ni_lldp_peer_t **pos, *peer, *found = NULL;
 	unsigned int npeers = 0;
@@ -657,7 +723,7 @@ ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id
 			*pos = peer->next;
 			peer->next = NULL;
 		} else {
-			*pos = peer->next;
+			pos = &peer->next;
 			npeers++;
 		}
 	}
@@ -685,11 +751,12 @@ ni_lldp_agent_update(ni_lldp_agent_t *agent, ni_lldp_t *lldp, const void *raw_id
 	/* Update/init the peer info */
 	found->expires = now + lldp->ttl;
 	found->data = lldp;
+	found->pdu_csum = csum;
 
 	/* Insert in order of increasing timeout */
 	pos = &agent->peers;
 	while ((peer = *pos) != NULL && peer->expires < found->expires)
-		*pos = peer->next;
+		pos = &peer->next;
 
 	found->next = *pos;
 	*pos = found;
@@ -736,6 +803,7 @@ ni_lldp_receive(ni_socket_t *sock)
 		ni_buffer_t raw_id_buf;
 		const void *raw_id;
 		unsigned int raw_id_len;
+		uint32_t csum;
 		ni_lldp_t *lldp;
 
 		/* Get the chassis and port ID TLVs as a raw string
@@ -744,6 +812,12 @@ ni_lldp_receive(ni_socket_t *sock)
 		if (ni_lldp_pdu_get_raw_id(&raw_id_buf, &raw_id, &raw_id_len) < 0)
 			return;
 
+		/* Most frames are identical periodic refreshes from a
+		 * known peer; those only need their expiry re-armed. */
+		csum = ni_lldp_pdu_csum(&buf);
+		if (ni_lldp_agent_refresh_peer(agent, raw_id, raw_id_len, csum))
+			return;
+
 		lldp = ni_lldp_new();
 		if (ni_lldp_pdu_parse(lldp, &buf) < 0) {
 			ni_debug_lldp("%s: failed to parse LLDP PDU", agent->dev->name);
@@ -751,7 +825,7 @@ ni_lldp_receive(ni_socket_t *sock)
 			return;
 		}
 
-		ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len);
+		ni_lldp_agent_update(agent, lldp, raw_id, raw_id_len, csum);
 	}
 
 }
@@ -19,6 +19,7 @@
 #include <wicked/logging.h>
 #include <wicked/util.h>
 #include "util_priv.h"
+#include "flight.h"
 
 #define NI_LOG_PID	(1 << 0)
 #define NI_LOG_TIME	(1 << 1)
@@ -306,6 +307,7 @@ ni_log_level_set(const char *name)
 void
 ni_log_close(void)
 {
+	ni_log_flush();
 	if (ni_log_syslog) {
 		closelog();
 	}
@@ -317,6 +319,7 @@ ni_log_close(void)
 void
 ni_log_reopen(void)
 {
+	ni_log_flush();
 	if (ni_log_syslog) {
 		closelog();
 		openlog(ni_log_ident, ni_log_opts, ni_log_syslog);
@@ -469,9 +472,11 @@ ni_log_destination(const char *progname, const char *destination)
 	return FALSE;
 }
 
-static inline void
-__ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
+static size_t
+__ni_log_stderr_prefix(char *buf, size_t size, const struct timeval *stamp)
 {
+	size_t off = 0;
+
 	/* rfc5424 / rfc3339 timestamp with ms precision, e.g.:
 	 * 	2013-11-07T19:29:38.663870+01:00
 	 */
@@ -480,7 +485,10 @@ __ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
 		struct tm lt;
 		char tzsign;
 
-		gettimeofday(&tv, NULL);
+		if (stamp)
+			tv = *stamp;
+		else
+			gettimeofday(&tv, NULL);
 		localtime_r(&tv.tv_sec, &lt);
 		if (lt.tm_gmtoff < 0) {
 			lt.tm_gmtoff *= -1;
@@ -488,26 +496,154 @@ __ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
 		} else {
 			tzsign = '+';
 		}
-		fprintf(stderr, "%04d-%02d-%02dT%02d:%02d:%02d.%06ld%c%02ld:%02ld ",
+		off += snprintf(buf + off, size - off,
+				"%04d-%02d-%02dT%02d:%02d:%02d.%06ld%c%02ld:%02ld ",
 				lt.tm_year + 1900, lt.tm_mon + 1, lt.tm_mday,
 				lt.tm_hour, lt.tm_min, lt.tm_sec, tv.tv_usec,
 				tzsign, lt.tm_gmtoff/3600, (lt.tm_gmtoff%3600)/60);
 	}
 
-	if (ni_log_opts & NI_LOG_PID) {
+	if (off < size && (ni_log_opts & NI_LOG_PID)) {
 		if (ni_log_opts & NI_LOG_IDENT)
-			fprintf(stderr, "%s[%d]: ", ni_log_ident, getpid());
+			off += snprintf(buf + off, size - off, "%s[%d]: ",
+					ni_log_ident, getpid());
 		else
-			fprintf(stderr, "[%d]: ", getpid());
-	} else if (ni_log_opts & NI_LOG_IDENT) {
-		fprintf(stderr, "%s: ", ni_log_ident);
+			off += snprintf(buf + off, size - off, "[%d]: ",
+					getpid());
+	} else if (off < size && (ni_log_opts & NI_LOG_IDENT)) {
+		off += snprintf(buf + off, size - off, "%s: ", ni_log_ident);
+	}
+
+	return off < size ? off : size - 1;
+}
+
+static inline void
+__ni_log_stderr(const char *tag, const char *fmt, va_list ap, const char *end)
+{
+	/*
+	 * Format the complete line into one fixed stack buffer and emit
+	 * it with a single write. stderr is unbuffered, so the former
+	 * fprintf sequence caused several syscalls per message and let
+	 * concurrent writers interleave their fragments.
+	 */
+	char buf[1024];
+	size_t size = sizeof(buf);
+	size_t off;
+	va_list aq;
+	int len;
+
+	off = __ni_log_stderr_prefix(buf, size, NULL);
+
+	if (off < size)
+		off += snprintf(buf + off, size - off, "%s", tag);
+
+	if (off < size) {
+		va_copy(aq, ap);
+		len = vsnprintf(buf + off, size - off, fmt, aq);
+		va_end(aq);
+
+		if (len >= 0 && (size_t)len < size - off &&
+		    (size_t)len + strlen(end) + 1 < size - off) {
+			off += len;
+			off += snprintf(buf + off, size - off, "%s\n", end);
+			fwrite(buf, 1, off, stderr);
+			return;
+		}
 	}
 
-	fprintf(stderr, "%s", tag);
+	/* overlong message; fall back to the incremental output */
+	fwrite(buf, 1, off < size ? off : size - 1, stderr);
 	vfprintf(stderr, fmt, ap);
 	fprintf(stderr, "%s\n", end);
 }
 
+/*
+ * Ring buffer sink for debug messages.
+ *
+ * Under "--debug all" a busy daemon spends a good part of each event
+ * loop pass in write/syslog syscalls. Debug messages are therefore
+ * formatted into a preallocated ring here and emitted in one batch by
+ * ni_log_flush(), which the socket loop calls after dispatching its
+ * events (and which runs at exit for one-shot clients). Messages at
+ * notice level and above are still written synchronously, but drain
+ * the ring first so the output order is preserved. When the ring
+ * overflows, further debug messages are dropped and accounted for in
+ * a warning on the next flush.
+ */
+#define NI_LOG_RING_SLOTS	256
+#define NI_LOG_RING_MSGSIZE	512
+
+struct ni_log_ring_slot {
+	struct timeval		stamp;
+	char			msg[NI_LOG_RING_MSGSIZE];
+};
+
+static struct ni_log_ring_slot *ni_log_ring;
+static unsigned int	ni_log_ring_head;	/* next slot to drain */
+static unsigned int	ni_log_ring_tail;	/* next slot to fill  */
+static unsigned int	ni_log_ring_dropped;
+
+static ni_bool_t
+__ni_log_ring_put(const char *fmt, va_list ap)
+{
+	struct ni_log_ring_slot *slot;
+	unsigned int next;
+
+	if (ni_log_ring == NULL) {
+		ni_log_ring = xcalloc(NI_LOG_RING_SLOTS, sizeof(*ni_log_ring));
+		atexit(ni_log_flush);
+	}
+
+	next = (ni_log_ring_tail + 1) % NI_LOG_RING_SLOTS;
+	if (next == ni_log_ring_head) {
+		ni_log_ring_dropped++;
+		return TRUE;	/* consumed (dropped) */
+	}
+
+	slot = &ni_log_ring[ni_log_ring_tail];
+	gettimeofday(&slot->stamp, NULL);
+	vsnprintf(slot->msg, sizeof(slot->msg), fmt, ap);
+	ni_log_ring_tail = next;
+	return TRUE;
+}
+
+void
+ni_log_flush(void)
+{
+	char buf[1024];
+	size_t off;
+
+	while (ni_log_ring_head != ni_log_ring_tail) {
+		struct ni_log_ring_slot *slot = &ni_log_ring[ni_log_ring_head];
+
+		if (ni_log_syslog) {
+			syslog(LOG_DEBUG, "%s", slot->msg);
+		} else {
+			off = __ni_log_stderr_prefix(buf, sizeof(buf), &slot->stamp);
+			off += snprintf(buf + off, sizeof(buf) - off, "::: %s\n",
+					slot->msg);
+			fwrite(buf, 1, off < sizeof(buf) ? off : sizeof(buf) - 1,
+					stderr);
+		}
+		ni_log_ring_head = (ni_log_ring_head + 1) % NI_LOG_RING_SLOTS;
+	}
+
+	if (ni_log_ring_dropped) {
+		if (ni_log_syslog) {
+			syslog(LOG_WARNING, "dropped %u debug messages (log ring overflow)",
+					ni_log_ring_dropped);
+		} else {
+			off = __ni_log_stderr_prefix(buf, sizeof(buf), NULL);
+			off += snprintf(buf + off, sizeof(buf) - off,
+					"Warning: dropped %u debug messages (log ring overflow)\n",
+					ni_log_ring_dropped);
+			fwrite(buf, 1, off < sizeof(buf) ? off : sizeof(buf) - 1,
+					stderr);
+		}
+		ni_log_ring_dropped = 0;
+	}
+}
+
 void
 ni_info(const char *fmt, ...)
 {
@@ -516,6 +652,7 @@ ni_info(const char *fmt, ...)
 	if (ni_log_level < NI_LOG_INFO)
 		return;
 
+	ni_log_flush();
 	va_start(ap, fmt);
 	if (!ni_log_syslog) {
 		__ni_log_stderr("Info: ", fmt, ap, "");
@@ -533,6 +670,7 @@ ni_note(const char *fmt, ...)
 	if (ni_log_level < NI_LOG_NOTICE)
 		return;
 
+	ni_log_flush();
 	va_start(ap, fmt);
 	if (!ni_log_syslog) {
 		__ni_log_stderr("Notice: ", fmt, ap, "");
@@ -550,6 +688,7 @@ ni_warn(const char *fmt, ...)
 	if (ni_log_level < NI_LOG_WARNING)
 		return;
 
+	ni_log_flush();
 	va_start(ap, fmt);
 	if (!ni_log_syslog) {
 		__ni_log_stderr("Warning: ", fmt, ap, "");
@@ -564,6 +703,7 @@ ni_error(const char *fmt, ...)
 {
 	va_list ap;
 
+	ni_log_flush();
 	va_start(ap, fmt);
 	if (!ni_log_syslog) {
 		__ni_log_stderr("Error: ", fmt, ap, "");
@@ -582,6 +722,7 @@ ni_error_extra(const char *fmt, ...)
 {
 	va_list ap;
 
+	ni_log_flush();
 	va_start(ap, fmt);
 	if (!ni_log_syslog) {
 		__ni_log_stderr("       ", fmt, ap, "");
@@ -600,11 +741,7 @@ ni_trace(const char *fmt, ...)
 		return;
 
 	va_start(ap, fmt);
-	if (!ni_log_syslog) {
-		__ni_log_stderr("::: ", fmt, ap, "");
-	} else {
-		vsyslog(LOG_DEBUG, fmt, ap);
-	}
+	__ni_log_ring_put(fmt, ap);
 	va_end(ap);
 }
 
@@ -613,6 +750,8 @@ ni_fatal(const char *fmt, ...)
 {
 	va_list ap;
 
+	ni_log_flush();
+	ni_flight_dump_to_path();
 	va_start(ap, fmt);
 	if (!ni_log_syslog) {
 		__ni_log_stderr("FATAL ERROR: *** ", fmt, ap, " ***");
@@ -9,6 +9,8 @@
 #include "config.h"
 #endif
 
+#include <sys/time.h>
+
 #include <wicked/util.h>
 #include <wicked/dbus-service.h>
 #include <wicked/dbus-errors.h>
@@ -37,6 +39,9 @@
 #define NI_MM_MODEM_SIMPLE_IF	"org.freedesktop.ModemManager.Modem.Simple"
 #define NI_MM_MODEM_GSM_IF	"org.freedesktop.ModemManager.Modem.Gsm"
 
+/* How long to wait for all modems to answer their property queries (seconds) */
+#define NI_MM_ENUMERATE_TIMEOUT	15
+
 typedef struct ni_modem_manager_client ni_modem_manager_client_t;
 struct ni_modem_manager_client {
 	ni_dbus_client_t *	dbus;
@@ -45,6 +50,9 @@ struct ni_modem_manager_client {
 };
 
 static void			ni_modem_manager_add_modem(ni_modem_manager_client_t *modem_manager, const char *object_path);
+static void			ni_modem_manager_modem_refreshed(ni_dbus_object_t *, ni_dbus_message_t *, void *);
+static void			ni_modem_manager_modem_info(ni_dbus_object_t *, ni_dbus_message_t *, void *);
+static void			ni_modem_manager_modem_ready(ni_dbus_object_t *);
 static void			ni_modem_manager_signal(ni_dbus_connection_t *, ni_dbus_message_t *, void *);
 static void			ni_modem_unlink(ni_modem_t *);
 
@@ -57,6 +65,7 @@ static ni_dbus_service_t	ni_objectmodel_mm_gsm_modem_service;
 
 static ni_modem_manager_client_t *ni_modem_manager_client;
 static ni_modem_manager_event_handler_fn_t *ni_modem_manager_event_handler;
+static unsigned int	ni_modem_manager_pending;
 
 static ni_intmap_t	__ni_modem_manager_error_names[] = {
 	{ "org.freedesktop.ModemManager.Modem.SerialSendfailed",	NI_ERROR_PERMISSION_DENIED },
@@ -148,6 +157,27 @@ ni_modem_manager_enumerate(ni_modem_manager_client_t *modem_manager)
 		ni_modem_manager_add_modem(modem_manager, object_path);
 	}
 
+	/* Completion barrier. The property queries for all modems are in
+	 * flight now, so their round trips overlap rather than serialize;
+	 * pump the event loop until every modem has replied (or give up
+	 * after a generous timeout). */
+	if (ni_modem_manager_pending) {
+		struct timeval now, deadline;
+
+		ni_timer_get_time(&deadline);
+		deadline.tv_sec += NI_MM_ENUMERATE_TIMEOUT;
+
+		while (ni_modem_manager_pending) {
+			ni_timer_get_time(&now);
+			if (timercmp(&now, &deadline, >)) {
+				ni_warn("%s: timed out waiting for modem property replies", __func__);
+				break;
+			}
+			if (ni_socket_wait(1000) < 0)
+				break;
+		}
+	}
+
 done:
 	ni_dbus_variant_destroy(&resp);
 	return rv;
@@ -197,32 +227,51 @@ __ni_modem_manager_object(const ni_modem_t *modem)
 }
 
 /*
- * Get modem information - manufacturer, model, version
+ * Second stage of the modem discovery. The Properties.GetAll reply has
+ * been folded into the modem object; now ask for the model information
+ * (manufacturer, model, version), again without blocking.
  */
-int
-ni_modem_manager_get_info(ni_modem_t *modem, ni_dbus_object_t *modem_object)
+static void
+ni_modem_manager_modem_refreshed(ni_dbus_object_t *modem_object, ni_dbus_message_t *reply, void *user_data)
 {
-	DBusError error = DBUS_ERROR_INIT;
-	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
-	int rv = 0;
+	if (!reply || dbus_message_get_type(reply) != DBUS_MESSAGE_TYPE_METHOD_RETURN) {
+		ni_error("cannot update properties of %s", modem_object->path);
+		if (ni_modem_manager_pending)
+			ni_modem_manager_pending--;
+		return;
+	}
 
-	if (!ni_dbus_object_call_variant(modem_object,
+	if (ni_dbus_object_call_variant_async(modem_object,
 				NI_MM_MODEM_IF, "GetInfo",
-				0, NULL, 1, &result, &error)) {
-		rv = ni_dbus_get_error(&error, NULL);
-	} else {
+				0, NULL, ni_modem_manager_modem_info, NULL) < 0) {
+		ni_error("Cannot obtain model info for modem (%s)", modem_object->path);
+		ni_modem_manager_modem_ready(modem_object);
+	}
+}
+
+static void
+ni_modem_manager_modem_info(ni_dbus_object_t *modem_object, ni_dbus_message_t *reply, void *user_data)
+{
+	ni_modem_t *modem = ni_objectmodel_unwrap_modem(modem_object, NULL);
+
+	if (reply && dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN) {
+		ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
 		const char *string;
 
-		if (ni_dbus_struct_get_string(&result, 0, &string))
-			ni_string_dup(&modem->identify.manufacturer, string);
-		if (ni_dbus_struct_get_string(&result, 1, &string))
-			ni_string_dup(&modem->identify.model, string);
-		if (ni_dbus_struct_get_string(&result, 2, &string))
-			ni_string_dup(&modem->identify.version, string);
+		if (ni_dbus_message_get_args_variants(reply, &result, 1) >= 0) {
+			if (ni_dbus_struct_get_string(&result, 0, &string))
+				ni_string_dup(&modem->identify.manufacturer, string);
+			if (ni_dbus_struct_get_string(&result, 1, &string))
+				ni_string_dup(&modem->identify.model, string);
+			if (ni_dbus_struct_get_string(&result, 2, &string))
+				ni_string_dup(&modem->identify.version, string);
+		}
+		ni_dbus_variant_destroy(&result);
+	} else {
+		ni_error("Cannot obtain model info for modem (%s)", modem_object->path);
 	}
 
-	ni_dbus_variant_destroy(&result);
-	return rv;
+	ni_modem_manager_modem_ready(modem_object);
 }
 
 /*
@@ -367,9 +416,7 @@ ni_objectmodel_mm_modem_get_class(ni_modem_type_t type)
 static void
 ni_modem_manager_add_modem(ni_modem_manager_client_t *modem_manager, const char *object_path)
 {
-	DBusError error = DBUS_ERROR_INIT;
 	ni_dbus_object_t *modem_object;
-	const ni_dbus_class_t *class;
 	ni_modem_t *modem;
 
 	ni_debug_dbus("%s(%s)", __func__, object_path);
@@ -385,15 +432,32 @@ ni_modem_manager_add_modem(ni_modem_manager_client_t *modem_manager, const char
 	}
 	ni_dbus_object_set_default_interface(modem_object, NI_MM_MODEM_IF);
 
-	/* Use Properties.GetAll() to refresh the properties of this modem */
-	if (!ni_dbus_object_refresh_properties(modem_object, &ni_objectmodel_mm_modem_service, &error)) {
-		ni_dbus_print_error(&error, "cannot update properties of %s", object_path);
-		dbus_error_free(&error);
-		return;
+	/* Use Properties.GetAll() to refresh the properties of this modem.
+	 * The call is placed asynchronously so that the queries for all
+	 * modems found in one enumeration pass are in flight concurrently;
+	 * registration completes from the reply callbacks, and the caller
+	 * waits on ni_modem_manager_pending as a completion barrier. */
+	ni_modem_manager_pending++;
+	if (ni_dbus_object_refresh_properties_async(modem_object, &ni_objectmodel_mm_modem_service,
+				ni_modem_manager_modem_refreshed, NULL) < 0) {
+		ni_error("cannot update properties of %s", object_path);
+		ni_modem_manager_pending--;
 	}
+}
+
+/*
+ * Final stage of the modem discovery - all property queries have been
+ * answered, register the modem with the object model.
+ */
+static void
+ni_modem_manager_modem_ready(ni_dbus_object_t *modem_object)
+{
+	ni_modem_t *modem = ni_objectmodel_unwrap_modem(modem_object, NULL);
+	const char *object_path = modem_object->path;
+	const ni_dbus_class_t *class;
 
-	if (ni_modem_manager_get_info(modem, modem_object) < 0)
-		ni_error("Cannot obtain model info for modem (%s)", object_path);
+	if (ni_modem_manager_pending)
+		ni_modem_manager_pending--;
 
 	/* Override the dbus class of this object */
 	if ((class = ni_objectmodel_mm_modem_get_class(modem->type)) != NULL)
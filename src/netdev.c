@@ -35,10 +35,12 @@
 #include <wicked/ipv6.h>
 #include <wicked/pci.h>
 #include <wicked/lldp.h>
+#include <wicked/linkstats.h>
 #include <wicked/fsm.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
 #include "appconfig.h"
+#include "teamd.h"
 
 /*
  * Constructor for network interface.
@@ -53,6 +55,7 @@ ni_netdev_new(const char *name, unsigned int index)
 	if (!dev)
 		return NULL;
 
+	ni_memstats_alloc(NI_MEMTAG_NETINFO, sizeof(*dev));
 	dev->users = 1;
 	dev->link.type = NI_IFTYPE_UNKNOWN;
 	dev->link.hwaddr.type = ARPHRD_VOID;
@@ -105,6 +108,8 @@ ni_netdev_free(ni_netdev_t *dev)
 	ni_netdev_ref_destroy(&dev->link.masterdev);
 	ni_netdev_slaveinfo_destroy(&dev->link.slave);
 	ni_netdev_set_link_stats(dev, NULL);
+	free(dev->link.stats_ring);
+	dev->link.stats_ring = NULL;
 
 	/* Clear out addresses, routes, ... */
 	ni_netdev_clear_addresses(dev);
@@ -139,6 +144,7 @@ ni_netdev_free(ni_netdev_t *dev)
 	ni_addrconf_lease_list_destroy(&dev->leases);
 
 	ni_string_free(&dev->name);
+	ni_memstats_free(NI_MEMTAG_NETINFO, sizeof(*dev));
 	free(dev);
 }
 
@@ -374,13 +380,20 @@ ni_netdev_set_macvlan(ni_netdev_t *dev, ni_macvlan_t *macvlan)
 }
 
 /*
- * Get the interface's bridge information
+ * Get the interface's bridge information.
+ *
+ * The refresh code marks the bridge details stale instead of reading
+ * them from sysfs on every link change; catch up on first access.
  */
 ni_bridge_t *
 ni_netdev_get_bridge(ni_netdev_t *dev)
 {
 	if (dev->link.type != NI_IFTYPE_BRIDGE)
 		return NULL;
+	if (dev->bridge_stale) {
+		dev->bridge_stale = 0;
+		__ni_discover_bridge(dev);
+	}
 	if (!dev->bridge)
 		dev->bridge = ni_bridge_new();
 	return dev->bridge;
@@ -437,13 +450,21 @@ ni_netdev_set_bonding(ni_netdev_t *dev, ni_bonding_t *bonding)
 }
 
 /*
- * Get team interface information
+ * Get team interface information.
+ *
+ * The refresh code marks the team details stale instead of querying
+ * teamd on every link change; catch up on first access.
  */
 ni_team_t *
 ni_netdev_get_team(ni_netdev_t *dev)
 {
 	if (dev->link.type != NI_IFTYPE_TEAM)
 		return NULL;
+	if (dev->team_stale) {
+		dev->team_stale = 0;
+		if (ni_config_teamd_enabled() && ni_netdev_device_is_ready(dev))
+			ni_teamd_discover(dev);
+	}
 	if (!dev->team)
 		dev->team = ni_team_new();
 	return dev->team;
@@ -589,6 +610,45 @@ ni_netdev_set_link_stats(ni_netdev_t *dev, ni_link_stats_t *stats)
 	dev->link.stats = stats;
 }
 
+/*
+ * Record a timestamped link stats sample in the interface's ring
+ */
+void
+ni_link_stats_ring_record(ni_link_stats_ring_t **ring, const ni_link_stats_t *stats)
+{
+	ni_link_stats_sample_t *sample;
+
+	if (!ring || !stats)
+		return;
+
+	if (!*ring)
+		*ring = xcalloc(1, sizeof(**ring));
+
+	sample = &(*ring)->samples[(*ring)->head];
+	ni_timer_get_time(&sample->when);
+	sample->stats = *stats;
+
+	(*ring)->head = ((*ring)->head + 1) % NI_LINK_STATS_RING_SIZE;
+	if ((*ring)->count < NI_LINK_STATS_RING_SIZE)
+		(*ring)->count++;
+}
+
+/*
+ * Return the age-th most recent sample, 0 being the latest
+ */
+const ni_link_stats_sample_t *
+ni_link_stats_ring_get(const ni_link_stats_ring_t *ring, unsigned int age)
+{
+	unsigned int slot;
+
+	if (!ring || age >= ring->count)
+		return NULL;
+
+	slot = (ring->head + NI_LINK_STATS_RING_SIZE - 1 - age)
+		% NI_LINK_STATS_RING_SIZE;
+	return &ring->samples[slot];
+}
+
 /*
  * Set the PCI device info
  */
@@ -42,16 +42,48 @@ typedef struct ni_netconfig_filter {
 	unsigned int		discover;
 } ni_netconfig_filter_t;
 
+#define NI_NETDEV_HASH_NBUCKETS	256
+
+typedef struct ni_netdev_hash_entry ni_netdev_hash_entry_t;
+struct ni_netdev_hash_entry {
+	ni_netdev_hash_entry_t *next;
+	ni_netdev_t *		dev;
+
+	/* The lookup key is cached in the entry, so walking a hash chain
+	 * does not pull the much larger ni_netdev_t of every non-matching
+	 * device into the cache. */
+	unsigned int		ifindex;
+	char *			name;
+};
+
+typedef struct ni_netdev_hash {
+	ni_netdev_hash_entry_t *by_index[NI_NETDEV_HASH_NBUCKETS];
+	ni_netdev_hash_entry_t *by_name[NI_NETDEV_HASH_NBUCKETS];
+	ni_bool_t		valid;
+} ni_netdev_hash_t;
+
 struct ni_netconfig {
 	ni_netconfig_filter_t	filter;
 
 	ni_netdev_t *		interfaces;
+	ni_netdev_hash_t	index;
 	ni_modem_t *		modems;
 
 	struct {
 		ni_rule_array_t	rules;
+		ni_route_foreign_set_t	foreign;
 	}			route;
 
+	unsigned int		generation;
+	ni_bool_t		incremental;
+	ni_bool_t		stale;
+
+	struct {
+		ni_refresh_stats_t	stats;
+		unsigned int		generation;	/* at last completed refresh */
+		struct timeval		stamp;		/* when it completed */
+	}			refresh;
+
 	unsigned char		initialized;
 };
 
@@ -519,8 +551,10 @@ ni_netconfig_init(ni_netconfig_t *nc)
 void
 ni_netconfig_destroy(ni_netconfig_t *nc)
 {
+	__ni_netconfig_index_invalidate(nc);
 	__ni_netdev_list_destroy(&nc->interfaces);
 	ni_rule_array_destroy(&nc->route.rules);
+	ni_route_foreign_set_destroy(&nc->route.foreign);
 	memset(nc, 0, sizeof(*nc));
 }
 
@@ -537,6 +571,16 @@ ni_netconfig_set_discover_filter(ni_netconfig_t *nc, unsigned int flag)
 	return FALSE;
 }
 
+ni_bool_t
+ni_netconfig_clear_discover_filter(ni_netconfig_t *nc, unsigned int flag)
+{
+	if (nc) {
+		nc->filter.discover &= ~flag;
+		return TRUE;
+	}
+	return FALSE;
+}
+
 ni_bool_t
 ni_netconfig_discover_filtered(ni_netconfig_t *nc, unsigned int flag)
 {
@@ -559,6 +603,163 @@ ni_netconfig_get_family_filter(ni_netconfig_t *nc)
 	return nc ? nc->filter.family : AF_UNSPEC;
 }
 
+/*
+ * Incremental refresh mode. When enabled, the rtnetlink event stream is
+ * considered authoritative and full re-dumps of links, addresses and
+ * routes are skipped unless the event socket reported message loss.
+ * The generation counter is bumped whenever an event or a full dump
+ * modified the state, so callers can cheaply detect changes.
+ */
+ni_bool_t
+ni_netconfig_set_incremental_refresh(ni_netconfig_t *nc, ni_bool_t enable)
+{
+	if (nc) {
+		nc->incremental = enable;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+unsigned int
+ni_netconfig_generation(const ni_netconfig_t *nc)
+{
+	return nc ? nc->generation : 0;
+}
+
+void
+__ni_netconfig_generation_bump(ni_netconfig_t *nc)
+{
+	if (nc)
+		nc->generation++;
+}
+
+void
+__ni_netconfig_mark_stale(ni_netconfig_t *nc)
+{
+	if (nc)
+		nc->stale = TRUE;
+}
+
+ni_bool_t
+__ni_netconfig_full_refresh_needed(const ni_netconfig_t *nc)
+{
+	if (!nc || !nc->incremental || !nc->initialized)
+		return TRUE;
+	return nc->stale;
+}
+
+void
+__ni_netconfig_full_refresh_done(ni_netconfig_t *nc)
+{
+	if (nc) {
+		nc->stale = FALSE;
+		nc->generation++;
+	}
+}
+
+/*
+ * Refresh cost profiling and adaptive skipping of redundant refreshes.
+ *
+ * Every completed full refresh records its duration and the resulting
+ * object counts. While the rtnetlink event listener is active, a repeated
+ * refresh request is redundant as long as no event changed the state
+ * (the generation counter did not move); within a quiet window scaled
+ * by the smoothed refresh cost, such requests reuse the current state
+ * instead of re-dumping the kernel tables. This caps the damage of
+ * refresh storms, e.g. while BGP convergence churns the route tables.
+ */
+#define NI_REFRESH_QUIET_MIN_USEC	(100 * 1000)
+#define NI_REFRESH_QUIET_MAX_USEC	(5 * 1000 * 1000)
+#define NI_REFRESH_QUIET_COST_FACTOR	16
+#define NI_REFRESH_COST_WARN_USEC	(500 * 1000)
+
+ni_bool_t
+__ni_netconfig_refresh_redundant(ni_netconfig_t *nc)
+{
+	struct timeval now, delta;
+	uint64_t window, elapsed;
+
+	if (!nc || !nc->refresh.stats.count || !ni_rtevent_listening())
+		return FALSE;
+
+	/* A netlink overrun marks the state stale without bumping the
+	 * generation; never skip the recovery refresh in that case. */
+	if (nc->stale)
+		return FALSE;
+
+	if (nc->generation != nc->refresh.generation)
+		return FALSE;
+
+	window = nc->refresh.stats.ewma_usec * NI_REFRESH_QUIET_COST_FACTOR;
+	if (window < NI_REFRESH_QUIET_MIN_USEC)
+		window = NI_REFRESH_QUIET_MIN_USEC;
+	if (window > NI_REFRESH_QUIET_MAX_USEC)
+		window = NI_REFRESH_QUIET_MAX_USEC;
+
+	ni_timer_get_time(&now);
+	if (!timercmp(&now, &nc->refresh.stamp, >))
+		return FALSE;
+	timersub(&now, &nc->refresh.stamp, &delta);
+	elapsed = delta.tv_sec * 1000000ULL + delta.tv_usec;
+	if (elapsed >= window)
+		return FALSE;
+
+	nc->refresh.stats.skipped++;
+	return TRUE;
+}
+
+void
+__ni_netconfig_refresh_profile(ni_netconfig_t *nc, const struct timeval *began)
+{
+	ni_refresh_stats_t *stats;
+	struct timeval now, delta;
+	const ni_netdev_t *dev;
+	const ni_route_table_t *tab;
+	uint64_t usec;
+
+	if (!nc)
+		return;
+	stats = &nc->refresh.stats;
+
+	ni_timer_get_time(&now);
+	if (timercmp(&now, began, >))
+		timersub(&now, began, &delta);
+	else
+		timerclear(&delta);
+	usec = delta.tv_sec * 1000000ULL + delta.tv_usec;
+
+	stats->count++;
+	stats->last_usec = usec;
+	stats->ewma_usec = stats->ewma_usec ?
+			(3 * stats->ewma_usec + usec) / 4 : usec;
+	if (usec > stats->max_usec)
+		stats->max_usec = usec;
+
+	stats->devices = 0;
+	stats->routes = 0;
+	for (dev = nc->interfaces; dev; dev = dev->next) {
+		stats->devices++;
+		for (tab = dev->routes; tab; tab = tab->next)
+			stats->routes += tab->routes.count;
+	}
+
+	nc->refresh.generation = nc->generation;
+	nc->refresh.stamp = now;
+
+	if (usec >= NI_REFRESH_COST_WARN_USEC) {
+		ni_note("full refresh took %llu.%03llu msec (%u interfaces, %u routes)",
+				(unsigned long long)usec / 1000,
+				(unsigned long long)usec % 1000,
+				stats->devices, stats->routes);
+	}
+}
+
+const ni_refresh_stats_t *
+ni_netconfig_refresh_stats(const ni_netconfig_t *nc)
+{
+	return nc ? &nc->refresh.stats : NULL;
+}
+
 /*
  * Get the list of all discovered interfaces, given a
  * netinfo handle.
@@ -575,10 +776,125 @@ ni_netconfig_device_list_head(ni_netconfig_t *nc)
 	return &nc->interfaces;
 }
 
+/*
+ * Hash index for the interface lookups by ifindex and name.
+ * The index is maintained by ni_netconfig_device_append/remove and
+ * rebuilt lazily on the first lookup after an invalidation; code which
+ * renames devices in place or splices the interface list directly must
+ * invalidate it via __ni_netconfig_index_invalidate().
+ */
+static inline unsigned int
+__ni_netdev_index_hash(unsigned int ifindex)
+{
+	return ifindex % NI_NETDEV_HASH_NBUCKETS;
+}
+
+static unsigned int
+__ni_netdev_name_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = (hash << 5) + hash + (unsigned char)*name++;
+	return hash % NI_NETDEV_HASH_NBUCKETS;
+}
+
+static ni_netdev_hash_entry_t *
+__ni_netdev_hash_chain_insert(ni_netdev_hash_entry_t **chain, ni_netdev_t *dev)
+{
+	ni_netdev_hash_entry_t *entry;
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->dev = dev;
+	entry->next = *chain;
+	*chain = entry;
+	return entry;
+}
+
+static void
+__ni_netdev_hash_chain_remove(ni_netdev_hash_entry_t **chain, const ni_netdev_t *dev)
+{
+	ni_netdev_hash_entry_t *entry;
+
+	while ((entry = *chain) != NULL) {
+		if (entry->dev == dev) {
+			*chain = entry->next;
+			ni_string_free(&entry->name);
+			free(entry);
+		} else {
+			chain = &entry->next;
+		}
+	}
+}
+
+static void
+__ni_netconfig_index_insert(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netdev_hash_entry_t *entry;
+
+	entry = __ni_netdev_hash_chain_insert(&nc->index.by_index[__ni_netdev_index_hash(dev->link.ifindex)], dev);
+	entry->ifindex = dev->link.ifindex;
+
+	entry = __ni_netdev_hash_chain_insert(&nc->index.by_name[__ni_netdev_name_hash(dev->name)], dev);
+	ni_string_dup(&entry->name, dev->name);
+}
+
+static void
+__ni_netconfig_index_remove(ni_netconfig_t *nc, const ni_netdev_t *dev)
+{
+	unsigned int i;
+
+	if (!nc->index.valid)
+		return;
+
+	__ni_netdev_hash_chain_remove(&nc->index.by_index[__ni_netdev_index_hash(dev->link.ifindex)], dev);
+
+	/* The device may have been renamed since it was indexed, so make
+	 * sure no name bucket retains a reference. */
+	for (i = 0; i < NI_NETDEV_HASH_NBUCKETS; ++i)
+		__ni_netdev_hash_chain_remove(&nc->index.by_name[i], dev);
+}
+
+void
+__ni_netconfig_index_invalidate(ni_netconfig_t *nc)
+{
+	ni_netdev_hash_entry_t *entry;
+	unsigned int i;
+
+	if (!nc)
+		return;
+
+	for (i = 0; i < NI_NETDEV_HASH_NBUCKETS; ++i) {
+		while ((entry = nc->index.by_index[i]) != NULL) {
+			nc->index.by_index[i] = entry->next;
+			free(entry);
+		}
+		while ((entry = nc->index.by_name[i]) != NULL) {
+			nc->index.by_name[i] = entry->next;
+			ni_string_free(&entry->name);
+			free(entry);
+		}
+	}
+	nc->index.valid = FALSE;
+}
+
+static void
+__ni_netconfig_index_build(ni_netconfig_t *nc)
+{
+	ni_netdev_t *dev;
+
+	__ni_netconfig_index_invalidate(nc);
+	for (dev = nc->interfaces; dev; dev = dev->next)
+		__ni_netconfig_index_insert(nc, dev);
+	nc->index.valid = TRUE;
+}
+
 void
 ni_netconfig_device_append(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
 	__ni_netdev_list_append(&nc->interfaces, dev);
+	if (nc->index.valid)
+		__ni_netconfig_index_insert(nc, dev);
 }
 
 static inline void
@@ -600,6 +916,7 @@ ni_netconfig_device_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
 	for (pos = &nc->interfaces; (cur = *pos) != NULL; pos = &cur->next) {
 		if (cur == dev) {
 			*pos = cur->next;
+			__ni_netconfig_index_remove(nc, cur);
 			ni_netconfig_device_unbind_slave_index(nc, cur->link.ifindex);
 			ni_netdev_put(cur);
 			return;
@@ -672,7 +989,7 @@ ni_netconfig_route_add(ni_netconfig_t *nc, ni_route_t *rp, ni_netdev_t *dev)
 				nh->device.index);
 			ret = -1;
 		} else {
-			ni_string_dup(&nh->device.name, dev->name);
+			ni_refstr_dup(&nh->device.name, dev->name);
 			ret = 0;
 
 			if (ni_log_level_at(NI_LOG_DEBUG2)) {
@@ -725,6 +1042,25 @@ ni_netconfig_route_del(ni_netconfig_t *nc, ni_route_t *rp, ni_netdev_t *dev)
 	return ret;
 }
 
+/*
+ * Compact summary of foreign routes (see ni_route_foreign_set_t);
+ * only maintained when compact-foreign-routes is enabled.
+ */
+ni_route_foreign_set_t *
+ni_netconfig_foreign_routes(ni_netconfig_t *nc)
+{
+	return nc ? &nc->route.foreign : NULL;
+}
+
+ni_bool_t
+ni_netconfig_foreign_route_present(ni_netconfig_t *nc, const ni_route_t *rp)
+{
+	if (!nc || !rp)
+		return FALSE;
+	return ni_route_foreign_set_test(&nc->route.foreign,
+			ni_route_dest_fingerprint(rp));
+}
+
 ni_rule_array_t *
 ni_netconfig_rule_array(ni_netconfig_t *nc)
 {
@@ -814,11 +1150,27 @@ ni_netconfig_rule_find(ni_netconfig_t *nc, const ni_rule_t *rule)
 ni_netdev_t *
 ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 {
+	ni_netdev_hash_entry_t *entry;
 	ni_netdev_t *dev;
 
+	if (!nc->index.valid)
+		__ni_netconfig_index_build(nc);
+
+	for (entry = nc->index.by_name[__ni_netdev_name_hash(name)]; entry; entry = entry->next) {
+		/* compare against the cached key first and consult the
+		 * device itself only for the likely match */
+		if (entry->name && ni_string_eq(entry->name, name)
+		 && ni_string_eq(entry->dev->name, name))
+			return entry->dev;
+	}
+
+	/* The name index can be bypassed by code renaming a device in
+	 * place; fall back to a list walk and rebuild when this happens. */
 	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->name && ni_string_eq(dev->name, name))
+		if (dev->name && ni_string_eq(dev->name, name)) {
+			__ni_netconfig_index_build(nc);
 			return dev;
+		}
 	}
 
 	return NULL;
@@ -830,11 +1182,17 @@ ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 ni_netdev_t *
 ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 {
-	ni_netdev_t *dev;
+	ni_netdev_hash_entry_t *entry;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->link.ifindex == ifindex)
-			return dev;
+	if (!nc->index.valid)
+		__ni_netconfig_index_build(nc);
+
+	for (entry = nc->index.by_index[__ni_netdev_index_hash(ifindex)]; entry; entry = entry->next) {
+		/* the ifindex of an indexed device does not change; code
+		 * assigning it in place must invalidate the index anyway,
+		 * since the device would hash to a different bucket */
+		if (entry->ifindex == ifindex)
+			return entry->dev;
 	}
 
 	return NULL;
@@ -916,7 +1274,7 @@ ni_netdev_ref_init(ni_netdev_ref_t *ref, const char *ifname, unsigned int ifinde
 {
 	if (ref) {
 		memset(ref, 0, sizeof(*ref));
-		ni_string_dup(&ref->name, ifname);
+		ni_refstr_dup(&ref->name, ifname);
 		ref->index = ifindex;
 		return TRUE;
 	}
@@ -926,7 +1284,7 @@ ni_netdev_ref_init(ni_netdev_ref_t *ref, const char *ifname, unsigned int ifinde
 ni_bool_t
 ni_netdev_ref_set(ni_netdev_ref_t *ref, const char *ifname, unsigned int ifindex)
 {
-	if (ref && ni_string_dup(&ref->name, ifname)) {
+	if (ref && ni_refstr_dup(&ref->name, ifname)) {
 		ref->index = ifindex;
 		return TRUE;
 	}
@@ -936,7 +1294,7 @@ ni_netdev_ref_set(ni_netdev_ref_t *ref, const char *ifname, unsigned int ifindex
 ni_bool_t
 ni_netdev_ref_set_ifname(ni_netdev_ref_t *ref, const char *ifname)
 {
-	return ref && ni_string_dup(&ref->name, ifname);
+	return ref && ni_refstr_dup(&ref->name, ifname);
 }
 
 ni_bool_t
@@ -979,7 +1337,7 @@ ni_netdev_ref_bind_ifname(ni_netdev_ref_t *ref, ni_netconfig_t *nc)
 		return NULL;
 
 	if (!ni_string_eq(ref->name, dev->name))
-		ni_string_dup(&ref->name, dev->name);
+		ni_refstr_dup(&ref->name, dev->name);
 	return dev;
 }
 
@@ -1004,7 +1362,7 @@ ni_netdev_ref_destroy(ni_netdev_ref_t *ref)
 {
 	if (ref) {
 		ref->index = 0;
-		ni_string_free(&ref->name);
+		ni_refstr_free(&ref->name);
 	}
 }
 
@@ -1102,6 +1460,7 @@ ni_addrconf_lease_new(int type, int family)
 
 	lease = calloc(1, sizeof(*lease));
 	if (lease) {
+		ni_memstats_alloc(NI_MEMTAG_LEASES, sizeof(*lease));
 		lease->seqno = __ni_global_seqno++;
 		lease->type = type;
 		lease->family = family;
@@ -1113,8 +1472,10 @@ ni_addrconf_lease_new(int type, int family)
 void
 ni_addrconf_lease_free(ni_addrconf_lease_t *lease)
 {
-	if (lease)
+	if (lease) {
 		ni_addrconf_lease_destroy(lease);
+		ni_memstats_free(NI_MEMTAG_LEASES, sizeof(*lease));
+	}
 	free(lease);
 }
 
@@ -9,6 +9,7 @@
 #define __NETINFO_PRIV_H__
 
 #include <stdio.h>
+#include <sys/time.h>
 
 #include <wicked/types.h>
 #include <wicked/netinfo.h>
@@ -46,6 +47,7 @@ extern void		__ni_netlink_close(ni_netlink_t *);
 
 extern void		ni_netconfig_device_append(ni_netconfig_t *, ni_netdev_t *);
 extern void		ni_netconfig_device_remove(ni_netconfig_t *, ni_netdev_t *);
+extern void		__ni_netconfig_index_invalidate(ni_netconfig_t *);
 extern ni_netdev_t **	ni_netconfig_device_list_head(ni_netconfig_t *);
 extern void		ni_netconfig_modem_append(ni_netconfig_t *, ni_modem_t *);
 extern int		ni_netconfig_route_add(ni_netconfig_t *, ni_route_t *, ni_netdev_t *);
@@ -54,12 +56,37 @@ extern int		ni_netconfig_rule_add(ni_netconfig_t *, ni_rule_t *);
 extern int		ni_netconfig_rule_del(ni_netconfig_t *, const ni_rule_t *, ni_rule_t **);
 extern ni_rule_t *	ni_netconfig_rule_find(ni_netconfig_t *, const ni_rule_t *);
 extern ni_rule_array_t *ni_netconfig_rule_array(ni_netconfig_t *);
+extern ni_route_foreign_set_t *	ni_netconfig_foreign_routes(ni_netconfig_t *);
+extern ni_bool_t	ni_netconfig_foreign_route_present(ni_netconfig_t *, const ni_route_t *);
 
 extern ni_bool_t	ni_netconfig_set_discover_filter(ni_netconfig_t *, unsigned int);
+extern ni_bool_t	ni_netconfig_clear_discover_filter(ni_netconfig_t *, unsigned int);
 extern ni_bool_t	ni_netconfig_discover_filtered(ni_netconfig_t *, unsigned int);
 extern ni_bool_t	ni_netconfig_set_family_filter(ni_netconfig_t *, unsigned int);
 extern unsigned int	ni_netconfig_get_family_filter(ni_netconfig_t *);
 
+extern ni_bool_t	ni_netconfig_set_incremental_refresh(ni_netconfig_t *, ni_bool_t);
+extern unsigned int	ni_netconfig_generation(const ni_netconfig_t *);
+extern void		__ni_netconfig_generation_bump(ni_netconfig_t *);
+extern void		__ni_netconfig_mark_stale(ni_netconfig_t *);
+extern ni_bool_t	__ni_netconfig_full_refresh_needed(const ni_netconfig_t *);
+extern void		__ni_netconfig_full_refresh_done(ni_netconfig_t *);
+
+/* Per-refresh cost profile, see __ni_netconfig_refresh_profile() */
+typedef struct ni_refresh_stats {
+	uint64_t	count;		/* completed full refreshes */
+	uint64_t	skipped;	/* requests skipped as redundant */
+	uint64_t	last_usec;	/* cost of the last refresh */
+	uint64_t	ewma_usec;	/* smoothed refresh cost */
+	uint64_t	max_usec;
+	unsigned int	devices;	/* object counts after last refresh */
+	unsigned int	routes;
+} ni_refresh_stats_t;
+
+extern const ni_refresh_stats_t *ni_netconfig_refresh_stats(const ni_netconfig_t *);
+extern ni_bool_t	__ni_netconfig_refresh_redundant(ni_netconfig_t *);
+extern void		__ni_netconfig_refresh_profile(ni_netconfig_t *, const struct timeval *);
+
 extern ni_bool_t	__ni_linkinfo_kind_to_type(const char *, ni_iftype_t *);
 
 extern void		__ni_netdev_list_append(ni_netdev_t **, ni_netdev_t *);
@@ -79,6 +106,10 @@ extern void		__ni_routes_clear(ni_netconfig_t *);
 
 extern ni_bool_t	__ni_address_list_remove(ni_address_t **, ni_address_t *);
 
+struct nlmsghdr;
+extern int		ni_rtevent_replay(ni_netconfig_t *, struct nlmsghdr *);
+extern ni_bool_t	ni_rtevent_listening(void);
+
 extern int		__ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list);
 extern int		__ni_system_refresh_interfaces(ni_netconfig_t *nc);
 extern int		__ni_system_refresh_interface(ni_netconfig_t *, ni_netdev_t *);
@@ -95,6 +126,7 @@ extern int		__ni_system_interface_stats_refresh(ni_netconfig_t *, ni_netdev_t *)
 extern int		__ni_system_interface_flush_addrs(ni_netconfig_t *, ni_netdev_t *);
 extern int		__ni_system_interface_flush_routes(ni_netconfig_t *, ni_netdev_t *);
 extern void		__ni_system_ethernet_refresh(ni_netdev_t *);
+extern int		__ni_discover_bridge(ni_netdev_t *);
 extern void		__ni_system_ethernet_update(ni_netdev_t *, ni_ethernet_t *);
 extern void		ni_system_ethtool_refresh(ni_netdev_t *);
 
@@ -147,11 +179,17 @@ typedef struct ni_capture_protinfo {
 
 	/* If ip_protocol is IPPROT_UDP or TCP */
 	uint16_t		ip_port;
+
+	/* If nonzero, also match the BOOTP/DHCP4 transaction id in the
+	 * UDP payload, so the kernel drops replies to other clients.
+	 * The value is the xid exactly as stored in the message. */
+	uint32_t		ip_xid;
 } ni_capture_protinfo_t;
 
 extern int		ni_capture_devinfo_init(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern int		ni_capture_devinfo_refresh(ni_capture_devinfo_t *, const char *, const ni_linkinfo_t *);
 extern ni_capture_t *	ni_capture_open(const ni_capture_devinfo_t *, const ni_capture_protinfo_t *, void (*)(ni_socket_t *));
+extern int		ni_capture_set_xid(ni_capture_t *, uint32_t);
 extern int		ni_capture_recv(ni_capture_t *, ni_buffer_t *, ni_sockaddr_t *, const char *);
 extern ni_bool_t	ni_capture_from_hwaddr_set(ni_hwaddr_t *, const ni_sockaddr_t *);
 extern const char *	ni_capture_from_hwaddr_print(const ni_sockaddr_t *);
@@ -160,7 +198,7 @@ extern void		ni_capture_disarm_retransmit(ni_capture_t *);
 extern void		ni_capture_force_retransmit(ni_capture_t *, unsigned int);
 extern void		ni_capture_free(ni_capture_t *);
 extern int		ni_capture_desc(const ni_capture_t *);
-extern int		ni_capture_build_udp_header(ni_buffer_t *,
+extern int		ni_capture_set_udp_header(ni_capture_t *,
 					struct in_addr src_addr, uint16_t src_port,
 					struct in_addr dst_addr, uint16_t dst_port);
 extern void		ni_capture_set_user_data(ni_capture_t *, void *);
@@ -168,6 +206,7 @@ extern void *		ni_capture_get_user_data(const ni_capture_t *);
 extern int		ni_capture_is_valid(const ni_capture_t *, int protocol);
 
 typedef struct ni_arp_socket ni_arp_socket_t;
+typedef struct ni_arp_transport ni_arp_transport_t;
 
 typedef struct ni_arp_packet {
 	unsigned int		op;
@@ -180,7 +219,8 @@ typedef struct ni_arp_packet {
 typedef void		ni_arp_callback_t(ni_arp_socket_t *, const ni_arp_packet_t *, void *);
 
 struct ni_arp_socket {
-	ni_capture_t *		capture;
+	ni_arp_socket_t *	next;		/* next session on the same interface */
+	ni_arp_transport_t *	transport;	/* shared per-interface capture socket */
 	ni_capture_devinfo_t	dev_info;
 
 	ni_arp_callback_t *	callback;
@@ -0,0 +1,195 @@
+/*
+ * Network namespace handling.
+ *
+ * One wickedd can attach to several named network namespaces (as
+ * created by "ip netns add", i.e. bind-mounted under /run/netns). Each
+ * attached namespace gets its own rtnetlink handle and ni_netconfig_t
+ * instance, while schema, config and the event loop remain shared
+ * process-global state, so managing N tenant namespaces does not cost
+ * N daemons with N schema copies.
+ *
+ * Sockets inherit the namespace they were created in, so per-ns
+ * sockets are created by briefly entering the target namespace and
+ * switching back; the descriptors stay bound to that namespace for
+ * their lifetime and poll in the shared event loop like any other.
+ *
+ * Copyright (C) 2026 SUSE LLC
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+
+#include "netns.h"
+#include "util_priv.h"
+
+#ifndef NI_NETNS_RUNDIR
+#define NI_NETNS_RUNDIR		"/run/netns"
+#endif
+#define NI_NETNS_SELF		"/proc/self/ns/net"
+
+static ni_netns_t *		ni_netns_list;
+
+/*
+ * Switch the calling thread into the given namespace, returning a
+ * descriptor of the previous namespace to switch back through, or -1
+ * on failure.
+ */
+int
+ni_netns_enter(int nsfd)
+{
+	int restorefd;
+
+	if (nsfd < 0)
+		return -1;
+
+	if ((restorefd = open(NI_NETNS_SELF, O_RDONLY | O_CLOEXEC)) < 0) {
+		ni_error("netns: unable to open %s: %m", NI_NETNS_SELF);
+		return -1;
+	}
+	if (setns(nsfd, CLONE_NEWNET) < 0) {
+		ni_error("netns: unable to enter namespace: %m");
+		close(restorefd);
+		return -1;
+	}
+	return restorefd;
+}
+
+ni_bool_t
+ni_netns_restore(int restorefd)
+{
+	if (restorefd < 0)
+		return FALSE;
+
+	/* being stuck in the wrong namespace is fatal for a daemon
+	 * managing several of them */
+	if (setns(restorefd, CLONE_NEWNET) < 0)
+		ni_fatal("netns: unable to restore namespace: %m");
+
+	close(restorefd);
+	return TRUE;
+}
+
+/*
+ * Create a socket inside the given namespace. The descriptor stays
+ * bound to that namespace after we switch back.
+ */
+int
+ni_netns_socket(ni_netns_t *ns, int domain, int type, int protocol)
+{
+	int restorefd, fd;
+
+	if (!ns || ns->fd < 0)
+		return -1;
+
+	if ((restorefd = ni_netns_enter(ns->fd)) < 0)
+		return -1;
+
+	fd = socket(domain, type, protocol);
+
+	ni_netns_restore(restorefd);
+	return fd;
+}
+
+ni_netns_t *
+ni_netns_find(const char *name)
+{
+	ni_netns_t *ns;
+
+	for (ns = ni_netns_list; ns; ns = ns->next) {
+		if (ni_string_eq(ns->name, name))
+			return ns;
+	}
+	return NULL;
+}
+
+/*
+ * Attach to a named namespace, or return the already attached handle.
+ */
+ni_netns_t *
+ni_netns_get(const char *name)
+{
+	char *path = NULL;
+	ni_netns_t *ns;
+	int restorefd;
+
+	if (ni_string_empty(name))
+		return NULL;
+
+	if ((ns = ni_netns_find(name)) != NULL)
+		return ns;
+
+	ns = xcalloc(1, sizeof(*ns));
+	ni_string_dup(&ns->name, name);
+
+	ni_string_printf(&path, "%s/%s", NI_NETNS_RUNDIR, name);
+	ns->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (ns->fd < 0) {
+		ni_error("netns: unable to open namespace %s: %m", path);
+		goto failed;
+	}
+
+	/* the rtnetlink socket has to be created inside the namespace
+	 * it is to talk to */
+	if ((restorefd = ni_netns_enter(ns->fd)) < 0)
+		goto failed;
+	ns->netlink = __ni_netlink_open(0);
+	ni_netns_restore(restorefd);
+	if (ns->netlink == NULL)
+		goto failed;
+
+	ns->netconfig = ni_netconfig_new();
+
+	ns->next = ni_netns_list;
+	ni_netns_list = ns;
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
+			"netns: attached to namespace %s", name);
+	ni_string_free(&path);
+	return ns;
+
+failed:
+	ni_string_free(&path);
+	ni_netns_release(ns);
+	return NULL;
+}
+
+void
+ni_netns_release(ni_netns_t *ns)
+{
+	ni_netns_t **pos, *cur;
+
+	if (!ns)
+		return;
+
+	for (pos = &ni_netns_list; (cur = *pos) != NULL; pos = &cur->next) {
+		if (cur == ns) {
+			*pos = ns->next;
+			break;
+		}
+	}
+
+	if (ns->netconfig)
+		ni_netconfig_free(ns->netconfig);
+	if (ns->netlink)
+		__ni_netlink_close(ns->netlink);
+	if (ns->fd >= 0)
+		close(ns->fd);
+	ni_string_free(&ns->name);
+	free(ns);
+}
+
+void
+ni_netns_release_all(void)
+{
+	while (ni_netns_list)
+		ni_netns_release(ni_netns_list);
+}
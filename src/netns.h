@@ -0,0 +1,35 @@
+/*
+ * Network namespace handling: attach to named namespaces and keep a
+ * per-namespace networking state besides the default one, sharing the
+ * process-global schema and config.
+ *
+ * Copyright (C) 2026 SUSE LLC
+ */
+
+#ifndef __WICKED_NETNS_H__
+#define __WICKED_NETNS_H__
+
+#include <wicked/types.h>
+#include "netinfo_priv.h"
+
+typedef struct ni_netns	ni_netns_t;
+struct ni_netns {
+	ni_netns_t *		next;
+
+	char *			name;
+	int			fd;		/* netns handle		*/
+
+	ni_netlink_t *		netlink;	/* rtnetlink bound to ns */
+	ni_netconfig_t *	netconfig;	/* per-ns device state	 */
+};
+
+extern ni_netns_t *	ni_netns_get(const char *);
+extern ni_netns_t *	ni_netns_find(const char *);
+extern void		ni_netns_release(ni_netns_t *);
+extern void		ni_netns_release_all(void);
+
+extern int		ni_netns_enter(int);
+extern ni_bool_t	ni_netns_restore(int);
+extern int		ni_netns_socket(ni_netns_t *, int, int, int);
+
+#endif /* __WICKED_NETNS_H__ */
@@ -0,0 +1,131 @@
+/*
+ * Capture and replay of the raw rtnetlink stream seen by wickedd.
+ *
+ * When WICKED_NETLINK_CAPTURE names a file, every rtnetlink event
+ * message and every message delivered by a refresh dump is appended
+ * to it, length-prefixed and timestamped. A recorded stream can later
+ * be replayed offline through the regular event handlers (see the
+ * nl-replay harness in testing/), so refresh and event processing can
+ * be profiled against production-shaped topologies on a development
+ * machine. Capture is off unless the environment variable is set and
+ * costs a single writev() per message when on.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/uio.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include "nlcapture.h"
+#include "util_priv.h"
+
+static int			ni_nlcapture_fd = -2;	/* -2 unprobed, -1 off */
+
+static uint64_t
+__ni_nlcapture_stamp(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void
+ni_nlcapture_record(ni_nlcapture_kind_t kind, const struct nlmsghdr *h)
+{
+	ni_nlcapture_header_t hdr;
+	struct iovec iov[2];
+
+	if (ni_nlcapture_fd == -2) {
+		const char *path = getenv("WICKED_NETLINK_CAPTURE");
+
+		if (ni_string_empty(path)) {
+			ni_nlcapture_fd = -1;
+		} else
+		if ((ni_nlcapture_fd = open(path,
+				O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0600)) < 0) {
+			ni_error("cannot open netlink capture file %s: %m", path);
+			ni_nlcapture_fd = -1;
+		} else {
+			ni_note("recording netlink stream to %s", path);
+		}
+	}
+	if (ni_nlcapture_fd < 0 || h == NULL)
+		return;
+
+	hdr.magic = NI_NLCAPTURE_MAGIC;
+	hdr.kind = kind;
+	hdr.stamp_usec = __ni_nlcapture_stamp();
+	hdr.len = h->nlmsg_len;
+
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = (void *) h;
+	iov[1].iov_len = h->nlmsg_len;
+	if (writev(ni_nlcapture_fd, iov, 2) < 0) {
+		ni_error("writing netlink capture failed (%m), disabling capture");
+		close(ni_nlcapture_fd);
+		ni_nlcapture_fd = -1;
+	}
+}
+
+/*
+ * Replay a capture file through the given handler. A speedup of 0
+ * replays as fast as possible; otherwise the recorded inter-message
+ * gaps are reproduced divided by the speedup factor (1 = realtime).
+ * Stops early when the handler returns a negative value.
+ */
+int
+ni_nlcapture_replay(const char *path, ni_nlcapture_replay_fn_t *handler,
+		void *user_data, unsigned int speedup)
+{
+	ni_nlcapture_header_t hdr;
+	struct nlmsghdr *h = NULL;
+	size_t size = 0;
+	uint64_t prev = 0;
+	FILE *fp;
+	int rv = 0;
+
+	if (!(fp = fopen(path, "re"))) {
+		ni_error("cannot open netlink capture file %s: %m", path);
+		return -1;
+	}
+
+	while (fread(&hdr, sizeof(hdr), 1, fp) == 1) {
+		if (hdr.magic != NI_NLCAPTURE_MAGIC || hdr.len < sizeof(*h)) {
+			ni_error("%s: corrupt capture record", path);
+			rv = -1;
+			break;
+		}
+		if (hdr.len > size) {
+			h = xrealloc(h, hdr.len);
+			size = hdr.len;
+		}
+		if (fread(h, 1, hdr.len, fp) != hdr.len) {
+			ni_error("%s: truncated capture record", path);
+			rv = -1;
+			break;
+		}
+
+		if (speedup && prev && hdr.stamp_usec > prev)
+			usleep((hdr.stamp_usec - prev) / speedup);
+		prev = hdr.stamp_usec;
+
+		if ((rv = handler(&hdr, h, user_data)) < 0)
+			break;
+	}
+
+	free(h);
+	fclose(fp);
+	return rv;
+}
@@ -0,0 +1,34 @@
+/*
+ * Capture and replay of the raw rtnetlink stream seen by wickedd.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+
+#ifndef __WICKED_NLCAPTURE_H__
+#define __WICKED_NLCAPTURE_H__
+
+#include <stdint.h>
+#include <linux/netlink.h>
+
+#define NI_NLCAPTURE_MAGIC	0x574e4c43	/* "WNLC" */
+
+typedef enum {
+	NI_NLCAPTURE_EVENT = 0,		/* async rtnetlink event message */
+	NI_NLCAPTURE_DUMP,		/* message from a refresh dump */
+} ni_nlcapture_kind_t;
+
+typedef struct ni_nlcapture_header {
+	uint32_t	magic;
+	uint32_t	kind;
+	uint64_t	stamp_usec;	/* monotonic capture time */
+	uint32_t	len;		/* nlmsg bytes following */
+} ni_nlcapture_header_t;
+
+typedef int		ni_nlcapture_replay_fn_t(const ni_nlcapture_header_t *,
+					struct nlmsghdr *, void *);
+
+extern void		ni_nlcapture_record(ni_nlcapture_kind_t, const struct nlmsghdr *);
+extern int		ni_nlcapture_replay(const char *, ni_nlcapture_replay_fn_t *,
+					void *, unsigned int);
+
+#endif /* __WICKED_NLCAPTURE_H__ */
@@ -663,6 +663,130 @@ failure:
 	return rv;
 }
 
+/*
+ * Process one output line of the batched bridge query below; the
+ * first two lines belong to br-to-parent and br-to-vlan, the rest
+ * are the list-ports port names.
+ */
+static int
+__ni_ovs_vsctl_bridge_query_line(const char *brname, ni_ovs_bridge_t *ovsbr,
+				unsigned int lineno, char *line)
+{
+	unsigned int value;
+
+	if (!line)
+		return 0;
+
+	line[strcspn(line, "\n\r")] = '\0';
+	switch (lineno) {
+	case 0:
+		if (!ni_string_eq(brname, line))
+			ni_refstr_dup(&ovsbr->config.vlan.parent.name, line);
+		break;
+	case 1:
+		if (ni_parse_uint(line, &value, 10) < 0) {
+			ni_error("%s: unable to parse bridge vlan id '%s'", brname, line);
+			return -1;
+		}
+		if (value >= 0x0fff /* VLAN_VID_MASK */) {
+			ni_error("%s: bridge vlan id %u not in range 1..%u",
+					brname, value, 0x0fff);
+			return -1;
+		}
+		ovsbr->config.vlan.tag = value;
+		break;
+	default:
+		ni_ovs_bridge_port_array_add_new(&ovsbr->ports, line);
+		break;
+	}
+	return 0;
+}
+
+int /* process run codes (for now) */
+ni_ovs_vsctl_bridge_query(const char *brname, ni_ovs_bridge_t *ovsbr)
+{
+	ni_stringbuf_t line = NI_STRINGBUF_INIT_DYNAMIC;
+	const char *ovs_vsctl;
+	ni_shellcmd_t *cmd;
+	ni_process_t *pi;
+	ni_buffer_t buf;
+	unsigned int lineno = 0;
+	int rv = NI_PROCESS_FAILURE;
+	int cc;
+
+	if (ni_string_empty(brname) || !ovsbr)
+		return rv;
+
+	if (!(ovs_vsctl = ni_ovs_vsctl_tool_path()))
+		return rv;
+
+	if (!(cmd = ni_shellcmd_new(NULL)))
+		return rv;
+
+	ni_buffer_init_dynamic(&buf, 256);
+
+	/* batch the per-bridge queries into one ovs-vsctl run */
+	if (!ni_shellcmd_add_arg(cmd, ovs_vsctl))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, "br-to-parent"))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, brname))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, "--"))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, "br-to-vlan"))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, brname))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, "--"))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, "list-ports"))
+		goto failure;
+
+	if (!ni_shellcmd_add_arg(cmd, brname))
+		goto failure;
+
+	if (!(pi = ni_process_new(cmd)))
+		goto failure;
+
+	rv = ni_process_run_and_capture_output(pi, &buf);
+	ni_process_free(pi);
+	if (rv) {
+		ni_error("%s: unable to query ovs bridge", brname);
+		goto failure;
+	}
+
+	while ((cc = ni_buffer_getc(&buf)) != EOF) {
+		if (cc == '\n') {
+			if (__ni_ovs_vsctl_bridge_query_line(brname, ovsbr,
+						lineno++, line.string) < 0) {
+				rv = NI_PROCESS_FAILURE;
+				goto cleanup;
+			}
+			ni_stringbuf_destroy(&line);
+		} else {
+			ni_stringbuf_putc(&line, cc);
+		}
+	}
+	if (__ni_ovs_vsctl_bridge_query_line(brname, ovsbr, lineno, line.string) < 0)
+		rv = NI_PROCESS_FAILURE;
+
+cleanup:
+	ni_stringbuf_destroy(&line);
+failure:
+	if (cmd)
+		ni_shellcmd_release(cmd);
+	ni_buffer_destroy(&buf);
+	return rv;
+}
+
 int
 ni_ovs_bridge_discover(ni_netdev_t *dev, ni_netconfig_t *nc)
 {
@@ -673,9 +797,7 @@ ni_ovs_bridge_discover(ni_netdev_t *dev, ni_netconfig_t *nc)
 		return -1;
 
 	ovsbr = ni_ovs_bridge_new();
-	if (ni_ovs_vsctl_bridge_to_parent(dev->name, &ovsbr->config.vlan.parent.name) ||
-	    ni_ovs_vsctl_bridge_to_vlan(dev->name, &ovsbr->config.vlan.tag) ||
-	    ni_ovs_vsctl_bridge_ports(dev->name, &ovsbr->ports)) {
+	if (ni_ovs_vsctl_bridge_query(dev->name, ovsbr)) {
 		ni_ovs_bridge_free(ovsbr);
 		return -1;
 	}
@@ -33,6 +33,7 @@ extern int	ni_ovs_vsctl_bridge_exists(const char *);
 extern int	ni_ovs_vsctl_bridge_to_vlan(const char *, uint16_t *);
 extern int	ni_ovs_vsctl_bridge_to_parent(const char *, char **);
 extern int	ni_ovs_vsctl_bridge_ports(const char *, ni_ovs_bridge_port_array_t *);
+extern int	ni_ovs_vsctl_bridge_query(const char *, ni_ovs_bridge_t *);
 
 extern int	ni_ovs_vsctl_bridge_port_add(const char *, const ni_ovs_bridge_port_config_t *,
 							ni_bool_t);
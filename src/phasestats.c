@@ -0,0 +1,77 @@
+/*
+ * Ifup phase duration accounting.
+ *
+ * While the event loop statistics in evstats.c measure how long single
+ * callbacks block the loop, the histograms here measure how long the
+ * logical phases of bringing up an interface take end to end: creating
+ * the device, waiting for the link, acquiring a lease, and running the
+ * lease updater. The FSM and the addrconf paths feed durations in here;
+ * the result is exported through the getRuntimeStats endpoint and can
+ * be reset via resetRuntimeStats, so an external scraper can compute
+ * per-interval distributions.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "phasestats.h"
+#include "trace.h"
+
+static ni_evstat_hist_t		ni_phase_hists[__NI_PHASE_MAX];
+
+static const char *		ni_phase_type_names[__NI_PHASE_MAX] = {
+	[NI_PHASE_DEVICE_CREATE]	= "device-create",
+	[NI_PHASE_LINK_UP_WAIT]		= "link-up-wait",
+	[NI_PHASE_ADDRCONF_ACQUIRE]	= "addrconf-acquire",
+	[NI_PHASE_UPDATER_RUN]		= "updater-run",
+};
+
+void
+ni_phasestats_record(ni_phase_type_t type, uint64_t usec)
+{
+	ni_evstat_hist_t *hist;
+	unsigned int bucket;
+
+	if (type >= __NI_PHASE_MAX)
+		return;
+
+	ni_tracepoint2(phase_duration, type, usec);
+
+	hist = &ni_phase_hists[type];
+	hist->count++;
+	hist->total_usec += usec;
+	if (usec > hist->max_usec)
+		hist->max_usec = usec;
+
+	for (bucket = 0; bucket + 1 < NI_EVSTAT_BUCKETS; ++bucket) {
+		if (usec < (1ULL << bucket))
+			break;
+	}
+	hist->bucket[bucket]++;
+}
+
+const ni_evstat_hist_t *
+ni_phasestats_get(ni_phase_type_t type)
+{
+	if (type >= __NI_PHASE_MAX)
+		return NULL;
+	return &ni_phase_hists[type];
+}
+
+void
+ni_phasestats_reset(void)
+{
+	memset(ni_phase_hists, 0, sizeof(ni_phase_hists));
+}
+
+const char *
+ni_phase_type_name(ni_phase_type_t type)
+{
+	if (type >= __NI_PHASE_MAX)
+		return NULL;
+	return ni_phase_type_names[type];
+}
@@ -0,0 +1,28 @@
+/*
+ * Ifup phase duration accounting.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+
+#ifndef __WICKED_PHASESTATS_H__
+#define __WICKED_PHASESTATS_H__
+
+#include <stdint.h>
+
+#include "evstats.h"
+
+typedef enum {
+	NI_PHASE_DEVICE_CREATE = 0,
+	NI_PHASE_LINK_UP_WAIT,
+	NI_PHASE_ADDRCONF_ACQUIRE,
+	NI_PHASE_UPDATER_RUN,
+
+	__NI_PHASE_MAX
+} ni_phase_type_t;
+
+extern void			ni_phasestats_record(ni_phase_type_t, uint64_t);
+extern const ni_evstat_hist_t *	ni_phasestats_get(ni_phase_type_t);
+extern void			ni_phasestats_reset(void);
+extern const char *		ni_phase_type_name(ni_phase_type_t);
+
+#endif /* __WICKED_PHASESTATS_H__ */
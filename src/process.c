@@ -14,16 +14,43 @@
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
+#include <sys/signalfd.h>
+
+#ifdef HAVE_POSIX_SPAWN
+#include <spawn.h>
+#endif
 
 #include <wicked/logging.h>
 #include <wicked/socket.h>
 #include "socket_priv.h"
 #include "process.h"
+#include "stats.h"
+
+/*
+ * posix_spawn(3) starts the child via CLONE_VM|CLONE_VFORK on Linux and
+ * thus avoids duplicating the page tables of a daemon with a large
+ * address space for the few microseconds up to execve().  Only usable
+ * when the chdir and closefrom file actions exist, so the child setup
+ * stays identical to the classic fork path below.
+ */
+#if defined(HAVE_POSIX_SPAWN) && \
+    HAVE_DECL_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP && \
+    HAVE_DECL_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+#define NI_USE_POSIX_SPAWN	1
+#endif
 
 static int				__ni_process_run(ni_process_t *, int *);
 static int				__ni_process_run_info(ni_process_t *);
 static ni_socket_t *			__ni_process_get_output(ni_process_t *, int);
+static ni_bool_t			__ni_process_sigchld_open(void);
+static void				__ni_process_track(ni_process_t *);
+static void				__ni_process_untrack(ni_process_t *);
 static const ni_string_array_t *	__ni_default_environment(void);
+static void				__ni_process_worker_forget(ni_process_worker_t *,
+						ni_process_t *);
+
+static ni_process_t *			__ni_process_running;
+static ni_socket_t *			__ni_process_sigchld_sock;
 
 static inline ni_bool_t
 __ni_shellcmd_parse(ni_string_array_t *argv, const char *command)
@@ -197,6 +224,13 @@ ni_process_new(ni_shellcmd_t *proc)
 void
 ni_process_free(ni_process_t *pi)
 {
+	__ni_process_untrack(pi);
+
+	if (pi->worker) {
+		/* A persistent worker executes this instance; the request
+		 * slot stays queued until the worker reports it done. */
+		__ni_process_worker_forget(pi->worker, pi);
+	} else
 	if (ni_process_running(pi)) {
 		if (kill(pi->pid, SIGKILL) < 0)
 			ni_info("Unable to kill process %d (%s): %m",
@@ -338,12 +372,27 @@ ni_process_tempstate(ni_process_t *process)
 }
 
 /*
- * Catch sigchild
+ * Track running asynchronous process instances for the signalfd reaper.
  */
 static void
-ni_process_sigchild(int sig)
+__ni_process_track(ni_process_t *pi)
 {
-	/* nop for now */
+	pi->next = __ni_process_running;
+	__ni_process_running = pi;
+}
+
+static void
+__ni_process_untrack(ni_process_t *pi)
+{
+	ni_process_t **pos, *cur;
+
+	for (pos = &__ni_process_running; (cur = *pos) != NULL; pos = &cur->next) {
+		if (cur == pi) {
+			*pos = pi->next;
+			pi->next = NULL;
+			return;
+		}
+	}
 }
 
 /*
@@ -354,6 +403,14 @@ ni_process_run(ni_process_t *pi)
 {
 	int pfd[2], rv;
 
+	ni_stats_inc(NI_STAT_EXTENSION_SPAWNS);
+
+	/* Prefer the persistent worker when one is configured for this
+	 * command; fall back to a one-shot spawn when it can't take it. */
+	if (pi->process && pi->process->worker &&
+	    ni_process_worker_run(pi->process->worker, pi) == NI_PROCESS_SUCCESS)
+		return NI_PROCESS_SUCCESS;
+
 	/* Our code in socket.c is only able to deal with sockets for now; */
 	if (socketpair(AF_UNIX, SOCK_STREAM, 0, pfd) < 0) {
 		ni_error("%s: unable to create pipe: %m", __func__);
@@ -366,6 +423,7 @@ ni_process_run(ni_process_t *pi)
 		 * subprocess. */
 		pi->socket = __ni_process_get_output(pi, pfd[0]);
 		ni_socket_activate(pi->socket);
+		__ni_process_track(pi);
 		close(pfd[1]);
 	} else  {
 		if (pfd[0] >= 0)
@@ -493,6 +551,50 @@ ni_process_run_and_capture_output(ni_process_t *pi, ni_buffer_t *out_buffer)
 	return __ni_process_run_info(pi);
 }
 
+#ifdef NI_USE_POSIX_SPAWN
+static int
+__ni_process_posix_spawn(ni_process_t *pi, int *pfd)
+{
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	const char *arg0 = pi->argv.data[0];
+	sigset_t mask;
+	pid_t pid;
+	int rv;
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addchdir_np(&actions, "/");
+	posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+	if (pfd) {
+		posix_spawn_file_actions_adddup2(&actions, pfd[1], 1);
+		posix_spawn_file_actions_adddup2(&actions, pfd[1], 2);
+	}
+	posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+
+	/* do not leak our blocked SIGCHLD into the child */
+	posix_spawnattr_init(&attr);
+	sigemptyset(&mask);
+	posix_spawnattr_setsigmask(&attr, &mask);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+	/* argv and environ are kept NULL terminated for us by
+	 * __ni_string_array_realloc */
+	rv = posix_spawn(&pid, arg0, &actions, &attr,
+			pi->argv.data, pi->environ.data);
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (rv != 0) {
+		errno = rv;
+		ni_error("%s: unable to posix_spawn %s: %m", __func__, arg0);
+		return NI_PROCESS_FAILURE;
+	}
+
+	pi->pid = pid;
+	return NI_PROCESS_SUCCESS;
+}
+#endif
+
 int
 __ni_process_run(ni_process_t *pi, int *pfd)
 {
@@ -509,7 +611,18 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 		return NI_PROCESS_COMMAND;
 	}
 
-	signal(SIGCHLD, ni_process_sigchild);
+	__ni_process_sigchld_open();
+
+#ifdef NI_USE_POSIX_SPAWN
+	/* The in-process exec hook cannot be expressed as spawn file
+	 * actions; spawn failures fall back to the classic fork path. */
+	if (pi->exec == NULL &&
+	    __ni_process_posix_spawn(pi, pfd) == NI_PROCESS_SUCCESS) {
+		pi->status = -1;
+		ni_timer_get_time(&pi->started);
+		return NI_PROCESS_SUCCESS;
+	}
+#endif
 
 	if ((pid = fork()) < 0) {
 		ni_error("%s: unable to fork child process: %m", __func__);
@@ -520,9 +633,15 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 	ni_timer_get_time(&pi->started);
 
 	if (pid == 0) {
+		sigset_t mask;
 		int maxfd;
 		int fd;
 
+		/* do not leak our blocked SIGCHLD into the child */
+		sigemptyset(&mask);
+		sigaddset(&mask, SIGCHLD);
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+
 		if (chdir("/") < 0)
 			ni_warn("%s: unable to chdir to /: %m", __func__);
 
@@ -568,31 +687,31 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 static int
 ni_process_reap(ni_process_t *pi)
 {
-	int rv;
-
-	if (pi->status != -1) {
-		ni_error("%s: child already reaped", __func__);
-		return NI_PROCESS_SUCCESS;
-	}
-
-	rv = waitpid(pi->pid, &pi->status, WNOHANG);
-	if (rv == 0) {
-		/* This is an ugly workaround. Sometimes, we seem to get a hangup on the socket even
-		 * though the script (provably) still has its end of the socket pair open for writing. */
-		ni_error("%s: process %u has not exited yet; now doing a blocking waitpid()",
-				__func__, pi->pid);
-		rv = waitpid(pi->pid, &pi->status, 0);
-	}
+	int rv = NI_PROCESS_SUCCESS;
+
+	if (pi->status == -1) {
+		rv = waitpid(pi->pid, &pi->status, WNOHANG);
+		if (rv == 0) {
+			/* This is an ugly workaround. Sometimes, we seem to get a hangup on the socket even
+			 * though the script (provably) still has its end of the socket pair open for writing. */
+			ni_error("%s: process %u has not exited yet; now doing a blocking waitpid()",
+					__func__, pi->pid);
+			rv = waitpid(pi->pid, &pi->status, 0);
+		}
 
-	if (rv < 0) {
-		ni_error("%s: waitpid returned error (%m)", __func__);
-		rv = NI_PROCESS_WAITPID;
+		if (rv < 0) {
+			ni_error("%s: waitpid returned error (%m)", __func__);
+			rv = NI_PROCESS_WAITPID;
+		} else {
+			rv = NI_PROCESS_SUCCESS;
+		}
 	}
+	__ni_process_untrack(pi);
 
 	if (pi->notify_callback)
 		pi->notify_callback(pi);
 
-	if (rv == NI_PROCESS_WAITPID)
+	if (rv != NI_PROCESS_SUCCESS)
 		return rv;
 
 	__ni_process_run_info(pi);
@@ -634,6 +753,17 @@ __ni_process_output_hangup(ni_socket_t *sock)
 	ni_process_t *pi = sock->user_data;
 
 	if (pi && pi->socket == sock) {
+		if (pi->status == -1 && __ni_process_sigchld_sock != NULL &&
+		    waitpid(pi->pid, &pi->status, WNOHANG) == 0) {
+			/* The child still holds its end of the socket pair
+			 * open without having exited; instead of blocking
+			 * the event loop in waitpid(), hand the instance
+			 * over to the signalfd reaper. */
+			sock->user_data = NULL;
+			ni_socket_close(sock);
+			pi->socket = NULL;
+			return;
+		}
 		if (ni_process_reap(pi) < 0)
 			ni_error("pipe closed by child process, but child did not exit");
 		ni_socket_close(pi->socket);
@@ -663,10 +793,485 @@ __ni_process_get_output(ni_process_t *pi, int fd)
 	return sock;
 }
 
+/*
+ * Persistent worker processes.
+ *
+ * A worker is a long-lived helper executing extension commands on our
+ * behalf, so that busy paths (addrconf updates during boot) don't pay
+ * a fork/exec per script invocation.  Workers are shared by command
+ * string and receive one request per invocation on stdin:
+ *
+ *	RUN <id>
+ *	ARG <argument>		one line per command line argument
+ *	ENV <name>=<value>	one line per environment variable
+ *	END
+ *
+ * and report every finished invocation on stdout as:
+ *
+ *	DONE <id> <exit-status>
+ *
+ * A worker executes up to max-pending requests concurrently; when it
+ * is busy, cannot be (re)started or the request does not fit the line
+ * protocol, the caller falls back to a one-shot fork/exec.
+ */
+#define NI_PROCESS_WORKER_MAX_PENDING	1	/* default concurrency	*/
+#define NI_PROCESS_WORKER_RETRY_SEC	10	/* restart back off	*/
+
+typedef struct ni_process_worker_req	ni_process_worker_req_t;
+
+struct ni_process_worker_req {
+	ni_process_worker_req_t *next;
+	unsigned int		id;
+	ni_process_t *		process;	/* NULL once abandoned	*/
+};
+
+struct ni_process_worker {
+	ni_process_worker_t *	next;
+	char *			command;
+	unsigned int		max_pending;
+
+	pid_t			pid;
+	int			status;		/* stashed by the reaper */
+	ni_socket_t *		socket;
+	struct timeval		failed;		/* last (re)start failure */
+
+	unsigned int		sequence;
+	unsigned int		npending;
+	ni_process_worker_req_t *pending;
+};
+
+static ni_process_worker_t *	__ni_process_workers;
+
+/*
+ * Find or create the worker serving the given helper command.
+ * The worker itself is started lazily on first use.
+ */
+ni_process_worker_t *
+ni_process_worker_get(const char *command, unsigned int max_pending)
+{
+	ni_process_worker_t *worker, **pos;
+
+	if (ni_string_empty(command))
+		return NULL;
+
+	for (pos = &__ni_process_workers; (worker = *pos); pos = &worker->next) {
+		if (ni_string_eq(worker->command, command))
+			return worker;
+	}
+
+	worker = xcalloc(1, sizeof(*worker));
+	ni_string_dup(&worker->command, command);
+	worker->max_pending = max_pending ? max_pending : NI_PROCESS_WORKER_MAX_PENDING;
+	worker->status = -1;
+	*pos = worker;
+
+	return worker;
+}
+
+static void
+__ni_process_worker_complete(ni_process_worker_t *worker, ni_process_worker_req_t *req,
+				int exit_status)
+{
+	ni_process_t *pi = req->process;
+
+	ni_assert(worker->npending);
+	worker->npending--;
+	free(req);
+
+	if (pi == NULL)		/* the caller gave up on this request */
+		return;
+
+	pi->worker = NULL;
+	/* synthesize a waitpid(2) style exit status */
+	pi->status = (exit_status & 0xff) << 8;
+	__ni_process_run_info(pi);
+
+	if (pi->notify_callback)
+		pi->notify_callback(pi);
+	ni_process_free(pi);
+}
+
+static void
+__ni_process_worker_recv(ni_socket_t *sock)
+{
+	ni_process_worker_t *worker = sock->user_data;
+	ni_buffer_t *rbuf = &sock->rbuf;
+	char *eol;
+	int cnt;
+
+	ni_assert(worker);
+
+	if (ni_buffer_tailroom(rbuf) < 256)
+		ni_buffer_ensure_tailroom(rbuf, 4096);
+
+	cnt = recv(sock->__fd, ni_buffer_tail(rbuf), ni_buffer_tailroom(rbuf), MSG_DONTWAIT);
+	if (cnt > 0) {
+		rbuf->tail += cnt;
+	} else if (cnt < 0 && errno != EWOULDBLOCK) {
+		ni_error("read error on worker pipe: %m");
+		ni_socket_deactivate(sock);
+		return;
+	}
+
+	while ((eol = memchr(ni_buffer_head(rbuf), '\n', ni_buffer_count(rbuf)))) {
+		char *line = (char *) ni_buffer_head(rbuf);
+		ni_process_worker_req_t *req, **pos;
+		unsigned int id;
+		int exit_status;
+
+		*eol = '\0';
+		if (sscanf(line, "DONE %u %d", &id, &exit_status) == 2) {
+			for (pos = &worker->pending; (req = *pos); pos = &req->next) {
+				if (req->id == id) {
+					*pos = req->next;
+					__ni_process_worker_complete(worker, req, exit_status);
+					break;
+				}
+			}
+			if (req == NULL)
+				ni_error("worker %d (%s): reply for unknown request %u",
+						worker->pid, worker->command, id);
+		} else {
+			ni_error("worker %d (%s): cannot parse reply \"%s\"",
+					worker->pid, worker->command, line);
+		}
+		ni_buffer_pull_head(rbuf, eol + 1 - line);
+	}
+}
+
+/*
+ * The worker closed its pipe, i.e. it exited or crashed. Fail whatever
+ * was in flight; the next request restarts it after a back off.
+ */
+static void
+__ni_process_worker_hangup(ni_socket_t *sock)
+{
+	ni_process_worker_t *worker = sock->user_data;
+	ni_process_worker_req_t *req;
+	int status = -1;
+
+	if (!worker || worker->socket != sock)
+		return;
+
+	if (worker->status != -1) {
+		/* the signalfd reaper collected the status already */
+		status = worker->status;
+		worker->status = -1;
+	} else if (waitpid(worker->pid, &status, WNOHANG) != worker->pid)
+		status = -1;
+
+	if (status != -1)
+		ni_debug_extension("worker process %d (%s) exited with status %d",
+				worker->pid, worker->command,
+				WIFEXITED(status) ? WEXITSTATUS(status) : NI_PROCESS_FAILURE);
+	else
+		ni_error("worker process %d (%s) closed its pipe but did not exit",
+				worker->pid, worker->command);
+
+	while ((req = worker->pending) != NULL) {
+		worker->pending = req->next;
+		__ni_process_worker_complete(worker, req, 127);
+	}
+
+	ni_socket_close(worker->socket);
+	worker->socket = NULL;
+	worker->pid = 0;
+	ni_timer_get_time(&worker->failed);
+}
+
+static int
+__ni_process_worker_start(ni_process_worker_t *worker)
+{
+	ni_string_array_t argv = NI_STRING_ARRAY_INIT;
+	int sfd[2];
+	pid_t pid;
+
+	if (ni_string_split(&argv, worker->command, " \t", 0) == 0)
+		goto failed;
+
+	if (!ni_file_executable(argv.data[0])) {
+		ni_error("Unable to start worker %s; does not exist or is not executable",
+				argv.data[0]);
+		goto failed;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sfd) < 0) {
+		ni_error("%s: unable to create worker socketpair: %m", __func__);
+		goto failed;
+	}
+
+	__ni_process_sigchld_open();
+
+	if ((pid = fork()) < 0) {
+		ni_error("%s: unable to fork worker process: %m", __func__);
+		close(sfd[0]);
+		close(sfd[1]);
+		goto failed;
+	}
+
+	if (pid == 0) {
+		ni_string_array_t environ = NI_STRING_ARRAY_INIT;
+		sigset_t mask;
+		int maxfd;
+		int fd;
+
+		/* do not leak our blocked SIGCHLD into the worker */
+		sigemptyset(&mask);
+		sigaddset(&mask, SIGCHLD);
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+
+		if (chdir("/") < 0)
+			ni_warn("%s: unable to chdir to /: %m", __func__);
+
+		/* requests on stdin, replies on stdout; stderr is inherited */
+		if (dup2(sfd[1], 0) < 0 || dup2(sfd[1], 1) < 0)
+			ni_warn("%s: cannot dup worker socket descriptor: %m", __func__);
+
+		maxfd = getdtablesize();
+		for (fd = 3; fd < maxfd; ++fd)
+			close(fd);
+
+		ni_string_array_copy(&environ, __ni_default_environment());
+		ni_string_array_append(&argv, NULL);
+		ni_string_array_append(&environ, NULL);
+
+		execve(argv.data[0], argv.data, environ.data);
+
+		ni_error("%s: cannot execute worker %s: %m", __func__, argv.data[0]);
+		exit(127);
+	}
+
+	close(sfd[1]);
+	worker->pid = pid;
+	worker->status = -1;
+	timerclear(&worker->failed);
+
+	worker->socket = ni_socket_wrap(sfd[0], SOCK_STREAM);
+	worker->socket->receive = __ni_process_worker_recv;
+	worker->socket->handle_hangup = __ni_process_worker_hangup;
+	worker->socket->user_data = worker;
+	ni_socket_activate(worker->socket);
+
+	ni_debug_extension("started worker process %d (%s)", pid, worker->command);
+	ni_string_array_destroy(&argv);
+	return NI_PROCESS_SUCCESS;
+
+failed:
+	ni_string_array_destroy(&argv);
+	ni_timer_get_time(&worker->failed);
+	return NI_PROCESS_FAILURE;
+}
+
+static int
+__ni_process_worker_send(ni_process_worker_t *worker, const char *data, size_t len)
+{
+	ssize_t cnt;
+
+	while (len) {
+		cnt = send(worker->socket->__fd, data, len, MSG_NOSIGNAL);
+		if (cnt < 0) {
+			if (errno == EINTR)
+				continue;
+			ni_error("worker process %d (%s): cannot send request: %m",
+					worker->pid, worker->command);
+			return -1;
+		}
+		data += cnt;
+		len -= cnt;
+	}
+	return 0;
+}
+
+/*
+ * Hand a process instance to the worker. On success, the worker owns
+ * the instance: it fires the notify callback and frees it once the
+ * reply arrives, as the one-shot spawn path does on child exit.
+ * A failure leaves the instance untouched so the caller can fall back
+ * to a regular fork/exec.
+ */
+int
+ni_process_worker_run(ni_process_worker_t *worker, ni_process_t *pi)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_process_worker_req_t *req, **pos;
+	unsigned int i;
+	int rv = NI_PROCESS_FAILURE;
+
+	if (!worker || !pi || pi->pid != 0 || pi->worker)
+		return NI_PROCESS_FAILURE;
+
+	if (worker->npending >= worker->max_pending)
+		return NI_PROCESS_FAILURE;
+
+	if (worker->socket == NULL) {
+		struct timeval now;
+
+		ni_timer_get_time(&now);
+		if (timerisset(&worker->failed) &&
+		    now.tv_sec - worker->failed.tv_sec < NI_PROCESS_WORKER_RETRY_SEC)
+			return NI_PROCESS_FAILURE;
+
+		if (__ni_process_worker_start(worker) < 0)
+			return NI_PROCESS_FAILURE;
+	}
+
+	ni_stringbuf_printf(&buf, "RUN %u\n", worker->sequence + 1);
+	for (i = 0; i < pi->argv.count; ++i) {
+		if (strchr(pi->argv.data[i], '\n'))
+			goto out;
+		ni_stringbuf_printf(&buf, "ARG %s\n", pi->argv.data[i]);
+	}
+	for (i = 0; i < pi->environ.count; ++i) {
+		if (strchr(pi->environ.data[i], '\n'))
+			goto out;
+		ni_stringbuf_printf(&buf, "ENV %s\n", pi->environ.data[i]);
+	}
+	ni_stringbuf_puts(&buf, "END\n");
+
+	if (__ni_process_worker_send(worker, buf.string, buf.len) < 0)
+		goto out;
+
+	req = xcalloc(1, sizeof(*req));
+	req->id = ++worker->sequence;
+	req->process = pi;
+	for (pos = &worker->pending; *pos; pos = &(*pos)->next)
+		;
+	*pos = req;
+	worker->npending++;
+
+	pi->worker = worker;
+	pi->status = -1;
+	ni_timer_get_time(&pi->started);
+
+	ni_debug_extension("dispatched request %u (%s) to worker process %d",
+			req->id, pi->process->command, worker->pid);
+	rv = NI_PROCESS_SUCCESS;
+
+out:
+	ni_stringbuf_destroy(&buf);
+	return rv;
+}
+
+/*
+ * The caller freed a process instance the worker still executes.
+ * Keep the request slot queued so the reply doesn't get out of step,
+ * but don't report to anyone.
+ */
+static void
+__ni_process_worker_forget(ni_process_worker_t *worker, ni_process_t *pi)
+{
+	ni_process_worker_req_t *req;
+
+	for (req = worker->pending; req; req = req->next) {
+		if (req->process == pi) {
+			req->process = NULL;
+			break;
+		}
+	}
+	pi->worker = NULL;
+}
+
+/*
+ * Child reaping through a signalfd.
+ *
+ * Catching SIGCHLD with a signal handler interacts poorly with the
+ * poll loop; the races between signal delivery and poll used to be
+ * papered over with poll timeouts and a blocking waitpid() fallback
+ * in the pipe hangup path. With SIGCHLD blocked and routed into a
+ * signalfd owned by the event loop, child exits become ordinary
+ * descriptor events: no handler, no EINTR churn, and the exit status
+ * is dispatched as soon as the kernel reports it.
+ *
+ * Only pids we track are reaped here, so code waiting for its own
+ * children synchronously (e.g. the reverse resolver) keeps working.
+ */
+static void
+__ni_process_exited(ni_process_t *pi, int status)
+{
+	pi->status = status;
+
+	if (pi->socket != NULL) {
+		/* dispatched from the output hangup handler, once the
+		 * remaining script output has been drained */
+		return;
+	}
+
+	/* the output pipe hung up before the child exited */
+	__ni_process_untrack(pi);
+	if (pi->notify_callback)
+		pi->notify_callback(pi);
+	__ni_process_run_info(pi);
+	ni_process_free(pi);
+}
+
+static void
+__ni_process_sigchld_receive(ni_socket_t *sock)
+{
+	struct signalfd_siginfo info;
+	ni_process_worker_t *worker;
+	ni_process_t *pi;
+	int status;
+
+	/* drain the queue; one SIGCHLD may stand for several exits */
+	while (read(sock->__fd, &info, sizeof(info)) == sizeof(info))
+		;
+
+restart:
+	for (pi = __ni_process_running; pi; pi = pi->next) {
+		if (pi->status != -1)
+			continue;
+		if (waitpid(pi->pid, &status, WNOHANG) != pi->pid)
+			continue;
+
+		/* may unlink and free the instance */
+		__ni_process_exited(pi, status);
+		goto restart;
+	}
+
+	for (worker = __ni_process_workers; worker; worker = worker->next) {
+		if (worker->pid <= 0 || worker->status != -1)
+			continue;
+		if (waitpid(worker->pid, &status, WNOHANG) == worker->pid)
+			worker->status = status;
+	}
+}
+
+static ni_bool_t
+__ni_process_sigchld_open(void)
+{
+	sigset_t mask;
+	int fd;
+
+	if (__ni_process_sigchld_sock != NULL)
+		return TRUE;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
+		ni_error("%s: unable to block SIGCHLD: %m", __func__);
+		return FALSE;
+	}
+
+	if ((fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+		ni_error("%s: unable to create SIGCHLD signalfd: %m", __func__);
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+		return FALSE;
+	}
+
+	if (!(__ni_process_sigchld_sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+		close(fd);
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+		return FALSE;
+	}
+	__ni_process_sigchld_sock->receive = __ni_process_sigchld_receive;
+	ni_socket_activate(__ni_process_sigchld_sock);
+	return TRUE;
+}
+
 ni_bool_t
 ni_process_running(const ni_process_t *pi)
 {
-	return pi && pi->pid > 0 && pi->status == -1;
+	return pi && pi->status == -1 && (pi->pid > 0 || pi->worker != NULL);
 }
 
 ni_bool_t
@@ -11,6 +11,8 @@
 #include <wicked/logging.h>
 #include <wicked/util.h>
 
+typedef struct ni_process_worker	ni_process_worker_t;
+
 struct ni_shellcmd {
 	unsigned int		refcount;
 
@@ -20,9 +22,14 @@ struct ni_shellcmd {
 	ni_string_array_t	environ;
 
 	unsigned int		timeout;
+
+	/* Optional persistent helper executing this command for us;
+	 * borrowed from the global worker list, do not free. */
+	ni_process_worker_t *	worker;
 };
 
 struct ni_process {
+	ni_process_t *		next;		/* running instances	*/
 	ni_shellcmd_t *		process;
 
 	pid_t			pid;
@@ -36,6 +43,9 @@ struct ni_process {
 	ni_socket_t *		socket;
 	ni_tempstate_t *	temp_state;
 
+	/* Set while a persistent worker executes this instance */
+	ni_process_worker_t *	worker;
+
 	void			(*notify_callback)(ni_process_t *);
 	void *			user_data;
 };
@@ -67,6 +77,9 @@ enum {
 	NI_PROCESS_UNKNOWN	= -6,	/* unknown (post fork) failure     */
 };
 
+extern ni_process_worker_t *	ni_process_worker_get(const char *, unsigned int);
+extern int			ni_process_worker_run(ni_process_worker_t *, ni_process_t *);
+
 extern ni_process_t *		ni_process_new(ni_shellcmd_t *);
 extern int			ni_process_run(ni_process_t *);
 extern int			ni_process_run_and_wait(ni_process_t *);
@@ -26,6 +26,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <netlink/netlink.h>
 #if !defined(IP6_RT_PRIO_USER) || !defined(IP6_RT_PRIO_ADDRCONF)
@@ -153,13 +154,36 @@ static const ni_intmap_t	ni_route_mxlock_bits[] = {
 
 /*
  * ni_route functions
+ *
+ * A refresh releases and reallocates route objects in bulk, one per
+ * RTM_NEWROUTE message; recycle them through a small free list to keep
+ * the refresh out of malloc/free. The freed object's memory holds the
+ * list link.
  */
+#define NI_ROUTE_CACHE_MAX	128
+
+typedef struct ni_route_cache_entry {
+	struct ni_route_cache_entry *	next;
+} ni_route_cache_entry_t;
+
+static ni_route_cache_entry_t *	__ni_route_cache;
+static unsigned int		__ni_route_cache_count;
+
 ni_route_t *
 ni_route_new(void)
 {
+	ni_route_cache_entry_t *ce;
 	ni_route_t *rp;
 
-	rp = xcalloc(1, sizeof(ni_route_t));
+	if ((ce = __ni_route_cache) != NULL) {
+		__ni_route_cache = ce->next;
+		__ni_route_cache_count--;
+		rp = (ni_route_t *) ce;
+		memset(rp, 0, sizeof(*rp));
+	} else {
+		ni_memstats_alloc(NI_MEMTAG_ROUTES, sizeof(ni_route_t));
+		rp = xcalloc(1, sizeof(ni_route_t));
+	}
 	if (rp)
 		rp->users = 1;
 	return rp;
@@ -312,7 +336,16 @@ do_route_free(ni_route_t *rp)
 	ni_route_nexthop_list_destroy(&rp->nh.next);
 	ni_route_nexthop_destroy(&rp->nh);
 
-	free(rp);
+	if (__ni_route_cache_count < NI_ROUTE_CACHE_MAX) {
+		ni_route_cache_entry_t *ce = (ni_route_cache_entry_t *) rp;
+
+		ce->next = __ni_route_cache;
+		__ni_route_cache = ce;
+		__ni_route_cache_count++;
+	} else {
+		ni_memstats_free(NI_MEMTAG_ROUTES, sizeof(*rp));
+		free(rp);
+	}
 }
 
 void
@@ -1276,10 +1309,27 @@ ni_route_via_gateway(const ni_route_t *rp)
 
 /*
  * ni_route_nexthop functions
+ *
+ * The first nexthop is embedded in ni_route_t; only ECMP routes chain
+ * additional heap-allocated hops. Recycle those nodes through a small
+ * free list like the route objects above, reusing ->next as the link.
  */
+#define NI_ROUTE_NH_CACHE_MAX	64
+
+static ni_route_nexthop_t *	__ni_route_nh_cache;
+static unsigned int		__ni_route_nh_cache_count;
+
 ni_route_nexthop_t *
 ni_route_nexthop_new(void)
 {
+	ni_route_nexthop_t *hop;
+
+	if ((hop = __ni_route_nh_cache) != NULL) {
+		__ni_route_nh_cache = hop->next;
+		__ni_route_nh_cache_count--;
+		hop->next = NULL;
+		return hop;
+	}
 	return xcalloc(1, sizeof(ni_route_nexthop_t));
 }
 
@@ -1297,7 +1347,13 @@ ni_route_nexthop_free(ni_route_nexthop_t *hop)
 {
 	if (hop) {
 		ni_route_nexthop_destroy(hop);
-		free(hop);
+		if (__ni_route_nh_cache_count < NI_ROUTE_NH_CACHE_MAX) {
+			hop->next = __ni_route_nh_cache;
+			__ni_route_nh_cache = hop;
+			__ni_route_nh_cache_count++;
+		} else {
+			free(hop);
+		}
 	}
 }
 
@@ -1310,7 +1366,7 @@ ni_route_nexthop_copy(ni_route_nexthop_t *dst, const ni_route_nexthop_t *src)
 		dst->flags   = src->flags;
 		dst->realm   = src->realm;
 		dst->device.index = src->device.index;
-		return ni_string_dup(&dst->device.name, src->device.name);
+		return ni_refstr_dup(&dst->device.name, src->device.name);
 	}
 	return FALSE;
 }
@@ -1365,7 +1421,7 @@ ni_route_nexthop_bind_ifname(ni_route_nexthop_t *nh, ni_netconfig_t *nc, ni_netd
 {
 	if (dev && nh->device.index == dev->link.ifindex) {
 		if (!ni_string_eq(nh->device.name, dev->name))
-			ni_string_dup(&nh->device.name, dev->name);
+			ni_refstr_dup(&nh->device.name, dev->name);
 	} else {
 		ni_netdev_ref_bind_ifname(&nh->device, nc);
 	}
@@ -1468,6 +1524,120 @@ ni_route_nexthop_find_by_gateway(const ni_route_nexthop_t *head, const ni_sockad
 /*
  * ni_route_array functions
  */
+/*
+ * Destination hash index for large route arrays.
+ *
+ * Route discovery and cleanup compare every kernel route against the
+ * stored table via ni_route_array_find_match(), which makes a full
+ * refresh O(n^2) on routers carrying complete tables. Once an array
+ * grows beyond NI_ROUTE_DEST_INDEX_MIN entries, we maintain a hash
+ * over (family, prefixlen, destination), so the destination-based
+ * match functions only compare routes within one bucket. Small arrays
+ * (leases, static config) stay plain to avoid the per-route overhead.
+ */
+#define NI_ROUTE_DEST_INDEX_MIN		32
+#define NI_ROUTE_DEST_NBUCKETS		256
+
+typedef struct ni_route_dest_entry	ni_route_dest_entry_t;
+struct ni_route_dest_entry {
+	ni_route_dest_entry_t *	next;
+	ni_route_t *		route;
+};
+
+struct ni_route_dest_index {
+	ni_route_dest_entry_t *	buckets[NI_ROUTE_DEST_NBUCKETS];
+};
+
+static unsigned int
+ni_route_dest_hash(const ni_route_t *rp)
+{
+	unsigned int hash = 5381;
+
+	hash = hash * 33 + rp->family;
+	hash = hash * 33 + rp->prefixlen;
+
+	/* the match functions ignore the destination of default routes */
+	if (rp->prefixlen) {
+		const unsigned char *ptr = NULL;
+		unsigned int len = 0, i;
+
+		switch (rp->destination.ss_family) {
+		case AF_INET:
+			ptr = (const unsigned char *)&rp->destination.sin.sin_addr;
+			len = sizeof(rp->destination.sin.sin_addr);
+			break;
+		case AF_INET6:
+			ptr = (const unsigned char *)&rp->destination.six.sin6_addr;
+			len = sizeof(rp->destination.six.sin6_addr);
+			break;
+		default:
+			break;
+		}
+		for (i = 0; i < len; ++i)
+			hash = hash * 33 + ptr[i];
+	}
+	return hash % NI_ROUTE_DEST_NBUCKETS;
+}
+
+static void
+ni_route_dest_index_insert(struct ni_route_dest_index *index, ni_route_t *rp)
+{
+	ni_route_dest_entry_t **chain = &index->buckets[ni_route_dest_hash(rp)];
+	ni_route_dest_entry_t *entry;
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->route = rp;
+	entry->next = *chain;
+	*chain = entry;
+}
+
+static void
+ni_route_dest_index_remove(struct ni_route_dest_index *index, const ni_route_t *rp)
+{
+	ni_route_dest_entry_t **chain = &index->buckets[ni_route_dest_hash(rp)];
+	ni_route_dest_entry_t *entry;
+
+	while ((entry = *chain) != NULL) {
+		if (entry->route == rp) {
+			*chain = entry->next;
+			free(entry);
+			return;
+		}
+		chain = &entry->next;
+	}
+}
+
+static void
+ni_route_array_index_destroy(ni_route_array_t *nra)
+{
+	ni_route_dest_entry_t *entry;
+	unsigned int i;
+
+	if (!nra->index)
+		return;
+
+	for (i = 0; i < NI_ROUTE_DEST_NBUCKETS; ++i) {
+		while ((entry = nra->index->buckets[i]) != NULL) {
+			nra->index->buckets[i] = entry->next;
+			free(entry);
+		}
+	}
+	free(nra->index);
+	nra->index = NULL;
+}
+
+static void
+ni_route_array_index_build(ni_route_array_t *nra)
+{
+	unsigned int i;
+
+	nra->index = xcalloc(1, sizeof(*nra->index));
+	for (i = 0; i < nra->count; ++i) {
+		if (nra->data[i])
+			ni_route_dest_index_insert(nra->index, nra->data[i]);
+	}
+}
+
 ni_route_array_t *
 ni_route_array_new(void)
 {
@@ -1493,6 +1663,7 @@ void
 ni_route_array_destroy(ni_route_array_t *nra)
 {
 	if (nra) {
+		ni_route_array_index_destroy(nra);
 		while (nra->count) {
 			nra->count--;
 			ni_route_free(nra->data[nra->count]);
@@ -1534,6 +1705,12 @@ ni_route_array_append(ni_route_array_t *nra, ni_route_t *rp)
 		return FALSE;
 
 	nra->data[nra->count++] = rp;
+
+	if (nra->index)
+		ni_route_dest_index_insert(nra->index, rp);
+	else if (nra->count >= NI_ROUTE_DEST_INDEX_MIN)
+		ni_route_array_index_build(nra);
+
 	return TRUE;
 }
 
@@ -1553,6 +1730,9 @@ ni_route_array_remove(ni_route_array_t *nra, unsigned int index)
 	}
 	nra->data[nra->count] = NULL;
 
+	if (nra->index)
+		ni_route_dest_index_remove(nra->index, rp);
+
 	/* Don't bother with shrinking the array. It's not worth the trouble */
 	return rp;
 }
@@ -1620,6 +1800,21 @@ ni_route_array_find_match(ni_route_array_t *nra, const ni_route_t *rp,
 	if (!nra || !rp || !match)
 		return NULL;
 
+	/* The destination-based match functions can only be satisfied by
+	 * routes in the bucket the reference route hashes to. */
+	if (nra->index && (match == ni_route_equal ||
+			   match == ni_route_equal_ref ||
+			   match == ni_route_equal_destination)) {
+		ni_route_dest_entry_t *entry;
+
+		entry = nra->index->buckets[ni_route_dest_hash(rp)];
+		for (; entry; entry = entry->next) {
+			if (match(entry->route, rp))
+				return entry->route;
+		}
+		return NULL;
+	}
+
 	for (i = 0; i < nra->count; ++i) {
 		if (!(r = nra->data[i]))
 			continue;
@@ -1915,9 +2110,9 @@ ni_rule_copy(ni_rule_t *dst, const ni_rule_t *src)
 	C(iif.index);
 	C(oif.index);
 #undef C
-	if (!ni_string_dup(&dst->iif.name, src->iif.name))
+	if (!ni_refstr_dup(&dst->iif.name, src->iif.name))
 		return FALSE;
-	if (!ni_string_dup(&dst->oif.name, src->oif.name))
+	if (!ni_refstr_dup(&dst->oif.name, src->oif.name))
 		return FALSE;
 	return TRUE;
 }
@@ -2477,3 +2672,159 @@ ni_rule_array_find_matches(const ni_rule_array_t *rules, const ni_rule_t *rule,
 	return count;
 }
 
+
+/*
+ * Bounded-memory summary of foreign routes.
+ *
+ * On routers holding full routing feeds, storing every kernel route as
+ * a ni_route_t costs gigabytes, while wicked itself only ever manages
+ * a handful of static routes. In compact mode, routes owned by routing
+ * daemons are kept as a count plus an open-addressed set of destination
+ * fingerprints, which is all the conflict checks need; anything more
+ * detailed is re-read from the kernel on demand.
+ */
+#define NI_ROUTE_FOREIGN_SET_MIN	256
+
+uint32_t
+ni_route_dest_fingerprint(const ni_route_t *rp)
+{
+	uint32_t csum = 0, word;
+
+	word = rp->family;
+	csum = ni_crc32c(csum, &word, sizeof(word));
+	word = rp->table;
+	csum = ni_crc32c(csum, &word, sizeof(word));
+	word = rp->tos;
+	csum = ni_crc32c(csum, &word, sizeof(word));
+	word = rp->priority;
+	csum = ni_crc32c(csum, &word, sizeof(word));
+	word = rp->prefixlen;
+	csum = ni_crc32c(csum, &word, sizeof(word));
+
+	switch (rp->family) {
+	case AF_INET:
+		csum = ni_crc32c(csum, &rp->destination.sin.sin_addr,
+				sizeof(rp->destination.sin.sin_addr));
+		break;
+	case AF_INET6:
+		csum = ni_crc32c(csum, &rp->destination.six.sin6_addr,
+				sizeof(rp->destination.six.sin6_addr));
+		break;
+	default:
+		break;
+	}
+	return csum;
+}
+
+void
+ni_route_foreign_set_init(ni_route_foreign_set_t *set)
+{
+	memset(set, 0, sizeof(*set));
+}
+
+void
+ni_route_foreign_set_reset(ni_route_foreign_set_t *set)
+{
+	if (set->slots)
+		memset(set->slots, 0, set->size * sizeof(set->slots[0]));
+	set->count = 0;
+	set->used = 0;
+}
+
+void
+ni_route_foreign_set_destroy(ni_route_foreign_set_t *set)
+{
+	free(set->slots);
+	memset(set, 0, sizeof(*set));
+}
+
+static ni_route_foreign_slot_t *
+__ni_route_foreign_set_slot(ni_route_foreign_set_t *set, uint32_t fp)
+{
+	unsigned int mask = set->size - 1;
+	unsigned int i = fp & mask;
+	ni_route_foreign_slot_t *slot;
+
+	while ((slot = &set->slots[i])->fp != 0 && slot->fp != fp)
+		i = (i + 1) & mask;
+	return slot;
+}
+
+static ni_bool_t
+__ni_route_foreign_set_grow(ni_route_foreign_set_t *set)
+{
+	ni_route_foreign_slot_t *old_slots = set->slots;
+	unsigned int i, old_size = set->size;
+
+	set->size = old_size ? old_size * 2 : NI_ROUTE_FOREIGN_SET_MIN;
+	set->slots = xcalloc(set->size, sizeof(set->slots[0]));
+	set->used = 0;
+
+	/* re-insert live entries; tombstones are dropped here */
+	for (i = 0; i < old_size; ++i) {
+		ni_route_foreign_slot_t *slot;
+
+		if (old_slots[i].refs == 0)
+			continue;
+		slot = __ni_route_foreign_set_slot(set, old_slots[i].fp);
+		*slot = old_slots[i];
+		set->used++;
+	}
+	free(old_slots);
+	return TRUE;
+}
+
+ni_bool_t
+ni_route_foreign_set_add(ni_route_foreign_set_t *set, uint32_t fp)
+{
+	ni_route_foreign_slot_t *slot;
+
+	if (fp == 0)
+		fp = 1;	/* zero marks an empty slot */
+
+	/* keep the load factor below 3/4, counting tombstones */
+	if ((set->used + 1) * 4 >= set->size * 3 &&
+	    !__ni_route_foreign_set_grow(set))
+		return FALSE;
+
+	slot = __ni_route_foreign_set_slot(set, fp);
+	if (slot->fp == 0) {
+		slot->fp = fp;
+		set->used++;
+	}
+	slot->refs++;
+	set->count++;
+	return TRUE;
+}
+
+void
+ni_route_foreign_set_del(ni_route_foreign_set_t *set, uint32_t fp)
+{
+	ni_route_foreign_slot_t *slot;
+
+	if (fp == 0)
+		fp = 1;
+	if (set->size == 0)
+		return;
+
+	/* the slot stays behind as tombstone, keeping probe chains intact */
+	slot = __ni_route_foreign_set_slot(set, fp);
+	if (slot->fp == fp && slot->refs) {
+		slot->refs--;
+		set->count--;
+	}
+}
+
+ni_bool_t
+ni_route_foreign_set_test(const ni_route_foreign_set_t *set, uint32_t fp)
+{
+	const ni_route_foreign_slot_t *slot;
+
+	if (fp == 0)
+		fp = 1;
+	if (set->size == 0)
+		return FALSE;
+
+	slot = __ni_route_foreign_set_slot((ni_route_foreign_set_t *)set, fp);
+	return slot->fp == fp && slot->refs != 0;
+}
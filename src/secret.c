@@ -10,9 +10,113 @@
 #include <wicked/util.h>
 #include "util_priv.h"
 
-	
+
 static ni_bool_t	ni_security_id_greater_equal(const ni_security_id_t *, const ni_security_id_t *);
 
+/*
+ * Hash index over the secret list, keyed by (class, path).
+ *
+ * Secret matching requires the class and path to match exactly
+ * (see ni_security_id_greater_equal), so a lookup only needs to
+ * evaluate the attribute subset check against one short chain
+ * instead of rescanning the whole list per device.
+ *
+ * Lookup misses are remembered as negative entries, so repeated
+ * queries for secrets we simply don't have (the common case during
+ * a mass wireless bring-up) return without any list walk at all.
+ * The negative cache is flushed whenever a new secret is added.
+ */
+#define NI_SECRET_HASH_NBUCKETS		64
+#define NI_SECRET_NEGATIVE_MAX		128
+
+typedef struct ni_secret_neg	ni_secret_neg_t;
+
+struct ni_secret_neg {
+	ni_secret_neg_t *	next;
+	ni_security_id_t	id;
+	char *			path;
+};
+
+struct ni_secret_index {
+	ni_secret_t *		buckets[NI_SECRET_HASH_NBUCKETS];
+	ni_secret_neg_t *	negative[NI_SECRET_HASH_NBUCKETS];
+	unsigned int		nnegative;
+};
+
+static unsigned int
+__ni_secret_hashval(const char *class, const char *path)
+{
+	unsigned int hash = 5381;
+
+	while (class && *class)
+		hash = (hash << 5) + hash + (unsigned char)*class++;
+	hash = (hash << 5) + hash + '|';
+	while (path && *path)
+		hash = (hash << 5) + hash + (unsigned char)*path++;
+	return hash % NI_SECRET_HASH_NBUCKETS;
+}
+
+static void
+__ni_secret_index_insert(ni_secret_db_t *db, ni_secret_t *sec)
+{
+	ni_secret_t **chain;
+
+	chain = &db->index->buckets[__ni_secret_hashval(sec->id.class, sec->path)];
+	sec->hash_pprev = chain;
+	sec->hash_next = *chain;
+	if (sec->hash_next)
+		sec->hash_next->hash_pprev = &sec->hash_next;
+	*chain = sec;
+}
+
+static void
+__ni_secret_neg_flush(ni_secret_db_t *db)
+{
+	ni_secret_neg_t *neg;
+	unsigned int i;
+
+	for (i = 0; i < NI_SECRET_HASH_NBUCKETS; ++i) {
+		while ((neg = db->index->negative[i]) != NULL) {
+			db->index->negative[i] = neg->next;
+			ni_security_id_destroy(&neg->id);
+			ni_string_free(&neg->path);
+			free(neg);
+		}
+	}
+	db->index->nnegative = 0;
+}
+
+static ni_bool_t
+__ni_secret_neg_lookup(ni_secret_db_t *db, const ni_security_id_t *id,
+			const char *path, unsigned int hash)
+{
+	ni_secret_neg_t *neg;
+
+	for (neg = db->index->negative[hash]; neg; neg = neg->next) {
+		if (ni_security_id_equal(&neg->id, id)
+		 && ni_string_eq(neg->path, path))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+__ni_secret_neg_record(ni_secret_db_t *db, const ni_security_id_t *id,
+			const char *path, unsigned int hash)
+{
+	ni_secret_neg_t *neg;
+
+	if (db->index->nnegative >= NI_SECRET_NEGATIVE_MAX)
+		__ni_secret_neg_flush(db);
+
+	neg = xcalloc(1, sizeof(*neg));
+	ni_security_id_set(&neg->id, id);
+	ni_string_dup(&neg->path, path);
+	neg->next = db->index->negative[hash];
+	db->index->negative[hash] = neg;
+	db->index->nnegative++;
+}
+
 ni_secret_db_t *
 ni_secret_db_new(void)
 {
@@ -20,6 +124,7 @@ ni_secret_db_new(void)
 
 	db = xcalloc(1, sizeof(*db));
 	db->seq = 1;
+	db->index = xcalloc(1, sizeof(*db->index));
 
 	return db;
 }
@@ -34,6 +139,8 @@ ni_secret_db_free(ni_secret_db_t *db)
 		ni_secret_put(sec);
 	}
 
+	__ni_secret_neg_flush(db);
+	free(db->index);
 	free(db);
 }
 
@@ -43,16 +150,21 @@ ni_secret_db_free(ni_secret_db_t *db)
 static ni_secret_t *
 __ni_secret_db_find(ni_secret_db_t *db, const ni_security_id_t *id, const char *path)
 {
+	unsigned int hash;
 	ni_secret_t *sec;
 
 	if (id == NULL)
 		return NULL;
 
-	for (sec = db->list; sec; sec = sec->next) {
+	hash = __ni_secret_hashval(id->class, path);
+	for (sec = db->index->buckets[hash]; sec; sec = sec->hash_next) {
 		if (ni_security_id_greater_equal(&sec->id, id)
 		 && ni_string_eq(sec->path, path))
 			return sec;
 	}
+
+	if (!__ni_secret_neg_lookup(db, id, path, hash))
+		__ni_secret_neg_record(db, id, path, hash);
 	return NULL;
 }
 
@@ -100,6 +212,10 @@ ni_secret_db_update(ni_secret_db_t *db, const ni_security_id_t *id, const char *
 	if ((sec = __ni_secret_db_find(db, id, path)) == NULL) {
 		sec = ni_secret_new(id, path);
 		__ni_secret_append(&db->list, sec);
+		__ni_secret_index_insert(db, sec);
+
+		/* the new secret may now satisfy previously missed lookups */
+		__ni_secret_neg_flush(db);
 	}
 
 	if (!ni_string_eq(sec->value, value)) {
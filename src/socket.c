@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/poll.h>
+#include <sys/epoll.h>
 #include <sys/un.h>
 #include <signal.h>
 #include <string.h>
@@ -19,6 +20,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
@@ -27,12 +29,17 @@
 #include "netinfo_priv.h"
 #include "socket_priv.h"
 #include "appconfig.h"
+#include "evstats.h"
+#include "trace.h"
 
 #define	NI_SOCKET_ARRAY_CHUNK	16
+#define	NI_SOCKET_EPOLL_EVENTS	64
+#define	NI_SOCKET_DISPATCH_BUDGET 32
 
 static void			__ni_socket_close(ni_socket_t *);
 static void			__ni_default_error_handler(ni_socket_t *);
 static void			__ni_default_hangup_handler(ni_socket_t *);
+static int			__ni_socket_array_poll(ni_socket_array_t *, long);
 
 static ni_socket_array_t	__ni_sockets;
 
@@ -110,11 +117,257 @@ __ni_default_hangup_handler(ni_socket_t *sock)
 }
 
 
+/*
+ * epoll backend. Each socket array lazily creates an epoll instance;
+ * fds are registered when a socket is activated and unregistered when
+ * it is deactivated, so waiting does not rebuild any fd set.
+ */
+static inline uint32_t
+__ni_socket_epoll_events(int poll_flags)
+{
+	uint32_t events = 0;
+
+	if (poll_flags & POLLIN)
+		events |= EPOLLIN;
+	if (poll_flags & POLLOUT)
+		events |= EPOLLOUT;
+	return events;
+}
+
+static ni_bool_t
+__ni_socket_epoll_register(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = __ni_socket_epoll_events(sock->poll_flags);
+	ev.data.ptr = sock;
+	if (epoll_ctl(array->epfd, EPOLL_CTL_ADD, sock->__fd, &ev) < 0) {
+		ni_error("epoll_ctl(ADD, %d) failed: %m", sock->__fd);
+		return FALSE;
+	}
+	sock->epoll_mask = sock->poll_flags;
+	return TRUE;
+}
+
+static void
+__ni_socket_epoll_unregister(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	if (array->epfd <= 0 || sock->__fd < 0)
+		return;
+
+	/* The kernel drops closed fds automatically; ENOENT is harmless */
+	if (epoll_ctl(array->epfd, EPOLL_CTL_DEL, sock->__fd, NULL) < 0 && errno != ENOENT && errno != EBADF)
+		ni_warn("epoll_ctl(DEL, %d) failed: %m", sock->__fd);
+}
+
+static ni_bool_t
+__ni_socket_epoll_init(ni_socket_array_t *array)
+{
+	unsigned int i;
+
+	if (array->epfd > 0)
+		return TRUE;
+
+	if ((array->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		array->epfd = -1;
+		return FALSE;
+	}
+
+	for (i = 0; i < array->count; ++i) {
+		ni_socket_t *sock = array->data[i];
+
+		if (sock && sock->active == array)
+			__ni_socket_epoll_register(array, sock);
+	}
+	return TRUE;
+}
+
 /*
  * Wait for incoming data on any of the sockets.
  */
 int
 ni_socket_array_wait(ni_socket_array_t *array, long timeout)
+{
+	struct epoll_event events[NI_SOCKET_EPOLL_EVENTS];
+	ni_socket_t *held[NI_SOCKET_EPOLL_EVENTS];
+	struct timeval now, expires;
+	unsigned int i, socket_count;
+	int nevents;
+
+	/* First step - cleanup empty socket slots from the array. */
+	ni_socket_array_cleanup(array);
+
+	if (!__ni_socket_epoll_init(array))
+		return __ni_socket_array_poll(array, timeout);
+
+	/* Second step - collect timeouts and sync poll flag changes */
+	timerclear(&expires);
+	socket_count = 0;
+	for (i = 0; i < array->count; ++i) {
+		ni_socket_t *sock = array->data[i];
+		struct timeval socket_expires;
+
+		if (sock->active != array)
+			continue;
+
+		timerclear(&socket_expires);
+		if (sock->get_timeout && sock->get_timeout(sock, &socket_expires) == 0) {
+			if (!timerisset(&expires) || timercmp(&socket_expires, &expires, <))
+				expires = socket_expires;
+		}
+
+		if (sock->poll_flags != sock->epoll_mask) {
+			struct epoll_event ev;
+
+			memset(&ev, 0, sizeof(ev));
+			ev.events = __ni_socket_epoll_events(sock->poll_flags);
+			ev.data.ptr = sock;
+			if (epoll_ctl(array->epfd, EPOLL_CTL_MOD, sock->__fd, &ev) == 0)
+				sock->epoll_mask = sock->poll_flags;
+		}
+		socket_count++;
+	}
+
+	ni_timer_get_time(&now);
+	if (timerisset(&expires)) {
+		struct timeval delta;
+		long delta_ms;
+
+		if (timercmp(&expires, &now, <)) {
+			timeout = 0;
+		} else {
+			timersub(&expires, &now, &delta);
+			delta_ms = 1000 * delta.tv_sec + delta.tv_usec / 1000;
+			if (timeout < 0 || delta_ms < timeout)
+				timeout = delta_ms;
+		}
+	}
+
+	if (socket_count == 0 && timeout < 0) {
+		ni_debug_socket("no sockets left to watch");
+		return 1;
+	}
+
+	nevents = epoll_wait(array->epfd, events, NI_SOCKET_EPOLL_EVENTS,
+			timeout > (long)INT_MAX ? INT_MAX : (int)timeout);
+	if (nevents < 0) {
+		if (errno == EINTR)
+			return 0;
+		ni_error("epoll_wait returns error: %m");
+		return -1;
+	}
+
+	/* Hold all sockets in this batch, so that a callback deactivating
+	 * one socket cannot free another one we still have to dispatch. */
+	for (i = 0; i < (unsigned int)nevents; ++i)
+		held[i] = ni_socket_hold(events[i].data.ptr);
+
+	/* Order the batch by socket priority, so that time-critical
+	 * protocol sockets (ARP/DHCP capture) are serviced before bulk
+	 * consumers such as dbus, whatever order the kernel returned. */
+	for (i = 1; i < (unsigned int)nevents; ++i) {
+		struct epoll_event ev = events[i];
+		ni_socket_t *sock = held[i];
+		unsigned int j = i;
+
+		while (j > 0 && held[j - 1]->priority > sock->priority) {
+			held[j] = held[j - 1];
+			events[j] = events[j - 1];
+			j--;
+		}
+		held[j] = sock;
+		events[j] = ev;
+	}
+
+	/* Dispatch at most NI_SOCKET_DISPATCH_BUDGET callbacks per wakeup;
+	 * epoll reports level-triggered, so fds left over are picked up
+	 * again on the next pass, after re-polling for new events. */
+	for (i = 0; i < (unsigned int)nevents && i < NI_SOCKET_DISPATCH_BUDGET; ++i) {
+		ni_socket_t *sock = held[i];
+		uint32_t revents = events[i].events;
+		struct timespec stamp;
+		int fd = sock->__fd;
+		uint64_t usec;
+
+		if (sock->active != array)
+			continue;
+
+		ni_tracepoint2(socket_dispatch, fd, revents);
+
+		if (revents & EPOLLERR) {
+			/* Deactivate socket */
+			ni_socket_array_deactivate(array, sock);
+			ni_evstats_stamp(&stamp);
+			sock->handle_error(sock);
+			usec = ni_evstats_record(NI_EVSTAT_SOCKET_ERROR, &stamp);
+			ni_evstats_stall_check(usec, "socket %d error callback", fd);
+			continue;
+		}
+
+		if (revents & EPOLLIN) {
+			if (sock->receive == NULL) {
+				ni_error("socket %d has no receive callback", sock->__fd);
+				ni_socket_array_deactivate(array, sock);
+			} else {
+				ni_evstats_stamp(&stamp);
+				sock->receive(sock);
+				usec = ni_evstats_record(NI_EVSTAT_SOCKET_RECEIVE, &stamp);
+				ni_evstats_stall_check(usec, "socket %d receive callback", fd);
+			}
+			if (sock->__fd < 0)
+				continue;
+		}
+
+		if (revents & EPOLLHUP) {
+			if (sock->handle_hangup) {
+				ni_evstats_stamp(&stamp);
+				sock->handle_hangup(sock);
+				usec = ni_evstats_record(NI_EVSTAT_SOCKET_HANGUP, &stamp);
+				ni_evstats_stall_check(usec, "socket %d hangup callback", fd);
+			}
+			if (sock->__fd < 0)
+				continue;
+		} else
+
+		if (revents & EPOLLOUT) {
+			if (sock->transmit == NULL) {
+				ni_error("socket %d has no transmit callback", sock->__fd);
+				ni_socket_array_deactivate(array, sock);
+			} else {
+				ni_evstats_stamp(&stamp);
+				sock->transmit(sock);
+				usec = ni_evstats_record(NI_EVSTAT_SOCKET_TRANSMIT, &stamp);
+				ni_evstats_stall_check(usec, "socket %d transmit callback", fd);
+			}
+		}
+	}
+
+	for (i = 0; i < (unsigned int)nevents; ++i)
+		ni_socket_release(held[i]);
+
+	ni_timer_get_time(&now);
+	for (i = 0; i < array->count; ++i) {
+		ni_socket_t *sock = array->data[i];
+
+		if (!sock || sock->active != array)
+			continue;
+
+		if (sock->check_timeout)
+			sock->check_timeout(sock, &now);
+	}
+
+	/* Finally cleanup deactivated/released sockets */
+	ni_socket_array_cleanup(array);
+
+	return 0;
+}
+
+/*
+ * poll(2) based fallback, used when no epoll instance can be created.
+ */
+static int
+__ni_socket_array_poll(ni_socket_array_t *array, long timeout)
 {
 	struct pollfd pfd[array->count];
 	struct timeval now, expires;
@@ -144,7 +397,7 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 		socket_count++;
 	}
 
-	gettimeofday(&now, NULL);
+	ni_timer_get_time(&now);
 	if (timerisset(&expires)) {
 		struct timeval delta;
 		long delta_ms;
@@ -220,7 +473,7 @@ done_with_this_socket:
 		ni_socket_release(sock);
 	}
 
-	gettimeofday(&now, NULL);
+	ni_timer_get_time(&now);
 	for (i = 0; i < array->count && i < socket_count; ++i) {
 		ni_socket_t *sock = array->data[i];
 
@@ -240,7 +493,14 @@ done_with_this_socket:
 int
 ni_socket_wait(long timeout)
 {
-	return ni_socket_array_wait(&__ni_sockets, timeout);
+	int rv;
+
+	rv = ni_socket_array_wait(&__ni_sockets, timeout);
+
+	/* Drain buffered debug messages outside the dispatch path */
+	ni_log_flush();
+
+	return rv;
 }
 
 /*
@@ -254,6 +514,7 @@ __ni_socket_wrap(int fd, int sotype)
 	socket = xcalloc(1, sizeof(*socket));
 	socket->refcount = 1;
 	socket->__fd = fd;
+	socket->priority = NI_SOCKET_PRIO_DEFAULT;
 
 	socket->handle_error = __ni_default_error_handler;
 	socket->handle_hangup = __ni_default_hangup_handler;
@@ -310,6 +571,7 @@ void
 ni_socket_array_init(ni_socket_array_t *array)
 {
 	memset(array, 0, sizeof(*array));
+	array->epfd = -1;
 }
 
 void
@@ -328,7 +590,10 @@ ni_socket_array_destroy(ni_socket_array_t *array)
 			}
 		}
 		free(array->data);
+		if (array->epfd > 0)
+			close(array->epfd);
 		memset(array, 0, sizeof(*array));
+		array->epfd = -1;
 	}
 }
 
@@ -383,6 +648,8 @@ ni_socket_array_remove_at(ni_socket_array_t *array, unsigned int index)
 		return NULL;
 
 	sock = array->data[index];
+	if (sock && sock->active == array)
+		__ni_socket_epoll_unregister(array, sock);
 	array->count--;
 	if (index < array->count) {
 		memmove(&array->data[index], &array->data[index + 1],
@@ -439,6 +706,8 @@ ni_socket_array_activate(ni_socket_array_t *array, ni_socket_t *sock)
 	ni_socket_hold(sock);
 	sock->active = array;
 	sock->poll_flags = POLLIN;
+	if (array->epfd > 0)
+		__ni_socket_epoll_register(array, sock);
 	return TRUE;
 }
 
@@ -20,6 +20,8 @@ struct ni_socket {
 	int		__fd;
 	unsigned int	error  : 1;
 	int		poll_flags;
+	int		epoll_mask;	/* events currently registered with epoll */
+	unsigned int	priority;	/* dispatch order within one wakeup, lower first */
 
 	ni_buffer_t	rbuf;
 	ni_buffer_t	wbuf;
@@ -43,9 +45,19 @@ struct ni_socket {
 struct ni_socket_array {
 	unsigned int	count;
 	ni_socket_t **	data;
+	int		epfd;		/* epoll instance, 0/-1 if not created */
 };
 
-#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL }
+#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL, .epfd = -1 }
+
+/* Dispatch priority classes. Within a single event loop wakeup,
+ * protocol sockets (DHCP/ARP/RA packet traffic) are serviced first,
+ * then control sockets (dbus, AF_LOCAL), then bulk event feeds
+ * (rtnetlink, uevent), which can flood during interface storms. */
+#define NI_SOCKET_PRIO_PROTOCOL	0
+#define NI_SOCKET_PRIO_CONTROL	1
+#define NI_SOCKET_PRIO_BULK	2
+#define NI_SOCKET_PRIO_DEFAULT	NI_SOCKET_PRIO_CONTROL
 
 extern void		ni_socket_array_init(ni_socket_array_t *);
 extern void		ni_socket_array_destroy(ni_socket_array_t *);
@@ -0,0 +1,53 @@
+/*
+ * Runtime work counters for wickedd.
+ *
+ * The hot paths (netlink event processing, dbus method dispatch, timer
+ * callbacks, interface refreshes, extension spawns) bump one counter
+ * each, so a production daemon can be asked what it has been doing
+ * without enabling debug logging. The counters are plain increments in
+ * a single-threaded daemon and always on; they complement the latency
+ * histograms in evstats.c, which tell how long the same work took.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+
+#include "stats.h"
+
+static uint64_t			ni_stat_counters[__NI_STAT_MAX];
+
+static const char *		ni_stat_type_names[__NI_STAT_MAX] = {
+	[NI_STAT_NETLINK_EVENTS]	= "netlink-events",
+	[NI_STAT_DBUS_CALLS]		= "dbus-calls",
+	[NI_STAT_TIMERS_FIRED]		= "timers-fired",
+	[NI_STAT_REFRESHES]		= "refreshes",
+	[NI_STAT_EXTENSION_SPAWNS]	= "extension-spawns",
+};
+
+void
+ni_stats_inc(ni_stat_type_t type)
+{
+	if (type >= __NI_STAT_MAX)
+		return;
+	ni_stat_counters[type]++;
+}
+
+uint64_t
+ni_stats_get(ni_stat_type_t type)
+{
+	if (type >= __NI_STAT_MAX)
+		return 0;
+	return ni_stat_counters[type];
+}
+
+const char *
+ni_stat_type_name(ni_stat_type_t type)
+{
+	if (type >= __NI_STAT_MAX)
+		return NULL;
+	return ni_stat_type_names[type];
+}
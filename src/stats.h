@@ -0,0 +1,26 @@
+/*
+ * Runtime work counters for wickedd.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+
+#ifndef __WICKED_STATS_H__
+#define __WICKED_STATS_H__
+
+#include <stdint.h>
+
+typedef enum {
+	NI_STAT_NETLINK_EVENTS = 0,
+	NI_STAT_DBUS_CALLS,
+	NI_STAT_TIMERS_FIRED,
+	NI_STAT_REFRESHES,
+	NI_STAT_EXTENSION_SPAWNS,
+
+	__NI_STAT_MAX
+} ni_stat_type_t;
+
+extern void		ni_stats_inc(ni_stat_type_t);
+extern uint64_t		ni_stats_get(ni_stat_type_t);
+extern const char *	ni_stat_type_name(ni_stat_type_t);
+
+#endif /* __WICKED_STATS_H__ */
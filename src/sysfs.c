@@ -9,6 +9,9 @@
 
 #include <unistd.h>
 #include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
 #include <net/if_arp.h>
 
 #include <wicked/netinfo.h>
@@ -53,6 +56,207 @@ static int		__ni_sysfs_read_list(const char *, ni_string_array_t *);
 static int		__ni_sysfs_read_string(const char *, char **);
 
 
+/*
+ * Per-device sysfs directory fd cache.
+ *
+ * A refresh of a bridge or bond reads dozens of attributes of the same
+ * device in a row; keep the device directory open and openat() relative
+ * to it, rather than constructing and walking the full path for every
+ * single attribute.
+ */
+#define NI_SYSFS_NETIF_DIRFD_CACHE_SIZE	4
+
+static struct __ni_sysfs_netif_dirfd {
+	char		ifname[IF_NAMESIZE];
+	int		fd;
+} __ni_sysfs_netif_dirfd_cache[NI_SYSFS_NETIF_DIRFD_CACHE_SIZE];
+static unsigned int	__ni_sysfs_netif_dirfd_next;
+
+static void
+__ni_sysfs_netif_dirfd_drop(const char *ifname)
+{
+	struct __ni_sysfs_netif_dirfd *entry;
+	unsigned int i;
+
+	for (i = 0; i < NI_SYSFS_NETIF_DIRFD_CACHE_SIZE; ++i) {
+		entry = &__ni_sysfs_netif_dirfd_cache[i];
+		if (entry->ifname[0] && ni_string_eq(entry->ifname, ifname)) {
+			close(entry->fd);
+			entry->ifname[0] = '\0';
+		}
+	}
+}
+
+static int
+__ni_sysfs_netif_dirfd(const char *ifname)
+{
+	struct __ni_sysfs_netif_dirfd *entry;
+	char pathbuf[PATH_MAX];
+	unsigned int i;
+	int fd;
+
+	/* the kernel limits interface names to IF_NAMESIZE anyway */
+	if (strlen(ifname) >= IF_NAMESIZE)
+		return -1;
+
+	for (i = 0; i < NI_SYSFS_NETIF_DIRFD_CACHE_SIZE; ++i) {
+		entry = &__ni_sysfs_netif_dirfd_cache[i];
+		if (entry->ifname[0] && ni_string_eq(entry->ifname, ifname))
+			return entry->fd;
+	}
+
+	snprintf(pathbuf, sizeof(pathbuf), "%s/%s", _PATH_SYS_CLASS_NET, ifname);
+	if ((fd = open(pathbuf, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -1;
+
+	entry = &__ni_sysfs_netif_dirfd_cache[__ni_sysfs_netif_dirfd_next];
+	__ni_sysfs_netif_dirfd_next = (__ni_sysfs_netif_dirfd_next + 1)
+					% NI_SYSFS_NETIF_DIRFD_CACHE_SIZE;
+	if (entry->ifname[0])
+		close(entry->fd);
+	strcpy(entry->ifname, ifname);
+	entry->fd = fd;
+	return fd;
+}
+
+/*
+ * A cached directory fd goes stale when the device is deleted (and
+ * possibly recreated under the same name); attribute lookups relative
+ * to it then fail with ENOENT, just as lookups of attributes a device
+ * simply doesn't have. Every netdev has an ifindex attribute, so use
+ * that to tell the two cases apart.
+ */
+static ni_bool_t
+__ni_sysfs_netif_dirfd_stale(int dirfd)
+{
+	return faccessat(dirfd, "ifindex", F_OK, 0) < 0;
+}
+
+static int
+__ni_sysfs_netif_read_attr(int dirfd, const char *attr_name, char *buffer, size_t size)
+{
+	ssize_t len;
+	int fd;
+
+	if ((fd = openat(dirfd, attr_name, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+
+	len = read(fd, buffer, size - 1);
+	close(fd);
+	if (len < 0)
+		return -1;
+
+	buffer[len] = '\0';
+	buffer[strcspn(buffer, "\n")] = '\0';
+	return 0;
+}
+
+/*
+ * Read a batch of attributes of one device, resolving the device
+ * directory only once. Attributes that do not exist (or cannot be
+ * read) just leave their entry marked not present.
+ * Returns the number of attributes actually read.
+ */
+unsigned int
+ni_sysfs_netif_get_attrs(const char *ifname, ni_sysfs_netif_attr_t *attrs, unsigned int count)
+{
+	unsigned int i, found = 0;
+	int dirfd;
+
+	for (i = 0; i < count; ++i) {
+		attrs[i].present = FALSE;
+		attrs[i].value[0] = '\0';
+	}
+
+	if ((dirfd = __ni_sysfs_netif_dirfd(ifname)) < 0)
+		return 0;
+
+	for (i = 0; i < count; ++i) {
+		if (__ni_sysfs_netif_read_attr(dirfd, attrs[i].name,
+					attrs[i].value, sizeof(attrs[i].value)) < 0) {
+			if (errno == ENOENT && __ni_sysfs_netif_dirfd_stale(dirfd)) {
+				__ni_sysfs_netif_dirfd_drop(ifname);
+				if ((dirfd = __ni_sysfs_netif_dirfd(ifname)) < 0)
+					return found;
+				if (__ni_sysfs_netif_read_attr(dirfd, attrs[i].name,
+						attrs[i].value, sizeof(attrs[i].value)) < 0)
+					continue;
+			} else {
+				continue;
+			}
+		}
+		attrs[i].present = TRUE;
+		found++;
+	}
+	return found;
+}
+
+/*
+ * Touch the per-device attributes the discovery path is about to read,
+ * for all devices present in sysfs. This only warms the kernel dentry
+ * and attribute caches; the values are thrown away. Runs on a worker
+ * thread during the bootstrap refresh, so it deliberately uses a local
+ * directory fd instead of the shared cache above.
+ */
+void
+ni_sysfs_netif_prefetch(void)
+{
+	static const char *attrs[] = {
+		"ifindex", "iflink", "type", "flags", "mtu",
+		"address", "carrier", "operstate", "phys_port_id",
+	};
+	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	char pathbuf[PATH_MAX], buffer[NI_SYSFS_NETIF_ATTR_SIZE];
+	unsigned int i, j;
+	int dirfd;
+
+	if (ni_scandir(_PATH_SYS_CLASS_NET, NULL, &names) <= 0) {
+		ni_string_array_destroy(&names);
+		return;
+	}
+
+	for (i = 0; i < names.count; ++i) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s",
+				_PATH_SYS_CLASS_NET, names.data[i]);
+		if ((dirfd = open(pathbuf, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+			continue;
+
+		for (j = 0; j < sizeof(attrs) / sizeof(attrs[0]); ++j)
+			__ni_sysfs_netif_read_attr(dirfd, attrs[j],
+					buffer, sizeof(buffer));
+		close(dirfd);
+	}
+	ni_string_array_destroy(&names);
+}
+
+static void
+__ni_sysfs_attr_to_int(const ni_sysfs_netif_attr_t *attr, int *result)
+{
+	if (attr->present)
+		*result = strtol(attr->value, NULL, 0);
+}
+
+static void
+__ni_sysfs_attr_to_uint(const ni_sysfs_netif_attr_t *attr, unsigned int *result)
+{
+	if (attr->present)
+		*result = strtoul(attr->value, NULL, 0);
+}
+
+static void
+__ni_sysfs_attr_to_ulong(const ni_sysfs_netif_attr_t *attr, unsigned long *result)
+{
+	if (attr->present)
+		*result = strtoul(attr->value, NULL, 0);
+}
+
+static void
+__ni_sysfs_attr_to_string(const ni_sysfs_netif_attr_t *attr, char **result)
+{
+	if (attr->present)
+		ni_string_dup(result, attr->value);
+}
+
 /*
  * Functions for reading and writing sysfs attributes
  */
@@ -199,20 +403,23 @@ static const char *
 __ni_sysfs_netif_get_attr(const char *ifname, const char *attr_name)
 {
 	static char buffer[256];
-	const char *filename;
-	char *result = NULL;
-	FILE *fp;
+	int dirfd;
 
-	filename = __ni_sysfs_netif_attrpath(ifname, attr_name);
-	if (!(fp = fopen(filename, "r")))
+	if ((dirfd = __ni_sysfs_netif_dirfd(ifname)) < 0)
 		return NULL;
 
-	if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-		buffer[strcspn(buffer, "\n")] = '\0';
-		result = buffer;
-	}
-	fclose(fp);
-	return result;
+	if (__ni_sysfs_netif_read_attr(dirfd, attr_name, buffer, sizeof(buffer)) == 0)
+		return buffer;
+
+	if (errno != ENOENT || !__ni_sysfs_netif_dirfd_stale(dirfd))
+		return NULL;
+
+	__ni_sysfs_netif_dirfd_drop(ifname);
+	if ((dirfd = __ni_sysfs_netif_dirfd(ifname)) < 0)
+		return NULL;
+	if (__ni_sysfs_netif_read_attr(dirfd, attr_name, buffer, sizeof(buffer)) < 0)
+		return NULL;
+	return buffer;
 }
 
 static int
@@ -470,18 +677,37 @@ ni_sysfs_bridge_update_config(const char *ifname, const ni_bridge_t *bridge)
 void
 ni_sysfs_bridge_get_status(const char *ifname, ni_bridge_status_t *bs)
 {
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/stp_state", &bs->stp_state);
-	ni_sysfs_netif_get_string(ifname, SYSFS_BRIDGE_ATTR "/root_id", &bs->root_id);
-	ni_sysfs_netif_get_string(ifname, SYSFS_BRIDGE_ATTR "/bridge_id", &bs->bridge_id);
-	ni_sysfs_netif_get_string(ifname, SYSFS_BRIDGE_ATTR "/group_addr", &bs->group_addr);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/root_port", &bs->root_port);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/root_path_cost", &bs->root_path_cost);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/topology_change", &bs->topology_change);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/topology_change_detected", &bs->topology_change_detected);
-	ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_ATTR "/gc_timer", &bs->gc_timer);
-	ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_ATTR "/tcn_timer", &bs->tcn_timer);
-	ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_ATTR "/hello_timer", &bs->hello_timer);
-	ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_ATTR "/topology_change_timer", &bs->topology_change_timer);
+	ni_sysfs_netif_attr_t attrs[] = {
+		{ .name = SYSFS_BRIDGE_ATTR "/stp_state"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/root_id"			},
+		{ .name = SYSFS_BRIDGE_ATTR "/bridge_id"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/group_addr"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/root_port"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/root_path_cost"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/topology_change"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/topology_change_detected"	},
+		{ .name = SYSFS_BRIDGE_ATTR "/gc_timer"			},
+		{ .name = SYSFS_BRIDGE_ATTR "/tcn_timer"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/hello_timer"		},
+		{ .name = SYSFS_BRIDGE_ATTR "/topology_change_timer"	},
+	};
+	ni_sysfs_netif_attr_t *ap = attrs;
+
+	if (!ni_sysfs_netif_get_attrs(ifname, attrs, sizeof(attrs) / sizeof(attrs[0])))
+		return;
+
+	__ni_sysfs_attr_to_uint(ap++, &bs->stp_state);
+	__ni_sysfs_attr_to_string(ap++, &bs->root_id);
+	__ni_sysfs_attr_to_string(ap++, &bs->bridge_id);
+	__ni_sysfs_attr_to_string(ap++, &bs->group_addr);
+	__ni_sysfs_attr_to_uint(ap++, &bs->root_port);
+	__ni_sysfs_attr_to_uint(ap++, &bs->root_path_cost);
+	__ni_sysfs_attr_to_uint(ap++, &bs->topology_change);
+	__ni_sysfs_attr_to_uint(ap++, &bs->topology_change_detected);
+	__ni_sysfs_attr_to_ulong(ap++, &bs->gc_timer);
+	__ni_sysfs_attr_to_ulong(ap++, &bs->tcn_timer);
+	__ni_sysfs_attr_to_ulong(ap++, &bs->hello_timer);
+	__ni_sysfs_attr_to_ulong(ap++, &bs->topology_change_timer);
 }
 
 int
@@ -516,23 +742,43 @@ ni_sysfs_bridge_port_update_config(const char *ifname, const ni_bridge_port_t *p
 void
 ni_sysfs_bridge_port_get_status(const char *ifname, ni_bridge_port_status_t *ps)
 {
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/priority", &ps->priority);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/path_cost", &ps->path_cost);
-
-	ni_sysfs_netif_get_int(ifname, SYSFS_BRIDGE_PORT_ATTR "/state", &ps->state);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/port_no", &ps->port_no);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/port_id", &ps->port_no);
-	ni_sysfs_netif_get_string(ifname, SYSFS_BRIDGE_PORT_ATTR "/designated_root", &ps->designated_root);
-	ni_sysfs_netif_get_string(ifname, SYSFS_BRIDGE_PORT_ATTR "/designated_bridge", &ps->designated_bridge);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/designated_port", &ps->designated_port);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/designated_cost", &ps->designated_cost);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/change_ack", &ps->change_ack);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/hairpin_mode", &ps->hairpin_mode);
-	ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_PORT_ATTR "/config_pending", &ps->config_pending);
-
-	ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_PORT_ATTR "/hold_timer", &ps->hold_timer);
-	ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_PORT_ATTR "/message_age_timer", &ps->message_age_timer);
-	ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_PORT_ATTR "/forward_delay_timer", &ps->forward_delay_timer);
+	ni_sysfs_netif_attr_t attrs[] = {
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/priority"		},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/path_cost"		},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/state"		},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/port_no"		},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/port_id"		},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/designated_root"	},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/designated_bridge"	},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/designated_port"	},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/designated_cost"	},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/change_ack"		},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/hairpin_mode"	},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/config_pending"	},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/hold_timer"		},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/message_age_timer"	},
+		{ .name = SYSFS_BRIDGE_PORT_ATTR "/forward_delay_timer"	},
+	};
+	ni_sysfs_netif_attr_t *ap = attrs;
+
+	if (!ni_sysfs_netif_get_attrs(ifname, attrs, sizeof(attrs) / sizeof(attrs[0])))
+		return;
+
+	__ni_sysfs_attr_to_uint(ap++, &ps->priority);
+	__ni_sysfs_attr_to_uint(ap++, &ps->path_cost);
+	__ni_sysfs_attr_to_int(ap++, &ps->state);
+	__ni_sysfs_attr_to_uint(ap++, &ps->port_no);
+	__ni_sysfs_attr_to_uint(ap++, &ps->port_no);
+	__ni_sysfs_attr_to_string(ap++, &ps->designated_root);
+	__ni_sysfs_attr_to_string(ap++, &ps->designated_bridge);
+	__ni_sysfs_attr_to_uint(ap++, &ps->designated_port);
+	__ni_sysfs_attr_to_uint(ap++, &ps->designated_cost);
+	__ni_sysfs_attr_to_uint(ap++, &ps->change_ack);
+	__ni_sysfs_attr_to_uint(ap++, &ps->hairpin_mode);
+	__ni_sysfs_attr_to_uint(ap++, &ps->config_pending);
+	__ni_sysfs_attr_to_ulong(ap++, &ps->hold_timer);
+	__ni_sysfs_attr_to_ulong(ap++, &ps->message_age_timer);
+	__ni_sysfs_attr_to_ulong(ap++, &ps->forward_delay_timer);
 }
 
 /*
@@ -689,6 +935,84 @@ ni_sysctl_ipv6_ifconfig_set_uint(const char *ifname, const char *ctl_name, unsig
 	return __ni_sysfs_printf(__ni_sysctl_ipv6_ifconfig_path(ifname, ctl_name), "%u", newval);
 }
 
+/*
+ * Batched sysctl access. The per-interface settings all live in one
+ * procfs conf directory; device discovery and ifconfig apply touch a
+ * whole group of them back to back, so callers open the directory
+ * once and access the attributes through openat(), saving the full
+ * path lookup per attribute.
+ */
+static int
+__ni_sysctl_ifconfig_open(const char *family, const char *ifname)
+{
+	char pathname[PATH_MAX];
+
+	snprintf(pathname, sizeof(pathname), "/proc/sys/net/%s/conf/%s",
+			family, ifname);
+	return open(pathname, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+int
+ni_sysctl_ipv4_ifconfig_open(const char *ifname)
+{
+	return __ni_sysctl_ifconfig_open("ipv4", ifname);
+}
+
+int
+ni_sysctl_ipv6_ifconfig_open(const char *ifname)
+{
+	return __ni_sysctl_ifconfig_open("ipv6", ifname);
+}
+
+void
+ni_sysctl_ifconfig_close(int dirfd)
+{
+	if (dirfd >= 0)
+		close(dirfd);
+}
+
+int
+ni_sysctl_ifconfig_get_int(int dirfd, const char *ctl_name, int *value)
+{
+	char buffer[256];
+	ssize_t len;
+	int fd;
+
+	*value = 0;
+	if (dirfd < 0 || (fd = openat(dirfd, ctl_name, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+
+	len = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+
+	buffer[len] = '\0';
+	buffer[strcspn(buffer, "\n")] = '\0';
+	return ni_parse_int(buffer, value, 0);
+}
+
+int
+ni_sysctl_ifconfig_set_int(int dirfd, const char *ctl_name, int newval)
+{
+	char buffer[32];
+	int fd, len, ret = 0;
+
+	if (dirfd < 0) {
+		errno = ENOENT;
+		return -1;
+	}
+	if ((fd = openat(dirfd, ctl_name, O_WRONLY | O_CLOEXEC)) < 0)
+		return -1;
+
+	len = snprintf(buffer, sizeof(buffer), "%d", newval);
+	if (write(fd, buffer, len) != len)
+		ret = -1;
+	if (close(fd) < 0)
+		ret = -1;
+	return ret;
+}
+
 /*
  * Print a value to a sysfs file
  */
@@ -10,11 +10,21 @@
 #include <wicked/bridge.h>
 #include <wicked/pci.h>
 
+#define NI_SYSFS_NETIF_ATTR_SIZE	128
+
+typedef struct ni_sysfs_netif_attr {
+	const char *	name;		/* attribute path relative to the device directory */
+	ni_bool_t	present;	/* attribute existed and could be read */
+	char		value[NI_SYSFS_NETIF_ATTR_SIZE];	/* first line, newline stripped */
+} ni_sysfs_netif_attr_t;
+
 extern int	ni_sysfs_netif_get_int(const char *, const char *, int *);
 extern int	ni_sysfs_netif_get_long(const char *, const char *, long *);
 extern int	ni_sysfs_netif_get_uint(const char *, const char *, unsigned int *);
 extern int	ni_sysfs_netif_get_ulong(const char *, const char *, unsigned long *);
 extern int	ni_sysfs_netif_get_string(const char *, const char *, char **);
+extern unsigned int ni_sysfs_netif_get_attrs(const char *, ni_sysfs_netif_attr_t *, unsigned int);
+extern void	ni_sysfs_netif_prefetch(void);
 extern int	ni_sysfs_netif_put_int(const char *, const char *, int);
 extern int	ni_sysfs_netif_put_long(const char *, const char *, long);
 extern int	ni_sysfs_netif_put_uint(const char *, const char *, unsigned int);
@@ -59,4 +69,11 @@ extern int	ni_sysctl_ipv4_ifconfig_get_uint(const char *, const char *, unsigned
 extern int	ni_sysctl_ipv4_ifconfig_set_int(const char *, const char *, int);
 extern int	ni_sysctl_ipv4_ifconfig_set_uint(const char *, const char *, unsigned int);
 
+/* batched access via a cached conf directory fd */
+extern int	ni_sysctl_ipv4_ifconfig_open(const char *ifname);
+extern int	ni_sysctl_ipv6_ifconfig_open(const char *ifname);
+extern void	ni_sysctl_ifconfig_close(int dirfd);
+extern int	ni_sysctl_ifconfig_get_int(int dirfd, const char *, int *);
+extern int	ni_sysctl_ifconfig_set_int(int dirfd, const char *, int);
+
 #endif /* __NETINFO_SYSFS_H__ */
@@ -25,13 +25,33 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
+
 #include <wicked/util.h>
 #include <wicked/logging.h>
+#include <wicked/dbus.h>
+#include <wicked/dbus-errors.h>
 
+#include "dbus-common.h"
 #include "buffer.h"
 #include "process.h"
 
 
+#define NI_SYSTEMD_BUS_NAME		"org.freedesktop.systemd1"
+#define NI_SYSTEMD_OBJECT_PATH		"/org/freedesktop/systemd1"
+#define NI_SYSTEMD_MANAGER_INTERFACE	NI_SYSTEMD_BUS_NAME ".Manager"
+#define NI_SYSTEMD_UNIT_INTERFACE	NI_SYSTEMD_BUS_NAME ".Unit"
+#define NI_SYSTEMD_SERVICE_INTERFACE	NI_SYSTEMD_BUS_NAME ".Service"
+#define NI_DBUS_PROPERTIES_INTERFACE	"org.freedesktop.DBus.Properties"
+
+/* secs we wait for a unit to leave its activating/deactivating state */
+#define NI_SYSTEMD_JOB_WAIT_SEC		30
+
+/* internal return codes of the dbus call helpers */
+#define NI_SYSTEMD_CALL_OK		0	/* executed              */
+#define NI_SYSTEMD_CALL_FAILURE		-1	/* systemd reports error */
+#define NI_SYSTEMD_CALL_UNAVAILABLE	1	/* use systemctl binary  */
+
 static const char *
 ni_systemctl_tool_path(void)
 {
@@ -45,70 +65,219 @@ ni_systemctl_tool_path(void)
 }
 
 /*
- * systemd instance service methods
+ * === dbus client ===
+ *
+ * Talk to org.freedesktop.systemd1 directly over a cached connection;
+ * spawning the systemctl binary costs a fork/exec plus systemctl's own
+ * bus connection setup per call.  The binary remains as fallback when
+ * the bus is not available (e.g. within a container or during shutdown).
  */
-int
-ni_systemctl_service_start(const char *service)
+static ni_dbus_class_t		ni_systemd_client_class = {
+	.name = "systemd-client"
+};
+
+static ni_dbus_client_t *	systemd_client;
+static ni_dbus_object_t *	systemd_manager;
+
+static ni_dbus_object_t *
+ni_systemd_manager_object(void)
 {
-	const char *systemctl;
-	ni_shellcmd_t *cmd;
-	ni_process_t *pi;
-	int rv;
+	if (systemd_manager)
+		return systemd_manager;
 
-	if (ni_string_empty(service))
-		return -1;
+	if (!(systemd_client = ni_dbus_client_open("system", NI_SYSTEMD_BUS_NAME)))
+		return NULL;
 
-	if (!(systemctl = ni_systemctl_tool_path()))
-		return -1;
+	systemd_manager = ni_dbus_client_object_new(systemd_client,
+			&ni_systemd_client_class, NI_SYSTEMD_OBJECT_PATH,
+			NI_SYSTEMD_MANAGER_INTERFACE, NULL);
+	if (!systemd_manager) {
+		ni_dbus_client_free(systemd_client);
+		systemd_client = NULL;
+	}
+	return systemd_manager;
+}
 
-	if (!(cmd = ni_shellcmd_new(NULL)))
-		return -1;
+static void
+ni_systemd_manager_release(void)
+{
+	if (systemd_manager) {
+		ni_dbus_object_free(systemd_manager);
+		systemd_manager = NULL;
+	}
+	if (systemd_client) {
+		ni_dbus_client_free(systemd_client);
+		systemd_client = NULL;
+	}
+}
 
-	if (!ni_shellcmd_add_arg(cmd, systemctl))
-		goto failure;
+/*
+ * A failure in the dbus stack itself (disconnect, timeout, no bus, ...)
+ * means we should drop the cached connection and retry via the binary;
+ * an org.freedesktop.systemd1.* error is a genuine answer from systemd.
+ */
+static int
+ni_systemd_error_disposition(const DBusError *error)
+{
+	if (dbus_error_is_set(error) &&
+	    !ni_string_startswith(error->name, "org.freedesktop.DBus.Error."))
+		return NI_SYSTEMD_CALL_FAILURE;
 
-	if (!ni_shellcmd_add_arg(cmd, "start"))
-		goto failure;
+	ni_systemd_manager_release();
+	return NI_SYSTEMD_CALL_UNAVAILABLE;
+}
 
-	if (!ni_shellcmd_add_arg(cmd, service))
-		goto failure;
+static char *
+ni_systemd_unit_object_path(const char *service)
+{
+	ni_dbus_object_t *manager;
+	char *path = NULL;
 
-	if (!(pi = ni_process_new(cmd)))
-		goto failure;
-	ni_shellcmd_release(cmd);
+	if (!(manager = ni_systemd_manager_object()))
+		return NULL;
 
-	rv = ni_process_run_and_wait(pi);
-	ni_process_free(pi);
+	if (ni_dbus_object_call_simple(manager, NI_SYSTEMD_MANAGER_INTERFACE,
+				"LoadUnit", DBUS_TYPE_STRING, &service,
+				DBUS_TYPE_OBJECT_PATH, &path) < 0)
+		return NULL;
+
+	return path;
+}
+
+static int
+ni_systemd_unit_property_get(const char *service, const char *interface,
+				const char *property, char **result)
+{
+	ni_dbus_variant_t argv[2] = { NI_DBUS_VARIANT_INIT, NI_DBUS_VARIANT_INIT };
+	ni_dbus_variant_t res = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *unit = NULL;
+	const char *string;
+	char *path = NULL;
+	int rv;
 
+	if (!(path = ni_systemd_unit_object_path(service)))
+		return NI_SYSTEMD_CALL_UNAVAILABLE;
+
+	unit = ni_dbus_client_object_new(systemd_client, &ni_systemd_client_class,
+			path, NI_SYSTEMD_UNIT_INTERFACE, NULL);
+	ni_string_free(&path);
+	if (!unit)
+		return NI_SYSTEMD_CALL_UNAVAILABLE;
+
+	ni_dbus_variant_set_string(&argv[0], interface);
+	ni_dbus_variant_set_string(&argv[1], property);
+
+	if (!ni_dbus_object_call_variant(unit, NI_DBUS_PROPERTIES_INTERFACE, "Get",
+				2, argv, 1, &res, &error)) {
+		rv = ni_systemd_error_disposition(&error);
+	} else
+	if (ni_dbus_variant_get_string(&res, &string)) {
+		ni_string_dup(result, string);
+		rv = NI_SYSTEMD_CALL_OK;
+	} else {
+		/* non-string property; let systemctl format it */
+		rv = NI_SYSTEMD_CALL_UNAVAILABLE;
+	}
+
+	ni_dbus_variant_destroy(&argv[0]);
+	ni_dbus_variant_destroy(&argv[1]);
+	ni_dbus_variant_destroy(&res);
+	dbus_error_free(&error);
+	ni_dbus_object_free(unit);
 	return rv;
+}
 
-failure:
-	if (cmd)
-		ni_shellcmd_release(cmd);
-	return -1;
+/*
+ * StartUnit/StopUnit only enqueue a job; systemctl would wait for the
+ * job to finish, so poll the unit state until it leaves the transition.
+ */
+static int
+ni_systemd_unit_wait(const char *service, ni_bool_t starting)
+{
+	unsigned int loops = NI_SYSTEMD_JOB_WAIT_SEC * 10;
+	char *state = NULL;
+	int rv = NI_SYSTEMD_CALL_FAILURE;
+
+	while (loops--) {
+		if (ni_systemd_unit_property_get(service, NI_SYSTEMD_UNIT_INTERFACE,
+					"ActiveState", &state) != NI_SYSTEMD_CALL_OK)
+			break;
+
+		if (starting) {
+			if (ni_string_eq(state, "active")) {
+				rv = NI_SYSTEMD_CALL_OK;
+				break;
+			}
+			if (ni_string_eq(state, "failed"))
+				break;
+		} else {
+			if (ni_string_eq(state, "inactive") ||
+			    ni_string_eq(state, "failed")) {
+				rv = NI_SYSTEMD_CALL_OK;
+				break;
+			}
+		}
+		usleep(100000);
+	}
+
+	ni_string_free(&state);
+	return rv;
 }
 
-int
-ni_systemctl_service_stop(const char *service)
+static int
+ni_systemd_unit_method_call(const char *method, const char *service)
+{
+	ni_dbus_variant_t argv[2] = { NI_DBUS_VARIANT_INIT, NI_DBUS_VARIANT_INIT };
+	ni_dbus_variant_t res = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_object_t *manager;
+	int rv;
+
+	if (!(manager = ni_systemd_manager_object()))
+		return NI_SYSTEMD_CALL_UNAVAILABLE;
+
+	ni_dbus_variant_set_string(&argv[0], service);
+	ni_dbus_variant_set_string(&argv[1], "replace");
+
+	if (ni_dbus_object_call_variant(manager, NI_SYSTEMD_MANAGER_INTERFACE,
+				method, 2, argv, 1, &res, &error)) {
+		rv = NI_SYSTEMD_CALL_OK;
+	} else {
+		rv = ni_systemd_error_disposition(&error);
+		if (rv == NI_SYSTEMD_CALL_FAILURE)
+			ni_debug_dbus("%s(%s) failed: %s (%s)", method, service,
+					error.name, error.message);
+	}
+
+	ni_dbus_variant_destroy(&argv[0]);
+	ni_dbus_variant_destroy(&argv[1]);
+	ni_dbus_variant_destroy(&res);
+	dbus_error_free(&error);
+	return rv;
+}
+
+/*
+ * === systemctl binary fallback ===
+ */
+static int
+ni_systemctl_tool_action(const char *action, const char *service)
 {
 	const char *systemctl;
 	ni_shellcmd_t *cmd;
 	ni_process_t *pi;
 	int rv;
 
-	if (ni_string_empty(service))
+	if (!(systemctl = ni_systemctl_tool_path()))
 		return -1;
 
 	if (!(cmd = ni_shellcmd_new(NULL)))
 		return -1;
 
-	if (!(systemctl = ni_systemctl_tool_path()))
-		return -1;
-
 	if (!ni_shellcmd_add_arg(cmd, systemctl))
 		goto failure;
 
-	if (!ni_shellcmd_add_arg(cmd, "stop"))
+	if (!ni_shellcmd_add_arg(cmd, action))
 		goto failure;
 
 	if (!ni_shellcmd_add_arg(cmd, service))
@@ -129,8 +298,8 @@ failure:
 	return -1;
 }
 
-const char *
-ni_systemctl_service_show_property(const char *service, const char *property, char **result)
+static const char *
+ni_systemctl_tool_show_property(const char *service, const char *property, char **result)
 {
 	const char *systemctl;
 	char *complete = NULL;
@@ -140,9 +309,6 @@ ni_systemctl_service_show_property(const char *service, const char *property, ch
 	ni_buffer_t buf;
 	int rv;
 
-	if (ni_string_empty(service) || ni_string_empty(property) || !result)
-		return NULL;
-
 	if (!ni_string_printf(&complete, "%s=", property))
 		return NULL;
 
@@ -204,3 +370,83 @@ failure:
 	ni_buffer_destroy(&buf);
 	return NULL;
 }
+
+/*
+ * systemd instance service methods
+ */
+int
+ni_systemctl_service_start(const char *service)
+{
+	int rv;
+
+	if (ni_string_empty(service))
+		return -1;
+
+	rv = ni_systemd_unit_method_call("StartUnit", service);
+	if (rv == NI_SYSTEMD_CALL_OK)
+		rv = ni_systemd_unit_wait(service, TRUE);
+	if (rv != NI_SYSTEMD_CALL_UNAVAILABLE)
+		return rv;
+
+	return ni_systemctl_tool_action("start", service);
+}
+
+int
+ni_systemctl_service_stop(const char *service)
+{
+	int rv;
+
+	if (ni_string_empty(service))
+		return -1;
+
+	rv = ni_systemd_unit_method_call("StopUnit", service);
+	if (rv == NI_SYSTEMD_CALL_OK)
+		rv = ni_systemd_unit_wait(service, FALSE);
+	if (rv != NI_SYSTEMD_CALL_UNAVAILABLE)
+		return rv;
+
+	return ni_systemctl_tool_action("stop", service);
+}
+
+/*
+ * Map the systemctl show property names our callers use to the dbus
+ * interface implementing them; anything unknown goes to the Service
+ * interface, where most of the show output lives.
+ */
+static const char *
+ni_systemd_property_interface(const char *property)
+{
+	static const char *	unit_properties[] = {
+		"ActiveState",
+		"SubState",
+		"LoadState",
+		"UnitFileState",
+		"Id",
+		NULL
+	};
+	const char **name;
+
+	for (name = unit_properties; *name; ++name) {
+		if (ni_string_eq(*name, property))
+			return NI_SYSTEMD_UNIT_INTERFACE;
+	}
+	return NI_SYSTEMD_SERVICE_INTERFACE;
+}
+
+const char *
+ni_systemctl_service_show_property(const char *service, const char *property, char **result)
+{
+	int rv;
+
+	if (ni_string_empty(service) || ni_string_empty(property) || !result)
+		return NULL;
+
+	rv = ni_systemd_unit_property_get(service,
+			ni_systemd_property_interface(property), property, result);
+	if (rv == NI_SYSTEMD_CALL_OK)
+		return *result;
+	if (rv == NI_SYSTEMD_CALL_FAILURE)
+		return NULL;
+
+	return ni_systemctl_tool_show_property(service, property, result);
+}
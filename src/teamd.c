@@ -28,7 +28,12 @@
 
 #include <limits.h>
 #include <pwd.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/poll.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <wicked/util.h>
 #include <wicked/dbus-service.h>
@@ -69,6 +74,21 @@
 #define NI_TEAMD_CALL_PORT_ADD			"PortAdd"
 #define NI_TEAMD_CALL_PORT_CONFIG_UPDATE	"PortConfigUpdate"
 
+/*
+ * teamd's unix control socket, as used by teamdctl --force-usock;
+ * see teamd_usock.h in the libteam sources for the wire format.
+ */
+#define NI_TEAMD_USOCK_FMT			NI_TEAMD_CONFIG_DIR"/%s.sock"
+#define NI_TEAMD_USOCK_REQUEST			"REQUEST"
+#define NI_TEAMD_USOCK_REPLY_SUCCESS		"REPLY_SUCCESS"
+#define NI_TEAMD_USOCK_REPLY_ERROR		"REPLY_ERROR"
+#define NI_TEAMD_USOCK_TIMEOUT			5000	/* msec */
+
+/* internal result codes of the usock call path */
+#define NI_TEAMD_USOCK_OK			0
+#define NI_TEAMD_USOCK_FAILURE			-1
+#define NI_TEAMD_USOCK_UNAVAILABLE		1
+
 
 typedef struct ni_teamd_client_ops {
 	void	(*destroy)(ni_teamd_client_t *);
@@ -90,6 +110,7 @@ struct ni_teamd_client {
 
 	/* unix */
 	ni_shellcmd_t *		cmd;
+	int			usock;
 };
 
 static inline const char *
@@ -321,6 +342,153 @@ ni_teamd_dbus_ctl_port_config_update(ni_teamd_client_t *tdc, const char *port_na
 	return rv;
 }
 
+/*
+ * === usock client ===
+ *
+ * Persistent connection to teamd's unix control socket, speaking the
+ * same line-based protocol as teamdctl --force-usock: a request is
+ * "REQUEST\n<method>\n" followed by one line per string argument, the
+ * reply starts with a "REPLY_SUCCESS" or "REPLY_ERROR" line.  When the
+ * channel cannot be used, the caller falls back to spawning teamdctl.
+ */
+static int
+ni_teamd_usock_connect(const char *instance)
+{
+	struct sockaddr_un sun;
+	int fd;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	if (snprintf(sun.sun_path, sizeof(sun.sun_path), NI_TEAMD_USOCK_FMT,
+				instance) >= (int)sizeof(sun.sun_path))
+		return -1;
+
+	if ((fd = socket(PF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+		return -1;
+
+	if (connect(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+		ni_debug_application("%s: cannot connect teamd socket %s: %m",
+				instance, sun.sun_path);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void
+ni_teamd_usock_disconnect(ni_teamd_client_t *tdc)
+{
+	if (tdc->usock >= 0) {
+		close(tdc->usock);
+		tdc->usock = -1;
+	}
+}
+
+/*
+ * Collect a complete reply; teamd sends it in one piece including the
+ * terminating NUL, so read until we see it (or give up).
+ */
+static int
+ni_teamd_usock_recv(int fd, ni_buffer_t *buf)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	ssize_t len;
+
+	for (;;) {
+		if (ni_buffer_count(buf) &&
+		    memchr(ni_buffer_head(buf), '\0', ni_buffer_count(buf)))
+			return 0;
+
+		switch (poll(&pfd, 1, NI_TEAMD_USOCK_TIMEOUT)) {
+		case -1:
+			if (errno == EINTR)
+				continue;
+			return -1;
+		case 0:
+			return -1;	/* reply timed out */
+		}
+
+		ni_buffer_ensure_tailroom(buf, 4096);
+		len = recv(fd, ni_buffer_tail(buf), ni_buffer_tailroom(buf), 0);
+		if (len < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			return -1;
+		}
+		if (len == 0)
+			return -1;	/* teamd closed the connection */
+		ni_buffer_push_tail(buf, len);
+	}
+}
+
+static int
+ni_teamd_usock_call_once(ni_teamd_client_t *tdc, const char *request, char **result)
+{
+	ni_buffer_t buf;
+	char *reply, *rest, *line;
+	int rv = NI_TEAMD_USOCK_UNAVAILABLE;
+
+	if (tdc->usock < 0 && (tdc->usock = ni_teamd_usock_connect(tdc->instance)) < 0)
+		return NI_TEAMD_USOCK_UNAVAILABLE;
+
+	if (send(tdc->usock, request, strlen(request) + 1, MSG_NOSIGNAL) < 0) {
+		ni_teamd_usock_disconnect(tdc);
+		return NI_TEAMD_USOCK_UNAVAILABLE;
+	}
+
+	ni_buffer_init_dynamic(&buf, 1024);
+	if (ni_teamd_usock_recv(tdc->usock, &buf) < 0) {
+		ni_teamd_usock_disconnect(tdc);
+		ni_buffer_destroy(&buf);
+		return NI_TEAMD_USOCK_UNAVAILABLE;
+	}
+
+	reply = rest = (char *)ni_buffer_head(&buf);
+	line = strsep(&rest, "\n");
+	if (ni_string_eq(line, NI_TEAMD_USOCK_REPLY_SUCCESS)) {
+		if (result)
+			ni_string_dup(result, rest ? rest : "");
+		rv = NI_TEAMD_USOCK_OK;
+	} else
+	if (ni_string_eq(line, NI_TEAMD_USOCK_REPLY_ERROR)) {
+		const char *err_name = rest ? strsep(&rest, "\n") : NULL;
+		const char *err_msg  = rest ? strsep(&rest, "\n") : NULL;
+
+		ni_debug_application("%s: teamd replied with error %s: %s",
+				tdc->instance, err_name, err_msg);
+		rv = NI_TEAMD_USOCK_FAILURE;
+	} else {
+		ni_debug_application("%s: unrecognized teamd reply '%s'",
+				tdc->instance, reply);
+		ni_teamd_usock_disconnect(tdc);
+	}
+	ni_buffer_destroy(&buf);
+	return rv;
+}
+
+static int
+ni_teamd_usock_call(ni_teamd_client_t *tdc, const char *method,
+		const char *arg1, const char *arg2, char **result)
+{
+	ni_stringbuf_t request = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_bool_t fresh = tdc->usock < 0;
+	int rv;
+
+	ni_stringbuf_printf(&request, "%s\n%s\n", NI_TEAMD_USOCK_REQUEST, method);
+	if (arg1)
+		ni_stringbuf_printf(&request, "%s\n", arg1);
+	if (arg2)
+		ni_stringbuf_printf(&request, "%s\n", arg2);
+
+	rv = ni_teamd_usock_call_once(tdc, request.string, result);
+	if (rv == NI_TEAMD_USOCK_UNAVAILABLE && !fresh) {
+		/* teamd may have been restarted since we connected */
+		rv = ni_teamd_usock_call_once(tdc, request.string, result);
+	}
+	ni_stringbuf_destroy(&request);
+	return rv;
+}
+
 /*
  * === unix client ===
  */
@@ -368,6 +536,7 @@ failure:
 void
 ni_teamd_unix_client_destroy(ni_teamd_client_t *tdc)
 {
+	ni_teamd_usock_disconnect(tdc);
 	ni_shellcmd_release(tdc->cmd);
 }
 
@@ -381,6 +550,12 @@ ni_teamd_unix_ctl_config_dump(ni_teamd_client_t *tdc, ni_bool_t actual, char **r
 	if (!result)
 		return -1;
 
+	rv = ni_teamd_usock_call(tdc, actual ?
+			NI_TEAMD_CALL_CONFIG_DUMP_ACTUAL : NI_TEAMD_CALL_CONFIG_DUMP,
+			NULL, NULL, result);
+	if (rv != NI_TEAMD_USOCK_UNAVAILABLE)
+		return rv;
+
 	ni_buffer_init_dynamic(&buf, 1024);
 	if (!(pi = ni_process_new(tdc->cmd)))
 		goto failure;
@@ -409,6 +584,55 @@ failure:
 	return -1;
 }
 
+int
+ni_teamd_unix_ctl_state_dump(ni_teamd_client_t *tdc, char **result)
+{
+	int rv;
+
+	if (!result)
+		return -1;
+
+	rv = ni_teamd_usock_call(tdc, NI_TEAMD_CALL_STATE_DUMP, NULL, NULL, result);
+	if (rv == NI_TEAMD_USOCK_UNAVAILABLE) {
+		ni_error("%s: unable to dump team state", tdc->instance);
+		rv = -1;
+	}
+	return rv;
+}
+
+int
+ni_teamd_unix_ctl_state_get_item(ni_teamd_client_t *tdc, const char *item_name, char **result)
+{
+	int rv;
+
+	if (ni_string_empty(item_name) || !result)
+		return -1;
+
+	rv = ni_teamd_usock_call(tdc, NI_TEAMD_CALL_STATE_ITEM_GET, item_name, NULL, result);
+	if (rv == NI_TEAMD_USOCK_UNAVAILABLE) {
+		ni_error("%s: unable to get team state item %s", tdc->instance, item_name);
+		rv = -1;
+	}
+	return rv;
+}
+
+int
+ni_teamd_unix_ctl_state_set_item(ni_teamd_client_t *tdc, const char *item_name, const char *item_val)
+{
+	int rv;
+
+	if (ni_string_empty(item_name))
+		return -1;
+
+	rv = ni_teamd_usock_call(tdc, NI_TEAMD_CALL_STATE_ITEM_SET,
+			item_name, item_val ? item_val : "", NULL);
+	if (rv == NI_TEAMD_USOCK_UNAVAILABLE) {
+		ni_error("%s: unable to set team state item %s", tdc->instance, item_name);
+		rv = -1;
+	}
+	return rv;
+}
+
 int
 ni_teamd_unix_ctl_port_add(ni_teamd_client_t *tdc, const char *port_name)
 {
@@ -418,6 +642,13 @@ ni_teamd_unix_ctl_port_add(ni_teamd_client_t *tdc, const char *port_name)
 	if (ni_string_empty(port_name))
 		return -1;
 
+	rv = ni_teamd_usock_call(tdc, NI_TEAMD_CALL_PORT_ADD, port_name, NULL, NULL);
+	if (rv != NI_TEAMD_USOCK_UNAVAILABLE) {
+		if (rv)
+			ni_error("%s: unable to add team port %s", tdc->instance, port_name);
+		return rv;
+	}
+
 	if (!(pi = ni_process_new(tdc->cmd)))
 		return -1;
 
@@ -443,6 +674,15 @@ ni_teamd_unix_ctl_port_config_update(ni_teamd_client_t *tdc, const char *port_na
 	if (!tdc || ni_string_empty(port_name))
 		return -1;
 
+	rv = ni_teamd_usock_call(tdc, NI_TEAMD_CALL_PORT_CONFIG_UPDATE,
+			port_name, port_conf ? port_conf : "", NULL);
+	if (rv != NI_TEAMD_USOCK_UNAVAILABLE) {
+		if (rv)
+			ni_error("%s: unable to update team port %s config",
+					tdc->instance, port_name);
+		return rv;
+	}
+
 	if (!(pi = ni_process_new(tdc->cmd)))
 		return -1;
 
@@ -477,6 +717,9 @@ static const ni_teamd_client_ops_t	teamd_dbus_ops = {
 static const ni_teamd_client_ops_t	teamd_unix_ops = {
 	.destroy		= ni_teamd_unix_client_destroy,
 	.ctl_config_dump	= ni_teamd_unix_ctl_config_dump,
+	.ctl_state_dump		= ni_teamd_unix_ctl_state_dump,
+	.ctl_state_get_item	= ni_teamd_unix_ctl_state_get_item,
+	.ctl_state_set_item	= ni_teamd_unix_ctl_state_set_item,
 	.ctl_port_add		= ni_teamd_unix_ctl_port_add,
 	.ctl_port_config_update	= ni_teamd_unix_ctl_port_config_update,
 };
@@ -557,6 +800,7 @@ ni_teamd_client_open(const char *instance)
 		return NULL;
 
 	tdc = xcalloc(1, sizeof(*tdc));
+	tdc->usock = -1;
 	ni_string_dup(&tdc->instance, instance);
 
 	ctl = ni_teamd_client_ctl_detect(instance, &busname);
@@ -8,23 +8,222 @@
 #endif
 
 #include <sys/time.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
+#include "socket_priv.h"
 #include "util_priv.h"
+#include "evstats.h"
+#include "stats.h"
+#include "flight.h"
 
 struct ni_timer {
-	ni_timer_t *		next;
 	unsigned int		ident;
+	unsigned int		heap_pos;	/* slot in ni_timer_heap */
 	struct timeval		expires;
 	ni_timeout_callback_t	*callback;
 	void *			user_data;
 };
 
-static ni_timer_t *		ni_timer_list;
+/*
+ * Armed timers live in a 4-ary min-heap ordered by expiry time, so
+ * arming is O(log n) and the earliest deadline is found in O(1).
+ * Each timer records its heap slot, which makes cancel/rearm cheap
+ * even with thousands of armed timers.
+ */
+#define	NI_TIMER_HEAP_ARITY	4
+#define	NI_TIMER_HEAP_CHUNK	64
+
+static ni_timer_t **		ni_timer_heap;
+static unsigned int		ni_timer_heap_count;
+static unsigned int		ni_timer_heap_size;
+
+/*
+ * Timer expiry is driven through a timerfd registered in the socket
+ * array. The timerfd is armed to the earliest deadline plus a small
+ * slack, so that bursts of near-simultaneous timers (e.g. DHCP renews
+ * across many interfaces) collapse into a single wakeup and a single
+ * batch of callback dispatches.
+ */
+#define	NI_TIMER_SLACK_MSEC	50
+
+static ni_socket_t *		ni_timer_sock;
+static unsigned int		ni_timer_slack_msec = NI_TIMER_SLACK_MSEC;
+static ni_bool_t		ni_timer_sock_failed;
+
+void
+ni_timer_set_slack(unsigned int msec)
+{
+	ni_timer_slack_msec = msec;
+}
+
+static void
+__ni_timer_sock_receive(ni_socket_t *sock)
+{
+	uint64_t expirations;
+
+	/* Just drain the expiration count; the expired timers are
+	 * dispatched from ni_timer_next_timeout() in the main loop. */
+	if (read(sock->__fd, &expirations, sizeof(expirations)) < 0 &&
+	    errno != EAGAIN && errno != EINTR)
+		ni_error("unable to read timerfd: %m");
+}
+
+static ni_bool_t
+__ni_timer_sock_open(void)
+{
+	int fd;
+
+	if (ni_timer_sock)
+		return TRUE;
+	if (ni_timer_sock_failed)
+		return FALSE;
+
+	fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_TIMER,
+				"timerfd_create failed (%m), using poll timeouts");
+		ni_timer_sock_failed = TRUE;
+		return FALSE;
+	}
+
+	ni_timer_sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	ni_timer_sock->receive = __ni_timer_sock_receive;
+	return TRUE;
+}
+
+static void
+__ni_timer_sock_arm(const struct timeval *expires)
+{
+	struct itimerspec its;
+	long long nsec;
+
+	memset(&its, 0, sizeof(its));
+	nsec = expires->tv_usec * 1000LL + ni_timer_slack_msec * 1000000LL;
+	its.it_value.tv_sec = expires->tv_sec + nsec / 1000000000LL;
+	its.it_value.tv_nsec = nsec % 1000000000LL;
+
+	if (timerfd_settime(ni_timer_sock->__fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		ni_error("timerfd_settime failed: %m");
+		return;
+	}
+	if (!ni_timer_sock->active)
+		ni_socket_activate(ni_timer_sock);
+}
+
+static void
+__ni_timer_sock_disarm(void)
+{
+	struct itimerspec its;
+
+	if (!ni_timer_sock || !ni_timer_sock->active)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	timerfd_settime(ni_timer_sock->__fd, 0, &its, NULL);
+	ni_socket_deactivate(ni_timer_sock);
+}
 
 static void			__ni_timer_arm(ni_timer_t *, unsigned long);
 static ni_timer_t *		__ni_timer_disarm(const ni_timer_t *);
 
+static void
+__ni_timer_set_expires(ni_timer_t *timer, unsigned long timeout)
+{
+	ni_timer_get_time(&timer->expires);
+	timer->expires.tv_sec += timeout / 1000;
+	timer->expires.tv_usec += (timeout % 1000) * 1000;
+	if (timer->expires.tv_usec >= 1000000) {
+		timer->expires.tv_sec++;
+		timer->expires.tv_usec -= 1000000;
+	}
+}
+
+static inline void
+__ni_timer_heap_set(unsigned int pos, ni_timer_t *timer)
+{
+	ni_timer_heap[pos] = timer;
+	timer->heap_pos = pos;
+}
+
+static void
+__ni_timer_heap_sift_up(unsigned int pos)
+{
+	ni_timer_t *timer = ni_timer_heap[pos];
+
+	while (pos > 0) {
+		unsigned int parent = (pos - 1) / NI_TIMER_HEAP_ARITY;
+
+		if (!timercmp(&timer->expires, &ni_timer_heap[parent]->expires, <))
+			break;
+		__ni_timer_heap_set(pos, ni_timer_heap[parent]);
+		pos = parent;
+	}
+	__ni_timer_heap_set(pos, timer);
+}
+
+static void
+__ni_timer_heap_sift_down(unsigned int pos)
+{
+	ni_timer_t *timer = ni_timer_heap[pos];
+
+	while (TRUE) {
+		unsigned int child = pos * NI_TIMER_HEAP_ARITY + 1;
+		unsigned int last, least;
+
+		if (child >= ni_timer_heap_count)
+			break;
+
+		last = child + NI_TIMER_HEAP_ARITY - 1;
+		if (last >= ni_timer_heap_count)
+			last = ni_timer_heap_count - 1;
+
+		for (least = child++; child <= last; ++child) {
+			if (timercmp(&ni_timer_heap[child]->expires,
+				     &ni_timer_heap[least]->expires, <))
+				least = child;
+		}
+
+		if (!timercmp(&ni_timer_heap[least]->expires, &timer->expires, <))
+			break;
+		__ni_timer_heap_set(pos, ni_timer_heap[least]);
+		pos = least;
+	}
+	__ni_timer_heap_set(pos, timer);
+}
+
+static void
+__ni_timer_heap_insert(ni_timer_t *timer)
+{
+	if (ni_timer_heap_count >= ni_timer_heap_size) {
+		ni_timer_heap_size += NI_TIMER_HEAP_CHUNK;
+		ni_timer_heap = xrealloc(ni_timer_heap,
+				ni_timer_heap_size * sizeof(ni_timer_t *));
+	}
+	__ni_timer_heap_set(ni_timer_heap_count++, timer);
+	__ni_timer_heap_sift_up(timer->heap_pos);
+}
+
+static void
+__ni_timer_heap_remove(ni_timer_t *timer)
+{
+	unsigned int pos = timer->heap_pos;
+
+	ni_timer_heap_count--;
+	if (pos != ni_timer_heap_count) {
+		ni_timer_t *moved = ni_timer_heap[ni_timer_heap_count];
+
+		__ni_timer_heap_set(pos, moved);
+		__ni_timer_heap_sift_up(pos);
+		__ni_timer_heap_sift_down(moved->heap_pos);
+	}
+	ni_timer_heap[ni_timer_heap_count] = NULL;
+	timer->heap_pos = -1U;
+}
+
 const ni_timer_t *
 ni_timer_register(unsigned long timeout, ni_timeout_callback_t *callback, void *data)
 {
@@ -64,32 +263,56 @@ ni_timer_cancel(const ni_timer_t *handle)
 const ni_timer_t *
 ni_timer_rearm(const ni_timer_t *handle, unsigned long timeout)
 {
-	 ni_timer_t *timer;
+	unsigned int pos;
+	ni_timer_t *timer;
 
-	 if ((timer = __ni_timer_disarm(handle)) != NULL)
-		 __ni_timer_arm(timer, timeout);
-	 else
+	/*
+	 * Rearm in place: update the expiry and restore the heap order
+	 * with a single sift from the timer's current slot instead of
+	 * paying a full remove and reinsert.  Retransmit backoff (the
+	 * DHCP RT doubling) rearms the same timer over and over, which
+	 * makes this the hottest timer operation under a solicit storm.
+	 */
+	if (handle && (pos = handle->heap_pos) < ni_timer_heap_count
+	 && (timer = ni_timer_heap[pos]) == handle) {
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
-				"%s: timer %p NOT found", __func__, handle);
-	 return timer;
+				"%s: timer %p timeout %lu", __func__, timer, timeout);
+		__ni_timer_set_expires(timer, timeout);
+		__ni_timer_heap_sift_up(pos);
+		__ni_timer_heap_sift_down(timer->heap_pos);
+		return timer;
+	}
+	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
+			"%s: timer %p NOT found", __func__, handle);
+	return NULL;
 }
 
 long
 ni_timer_next_timeout(void)
 {
 	struct timeval now, delta;
+	struct timespec stamp;
 	ni_timer_t *timer;
+	uint64_t usec;
 	long timeout;
 
 	ni_timer_get_time(&now);
-	while ((timer = ni_timer_list) != NULL) {
+	while (ni_timer_heap_count != 0) {
+		timer = ni_timer_heap[0];
 		if (!timercmp(&timer->expires, &now, <)) {
 			timersub(&timer->expires, &now, &delta);
 			timeout = delta.tv_sec * 1000 + delta.tv_usec / 1000;
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 					"%s: timer %p timeout %ld", __func__, timer, timeout);
-			if (timeout > 0)
+			if (timeout > 0) {
+				if (__ni_timer_sock_open()) {
+					/* Sleep on the timerfd instead; the slack
+					 * lets nearby deadlines share one wakeup. */
+					__ni_timer_sock_arm(&timer->expires);
+					return -1;
+				}
 				return timeout;
+			}
 		}
 
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
@@ -97,51 +320,41 @@ ni_timer_next_timeout(void)
 				__func__, timer,
 				(long) now.tv_sec, (long) now.tv_usec,
 				(long) timer->expires.tv_sec, (long) timer->expires.tv_usec);
-		ni_timer_list = timer->next;
+		__ni_timer_heap_remove(timer);
+		ni_stats_inc(NI_STAT_TIMERS_FIRED);
+		ni_flight_record(NI_FLIGHT_TIMER, timer->ident, 0, NULL);
+		ni_evstats_stamp(&stamp);
 		timer->callback(timer->user_data, timer);
+		usec = ni_evstats_record(NI_EVSTAT_TIMER, &stamp);
+		ni_evstats_stall_check(usec, "timer callback %p", timer->callback);
 		free(timer);
 	}
 
+	__ni_timer_sock_disarm();
 	return -1;
 }
 
 static void
 __ni_timer_arm(ni_timer_t *timer, unsigned long timeout)
 {
-	ni_timer_t *tail, **pos;
-
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 			"%s: timer %p timeout %lu", __func__, timer, timeout);
-	ni_timer_get_time(&timer->expires);
-	timer->expires.tv_sec += timeout / 1000;
-	timer->expires.tv_usec += (timeout % 1000) * 1000;
-	if (timer->expires.tv_usec >= 1000000) {
-		timer->expires.tv_sec++;
-		timer->expires.tv_usec -= 1000000;
-	}
-
-	for (pos = &ni_timer_list; (tail = *pos) != NULL; pos = &tail->next) {
-		if (timercmp(&timer->expires, &tail->expires, <))
-			break;
-	}
-
-	timer->next = tail;
-	*pos = timer;
+	__ni_timer_set_expires(timer, timeout);
+	__ni_timer_heap_insert(timer);
 }
 
 static ni_timer_t *
 __ni_timer_disarm(const ni_timer_t *handle)
 {
-	ni_timer_t **pos, *timer;
+	unsigned int pos;
+	ni_timer_t *timer;
 
-	for (pos = &ni_timer_list; (timer = *pos) != NULL; pos = &timer->next) {
-		if (timer == handle) {
-			*pos = timer->next;
-			timer->next = NULL;
-			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
-					"%s: timer %p found", __func__, handle);
-			return timer;
-		}
+	if (handle && (pos = handle->heap_pos) < ni_timer_heap_count
+	 && (timer = ni_timer_heap[pos]) == handle) {
+		__ni_timer_heap_remove(timer);
+		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
+				"%s: timer %p found", __func__, handle);
+		return timer;
 	}
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 			"%s: timer %p NOT found", __func__, handle);
@@ -151,10 +364,26 @@ __ni_timer_disarm(const ni_timer_t *handle)
 int
 ni_timer_get_time(struct timeval *tv)
 {
+	static int use_coarse = -1;
+	struct timespec ts;
+
 	/*
 	 * The wallclock time has to be used because leases are stored on disk.
 	 * Using CLOCK_BOOTTIME is the alternative without persistant leases.
+	 *
+	 * The coarse clock returns the wallclock at timer tick granularity
+	 * from the vdso without entering the kernel, which is plenty for
+	 * lease and retransmit timekeeping on the hot paths.
 	 */
+	if (use_coarse) {
+		if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0) {
+			use_coarse = 1;
+			tv->tv_sec = ts.tv_sec;
+			tv->tv_usec = ts.tv_nsec / 1000;
+			return 0;
+		}
+		use_coarse = 0;
+	}
 	return gettimeofday(tv, NULL);
 }
 
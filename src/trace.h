@@ -0,0 +1,30 @@
+/*
+ * Static tracepoints (USDT probes) for the wicked daemons.
+ *
+ * When <sys/sdt.h> is available at build time, the daemon hot paths
+ * carry probes in the "wicked" provider that bpftrace, perf or
+ * systemtap can attach to on a production system without enabling
+ * debug logging. Without the header, the macros compile to nothing.
+ *
+ * Copyright (C) 2012 SUSE LINUX Products GmbH, Nuernberg, Germany.
+ */
+
+#ifndef __WICKED_TRACE_PROBE_H__
+#define __WICKED_TRACE_PROBE_H__
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define ni_tracepoint1(name, a1)		DTRACE_PROBE1(wicked, name, a1)
+#define ni_tracepoint2(name, a1, a2)		DTRACE_PROBE2(wicked, name, a1, a2)
+#define ni_tracepoint3(name, a1, a2, a3)	DTRACE_PROBE3(wicked, name, a1, a2, a3)
+
+#else
+
+#define ni_tracepoint1(name, a1)		do { } while (0)
+#define ni_tracepoint2(name, a1, a2)		do { } while (0)
+#define ni_tracepoint3(name, a1, a2, a3)	do { } while (0)
+
+#endif /* HAVE_SYS_SDT_H */
+
+#endif /* __WICKED_TRACE_PROBE_H__ */
@@ -35,6 +35,7 @@
 #include <wicked/netinfo.h>
 
 #include "udev-utils.h"
+#include "util_priv.h"
 #include "process.h"
 #include "buffer.h"
 #include "sysfs.h"
@@ -52,6 +53,73 @@ struct netdev_uinfo {
 	const char *	tags;
 };
 
+/*
+ * Per-ifindex cache of the udev properties the readiness check needs.
+ *
+ * Filled from udevadm query results and kept up to date by the uevent
+ * stream (see __ni_uevent_ifevent_forwarder), so that repeated
+ * discovery passes don't have to fork a udevadm per device.
+ */
+struct netdev_ucache {
+	struct netdev_ucache *	next;
+	unsigned int		ifindex;
+	char *			interface;
+	char *			interface_old;
+	char *			tags;
+};
+
+static struct netdev_ucache *	__ni_udev_netdev_cache;
+
+static struct netdev_ucache *
+__ni_udev_netdev_cache_get(unsigned int ifindex, ni_bool_t create)
+{
+	struct netdev_ucache **pos, *entry;
+
+	for (pos = &__ni_udev_netdev_cache; (entry = *pos); pos = &entry->next) {
+		if (entry->ifindex == ifindex)
+			return entry;
+	}
+	if (!create)
+		return NULL;
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->ifindex = ifindex;
+	*pos = entry;
+	return entry;
+}
+
+void
+ni_udev_netdev_cache_update(unsigned int ifindex, const char *interface,
+		const char *interface_old, const char *tags)
+{
+	struct netdev_ucache *entry;
+
+	if (!ifindex)
+		return;
+
+	entry = __ni_udev_netdev_cache_get(ifindex, TRUE);
+	ni_string_dup(&entry->interface, interface);
+	ni_string_dup(&entry->interface_old, interface_old);
+	ni_string_dup(&entry->tags, tags);
+}
+
+void
+ni_udev_netdev_cache_forget(unsigned int ifindex)
+{
+	struct netdev_ucache **pos, *entry;
+
+	for (pos = &__ni_udev_netdev_cache; (entry = *pos); pos = &entry->next) {
+		if (entry->ifindex == ifindex) {
+			*pos = entry->next;
+			ni_string_free(&entry->interface);
+			ni_string_free(&entry->interface_old);
+			ni_string_free(&entry->tags);
+			free(entry);
+			return;
+		}
+	}
+}
+
 
 static const char *
 ni_udevadm_tool_path()
@@ -274,6 +342,9 @@ netdev_uinfo_ready(const ni_var_array_t *vars, const char *ifname, unsigned int
 		return -1;	/* huh? not a net subsystem?! */
 	}
 
+	ni_udev_netdev_cache_update(uinfo.ifindex, uinfo.interface,
+			uinfo.interface_old, uinfo.tags);
+
 	if (uinfo.ifindex != ifindex || !ni_string_eq(uinfo.interface, ifname)) {
 		ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
 				"%s[%u] udev info: ifname %s or ifindex %u differ",
@@ -321,6 +392,30 @@ ni_udev_netdev_update_name(ni_netdev_t *dev)
 	return 0;
 }
 
+/*
+ * Evaluate readiness from the cached udev properties; returns -1 when
+ * the cache has nothing usable and udevadm has to be asked.
+ */
+static int
+netdev_ucache_ready(const ni_netdev_t *dev)
+{
+	const struct netdev_ucache *entry;
+
+	if (!(entry = __ni_udev_netdev_cache_get(dev->link.ifindex, FALSE)))
+		return -1;	/* nothing cached yet */
+
+	if (!ni_string_eq(entry->interface, dev->name))
+		return -1;	/* rename in flight, re-query */
+
+	if (entry->interface_old)
+		return 1;	/* not ready, expect rename event to arrive */
+
+	if (entry->tags && strstr(entry->tags, ":systemd:"))
+		return 0;	/* only systemd-udevd sets tags */
+
+	return 1;
+}
+
 ni_bool_t
 ni_udev_netdev_is_ready(ni_netdev_t *dev)
 {
@@ -328,6 +423,18 @@ ni_udev_netdev_is_ready(ni_netdev_t *dev)
 	ni_var_array_t *vars = NULL;
 	int ret, retry = 2;
 
+	if (ni_udev_netdev_update_name(dev) < 0)
+		return FALSE;
+
+	switch (netdev_ucache_ready(dev)) {
+	case 0:
+		return TRUE;
+	case 1:
+		return FALSE;
+	default:
+		break;
+	}
+
 	do {
 		/*
 		 * we're called to bootstrap before events listeners
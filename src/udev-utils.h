@@ -31,4 +31,8 @@ extern ni_bool_t		ni_udev_is_active(void);
 extern ni_bool_t		ni_udev_net_subsystem_available(void);
 extern ni_bool_t		ni_udev_netdev_is_ready(ni_netdev_t *);
 
+extern void			ni_udev_netdev_cache_update(unsigned int,
+						const char *, const char *, const char *);
+extern void			ni_udev_netdev_cache_forget(unsigned int);
+
 #endif /* WICKED_UDEV_UTILS_H */
@@ -58,6 +58,7 @@
 #include "netinfo_priv.h"
 #include "socket_priv.h"
 #include "uevent.h"
+#include "udev-utils.h"
 #include "appconfig.h"
 
 
@@ -392,26 +393,33 @@ ni_uevent_monitor_filter_apply(ni_uevent_monitor_t *mon)
 	unsigned int i, at;
 
 	/*
-	if (!mon->sub_filter.count && !mon->tag_filter.count)
+	 * The pre-hashed filter fields only exist in the libudev message
+	 * header; kernel uevents carry the properties as a plain string
+	 * blob, which classic BPF cannot scan, so those monitors have to
+	 * match in userspace.
+	 */
+	if (mon->addr.nl_groups != NI_UEVENT_NLGRP_UDEV)
 		return 0;
-	*/
 
 	at = 0;
 	memset(&ins, 0, sizeof(ins));
 
+	i = 3 + (mon->tag_filter.count * 6) + 1
+	      + (mon->sub_filter.count * 5) + 1 + 1;
+	if (i >= sizeof(ins)/sizeof(ins[0]))
+		return -1;
+
 	/* load magic in A */
 	bpf_stmt(ins, &at, BPF_LD|BPF_W|BPF_ABS,
 			offsetof(struct __ni_uevent_nlhdr, magic));
 	/* jump if magic matches */
 	bpf_jump(ins, &at, BPF_JMP|BPF_JEQ|BPF_K, NI_UEVENT_UDEV_MAGIC, 1, 0);
-	/* wrong magic, pass packet -- this allows us to complain in receive */
-	bpf_stmt(ins, &at, BPF_RET|BPF_K, 0xffffffff);
-
-	i = at + 2;
-	i = (mon->tag_filter.count * 6) + 1;
-	i = (mon->sub_filter.count * 5) + 1;
-	if (i >= sizeof(ins)/sizeof(ins[0]))
-		return -1;
+	/*
+	 * wrong magic, drop packet -- on the udev group everything
+	 * legitimate carries the magic, and passing the rest just to
+	 * complain in receive means a wakeup for every foreign message
+	 */
+	bpf_stmt(ins, &at, BPF_RET|BPF_K, 0);
 
 	if (mon->tag_filter.count) {
 		unsigned int tag_matches = mon->tag_filter.count;
@@ -551,7 +559,7 @@ ni_uevent_monitor_new(unsigned int group, ni_uevent_callback_t *user_func, void
 		ni_error("Cannot wrap uevent netlink socket: %m");
 		return NULL;
 	}
-
+	mon->sock->priority	= NI_SOCKET_PRIO_BULK;
 	mon->sock->user_data	= mon;
 	mon->sock->receive	= __ni_uevent_monitor_receive;
 	mon->addr.nl_family	= AF_NETLINK;
@@ -589,14 +597,16 @@ __ni_uevent_ifevent_forwarder(const ni_var_array_t *vars, void *user_data)
 	unsigned int i;
 	const ni_var_t *var;
 	enum {
-		UDEV_ACTION_SKIP = 0,
-		UDEV_ACTION_ADD  = 1,
-		UDEV_ACTION_MOVE = 2,
+		UDEV_ACTION_SKIP   = 0,
+		UDEV_ACTION_ADD    = 1,
+		UDEV_ACTION_MOVE   = 2,
+		UDEV_ACTION_REMOVE = 3,
 	};
 	static ni_intmap_t      __action_map[] = {
-		{ "add",	UDEV_ACTION_ADD  },
-		{ "move",	UDEV_ACTION_MOVE },
-		{ NULL,		UDEV_ACTION_SKIP }
+		{ "add",	UDEV_ACTION_ADD    },
+		{ "move",	UDEV_ACTION_MOVE   },
+		{ "remove",	UDEV_ACTION_REMOVE },
+		{ NULL,		UDEV_ACTION_SKIP   }
 	};
 	struct {
 		ni_bool_t       subsystem;
@@ -649,6 +659,13 @@ __ni_uevent_ifevent_forwarder(const ni_var_array_t *vars, void *user_data)
 	if (!uinfo.subsystem || uinfo.action == UDEV_ACTION_SKIP || !uinfo.ifindex)
 		return;
 
+	if (uinfo.action == UDEV_ACTION_REMOVE) {
+		ni_udev_netdev_cache_forget(uinfo.ifindex);
+		return;
+	}
+	ni_udev_netdev_cache_update(uinfo.ifindex, uinfo.interface,
+			uinfo.interface_old, uinfo.tags);
+
 	dev = ni_netdev_by_index(nc, uinfo.ifindex);
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
 			"UEVENT(%s) ACTION: %s, IFINDEX=%u, NAME=%s, PREV=%s, TAGS=%s",
@@ -671,8 +688,10 @@ __ni_uevent_ifevent_forwarder(const ni_var_array_t *vars, void *user_data)
 		if (!(ifname = if_indextoname(dev->link.ifindex, namebuf)))
 			return; /* device gone in the meantime */
 
-		if (!ni_string_eq(dev->name, ifname))
+		if (!ni_string_eq(dev->name, ifname)) {
 			ni_string_dup(&dev->name, ifname);
+			__ni_netconfig_index_invalidate(nc);
+		}
 
 		dev->link.ifflags |= NI_IFF_DEVICE_READY;
 		__ni_netdev_process_events(nc, dev, old_flags);
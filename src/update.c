@@ -8,6 +8,7 @@
 #endif
 
 #include <unistd.h>
+#include <sys/time.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
@@ -36,6 +37,19 @@
 #define	NI_UPDATER_SOURCE_ARRAY_CHUNK	4
 #define	NI_UPDATER_SOURCE_ARRAY_INIT	{ 0, NULL }
 
+/* msecs without new lease changes before a batch update runs */
+#ifndef NI_UPDATER_BATCH_QUIET_MSEC
+#define NI_UPDATER_BATCH_QUIET_MSEC	200
+#endif
+/* msecs a batch update may be deferred at most */
+#ifndef NI_UPDATER_BATCH_DELAY_MSEC
+#define NI_UPDATER_BATCH_DELAY_MSEC	2000
+#endif
+
+/* updater extension protocol environment variables */
+#define NI_UPDATER_DELTA_ENVVAR		"WICKED_UPDATER_DELTA"
+#define NI_UPDATER_DELTA_FILE_ENVVAR	"WICKED_UPDATER_DELTA_FILE"
+
 typedef struct ni_updater_source	ni_updater_source_t;
 struct ni_updater_source {
 	unsigned int			refcount;
@@ -107,6 +121,12 @@ struct ni_updater {
 	ni_shellcmd_t *			proc_install;
 	ni_shellcmd_t *			proc_remove;
 	ni_shellcmd_t *			proc_batch;
+
+	struct {
+		struct timeval		since;	/* oldest deferred job	*/
+		struct timeval		quiet;	/* last new job seen	*/
+		unsigned long		seen;	/* job counter watermark*/
+	} debounce;
 };
 
 static ni_updater_t			updaters[__NI_ADDRCONF_UPDATER_MAX];
@@ -126,6 +146,7 @@ static const ni_intmap_t		ni_updater_kind_names[] = {
 };
 
 static ni_bool_t			ni_system_updater_generic_batch_test(ni_updater_t *);
+static void				ni_updater_job_set_timeout(ni_updater_job_t *, unsigned int);
 
 /*
  * Get the name of an updater
@@ -617,6 +638,24 @@ ni_system_updaters_init(void)
 				"system-updater %s configured, but no backup/restore script defined", name);
 			updater->proc_backup = updater->proc_restore = NULL;
 		}
+
+		if (updater->enabled) {
+			unsigned int i;
+
+			/* export <putenv> vars from the extension config to
+			 * all updater scripts */
+			for (i = 0; i < ex->environment.count; ++i) {
+				const ni_var_t *var = &ex->environment.data[i];
+
+				ni_extension_script_setenv(ex, var->name, var->value);
+			}
+
+			/* announce that install/remove calls provide per-run
+			 * delta input files along with the full state file */
+			if (kind == NI_ADDRCONF_UPDATER_RESOLVER)
+				ni_extension_script_setenv(ex,
+						NI_UPDATER_DELTA_ENVVAR, "supported");
+		}
 	}
 }
 
@@ -701,7 +740,8 @@ ni_system_updater_notify(ni_process_t *pi)
 }
 
 static int
-ni_system_updater_run(ni_updater_job_t *job, ni_shellcmd_t *shellcmd, ni_string_array_t *args)
+ni_system_updater_run(ni_updater_job_t *job, ni_shellcmd_t *shellcmd, ni_string_array_t *args,
+			const ni_var_array_t *env)
 {
 	ni_process_t *pi;
 	int rv;
@@ -724,6 +764,16 @@ ni_system_updater_run(ni_updater_job_t *job, ni_shellcmd_t *shellcmd, ni_string_
 		}
 	}
 
+	if (env) {
+		unsigned int i;
+
+		for (i = 0; i < env->count; ++i) {
+			const ni_var_t *var = &env->data[i];
+
+			ni_process_setenv(pi, var->name, var->value);
+		}
+	}
+
 	rv = ni_process_run(pi);
 	if (rv == NI_PROCESS_SUCCESS) {
 		job->process = pi;
@@ -790,7 +840,7 @@ ni_system_updater_backup_call(ni_updater_t *updater, ni_updater_job_t *job)
 	if (!updater->proc_backup)
 		return 0;
 
-	if (ni_system_updater_run(job, updater->proc_backup, NULL) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_backup, NULL, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_backup->command,
@@ -831,7 +881,7 @@ ni_system_updater_restore_call(ni_updater_t *updater, ni_updater_job_t *job)
 	if (!updater->proc_restore)
 		return 0;
 
-	if (ni_system_updater_run(job, updater->proc_restore, NULL) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_restore, NULL, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_restore->command,
@@ -896,7 +946,7 @@ ni_system_updater_generic_cleanup_call(ni_updater_t *updater, ni_updater_job_t *
 		ni_leaseinfo_remove(src->device.name, src->lease.type, src->lease.family);
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove, &args, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to cleanup %s updater (%s) for lease %s:%s in state %s",
 				src->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -1101,6 +1151,50 @@ cleanup:
 	return ret;
 }
 
+/*
+ * Debounce stage for batched updates: lease changes tend to arrive in
+ * bursts (a boot acquiring dhcp on many interfaces), so defer the batch
+ * for a quiet period while new jobs keep joining -- each deferred job
+ * stays pending and gets merged into the one batch run -- but never
+ * longer than NI_UPDATER_BATCH_DELAY_MSEC altogether.
+ */
+static int
+ni_system_updater_batch_debounce(ni_updater_t *updater, ni_updater_job_t *job)
+{
+	struct timeval now, delta;
+
+	ni_timer_get_time(&now);
+
+	if (!timerisset(&updater->debounce.since)) {
+		updater->debounce.since = now;
+		updater->debounce.quiet = now;
+		updater->debounce.seen = job_nr;
+	} else
+	if (updater->debounce.seen != job_nr) {
+		/* new lease changes arrived; restart the quiet period */
+		updater->debounce.seen = job_nr;
+		updater->debounce.quiet = now;
+	}
+
+	timersub(&now, &updater->debounce.since, &delta);
+	if (delta.tv_sec * 1000 + delta.tv_usec / 1000 >= NI_UPDATER_BATCH_DELAY_MSEC)
+		goto flush;
+
+	timersub(&now, &updater->debounce.quiet, &delta);
+	if (delta.tv_sec * 1000 + delta.tv_usec / 1000 >= NI_UPDATER_BATCH_QUIET_MSEC)
+		goto flush;
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+			"%s: deferring %s batch update for more lease changes",
+			job->device.name, ni_updater_name(updater->kind));
+	ni_updater_job_set_timeout(job, NI_UPDATER_BATCH_QUIET_MSEC);
+	return 1;
+
+flush:
+	timerclear(&updater->debounce.since);
+	return 0;
+}
+
 static int
 ni_system_updater_generic_batch_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
@@ -1114,6 +1208,9 @@ ni_system_updater_generic_batch_call(ni_updater_t *updater, ni_updater_job_t *jo
 	if (!updater->proc_batch || !updater->proc_batch->command)
 		return -1;
 
+	if (ni_system_updater_batch_debounce(updater, job))
+		return 1;
+
 	ident = ni_basename(updater->proc_batch->command);
 	pi = ni_system_updater_generic_batch_create(updater, &filename, &out);
 	if (!pi) {
@@ -1211,7 +1308,7 @@ ni_system_updater_generic_install_call(ni_updater_t *updater, ni_updater_job_t *
 		goto cleanup;
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_install, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_install, &args, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_install->command,
@@ -1263,7 +1360,7 @@ ni_system_updater_generic_remove_call(ni_updater_t *updater, ni_updater_job_t *j
 	}
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove, &args, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -1285,6 +1382,74 @@ ni_system_updater_generic_remove_wait(ni_updater_t *updater, ni_updater_job_t *j
 	return ni_system_updater_generic_wait(updater, job);
 }
 
+/*
+ * Per-run delta input files for netconfig-style backends
+ *
+ * Each line records one change relative to the state file we installed
+ * in the previous run: "+<keyword> <value>" for additions, "-<keyword>
+ * <value>" for removals. Backends that understand the delta can apply
+ * the incremental change instead of recomputing the merged state from
+ * all per-lease files; the full state file remains authoritative.
+ */
+static void
+ni_system_updater_delta_dump(FILE *out, const char *keyword,
+		const ni_string_array_t *cur, const ni_string_array_t *old)
+{
+	unsigned int i;
+
+	for (i = 0; cur && i < cur->count; ++i) {
+		if (!old || ni_string_array_index(old, cur->data[i]) < 0)
+			fprintf(out, "+%s %s\n", keyword, cur->data[i]);
+	}
+	for (i = 0; old && i < old->count; ++i) {
+		if (!cur || ni_string_array_index(cur, old->data[i]) < 0)
+			fprintf(out, "-%s %s\n", keyword, old->data[i]);
+	}
+}
+
+static ni_bool_t
+ni_system_updater_resolver_delta_create(const char *filename,
+		const ni_resolver_info_t *info, char **deltafile)
+{
+	ni_resolver_info_t *old = NULL;
+	const char *old_domain;
+	const char *new_domain;
+	FILE *out;
+
+	if (!ni_string_printf(deltafile, "%s.delta", filename))
+		return FALSE;
+
+	if (ni_file_exists(filename))
+		old = ni_resolver_parse_resolv_conf(filename);
+
+	if (!(out = fopen(*deltafile, "we"))) {
+		ni_warn("unable to open resolver delta file %s for writing: %m",
+				*deltafile);
+		ni_resolver_info_free(old);
+		ni_string_free(deltafile);
+		return FALSE;
+	}
+
+	old_domain = old  ? old->default_domain  : NULL;
+	new_domain = info ? info->default_domain : NULL;
+	if (!ni_string_eq(old_domain, new_domain)) {
+		if (old_domain)
+			fprintf(out, "-domain %s\n", old_domain);
+		if (new_domain)
+			fprintf(out, "+domain %s\n", new_domain);
+	}
+	ni_system_updater_delta_dump(out, "nameserver",
+			info ? &info->dns_servers : NULL,
+			old  ? &old->dns_servers  : NULL);
+	ni_system_updater_delta_dump(out, "search",
+			info ? &info->dns_search  : NULL,
+			old  ? &old->dns_search   : NULL);
+
+	fclose(out);
+	ni_resolver_info_free(old);
+	return TRUE;
+}
+
 /*
  * Resolver updater specific calls
  */
@@ -1305,8 +1470,10 @@ static int
 ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
 	ni_string_array_t args = NI_STRING_ARRAY_INIT;
+	ni_var_array_t env = NI_VAR_ARRAY_INIT;
 	const char *statedir;
 	char *filename = NULL;
+	char *deltafile = NULL;
 	int ret = -1;
 
 	if (!ni_system_updater_common_args(&args, job->device.name,
@@ -1332,6 +1499,12 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 	}
 	ni_string_array_append(&args, filename);
 
+	/* diff against the state file of the previous run before it
+	 * gets replaced below */
+	if (ni_system_updater_resolver_delta_create(filename,
+				job->lease->resolver, &deltafile))
+		ni_var_array_set(&env, NI_UPDATER_DELTA_FILE_ENVVAR, deltafile);
+
 	if (ni_resolver_write_resolv_conf(filename, job->lease->resolver, NULL) < 0) {
 		ni_error("%s: unable to write %s updater resolv.conf file %s: %m",
 				job->device.name, ni_updater_name(updater->kind),
@@ -1340,7 +1513,7 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 	}
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_install, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_install, &args, &env) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_install->command,
@@ -1355,7 +1528,9 @@ ni_system_updater_resolver_install_call(ni_updater_t *updater, ni_updater_job_t
 	ret = 0; /* started, advance to wait for finish */
 
 cleanup:
+	ni_string_free(&deltafile);
 	ni_string_free(&filename);
+	ni_var_array_destroy(&env);
 	ni_string_array_destroy(&args);
 	return ret;
 }
@@ -1377,7 +1552,11 @@ static int
 ni_system_updater_resolver_remove_call(ni_updater_t *updater, ni_updater_job_t *job)
 {
 	ni_string_array_t args = NI_STRING_ARRAY_INIT;
+	ni_var_array_t env = NI_VAR_ARRAY_INIT;
 	ni_updater_source_t *src;
+	const char *statedir;
+	char *filename = NULL;
+	char *deltafile = NULL;
 	int ret = -1;
 
 	/* Call remove action only, when we applied it */
@@ -1390,8 +1569,24 @@ ni_system_updater_resolver_remove_call(ni_updater_t *updater, ni_updater_job_t *
 				job->lease->type, job->lease->family))
 		goto cleanup;
 
+	/* everything we installed from this lease goes away; emit a
+	 * removal-only delta and drop the per-lease state file, so the
+	 * next install starts from a clean slate */
+	statedir = ni_extension_statedir(ni_updater_name(updater->kind));
+	if (!ni_string_empty(statedir)) {
+		ni_string_printf(&filename, "%s/resolv.conf.%s.%s.%s",
+				statedir, job->device.name,
+				ni_addrconf_type_to_name(job->lease->type),
+				ni_addrfamily_type_to_name(job->lease->family));
+	}
+	if (!ni_string_empty(filename) && ni_file_exists(filename)) {
+		if (ni_system_updater_resolver_delta_create(filename, NULL, &deltafile))
+			ni_var_array_set(&env, NI_UPDATER_DELTA_FILE_ENVVAR, deltafile);
+		unlink(filename);
+	}
+
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove, &args, &env) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -1404,6 +1599,9 @@ ni_system_updater_resolver_remove_call(ni_updater_t *updater, ni_updater_job_t *
 	ret = 0; /* started, advance to wait for finish */
 
 cleanup:
+	ni_string_free(&deltafile);
+	ni_string_free(&filename);
+	ni_var_array_destroy(&env);
 	ni_string_array_destroy(&args);
 	return ret;
 }
@@ -1556,7 +1754,7 @@ ni_system_updater_hostname_install_call(ni_updater_t *updater, ni_updater_job_t
 	ni_string_array_append(&args, job->hostname);
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_install, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_install, &args, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_install->command,
@@ -1604,7 +1802,7 @@ ni_system_updater_hostname_remove_call(ni_updater_t *updater, ni_updater_job_t *
 		goto cleanup;
 
 	job->result = 0;
-	if (ni_system_updater_run(job, updater->proc_remove, &args) != NI_PROCESS_SUCCESS) {
+	if (ni_system_updater_run(job, updater->proc_remove, &args, NULL) != NI_PROCESS_SUCCESS) {
 		ni_warn("%s: unable to execute %s updater (%s) for lease %s:%s in state %s",
 				job->device.name, ni_updater_name(updater->kind),
 				updater->proc_remove->command,
@@ -20,6 +20,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #include <wicked/util.h>
 #include <wicked/logging.h>
@@ -484,6 +485,66 @@ ni_var_array_init(ni_var_array_t *nva)
 	memset(nva, 0, sizeof(*nva));
 }
 
+/*
+ * Hashed name index over a variable array.
+ *
+ * The index is built lazily on the first lookup once the array has
+ * grown beyond a handful of entries (the sysconfig parser and the
+ * compat code query dozens of variables per file), and is simply
+ * dropped again whenever entries are added or removed, so writers
+ * keep their insertion order and never pay for maintenance.
+ */
+#define NI_VAR_ARRAY_INDEX_THRESHOLD	16
+
+struct ni_var_array_index {
+	unsigned int	nbuckets;	/* power of two */
+	unsigned int *	buckets;	/* position + 1, 0 is empty */
+	unsigned int *	chains;		/* per entry: next position + 1 */
+};
+
+static unsigned int
+__ni_var_array_name_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (name && *name)
+		hash = (hash << 5) + hash + (unsigned char)*name++;
+	return hash;
+}
+
+static void
+__ni_var_array_index_free(ni_var_array_t *nva)
+{
+	if (nva->index) {
+		free(nva->index->buckets);
+		free(nva->index->chains);
+		free(nva->index);
+		nva->index = NULL;
+	}
+}
+
+static void
+__ni_var_array_index_build(ni_var_array_t *nva)
+{
+	struct ni_var_array_index *index;
+	unsigned int i, hash;
+
+	index = xcalloc(1, sizeof(*index));
+	index->nbuckets = NI_VAR_ARRAY_INDEX_THRESHOLD;
+	while (index->nbuckets < nva->count)
+		index->nbuckets <<= 1;
+	index->buckets = xcalloc(index->nbuckets, sizeof(index->buckets[0]));
+	index->chains = xcalloc(nva->count, sizeof(index->chains[0]));
+
+	for (i = 0; i < nva->count; ++i) {
+		hash = __ni_var_array_name_hash(nva->data[i].name)
+			& (index->nbuckets - 1);
+		index->chains[i] = index->buckets[hash];
+		index->buckets[hash] = i + 1;
+	}
+	nva->index = index;
+}
+
 void
 ni_var_array_destroy(ni_var_array_t *nva)
 {
@@ -494,15 +555,33 @@ ni_var_array_destroy(ni_var_array_t *nva)
 		free(nva->data[i].value);
 	}
 	free(nva->data);
+	__ni_var_array_index_free(nva);
 	memset(nva, 0, sizeof(*nva));
 }
 
 ni_var_t *
-ni_var_array_get(const ni_var_array_t *nva, const char *name)
+ni_var_array_get(const ni_var_array_t *cnva, const char *name)
 {
+	/* cast to build the lazy lookup index; logically const */
+	ni_var_array_t *nva = (ni_var_array_t *)cnva;
 	unsigned int i;
 	ni_var_t *var;
 
+	if (nva->count >= NI_VAR_ARRAY_INDEX_THRESHOLD) {
+		unsigned int hash;
+
+		if (nva->index == NULL)
+			__ni_var_array_index_build(nva);
+
+		hash = __ni_var_array_name_hash(name) & (nva->index->nbuckets - 1);
+		for (i = nva->index->buckets[hash]; i; i = nva->index->chains[i - 1]) {
+			var = &nva->data[i - 1];
+			if (ni_string_eq(var->name, name))
+				return var;
+		}
+		return NULL;
+	}
+
 	for (i = 0, var = nva->data; i < nva->count; ++i, ++var) {
 		if (ni_string_eq(var->name, name))
 			return var;
@@ -532,6 +611,8 @@ ni_var_array_remove_at(ni_var_array_t *array, unsigned int index)
 	if (!array || index >= array->count)
 		return FALSE;
 
+	__ni_var_array_index_free(array);
+
 	free(array->data[index].name);
 	free(array->data[index].value);
 
@@ -567,6 +648,7 @@ __ni_var_array_append(ni_var_array_t *nva, const char *name, const char *value)
 {
 	ni_var_t *var;
 
+	__ni_var_array_index_free(nva);
 	if ((nva->count % NI_VAR_ARRAY_CHUNK) == 0)
 		__ni_var_array_realloc(nva, nva->count);
 	var = &nva->data[nva->count++];
@@ -574,12 +656,19 @@ __ni_var_array_append(ni_var_array_t *nva, const char *name, const char *value)
 	var->value = xstrdup(value);
 }
 
+void
+ni_var_array_append(ni_var_array_t *nva, const char *name, const char *value)
+{
+	__ni_var_array_append(nva, name, value);
+}
+
 void
 ni_var_array_set(ni_var_array_t *nva, const char *name, const char *value)
 {
 	ni_var_t *var;
 
 	if ((var = ni_var_array_get(nva, name)) == NULL) {
+		__ni_var_array_index_free(nva);
 		if ((nva->count % NI_VAR_ARRAY_CHUNK) == 0)
 			__ni_var_array_realloc(nva, nva->count);
 
@@ -716,6 +805,194 @@ ni_var_array_list_destroy(ni_var_array_t **list)
 	}
 }
 
+/*
+ * Arena allocator
+ *
+ * Objects are bump-allocated from chunks and never freed individually;
+ * ni_arena_reset releases everything at once, retaining the largest
+ * chunk so steady-state operation stops hitting malloc entirely.
+ * All arenas register on a global list with per-subsystem counters,
+ * reported by ni_arena_stats_log.
+ */
+#define NI_ARENA_ALIGN		(2 * sizeof(void *))
+#define NI_ARENA_CHUNK_MIN	512
+
+struct ni_arena_chunk {
+	ni_arena_chunk_t *	next;
+	size_t			size;		/* usable bytes */
+	size_t			used;
+	/* data follows */
+};
+
+static ni_arena_t *		__ni_arenas;
+
+static inline unsigned char *
+__ni_arena_chunk_data(ni_arena_chunk_t *chunk)
+{
+	return (unsigned char *)(chunk + 1);
+}
+
+static ni_arena_chunk_t *
+__ni_arena_chunk_new(ni_arena_t *arena, size_t size)
+{
+	ni_arena_chunk_t *chunk;
+
+	chunk = xmalloc(sizeof(*chunk) + size);
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+
+	arena->stats.chunks++;
+	arena->stats.capacity += size;
+	if (arena->stats.capacity > arena->stats.peak)
+		arena->stats.peak = arena->stats.capacity;
+	return chunk;
+}
+
+void
+ni_arena_init(ni_arena_t *arena, const char *name, size_t chunk_size)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->name = name;
+	arena->chunk_size = chunk_size < NI_ARENA_CHUNK_MIN ?
+				NI_ARENA_CHUNK_MIN : chunk_size;
+
+	arena->next = __ni_arenas;
+	__ni_arenas = arena;
+}
+
+void *
+ni_arena_alloc(ni_arena_t *arena, size_t size)
+{
+	ni_arena_chunk_t *chunk = arena->chunks;
+	unsigned char *ptr;
+
+	size = (size + NI_ARENA_ALIGN - 1) & ~(NI_ARENA_ALIGN - 1);
+
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		if (size > arena->chunk_size) {
+			/* oversized: dedicated chunk, current one stays
+			 * the bump target for subsequent allocations */
+			chunk = __ni_arena_chunk_new(arena, size);
+			if (arena->chunks) {
+				chunk->next = arena->chunks->next;
+				arena->chunks->next = chunk;
+			} else {
+				arena->chunks = chunk;
+			}
+		} else if (arena->spare) {
+			chunk = arena->spare;
+			arena->spare = NULL;
+			chunk->next = arena->chunks;
+			arena->chunks = chunk;
+		} else {
+			chunk = __ni_arena_chunk_new(arena, arena->chunk_size);
+			chunk->next = arena->chunks;
+			arena->chunks = chunk;
+		}
+	}
+
+	ptr = __ni_arena_chunk_data(chunk) + chunk->used;
+	chunk->used += size;
+	arena->stats.allocs++;
+	arena->stats.bytes += size;
+	return ptr;
+}
+
+void *
+ni_arena_calloc(ni_arena_t *arena, size_t size)
+{
+	void *ptr = ni_arena_alloc(arena, size);
+
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+char *
+ni_arena_strdup(ni_arena_t *arena, const char *string)
+{
+	size_t len;
+	char *copy;
+
+	if (string == NULL)
+		return NULL;
+
+	len = strlen(string) + 1;
+	copy = ni_arena_alloc(arena, len);
+	memcpy(copy, string, len);
+	return copy;
+}
+
+void
+ni_arena_reset(ni_arena_t *arena)
+{
+	ni_arena_chunk_t *chunk;
+
+	while ((chunk = arena->chunks) != NULL) {
+		arena->chunks = chunk->next;
+
+		/* retain the largest chunk for reuse */
+		if (arena->spare == NULL) {
+			chunk->used = 0;
+			arena->spare = chunk;
+			continue;
+		}
+		if (arena->spare->size < chunk->size) {
+			ni_arena_chunk_t *drop = arena->spare;
+
+			chunk->used = 0;
+			arena->spare = chunk;
+			chunk = drop;
+		}
+		arena->stats.chunks--;
+		arena->stats.capacity -= chunk->size;
+		free(chunk);
+	}
+	arena->stats.resets++;
+}
+
+void
+ni_arena_destroy(ni_arena_t *arena)
+{
+	ni_arena_t **pos, *cur;
+	ni_arena_chunk_t *chunk;
+
+	ni_arena_reset(arena);
+	if ((chunk = arena->spare) != NULL)
+		free(chunk);
+
+	for (pos = &__ni_arenas; (cur = *pos) != NULL; pos = &cur->next) {
+		if (cur == arena) {
+			*pos = arena->next;
+			break;
+		}
+	}
+	memset(arena, 0, sizeof(*arena));
+}
+
+const ni_arena_t *
+ni_arena_stats_list(void)
+{
+	return __ni_arenas;
+}
+
+void
+ni_arena_stats_log(void)
+{
+	const ni_arena_t *arena;
+
+	for (arena = __ni_arenas; arena; arena = arena->next) {
+		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_WICKED,
+				"arena %s: %llu allocs, %llu bytes, "
+				"%u chunks (%zu bytes, peak %zu), %llu resets",
+				arena->name ? arena->name : "<unnamed>",
+				(unsigned long long)arena->stats.allocs,
+				(unsigned long long)arena->stats.bytes,
+				arena->stats.chunks, arena->stats.capacity,
+				arena->stats.peak,
+				(unsigned long long)arena->stats.resets);
+	}
+}
 
 /*
  * Bitfield functions
@@ -1120,6 +1397,120 @@ ni_file_exists_fmt(const char *fmt, ...)
 	return ret;
 }
 
+/*
+ * Refcounted shared strings.
+ *
+ * Distinct values are interned once in a global hash table and handed
+ * out refcounted; fields with heavy duplication (interface names in
+ * routes, addresses and leases) share one copy per value instead of
+ * strdup'ing it thousands of times.  Holders must release through
+ * ni_refstr_put/ni_refstr_free -- never plain free().
+ */
+#define NI_REFSTR_HASH_NBUCKETS		256
+
+typedef struct ni_refstr	ni_refstr_t;
+
+struct ni_refstr {
+	ni_refstr_t *	next;
+	unsigned int	refcount;
+	unsigned int	hash;
+	char		data[];
+};
+
+static ni_refstr_t *	__ni_refstr_hash[NI_REFSTR_HASH_NBUCKETS];
+
+static unsigned int
+__ni_refstr_hashval(const char *string)
+{
+	unsigned int hash = 5381;
+
+	while (*string)
+		hash = (hash << 5) + hash + (unsigned char)*string++;
+	return hash;
+}
+
+static inline ni_refstr_t *
+__ni_refstr_entry(const char *string)
+{
+	return (ni_refstr_t *)(string - offsetof(ni_refstr_t, data));
+}
+
+const char *
+ni_refstr_get(const char *string)
+{
+	ni_refstr_t *str;
+	unsigned int hash;
+	size_t len;
+
+	if (string == NULL)
+		return NULL;
+
+	hash = __ni_refstr_hashval(string);
+	for (str = __ni_refstr_hash[hash % NI_REFSTR_HASH_NBUCKETS]; str; str = str->next) {
+		if (str->hash == hash && strcmp(str->data, string) == 0) {
+			str->refcount++;
+			return str->data;
+		}
+	}
+
+	len = strlen(string);
+	str = xmalloc(sizeof(*str) + len + 1);
+	str->refcount = 1;
+	str->hash = hash;
+	memcpy(str->data, string, len + 1);
+	str->next = __ni_refstr_hash[hash % NI_REFSTR_HASH_NBUCKETS];
+	__ni_refstr_hash[hash % NI_REFSTR_HASH_NBUCKETS] = str;
+	return str->data;
+}
+
+void
+ni_refstr_put(const char *string)
+{
+	ni_refstr_t **pos, *str, *cur;
+
+	if (string == NULL)
+		return;
+
+	str = __ni_refstr_entry(string);
+	ni_assert(str->refcount);
+	if (--(str->refcount))
+		return;
+
+	pos = &__ni_refstr_hash[str->hash % NI_REFSTR_HASH_NBUCKETS];
+	while ((cur = *pos) != NULL) {
+		if (cur == str) {
+			*pos = str->next;
+			break;
+		}
+		pos = &cur->next;
+	}
+	free(str);
+}
+
+ni_bool_t
+ni_refstr_dup(const char **pp, const char *value)
+{
+	const char *newval;
+
+	/* Beware: take the new reference first; value may be *pp */
+	newval = ni_refstr_get(value);
+	if (value && !newval)
+		return FALSE;
+	if (*pp)
+		ni_refstr_put(*pp);
+	*pp = newval;
+	return TRUE;
+}
+
+void
+ni_refstr_free(const char **pp)
+{
+	if (pp && *pp) {
+		ni_refstr_put(*pp);
+		*pp = NULL;
+	}
+}
+
 /*
  * String handling
  */
@@ -1544,12 +1935,135 @@ ni_parse_uint(const char *input, unsigned int *result, int base)
 	return 0;
 }
 
+/*
+ * Lazily built name lookup indexes for large ni_intmap_t tables.
+ *
+ * Most tables are tiny, but a few (ethtool feature names, route
+ * attributes, schema enums) are searched for every string-to-constant
+ * conversion during dbus-xml deserialization. On the first lookup in
+ * a table with enough entries we build a case-insensitive hash index,
+ * keyed by the table address, and keep it for later lookups.
+ *
+ * Owners of dynamically built tables (the xml schema enum/bitmap
+ * constraints) must call ni_intmap_index_drop() before freeing the
+ * table, so a later allocation at the same address cannot match a
+ * stale index.
+ */
+#define NI_INTMAP_INDEX_THRESHOLD	16
+#define NI_INTMAP_INDEX_MAXMAPS		32
+
+struct ni_intmap_index {
+	const ni_intmap_t *	map;
+	unsigned int		nbuckets;	/* power of two */
+	unsigned int *		buckets;	/* entry position + 1, 0 is empty */
+	unsigned int *		chains;		/* per entry: next position + 1 */
+};
+
+static struct ni_intmap_index	__ni_intmap_index[NI_INTMAP_INDEX_MAXMAPS];
+static unsigned int		__ni_intmap_index_count;
+
+static unsigned int
+__ni_intmap_name_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (*name)
+		hash = (hash << 5) + hash + tolower((unsigned char)*name++);
+	return hash;
+}
+
+static struct ni_intmap_index *
+__ni_intmap_index_find(const ni_intmap_t *map)
+{
+	unsigned int i;
+
+	for (i = 0; i < __ni_intmap_index_count; ++i) {
+		if (__ni_intmap_index[i].map == map)
+			return &__ni_intmap_index[i];
+	}
+	return NULL;
+}
+
+static struct ni_intmap_index *
+__ni_intmap_index_build(const ni_intmap_t *map, unsigned int count)
+{
+	struct ni_intmap_index *index;
+	unsigned int nbuckets, pos, bucket;
+
+	if (__ni_intmap_index_count >= NI_INTMAP_INDEX_MAXMAPS)
+		return NULL;
+
+	for (nbuckets = 16; nbuckets < count; nbuckets *= 2)
+		;
+
+	index = &__ni_intmap_index[__ni_intmap_index_count++];
+	index->map = map;
+	index->nbuckets = nbuckets;
+	index->buckets = xcalloc(nbuckets, sizeof(*index->buckets));
+	index->chains = xcalloc(count, sizeof(*index->chains));
+
+	/* insert back to front, so the first match wins as in the scan */
+	for (pos = count; pos--; ) {
+		bucket = __ni_intmap_name_hash(map[pos].name) & (nbuckets - 1);
+		index->chains[pos] = index->buckets[bucket];
+		index->buckets[bucket] = pos + 1;
+	}
+	return index;
+}
+
+static int
+__ni_intmap_index_lookup(const struct ni_intmap_index *index, const char *input,
+			unsigned int *result)
+{
+	const ni_intmap_t *map = index->map;
+	unsigned int pos, next;
+
+	next = index->buckets[__ni_intmap_name_hash(input) & (index->nbuckets - 1)];
+	while (next) {
+		pos = next - 1;
+		if (!strcasecmp(map[pos].name, input)) {
+			*result = map[pos].value;
+			return 0;
+		}
+		next = index->chains[pos];
+	}
+	return -1;
+}
+
+void
+ni_intmap_index_drop(const ni_intmap_t *map)
+{
+	struct ni_intmap_index *index;
+
+	if (!(index = __ni_intmap_index_find(map)))
+		return;
+
+	free(index->buckets);
+	free(index->chains);
+	*index = __ni_intmap_index[--__ni_intmap_index_count];
+	memset(&__ni_intmap_index[__ni_intmap_index_count], 0,
+			sizeof(__ni_intmap_index[0]));
+}
+
 int
 ni_parse_uint_mapped(const char *input, const ni_intmap_t *map, unsigned int *result)
 {
+	const struct ni_intmap_index *index;
+	unsigned int count;
+
 	if (!map || !input || !result)
 		return -1;
 
+	if ((index = __ni_intmap_index_find(map)))
+		return __ni_intmap_index_lookup(index, input, result);
+
+	for (count = 0; map[count].name; ++count)
+		;
+
+	if (count >= NI_INTMAP_INDEX_THRESHOLD &&
+	    (index = __ni_intmap_index_build(map, count)))
+		return __ni_intmap_index_lookup(index, input, result);
+
 	for (; map->name; ++map) {
 		if (!strcasecmp(map->name, input)) {
 			*result = map->value;
@@ -2801,6 +3315,56 @@ ni_srandom(void)
 	srandom(seed);
 }
 
+/*
+ * Per-subsystem memory accounting, see util_priv.h. The counters track
+ * the primary object allocations of each subsystem (xml nodes, netdevs,
+ * routes, leases, dbus objects), not every owned string, which is
+ * enough to attribute RSS growth to a subsystem.
+ */
+static ni_memstat_t		ni_memstat_counters[__NI_MEMTAG_MAX];
+
+static const char *		ni_memtag_names[__NI_MEMTAG_MAX] = {
+	[NI_MEMTAG_XML]		= "xml",
+	[NI_MEMTAG_NETINFO]	= "netinfo",
+	[NI_MEMTAG_ROUTES]	= "routes",
+	[NI_MEMTAG_LEASES]	= "leases",
+	[NI_MEMTAG_DBUS]	= "dbus",
+};
+
+void
+ni_memstats_alloc(ni_memtag_t tag, size_t size)
+{
+	if (tag >= __NI_MEMTAG_MAX)
+		return;
+	ni_memstat_counters[tag].allocs++;
+	ni_memstat_counters[tag].bytes_alloc += size;
+}
+
+void
+ni_memstats_free(ni_memtag_t tag, size_t size)
+{
+	if (tag >= __NI_MEMTAG_MAX)
+		return;
+	ni_memstat_counters[tag].frees++;
+	ni_memstat_counters[tag].bytes_freed += size;
+}
+
+const ni_memstat_t *
+ni_memstats_get(ni_memtag_t tag)
+{
+	if (tag >= __NI_MEMTAG_MAX)
+		return NULL;
+	return &ni_memstat_counters[tag];
+}
+
+const char *
+ni_memtag_name(ni_memtag_t tag)
+{
+	if (tag >= __NI_MEMTAG_MAX)
+		return NULL;
+	return ni_memtag_names[tag];
+}
+
 /*
  * Alloc helpers with NULLL check
  */
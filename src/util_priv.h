@@ -14,6 +14,35 @@ extern void *	xrealloc(void *, size_t);
 
 extern char *	xstrdup(const char *);
 
+/*
+ * Per-subsystem memory accounting. The object lifecycle funnels bump
+ * these counters whenever memory is actually obtained from or returned
+ * to the allocator (recycled cache hits don't count), so daemon RSS
+ * growth can be attributed by subsystem through the stats endpoint.
+ * Plain counter adds, cheap enough to stay always on.
+ */
+typedef enum {
+	NI_MEMTAG_XML = 0,
+	NI_MEMTAG_NETINFO,
+	NI_MEMTAG_ROUTES,
+	NI_MEMTAG_LEASES,
+	NI_MEMTAG_DBUS,
+
+	__NI_MEMTAG_MAX
+} ni_memtag_t;
+
+typedef struct ni_memstat {
+	uint64_t	allocs;
+	uint64_t	frees;
+	uint64_t	bytes_alloc;
+	uint64_t	bytes_freed;
+} ni_memstat_t;
+
+extern void			ni_memstats_alloc(ni_memtag_t, size_t);
+extern void			ni_memstats_free(ni_memtag_t, size_t);
+extern const ni_memstat_t *	ni_memstats_get(ni_memtag_t);
+extern const char *		ni_memtag_name(ni_memtag_t);
+
 #endif /* __WICKED_UTIL_PRIV_H__ */
 
 
@@ -171,14 +171,12 @@ __ni_wireless_do_scan(ni_netdev_t *dev)
 
 	wlan->capabilities = wpa_dev->capabilities;
 
-	/* We currently don't have a reasonable way to call back
-	 * to a higher level from the depths of the wpa-supplicant
-	 * code. Thus we have to result to polling here :-(
-	 */
-	if (ni_wpa_interface_scan_in_progress(wpa_dev)) {
-		__ni_wireless_scan_timer_arm(scan, dev, 1);
+	/* A scan is still running; ni_wireless_scan_completed() will
+	 * deliver the results as soon as the last BSS property reply
+	 * has arrived, and the interval timer armed above serves as a
+	 * backstop should the supplicant never answer. */
+	if (ni_wpa_interface_scan_in_progress(wpa_dev))
 		return 0;
-	}
 
 	/* Retrieve whatever is there. */
 	if (ni_wpa_interface_retrieve_scan(wpa_dev, scan)) {
@@ -237,6 +235,39 @@ __ni_wireless_scan_timer_arm(ni_wireless_scan_t *scan, ni_netdev_t *dev, unsigne
 	}
 }
 
+/*
+ * Callback from the wpa_supplicant client once all results of a scan
+ * have been retrieved. Scans on several radios run concurrently and
+ * each interface reports its own completion here, so we no longer
+ * serialize on the one second poll timer that used to pick them up.
+ */
+void
+ni_wireless_scan_completed(unsigned int ifindex)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *dev;
+	ni_wireless_t *wlan;
+	ni_wireless_scan_t *scan;
+	ni_wpa_interface_t *wpa_dev;
+
+	if (!(dev = ni_netdev_by_index(nc, ifindex)))
+		return;
+
+	if (!(wlan = dev->wireless) || !(scan = wlan->scan))
+		return;
+
+	if (!(wpa_dev = ni_wireless_bind_supplicant(dev)))
+		return;
+
+	if (ni_wpa_interface_retrieve_scan(wpa_dev, scan)) {
+		ni_debug_wireless("%s: list of networks changed", dev->name);
+		__ni_netdev_event(nc, dev, NI_EVENT_LINK_SCAN_UPDATED);
+	}
+
+	/* next periodic refresh a full interval out */
+	__ni_wireless_scan_timer_arm(scan, dev, scan->interval);
+}
+
 /*
  * Request association
  */
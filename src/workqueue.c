@@ -0,0 +1,264 @@
+/*
+ * Worker thread pool for offloading blocking syscalls.
+ *
+ * The daemons are single threaded; every sysfs read, ioctl and disk
+ * write otherwise stalls the event loop (some NICs take hundreds of
+ * msec to answer an ethtool ioctl). Jobs submitted here run their work
+ * function on one of a few worker threads; completions are queued back
+ * and dispatched on the event loop thread through an eventfd wired
+ * into the socket poll loop, so completion functions never need locks.
+ *
+ * Copyright (C) 2026 SUSE LLC
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+
+#include "socket_priv.h"
+#include "workqueue.h"
+#include "util_priv.h"
+
+#define NI_WORKQUEUE_WORKERS_MAX	8
+#define NI_WORKQUEUE_WORKERS_DEFAULT	2
+
+typedef struct ni_workqueue_job	ni_workqueue_job_t;
+struct ni_workqueue_job {
+	ni_workqueue_job_t *	next;
+
+	ni_workqueue_fn_t *	work;
+	ni_workqueue_fn_t *	done;
+	void *			user_data;
+};
+
+static pthread_mutex_t		ni_workqueue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		ni_workqueue_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t		ni_workqueue_idle = PTHREAD_COND_INITIALIZER;
+
+static ni_workqueue_job_t *	ni_workqueue_pending;
+static ni_workqueue_job_t **	ni_workqueue_pending_tail = &ni_workqueue_pending;
+static ni_workqueue_job_t *	ni_workqueue_completed;
+static ni_workqueue_job_t **	ni_workqueue_completed_tail = &ni_workqueue_completed;
+static unsigned int		ni_workqueue_executing;
+
+static ni_bool_t		ni_workqueue_running;
+static unsigned int		ni_workqueue_workers;
+static pthread_t		ni_workqueue_thread[NI_WORKQUEUE_WORKERS_MAX];
+static int			ni_workqueue_eventfd = -1;
+static ni_socket_t *		ni_workqueue_sock;
+
+static void
+__ni_workqueue_notify(void)
+{
+	uint64_t one = 1;
+
+	if (write(ni_workqueue_eventfd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		ni_warn("workqueue: unable to signal completion eventfd: %m");
+}
+
+static void *
+__ni_workqueue_worker(void *dummy)
+{
+	ni_workqueue_job_t *job;
+
+	pthread_mutex_lock(&ni_workqueue_lock);
+	while (ni_workqueue_running) {
+		if ((job = ni_workqueue_pending) == NULL) {
+			pthread_cond_wait(&ni_workqueue_wakeup, &ni_workqueue_lock);
+			continue;
+		}
+		if ((ni_workqueue_pending = job->next) == NULL)
+			ni_workqueue_pending_tail = &ni_workqueue_pending;
+		job->next = NULL;
+		ni_workqueue_executing++;
+		pthread_mutex_unlock(&ni_workqueue_lock);
+
+		job->work(job->user_data);
+
+		pthread_mutex_lock(&ni_workqueue_lock);
+		*ni_workqueue_completed_tail = job;
+		ni_workqueue_completed_tail = &job->next;
+		ni_workqueue_executing--;
+		if (ni_workqueue_pending == NULL && ni_workqueue_executing == 0)
+			pthread_cond_broadcast(&ni_workqueue_idle);
+		__ni_workqueue_notify();
+	}
+	pthread_mutex_unlock(&ni_workqueue_lock);
+	return NULL;
+}
+
+/*
+ * Take the completed jobs off the queue and run their completion
+ * functions; runs on the event loop thread only.
+ */
+static void
+__ni_workqueue_dispatch_completed(void)
+{
+	ni_workqueue_job_t *list, *job;
+
+	pthread_mutex_lock(&ni_workqueue_lock);
+	list = ni_workqueue_completed;
+	ni_workqueue_completed = NULL;
+	ni_workqueue_completed_tail = &ni_workqueue_completed;
+	pthread_mutex_unlock(&ni_workqueue_lock);
+
+	while ((job = list) != NULL) {
+		list = job->next;
+		if (job->done)
+			job->done(job->user_data);
+		free(job);
+	}
+}
+
+static void
+__ni_workqueue_completion_receive(ni_socket_t *sock)
+{
+	uint64_t count;
+
+	while (read(ni_workqueue_eventfd, &count, sizeof(count)) > 0)
+		;
+	__ni_workqueue_dispatch_completed();
+}
+
+ni_bool_t
+ni_workqueue_active(void)
+{
+	return ni_workqueue_running;
+}
+
+ni_bool_t
+ni_workqueue_init(unsigned int nworkers)
+{
+	unsigned int i;
+
+	if (ni_workqueue_running)
+		return TRUE;
+
+	if (nworkers == 0)
+		nworkers = NI_WORKQUEUE_WORKERS_DEFAULT;
+	if (nworkers > NI_WORKQUEUE_WORKERS_MAX)
+		nworkers = NI_WORKQUEUE_WORKERS_MAX;
+
+	ni_workqueue_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ni_workqueue_eventfd < 0) {
+		ni_error("workqueue: unable to create completion eventfd: %m");
+		return FALSE;
+	}
+
+	if (!(ni_workqueue_sock = ni_socket_wrap(ni_workqueue_eventfd, SOCK_DGRAM))) {
+		close(ni_workqueue_eventfd);
+		ni_workqueue_eventfd = -1;
+		return FALSE;
+	}
+	ni_workqueue_sock->receive = __ni_workqueue_completion_receive;
+	ni_socket_activate(ni_workqueue_sock);
+
+	/* registered before any atexit consumers (e.g. the lease file
+	 * flush), so their final submissions still get drained */
+	atexit(ni_workqueue_shutdown);
+
+	ni_workqueue_running = TRUE;
+	for (i = 0; i < nworkers; ++i) {
+		if (pthread_create(&ni_workqueue_thread[i], NULL,
+					__ni_workqueue_worker, NULL) != 0) {
+			ni_error("workqueue: unable to create worker thread: %m");
+			break;
+		}
+		ni_workqueue_workers++;
+	}
+	if (ni_workqueue_workers == 0) {
+		ni_workqueue_shutdown();
+		return FALSE;
+	}
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_SOCKET,
+			"workqueue: started %u worker thread%s",
+			ni_workqueue_workers, ni_workqueue_workers == 1 ? "" : "s");
+	return TRUE;
+}
+
+ni_bool_t
+ni_workqueue_submit(ni_workqueue_fn_t *work, ni_workqueue_fn_t *done, void *user_data)
+{
+	ni_workqueue_job_t *job;
+
+	if (!work)
+		return FALSE;
+
+	/* no pool (one-shot utility, or startup/shutdown): run inline */
+	if (!ni_workqueue_running) {
+		work(user_data);
+		if (done)
+			done(user_data);
+		return TRUE;
+	}
+
+	job = xcalloc(1, sizeof(*job));
+	job->work = work;
+	job->done = done;
+	job->user_data = user_data;
+
+	pthread_mutex_lock(&ni_workqueue_lock);
+	*ni_workqueue_pending_tail = job;
+	ni_workqueue_pending_tail = &job->next;
+	pthread_cond_signal(&ni_workqueue_wakeup);
+	pthread_mutex_unlock(&ni_workqueue_lock);
+	return TRUE;
+}
+
+/*
+ * Wait until all submitted work has finished and run the outstanding
+ * completion functions. Used before operations that must observe the
+ * effects of in-flight jobs, and at shutdown.
+ */
+void
+ni_workqueue_drain(void)
+{
+	if (!ni_workqueue_running)
+		return;
+
+	pthread_mutex_lock(&ni_workqueue_lock);
+	while (ni_workqueue_pending != NULL || ni_workqueue_executing != 0)
+		pthread_cond_wait(&ni_workqueue_idle, &ni_workqueue_lock);
+	pthread_mutex_unlock(&ni_workqueue_lock);
+
+	__ni_workqueue_dispatch_completed();
+}
+
+void
+ni_workqueue_shutdown(void)
+{
+	unsigned int i;
+
+	if (ni_workqueue_eventfd < 0)
+		return;
+
+	if (ni_workqueue_running) {
+		ni_workqueue_drain();
+
+		pthread_mutex_lock(&ni_workqueue_lock);
+		ni_workqueue_running = FALSE;
+		pthread_cond_broadcast(&ni_workqueue_wakeup);
+		pthread_mutex_unlock(&ni_workqueue_lock);
+
+		for (i = 0; i < ni_workqueue_workers; ++i)
+			pthread_join(ni_workqueue_thread[i], NULL);
+		ni_workqueue_workers = 0;
+	}
+
+	if (ni_workqueue_sock) {
+		/* closes the eventfd as well */
+		ni_socket_close(ni_workqueue_sock);
+		ni_workqueue_sock = NULL;
+		ni_workqueue_eventfd = -1;
+	}
+}
@@ -0,0 +1,30 @@
+/*
+ * Worker thread pool for offloading blocking syscalls (slow ioctls,
+ * sysfs reads, disk writes) from the event loop.
+ *
+ * Copyright (C) 2026 SUSE LLC
+ */
+
+#ifndef __WICKED_WORKQUEUE_H__
+#define __WICKED_WORKQUEUE_H__
+
+#include <wicked/types.h>
+
+/*
+ * A job consists of a work function executed on a worker thread and an
+ * optional completion function executed on the event loop thread once
+ * the work has finished; both receive the same user data pointer.
+ *
+ * When the pool has not been initialized (one-shot client utilities),
+ * ni_workqueue_submit falls back to executing the job inline, so
+ * callers do not need to distinguish the two modes.
+ */
+typedef void		ni_workqueue_fn_t(void *);
+
+extern ni_bool_t	ni_workqueue_init(unsigned int);
+extern ni_bool_t	ni_workqueue_active(void);
+extern ni_bool_t	ni_workqueue_submit(ni_workqueue_fn_t *, ni_workqueue_fn_t *, void *);
+extern void		ni_workqueue_drain(void);
+extern void		ni_workqueue_shutdown(void);
+
+#endif /* __WICKED_WORKQUEUE_H__ */
@@ -617,6 +617,8 @@ ni_wpa_interface_retrieve_scan(ni_wpa_interface_t *wpa_dev, ni_wireless_scan_t *
 	ni_wireless_network_t *net;
 	ni_dbus_object_t *pos;
 	ni_bool_t send_event = FALSE;
+	ni_bool_t changed = FALSE;
+	unsigned int count = 0;
 
 	/* Prune old BSSes */
 	if (ni_wpa_interface_expire_networks(wpa_dev, scan->interval + 1) == 0) {
@@ -628,7 +630,10 @@ ni_wpa_interface_retrieve_scan(ni_wpa_interface_t *wpa_dev, ni_wireless_scan_t *
 		send_event = TRUE;
 	}
 
-	ni_wireless_network_array_destroy(&scan->networks);
+	/* The network objects are shared by reference and their signal
+	 * and seen fields are updated in place as the BSS property
+	 * replies arrive, so the array needs rebuilding only when the
+	 * set of networks in range actually changed. */
 	for (net = ni_wpa_interface_first_network(wpa_dev, &pos, NULL); net; net = ni_wpa_interface_next_network(wpa_dev, &pos, NULL)) {
 		/* We mix networks learned through scanning with those we configured manually.
 		 * We can tell them apart by their timestamp field. Manually configured networks
@@ -639,13 +644,25 @@ ni_wpa_interface_retrieve_scan(ni_wpa_interface_t *wpa_dev, ni_wireless_scan_t *
 		 * set yet.
 		 */
 		if (net->scan_info.timestamp && net->access_point.len != 0) {
-			ni_wireless_network_array_append(&scan->networks, net);
+			if (count >= scan->networks.count || scan->networks.data[count] != net)
+				changed = TRUE;
+			count++;
 			if (!net->notified) {
 				net->notified = TRUE;
 				send_event = TRUE;
 			}
 		}
 	}
+	if (count != scan->networks.count)
+		changed = TRUE;
+
+	if (changed) {
+		ni_wireless_network_array_destroy(&scan->networks);
+		for (net = ni_wpa_interface_first_network(wpa_dev, &pos, NULL); net; net = ni_wpa_interface_next_network(wpa_dev, &pos, NULL)) {
+			if (net->scan_info.timestamp && net->access_point.len != 0)
+				ni_wireless_network_array_append(&scan->networks, net);
+		}
+	}
 	scan->timestamp = wpa_dev->scan.timestamp;
 
 	return send_event;
@@ -896,6 +913,34 @@ ni_wpa_interface_update_state(ni_wpa_interface_t *dev, ni_wpa_ifstate_t new_stat
 	ni_wireless_association_changed(dev->ifindex, assoc_state);
 }
 
+/*
+ * Find the interface a BSS object belongs to; the BSS proxies are
+ * created below the interface proxy in the object tree.
+ */
+static ni_wpa_interface_t *
+ni_wpa_network_interface(const ni_dbus_object_t *net_object)
+{
+	ni_dbus_object_t *parent;
+
+	for (parent = net_object->parent; parent; parent = parent->parent) {
+		if (parent->class == &ni_objectmodel_wpadev_class)
+			return parent->handle;
+	}
+	return NULL;
+}
+
+/*
+ * Once the scanResults reply and all outstanding BSS property replies
+ * have arrived, tell the wireless layer; it subscribes to this instead
+ * of polling our pending flags on a timer.
+ */
+static void
+ni_wpa_interface_scan_maybe_complete(ni_wpa_interface_t *wpa_dev)
+{
+	if (wpa_dev && !ni_wpa_interface_scan_in_progress(wpa_dev))
+		ni_wireless_scan_completed(wpa_dev->ifindex);
+}
+
 /*
  * Handle async retrieval of scan results.
  * The results of a scan consists of a list of object path names,
@@ -929,6 +974,12 @@ ni_wpa_interface_scan_results(ni_dbus_object_t *proxy, ni_dbus_message_t *msg)
 				continue;
 
 			net = net_object->handle;
+
+			/* a properties call for this BSS is already in
+			 * flight; don't queue a duplicate */
+			if (net->scan_info.updating)
+				continue;
+
 			net->scan_info.updating = TRUE;
 			ni_wpa_network_request_properties(net_object);
 		}
@@ -936,6 +987,9 @@ ni_wpa_interface_scan_results(ni_dbus_object_t *proxy, ni_dbus_message_t *msg)
 
 	if (object_path_array)
 		dbus_free_string_array(object_path_array);
+
+	/* an empty result, or all BSS properties already in flight */
+	ni_wpa_interface_scan_maybe_complete(wpa_dev);
 }
 
 /*
@@ -1827,11 +1881,16 @@ ni_wpa_bss_properties_result(ni_dbus_object_t *proxy, ni_dbus_message_t *msg)
 	net->scan_info.timestamp = time(NULL);
 
 	ni_dbus_variant_destroy(&dict);
+	ni_wpa_interface_scan_maybe_complete(ni_wpa_network_interface(proxy));
 	return;
 
 failed:
 	ni_error("trouble parsing BSS properties response");
+	/* clear the in-flight marker, or the interface would
+	 * count as "scanning" forever */
+	net->scan_info.updating = FALSE;
 	ni_dbus_variant_destroy(&dict);
+	ni_wpa_interface_scan_maybe_complete(ni_wpa_network_interface(proxy));
 }
 
 /*
@@ -0,0 +1,340 @@
+/*
+ * Binary serialization of XML document trees.
+ *
+ * This implements a compact dump/restore of a parsed document, used to
+ * cache the schema files: they change only on package update, but every
+ * wicked invocation used to tokenize all of them from scratch. Loading
+ * the dump rebuilds the tree in a single pass over the file, without
+ * going through the XML tokenizer.
+ *
+ * The format is a "NiXB" magic plus format version, the document DTD,
+ * and the root node as a recursive record of name, cdata, attributes
+ * and children. Strings are length-prefixed and include the
+ * terminating NUL, so the reader can hand them on in place.
+ *
+ * Copyright (C) 2026 SUSE
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/xml.h>
+
+#include "buffer.h"
+#include "util_priv.h"
+
+#define XML_BINARY_MAGIC	"NiXB"
+#define XML_BINARY_MAGIC_LEN	4
+#define XML_BINARY_VERSION	1U
+
+/* Keep a sanity limit on cache files; the schema set is well below this */
+#define XML_BINARY_MAX_SIZE	(64 * 1024 * 1024)
+
+#define XML_BINARY_TAG_NODE	0x01
+#define XML_BINARY_TAG_END	0x02
+
+static int
+xml_binary_put_string(ni_buffer_t *bp, const char *string)
+{
+	uint32_t len = string ? strlen(string) + 1 : 0;
+
+	ni_buffer_ensure_tailroom(bp, sizeof(len) + len);
+	if (ni_buffer_put_uint32(bp, len) < 0)
+		return -1;
+	if (len && ni_buffer_put(bp, string, len) < 0)
+		return -1;
+	return 0;
+}
+
+static int
+xml_binary_put_node(ni_buffer_t *bp, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	const ni_var_t *attr;
+	unsigned int i;
+
+	ni_buffer_ensure_tailroom(bp, 1);
+	if (ni_buffer_putc(bp, XML_BINARY_TAG_NODE) < 0)
+		return -1;
+
+	if (xml_binary_put_string(bp, node->name) < 0
+	 || xml_binary_put_string(bp, node->cdata) < 0)
+		return -1;
+
+	ni_buffer_ensure_tailroom(bp, sizeof(uint32_t));
+	if (ni_buffer_put_uint32(bp, node->attrs.count) < 0)
+		return -1;
+	for (i = 0, attr = node->attrs.data; i < node->attrs.count; ++i, ++attr) {
+		if (xml_binary_put_string(bp, attr->name) < 0
+		 || xml_binary_put_string(bp, attr->value) < 0)
+			return -1;
+	}
+
+	for (child = node->children; child; child = child->next) {
+		if (xml_binary_put_node(bp, child) < 0)
+			return -1;
+	}
+
+	ni_buffer_ensure_tailroom(bp, 1);
+	return ni_buffer_putc(bp, XML_BINARY_TAG_END);
+}
+
+int
+xml_document_write_binary(const xml_document_t *doc, const char *path)
+{
+	ni_buffer_t buf;
+	char *tmppath = NULL;
+	FILE *fp = NULL;
+	int rv = -1;
+
+	if (!doc || !doc->root || !path)
+		return -1;
+
+	ni_buffer_init_dynamic(&buf, 64 * 1024);
+	ni_buffer_ensure_tailroom(&buf, XML_BINARY_MAGIC_LEN + sizeof(uint32_t));
+	ni_buffer_put(&buf, XML_BINARY_MAGIC, XML_BINARY_MAGIC_LEN);
+	ni_buffer_put_uint32(&buf, XML_BINARY_VERSION);
+
+	if (xml_binary_put_string(&buf, doc->dtd) < 0
+	 || xml_binary_put_node(&buf, doc->root) < 0)
+		goto out;
+
+	/* write to a temp file and rename, so concurrent readers never
+	 * see a partial dump */
+	ni_string_printf(&tmppath, "%s.%u.tmp", path, getpid());
+	if ((fp = fopen(tmppath, "we")) == NULL) {
+		ni_debug_xml("%s: unable to open %s for writing: %m", __func__, tmppath);
+		goto out;
+	}
+
+	if (ni_file_write(fp, ni_buffer_head(&buf), ni_buffer_count(&buf)) < 0)
+		goto out;
+	fclose(fp);
+	fp = NULL;
+
+	if (rename(tmppath, path) < 0) {
+		ni_debug_xml("%s: unable to rename %s to %s: %m", __func__, tmppath, path);
+		goto out;
+	}
+	rv = 0;
+
+out:
+	if (fp)
+		fclose(fp);
+	if (rv < 0 && tmppath)
+		unlink(tmppath);
+	ni_string_free(&tmppath);
+	ni_buffer_destroy(&buf);
+	return rv;
+}
+
+/*
+ * Serialize a single node (without document framing path handling) to
+ * an open stream. Used by the lease file code, which manages its own
+ * temp file, fsync and rename dance.
+ */
+int
+xml_node_write_binary(const xml_node_t *node, FILE *fp)
+{
+	ni_buffer_t buf;
+	int rv = -1;
+
+	if (!node || !fp)
+		return -1;
+
+	ni_buffer_init_dynamic(&buf, 16 * 1024);
+	ni_buffer_ensure_tailroom(&buf, XML_BINARY_MAGIC_LEN + sizeof(uint32_t));
+	ni_buffer_put(&buf, XML_BINARY_MAGIC, XML_BINARY_MAGIC_LEN);
+	ni_buffer_put_uint32(&buf, XML_BINARY_VERSION);
+
+	if (xml_binary_put_string(&buf, NULL) < 0	/* no dtd */
+	 || xml_binary_put_node(&buf, node) < 0)
+		goto out;
+
+	rv = ni_file_write(fp, ni_buffer_head(&buf), ni_buffer_count(&buf));
+out:
+	ni_buffer_destroy(&buf);
+	return rv < 0 ? -1 : 0;
+}
+
+/*
+ * Check whether the stream starts with a binary xml dump; the stream
+ * position is restored, so the caller can go on and parse either way.
+ */
+ni_bool_t
+xml_binary_sniff(FILE *fp)
+{
+	unsigned char magic[XML_BINARY_MAGIC_LEN];
+	long pos;
+	size_t got;
+
+	if (fp == NULL || (pos = ftell(fp)) < 0)
+		return FALSE;
+
+	got = fread(magic, 1, sizeof(magic), fp);
+	if (fseek(fp, pos, SEEK_SET) < 0)
+		return FALSE;
+
+	return got == sizeof(magic) && !memcmp(magic, XML_BINARY_MAGIC, sizeof(magic));
+}
+
+static int
+xml_binary_get_string(ni_buffer_t *bp, const char **result)
+{
+	const char *string;
+	uint32_t len;
+
+	if (ni_buffer_get_uint32(bp, &len) < 0)
+		return -1;
+	if (len == 0) {
+		*result = NULL;
+		return 0;
+	}
+
+	if (ni_buffer_count(bp) < len
+	 || (string = ni_buffer_pull_head(bp, len)) == NULL
+	 || string[len - 1] != '\0')
+		return -1;
+
+	*result = string;
+	return 0;
+}
+
+static inline int
+xml_binary_peek_tag(const ni_buffer_t *bp)
+{
+	if (ni_buffer_count(bp) == 0)
+		return -1;
+	return *(const unsigned char *) ni_buffer_head(bp);
+}
+
+static xml_node_t *
+xml_binary_get_node(ni_buffer_t *bp)
+{
+	const char *name, *cdata;
+	uint32_t count, i;
+	xml_node_t *node;
+
+	if (ni_buffer_getc(bp) != XML_BINARY_TAG_NODE)
+		return NULL;
+
+	if (xml_binary_get_string(bp, &name) < 0
+	 || xml_binary_get_string(bp, &cdata) < 0)
+		return NULL;
+
+	node = xml_node_new(name, NULL);
+	if (cdata)
+		xml_node_set_cdata(node, cdata);
+
+	if (ni_buffer_get_uint32(bp, &count) < 0)
+		goto failed;
+	for (i = 0; i < count; ++i) {
+		const char *aname, *avalue;
+
+		if (xml_binary_get_string(bp, &aname) < 0 || aname == NULL
+		 || xml_binary_get_string(bp, &avalue) < 0)
+			goto failed;
+		xml_node_add_attr(node, aname, avalue);
+	}
+
+	while (xml_binary_peek_tag(bp) == XML_BINARY_TAG_NODE) {
+		xml_node_t *child;
+
+		if ((child = xml_binary_get_node(bp)) == NULL)
+			goto failed;
+		xml_node_add_child(node, child);
+	}
+
+	if (ni_buffer_getc(bp) != XML_BINARY_TAG_END)
+		goto failed;
+	return node;
+
+failed:
+	xml_node_free(node);
+	return NULL;
+}
+
+xml_document_t *
+xml_document_read_binary(const char *path)
+{
+	unsigned char magic[XML_BINARY_MAGIC_LEN];
+	xml_document_t *doc = NULL;
+	xml_node_t *root;
+	const char *dtd;
+	ni_buffer_t buf;
+	uint32_t version;
+	void *data;
+	size_t len;
+	FILE *fp;
+
+	if ((fp = fopen(path, "re")) == NULL)
+		return NULL;
+	data = ni_file_read(fp, &len, XML_BINARY_MAX_SIZE);
+	fclose(fp);
+	if (data == NULL)
+		return NULL;
+
+	ni_buffer_init_reader(&buf, data, len);
+	if (ni_buffer_get(&buf, magic, sizeof(magic)) < 0
+	 || memcmp(magic, XML_BINARY_MAGIC, sizeof(magic))
+	 || ni_buffer_get_uint32(&buf, &version) < 0
+	 || version != XML_BINARY_VERSION
+	 || xml_binary_get_string(&buf, &dtd) < 0) {
+		ni_debug_xml("%s: not a usable binary xml dump", path);
+		free(data);
+		return NULL;
+	}
+
+	if ((root = xml_binary_get_node(&buf)) == NULL) {
+		ni_debug_xml("%s: corrupt binary xml dump", path);
+		free(data);
+		return NULL;
+	}
+
+	doc = xml_document_new();
+	xml_document_set_root(doc, root);
+	if (dtd)
+		ni_string_dup(&doc->dtd, dtd);
+
+	free(data);
+	return doc;
+}
+
+xml_node_t *
+xml_node_read_binary(FILE *fp, const char *location)
+{
+	unsigned char magic[XML_BINARY_MAGIC_LEN];
+	xml_node_t *node = NULL;
+	const char *dtd;
+	ni_buffer_t buf;
+	uint32_t version;
+	void *data;
+	size_t len;
+
+	if (fp == NULL)
+		return NULL;
+	if ((data = ni_file_read(fp, &len, XML_BINARY_MAX_SIZE)) == NULL)
+		return NULL;
+
+	ni_buffer_init_reader(&buf, data, len);
+	if (ni_buffer_get(&buf, magic, sizeof(magic)) < 0
+	 || memcmp(magic, XML_BINARY_MAGIC, sizeof(magic))
+	 || ni_buffer_get_uint32(&buf, &version) < 0
+	 || version != XML_BINARY_VERSION
+	 || xml_binary_get_string(&buf, &dtd) < 0
+	 || (node = xml_binary_get_node(&buf)) == NULL) {
+		ni_debug_xml("%s: not a usable binary xml dump",
+				location ? location : "<stream>");
+		free(data);
+		return NULL;
+	}
+
+	free(data);
+	return node;
+}
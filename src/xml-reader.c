@@ -26,7 +26,11 @@
 #endif
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <wicked/xml.h>
 #include <wicked/logging.h>
@@ -61,6 +65,12 @@ typedef struct xml_reader {
 	FILE *			file;
 	unsigned char *		buffer;		/* FIXME: use in_buffer for this as well */
 
+	/* when reading from a regular file, we map it and tokenize the
+	 * mapping through in_buffer instead of copying through stdio */
+	void *			mapped;
+	size_t			mapped_size;
+	ni_buffer_t		map_buffer;
+
 	unsigned int		no_close : 1;
 
 	char *			doctype;
@@ -75,8 +85,16 @@ typedef struct xml_reader {
 	struct xml_location_shared *shared_location;
 } xml_reader_t;
 
+struct xml_stream_context {
+	xml_stream_callback_t *	callback;
+	void *			user_data;
+	ni_bool_t		stopped;
+};
+
 static xml_document_t *	xml_process_document(xml_reader_t *);
 static ni_bool_t	xml_process_element_nested(xml_reader_t *, xml_node_t *, unsigned int);
+static ni_bool_t	xml_stream_element_nested(xml_reader_t *, struct xml_stream_context *,
+				xml_node_t *, unsigned int);
 static ni_bool_t	xml_get_identifier(xml_reader_t *, ni_stringbuf_t *);
 static xml_token_type_t	xml_get_token(xml_reader_t *, ni_stringbuf_t *);
 static xml_token_type_t	xml_get_token_initial(xml_reader_t *, ni_stringbuf_t *);
@@ -222,6 +240,86 @@ xml_node_scan(FILE *fp, const char *location)
 	return root;
 }
 
+/*
+ * Streaming parse entry points. These run the same tokenizer as the
+ * document readers above, but hand each element to a callback instead
+ * of building a node tree.
+ */
+static ni_bool_t
+xml_process_stream(xml_reader_t *xr, xml_stream_callback_t *callback, void *user_data)
+{
+	struct xml_stream_context ctx = { .callback = callback, .user_data = user_data };
+	xml_node_t *root = xml_node_new(NULL, NULL);
+	ni_bool_t rv;
+
+	rv = xml_stream_element_nested(xr, &ctx, root, 0);
+	xml_node_free(root);
+
+	/* The callback asking us to stop is not a parse error */
+	return rv || ctx.stopped;
+}
+
+ni_bool_t
+xml_stream_read(const char *filename, xml_stream_callback_t *callback, void *user_data)
+{
+	xml_reader_t reader;
+	ni_bool_t rv;
+
+	if (!strcmp(filename, "-")) {
+		if (xml_reader_init_file(&reader, stdin, NULL) < 0)
+			return FALSE;
+	} else
+	if (xml_reader_open(&reader, filename) < 0)
+		return FALSE;
+
+	rv = xml_process_stream(&reader, callback, user_data);
+	if (xml_reader_destroy(&reader) < 0)
+		return FALSE;
+	return rv;
+}
+
+ni_bool_t
+xml_stream_scan(FILE *fp, const char *location, xml_stream_callback_t *callback, void *user_data)
+{
+	xml_reader_t reader;
+	ni_bool_t rv;
+
+	if (xml_reader_init_file(&reader, fp, location) < 0)
+		return FALSE;
+
+	rv = xml_process_stream(&reader, callback, user_data);
+	if (xml_reader_destroy(&reader) < 0)
+		return FALSE;
+	return rv;
+}
+
+ni_bool_t
+xml_stream_from_buffer(ni_buffer_t *in_buffer, const char *location,
+			xml_stream_callback_t *callback, void *user_data)
+{
+	xml_reader_t reader;
+	ni_bool_t rv;
+
+	if (xml_reader_init_buffer(&reader, in_buffer, location) < 0)
+		return FALSE;
+
+	rv = xml_process_stream(&reader, callback, user_data);
+	if (xml_reader_destroy(&reader) < 0)
+		return FALSE;
+	return rv;
+}
+
+static ni_bool_t
+xml_stream_emit(struct xml_stream_context *ctx, xml_stream_event_t event,
+			const xml_node_t *node, const char *cdata)
+{
+	if (!ctx->callback(event, node, cdata, ctx->user_data)) {
+		ctx->stopped = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 xml_process_pi_node(xml_reader_t *xr, xml_node_t *pi)
 {
@@ -400,6 +498,189 @@ error:
 	return FALSE;
 }
 
+/*
+ * Streaming twin of xml_process_element_nested. Elements are handed to
+ * the callback as transient nodes carrying name and attributes only;
+ * nothing is linked into a tree. cur is the innermost open element, or
+ * the anonymous (name == NULL) root outside the toplevel element.
+ */
+ni_bool_t
+xml_stream_element_nested(xml_reader_t *xr, struct xml_stream_context *ctx,
+			xml_node_t *cur, unsigned int nesting)
+{
+	ni_stringbuf_t tokenValue, identifier;
+	xml_token_type_t token;
+	xml_node_t *child;
+
+	ni_stringbuf_init(&tokenValue);
+	ni_stringbuf_init(&identifier);
+
+	while (1) {
+		token = xml_get_token(xr, &tokenValue);
+
+		switch (token) {
+		case CData:
+			/* element content; there is none to report outside the
+			 * toplevel element */
+			if (cur->name
+			 && !xml_stream_emit(ctx, XML_STREAM_CDATA, cur, tokenValue.string))
+				goto error;
+			break;
+
+		case LeftAngleExclam:
+			/* Most likely <!DOCTYPE ...> */
+			if (!xml_get_identifier(xr, &identifier)) {
+				xml_parse_error(xr, "Bad element: tag open <! not followed by identifier");
+				goto error;
+			}
+
+			if (strcmp(identifier.string, "DOCTYPE")) {
+				xml_parse_error(xr, "Unexpected element: <!%s ...> not supported", identifier.string);
+				goto error;
+			}
+
+			while (1) {
+				token = xml_get_token(xr, &identifier);
+				if (token == RightAngle)
+					break;
+				if (token == Identifier && !xr->doctype)
+					ni_string_dup(&xr->doctype, identifier.string);
+				if (token != Identifier && token != QuotedString) {
+					xml_parse_error(xr, "Error parsing <!DOCTYPE ...> attributes");
+					goto error;
+				}
+			}
+			break;
+
+		case LeftAngle:
+			/* New element start */
+			if (!xml_get_identifier(xr, &identifier)) {
+				xml_parse_error(xr, "Bad element: tag open < not followed by identifier");
+				goto error;
+			}
+
+			child = xml_node_new(identifier.string, NULL);
+			if (xr->shared_location)
+				child->location = xml_location_new(xr->shared_location, xr->lineCount);
+
+			token = xml_get_tag_attributes(xr, child);
+			if (token == None) {
+				xml_parse_error(xr, "Error parsing <%s ...> tag attributes", child->name);
+				xml_node_free(child);
+				goto error;
+			} else
+			if (token == RightAngle) {
+				/* Handle <foo>...</foo> */
+				xml_debug("%*.*s<%s>\n", nesting, nesting, "", child->name);
+				if (!xml_stream_emit(ctx, XML_STREAM_ELEMENT_OPEN, child, NULL)
+				 || !xml_stream_element_nested(xr, ctx, child, nesting + 2)) {
+					xml_node_free(child);
+					goto error;
+				}
+				xml_node_free(child);
+			} else if (token == RightAngleSlash) {
+				/* We parsed a "<foo/>" element - open and close right away */
+				xml_debug("%*.*s<%s/>\n", nesting, nesting, "", child->name);
+				if (!xml_stream_emit(ctx, XML_STREAM_ELEMENT_OPEN, child, NULL)
+				 || !xml_stream_emit(ctx, XML_STREAM_ELEMENT_CLOSE, child, NULL)) {
+					xml_node_free(child);
+					goto error;
+				}
+				xml_node_free(child);
+			} else {
+				xml_parse_error(xr, "Unexpected token %s at end of <%s ...",
+						xml_token_name(token), child->name);
+				xml_node_free(child);
+				goto error;
+			}
+
+			break;
+
+		case LeftAngleSlash:
+			/* Element end */
+			if (!xml_get_identifier(xr, &identifier)) {
+				xml_parse_error(xr, "Bad element: end tag open </ not followed by identifier");
+				goto error;
+			}
+
+			if (xml_get_token(xr, &tokenValue) != RightAngle) {
+				xml_parse_error(xr, "Bad element: </%s - missing tag close", identifier.string);
+				goto error;
+			}
+
+			if (cur->name == NULL) {
+				xml_parse_error(xr, "Unexpected </%s> tag", identifier.string);
+				goto error;
+			}
+			if (strcmp(cur->name, identifier.string)) {
+				xml_parse_error(xr, "Closing tag </%s> does not match <%s>",
+						identifier.string, cur->name);
+				goto error;
+			}
+
+			xml_debug("%*.*s</%s>\n", nesting, nesting, "", cur->name);
+			if (!xml_stream_emit(ctx, XML_STREAM_ELEMENT_CLOSE, cur, NULL))
+				goto error;
+			goto success;
+
+		case LeftAngleQ:
+			/* New PI node starts here */
+			if (!xml_get_identifier(xr, &identifier)) {
+				xml_parse_error(xr, "Bad element: tag open <? not followed by identifier");
+				goto error;
+			}
+
+			child = xml_node_new(identifier.string, NULL);
+			if (xr->shared_location)
+				child->location = xml_location_new(xr->shared_location, xr->lineCount);
+
+			token = xml_get_tag_attributes(xr, child);
+			if (token == None) {
+				xml_parse_error(xr, "Error parsing <?%s ...?> tag attributes", child->name);
+				xml_node_free(child);
+				goto error;
+			} else
+			if (token == RightAngleQ) {
+				xml_debug("%*.*s<%s>\n", nesting, nesting, "", child->name);
+				xml_process_pi_node(xr, child);
+				xml_node_free(child);
+			} else {
+				xml_parse_error(xr, "Unexpected token %s at end of <?%s ...",
+						xml_token_name(token), child->name);
+				xml_node_free(child);
+				goto error;
+			}
+
+			break;
+
+		case EndOfDocument:
+			if (cur->name) {
+				xml_parse_error(xr, "End of document while processing element <%s>", cur->name);
+				goto error;
+			}
+			goto success;
+
+		case None:
+			/* parser error */
+			goto error;
+
+		default:
+			xml_parse_error(xr, "Unexpected token %s", xml_token_name(token));
+			goto error;
+		}
+	}
+
+success:
+	ni_stringbuf_destroy(&tokenValue);
+	ni_stringbuf_destroy(&identifier);
+	return TRUE;
+
+error:
+	ni_stringbuf_destroy(&tokenValue);
+	ni_stringbuf_destroy(&identifier);
+	return FALSE;
+}
+
 ni_bool_t
 xml_get_identifier(xml_reader_t *xr, ni_stringbuf_t *res)
 {
@@ -1012,6 +1293,8 @@ xml_location_free(xml_location_t *loc)
 static int
 xml_reader_open(xml_reader_t *xr, const char *filename)
 {
+	struct stat stb;
+
 	memset(xr, 0, sizeof(*xr));
 	xr->filename = filename;
 
@@ -1021,7 +1304,28 @@ xml_reader_open(xml_reader_t *xr, const char *filename)
 		return -1;
 	}
 
-	xr->buffer = xmalloc(XML_READER_BUFSZ);
+	/* Regular files are mapped read-only and tokenized straight from
+	 * the mapping; this avoids copying the content through the stdio
+	 * chunk buffer. Anything that cannot be mapped (pipes, empty or
+	 * special files) falls back to the stdio path below. */
+	if (fstat(fileno(xr->file), &stb) >= 0
+	 && S_ISREG(stb.st_mode) && stb.st_size > 0) {
+		void *map;
+
+		map = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fileno(xr->file), 0);
+		if (map != MAP_FAILED) {
+			xr->mapped = map;
+			xr->mapped_size = stb.st_size;
+			madvise(map, stb.st_size, MADV_SEQUENTIAL);
+			ni_buffer_init_reader(&xr->map_buffer, map, stb.st_size);
+			xr->in_buffer = &xr->map_buffer;
+			fclose(xr->file);
+			xr->file = NULL;
+		}
+	}
+
+	if (xr->file)
+		xr->buffer = xmalloc(XML_READER_BUFSZ);
 	xr->state = Initial;
 	xr->lineCount = 1;
 	xr->shared_location = xml_location_shared_new(filename);
@@ -1080,6 +1384,11 @@ xml_reader_destroy(xml_reader_t *xr)
 		free(xr->buffer);
 		xr->buffer = NULL;
 	}
+	if (xr->mapped) {
+		munmap(xr->mapped, xr->mapped_size);
+		xr->mapped = NULL;
+		xr->in_buffer = NULL;
+	}
 
 	if (xr->shared_location) {
 		xml_location_shared_release(xr->shared_location);
@@ -8,10 +8,12 @@
 #endif
 
 #include <limits.h>
+#include <sys/stat.h>
 
 #include <wicked/logging.h>
 #include <wicked/xml.h>
 #include <wicked/logging.h>
+#include <wicked/netinfo.h>
 #include "xml-schema.h"
 #include "util_priv.h"
 
@@ -27,6 +29,7 @@ static ni_xs_type_t *	ni_xs_build_simple_type(xml_node_t *, const char *, ni_xs_
 static ni_xs_type_t *	ni_xs_build_complex_type(xml_node_t *, const char *, ni_xs_scope_t *);
 static void		ni_xs_name_type_array_copy(ni_xs_name_type_array_t *, const ni_xs_name_type_array_t *);
 static void		ni_xs_name_type_array_destroy(ni_xs_name_type_array_t *);
+static void		ni_xs_name_type_index_destroy(ni_xs_name_type_array_t *);
 static ni_xs_type_t *	ni_xs_build_one_type(xml_node_t *, ni_xs_scope_t *);
 static void		ni_xs_service_free(ni_xs_service_t *);
 static ni_bool_t	ni_xs_type_build_constraints(ni_xs_type_t **, const xml_node_t *, ni_xs_group_array_t *);
@@ -280,6 +283,7 @@ ni_xs_type_free(ni_xs_type_t *type)
 
 	ni_string_free(&type->description);
 	ni_string_free(&type->name);
+	ni_string_free(&type->dbus_signature);
 	free(type);
 }
 
@@ -322,6 +326,7 @@ ni_xs_name_type_array_destroy(ni_xs_name_type_array_t *array)
 		ni_string_free(&def->name);
 		ni_xs_type_release(def->type);
 	}
+	ni_xs_name_type_index_destroy(array);
 	free(array->data);
 	memset(array, 0, sizeof(*array));
 }
@@ -338,6 +343,9 @@ ni_xs_name_type_array_append(ni_xs_name_type_array_t *array, const char *name, n
 {
 	ni_xs_name_type_t *def;
 
+	/* entries may move and the set changes; rebuild index on demand */
+	ni_xs_name_type_index_destroy(array);
+
 	if ((array->count % 32) == 0) {
 		array->data = xrealloc(array->data, (array->count + 32) * sizeof(array->data[0]));
 	}
@@ -359,12 +367,89 @@ ni_xs_name_type_array_copy(ni_xs_name_type_array_t *dst, const ni_xs_name_type_a
 		ni_xs_name_type_array_append(dst, def->name, def->type, def->description);
 }
 
+/*
+ * The schema is static once parsed, but serialization looks up dict
+ * and struct members by name for every xml node and dict entry it
+ * processes. Instead of a linear scan per lookup, build a sorted
+ * index over the entries on first use and binary-search it from then
+ * on. Appending to the array invalidates the index, so it is rebuilt
+ * should a schema ever change after use.
+ */
+#define NI_XS_NAME_TYPE_INDEX_MIN	8
+
+struct ni_xs_name_type_index {
+	unsigned int			count;
+	const ni_xs_name_type_t **	data;
+};
+
+static void
+ni_xs_name_type_index_destroy(ni_xs_name_type_array_t *array)
+{
+	if (array->index) {
+		free(array->index->data);
+		free(array->index);
+		array->index = NULL;
+	}
+}
+
+static int
+__ni_xs_name_type_index_cmp(const void *pa, const void *pb)
+{
+	const ni_xs_name_type_t *a = *(const ni_xs_name_type_t **) pa;
+	const ni_xs_name_type_t *b = *(const ni_xs_name_type_t **) pb;
+
+	return strcmp(a->name, b->name);
+}
+
+static ni_xs_name_type_index_t *
+ni_xs_name_type_index_build(const ni_xs_name_type_array_t *array)
+{
+	/* the index is a mutable cache on a const array */
+	ni_xs_name_type_array_t *mutable = (ni_xs_name_type_array_t *) array;
+	ni_xs_name_type_index_t *index;
+	unsigned int i;
+
+	index = xcalloc(1, sizeof(*index));
+	index->data = xcalloc(array->count, sizeof(index->data[0]));
+	for (i = 0; i < array->count; ++i)
+		index->data[i] = &array->data[i];
+	index->count = array->count;
+	qsort(index->data, index->count, sizeof(index->data[0]),
+			__ni_xs_name_type_index_cmp);
+
+	mutable->index = index;
+	return index;
+}
+
 static ni_xs_type_t *
 ni_xs_name_type_array_find_local(const ni_xs_name_type_array_t *array, const char *name)
 {
 	ni_xs_name_type_t *def;
 	unsigned int i;
 
+	if (array->count >= NI_XS_NAME_TYPE_INDEX_MIN) {
+		const ni_xs_name_type_index_t *index = array->index;
+		unsigned int lo, hi;
+
+		if (!index)
+			index = ni_xs_name_type_index_build(array);
+
+		lo = 0;
+		hi = index->count;
+		while (lo < hi) {
+			unsigned int mid = lo + (hi - lo) / 2;
+			int cmp = strcmp(index->data[mid]->name, name);
+
+			if (cmp == 0)
+				return index->data[mid]->type;
+			if (cmp < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return NULL;
+	}
+
 	for (i = 0, def = array->data; i < array->count; ++i, ++def) {
 		if (!strcmp(def->name, name))
 			return def->type;
@@ -606,6 +691,119 @@ ni_xs_is_reserved_name(const char *name)
 	return __string_is_in_list(name, reserved);
 }
 
+#ifdef NI_ENABLE_EMBEDDED_SCHEMA
+/*
+ * Look up a schema file in the compiled-in table. Entries are keyed
+ * on the basename, which is also how <include> elements refer to
+ * their sibling schema files.
+ */
+static const ni_xs_embedded_schema_t *
+ni_xs_embedded_schema_find(const char *filename)
+{
+	const ni_xs_embedded_schema_t *emb;
+	const char *name;
+
+	if ((name = strrchr(filename, '/')) != NULL)
+		name++;
+	else
+		name = filename;
+
+	for (emb = ni_xs_embedded_schema_files; emb->name; ++emb) {
+		if (ni_string_eq(emb->name, name))
+			return emb;
+	}
+	return NULL;
+}
+
+/*
+ * An on-disk schema file overrides the embedded copy when its contents
+ * differ. The caller has already rejected size mismatches via stat(),
+ * so only a size-preserving edit costs a content compare here.
+ */
+static ni_bool_t
+ni_xs_embedded_schema_unmodified(const ni_xs_embedded_schema_t *emb, const char *filename)
+{
+	char *data;
+	FILE *fp;
+	ni_bool_t match;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+		return FALSE;
+
+	data = xmalloc(emb->size);
+	match = fread(data, 1, emb->size, fp) == emb->size &&
+		getc(fp) == EOF &&
+		memcmp(data, emb->data, emb->size) == 0;
+	free(data);
+	fclose(fp);
+	return match;
+}
+#endif
+
+/*
+ * Read a schema file, going through a binary cache of the parsed
+ * document under the statedir. The schema files only change on package
+ * update, but tokenizing all of them dominated daemon and client
+ * startup; loading the binary dump skips the XML parse entirely.
+ * The cache is validated against the source file's mtime, and all cache
+ * failures (stale, corrupt, unwritable statedir) silently fall back to
+ * parsing the XML.
+ *
+ * When configured with --enable-embedded-schema, an unmodified (or
+ * absent) schema file is served straight from the compiled-in copy,
+ * so the whole cache machinery and its stat storm are skipped; an
+ * on-disk file that differs from the embedded copy still wins.
+ */
+static xml_document_t *
+ni_xs_read_schema_document(const char *filename)
+{
+	struct stat stb, cstb;
+	xml_document_t *doc = NULL;
+	char *cachefile = NULL;
+	const unsigned char *sp;
+	unsigned int hash;
+#ifdef NI_ENABLE_EMBEDDED_SCHEMA
+	const ni_xs_embedded_schema_t *emb;
+
+	if ((emb = ni_xs_embedded_schema_find(filename)) != NULL) {
+		if (stat(filename, &stb) < 0 ||
+		    ((size_t) stb.st_size == emb->size &&
+		     ni_xs_embedded_schema_unmodified(emb, filename))) {
+			ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_XML,
+				"%s: using embedded schema", filename);
+			return xml_document_from_string(emb->data, filename);
+		}
+		/* the on-disk file exists and differs - it overrides */
+	}
+#endif
+
+	if (stat(filename, &stb) < 0)
+		return xml_document_read(filename);
+
+	/* key the cache file on a hash of the full source path */
+	hash = 5381;
+	for (sp = (const unsigned char *) filename; *sp; ++sp)
+		hash = ((hash << 5) + hash) + *sp;
+	ni_string_printf(&cachefile, "%s/schema-%08x.xbin", ni_config_statedir(), hash);
+
+	if (stat(cachefile, &cstb) >= 0 && cstb.st_mtime >= stb.st_mtime) {
+		if ((doc = xml_document_read_binary(cachefile)) != NULL) {
+			ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_XML,
+				"%s: loaded from cache %s", filename, cachefile);
+			goto out;
+		}
+	}
+
+	if ((doc = xml_document_read(filename)) != NULL) {
+		/* best effort - a read-only statedir is not an error */
+		xml_document_write_binary(doc, cachefile);
+	}
+
+out:
+	ni_string_free(&cachefile);
+	return doc;
+}
+
 /*
  * Parse an XML schema file and process it
  */
@@ -622,7 +820,7 @@ ni_xs_process_schema_file(const char *filename, ni_xs_scope_t *scope)
 		return -1;
 	}
 
-	doc = xml_document_read(filename);
+	doc = ni_xs_read_schema_document(filename);
 	if (doc == NULL) {
 		ni_error("cannot parse schema file \"%s\"", filename);
 		return -1;
@@ -799,7 +997,7 @@ ni_xs_process_method(xml_node_t *node, ni_xs_service_t *service, ni_xs_scope_t *
 			if (method->meta == NULL)
 				method->meta = xml_node_new("meta", NULL);
 			xml_node_reparent(method->meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 
@@ -1297,7 +1495,7 @@ ni_xs_build_simple_type(xml_node_t *node, const char *typeName, ni_xs_scope_t *s
 			if (meta == NULL)
 				meta = xml_node_new("meta", NULL);
 			xml_node_reparent(meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 	if (meta) {
@@ -1475,6 +1673,7 @@ __ni_xs_intmap_free(ni_intmap_t *map)
 	ni_intmap_t *p;
 
 	if (map != NULL) {
+		ni_intmap_index_drop(map);
 		for (p = map; p->name; ++p)
 			free((char *) p->name);
 		free(map);
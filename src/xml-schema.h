@@ -177,9 +177,14 @@ struct ni_xs_name_type {
 	char *			description;
 };
 
+typedef struct ni_xs_name_type_index ni_xs_name_type_index_t;
+
 typedef struct ni_xs_name_type_array {
 	unsigned int		count;
 	ni_xs_name_type_t *	data;
+
+	/* lazily built name lookup index, see xml-schema.c */
+	ni_xs_name_type_index_t *index;
 } ni_xs_name_type_array_t;
 
 typedef struct ni_xs_intmap {
@@ -294,6 +299,16 @@ struct ni_xs_type {
 
 	/* <meta> node holding additional information */
 	xml_node_t *		meta;
+
+	/* lazily computed by the validator: 1 when no <meta> exists
+	 * anywhere in this type subtree (validation verdicts can be
+	 * memoized), -1 when there is one, 2 while the scan is in
+	 * progress, 0 when not scanned yet */
+	int			meta_scan;
+
+	/* dbus signature of this type, memoized by dbus-xml.c on
+	 * first use; the schema is immutable once it has been loaded */
+	char *			dbus_signature;
 };
 
 struct ni_xs_method {
@@ -344,6 +359,18 @@ struct ni_xs_scope {
 	} defined_by;
 };
 
+/*
+ * Schema file compiled into libwicked (--enable-embedded-schema);
+ * the table is generated by util/mkembed and keyed on the basename.
+ */
+typedef struct ni_xs_embedded_schema {
+	const char *		name;
+	size_t			size;
+	const char *		data;
+} ni_xs_embedded_schema_t;
+
+extern const ni_xs_embedded_schema_t	ni_xs_embedded_schema_files[];
+
 extern ni_xs_scope_t *	ni_xs_scope_new(ni_xs_scope_t *, const char *);
 extern void		ni_xs_scope_free(ni_xs_scope_t *);
 extern const ni_xs_scope_t *ni_xs_scope_lookup_scope(const ni_xs_scope_t *, const char *);
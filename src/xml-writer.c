@@ -43,7 +43,10 @@ static int		xml_writer_init_hash(xml_writer_t *, ni_hashctx_algo_t);
 static int		xml_writer_close(xml_writer_t *);
 static int		xml_writer_destroy(xml_writer_t *);
 static int		xml_writer_destroy_get_hash(xml_writer_t *, void *, size_t);
-static void		xml_writer_printf(xml_writer_t *, const char *, ...);
+static void		xml_writer_put(xml_writer_t *, const char *, size_t);
+static void		xml_writer_puts(xml_writer_t *, const char *);
+static void		xml_writer_indent(xml_writer_t *, unsigned int);
+static void		xml_writer_reserve(xml_writer_t *, const xml_node_t *);
 
 static void		xml_document_output(const xml_document_t *, xml_writer_t *);
 static void		xml_node_output(const xml_node_t *node, xml_writer_t *, unsigned int indent);
@@ -139,7 +142,8 @@ xml_document_uuid(const xml_document_t *doc, unsigned int version,
 void
 xml_document_output(const xml_document_t *doc, xml_writer_t *writer)
 {
-	xml_writer_printf(writer, "<?xml version=\"1.0\" encoding=\"utf8\"?>\n");
+	xml_writer_reserve(writer, doc->root);
+	xml_writer_puts(writer, "<?xml version=\"1.0\" encoding=\"utf8\"?>\n");
 	xml_node_output(doc->root, writer, 0);
 }
 
@@ -150,6 +154,7 @@ xml_node_print(const xml_node_t *node, FILE *fp)
 	int rv = 0;
 
 	if (xml_writer_init_file(&writer, fp? fp : stdout) >= 0) {
+		xml_writer_reserve(&writer, node);
 		xml_node_output(node, &writer, 0);
 		rv = xml_writer_destroy(&writer);
 	}
@@ -233,7 +238,7 @@ xml_node_content_uuid(const xml_node_t *node, unsigned int version,
 	 * children/cdata, but without node name or attrs. */
 	temp = xml_node_clone(node, NULL);
 	ni_var_array_destroy(&temp->attrs);
-	ni_string_free(&temp->name);
+	xml_node_set_name(temp, NULL);
 
 	ret = xml_node_uuid(temp, version, namespace, uuid);
 	xml_node_free(temp);
@@ -293,20 +298,24 @@ xml_node_output(const xml_node_t *node, xml_writer_t *writer, unsigned int inden
 		ni_var_t *attr;
 		unsigned int i;
 
-		xml_writer_printf(writer, "%*.*s<%s", indent, indent, "", node->name);
+		xml_writer_indent(writer, indent);
+		xml_writer_puts(writer, "<");
+		xml_writer_puts(writer, node->name);
 		for (i = 0, attr = node->attrs.data; i < node->attrs.count; ++i, ++attr) {
-			if (attr->value)
-				xml_writer_printf(writer, " %s=\"%s\"",
-						attr->name, xml_escape_quote(attr->value));
-			else
-				xml_writer_printf(writer, " %s", attr->name);
+			xml_writer_puts(writer, " ");
+			xml_writer_puts(writer, attr->name);
+			if (attr->value) {
+				xml_writer_puts(writer, "=\"");
+				xml_writer_puts(writer, xml_escape_quote(attr->value));
+				xml_writer_puts(writer, "\"");
+			}
 		}
 
 		if (node->cdata == NULL && node->children == NULL) {
-			xml_writer_printf(writer, "/>\n");
+			xml_writer_puts(writer, "/>\n");
 			return;
 		}
-		xml_writer_printf(writer, ">");
+		xml_writer_puts(writer, ">");
 		child_indent += 2;
 	} else {
 		newline = 1;
@@ -317,23 +326,23 @@ xml_node_output(const xml_node_t *node, xml_writer_t *writer, unsigned int inden
 		char *temp = NULL;
 
 		if (strchr(node->cdata, '\n')) {
-			xml_writer_printf(writer, "\n");
+			xml_writer_puts(writer, "\n");
 			newline = 1;
 		}
-		xml_writer_printf(writer, "%s", xml_escape_entities(node->cdata, &temp));
+		xml_writer_puts(writer, xml_escape_entities(node->cdata, &temp));
 		ni_string_free(&temp);
 
 		if (newline) {
 			len = strlen(node->cdata);
 			if (len && node->cdata[len-1] != '\n')
-				xml_writer_printf(writer, "\n");
+				xml_writer_puts(writer, "\n");
 		}
 	}
 	if (node->children) {
 		xml_node_t *child;
 
 		if (!newline)
-			xml_writer_printf(writer, "\n");
+			xml_writer_puts(writer, "\n");
 		for (child = node->children; child; child = child->next)
 			xml_node_output(child, writer, child_indent);
 		newline = 1;
@@ -341,8 +350,10 @@ xml_node_output(const xml_node_t *node, xml_writer_t *writer, unsigned int inden
 
 	if (node->name != NULL) {
 		if (newline)
-			xml_writer_printf(writer, "%*.*s", indent, indent, "");
-		xml_writer_printf(writer, "</%s>\n", node->name);
+			xml_writer_indent(writer, indent);
+		xml_writer_puts(writer, "</");
+		xml_writer_puts(writer, node->name);
+		xml_writer_puts(writer, ">\n");
 	}
 }
 
@@ -402,6 +413,7 @@ int
 xml_writer_open(xml_writer_t *writer, const char *filename)
 {
 	memset(writer, 0, sizeof(*writer));
+	ni_stringbuf_init(&writer->buffer);
 	writer->file = fopen(filename, "w");
 	if (!writer->file) {
 		ni_error("xml_writer: cannot open %s for writing: %m", filename);
@@ -415,6 +427,7 @@ int
 xml_writer_init_file(xml_writer_t *writer, FILE *file)
 {
 	memset(writer, 0, sizeof(*writer));
+	ni_stringbuf_init(&writer->buffer);
 	writer->file = file;
 	writer->noclose = 1;
 	return 0;
@@ -424,6 +437,7 @@ int
 xml_writer_init_hash(xml_writer_t *writer, ni_hashctx_algo_t algo)
 {
 	memset(writer, 0, sizeof(*writer));
+	ni_stringbuf_init(&writer->buffer);
 	writer->hash = ni_hashctx_new(algo);
 	if (writer->hash)
 		return 0;
@@ -435,6 +449,13 @@ xml_writer_close(xml_writer_t *writer)
 {
 	int rv = 0;
 
+	/* file writers serialize into the buffer; flush it in one write */
+	if (writer->file && writer->buffer.len) {
+		if (fwrite(writer->buffer.string, 1, writer->buffer.len,
+					writer->file) != writer->buffer.len)
+			rv = -1;
+		ni_stringbuf_clear(&writer->buffer);
+	}
 	if (writer->file && ferror(writer->file))
 		rv = -1;
 	if (writer->file && !writer->noclose) {
@@ -451,8 +472,11 @@ xml_writer_close(xml_writer_t *writer)
 int
 xml_writer_destroy(xml_writer_t *writer)
 {
+	int rv;
+
+	rv = xml_writer_close(writer);
 	ni_stringbuf_destroy(&writer->buffer);
-	return xml_writer_close(writer);
+	return rv;
 }
 
 int
@@ -470,20 +494,69 @@ xml_writer_destroy_get_hash(xml_writer_t *writer, void *md_buffer, size_t md_siz
 }
 
 void
-xml_writer_printf(xml_writer_t *writer, const char *fmt, ...)
+xml_writer_put(xml_writer_t *writer, const char *data, size_t len)
 {
-	char temp[256];
-	va_list ap;
+	if (writer->hash)
+		ni_hashctx_put(writer->hash, data, len);
+	else
+		ni_stringbuf_put(&writer->buffer, data, len);
+}
 
-	va_start(ap, fmt);
-	if (writer->file) {
-		vfprintf(writer->file, fmt, ap);
-	} else {
-		vsnprintf(temp, sizeof(temp), fmt, ap);
-		if (writer->hash)
-			ni_hashctx_puts(writer->hash, temp);
-		else
-			ni_stringbuf_puts(&writer->buffer, temp);
+void
+xml_writer_puts(xml_writer_t *writer, const char *string)
+{
+	if (string)
+		xml_writer_put(writer, string, strlen(string));
+}
+
+void
+xml_writer_indent(xml_writer_t *writer, unsigned int indent)
+{
+	static const char spaces[] = "                ";
+
+	while (indent) {
+		unsigned int chunk = indent;
+
+		if (chunk > sizeof(spaces) - 1)
+			chunk = sizeof(spaces) - 1;
+		xml_writer_put(writer, spaces, chunk);
+		indent -= chunk;
 	}
-	va_end(ap);
+}
+
+/*
+ * Estimate the serialized size of a subtree and pre-grow the output
+ * buffer, so a large dump is emitted with memcpy appends into a single
+ * allocation instead of growing it piecemeal. The estimate ignores
+ * entity expansion; the buffer still grows on demand if it is short.
+ */
+static size_t
+xml_node_output_size(const xml_node_t *node, unsigned int indent)
+{
+	const xml_node_t *child;
+	const ni_var_t *attr;
+	unsigned int i;
+	size_t size = indent + 8;
+
+	if (node->name)
+		size += 2 * strlen(node->name) + indent;
+	if (node->cdata)
+		size += strlen(node->cdata) + 2;
+	for (i = 0, attr = node->attrs.data; i < node->attrs.count; ++i, ++attr) {
+		size += strlen(attr->name) + 4;
+		if (attr->value)
+			size += strlen(attr->value);
+	}
+	for (child = node->children; child; child = child->next)
+		size += xml_node_output_size(child, indent + 2);
+
+	return size;
+}
+
+void
+xml_writer_reserve(xml_writer_t *writer, const xml_node_t *node)
+{
+	if (writer->hash || node == NULL)
+		return;
+	ni_stringbuf_grow(&writer->buffer, xml_node_output_size(node, 0) + 64);
 }
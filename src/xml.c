@@ -31,6 +31,206 @@
 #define XML_DOCUMENTARRAY_CHUNK		1
 #define XML_NODEARRAY_CHUNK		8
 
+/*
+ * Element names are drawn from a small, schema-defined vocabulary, but
+ * repeated enormously often in large documents. We intern them in a
+ * refcounted atom table, so that each distinct name is stored just once
+ * and comparing two interned names reduces to pointer equality.
+ *
+ * Note that node->name must never be freed or reassigned directly;
+ * use xml_node_set_name for renames.
+ */
+#define XML_NAME_HASH_NBUCKETS	256
+
+typedef struct xml_name_atom xml_name_atom_t;
+struct xml_name_atom {
+	xml_name_atom_t *	next;
+	unsigned int		refcount;
+	char			name[];
+};
+
+static xml_name_atom_t *	xml_name_buckets[XML_NAME_HASH_NBUCKETS];
+
+static unsigned int
+xml_name_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	while (*name)
+		hash = ((hash << 5) + hash) + (unsigned char) *name++;
+	return hash % XML_NAME_HASH_NBUCKETS;
+}
+
+static char *
+xml_name_get(const char *name)
+{
+	xml_name_atom_t **bucket = &xml_name_buckets[xml_name_hash(name)];
+	xml_name_atom_t *atom;
+
+	for (atom = *bucket; atom; atom = atom->next) {
+		if (!strcmp(atom->name, name)) {
+			atom->refcount++;
+			return atom->name;
+		}
+	}
+
+	atom = xmalloc(sizeof(*atom) + strlen(name) + 1);
+	atom->next = *bucket;
+	atom->refcount = 1;
+	strcpy(atom->name, name);
+	*bucket = atom;
+	return atom->name;
+}
+
+static void
+xml_name_put(char *name)
+{
+	xml_name_atom_t **pos, *atom;
+
+	if (name == NULL)
+		return;
+
+	pos = &xml_name_buckets[xml_name_hash(name)];
+	while ((atom = *pos) != NULL) {
+		if (atom->name == name) {
+			if (--(atom->refcount) == 0) {
+				*pos = atom->next;
+				free(atom);
+			}
+			return;
+		}
+		pos = &atom->next;
+	}
+	ni_warn("%s: attempt to release unknown xml name \"%s\"", __func__, name);
+}
+
+/* Interned names are equal iff the pointers are; fall back to strcmp
+ * for caller supplied strings. */
+static inline ni_bool_t
+xml_name_eq(const char *a, const char *b)
+{
+	return a == b || (a && b && !strcmp(a, b));
+}
+
+/*
+ * Node objects are created and torn down in large batches - a config
+ * or state document is usually built, consumed and freed as a unit.
+ * Nodes are refcounted, can be reparented and may well outlive the
+ * document they were parsed from (policies, clone_ref), so we cannot
+ * tie their storage to the document. Instead, recycle the fixed-size
+ * node objects through a free list, which takes the bulk of the
+ * malloc/free traffic out of parsing and freeing documents.
+ */
+#define XML_NODE_CACHE_MAX	1024
+
+static xml_node_t *		xml_node_cache;		/* chained via ->next */
+static unsigned int		xml_node_cache_count;
+
+static xml_node_t *
+xml_node_alloc(void)
+{
+	xml_node_t *node;
+
+	if ((node = xml_node_cache) != NULL) {
+		xml_node_cache = node->next;
+		xml_node_cache_count--;
+		memset(node, 0, sizeof(*node));
+		return node;
+	}
+	ni_memstats_alloc(NI_MEMTAG_XML, sizeof(xml_node_t));
+	return xcalloc(1, sizeof(xml_node_t));
+}
+
+static void
+xml_node_dealloc(xml_node_t *node)
+{
+	if (xml_node_cache_count < XML_NODE_CACHE_MAX) {
+		node->next = xml_node_cache;
+		xml_node_cache = node;
+		xml_node_cache_count++;
+	} else {
+		ni_memstats_free(NI_MEMTAG_XML, sizeof(*node));
+		free(node);
+	}
+}
+
+/*
+ * Optional child-name index. Wide nodes (interface lists with thousands
+ * of children) get looked up by name over and over from the schema and
+ * dbus deserialization code; once a node has more than a handful of
+ * children, build a hash over them so the first-match lookup is O(1).
+ * The index is dropped whenever the child list or a child name changes
+ * and lazily rebuilt on the next lookup.
+ */
+#define XML_CHILD_INDEX_MIN	16
+
+typedef struct xml_child_index_entry xml_child_index_entry_t;
+struct xml_child_index_entry {
+	xml_child_index_entry_t *next;
+	xml_node_t *		node;
+};
+
+struct xml_child_index {
+	xml_child_index_entry_t *buckets[XML_NAME_HASH_NBUCKETS];
+};
+
+static void
+xml_child_index_free(xml_node_t *node)
+{
+	struct xml_child_index *index;
+	unsigned int i;
+
+	if ((index = node->child_index) == NULL)
+		return;
+	node->child_index = NULL;
+
+	for (i = 0; i < XML_NAME_HASH_NBUCKETS; ++i) {
+		xml_child_index_entry_t *entry;
+
+		while ((entry = index->buckets[i]) != NULL) {
+			index->buckets[i] = entry->next;
+			free(entry);
+		}
+	}
+	free(index);
+}
+
+static void
+xml_child_index_build(xml_node_t *node)
+{
+	struct xml_child_index *index = xcalloc(1, sizeof(*index));
+	xml_node_t *child;
+
+	for (child = node->children; child; child = child->next) {
+		xml_child_index_entry_t **tail, *entry;
+
+		if (child->name == NULL)
+			continue;
+
+		entry = xcalloc(1, sizeof(*entry));
+		entry->node = child;
+
+		/* append in document order, so that the first match wins */
+		tail = &index->buckets[xml_name_hash(child->name)];
+		while (*tail)
+			tail = &(*tail)->next;
+		*tail = entry;
+	}
+	node->child_index = index;
+}
+
+static xml_node_t *
+xml_child_index_lookup(const xml_node_t *node, const char *name)
+{
+	xml_child_index_entry_t *entry;
+
+	for (entry = node->child_index->buckets[xml_name_hash(name)]; entry; entry = entry->next) {
+		if (xml_name_eq(entry->node->name, name))
+			return entry->node;
+	}
+	return NULL;
+}
+
 xml_document_t *
 xml_document_new()
 {
@@ -87,6 +287,8 @@ xml_document_free(xml_document_t *doc)
 static inline void
 __xml_node_list_insert(xml_node_t **pos, xml_node_t *node, xml_node_t *parent)
 {
+	if (parent)
+		xml_child_index_free(parent);
 	node->parent = parent;
 	node->next = *pos;
 	*pos = node;
@@ -98,6 +300,8 @@ __xml_node_list_remove(xml_node_t **pos)
 	xml_node_t *np = *pos;
 
 	if (np) {
+		if (np->parent)
+			xml_child_index_free(np->parent);
 		np->parent = NULL;
 		*pos = np->next;
 		np->next = NULL;
@@ -141,9 +345,9 @@ xml_node_new(const char *ident, xml_node_t *parent)
 {
 	xml_node_t *node;
 
-	node = xcalloc(1, sizeof(xml_node_t));
+	node = xml_node_alloc();
 	if (ident)
-		node->name = xstrdup(ident);
+		node->name = xml_name_get(ident);
 
 	if (parent)
 		xml_node_add_child(parent, node);
@@ -216,9 +420,8 @@ xml_node_new_element_uint64(const char *ident, xml_node_t *parent, uint64_t valu
 xml_node_t *
 xml_node_clone(const xml_node_t *src, xml_node_t *parent)
 {
-	xml_node_t *dst, *child;
-	const ni_var_t *attr;
-	unsigned int i;
+	xml_node_t *dst, *clone, **tail;
+	const xml_node_t *child;
 
 	if (!src)
 		return NULL;
@@ -226,11 +429,20 @@ xml_node_clone(const xml_node_t *src, xml_node_t *parent)
 	dst = xml_node_new(src->name, parent);
 	ni_string_dup(&dst->cdata, src->cdata);
 
-	for (i = 0, attr = src->attrs.data; i < src->attrs.count; ++i, ++attr)
-		xml_node_add_attr(dst, attr->name, attr->value);
-
-	for (child = src->children; child; child = child->next)
-		xml_node_clone(child, dst);
+	/* bulk-copy the attributes; appending through xml_node_add_attr
+	 * would do a linear duplicate check per attribute */
+	ni_var_array_copy(&dst->attrs, &src->attrs);
+
+	/* keep our own tail pointer; xml_node_add_child re-walks the
+	 * sibling list on every append, which is quadratic when cloning
+	 * wide nodes */
+	tail = &dst->children;
+	for (child = src->children; child; child = child->next) {
+		clone = xml_node_clone(child, NULL);
+		clone->parent = dst;
+		*tail = clone;
+		tail = &clone->next;
+	}
 
 	dst->location = xml_location_clone(src->location);
 	return dst;
@@ -290,6 +502,7 @@ xml_node_free(xml_node_t *node)
 	if (--(node->refcount) != 0)
 		return;
 
+	xml_child_index_free(node);
 	while ((child = node->children) != NULL) {
 		node->children = child->next;
 		child->parent = NULL;
@@ -301,8 +514,27 @@ xml_node_free(xml_node_t *node)
 
 	ni_var_array_destroy(&node->attrs);
 	free(node->cdata);
-	free(node->name);
-	free(node);
+	xml_name_put(node->name);
+	xml_node_dealloc(node);
+}
+
+/*
+ * Rename a node (or clear its name by passing NULL). The name is an
+ * interned atom, so this is the only legal way to change it.
+ */
+void
+xml_node_set_name(xml_node_t *node, const char *name)
+{
+	char *oname = node->name;
+
+	/* get the new name before putting the old one; the caller may
+	 * pass a pointer into the current name */
+	node->name = name ? xml_name_get(name) : NULL;
+	xml_name_put(oname);
+
+	/* any index over the siblings is stale now */
+	if (node->parent)
+		xml_child_index_free(node->parent);
 }
 
 void
@@ -460,8 +692,26 @@ xml_node_get_next_child(const xml_node_t *top, const char *name, const xml_node_
 
 	if (top == NULL)
 		return NULL;
+
+	/* For first-match lookups, use the child index on wide nodes.
+	 * Building it caches lookup state, hence the cast. */
+	if (cur == NULL) {
+		if (top->child_index == NULL) {
+			unsigned int count = 0;
+
+			for (child = top->children; child; child = child->next) {
+				if (++count >= XML_CHILD_INDEX_MIN) {
+					xml_child_index_build((xml_node_t *) top);
+					break;
+				}
+			}
+		}
+		if (top->child_index)
+			return xml_child_index_lookup(top, name);
+	}
+
 	for (child = cur ? cur->next : top->children; child; child = child->next) {
-		if (!strcmp(child->name, name))
+		if (xml_name_eq(child->name, name))
 			return child;
 	}
 
@@ -484,7 +734,7 @@ xml_node_get_child_with_attrs(const xml_node_t *node, const char *name,
 	xml_node_t *child;
 
 	for (child = node->children; child; child = child->next) {
-		if (!strcmp(child->name, name)
+		if (xml_name_eq(child->name, name)
 		 && xml_node_match_attrs(child, attrs))
 			return child;
 	}
@@ -499,7 +749,7 @@ xml_node_replace_child(xml_node_t *node, xml_node_t *newchild)
 
 	pos = &node->children;
 	while ((child = *pos) != NULL) {
-		if (!strcmp(child->name, newchild->name)) {
+		if (xml_name_eq(child->name, newchild->name)) {
 			__xml_node_list_drop(pos);
 			found = TRUE;
 		} else {
@@ -519,7 +769,7 @@ xml_node_delete_child(xml_node_t *node, const char *name)
 
 	pos = &node->children;
 	while ((child = *pos) != NULL) {
-		if (!strcmp(child->name, name)) {
+		if (xml_name_eq(child->name, name)) {
 			__xml_node_list_drop(pos);
 			found = TRUE;
 		} else {
@@ -684,7 +934,7 @@ xml_node_t *
 xml_node_get_next_named(xml_node_t *top, const char *name, xml_node_t *cur)
 {
 	while ((cur = xml_node_get_next(top, cur)) != NULL) {
-		if (!strcmp(cur->name, name))
+		if (xml_name_eq(cur->name, name))
 			return cur;
 	}
 
@@ -714,6 +964,126 @@ xml_node_match_attrs(const xml_node_t *node, const ni_var_array_t *attrlist)
 	return TRUE;
 }
 
+/*
+ * Structural document diff.
+ *
+ * Compares two trees and collects the minimal set of nodes that differ:
+ * nodes only present in the new tree (added), nodes only present in the
+ * old tree (removed), and new-tree nodes whose cdata or attributes
+ * changed (modified). Children are matched by name and by ordinal among
+ * same-named siblings, so repeated elements (addresses, routes) pair up
+ * in document order. Callers can walk the result to decide whether a
+ * change warrants a full reconfiguration or just touching the affected
+ * settings.
+ */
+static ni_bool_t
+__xml_node_attrs_equal(const xml_node_t *a, const xml_node_t *b)
+{
+	if (a->attrs.count != b->attrs.count)
+		return FALSE;
+	return xml_node_match_attrs(a, &b->attrs);
+}
+
+static const xml_node_t *
+__xml_diff_find_match(const xml_node_t *parent, const char *name, unsigned int ordinal)
+{
+	const xml_node_t *child;
+
+	for (child = parent->children; child; child = child->next) {
+		if (!xml_name_eq(child->name, name))
+			continue;
+		if (ordinal == 0)
+			return child;
+		ordinal--;
+	}
+	return NULL;
+}
+
+static ni_bool_t
+__xml_node_diff(const xml_node_t *onode, const xml_node_t *nnode, xml_diff_t *diff)
+{
+	const xml_node_t *child, *match;
+	unsigned int ordinal;
+	ni_bool_t changed = FALSE;
+
+	if (!ni_string_eq(onode->cdata, nnode->cdata)
+	 || !__xml_node_attrs_equal(onode, nnode)) {
+		xml_node_array_append(&diff->modified, (xml_node_t *) nnode);
+		changed = TRUE;
+	}
+
+	/* old children without a counterpart in the new tree are removed;
+	 * paired children recurse */
+	for (child = onode->children; child; child = child->next) {
+		ordinal = 0;
+		for (match = onode->children; match != child; match = match->next) {
+			if (xml_name_eq(match->name, child->name))
+				ordinal++;
+		}
+
+		if ((match = __xml_diff_find_match(nnode, child->name, ordinal)) == NULL) {
+			xml_node_array_append(&diff->removed, (xml_node_t *) child);
+			changed = TRUE;
+		} else if (__xml_node_diff(child, match, diff)) {
+			changed = TRUE;
+		}
+	}
+
+	/* new children without a counterpart in the old tree are added */
+	for (child = nnode->children; child; child = child->next) {
+		ordinal = 0;
+		for (match = nnode->children; match != child; match = match->next) {
+			if (xml_name_eq(match->name, child->name))
+				ordinal++;
+		}
+
+		if (__xml_diff_find_match(onode, child->name, ordinal) == NULL) {
+			xml_node_array_append(&diff->added, (xml_node_t *) child);
+			changed = TRUE;
+		}
+	}
+
+	return changed;
+}
+
+ni_bool_t
+xml_node_diff(const xml_node_t *onode, const xml_node_t *nnode, xml_diff_t *diff)
+{
+	if (onode == NULL && nnode == NULL)
+		return FALSE;
+	if (onode == NULL) {
+		xml_node_array_append(&diff->added, (xml_node_t *) nnode);
+		return TRUE;
+	}
+	if (nnode == NULL) {
+		xml_node_array_append(&diff->removed, (xml_node_t *) onode);
+		return TRUE;
+	}
+
+	if (!xml_name_eq(onode->name, nnode->name)) {
+		xml_node_array_append(&diff->removed, (xml_node_t *) onode);
+		xml_node_array_append(&diff->added, (xml_node_t *) nnode);
+		return TRUE;
+	}
+
+	return __xml_node_diff(onode, nnode, diff);
+}
+
+ni_bool_t
+xml_document_diff(const xml_document_t *odoc, const xml_document_t *ndoc, xml_diff_t *diff)
+{
+	return xml_node_diff(odoc ? odoc->root : NULL,
+			ndoc ? ndoc->root : NULL, diff);
+}
+
+void
+xml_diff_destroy(xml_diff_t *diff)
+{
+	xml_node_array_destroy(&diff->added);
+	xml_node_array_destroy(&diff->removed);
+	xml_node_array_destroy(&diff->modified);
+}
+
 /*
  * XML document arrays
  */
@@ -71,9 +71,97 @@ struct xpath_format {
 
 static xpath_format_t *	xpath_format_new(void);
 static xpath_fnode_t *	xpath_format_extend(xpath_format_t *);
+static xpath_format_t *	__xpath_format_compile(const char *);
+static void		__xpath_format_destroy(xpath_format_t *);
+
+/*
+ * Cache of compiled format templates, keyed by the format string.
+ *
+ * Callers expanding the same template again and again (per script
+ * invocation during lease-update storms) get the precompiled literal
+ * segments and expression trees back instead of re-parsing them; the
+ * embedded expressions additionally go through the expression cache
+ * in xpath.c. Unlike a compiled expression, a template carries per-eval
+ * result state, so a cached template is only handed out while nobody
+ * else holds it; concurrent holders get a fresh uncached copy.
+ */
+#define XPATH_FORMAT_CACHE_SIZE	16
+
+typedef struct xpath_format_cache_entry {
+	char *			format;
+	xpath_format_t *	pieces;
+	unsigned int		users;
+	unsigned int		stamp;
+} xpath_format_cache_entry_t;
+
+static xpath_format_cache_entry_t	__xpath_format_cache[XPATH_FORMAT_CACHE_SIZE];
+static unsigned int			__xpath_format_cache_clock;
+
+static xpath_format_t *
+xpath_format_cache_lookup(const char *format)
+{
+	xpath_format_cache_entry_t *entry;
+	unsigned int i;
+
+	for (i = 0, entry = __xpath_format_cache; i < XPATH_FORMAT_CACHE_SIZE; ++i, ++entry) {
+		if (entry->pieces && entry->users == 0
+		 && ni_string_eq(entry->format, format)) {
+			entry->users++;
+			entry->stamp = ++__xpath_format_cache_clock;
+			return entry->pieces;
+		}
+	}
+	return NULL;
+}
+
+static void
+xpath_format_cache_insert(const char *format, xpath_format_t *pieces)
+{
+	xpath_format_cache_entry_t *entry, *victim = NULL;
+	unsigned int i;
+
+	for (i = 0, entry = __xpath_format_cache; i < XPATH_FORMAT_CACHE_SIZE; ++i, ++entry) {
+		if (entry->pieces == NULL) {
+			victim = entry;
+			break;
+		}
+		if (entry->users == 0
+		 && (victim == NULL || entry->stamp < victim->stamp))
+			victim = entry;
+	}
+
+	/* every slot is held by a live user; hand out an uncached template */
+	if (victim == NULL)
+		return;
+
+	if (victim->pieces) {
+		__xpath_format_destroy(victim->pieces);
+		ni_string_free(&victim->format);
+	}
+	ni_string_dup(&victim->format, format);
+	victim->pieces = pieces;
+	victim->users = 1;
+	victim->stamp = ++__xpath_format_cache_clock;
+}
 
 xpath_format_t *
 xpath_format_parse(const char *format)
+{
+	xpath_format_t *pieces;
+
+	if (!format)
+		return NULL;
+
+	if ((pieces = xpath_format_cache_lookup(format)) != NULL)
+		return pieces;
+
+	if ((pieces = __xpath_format_compile(format)) != NULL)
+		xpath_format_cache_insert(format, pieces);
+	return pieces;
+}
+
+static xpath_format_t *
+__xpath_format_compile(const char *format)
 {
 	xpath_format_t *pieces;
 	xpath_fnode_t *cur = NULL;
@@ -138,7 +226,7 @@ xpath_format_parse(const char *format)
 	return pieces;
 
 failed:
-	xpath_format_free(pieces);
+	__xpath_format_destroy(pieces);
 	return NULL;
 }
 
@@ -224,6 +312,27 @@ xpath_format_new(void)
 
 void
 xpath_format_free(xpath_format_t *na)
+{
+	xpath_format_cache_entry_t *entry;
+	unsigned int i;
+
+	if (!na)
+		return;
+
+	/* cached templates stay resident for reuse; just drop the use count */
+	for (i = 0, entry = __xpath_format_cache; i < XPATH_FORMAT_CACHE_SIZE; ++i, ++entry) {
+		if (entry->pieces == na) {
+			if (entry->users)
+				entry->users--;
+			return;
+		}
+	}
+
+	__xpath_format_destroy(na);
+}
+
+static void
+__xpath_format_destroy(xpath_format_t *na)
 {
 	xpath_fnode_t *fnp;
 	unsigned int n;
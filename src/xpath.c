@@ -100,8 +100,8 @@ static void		xpath_enode_free(xpath_enode_t *);
 /*
  * Parse/compile an XPATH expression into a tree of nodes
  */
-xpath_enode_t *
-xpath_expression_parse(const char *expr)
+static xpath_enode_t *
+__xpath_expression_compile(const char *expr)
 {
 	const char *orig_expr = expr;
 	xpath_enode_t *tree;
@@ -161,9 +161,109 @@ xpath_expr_free(xpath_enode_t *enode, unsigned int depth, const char *info)
 	xpath_enode_free(enode);
 }
 
+/*
+ * Cache of compiled expressions, keyed by the expression string.
+ *
+ * The extension environment formatting re-parses the same handful of
+ * expressions on every lease update; keep the compiled trees around and
+ * hand them out again. Entries track how many callers currently hold
+ * the tree, so a tree handed out through xpath_expression_parse is
+ * never evicted while in use; xpath_expression_free just drops the use
+ * count for cached trees. Like the rest of this code, this is not
+ * thread safe.
+ */
+#define XPATH_EXPR_CACHE_SIZE	32
+
+typedef struct xpath_expr_cache_entry {
+	char *			expr;
+	xpath_enode_t *		tree;
+	unsigned int		users;
+	unsigned int		stamp;
+} xpath_expr_cache_entry_t;
+
+static xpath_expr_cache_entry_t	__xpath_expr_cache[XPATH_EXPR_CACHE_SIZE];
+static unsigned int		__xpath_expr_cache_clock;
+
+static xpath_enode_t *
+xpath_expr_cache_lookup(const char *expr)
+{
+	xpath_expr_cache_entry_t *entry;
+	unsigned int i;
+
+	for (i = 0, entry = __xpath_expr_cache; i < XPATH_EXPR_CACHE_SIZE; ++i, ++entry) {
+		if (entry->tree && ni_string_eq(entry->expr, expr)) {
+			entry->users++;
+			entry->stamp = ++__xpath_expr_cache_clock;
+			return entry->tree;
+		}
+	}
+	return NULL;
+}
+
+static void
+xpath_expr_cache_insert(const char *expr, xpath_enode_t *tree)
+{
+	xpath_expr_cache_entry_t *entry, *victim = NULL;
+	unsigned int i;
+
+	for (i = 0, entry = __xpath_expr_cache; i < XPATH_EXPR_CACHE_SIZE; ++i, ++entry) {
+		if (entry->tree == NULL) {
+			victim = entry;
+			break;
+		}
+		if (entry->users == 0
+		 && (victim == NULL || entry->stamp < victim->stamp))
+			victim = entry;
+	}
+
+	/* every slot is held by a live user; hand out an uncached tree */
+	if (victim == NULL)
+		return;
+
+	if (victim->tree) {
+		xpath_expr_free(victim->tree, 0, "evict");
+		ni_string_free(&victim->expr);
+	}
+	ni_string_dup(&victim->expr, expr);
+	victim->tree = tree;
+	victim->users = 1;
+	victim->stamp = ++__xpath_expr_cache_clock;
+}
+
+xpath_enode_t *
+xpath_expression_parse(const char *expr)
+{
+	xpath_enode_t *tree;
+
+	if (!expr)
+		return NULL;
+
+	if ((tree = xpath_expr_cache_lookup(expr)) != NULL)
+		return tree;
+
+	if ((tree = __xpath_expression_compile(expr)) != NULL)
+		xpath_expr_cache_insert(expr, tree);
+	return tree;
+}
+
 void
 xpath_expression_free(xpath_enode_t *enode)
 {
+	xpath_expr_cache_entry_t *entry;
+	unsigned int i;
+
+	if (!enode)
+		return;
+
+	/* cached trees stay resident for reuse; just drop the use count */
+	for (i = 0, entry = __xpath_expr_cache; i < XPATH_EXPR_CACHE_SIZE; ++i, ++entry) {
+		if (entry->tree == enode) {
+			if (entry->users)
+				entry->users--;
+			return;
+		}
+	}
+
 	xpath_expr_free(enode, 0, "expr ");
 }
 
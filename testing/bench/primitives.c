@@ -0,0 +1,223 @@
+/*
+ * Microbenchmarks for libwicked primitives.
+ *
+ * Each benchmark runs a fixed number of operations and reports ns/op,
+ * so primitive-level optimizations can be compared across changes.
+ * Iteration counts are deliberately constant (no calibration), which
+ * keeps successive runs comparable; rerun on an idle machine and
+ * compare ns/op.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <wicked/util.h>
+#include <wicked/xml.h>
+#include <wicked/xpath.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/dbus.h>
+
+#define BENCH_STRINGS		1000
+#define BENCH_VARS		100
+#define BENCH_XML_NODES		200
+#define BENCH_DICT_ENTRIES	64
+
+static char *			bench_xml_doc;
+
+static void
+bench_report(const char *name, unsigned long ops, const struct timespec *t0)
+{
+	struct timespec t1;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	ns = (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+	printf("%-24s %10lu ops %10.1f ms %10.1f ns/op\n",
+			name, ops, ns / 1e6, ns / ops);
+}
+
+static void
+bench_string_array_append(void)
+{
+	unsigned long iters = 200, i, j, ops;
+	struct timespec t0;
+
+	ops = iters * BENCH_STRINGS;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iters; ++i) {
+		ni_string_array_t array = NI_STRING_ARRAY_INIT;
+
+		for (j = 0; j < BENCH_STRINGS; ++j)
+			ni_string_array_append(&array, "some interface name");
+		ni_string_array_destroy(&array);
+	}
+	bench_report("string-array-append", ops, &t0);
+}
+
+static void
+bench_var_array_get(void)
+{
+	unsigned long ops = 1000000, i;
+	ni_var_array_t vars = NI_VAR_ARRAY_INIT;
+	char name[32];
+	struct timespec t0;
+
+	for (i = 0; i < BENCH_VARS; ++i) {
+		snprintf(name, sizeof(name), "variable%03lu", i);
+		ni_var_array_set(&vars, name, "value");
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; ++i) {
+		snprintf(name, sizeof(name), "variable%03lu", i % BENCH_VARS);
+		if (ni_var_array_get(&vars, name) == NULL)
+			ni_fatal("lookup of %s failed", name);
+	}
+	bench_report("var-array-get", ops, &t0);
+
+	ni_var_array_destroy(&vars);
+}
+
+static void
+bench_build_xml_doc(void)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int i;
+
+	ni_stringbuf_puts(&buf, "<interfaces>\n");
+	for (i = 0; i < BENCH_XML_NODES; ++i) {
+		ni_stringbuf_printf(&buf,
+			" <interface>\n"
+			"  <name>eth%u</name>\n"
+			"  <index>%u</index>\n"
+			"  <ipv4><address>10.%u.%u.1/24</address></ipv4>\n"
+			" </interface>\n",
+			i, i + 2, i / 250, i % 250);
+	}
+	ni_stringbuf_puts(&buf, "</interfaces>\n");
+	bench_xml_doc = strdup(buf.string);
+	ni_stringbuf_destroy(&buf);
+}
+
+static void
+bench_xml_document_read(void)
+{
+	unsigned long ops = 100, i;
+	struct timespec t0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; ++i) {
+		xml_document_t *doc;
+
+		if (!(doc = xml_document_from_string(bench_xml_doc, "bench")))
+			ni_fatal("unable to parse benchmark document");
+		xml_document_free(doc);
+	}
+	bench_report("xml-document-read", ops, &t0);
+}
+
+static void
+bench_xpath_parse_eval(void)
+{
+	unsigned long ops = 1000, i;
+	xml_document_t *doc;
+	struct timespec t0;
+
+	if (!(doc = xml_document_from_string(bench_xml_doc, "bench")))
+		ni_fatal("unable to parse benchmark document");
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; ++i) {
+		xpath_enode_t *enode;
+		xpath_result_t *result;
+
+		if (!(enode = xpath_expression_parse("/interface/name")))
+			ni_fatal("unable to parse xpath expression");
+		if (!(result = xpath_expression_eval(enode, doc->root)))
+			ni_fatal("unable to evaluate xpath expression");
+		xpath_result_free(result);
+		xpath_expression_free(enode);
+	}
+	bench_report("xpath-parse-eval", ops, &t0);
+
+	xml_document_free(doc);
+}
+
+static void
+bench_timer_noop(void *user_data, const ni_timer_t *timer)
+{
+}
+
+static void
+bench_timer_churn(void)
+{
+	unsigned long iters = 200, i, j, ops;
+	const ni_timer_t *timers[BENCH_STRINGS];
+	struct timespec t0;
+
+	ops = iters * BENCH_STRINGS;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iters; ++i) {
+		for (j = 0; j < BENCH_STRINGS; ++j)
+			timers[j] = ni_timer_register(3600000, bench_timer_noop, NULL);
+		for (j = BENCH_STRINGS; j--; )
+			ni_timer_cancel(timers[j]);
+	}
+	bench_report("timer-register-cancel", ops, &t0);
+}
+
+static void
+bench_dbus_dict_marshal(void)
+{
+	unsigned long ops = 10000, i, j;
+	char name[32];
+	struct timespec t0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; ++i) {
+		ni_dbus_variant_t dict = NI_DBUS_VARIANT_INIT;
+		DBusError error = DBUS_ERROR_INIT;
+		ni_dbus_message_t *msg;
+
+		ni_dbus_variant_init_dict(&dict);
+		for (j = 0; j < BENCH_DICT_ENTRIES; ++j) {
+			snprintf(name, sizeof(name), "property%02lu", j);
+			if (j & 1)
+				ni_dbus_dict_add_uint32(&dict, name, j);
+			else
+				ni_dbus_dict_add_string(&dict, name, "some property value");
+		}
+
+		msg = dbus_message_new_method_call("org.opensuse.Network",
+				"/org/opensuse/Network",
+				"org.opensuse.Network", "bench");
+		if (!msg || !ni_dbus_message_serialize_variants(msg, 1, &dict, &error))
+			ni_fatal("unable to marshal benchmark dict");
+		dbus_message_unref(msg);
+		dbus_error_free(&error);
+		ni_dbus_variant_destroy(&dict);
+	}
+	bench_report("dbus-dict-marshal", ops, &t0);
+}
+
+int
+main(int argc, char **argv)
+{
+	bench_build_xml_doc();
+
+	bench_string_array_append();
+	bench_var_array_get();
+	bench_xml_document_read();
+	bench_xpath_parse_eval();
+	bench_timer_churn();
+	bench_dbus_dict_marshal();
+
+	free(bench_xml_doc);
+	return 0;
+}
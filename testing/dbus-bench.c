@@ -0,0 +1,178 @@
+/*
+ * Benchmark the wickedd dbus call path.
+ *
+ * Drives a configurable number of concurrent InterfaceList.echo calls
+ * against a running wickedd and reports throughput and latency, so that
+ * changes to the marshalling code can be measured in isolation from the
+ * real method handlers.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/netinfo.h>
+#include <wicked/dbus.h>
+#include <wicked/objectmodel.h>
+
+#include "util_priv.h"
+
+static const char *	program_name;
+
+static unsigned int	opt_count = 1000;
+static unsigned int	opt_parallel = 1;
+static unsigned int	opt_payload = 64;
+
+static ni_dbus_object_t *list_object;
+static ni_dbus_variant_t call_arg = NI_DBUS_VARIANT_INIT;
+
+static unsigned int	nsubmitted;
+static unsigned int	ncompleted;
+static unsigned int	nerrors;
+static double *		latencies;	/* microseconds, one slot per call */
+
+struct bench_call {
+	struct timespec	sent;
+};
+
+static double
+elapsed_us(const struct timespec *since)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - since->tv_sec) * 1e6
+	     + (now.tv_nsec - since->tv_nsec) * 1e-3;
+}
+
+static void		bench_submit_one(void);
+
+static void
+bench_call_done(ni_dbus_object_t *proxy, ni_dbus_message_t *reply, void *user_data)
+{
+	struct bench_call *call = user_data;
+
+	latencies[ncompleted++] = elapsed_us(&call->sent);
+	if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR)
+		nerrors++;
+	free(call);
+
+	if (nsubmitted < opt_count)
+		bench_submit_one();
+}
+
+static void
+bench_submit_one(void)
+{
+	struct bench_call *call;
+	int rv;
+
+	call = xcalloc(1, sizeof(*call));
+	clock_gettime(CLOCK_MONOTONIC, &call->sent);
+
+	nsubmitted++;
+	rv = ni_dbus_object_call_variant_async(list_object,
+			NI_OBJECTMODEL_NETIFLIST_INTERFACE, "echo",
+			1, &call_arg,
+			bench_call_done, call);
+	if (rv < 0)
+		ni_fatal("unable to submit echo call: %s", ni_strerror(rv));
+}
+
+static int
+compare_double(const void *pa, const void *pb)
+{
+	double a = *(const double *) pa, b = *(const double *) pb;
+
+	return (a > b) - (a < b);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct timespec start;
+	ni_dbus_client_t *client;
+	char *payload;
+	double total_us, sum = 0;
+	unsigned int i;
+	int c;
+
+	program_name = ni_basename(argv[0]);
+
+	while ((c = getopt(argc, argv, "c:p:s:h")) != EOF) {
+		switch (c) {
+		case 'c':
+			if (ni_parse_uint(optarg, &opt_count, 10) < 0 || opt_count == 0)
+				ni_fatal("bad call count \"%s\"", optarg);
+			break;
+		case 'p':
+			if (ni_parse_uint(optarg, &opt_parallel, 10) < 0 || opt_parallel == 0)
+				ni_fatal("bad concurrency \"%s\"", optarg);
+			break;
+		case 's':
+			if (ni_parse_uint(optarg, &opt_payload, 10) < 0)
+				ni_fatal("bad payload size \"%s\"", optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-c count] [-p parallel] [-s payload-bytes]\n",
+				program_name);
+			return (c == 'h') ? 0 : 1;
+		}
+	}
+
+	if (ni_init(program_name) < 0)
+		return 1;
+
+	if (!(client = ni_create_dbus_client(NI_OBJECTMODEL_DBUS_BUS_NAME)))
+		ni_fatal("unable to connect to wickedd dbus service");
+
+	list_object = ni_dbus_client_object_new(client,
+			&ni_dbus_anonymous_class,
+			NI_OBJECTMODEL_NETIF_LIST_PATH,
+			NI_OBJECTMODEL_NETIFLIST_INTERFACE,
+			NULL);
+
+	payload = xcalloc(1, opt_payload + 1);
+	memset(payload, 'x', opt_payload);
+	ni_dbus_variant_set_string(&call_arg, payload);
+	free(payload);
+
+	latencies = xcalloc(opt_count, sizeof(latencies[0]));
+	if (opt_parallel > opt_count)
+		opt_parallel = opt_count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < opt_parallel; ++i)
+		bench_submit_one();
+
+	while (ncompleted < opt_count) {
+		if (ni_socket_wait(ni_timer_next_timeout()) != 0)
+			ni_fatal("ni_socket_wait failed");
+	}
+	total_us = elapsed_us(&start);
+
+	for (i = 0; i < opt_count; ++i)
+		sum += latencies[i];
+	qsort(latencies, opt_count, sizeof(latencies[0]), compare_double);
+
+	printf("%u calls, %u in flight, %u byte payload, %u errors\n",
+			opt_count, opt_parallel, opt_payload, nerrors);
+	printf("  elapsed:    %10.3f ms\n", total_us * 1e-3);
+	printf("  throughput: %10.0f calls/sec\n", opt_count / (total_us * 1e-6));
+	printf("  latency:    min %.1f us, avg %.1f us, p99 %.1f us, max %.1f us\n",
+			latencies[0], sum / opt_count,
+			latencies[(unsigned int) (0.99 * (opt_count - 1))],
+			latencies[opt_count - 1]);
+
+	ni_dbus_variant_destroy(&call_arg);
+	free(latencies);
+	return nerrors ? 1 : 0;
+}
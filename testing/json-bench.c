@@ -0,0 +1,194 @@
+/*
+ * Parse benchmark for the JSON routines.
+ *
+ * Generates a JSON-RPC style sample stream and compares parsing it as
+ * one document (buffer-then-parse) against the incremental stream
+ * parser fed in socket-sized chunks. Iteration counts are constant so
+ * successive runs stay comparable; rerun on an idle machine and compare
+ * ms per pass. An optional file argument benchmarks a sample document
+ * from disk instead of the generated one.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+
+#include "json.h"
+#include "buffer.h"
+
+#define BENCH_MESSAGES		5000	/* RPC messages in the sample stream */
+#define BENCH_PARAMS		32	/* parameters per message            */
+#define BENCH_CHUNK_SIZE	4096	/* feed granularity, like a socket   */
+#define BENCH_PASSES		10
+
+static void
+bench_report(const char *name, size_t bytes, unsigned long passes, const struct timespec *t0)
+{
+	struct timespec t1;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	ns = (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+	printf("%-24s %8.1f MB %6lu passes %10.1f ms/pass\n",
+			name, bytes / 1e6, passes, ns / 1e6 / passes);
+}
+
+/*
+ * Build one JSON-RPC style message as the OVSDB channel would send it.
+ */
+static ni_json_t *
+bench_sample_message(unsigned int id)
+{
+	ni_json_t *msg, *params;
+	char buf[64];
+	unsigned int i;
+
+	params = ni_json_new_array();
+	for (i = 0; i < BENCH_PARAMS; ++i) {
+		snprintf(buf, sizeof(buf), "parameter \"%u\" of message %u", i, id);
+		ni_json_array_append(params, ni_json_new_string(buf));
+		ni_json_array_append(params, ni_json_new_int64(i * id));
+	}
+
+	msg = ni_json_new_object();
+	ni_json_object_set(msg, "method", ni_json_new_string("transact"));
+	ni_json_object_set(msg, "id", ni_json_new_int64(id));
+	ni_json_object_set(msg, "params", params);
+	return msg;
+}
+
+/*
+ * The same payload in both framings: as one big array document for the
+ * buffer-then-parse baseline, and as a newline separated message stream
+ * for the incremental parser.
+ */
+static char *
+bench_sample_stream(ni_bool_t as_array)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned int i;
+
+	if (as_array)
+		ni_stringbuf_putc(&buf, '[');
+	for (i = 0; i < BENCH_MESSAGES; ++i) {
+		ni_json_t *msg = bench_sample_message(i);
+
+		if (i && as_array)
+			ni_stringbuf_putc(&buf, ',');
+		if (!ni_json_format_string(&buf, msg, NULL))
+			ni_fatal("unable to format sample message %u", i);
+		if (!as_array)
+			ni_stringbuf_putc(&buf, '\n');
+		ni_json_free(msg);
+	}
+	if (as_array)
+		ni_stringbuf_putc(&buf, ']');
+	return buf.string;	/* caller frees */
+}
+
+static void
+bench_parse_whole(const char *name, const char *text)
+{
+	size_t len = strlen(text);
+	struct timespec t0;
+	unsigned long pass;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (pass = 0; pass < BENCH_PASSES; ++pass) {
+		ni_buffer_t buf;
+		ni_json_t *json;
+
+		ni_buffer_init_reader(&buf, (char *)text, len);
+		if (!(json = ni_json_parse_buffer(&buf)))
+			ni_fatal("%s: unable to parse sample document", name);
+		ni_json_free(json);
+	}
+	bench_report(name, len, pass, &t0);
+}
+
+static void
+bench_stream_count(ni_json_t *json, void *user_data)
+{
+	unsigned long *count = user_data;
+
+	(*count)++;
+	ni_json_free(json);
+}
+
+static void
+bench_parse_stream(const char *name, const char *text)
+{
+	size_t len = strlen(text);
+	unsigned long pass, count;
+	struct timespec t0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (pass = 0; pass < BENCH_PASSES; ++pass) {
+		ni_json_stream_t *stream;
+		size_t off;
+
+		count = 0;
+		if (!(stream = ni_json_stream_new(bench_stream_count, &count)))
+			ni_fatal("unable to create json stream");
+
+		for (off = 0; off < len; off += BENCH_CHUNK_SIZE) {
+			size_t chunk = len - off;
+			ni_buffer_t buf;
+
+			if (chunk > BENCH_CHUNK_SIZE)
+				chunk = BENCH_CHUNK_SIZE;
+			ni_buffer_init_reader(&buf, (char *)text + off, chunk);
+			if (ni_json_stream_feed(stream, &buf) < 0)
+				ni_fatal("%s: stream feed failed at offset %zu", name, off);
+		}
+		ni_json_stream_free(stream);
+
+		if (count != BENCH_MESSAGES)
+			ni_fatal("%s: emitted %lu of %u values", name, count, BENCH_MESSAGES);
+	}
+	bench_report(name, len, pass, &t0);
+}
+
+static char *
+bench_read_file(const char *filename)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	char line[4096];
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "r")))
+		ni_fatal("cannot open %s: %m", filename);
+	while (fgets(line, sizeof(line), fp))
+		ni_stringbuf_puts(&buf, line);
+	fclose(fp);
+	return buf.string;
+}
+
+int
+main(int argc, char **argv)
+{
+	char *text;
+
+	if (argc > 1) {
+		text = bench_read_file(argv[1]);
+		bench_parse_whole("file-parse", text);
+		free(text);
+		return 0;
+	}
+
+	text = bench_sample_stream(TRUE);
+	bench_parse_whole("document-parse", text);
+	free(text);
+
+	text = bench_sample_stream(FALSE);
+	bench_parse_stream("stream-chunk-feed", text);
+	free(text);
+	return 0;
+}
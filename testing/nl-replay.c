@@ -0,0 +1,107 @@
+/*
+ * nl-replay -- feed a recorded rtnetlink stream through the regular
+ * event processing machinery, offline.
+ *
+ * The input file is produced by running wickedd (or one of the test
+ * daemons) with WICKED_NETLINK_CAPTURE=<file> in the environment; see
+ * src/nlcapture.c for the format. Replaying such a capture rebuilds
+ * the recorded interface topology in a local netconfig without
+ * touching the system, so refresh and event handling can be profiled
+ * against production-shaped data on a development machine, e.g.
+ *
+ *	perf record ./nl-replay -s 0 customer.wnlc
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+#include <wicked/logging.h>
+#include <wicked/netinfo.h>
+
+#include "netinfo_priv.h"
+#include "nlcapture.h"
+
+static const char *	program_name;
+
+struct replay_stats {
+	unsigned long	messages;
+	unsigned long	failed;
+};
+
+static int
+replay_handler(const ni_nlcapture_header_t *hdr, struct nlmsghdr *h, void *user_data)
+{
+	struct replay_stats *stats = user_data;
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+
+	stats->messages++;
+	if (ni_rtevent_replay(nc, h) < 0)
+		stats->failed++;
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct replay_stats stats = { 0, 0 };
+	unsigned int speedup = 0;
+	unsigned int devices = 0;
+	struct timeval begin, end, delta;
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+	double elapsed;
+	int c;
+
+	program_name = ni_basename(argv[0]);
+
+	while ((c = getopt(argc, argv, "s:h")) != -1) {
+		switch (c) {
+		case 's':
+			speedup = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+		default:
+			fprintf(stderr,
+				"Usage: %s [-s speedup] <capture-file>\n"
+				"  -s speedup\n"
+				"      Reproduce the recorded inter-message gaps divided by\n"
+				"      this factor; 1 replays in realtime, 0 (the default)\n"
+				"      replays as fast as possible.\n",
+				program_name);
+			return 1;
+		}
+	}
+	if (optind + 1 != argc) {
+		fprintf(stderr, "%s: expected exactly one capture file\n", program_name);
+		return 1;
+	}
+
+	if (ni_init(program_name) < 0)
+		return 1;
+
+	if ((nc = ni_global_state_handle(0)) == NULL)
+		ni_fatal("cannot allocate global state");
+
+	gettimeofday(&begin, NULL);
+	if (ni_nlcapture_replay(argv[optind], replay_handler, &stats, speedup) < 0)
+		return 1;
+	gettimeofday(&end, NULL);
+
+	timersub(&end, &begin, &delta);
+	elapsed = delta.tv_sec + delta.tv_usec / 1e6;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		devices++;
+
+	printf("replayed %lu messages (%lu not processed) in %.3f sec",
+			stats.messages, stats.failed, elapsed);
+	if (elapsed > 0.0)
+		printf(", %.0f msg/sec", stats.messages / elapsed);
+	printf("\nresulting topology: %u interfaces\n", devices);
+	return 0;
+}
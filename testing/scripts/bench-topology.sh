@@ -0,0 +1,171 @@
+#!/bin/bash
+#
+# Synthetic large-topology benchmark for wicked.
+#
+# Builds a bridge with N veth pairs as ports plus M vlans stacked on
+# the bridge, generates the matching XML configuration, and drives
+# `wicked ifup all`, a full refresh (show-xml), `wicked ifstatus all`
+# and `wicked ifdown all` against the running wickedd, recording wall
+# clock, CPU time and peak RSS of each client phase plus the daemon
+# RSS growth. The result is printed (or appended with -o) as one JSON
+# document per run, so scaling trends can be tracked across changes.
+#
+# Needs root and a running wickedd. All devices are named bench* and
+# removed again on exit.
+
+set -u
+
+NUM_VETH=32
+NUM_VLAN=8
+OUTPUT=""
+WICKED="${WICKED:-wicked}"
+TIME=/usr/bin/time
+
+usage()
+{
+	echo "Usage: `basename $0` [-n veth-pairs] [-v vlans] [-o result.json] [-w wicked-binary]"
+	exit 1
+}
+
+while getopts "n:v:o:w:h" opt; do
+	case $opt in
+	n) NUM_VETH=$OPTARG ;;
+	v) NUM_VLAN=$OPTARG ;;
+	o) OUTPUT=$OPTARG ;;
+	w) WICKED=$OPTARG ;;
+	*) usage ;;
+	esac
+done
+
+number='^[0-9]+$'
+[[ $NUM_VETH =~ $number && $NUM_VLAN =~ $number ]] || usage
+[ `id -u` -eq 0 ] || { echo "`basename $0`: must be run as root" >&2; exit 1; }
+[ -x "$TIME" ] || { echo "`basename $0`: $TIME not available" >&2; exit 1; }
+
+WORKDIR=`mktemp -d /tmp/wicked-bench.XXXXXX` || exit 1
+CONFDIR="$WORKDIR/ifconfig"
+mkdir -p "$CONFDIR"
+
+cleanup()
+{
+	local i
+
+	for ((i = 0; i < NUM_VLAN; i++)); do
+		ip link del "benchbr0.$((i + 10))" 2>/dev/null
+	done
+	for ((i = 0; i < NUM_VETH; i++)); do
+		ip link del "benchv$i" 2>/dev/null
+	done
+	ip link del benchbr0 2>/dev/null
+	rm -rf "$WORKDIR"
+}
+trap cleanup EXIT
+
+# write one XML interface config, body on stdin
+config()
+{
+	local name=$1
+
+	{
+		echo "<interface>"
+		echo " <name>$name</name>"
+		echo " <control><mode>boot</mode></control>"
+		cat
+		echo "</interface>"
+	} > "$CONFDIR/$name.xml"
+}
+
+# the veth pairs themselves are created by the kernel, not wicked;
+# the bridge enslaves the benchv ends, the benchp peers get addresses
+for ((i = 0; i < NUM_VETH; i++)); do
+	ip link add "benchv$i" type veth peer name "benchp$i" || exit 1
+done
+
+{
+	echo " <bridge>"
+	echo "  <ports>"
+	for ((i = 0; i < NUM_VETH; i++)); do
+		echo "   <port><device>benchv$i</device></port>"
+	done
+	echo "  </ports>"
+	echo " </bridge>"
+	echo " <ipv4:static>"
+	echo "  <address><local>192.0.2.1/24</local></address>"
+	echo " </ipv4:static>"
+} | config benchbr0
+
+for ((i = 0; i < NUM_VETH; i++)); do
+	{
+		echo " <ipv4:static>"
+		echo "  <address><local>10.231.$((i / 250)).$((i % 250 + 1))/16</local></address>"
+		echo " </ipv4:static>"
+	} | config "benchp$i"
+done
+
+for ((i = 0; i < NUM_VLAN; i++)); do
+	tag=$((i + 10))
+	{
+		echo " <vlan>"
+		echo "  <device>benchbr0</device>"
+		echo "  <tag>$tag</tag>"
+		echo " </vlan>"
+	} | config "benchbr0.$tag"
+done
+
+TOTAL=$((1 + 2 * NUM_VETH + NUM_VLAN))
+
+wickedd_rss()
+{
+	local pid=`pidof -s wickedd 2>/dev/null`
+
+	if [ -n "$pid" ]; then
+		awk '/^VmRSS:/ { print $2 }' "/proc/$pid/status"
+	else
+		echo 0
+	fi
+}
+
+PHASES=""
+COMMA=""
+
+# run one phase under time(1), collect wall/user/sys seconds and peak RSS
+phase()
+{
+	local name=$1 rc stats
+	shift
+
+	$TIME -f "%e %U %S %M" -o "$WORKDIR/time.$name" \
+		"$@" > "$WORKDIR/log.$name" 2>&1
+	rc=$?
+	stats=(`tail -1 "$WORKDIR/time.$name"`)
+	PHASES="$PHASES$COMMA
+    \"$name\": { \"exit\": $rc, \"wall_sec\": ${stats[0]}, \"user_sec\": ${stats[1]}, \"sys_sec\": ${stats[2]}, \"max_rss_kb\": ${stats[3]} }"
+	COMMA=","
+	[ $rc -eq 0 ] || echo "`basename $0`: phase $name exited with $rc, see $WORKDIR/log.$name" >&2
+}
+
+RSS_BEFORE=`wickedd_rss`
+
+phase ifup	$WICKED ifup     --ifconfig "wicked:$CONFDIR" all
+phase refresh	$WICKED show-xml
+phase ifstatus	$WICKED ifstatus --ifconfig "wicked:$CONFDIR" all
+phase ifdown	$WICKED ifdown   all
+
+RSS_AFTER=`wickedd_rss`
+
+RESULT="{
+  \"timestamp\": \"`date -u +%Y-%m-%dT%H:%M:%SZ`\",
+  \"veth_pairs\": $NUM_VETH,
+  \"vlans\": $NUM_VLAN,
+  \"interfaces\": $TOTAL,
+  \"phases\": {$PHASES
+  },
+  \"wickedd_rss_before_kb\": $RSS_BEFORE,
+  \"wickedd_rss_after_kb\": $RSS_AFTER
+}"
+
+if [ -n "$OUTPUT" ]; then
+	echo "$RESULT" >> "$OUTPUT"
+else
+	echo "$RESULT"
+fi
@@ -9,6 +9,7 @@
 
 #include <stdlib.h>
 #include <getopt.h>
+#include <time.h>
 #include <wicked/netinfo.h>
 #include <wicked/xpath.h>
 #include <wicked/logging.h>
@@ -16,20 +17,60 @@
 enum {
 	OPT_DEBUG,
 	OPT_REFERENCE,
+	OPT_BENCHMARK,
 };
 
 static struct option	options[] = {
 	{ "debug",		required_argument,	NULL,	OPT_DEBUG },
 	{ "reference",		required_argument,	NULL,	OPT_REFERENCE },
+	{ "benchmark",		required_argument,	NULL,	OPT_BENCHMARK },
 
 	{ NULL }
 };
 
+/*
+ * Parse and evaluate the expression @count times; with the compiled
+ * expression cache, all but the first iteration should skip parsing.
+ */
+static int
+xpath_benchmark(const char *expression, xml_node_t *refnode, unsigned int count)
+{
+	struct timespec t0, t1;
+	double elapsed;
+	unsigned int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < count; ++i) {
+		xpath_enode_t *enode;
+		xpath_result_t *result;
+
+		enode = xpath_expression_parse(expression);
+		if (!enode) {
+			fprintf(stderr, "Error parsing XPATH expression %s\n", expression);
+			return 1;
+		}
+		result = xpath_expression_eval(enode, refnode);
+		if (!result) {
+			fprintf(stderr, "Error evaluating XPATH expression\n");
+			return 1;
+		}
+		xpath_result_free(result);
+		xpath_expression_free(enode);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	printf("%u parse+eval iterations in %.3f sec (%.2f usec/iteration)\n",
+			count, elapsed, count? elapsed * 1e6 / count : 0.0);
+	return 0;
+}
+
 
 int
 main(int argc, char **argv)
 {
 	const char *opt_reference = NULL;
+	unsigned int opt_benchmark = 0;
 	const char *expression = NULL, *filename = "-";
 	xml_document_t *doc;
 	xml_node_t *refnode;
@@ -42,7 +83,7 @@ main(int argc, char **argv)
 		default:
 		usage:
 			fprintf(stderr,
-				"./xpath-test [--reference <expression>] <expression> [filename]\n"
+				"./xpath-test [--reference <expression>] [--benchmark <count>] <expression> [filename]\n"
 			       );
 			return 1;
 
@@ -57,6 +98,14 @@ main(int argc, char **argv)
 			opt_reference = optarg;
 			break;
 
+		case OPT_BENCHMARK:
+			opt_benchmark = strtoul(optarg, NULL, 0);
+			if (opt_benchmark == 0) {
+				fprintf(stderr, "Bad benchmark count \"%s\"\n", optarg);
+				return 1;
+			}
+			break;
+
 		}
 	}
 
@@ -104,6 +153,9 @@ main(int argc, char **argv)
 		xpath_expression_free(enode);
 	}
 
+	if (opt_benchmark)
+		return xpath_benchmark(expression, refnode, opt_benchmark);
+
 	enode = xpath_expression_parse(expression);
 	if (!enode) {
 		fprintf(stderr, "Error parsing XPATH expression %s\n", expression);
@@ -0,0 +1,108 @@
+/*
+ * This command line utility embeds the DBus XML schema files into
+ * a generated C table, compiled into libwicked when configured with
+ * --enable-embedded-schema.
+ *
+ * It deliberately links against nothing but libc: the generated file
+ * becomes part of libwicked itself, so unlike mkconst, this tool must
+ * be buildable before the library exists.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+static int	embed_file(const char *);
+
+int
+main(int argc, char **argv)
+{
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <schema file> ... > schema-embed.c\n", argv[0]);
+		return 1;
+	}
+
+	printf("/*\n"
+	       " * Embedded DBus XML schema files; generated by mkembed - do not edit.\n"
+	       " */\n"
+	       "#include <wicked/logging.h>\n"
+	       "#include \"xml-schema.h\"\n"
+	       "\n"
+	       "const ni_xs_embedded_schema_t	ni_xs_embedded_schema_files[] = {\n");
+
+	for (i = 1; i < argc; ++i) {
+		if (embed_file(argv[i]) < 0)
+			return 1;
+	}
+
+	printf("\n\t{ NULL, 0, NULL }\n"
+	       "};\n");
+
+	if (fflush(stdout) < 0 || ferror(stdout)) {
+		fprintf(stderr, "%s: write error\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Emit one { name, size, data } table entry, quoting the file
+ * contents as a C string literal, one literal per input line.
+ * The table is keyed on the basename, matching how the schema
+ * reader looks up include files.
+ */
+static int
+embed_file(const char *filename)
+{
+	const char *name;
+	struct stat stb;
+	FILE *fp;
+	int c;
+
+	if (stat(filename, &stb) < 0 || (fp = fopen(filename, "r")) == NULL) {
+		fprintf(stderr, "cannot open %s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	if ((name = strrchr(filename, '/')) != NULL)
+		name++;
+	else
+		name = filename;
+
+	printf("\n\t{ \"%s\", %lu,\n\t  \"", name, (unsigned long) stb.st_size);
+
+	while ((c = fgetc(fp)) != EOF) {
+		switch (c) {
+		case '\n':
+			fputs("\\n\"\n\t  \"", stdout);
+			break;
+		case '\t':
+			fputs("\\t", stdout);
+			break;
+		case '"':
+		case '\\':
+			printf("\\%c", c);
+			break;
+		default:
+			fputc(c, stdout);
+			break;
+		}
+	}
+
+	if (ferror(fp)) {
+		fprintf(stderr, "error reading %s: %s\n", filename, strerror(errno));
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	printf("\" },\n");
+	return 0;
+}